@@ -2,6 +2,7 @@
 #include "BlobOnBlocks.h"
 
 #include "datanodestore/DataLeafNode.h"
+#include "readahead/LeafPrefetcher.h"
 #include "utils/Math.h"
 #include <cmath>
 #include <cpp-utils/assert/assert.h>
@@ -12,36 +13,47 @@ using cpputils::Data;
 using blobstore::onblocks::datanodestore::DataLeafNode;
 using blobstore::onblocks::datanodestore::DataNodeLayout;
 using blockstore::Key;
+using boost::optional;
+using boost::none;
 
 namespace blobstore {
 namespace onblocks {
 
 using parallelaccessdatatreestore::DataTreeRef;
+using datatreestore::LeafAccess;
 
-BlobOnBlocks::BlobOnBlocks(unique_ref<DataTreeRef> datatree)
-: _datatree(std::move(datatree)), _sizeCache(boost::none) {
+BlobOnBlocks::BlobOnBlocks(unique_ref<DataTreeRef> datatree, readahead::LeafPrefetcher *leafPrefetcher)
+: _datatree(std::move(datatree)), _leafPrefetcher(leafPrefetcher) {
 }
 
 BlobOnBlocks::~BlobOnBlocks() {
 }
 
 uint64_t BlobOnBlocks::size() const {
-  if (_sizeCache == boost::none) {
-    _sizeCache = _datatree->numStoredBytes();
-  }
-  return *_sizeCache;
+  return _datatree->numStoredBytes();
 }
 
 void BlobOnBlocks::resize(uint64_t numBytes) {
   _datatree->resizeNumBytes(numBytes);
-  _sizeCache = numBytes;
 }
 
-void BlobOnBlocks::traverseLeaves(uint64_t beginByte, uint64_t sizeBytes, function<void (uint64_t, DataLeafNode *leaf, uint32_t, uint32_t)> func) const {
+void BlobOnBlocks::traverseLeaves(uint64_t beginByte, uint64_t sizeBytes, LeafAccess access, function<void (uint64_t, DataLeafNode *leaf, uint32_t, uint32_t)> func) const {
   uint64_t endByte = beginByte + sizeBytes;
-  uint32_t firstLeaf = beginByte / _datatree->maxBytesPerLeaf();
-  uint32_t endLeaf = utils::ceilDivision(endByte, _datatree->maxBytesPerLeaf());
-  bool writingOutside = size() < endByte; // TODO Calling size() is slow because it has to traverse the tree
+  uint64_t maxBytesPerLeaf = _datatree->maxBytesPerLeaf();
+  uint32_t firstLeaf = beginByte / maxBytesPerLeaf;
+  uint32_t endLeaf = utils::ceilDivision(endByte, maxBytesPerLeaf);
+  // Accesses inside the blob don't change the tree, so they can run in parallel with other such accesses
+  bool traversedExistingLeaves = _datatree->traverseExistingLeaves(firstLeaf, endLeaf, endByte, access, [&func, beginByte, endByte, maxBytesPerLeaf] (DataLeafNode *leaf, uint32_t leafIndex) {
+    uint64_t indexOfFirstLeafByte = leafIndex * maxBytesPerLeaf;
+    uint32_t dataBegin = utils::maxZeroSubtraction(beginByte, indexOfFirstLeafByte);
+    uint32_t dataEnd = std::min(maxBytesPerLeaf, endByte - indexOfFirstLeafByte);
+    func(indexOfFirstLeafByte, leaf, dataBegin, dataEnd-dataBegin);
+  });
+  if (traversedExistingLeaves) {
+    return;
+  }
+
+  bool writingOutside = size() < endByte;
   _datatree->traverseLeaves(firstLeaf, endLeaf, [&func, beginByte, endByte, endLeaf, writingOutside](DataLeafNode *leaf, uint32_t leafIndex) {
     uint64_t indexOfFirstLeafByte = leafIndex * leaf->maxStoreableBytes();
     uint32_t dataBegin = utils::maxZeroSubtraction(beginByte, indexOfFirstLeafByte);
@@ -54,12 +66,10 @@ void BlobOnBlocks::traverseLeaves(uint64_t beginByte, uint64_t sizeBytes, functi
   });
   if (writingOutside) {
     ASSERT(_datatree->numStoredBytes() == endByte, "Writing didn't grow by the correct number of bytes");
-    _sizeCache = endByte;
   }
 }
 
 Data BlobOnBlocks::readAll() const {
-  //TODO Querying size is inefficient. Is this possible without a call to size()?
   uint64_t count = size();
   Data result(count);
   _read(result.data(), 0, count);
@@ -73,26 +83,76 @@ void BlobOnBlocks::read(void *target, uint64_t offset, uint64_t count) const {
 }
 
 uint64_t BlobOnBlocks::tryRead(void *target, uint64_t offset, uint64_t count) const {
-  //TODO Quite inefficient to call size() here, because that has to traverse the tree
   uint64_t realCount = std::max(UINT64_C(0), std::min(count, size()-offset));
   _read(target, offset, realCount);
   return realCount;
 }
 
 void BlobOnBlocks::_read(void *target, uint64_t offset, uint64_t count) const {
-  traverseLeaves(offset, count, [target, offset] (uint64_t indexOfFirstLeafByte, const DataLeafNode *leaf, uint32_t leafDataOffset, uint32_t leafDataSize) {
+  traverseLeaves(offset, count, LeafAccess::READ, [target, offset] (uint64_t indexOfFirstLeafByte, const DataLeafNode *leaf, uint32_t leafDataOffset, uint32_t leafDataSize) {
       //TODO Simplify formula, make it easier to understand
-      leaf->read((uint8_t*)target + indexOfFirstLeafByte - offset + leafDataOffset, leafDataOffset, leafDataSize);
+      uint8_t *leafTarget = (uint8_t*)target + indexOfFirstLeafByte - offset + leafDataOffset;
+      if (leaf == nullptr) {
+        // The leaf is a hole
+        std::memset(leafTarget, 0, leafDataSize);
+      } else {
+        leaf->read(leafTarget, leafDataOffset, leafDataSize);
+      }
   });
 }
 
 void BlobOnBlocks::write(const void *source, uint64_t offset, uint64_t count) {
-  traverseLeaves(offset, count, [source, offset] (uint64_t indexOfFirstLeafByte, DataLeafNode *leaf, uint32_t leafDataOffset, uint32_t leafDataSize) {
+  traverseLeaves(offset, count, LeafAccess::WRITE, [source, offset] (uint64_t indexOfFirstLeafByte, DataLeafNode *leaf, uint32_t leafDataOffset, uint32_t leafDataSize) {
     //TODO Simplify formula, make it easier to understand
     leaf->write((uint8_t*)source + indexOfFirstLeafByte - offset + leafDataOffset, leafDataOffset, leafDataSize);
   });
 }
 
+void BlobOnBlocks::writeInPlace(uint64_t offset, uint64_t count, const function<void (void *target, uint64_t size)> &fill) {
+  // traverseLeaves() might restart at the first leaf if it runs into a hole. Other than write(), fill() can't be
+  // repeated, because the data might come from a pipe. So we remember up to where the data was already written.
+  uint64_t writtenUntil = offset;
+  traverseLeaves(offset, count, LeafAccess::WRITE, [&fill, &writtenUntil] (uint64_t indexOfFirstLeafByte, DataLeafNode *leaf, uint32_t leafDataOffset, uint32_t leafDataSize) {
+    uint64_t leafDataEnd = indexOfFirstLeafByte + leafDataOffset + leafDataSize;
+    if (leafDataEnd <= writtenUntil) {
+      return;
+    }
+    leaf->writeInPlace(leafDataOffset, leafDataSize, [&fill, leafDataSize] (void *target) {
+      fill(target, leafDataSize);
+    });
+    writtenUntil = leafDataEnd;
+  });
+}
+
+void BlobOnBlocks::prefetch(uint64_t offset, uint64_t count) const {
+  uint32_t firstLeaf = offset / _datatree->maxBytesPerLeaf();
+  uint32_t endLeaf = utils::ceilDivision(offset + count, _datatree->maxBytesPerLeaf());
+  _datatree->prefetchLeaves(firstLeaf, endLeaf, _leafPrefetcher);
+}
+
+optional<uint64_t> BlobOnBlocks::seekData(uint64_t offset) const {
+  if (offset >= size()) {
+    return none;
+  }
+  auto leafIndex = _datatree->nextDataLeaf(offset / _datatree->maxBytesPerLeaf());
+  if (leafIndex == none) {
+    return none;
+  }
+  return std::max(offset, *leafIndex * _datatree->maxBytesPerLeaf());
+}
+
+optional<uint64_t> BlobOnBlocks::seekHole(uint64_t offset) const {
+  uint64_t blobSize = size();
+  if (offset >= blobSize) {
+    return none;
+  }
+  auto leafIndex = _datatree->nextHoleLeaf(offset / _datatree->maxBytesPerLeaf());
+  if (leafIndex == none) {
+    return blobSize;
+  }
+  return std::min(blobSize, std::max(offset, *leafIndex * _datatree->maxBytesPerLeaf()));
+}
+
 void BlobOnBlocks::flush() {
   _datatree->flush();
 }
@@ -12,13 +12,19 @@ namespace onblocks {
 namespace datanodestore {
 class DataLeafNode;
 }
+namespace datatreestore {
+enum class LeafAccess;
+}
 namespace parallelaccessdatatreestore {
 class DataTreeRef;
 }
+namespace readahead {
+class LeafPrefetcher;
+}
 
 class BlobOnBlocks final: public Blob {
 public:
-  BlobOnBlocks(cpputils::unique_ref<parallelaccessdatatreestore::DataTreeRef> datatree);
+  BlobOnBlocks(cpputils::unique_ref<parallelaccessdatatreestore::DataTreeRef> datatree, readahead::LeafPrefetcher *leafPrefetcher);
   ~BlobOnBlocks();
 
   const blockstore::Key &key() const override;
@@ -30,6 +36,12 @@ public:
   void read(void *target, uint64_t offset, uint64_t size) const override;
   uint64_t tryRead(void *target, uint64_t offset, uint64_t size) const override;
   void write(const void *source, uint64_t offset, uint64_t size) override;
+  void writeInPlace(uint64_t offset, uint64_t size, const std::function<void (void *target, uint64_t size)> &fill) override;
+
+  void prefetch(uint64_t offset, uint64_t size) const override;
+
+  boost::optional<uint64_t> seekData(uint64_t offset) const override;
+  boost::optional<uint64_t> seekHole(uint64_t offset) const override;
 
   void flush() override;
 
@@ -38,10 +50,11 @@ public:
 private:
 
   void _read(void *target, uint64_t offset, uint64_t count) const;
-  void traverseLeaves(uint64_t offsetBytes, uint64_t sizeBytes, std::function<void (uint64_t, datanodestore::DataLeafNode *, uint32_t, uint32_t)>) const;
+  // When reading, func gets nullptr for leaves that are holes
+  void traverseLeaves(uint64_t offsetBytes, uint64_t sizeBytes, datatreestore::LeafAccess access, std::function<void (uint64_t, datanodestore::DataLeafNode *, uint32_t, uint32_t)>) const;
 
   cpputils::unique_ref<parallelaccessdatatreestore::DataTreeRef> _datatree;
-  mutable boost::optional<uint64_t> _sizeCache;
+  readahead::LeafPrefetcher *_leafPrefetcher;
 
   DISALLOW_COPY_AND_ASSIGN(BlobOnBlocks);
 };
@@ -7,8 +7,11 @@
 #include "datatreestore/DataTree.h"
 #include "BlobStoreOnBlocks.h"
 #include "BlobOnBlocks.h"
+#include "readahead/LeafPrefetcher.h"
+#include "removal/BackgroundRemover.h"
 #include <cpp-utils/pointer/cast.h>
 #include <cpp-utils/assert/assert.h>
+#include <cpp-utils/logging/logging.h>
 
 using cpputils::unique_ref;
 using cpputils::make_unique_ref;
@@ -19,6 +22,7 @@ using blockstore::Key;
 using cpputils::dynamic_pointer_move;
 using boost::optional;
 using boost::none;
+using namespace cpputils::logging;
 
 namespace blobstore {
 namespace onblocks {
@@ -26,16 +30,21 @@ namespace onblocks {
 using datanodestore::DataNodeStore;
 using datatreestore::DataTreeStore;
 using parallelaccessdatatreestore::ParallelAccessDataTreeStore;
+using readahead::LeafPrefetcher;
+using removal::BackgroundRemover;
+
+constexpr unsigned int BlobStoreOnBlocks::NUM_PREFETCH_THREADS;
 
 BlobStoreOnBlocks::BlobStoreOnBlocks(unique_ref<BlockStore> blockStore, uint64_t physicalBlocksizeBytes)
-        : _dataTreeStore(make_unique_ref<ParallelAccessDataTreeStore>(make_unique_ref<DataTreeStore>(make_unique_ref<DataNodeStore>(make_unique_ref<ParallelAccessBlockStore>(std::move(blockStore)), physicalBlocksizeBytes)))) {
+        : _dataTreeStore(make_unique_ref<ParallelAccessDataTreeStore>(make_unique_ref<DataTreeStore>(make_unique_ref<DataNodeStore>(make_unique_ref<ParallelAccessBlockStore>(std::move(blockStore)), physicalBlocksizeBytes)))),
+          _leafPrefetcher(make_unique_ref<LeafPrefetcher>(NUM_PREFETCH_THREADS)), _backgroundRemover(none) {
 }
 
 BlobStoreOnBlocks::~BlobStoreOnBlocks() {
 }
 
 unique_ref<Blob> BlobStoreOnBlocks::create() {
-    return make_unique_ref<BlobOnBlocks>(_dataTreeStore->createNewTree());
+    return make_unique_ref<BlobOnBlocks>(_dataTreeStore->createNewTree(), _leafPrefetcher.get());
 }
 
 optional<unique_ref<Blob>> BlobStoreOnBlocks::load(const Key &key) {
@@ -43,13 +52,36 @@ optional<unique_ref<Blob>> BlobStoreOnBlocks::load(const Key &key) {
     if (tree == none) {
         return none;
     }
-    return optional<unique_ref<Blob>>(make_unique_ref<BlobOnBlocks>(std::move(*tree)));
+    return optional<unique_ref<Blob>>(make_unique_ref<BlobOnBlocks>(std::move(*tree), _leafPrefetcher.get()));
 }
 
 void BlobStoreOnBlocks::remove(unique_ref<Blob> blob) {
     auto _blob = dynamic_pointer_move<BlobOnBlocks>(blob);
     ASSERT(_blob != none, "Passed Blob in BlobStoreOnBlocks::remove() is not a BlobOnBlocks.");
-    _dataTreeStore->remove((*_blob)->releaseTree());
+    if (_backgroundRemover != none) {
+        (*_backgroundRemover)->remove((*_blob)->releaseTree());
+    } else {
+        _dataTreeStore->remove((*_blob)->releaseTree());
+    }
+}
+
+void BlobStoreOnBlocks::removeInBackground(const Key &journalKey) {
+    ASSERT(_backgroundRemover == none, "Blobs are already removed in the background");
+    optional<unique_ref<Blob>> journal = load(journalKey);
+    if (journal == none) {
+        auto tree = _dataTreeStore->tryCreateNewTree(journalKey);
+        if (tree == none) {
+            throw std::runtime_error("Couldn't create removal journal " + journalKey.ToString());
+        }
+        journal = optional<unique_ref<Blob>>(make_unique_ref<BlobOnBlocks>(std::move(*tree), _leafPrefetcher.get()));
+    }
+    _backgroundRemover = make_unique_ref<BackgroundRemover>(_dataTreeStore.get(), std::move(*journal));
+}
+
+void BlobStoreOnBlocks::waitForPendingRemovals() {
+    if (_backgroundRemover != none) {
+        (*_backgroundRemover)->waitUntilDone();
+    }
 }
 
 uint64_t BlobStoreOnBlocks::virtualBlocksizeBytes() const {
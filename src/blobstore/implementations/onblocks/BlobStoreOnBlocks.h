@@ -11,6 +11,12 @@ namespace onblocks {
 namespace parallelaccessdatatreestore {
 class ParallelAccessDataTreeStore;
 }
+namespace readahead {
+class LeafPrefetcher;
+}
+namespace removal {
+class BackgroundRemover;
+}
 
 //TODO Make blobstore able to cope with incomplete data (some blocks missing, because they're not synchronized yet) and write test cases for that
 
@@ -24,14 +30,29 @@ public:
 
   void remove(cpputils::unique_ref<Blob> blob) override;
 
+  // After calling this, remove() only schedules removing the blob and returns. The nodes of the blob are removed on
+  // a background thread. Blobs that aren't removed yet are stored in the journal blob with the given key, so their
+  // removal is resumed when this is called with the same journal again, e.g. after the blob store was closed.
+  // If the journal blob doesn't exist yet, it is created with the given key.
+  void removeInBackground(const blockstore::Key &journalKey);
+  // Blocks until all blobs given to remove() are removed
+  void waitForPendingRemovals();
+
   //TODO Test blocksizeBytes/numBlocks/estimateSpaceForNumBlocksLeft
   //virtual means "space we can use" as opposed to "space it takes on the disk" (i.e. virtual is without headers, checksums, ...)
   uint64_t virtualBlocksizeBytes() const override;
   uint64_t numBlocks() const override;
   uint64_t estimateSpaceForNumBlocksLeft() const override;
 
+  // Number of threads loading leaves that are read ahead
+  static constexpr unsigned int NUM_PREFETCH_THREADS = 8;
+
 private:
   cpputils::unique_ref<parallelaccessdatatreestore::ParallelAccessDataTreeStore> _dataTreeStore;
+  // This has to be declared after _dataTreeStore, because it loads nodes from there until it is destructed.
+  cpputils::unique_ref<readahead::LeafPrefetcher> _leafPrefetcher;
+  // This has to be declared last, because it removes trees from _dataTreeStore until it is destructed.
+  boost::optional<cpputils::unique_ref<removal::BackgroundRemover>> _backgroundRemover;
 
   DISALLOW_COPY_AND_ASSIGN(BlobStoreOnBlocks);
 };
@@ -15,9 +15,7 @@ namespace datanodestore {
 DataInnerNode::DataInnerNode(DataNodeView view)
 : DataNode(std::move(view)) {
   ASSERT(depth() > 0, "Inner node can't have depth 0. Is this a leaf maybe?");
-  if (node().FormatVersion() != FORMAT_VERSION_HEADER) {
-    throw std::runtime_error("This node format is not supported. Was it created with a newer version of CryFS?");
-  }
+  checkFormatVersion();
 }
 
 DataInnerNode::~DataInnerNode() {
@@ -33,6 +31,20 @@ unique_ref<DataInnerNode> DataInnerNode::InitializeNewNode(unique_ref<Block> blo
   return result;
 }
 
+unique_ref<DataInnerNode> DataInnerNode::InitializeNewNodeWithHoles(unique_ref<Block> block, uint8_t depth, uint32_t numChildren) {
+  ASSERT(depth > 0, "Inner node can't have depth 0");
+  DataNodeView node(std::move(block));
+  node.setFormatVersion(DataNode::FORMAT_VERSION_HEADER);
+  node.setDepth(depth);
+  node.setSize(numChildren);
+  auto result = make_unique_ref<DataInnerNode>(std::move(node));
+  ASSERT(numChildren > 0 && numChildren <= result->maxStoreableChildren(), "Invalid number of children");
+  for (uint32_t i = 0; i < numChildren; ++i) {
+    result->setChildKey(i, Key::Null());
+  }
+  return result;
+}
+
 uint32_t DataInnerNode::numChildren() const {
   return node().Size();
 }
@@ -77,6 +89,43 @@ void DataInnerNode::addChild(const DataNode &child) {
   LastChild()->setKey(child.key());
 }
 
+void DataInnerNode::addHole() {
+  ASSERT(numChildren() < maxStoreableChildren(), "Adding more children than we can store");
+  node().setSize(node().Size()+1);
+  setChildKey(numChildren()-1, Key::Null());
+}
+
+void DataInnerNode::replaceHoleWithChild(unsigned int index, const DataNode &child) {
+  ASSERT(getChild(index)->isHole(), "Child isn't a hole");
+  ASSERT(child.depth() == depth()-1, "The child has wrong depth");
+  setChildKey(index, child.key());
+}
+
+void DataInnerNode::replaceChildWithHole(unsigned int index) {
+  ASSERT(index < numChildren(), "Accessing child out of range");
+  setChildKey(index, Key::Null());
+}
+
+bool DataInnerNode::hasOnlyHoles() const {
+  for (const ChildEntry *child = ChildrenBegin(); child != ChildrenEnd(); ++child) {
+    if (!child->isHole()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void DataInnerNode::setChildKey(unsigned int index, const Key &key) {
+  if (key == Key::Null() && node().FormatVersion() != FORMAT_VERSION_HEADER) {
+    // Nodes from older versions can't have holes. Upgrade the node so versions that don't know about holes reject it.
+    node().setFormatVersion(FORMAT_VERSION_HEADER);
+  }
+  // Write through the block (and not through ChildEntry::setKey), so it knows that it has to be stored again
+  uint8_t keyData[Key::BINARY_LENGTH];
+  key.ToBinary(keyData);
+  node().write(keyData, index * sizeof(ChildEntry), sizeof(ChildEntry));
+}
+
 void DataInnerNode::removeLastChild() {
   ASSERT(node().Size() > 1, "There is no child to remove");
   node().setSize(node().Size()-1);
@@ -12,6 +12,8 @@ namespace datanodestore {
 class DataInnerNode final: public DataNode {
 public:
   static cpputils::unique_ref<DataInnerNode> InitializeNewNode(cpputils::unique_ref<blockstore::Block> block, const DataNode &first_child_key);
+  // Initializes a node with the given depth whose children are all holes
+  static cpputils::unique_ref<DataInnerNode> InitializeNewNodeWithHoles(cpputils::unique_ref<blockstore::Block> block, uint8_t depth, uint32_t numChildren);
 
   DataInnerNode(DataNodeView block);
   ~DataInnerNode();
@@ -26,6 +28,11 @@ public:
   uint32_t numChildren() const;
 
   void addChild(const DataNode &child_key);
+  void addHole();
+
+  void replaceHoleWithChild(unsigned int index, const DataNode &child);
+  void replaceChildWithHole(unsigned int index);
+  bool hasOnlyHoles() const;
 
   void removeLastChild();
 
@@ -33,6 +40,7 @@ public:
   const ChildEntry *LastChild() const;
 
 private:
+  void setChildKey(unsigned int index, const blockstore::Key &key);
 
   ChildEntry *ChildrenBegin();
   ChildEntry *ChildrenEnd();
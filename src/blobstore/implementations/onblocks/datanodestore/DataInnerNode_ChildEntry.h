@@ -13,6 +13,11 @@ public:
   blockstore::Key key() const {
     return blockstore::Key::FromBinary(_keydata);
   }
+
+  // A child with the null key is a hole, i.e. a full subtree that only contains zeroes and isn't stored.
+  bool isHole() const {
+    return key() == blockstore::Key::Null();
+  }
 private:
   void setKey(const blockstore::Key &key) {
     key.ToBinary(_keydata);
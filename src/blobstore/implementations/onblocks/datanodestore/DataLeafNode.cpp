@@ -16,9 +16,7 @@ DataLeafNode::DataLeafNode(DataNodeView view)
 : DataNode(std::move(view)) {
   ASSERT(node().Depth() == 0, "Leaf node must have depth 0. Is it an inner node instead?");
   ASSERT(numBytes() <= maxStoreableBytes(), "Leaf says it stores more bytes than it has space for");
-  if (node().FormatVersion() != FORMAT_VERSION_HEADER) {
-    throw std::runtime_error("This node format is not supported. Was it created with a newer version of CryFS?");
-  }
+  checkFormatVersion();
 }
 
 DataLeafNode::~DataLeafNode() {
@@ -43,10 +41,22 @@ void DataLeafNode::write(const void *source, uint64_t offset, uint64_t size) {
   node().write(source, offset, size);
 }
 
+void DataLeafNode::writeInPlace(uint64_t offset, uint64_t size, const std::function<void (void *target)> &fill) {
+  ASSERT(offset <= node().Size() && offset + size <= node().Size(), "Write out of valid area"); // Also check offset, because the addition could lead to overflows
+  node().writeInPlace(offset, size, fill);
+}
+
 uint32_t DataLeafNode::numBytes() const {
   return node().Size();
 }
 
+bool DataLeafNode::containsOnlyZeroes() const {
+  const uint8_t *data = static_cast<const uint8_t*>(node().data());
+  uint32_t size = numBytes();
+  // If the first byte is zero and each byte equals its successor, all bytes are zero
+  return size == 0 || (data[0] == 0 && 0 == std::memcmp(data, data + 1, size - 1));
+}
+
 void DataLeafNode::resize(uint32_t new_size) {
   ASSERT(new_size <= maxStoreableBytes(), "Trying to resize to a size larger than the maximal size");
   uint32_t old_size = node().Size();
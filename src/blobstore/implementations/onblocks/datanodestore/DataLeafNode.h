@@ -21,9 +21,13 @@ public:
 
   void read(void *target, uint64_t offset, uint64_t size) const;
   void write(const void *source, uint64_t offset, uint64_t size);
+  // Lets fill() write the data directly into the leaf block, see blockstore::Block::writeInPlace()
+  void writeInPlace(uint64_t offset, uint64_t size, const std::function<void (void *target)> &fill);
 
   uint32_t numBytes() const;
 
+  bool containsOnlyZeroes() const;
+
   void resize(uint32_t size);
 
 private:
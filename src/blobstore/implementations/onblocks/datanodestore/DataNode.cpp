@@ -15,6 +15,7 @@ namespace onblocks {
 namespace datanodestore {
 
 constexpr uint16_t DataNode::FORMAT_VERSION_HEADER;
+constexpr uint16_t DataNode::FORMAT_VERSION_HEADER_WITHOUT_HOLES;
 
 DataNode::DataNode(DataNodeView node)
 : _node(std::move(node)) {
@@ -39,6 +40,13 @@ uint8_t DataNode::depth() const {
   return _node.Depth();
 }
 
+void DataNode::checkFormatVersion() const {
+  uint16_t formatVersion = _node.FormatVersion();
+  if (formatVersion != FORMAT_VERSION_HEADER && formatVersion != FORMAT_VERSION_HEADER_WITHOUT_HOLES) {
+    throw runtime_error("This node format is not supported. Was it created with a newer version of CryFS?");
+  }
+}
+
 unique_ref<DataInnerNode> DataNode::convertToNewInnerNode(unique_ref<DataNode> node, const DataNode &first_child) {
   Key key = node->key();
   auto block = node->_node.releaseBlock();
@@ -25,7 +25,13 @@ public:
 
 protected:
   // The FORMAT_VERSION_HEADER is used to allow future versions to have compatibility.
-  static constexpr uint16_t FORMAT_VERSION_HEADER = 0;
+  // Version 1 added holes (inner node children with a null key). Nodes are created with version 1, but version 0 nodes
+  // are still read, because they can't contain holes. They're upgraded when a hole is written to them, so CryFS
+  // versions that don't know about holes refuse to load them.
+  static constexpr uint16_t FORMAT_VERSION_HEADER = 1;
+  static constexpr uint16_t FORMAT_VERSION_HEADER_WITHOUT_HOLES = 0;
+
+  void checkFormatVersion() const;
 
   DataNode(DataNodeView block);
 
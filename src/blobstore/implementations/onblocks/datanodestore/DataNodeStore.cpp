@@ -47,12 +47,28 @@ unique_ref<DataInnerNode> DataNodeStore::createNewInnerNode(const DataNode &firs
   return DataInnerNode::InitializeNewNode(std::move(block), first_child);
 }
 
+unique_ref<DataInnerNode> DataNodeStore::createNewInnerNodeWithHoles(uint8_t depth, uint32_t numChildren) {
+  ASSERT(depth <= MAX_DEPTH, "Tree is too deep");
+  auto block = _blockstore->create(Data(_layout.blocksizeBytes()).FillWithZeroes());
+  return DataInnerNode::InitializeNewNodeWithHoles(std::move(block), depth, numChildren);
+}
+
 unique_ref<DataLeafNode> DataNodeStore::createNewLeafNode() {
   //TODO Initialize block and then create it in the blockstore - this is more efficient than creating it and then writing to it
   auto block = _blockstore->create(Data(_layout.blocksizeBytes()).FillWithZeroes());
   return DataLeafNode::InitializeNewNode(std::move(block));
 }
 
+optional<unique_ref<DataLeafNode>> DataNodeStore::tryCreateNewLeafNode(const Key &key) {
+  Data data(_layout.blocksizeBytes());
+  data.FillWithZeroes();
+  auto block = _blockstore->tryCreate(key, std::move(data));
+  if (block == none) {
+    return none;
+  }
+  return DataLeafNode::InitializeNewNode(std::move(*block));
+}
+
 optional<unique_ref<DataNode>> DataNodeStore::load(const Key &key) {
   auto block = _blockstore->load(key);
   if (block == none) {
@@ -88,6 +104,10 @@ void DataNodeStore::remove(unique_ref<DataNode> node) {
   _blockstore->remove(std::move(block));
 }
 
+void DataNodeStore::flush(const std::vector<Key> &keys) {
+  _blockstore->flush(keys);
+}
+
 uint64_t DataNodeStore::numNodes() const {
   return _blockstore->numBlocks();
 }
@@ -101,18 +121,34 @@ uint64_t DataNodeStore::virtualBlocksizeBytes() const {
 }
 
 void DataNodeStore::removeSubtree(unique_ref<DataNode> node) {
-  //TODO Make this faster by not loading the leaves but just deleting them. Can be recognized, because of the depth of their parents.
   DataInnerNode *inner = dynamic_cast<DataInnerNode*>(node.get());
   if (inner != nullptr) {
     for (uint32_t i = 0; i < inner->numChildren(); ++i) {
-      auto child = load(inner->getChild(i)->key());
-      ASSERT(child != none, "Couldn't load child node");
-      removeSubtree(std::move(*child));
+      if (inner->getChild(i)->isHole()) {
+        // Holes aren't stored, there's nothing to remove
+        continue;
+      }
+      removeSubtree(inner->depth() - 1, inner->getChild(i)->key());
     }
   }
   remove(std::move(node));
 }
 
+void DataNodeStore::removeSubtree(uint8_t depth, const Key &key) {
+  if (depth == 0) {
+    // Leaves don't have children, so we don't have to load (and decrypt) them
+    _blockstore->remove(key);
+    return;
+  }
+  auto node = load(key);
+  if (node == none) {
+    // This happens when a removal that was interrupted before is resumed
+    return;
+  }
+  ASSERT((*node)->depth() == depth, "Child node has wrong depth");
+  removeSubtree(std::move(*node));
+}
+
 DataNodeLayout DataNodeStore::layout() const {
   return _layout;
 }
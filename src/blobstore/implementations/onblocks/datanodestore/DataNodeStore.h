@@ -31,7 +31,10 @@ public:
   boost::optional<cpputils::unique_ref<DataNode>> load(const blockstore::Key &key);
 
   cpputils::unique_ref<DataLeafNode> createNewLeafNode();
+  // Returns none if a node with this key already exists
+  boost::optional<cpputils::unique_ref<DataLeafNode>> tryCreateNewLeafNode(const blockstore::Key &key);
   cpputils::unique_ref<DataInnerNode> createNewInnerNode(const DataNode &first_child);
+  cpputils::unique_ref<DataInnerNode> createNewInnerNodeWithHoles(uint8_t depth, uint32_t numChildren);
 
   cpputils::unique_ref<DataNode> createNewNodeAsCopyFrom(const DataNode &source);
 
@@ -40,6 +43,12 @@ public:
   void remove(cpputils::unique_ref<DataNode> node);
 
   void removeSubtree(cpputils::unique_ref<DataNode> node);
+  // Removes the subtree rooted at the node with the given key, which has to have the given depth.
+  // The leaves are removed without loading them. Nodes that were already removed are skipped.
+  void removeSubtree(uint8_t depth, const blockstore::Key &key);
+
+  // See BlockStore::flush()
+  void flush(const std::vector<blockstore::Key> &keys);
 
   //TODO Test blocksizeBytes/numBlocks/estimateSpaceForNumBlocksLeft
   uint64_t virtualBlocksizeBytes() const;
@@ -99,6 +99,10 @@ public:
     _block->write(source, offset + DataNodeLayout::HEADERSIZE_BYTES, size);
   }
 
+  void writeInPlace(uint64_t offset, uint64_t size, const std::function<void (void *target)> &fill) {
+    _block->writeInPlace(offset + DataNodeLayout::HEADERSIZE_BYTES, size, fill);
+  }
+
   template<typename Entry>
   const Entry *DataBegin() const {
     return GetOffset<DataNodeLayout::HEADERSIZE_BYTES, Entry>();
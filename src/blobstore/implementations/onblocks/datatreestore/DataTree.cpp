@@ -1,11 +1,12 @@
 #include "DataTree.h"
+#include "ParallelNodeLoader.h"
 
 #include "../datanodestore/DataNodeStore.h"
 #include "../datanodestore/DataInnerNode.h"
 #include "../datanodestore/DataLeafNode.h"
 #include "../utils/Math.h"
 
-#include "impl/algorithms.h"
+#include "../readahead/LeafPrefetcher.h"
 
 #include <cpp-utils/pointer/cast.h>
 #include <cpp-utils/pointer/optional_ownership_ptr.h>
@@ -25,6 +26,7 @@ using boost::shared_mutex;
 using boost::shared_lock;
 using boost::unique_lock;
 using boost::none;
+using boost::optional;
 using std::vector;
 
 using cpputils::dynamic_pointer_move;
@@ -37,77 +39,217 @@ namespace blobstore {
 namespace onblocks {
 namespace datatreestore {
 
-DataTree::DataTree(DataNodeStore *nodeStore, unique_ref<DataNode> rootNode)
-  : _mutex(), _nodeStore(nodeStore), _rootNode(std::move(rootNode)) {
+constexpr unsigned int DataTree::NUM_LEAF_MUTEXES;
+
+DataTree::DataTree(DataNodeStore *nodeStore, ParallelNodeLoader *nodeLoader, unique_ref<DataNode> rootNode)
+  : _mutex(), _leafMutexes(), _nodeStore(nodeStore), _nodeLoader(nodeLoader), _rootNode(std::move(rootNode)), _numLeavesCache(none), _numStoredBytesCache(none),
+    _changedNodesMutex(), _changedNodes() {
 }
 
 DataTree::~DataTree() {
 }
 
-void DataTree::removeLastDataLeaf() {
-  auto deletePosOrNull = algorithms::GetLowestRightBorderNodeWithMoreThanOneChildOrNull(_nodeStore, _rootNode.get());
-  ASSERT(deletePosOrNull.get() != nullptr, "Tree has only one leaf, can't shrink it.");
+void DataTree::deleteLastChildSubtree(DataInnerNode *node) {
+  if (!node->LastChild()->isHole()) {
+    auto lastChild = _nodeStore->load(node->LastChild()->key());
+    ASSERT(lastChild != none, "Couldn't load last child");
+    _nodeStore->removeSubtree(std::move(*lastChild));
+  }
+  node->removeLastChild();
+  _rememberChanged(*node);
+}
+
+void DataTree::decreaseTreeDepthWhileRootHasOnlyOneChild() {
+  DataInnerNode *rootNode = dynamic_cast<DataInnerNode*>(_rootNode.get());
+  while (rootNode != nullptr && rootNode->numChildren() == 1) {
+    auto child = _loadOrMaterializeChild(rootNode, 0);
+    _rootNode = _nodeStore->overwriteNodeWith(std::move(_rootNode), *child);
+    _nodeStore->remove(std::move(child));
+    rootNode = dynamic_cast<DataInnerNode*>(_rootNode.get());
+  }
+}
+
+void DataTree::_growToNumLeaves(uint32_t newNumLeaves) {
+  uint32_t oldNumLeaves = _numLeaves();
+  ASSERT(oldNumLeaves < newNumLeaves, "This can only grow the tree");
+  // Forget the cached size while growing, so it gets recomputed if growing fails halfway through
+  _numLeavesCache = none;
+  _numStoredBytesCache = none;
 
-  deleteLastChildSubtree(deletePosOrNull.get());
+  // The old last leaf isn't the last leaf anymore, so it has to be full
+  {
+    auto oldLastLeaf = LastLeaf(_rootNode.get());
+    oldLastLeaf->resize(_nodeStore->layout().maxBytesPerLeaf());
+    _rememberChanged(*oldLastLeaf);
+  }
+  uint8_t neededTreeDepth = utils::ceilLog(_nodeStore->layout().maxChildrenPerInnerNode(), (uint64_t)newNumLeaves);
+  if (_rootNode->depth() < neededTreeDepth) {
+    increaseTreeDepth(neededTreeDepth - _rootNode->depth());
+  }
+  DataInnerNode *root = dynamic_cast<DataInnerNode*>(_rootNode.get());
+  ASSERT(root != nullptr, "A tree with more than one leaf must have an inner node as root");
+  _growSubtree(root, newNumLeaves, true);
 
-  ifRootHasOnlyOneChildReplaceRootWithItsChild();
+  _numLeavesCache = newNumLeaves;
+  _numStoredBytesCache = (uint64_t)newNumLeaves * _nodeStore->layout().maxBytesPerLeaf();
 }
 
-void DataTree::ifRootHasOnlyOneChildReplaceRootWithItsChild() {
-  DataInnerNode *rootNode = dynamic_cast<DataInnerNode*>(_rootNode.get());
-  ASSERT(rootNode != nullptr, "RootNode is not an inner node");
-  if (rootNode->numChildren() == 1) {
-    auto child = _nodeStore->load(rootNode->getChild(0)->key());
-    ASSERT(child != none, "Couldn't load first child of root node");
-    _rootNode = _nodeStore->overwriteNodeWith(std::move(_rootNode), **child);
-    _nodeStore->remove(std::move(*child));
+void DataTree::_growSubtree(DataInnerNode *node, uint32_t newNumLeaves, bool isRightBorder) {
+  uint64_t leavesPerChild = leavesPerFullChild(*node);
+  uint32_t newNumChildren = utils::ceilDivision((uint64_t)newNumLeaves, leavesPerChild);
+  ASSERT(node->numChildren() <= newNumChildren && newNumChildren <= _nodeStore->layout().maxChildrenPerInnerNode(), "Subtree has the wrong depth for this number of leaves");
+  if (node->depth() > 1 && !node->LastChild()->isHole()) {
+    // All children except for the last one are full already, but the last one might need more leaves.
+    // If it is a hole, it is full as well.
+    uint32_t lastChildIndex = node->numChildren() - 1;
+    auto lastChild = _nodeStore->load(node->LastChild()->key());
+    ASSERT(lastChild != none, "Couldn't load last child");
+    auto lastInnerChild = dynamic_pointer_move<DataInnerNode>(*lastChild);
+    ASSERT(lastInnerChild != none, "Children of an inner node with depth > 1 must be inner nodes");
+    bool lastChildStaysOnRightBorder = isRightBorder && (newNumChildren == node->numChildren());
+    _growSubtree(lastInnerChild->get(), std::min(leavesPerChild, newNumLeaves - lastChildIndex * leavesPerChild), lastChildStaysOnRightBorder);
   }
+  for (uint32_t childIndex = node->numChildren(); childIndex < newNumChildren; ++childIndex) {
+    if (!isRightBorder || childIndex < newNumChildren - 1) {
+      // Subtrees that aren't on the right border are full, they only contain zeroes and don't have to be stored
+      ASSERT(newNumLeaves - childIndex * leavesPerChild >= leavesPerChild, "Subtree isn't full");
+      node->addHole();
+    } else {
+      auto child = _createSparseSubtree(node->depth() - 1, newNumLeaves - childIndex * leavesPerChild);
+      node->addChild(*child);
+    }
+  }
+  _rememberChanged(*node);
 }
 
-void DataTree::deleteLastChildSubtree(DataInnerNode *node) {
-  auto lastChild = _nodeStore->load(node->LastChild()->key());
-  ASSERT(lastChild != none, "Couldn't load last child");
-  _nodeStore->removeSubtree(std::move(*lastChild));
-  node->removeLastChild();
+unique_ref<DataNode> DataTree::_createSparseSubtree(uint8_t depth, uint32_t numLeaves) {
+  if (depth == 0) {
+    ASSERT(numLeaves == 1, "A leaf is a subtree with exactly one leaf");
+    auto leaf = _nodeStore->createNewLeafNode();
+    leaf->resize(_nodeStore->layout().maxBytesPerLeaf());
+    _rememberChanged(*leaf);
+    return std::move(leaf);
+  }
+  // Only the last child is stored, it is on the right border of the tree. All other children are holes.
+  uint64_t leavesPerChild = utils::intPow(_nodeStore->layout().maxChildrenPerInnerNode(), (uint64_t)depth-1);
+  uint32_t numChildren = utils::ceilDivision((uint64_t)numLeaves, leavesPerChild);
+  auto lastChild = _createSparseSubtree(depth - 1, numLeaves - (numChildren - 1) * leavesPerChild);
+  auto node = _nodeStore->createNewInnerNodeWithHoles(depth, numChildren);
+  node->replaceHoleWithChild(numChildren - 1, *lastChild);
+  _rememberChanged(*node);
+  return std::move(node);
+}
+
+void DataTree::_shrinkToNumLeaves(uint32_t newNumLeaves) {
+  DataInnerNode *root = dynamic_cast<DataInnerNode*>(_rootNode.get());
+  ASSERT(root != nullptr, "A tree with only one leaf can't shrink");
+  _shrinkSubtree(root, newNumLeaves);
+  decreaseTreeDepthWhileRootHasOnlyOneChild();
 }
 
-unique_ref<DataLeafNode> DataTree::addDataLeaf() {
-  auto insertPosOrNull = algorithms::GetLowestInnerRightBorderNodeWithLessThanKChildrenOrNull(_nodeStore, _rootNode.get());
-  if (insertPosOrNull) {
-    return addDataLeafAt(insertPosOrNull.get());
+void DataTree::_shrinkSubtree(DataInnerNode *node, uint32_t newNumLeaves) {
+  uint64_t leavesPerChild = leavesPerFullChild(*node);
+  uint32_t newNumChildren = utils::ceilDivision((uint64_t)newNumLeaves, leavesPerChild);
+  ASSERT(newNumChildren >= 1 && newNumChildren <= node->numChildren(), "This can only shrink the subtree");
+  while (node->numChildren() > newNumChildren) {
+    deleteLastChildSubtree(node);
+  }
+  uint32_t numLeavesInLastChild = newNumLeaves - (newNumChildren - 1) * leavesPerChild;
+  if (node->depth() > 1 && numLeavesInLastChild < leavesPerChild) {
+    auto lastChild = _loadOrMaterializeChild(node, newNumChildren - 1);
+    auto lastInnerChild = dynamic_pointer_move<DataInnerNode>(lastChild);
+    ASSERT(lastInnerChild != none, "Children of an inner node with depth > 1 must be inner nodes");
+    _shrinkSubtree(lastInnerChild->get(), numLeavesInLastChild);
+  }
+}
+
+unique_ref<DataNode> DataTree::_materializeHole(DataInnerNode *parent, uint32_t childIndex) {
+  ASSERT(parent->getChild(childIndex)->isHole(), "Child isn't a hole");
+  uint8_t depth = parent->depth() - 1;
+  unique_ref<DataNode> child = [this, depth] () -> unique_ref<DataNode> {
+    if (depth == 0) {
+      auto leaf = _nodeStore->createNewLeafNode();
+      leaf->resize(_nodeStore->layout().maxBytesPerLeaf());
+      return std::move(leaf);
+    }
+    // Only store this node, its children stay holes
+    return _nodeStore->createNewInnerNodeWithHoles(depth, _nodeStore->layout().maxChildrenPerInnerNode());
+  }();
+  parent->replaceHoleWithChild(childIndex, *child);
+  _rememberChanged(*parent);
+  _rememberChanged(*child);
+  return child;
+}
+
+unique_ref<DataNode> DataTree::_loadOrMaterializeChild(DataInnerNode *parent, uint32_t childIndex) {
+  if (parent->getChild(childIndex)->isHole()) {
+    return _materializeHole(parent, childIndex);
+  }
+  auto child = _nodeStore->load(parent->getChild(childIndex)->key());
+  ASSERT(child != none, "Couldn't load child node");
+  return std::move(*child);
+}
+
+void DataTree::_replaceZeroLeavesWithHoles(const vector<uint32_t> &leafIndices) {
+  DataInnerNode *root = dynamic_cast<DataInnerNode*>(_rootNode.get());
+  if (root == nullptr) {
+    // The only leaf is the last leaf, and that one is always stored
+    return;
+  }
+  for (uint32_t leafIndex : leafIndices) {
+    // The last leaf is always stored, so we can compute the size of the tree without looking at holes
+    if (leafIndex + 1 < _numLeaves()) {
+      _replaceZeroLeafWithHole(root, leafIndex);
+    }
+  }
+}
+
+bool DataTree::_replaceZeroLeafWithHole(DataInnerNode *node, uint32_t leafIndex) {
+  uint32_t leavesPerChild = leavesPerFullChild(*node);
+  uint32_t childIndex = leafIndex / leavesPerChild;
+  if (node->getChild(childIndex)->isHole()) {
+    return false;
+  }
+  auto child = _nodeStore->load(node->getChild(childIndex)->key());
+  ASSERT(child != none, "Couldn't load child node");
+  if (node->depth() == 1) {
+    const DataLeafNode *leaf = dynamic_cast<const DataLeafNode*>(child->get());
+    ASSERT(leaf != nullptr, "Children of an inner node with depth 1 must be leaves");
+    if (!_isZeroLeaf(*leaf)) {
+      return false;
+    }
   } else {
-    return addDataLeafToFullTree();
+    DataInnerNode *innerChild = dynamic_cast<DataInnerNode*>(child->get());
+    ASSERT(innerChild != nullptr, "Children of an inner node with depth > 1 must be inner nodes");
+    // An inner node can only become a hole if it is full, otherwise the hole would have too many leaves
+    if (!_replaceZeroLeafWithHole(innerChild, leafIndex % leavesPerChild) || innerChild->numChildren() < innerChild->maxStoreableChildren()) {
+      return false;
+    }
   }
+  _nodeStore->remove(std::move(*child));
+  node->replaceChildWithHole(childIndex);
+  _rememberChanged(*node);
+  return node->hasOnlyHoles();
 }
 
-unique_ref<DataLeafNode> DataTree::addDataLeafAt(DataInnerNode *insertPos) {
-  auto new_leaf = _nodeStore->createNewLeafNode();
-  auto chain = createChainOfInnerNodes(insertPos->depth()-1, new_leaf.get());
-  insertPos->addChild(*chain);
-  return new_leaf;
+bool DataTree::_isZeroLeaf(const DataLeafNode &leaf) const {
+  return leaf.numBytes() == _nodeStore->layout().maxBytesPerLeaf() && leaf.containsOnlyZeroes();
 }
 
 optional_ownership_ptr<DataNode> DataTree::createChainOfInnerNodes(unsigned int num, DataNode *child) {
-  //TODO This function is implemented twice, once with optional_ownership_ptr, once with unique_ref. Redundancy!
   optional_ownership_ptr<DataNode> chain = cpputils::WithoutOwnership<DataNode>(child);
   for(unsigned int i=0; i<num; ++i) {
     auto newnode = _nodeStore->createNewInnerNode(*chain);
+    _rememberChanged(*newnode);
     chain = cpputils::WithOwnership<DataNode>(std::move(newnode));
   }
   return chain;
 }
 
-unique_ref<DataNode> DataTree::createChainOfInnerNodes(unsigned int num, unique_ref<DataNode> child) {
-  unique_ref<DataNode> chain = std::move(child);
-  for(unsigned int i=0; i<num; ++i) {
-    chain = _nodeStore->createNewInnerNode(*chain);
-  }
-  return chain;
-}
-
 DataInnerNode* DataTree::increaseTreeDepth(unsigned int levels) {
   ASSERT(levels >= 1, "Parameter out of bounds: tried to increase tree depth by zero.");
   auto copyOfOldRoot = _nodeStore->createNewNodeAsCopyFrom(*_rootNode);
+  _rememberChanged(*copyOfOldRoot);
   auto chain = createChainOfInnerNodes(levels-1, copyOfOldRoot.get());
   auto newRootNode = DataNode::convertToNewInnerNode(std::move(_rootNode), *chain);
   DataInnerNode *result = newRootNode.get();
@@ -115,12 +257,6 @@ DataInnerNode* DataTree::increaseTreeDepth(unsigned int levels) {
   return result;
 }
 
-unique_ref<DataLeafNode> DataTree::addDataLeafToFullTree() {
-  DataInnerNode *rootNode = increaseTreeDepth(1);
-  auto newLeaf = addDataLeafAt(rootNode);
-  return newLeaf;
-}
-
 const Key &DataTree::key() const {
   return _rootNode->key();
 }
@@ -130,6 +266,22 @@ void DataTree::flush() const {
   unique_lock<shared_mutex> lock(_mutex);
   // We also have to flush the root node
   _rootNode->flush();
+  vector<Key> changedNodes;
+  {
+    std::unique_lock<std::mutex> changedNodesLock(_changedNodesMutex);
+    changedNodes.assign(_changedNodes.begin(), _changedNodes.end());
+  }
+  changedNodes.push_back(_rootNode->key());
+  // The other changed nodes were released, so the block store may still be writing them back in the background.
+  // Only forget them once they're stored, so a failing flush is retried by the next one.
+  _nodeStore->flush(changedNodes);
+  std::unique_lock<std::mutex> changedNodesLock(_changedNodesMutex);
+  _changedNodes.clear();
+}
+
+void DataTree::_rememberChanged(const DataNode &node) {
+  std::unique_lock<std::mutex> lock(_changedNodesMutex);
+  _changedNodes.insert(node.key());
 }
 
 unique_ref<DataNode> DataTree::releaseRootNode() {
@@ -139,7 +291,29 @@ unique_ref<DataNode> DataTree::releaseRootNode() {
 //TODO Test numLeaves(), for example also two configurations with same number of bytes but different number of leaves (last leaf has 0 bytes)
 uint32_t DataTree::numLeaves() const {
   shared_lock<shared_mutex> lock(_mutex);
-  return _numLeaves(*_rootNode);
+  _computeSizeCacheIfNeeded(&lock);
+  return *_numLeavesCache;
+}
+
+void DataTree::_computeSizeCacheIfNeeded(shared_lock<shared_mutex> *lock) const {
+  if (_numLeavesCache != none && _numStoredBytesCache != none) {
+    return;
+  }
+  // The caches may only be written with an exclusive lock
+  lock->unlock();
+  {
+    unique_lock<shared_mutex> exclusiveLock(_mutex);
+    _numLeaves();
+    _numStoredBytes();
+  }
+  lock->lock();
+}
+
+uint32_t DataTree::_numLeaves() const {
+  if (_numLeavesCache == none) {
+    _numLeavesCache = _numLeaves(*_rootNode);
+  }
+  return *_numLeavesCache;
 }
 
 uint32_t DataTree::_numLeaves(const DataNode &node) const {
@@ -150,6 +324,9 @@ uint32_t DataTree::_numLeaves(const DataNode &node) const {
 
   const DataInnerNode &inner = dynamic_cast<const DataInnerNode&>(node);
   uint64_t numLeavesInLeftChildren = (uint64_t)(inner.numChildren()-1) * leavesPerFullChild(inner);
+  if (inner.LastChild()->isHole()) {
+    return numLeavesInLeftChildren + leavesPerFullChild(inner);
+  }
   auto lastChild = _nodeStore->load(inner.LastChild()->key());
   ASSERT(lastChild != none, "Couldn't load last child");
   uint64_t numLeavesInRightChild = _numLeaves(**lastChild);
@@ -158,95 +335,225 @@ uint32_t DataTree::_numLeaves(const DataNode &node) const {
 }
 
 void DataTree::traverseLeaves(uint32_t beginIndex, uint32_t endIndex, function<void (DataLeafNode*, uint32_t)> func) {
-  //TODO Can we traverse in parallel?
-  unique_lock<shared_mutex> lock(_mutex); //TODO Only lock when resizing. Otherwise parallel read/write to a blob is not possible!
+  // Accesses that don't grow the tree should use traverseExistingLeaves(), which can run in parallel
+  unique_lock<shared_mutex> lock(_mutex);
   ASSERT(beginIndex <= endIndex, "Invalid parameters");
   if (0 == endIndex) {
-    // In this case the utils::ceilLog(_, endIndex) below would fail
+    // Nothing to traverse, and the tree doesn't have to grow
     return;
   }
 
-  uint8_t neededTreeDepth = utils::ceilLog(_nodeStore->layout().maxChildrenPerInnerNode(), (uint64_t)endIndex);
-  uint32_t numLeaves = this->_numLeaves(*_rootNode); // TODO Querying the size causes a tree traversal down to the leaves. Possible without querying the size?
-  if (_rootNode->depth() < neededTreeDepth) {
-    //TODO Test cases that actually increase it here by 0 level / 1 level / more than 1 level
-    increaseTreeDepth(neededTreeDepth - _rootNode->depth());
+  uint32_t numLeaves = _numLeaves();
+  if (numLeaves < endIndex) {
+    // Create all missing leaves (also the ones in a gap before beginIndex) with their maximal size.
+    // func resizes the new last leaf if it shouldn't be full.
+    _growToNumLeaves(endIndex);
   }
+  uint32_t newNumLeaves = std::max(numLeaves, endIndex);
 
-  if (numLeaves <= beginIndex) {
-    //TODO Test cases with numLeaves < / >= beginIndex
-    // There is a gap between the current size and the begin of the traversal
-    return _traverseLeaves(_rootNode.get(), 0, numLeaves-1, endIndex, [beginIndex, numLeaves, &func, this](DataLeafNode* node, uint32_t index) {
-      if (index >= beginIndex) {
-        func(node, index);
-      } else if (index == numLeaves - 1) {
-        // It is the old last leaf - resize it to maximum
-        node->resize(_nodeStore->layout().maxBytesPerLeaf());
-      }
-    });
-  } else if (numLeaves < endIndex) {
-    // We are starting traversal in the valid region, but traverse until after it (we grow new leaves)
-    return _traverseLeaves(_rootNode.get(), 0, beginIndex, endIndex, [numLeaves, &func, this] (DataLeafNode *node, uint32_t index) {
-      if (index == numLeaves - 1) {
-        // It is the old last leaf  - resize it to maximum
-        node->resize(_nodeStore->layout().maxBytesPerLeaf());
+  // If the traversal reaches the last leaf, func might resize it. Forget the cached size until we know the new one.
+  if (endIndex == newNumLeaves) {
+    _numStoredBytesCache = none;
+  }
+  vector<uint32_t> zeroLeaves;
+  _traverseLeaves(_rootNode.get(), 0, beginIndex, endIndex, HoleTraversal::MATERIALIZE, [&func, &zeroLeaves, newNumLeaves, this] (DataLeafNode *node, uint32_t index) {
+    func(node, index);
+    _rememberChanged(*node);
+    if (index == newNumLeaves - 1) {
+      _numStoredBytesCache = (uint64_t)index * _nodeStore->layout().maxBytesPerLeaf() + node->numBytes();
+    } else if (_isZeroLeaf(*node)) {
+      zeroLeaves.push_back(index);
+    }
+  });
+  _replaceZeroLeavesWithHoles(zeroLeaves);
+}
+
+bool DataTree::traverseExistingLeaves(uint32_t beginIndex, uint32_t endIndex, uint64_t minNumStoredBytes, LeafAccess access, function<void (DataLeafNode*, uint32_t)> func) {
+  shared_lock<shared_mutex> lock(_mutex);
+  ASSERT(beginIndex <= endIndex, "Invalid parameters");
+  _computeSizeCacheIfNeeded(&lock);
+  if (endIndex > *_numLeavesCache || minNumStoredBytes > *_numStoredBytesCache) {
+    return false;
+  }
+  uint32_t numLeaves = *_numLeavesCache;
+  vector<uint32_t> zeroLeaves;
+  HoleTraversal holeTraversal = (access == LeafAccess::WRITE) ? HoleTraversal::STOP : HoleTraversal::PASS_NULLPTR;
+  bool traversed = _traverseLeaves(_rootNode.get(), 0, beginIndex, endIndex, holeTraversal, [this, access, numLeaves, &zeroLeaves, &func] (DataLeafNode *leaf, uint32_t leafIndex) {
+    if (leaf == nullptr) {
+      // Holes can't change while we hold the shared lock, so we don't need the leaf lock
+      func(leaf, leafIndex);
+      return;
+    }
+    shared_mutex &leafMutex = _leafMutexes[leafIndex % NUM_LEAF_MUTEXES];
+    if (access == LeafAccess::WRITE) {
+      unique_lock<shared_mutex> leafLock(leafMutex);
+      func(leaf, leafIndex);
+      _rememberChanged(*leaf);
+      if (leafIndex != numLeaves - 1 && _isZeroLeaf(*leaf)) {
+        zeroLeaves.push_back(leafIndex);
       }
-      func(node, index);
-    });
-  } else {
-    //We are traversing entirely inside the valid region
-    _traverseLeaves(_rootNode.get(), 0, beginIndex, endIndex, func);
+    } else {
+      shared_lock<shared_mutex> leafLock(leafMutex);
+      func(leaf, leafIndex);
+    }
+  });
+  if (!zeroLeaves.empty()) {
+    // Turning the leaves into holes changes their parents, which needs an exclusive lock.
+    // In the meantime, other writes could have changed the leaves, so this checks them again.
+    lock.unlock();
+    unique_lock<shared_mutex> exclusiveLock(_mutex);
+    _replaceZeroLeavesWithHoles(zeroLeaves);
   }
+  return traversed;
 }
 
-void DataTree::_traverseLeaves(DataNode *root, uint32_t leafOffset, uint32_t beginIndex, uint32_t endIndex, function<void (DataLeafNode*, uint32_t)> func) {
+bool DataTree::_traverseLeaves(DataNode *root, uint32_t leafOffset, uint32_t beginIndex, uint32_t endIndex, HoleTraversal holeTraversal, function<void (DataLeafNode*, uint32_t)> func) {
   DataLeafNode *leaf = dynamic_cast<DataLeafNode*>(root);
   if (leaf != nullptr) {
     ASSERT(beginIndex <= 1 && endIndex <= 1, "If root node is a leaf, the (sub)tree has only one leaf - access indices must be 0 or 1.");
     if (beginIndex == 0 && endIndex == 1) {
       func(leaf, leafOffset);
     }
-    return;
+    return true;
   }
 
   DataInnerNode *inner = dynamic_cast<DataInnerNode*>(root);
   uint32_t leavesPerChild = leavesPerFullChild(*inner);
   uint32_t beginChild = beginIndex/leavesPerChild;
   uint32_t endChild = utils::ceilDivision(endIndex, leavesPerChild);
-  vector<unique_ref<DataNode>> children = getOrCreateChildren(inner, beginChild, endChild);
+  auto children = loadChildren(inner, beginChild, endChild);
 
   for (uint32_t childIndex = beginChild; childIndex < endChild; ++childIndex) {
     uint32_t childOffset = childIndex * leavesPerChild;
     uint32_t localBeginIndex = utils::maxZeroSubtraction(beginIndex, childOffset);
     uint32_t localEndIndex = std::min(leavesPerChild, endIndex - childOffset);
-    auto child = std::move(children[childIndex-beginChild]);
-    _traverseLeaves(child.get(), leafOffset + childOffset, localBeginIndex, localEndIndex, func);
+    auto &child = children[childIndex-beginChild];
+    if (child == none) {
+      if (holeTraversal == HoleTraversal::STOP) {
+        return false;
+      } else if (holeTraversal == HoleTraversal::PASS_NULLPTR) {
+        for (uint32_t localIndex = localBeginIndex; localIndex < localEndIndex; ++localIndex) {
+          func(nullptr, leafOffset + childOffset + localIndex);
+        }
+        continue;
+      }
+      child = _materializeHole(inner, childIndex);
+    }
+    if (!_traverseLeaves(child->get(), leafOffset + childOffset, localBeginIndex, localEndIndex, holeTraversal, func)) {
+      return false;
+    }
   }
+  return true;
 }
 
-vector<unique_ref<DataNode>> DataTree::getOrCreateChildren(DataInnerNode *node, uint32_t begin, uint32_t end) {
-  vector<unique_ref<DataNode>> children;
-  children.reserve(end-begin);
-  for (uint32_t childIndex = begin; childIndex < std::min(node->numChildren(), end); ++childIndex) {
-    auto child = _nodeStore->load(node->getChild(childIndex)->key());
-    ASSERT(child != none, "Couldn't load child node");
-    children.emplace_back(std::move(*child));
+void DataTree::prefetchLeaves(uint32_t beginIndex, uint32_t endIndex, readahead::LeafPrefetcher *prefetcher) const {
+  vector<Key> leafKeys;
+  {
+    shared_lock<shared_mutex> lock(_mutex);
+    _computeSizeCacheIfNeeded(&lock);
+    endIndex = std::min(endIndex, *_numLeavesCache);
+    if (beginIndex >= endIndex) {
+      return;
+    }
+    // This only loads inner nodes, which are usually in the block cache already because they were needed for the reads.
+    _collectLeafKeys(*_rootNode, beginIndex, endIndex, &leafKeys);
   }
-  for (uint32_t childIndex = node->numChildren(); childIndex < end; ++childIndex) {
-    //TODO This creates each child with one chain to one leaf only, and then on the next lower level it
-    //     has to create the children for the child. Would be faster to directly create full trees if necessary.
-    children.emplace_back(addChildTo(node));
+  prefetcher->prefetch(_nodeStore, leafKeys);
+}
+
+void DataTree::_collectLeafKeys(const DataNode &root, uint32_t beginIndex, uint32_t endIndex, vector<Key> *result) const {
+  const DataInnerNode *inner = dynamic_cast<const DataInnerNode*>(&root);
+  if (inner == nullptr) {
+    ASSERT(beginIndex == 0 && endIndex == 1, "If root node is a leaf, the (sub)tree has only one leaf - access indices must be 0 and 1.");
+    result->push_back(root.key());
+    return;
+  }
+
+  uint32_t leavesPerChild = leavesPerFullChild(*inner);
+  uint32_t beginChild = beginIndex/leavesPerChild;
+  uint32_t endChild = std::min(inner->numChildren(), utils::ceilDivision(endIndex, leavesPerChild));
+  for (uint32_t childIndex = beginChild; childIndex < endChild; ++childIndex) {
+    uint32_t childOffset = childIndex * leavesPerChild;
+    uint32_t localBeginIndex = utils::maxZeroSubtraction(beginIndex, childOffset);
+    uint32_t localEndIndex = std::min(leavesPerChild, endIndex - childOffset);
+    if (inner->getChild(childIndex)->isHole()) {
+      // There's nothing to load for holes
+      continue;
+    } else if (inner->depth() == 1) {
+      // The children are the leaves, we don't need to load them to know their keys
+      result->push_back(inner->getChild(childIndex)->key());
+    } else {
+      auto child = _nodeStore->load(inner->getChild(childIndex)->key());
+      ASSERT(child != none, "Couldn't load child node");
+      _collectLeafKeys(**child, localBeginIndex, localEndIndex, result);
+    }
+  }
+}
+
+vector<optional<unique_ref<DataNode>>> DataTree::loadChildren(DataInnerNode *node, uint32_t begin, uint32_t end) {
+  ASSERT(end <= node->numChildren(), "Node doesn't have these children");
+  vector<Key> childKeys;
+  vector<uint32_t> storedChildren;
+  for (uint32_t childIndex = begin; childIndex < end; ++childIndex) {
+    if (!node->getChild(childIndex)->isHole()) {
+      childKeys.push_back(node->getChild(childIndex)->key());
+      storedChildren.push_back(childIndex - begin);
+    }
+  }
+  // Load the children concurrently. The callers still process them in order.
+  auto loadedChildren = _nodeLoader->load(_nodeStore, childKeys);
+  vector<optional<unique_ref<DataNode>>> children(end-begin);
+  for (size_t i = 0; i < loadedChildren.size(); ++i) {
+    ASSERT(loadedChildren[i] != none, "Couldn't load child node");
+    children[storedChildren[i]] = std::move(loadedChildren[i]);
   }
-  ASSERT(children.size() == end-begin, "Number of children in the result is wrong");
   return children;
 }
 
-unique_ref<DataNode> DataTree::addChildTo(DataInnerNode *node) {
-  auto new_leaf = _nodeStore->createNewLeafNode();
-  new_leaf->resize(_nodeStore->layout().maxBytesPerLeaf());
-  auto chain = createChainOfInnerNodes(node->depth()-1, std::move(new_leaf));
-  node->addChild(*chain);
-  return chain;
+optional<uint32_t> DataTree::nextDataLeaf(uint32_t beginIndex) const {
+  return _nextLeaf(beginIndex, false);
+}
+
+optional<uint32_t> DataTree::nextHoleLeaf(uint32_t beginIndex) const {
+  return _nextLeaf(beginIndex, true);
+}
+
+optional<uint32_t> DataTree::_nextLeaf(uint32_t beginIndex, bool findHole) const {
+  shared_lock<shared_mutex> lock(_mutex);
+  _computeSizeCacheIfNeeded(&lock);
+  if (beginIndex >= *_numLeavesCache) {
+    return none;
+  }
+  return _nextLeaf(*_rootNode, beginIndex, findHole);
+}
+
+optional<uint32_t> DataTree::_nextLeaf(const DataNode &root, uint32_t beginIndex, bool findHole) const {
+  const DataInnerNode *inner = dynamic_cast<const DataInnerNode*>(&root);
+  if (inner == nullptr) {
+    // A leaf node is stored, so it isn't a hole
+    return findHole ? none : optional<uint32_t>(beginIndex);
+  }
+
+  uint32_t leavesPerChild = leavesPerFullChild(*inner);
+  for (uint32_t childIndex = beginIndex/leavesPerChild; childIndex < inner->numChildren(); ++childIndex) {
+    uint32_t childOffset = childIndex * leavesPerChild;
+    uint32_t localBeginIndex = utils::maxZeroSubtraction(beginIndex, childOffset);
+    bool isHole = inner->getChild(childIndex)->isHole();
+    if (isHole || inner->depth() == 1) {
+      // We don't have to load the child to know whether it is a hole
+      if (isHole == findHole) {
+        return childOffset + localBeginIndex;
+      }
+      continue;
+    }
+    auto child = _nodeStore->load(inner->getChild(childIndex)->key());
+    ASSERT(child != none, "Couldn't load child node");
+    auto result = _nextLeaf(**child, localBeginIndex, findHole);
+    if (result != none) {
+      return childOffset + *result;
+    }
+  }
+  return none;
 }
 
 uint32_t DataTree::leavesPerFullChild(const DataInnerNode &root) const {
@@ -255,11 +562,15 @@ uint32_t DataTree::leavesPerFullChild(const DataInnerNode &root) const {
 
 uint64_t DataTree::numStoredBytes() const {
   shared_lock<shared_mutex> lock(_mutex);
-  return _numStoredBytes();
+  _computeSizeCacheIfNeeded(&lock);
+  return *_numStoredBytesCache;
 }
 
 uint64_t DataTree::_numStoredBytes() const {
-  return _numStoredBytes(*_rootNode);
+  if (_numStoredBytesCache == none) {
+    _numStoredBytesCache = _numStoredBytes(*_rootNode);
+  }
+  return *_numStoredBytesCache;
 }
 
 uint64_t DataTree::_numStoredBytes(const DataNode &root) const {
@@ -270,6 +581,9 @@ uint64_t DataTree::_numStoredBytes(const DataNode &root) const {
 
   const DataInnerNode &inner = dynamic_cast<const DataInnerNode&>(root);
   uint64_t numBytesInLeftChildren = (inner.numChildren()-1) * leavesPerFullChild(inner) * _nodeStore->layout().maxBytesPerLeaf();
+  if (inner.LastChild()->isHole()) {
+    return numBytesInLeftChildren + leavesPerFullChild(inner) * _nodeStore->layout().maxBytesPerLeaf();
+  }
   auto lastChild = _nodeStore->load(inner.LastChild()->key());
   ASSERT(lastChild != none, "Couldn't load last child");
   uint64_t numBytesInRightChild = _numStoredBytes(**lastChild);
@@ -278,27 +592,31 @@ uint64_t DataTree::_numStoredBytes(const DataNode &root) const {
 }
 
 void DataTree::resizeNumBytes(uint64_t newNumBytes) {
-  //TODO Can we resize in parallel? Especially creating new blocks (i.e. encrypting them) is expensive and should be done in parallel.
   boost::upgrade_lock<shared_mutex> lock(_mutex);
   {
     boost::upgrade_to_unique_lock<shared_mutex> exclusiveLock(lock);
-    //TODO Faster implementation possible (no addDataLeaf()/removeLastDataLeaf() in a loop, but directly resizing)
-    LastLeaf(_rootNode.get())->resize(_nodeStore->layout().maxBytesPerLeaf());
-    uint64_t currentNumBytes = _numStoredBytes();
-    ASSERT(currentNumBytes % _nodeStore->layout().maxBytesPerLeaf() == 0, "The last leaf is not a max data leaf, although we just resized it to be one.");
-    uint32_t currentNumLeaves = currentNumBytes / _nodeStore->layout().maxBytesPerLeaf();
+    uint32_t currentNumLeaves = _numLeaves();
     uint32_t newNumLeaves = std::max(UINT64_C(1), utils::ceilDivision(newNumBytes, _nodeStore->layout().maxBytesPerLeaf()));
-
-    for(uint32_t i = currentNumLeaves; i < newNumLeaves; ++i) {
-      addDataLeaf()->resize(_nodeStore->layout().maxBytesPerLeaf());
+    if (newNumLeaves > currentNumLeaves) {
+      _growToNumLeaves(newNumLeaves);
     }
-    for(uint32_t i = currentNumLeaves; i > newNumLeaves; --i) {
-      removeLastDataLeaf();
+    // Forget the cached size while resizing, so it gets recomputed if resizing fails halfway through
+    _numLeavesCache = none;
+    _numStoredBytesCache = none;
+    if (newNumLeaves < currentNumLeaves) {
+      _shrinkToNumLeaves(newNumLeaves);
     }
+    // If the new last leaf was a hole, this stores it
     uint32_t newLastLeafSize = newNumBytes - (newNumLeaves-1)*_nodeStore->layout().maxBytesPerLeaf();
-    LastLeaf(_rootNode.get())->resize(newLastLeafSize);
+    {
+      auto newLastLeaf = LastLeaf(_rootNode.get());
+      newLastLeaf->resize(newLastLeafSize);
+      _rememberChanged(*newLastLeaf);
+    }
+    ASSERT(newNumBytes == _numStoredBytes(*_rootNode), "We resized to the wrong number of bytes ("+std::to_string(_numStoredBytes(*_rootNode))+" instead of "+std::to_string(newNumBytes)+")");
+    _numLeavesCache = newNumLeaves;
+    _numStoredBytesCache = newNumBytes;
   }
-  ASSERT(newNumBytes == _numStoredBytes(), "We resized to the wrong number of bytes ("+std::to_string(numStoredBytes())+" instead of "+std::to_string(newNumBytes)+")");
 }
 
 optional_ownership_ptr<DataLeafNode> DataTree::LastLeaf(DataNode *root) {
@@ -308,9 +626,7 @@ optional_ownership_ptr<DataLeafNode> DataTree::LastLeaf(DataNode *root) {
   }
 
   DataInnerNode *inner = dynamic_cast<DataInnerNode*>(root);
-  auto lastChild = _nodeStore->load(inner->LastChild()->key());
-  ASSERT(lastChild != none, "Couldn't load last child");
-  return WithOwnership(LastLeaf(std::move(*lastChild)));
+  return WithOwnership(LastLeaf(_loadOrMaterializeChild(inner, inner->numChildren() - 1)));
 }
 
 unique_ref<DataLeafNode> DataTree::LastLeaf(unique_ref<DataNode> root) {
@@ -320,9 +636,7 @@ unique_ref<DataLeafNode> DataTree::LastLeaf(unique_ref<DataNode> root) {
   }
   auto inner = dynamic_pointer_move<DataInnerNode>(root);
   ASSERT(inner != none, "Root node is neither a leaf nor an inner node");
-  auto child = _nodeStore->load((*inner)->LastChild()->key());
-  ASSERT(child != none, "Couldn't load last child");
-  return LastLeaf(std::move(*child));
+  return LastLeaf(_loadOrMaterializeChild(inner->get(), (*inner)->numChildren() - 1));
 }
 
 uint64_t DataTree::maxBytesPerLeaf() const {
@@ -2,12 +2,16 @@
 #ifndef MESSMER_BLOBSTORE_IMPLEMENTATIONS_ONBLOCKS_DATATREE_H_
 #define MESSMER_BLOBSTORE_IMPLEMENTATIONS_ONBLOCKS_DATATREE_H_
 
+#include <array>
 #include <memory>
+#include <mutex>
+#include <unordered_set>
 #include <cpp-utils/macros.h>
 #include <cpp-utils/pointer/optional_ownership_ptr.h>
 #include "../datanodestore/DataNodeView.h"
 //TODO Replace with C++14 once std::shared_mutex is supported
 #include <boost/thread/shared_mutex.hpp>
+#include <boost/optional.hpp>
 #include <blockstore/utils/Key.h>
 
 namespace blobstore {
@@ -18,56 +22,118 @@ class DataInnerNode;
 class DataLeafNode;
 class DataNode;
 }
+namespace readahead {
+class LeafPrefetcher;
+}
 namespace datatreestore {
+class ParallelNodeLoader;
+
+enum class LeafAccess {READ, WRITE};
 
 //TODO It is strange that DataLeafNode is still part in the public interface of DataTree. This should be separated somehow.
 class DataTree final {
 public:
-  DataTree(datanodestore::DataNodeStore *nodeStore, cpputils::unique_ref<datanodestore::DataNode> rootNode);
+  DataTree(datanodestore::DataNodeStore *nodeStore, ParallelNodeLoader *nodeLoader, cpputils::unique_ref<datanodestore::DataNode> rootNode);
   ~DataTree();
 
   const blockstore::Key &key() const;
   //Returning uint64_t, because calculations handling this probably need to be done in 64bit to support >4GB blobs.
   uint64_t maxBytesPerLeaf() const;
 
+  // Holes in the traversed range are stored as leaves before func is called for them.
+  // Leaves that only contain zeroes after func was called for them are turned into holes again.
   void traverseLeaves(uint32_t beginIndex, uint32_t endIndex, std::function<void (datanodestore::DataLeafNode*, uint32_t)> func);
+
+  // Like traverseLeaves(), but only if the leaves [beginIndex, endIndex) and the first minNumStoredBytes bytes already
+  // exist, i.e. if the tree doesn't have to grow. Returns false without calling func otherwise.
+  // This doesn't change the shape of the tree, so it only needs a shared lock on the tree and calls can run in parallel.
+  // Calls accessing the same leaf only wait for each other if one of them writes. func must not resize the leaves.
+  // When reading, func is called with nullptr for leaves that are holes. Writing to a hole needs an exclusive lock,
+  // so when writing, this stops at the first hole and returns false. func may already have been called for the leaves before it.
+  bool traverseExistingLeaves(uint32_t beginIndex, uint32_t endIndex, uint64_t minNumStoredBytes, LeafAccess access, std::function<void (datanodestore::DataLeafNode*, uint32_t)> func);
+  // Leaves added when growing are holes and don't take up space until they're written.
   void resizeNumBytes(uint64_t newNumBytes);
 
+  // Return the index of the first leaf at or after beginIndex that is stored (or that is a hole), boost::none if there is none.
+  boost::optional<uint32_t> nextDataLeaf(uint32_t beginIndex) const;
+  boost::optional<uint32_t> nextHoleLeaf(uint32_t beginIndex) const;
+
   uint32_t numLeaves() const;
   uint64_t numStoredBytes() const;
 
+  // Schedules loading the leaves [beginIndex, endIndex) in the background, so they're in the block cache when they're read.
+  // Leaves behind the end of the tree are ignored, i.e. this doesn't grow the tree.
+  void prefetchLeaves(uint32_t beginIndex, uint32_t endIndex, readahead::LeafPrefetcher *prefetcher) const;
+
+  // Also waits until the nodes that were changed and released since the last flush are stored
   void flush() const;
 
 private:
+  // Leaf i is protected by _leafMutexes[i % NUM_LEAF_MUTEXES] while traverseExistingLeaves() accesses it
+  static constexpr unsigned int NUM_LEAF_MUTEXES = 16;
+
+  // What a traversal does when it reaches a hole
+  enum class HoleTraversal {MATERIALIZE, PASS_NULLPTR, STOP};
+
+  // Changing the shape of the tree or the size of a leaf needs an exclusive lock, accessing existing leaves a shared lock.
   mutable boost::shared_mutex _mutex;
+  mutable std::array<boost::shared_mutex, NUM_LEAF_MUTEXES> _leafMutexes;
   datanodestore::DataNodeStore *_nodeStore;
+  ParallelNodeLoader *_nodeLoader;
   cpputils::unique_ref<datanodestore::DataNode> _rootNode;
-
-  cpputils::unique_ref<datanodestore::DataLeafNode> addDataLeaf();
-  void removeLastDataLeaf();
+  // Computing the size of the tree needs loading all nodes on the right border down to the last leaf.
+  // So we only compute it once (when it's first needed) and then keep it up to date when the tree changes.
+  // Both caches are only written while holding an exclusive lock on _mutex.
+  mutable boost::optional<uint32_t> _numLeavesCache;
+  mutable boost::optional<uint64_t> _numStoredBytesCache;
+  // Keys of the nodes changed since the last flush. They may still be waiting in the block store for being written back.
+  mutable std::mutex _changedNodesMutex;
+  mutable std::unordered_set<blockstore::Key> _changedNodes;
 
   cpputils::unique_ref<datanodestore::DataNode> releaseRootNode();
   friend class DataTreeStore;
 
-  cpputils::unique_ref<datanodestore::DataLeafNode> addDataLeafAt(datanodestore::DataInnerNode *insertPos);
+  void _rememberChanged(const datanodestore::DataNode &node);
+
+  // Adds leaves with the maximal size until the tree has newNumLeaves leaves. The old last leaf gets the maximal size, too.
+  // Instead of adding the leaves one by one, this directly builds the new subtrees. Only their right border is stored,
+  // all other new leaves are holes.
+  void _growToNumLeaves(uint32_t newNumLeaves);
+  void _growSubtree(datanodestore::DataInnerNode *node, uint32_t newNumLeaves, bool isRightBorder);
+  cpputils::unique_ref<datanodestore::DataNode> _createSparseSubtree(uint8_t depth, uint32_t numLeaves);
   cpputils::optional_ownership_ptr<datanodestore::DataNode> createChainOfInnerNodes(unsigned int num, datanodestore::DataNode *child);
-  cpputils::unique_ref<datanodestore::DataNode> createChainOfInnerNodes(unsigned int num, cpputils::unique_ref<datanodestore::DataNode> child);
-  cpputils::unique_ref<datanodestore::DataLeafNode> addDataLeafToFullTree();
 
+  // Removes whole subtrees instead of removing the leaves one by one
+  void _shrinkToNumLeaves(uint32_t newNumLeaves);
+  void _shrinkSubtree(datanodestore::DataInnerNode *node, uint32_t newNumLeaves);
   void deleteLastChildSubtree(datanodestore::DataInnerNode *node);
-  void ifRootHasOnlyOneChildReplaceRootWithItsChild();
+  void decreaseTreeDepthWhileRootHasOnlyOneChild();
+
+  cpputils::unique_ref<datanodestore::DataNode> _materializeHole(datanodestore::DataInnerNode *parent, uint32_t childIndex);
+  cpputils::unique_ref<datanodestore::DataNode> _loadOrMaterializeChild(datanodestore::DataInnerNode *parent, uint32_t childIndex);
+  // Needs an exclusive lock. Leaves that changed since they were checked are left alone.
+  void _replaceZeroLeavesWithHoles(const std::vector<uint32_t> &leafIndices);
+  // Returns true if node only has holes as children afterwards
+  bool _replaceZeroLeafWithHole(datanodestore::DataInnerNode *node, uint32_t leafIndex);
+  bool _isZeroLeaf(const datanodestore::DataLeafNode &leaf) const;
+  boost::optional<uint32_t> _nextLeaf(uint32_t beginIndex, bool findHole) const;
+  boost::optional<uint32_t> _nextLeaf(const datanodestore::DataNode &root, uint32_t beginIndex, bool findHole) const;
 
   //TODO Use underscore for private methods
-  void _traverseLeaves(datanodestore::DataNode *root, uint32_t leafOffset, uint32_t beginIndex, uint32_t endIndex, std::function<void (datanodestore::DataLeafNode*, uint32_t)> func);
+  void _collectLeafKeys(const datanodestore::DataNode &root, uint32_t beginIndex, uint32_t endIndex, std::vector<blockstore::Key> *result) const;
+  // Returns false if the traversal reached a hole and holeTraversal is STOP
+  bool _traverseLeaves(datanodestore::DataNode *root, uint32_t leafOffset, uint32_t beginIndex, uint32_t endIndex, HoleTraversal holeTraversal, std::function<void (datanodestore::DataLeafNode*, uint32_t)> func);
   uint32_t leavesPerFullChild(const datanodestore::DataInnerNode &root) const;
+  void _computeSizeCacheIfNeeded(boost::shared_lock<boost::shared_mutex> *lock) const;
   uint64_t _numStoredBytes() const;
   uint64_t _numStoredBytes(const datanodestore::DataNode &root) const;
+  uint32_t _numLeaves() const;
   uint32_t _numLeaves(const datanodestore::DataNode &node) const;
   cpputils::optional_ownership_ptr<datanodestore::DataLeafNode> LastLeaf(datanodestore::DataNode *root);
   cpputils::unique_ref<datanodestore::DataLeafNode> LastLeaf(cpputils::unique_ref<datanodestore::DataNode> root);
   datanodestore::DataInnerNode* increaseTreeDepth(unsigned int levels);
-  std::vector<cpputils::unique_ref<datanodestore::DataNode>> getOrCreateChildren(datanodestore::DataInnerNode *node, uint32_t begin, uint32_t end);
-  cpputils::unique_ref<datanodestore::DataNode> addChildTo(datanodestore::DataInnerNode *node);
+  // Returns boost::none for children that are holes
+  std::vector<boost::optional<cpputils::unique_ref<datanodestore::DataNode>>> loadChildren(datanodestore::DataInnerNode *node, uint32_t begin, uint32_t end);
 
   DISALLOW_COPY_AND_ASSIGN(DataTree);
 };
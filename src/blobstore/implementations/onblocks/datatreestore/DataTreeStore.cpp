@@ -2,6 +2,7 @@
 #include "../datanodestore/DataNodeStore.h"
 #include "../datanodestore/DataLeafNode.h"
 #include "DataTree.h"
+#include "ParallelNodeLoader.h"
 
 using cpputils::unique_ref;
 using cpputils::make_unique_ref;
@@ -15,8 +16,10 @@ namespace blobstore {
 namespace onblocks {
 namespace datatreestore {
 
+constexpr unsigned int DataTreeStore::NUM_NODE_LOADER_THREADS;
+
 DataTreeStore::DataTreeStore(unique_ref<DataNodeStore> nodeStore)
-  : _nodeStore(std::move(nodeStore)) {
+  : _nodeStore(std::move(nodeStore)), _nodeLoader(make_unique_ref<ParallelNodeLoader>(NUM_NODE_LOADER_THREADS)) {
 }
 
 DataTreeStore::~DataTreeStore() {
@@ -27,12 +30,20 @@ optional<unique_ref<DataTree>> DataTreeStore::load(const blockstore::Key &key) {
   if (node == none) {
     return none;
   }
-  return make_unique_ref<DataTree>(_nodeStore.get(), std::move(*node));
+  return make_unique_ref<DataTree>(_nodeStore.get(), _nodeLoader.get(), std::move(*node));
 }
 
 unique_ref<DataTree> DataTreeStore::createNewTree() {
   auto newleaf = _nodeStore->createNewLeafNode();
-  return make_unique_ref<DataTree>(_nodeStore.get(), std::move(newleaf));
+  return make_unique_ref<DataTree>(_nodeStore.get(), _nodeLoader.get(), std::move(newleaf));
+}
+
+optional<unique_ref<DataTree>> DataTreeStore::tryCreateNewTree(const blockstore::Key &key) {
+  auto newleaf = _nodeStore->tryCreateNewLeafNode(key);
+  if (newleaf == none) {
+    return none;
+  }
+  return make_unique_ref<DataTree>(_nodeStore.get(), _nodeLoader.get(), std::move(*newleaf));
 }
 
 void DataTreeStore::remove(unique_ref<DataTree> tree) {
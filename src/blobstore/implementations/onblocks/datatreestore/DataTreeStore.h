@@ -13,15 +13,21 @@ namespace blobstore {
 namespace onblocks {
 namespace datatreestore {
 class DataTree;
+class ParallelNodeLoader;
 
 class DataTreeStore final {
 public:
+  // Number of threads loading child nodes of the trees concurrently
+  static constexpr unsigned int NUM_NODE_LOADER_THREADS = 16;
+
   DataTreeStore(cpputils::unique_ref<datanodestore::DataNodeStore> nodeStore);
   ~DataTreeStore();
 
   boost::optional<cpputils::unique_ref<DataTree>> load(const blockstore::Key &key);
 
   cpputils::unique_ref<DataTree> createNewTree();
+  // Returns none if a node with this key already exists
+  boost::optional<cpputils::unique_ref<DataTree>> tryCreateNewTree(const blockstore::Key &key);
 
   void remove(cpputils::unique_ref<DataTree> tree);
 
@@ -32,6 +38,7 @@ public:
 
 private:
   cpputils::unique_ref<datanodestore::DataNodeStore> _nodeStore;
+  cpputils::unique_ref<ParallelNodeLoader> _nodeLoader;
 
   DISALLOW_COPY_AND_ASSIGN(DataTreeStore);
 };
@@ -0,0 +1,99 @@
+#include "ParallelNodeLoader.h"
+#include "../datanodestore/DataNodeStore.h"
+#include "../datanodestore/DataNode.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+
+using blockstore::Key;
+using blobstore::onblocks::datanodestore::DataNodeStore;
+using blobstore::onblocks::datanodestore::DataNode;
+using cpputils::unique_ref;
+using boost::optional;
+using std::vector;
+using std::shared_ptr;
+
+namespace blobstore {
+namespace onblocks {
+namespace datatreestore {
+
+struct ParallelNodeLoader::Batch final {
+  Batch(DataNodeStore *nodeStore_, vector<Key> keys_)
+    : nodeStore(nodeStore_), keys(std::move(keys_)), nextIndex(0), mutex(), allLoaded(), numLoaded(0),
+      results(keys.size()), errors(keys.size()) {}
+
+  DataNodeStore *nodeStore;
+  const vector<Key> keys;
+  std::atomic<size_t> nextIndex;
+  std::mutex mutex;
+  std::condition_variable allLoaded;
+  size_t numLoaded;
+  // Each entry is only written by the thread that claimed its index
+  vector<optional<unique_ref<DataNode>>> results;
+  vector<std::exception_ptr> errors;
+};
+
+ParallelNodeLoader::ParallelNodeLoader(unsigned int numThreads)
+  : _numThreads(numThreads), _queue(numThreads, &ParallelNodeLoader::_help) {
+}
+
+vector<optional<unique_ref<DataNode>>> ParallelNodeLoader::load(DataNodeStore *nodeStore, const vector<Key> &keys) {
+  if (keys.size() <= 1) {
+    // Not worth handing it to another thread
+    vector<optional<unique_ref<DataNode>>> result(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      result[i] = nodeStore->load(keys[i]);
+    }
+    return result;
+  }
+
+  auto batch = std::make_shared<Batch>(nodeStore, keys);
+  // The calling thread loads nodes as well, so we need one helper less than there are nodes
+  size_t numHelpers = std::min<size_t>(_numThreads, keys.size() - 1);
+  for (size_t i = 0; i < numHelpers; ++i) {
+    _queue.push(batch);
+  }
+
+  while (_loadNext(batch.get())) {
+  }
+  {
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->allLoaded.wait(lock, [&batch] {return batch->numLoaded == batch->keys.size();});
+  }
+
+  for (const auto &error : batch->errors) {
+    if (error != nullptr) {
+      std::rethrow_exception(error);
+    }
+  }
+  return std::move(batch->results);
+}
+
+bool ParallelNodeLoader::_loadNext(Batch *batch) {
+  size_t index = batch->nextIndex++;
+  if (index >= batch->keys.size()) {
+    return false;
+  }
+  try {
+    batch->results[index] = batch->nodeStore->load(batch->keys[index]);
+  } catch (...) {
+    batch->errors[index] = std::current_exception();
+  }
+  std::unique_lock<std::mutex> lock(batch->mutex);
+  if (++batch->numLoaded == batch->keys.size()) {
+    batch->allLoaded.notify_all();
+  }
+  return true;
+}
+
+void ParallelNodeLoader::_help(shared_ptr<Batch> batch) {
+  // If the calling thread and the other helpers already loaded everything, this returns right away
+  while (_loadNext(batch.get())) {
+  }
+}
+
+}
+}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#ifndef MESSMER_BLOBSTORE_IMPLEMENTATIONS_ONBLOCKS_DATATREESTORE_PARALLELNODELOADER_H_
+#define MESSMER_BLOBSTORE_IMPLEMENTATIONS_ONBLOCKS_DATATREESTORE_PARALLELNODELOADER_H_
+
+#include <memory>
+#include <vector>
+#include <boost/optional.hpp>
+#include <blockstore/utils/Key.h>
+#include <cpp-utils/macros.h>
+#include <cpp-utils/pointer/unique_ref.h>
+#include <cpp-utils/thread/WorkQueue.h>
+
+namespace blobstore {
+namespace onblocks {
+namespace datanodestore {
+class DataNodeStore;
+class DataNode;
+}
+namespace datatreestore {
+
+// Loads several nodes concurrently, so a traversal doesn't have to wait for each disk read and decryption one after
+// the other. The threads are shared between all trees. The calling thread helps loading its own nodes, so loading
+// makes progress even if all threads are busy with other trees, and each call uses at most numThreads of them.
+class ParallelNodeLoader final {
+public:
+  explicit ParallelNodeLoader(unsigned int numThreads);
+
+  // Returns the nodes in the order of the given keys, boost::none for nodes that don't exist.
+  // If loading a node throws, the exception is rethrown here after all loads finished.
+  std::vector<boost::optional<cpputils::unique_ref<datanodestore::DataNode>>> load(datanodestore::DataNodeStore *nodeStore, const std::vector<blockstore::Key> &keys);
+
+private:
+  struct Batch;
+
+  static bool _loadNext(Batch *batch);
+  static void _help(std::shared_ptr<Batch> batch);
+
+  const unsigned int _numThreads;
+  // A batch is queued once for each thread that should help with it
+  cpputils::WorkQueue<std::shared_ptr<Batch>> _queue;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelNodeLoader);
+};
+
+}
+}
+}
+
+#endif
@@ -25,6 +25,10 @@ public:
     return _baseTree->traverseLeaves(beginIndex, endIndex, func);
   }
 
+  bool traverseExistingLeaves(uint32_t beginIndex, uint32_t endIndex, uint64_t minNumStoredBytes, datatreestore::LeafAccess access, std::function<void (datanodestore::DataLeafNode*, uint32_t)> func) {
+    return _baseTree->traverseExistingLeaves(beginIndex, endIndex, minNumStoredBytes, access, func);
+  }
+
   uint32_t numLeaves() const {
     return _baseTree->numLeaves();
   }
@@ -37,6 +41,18 @@ public:
     return _baseTree->numStoredBytes();
   }
 
+  boost::optional<uint32_t> nextDataLeaf(uint32_t beginIndex) const {
+    return _baseTree->nextDataLeaf(beginIndex);
+  }
+
+  boost::optional<uint32_t> nextHoleLeaf(uint32_t beginIndex) const {
+    return _baseTree->nextHoleLeaf(beginIndex);
+  }
+
+  void prefetchLeaves(uint32_t beginIndex, uint32_t endIndex, readahead::LeafPrefetcher *prefetcher) const {
+    return _baseTree->prefetchLeaves(beginIndex, endIndex, prefetcher);
+  }
+
   void flush() {
     return _baseTree->flush();
   }
@@ -7,6 +7,7 @@
 using cpputils::unique_ref;
 using cpputils::make_unique_ref;
 using boost::optional;
+using boost::none;
 
 using blobstore::onblocks::datatreestore::DataTreeStore;
 using blockstore::Key;
@@ -36,6 +37,14 @@ unique_ref<DataTreeRef> ParallelAccessDataTreeStore::createNewTree() {
   return _parallelAccessStore.add(key, std::move(dataTree));
 }
 
+optional<unique_ref<DataTreeRef>> ParallelAccessDataTreeStore::tryCreateNewTree(const blockstore::Key &key) {
+  auto dataTree = _dataTreeStore->tryCreateNewTree(key);
+  if (dataTree == none) {
+    return none;
+  }
+  return _parallelAccessStore.add(key, std::move(*dataTree));
+}
+
 void ParallelAccessDataTreeStore::remove(unique_ref<DataTreeRef> tree) {
   Key key = tree->key();
   return _parallelAccessStore.remove(key, std::move(tree));
@@ -23,6 +23,8 @@ public:
   boost::optional<cpputils::unique_ref<DataTreeRef>> load(const blockstore::Key &key);
 
   cpputils::unique_ref<DataTreeRef> createNewTree();
+  // Returns none if a tree with this key already exists
+  boost::optional<cpputils::unique_ref<DataTreeRef>> tryCreateNewTree(const blockstore::Key &key);
 
   void remove(cpputils::unique_ref<DataTreeRef> tree);
 
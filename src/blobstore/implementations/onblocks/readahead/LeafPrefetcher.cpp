@@ -0,0 +1,41 @@
+#include "LeafPrefetcher.h"
+#include "../datanodestore/DataNodeStore.h"
+#include "../datanodestore/DataNode.h"
+#include <cpp-utils/logging/logging.h>
+
+using blockstore::Key;
+using blobstore::onblocks::datanodestore::DataNodeStore;
+using std::vector;
+using namespace cpputils::logging;
+
+namespace blobstore {
+namespace onblocks {
+namespace readahead {
+
+constexpr uint32_t LeafPrefetcher::MAX_QUEUE_SIZE;
+
+LeafPrefetcher::LeafPrefetcher(unsigned int numThreads)
+  : _queue(numThreads, &LeafPrefetcher::_load, MAX_QUEUE_SIZE) {
+}
+
+void LeafPrefetcher::prefetch(DataNodeStore *nodeStore, const vector<Key> &leafKeys) {
+  // Each leaf is a job of its own, so the leaves are loaded in parallel
+  for (const Key &leafKey : leafKeys) {
+    if (!_queue.push(Job{nodeStore, leafKey})) {
+      break;
+    }
+  }
+}
+
+void LeafPrefetcher::_load(Job job) {
+  try {
+    // Loading the leaf puts it into the block cache when it is released again
+    job.nodeStore->load(job.leafKey);
+  } catch (const std::exception &e) {
+    LOG(WARN, "Prefetching leaf {} failed: {}", job.leafKey.ToString(), e.what());
+  }
+}
+
+}
+}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#ifndef MESSMER_BLOBSTORE_IMPLEMENTATIONS_ONBLOCKS_READAHEAD_LEAFPREFETCHER_H_
+#define MESSMER_BLOBSTORE_IMPLEMENTATIONS_ONBLOCKS_READAHEAD_LEAFPREFETCHER_H_
+
+#include <vector>
+#include <blockstore/utils/Key.h>
+#include <cpp-utils/macros.h>
+#include <cpp-utils/thread/WorkQueue.h>
+
+namespace blobstore {
+namespace onblocks {
+namespace datanodestore {
+class DataNodeStore;
+}
+namespace readahead {
+
+// Loads leaves of blobs on background threads, so that they're in the block cache (i.e. loaded and decrypted)
+// when they're read. The leaves are loaded by their key and without locking the tree they belong to, so reads
+// and writes to the tree don't have to wait for the prefetching.
+class LeafPrefetcher final {
+public:
+  // If more leaves are waiting to be prefetched, further prefetch requests are dropped
+  static constexpr uint32_t MAX_QUEUE_SIZE = 1024;
+
+  // Leaves that are still queued when the LeafPrefetcher is destructed aren't loaded anymore. They're only an optimization.
+  explicit LeafPrefetcher(unsigned int numThreads);
+
+  // Schedules loading the given leaves from the node store. The node store has to outlive the LeafPrefetcher.
+  // If a leaf was removed by the time it is loaded, it is skipped.
+  void prefetch(datanodestore::DataNodeStore *nodeStore, const std::vector<blockstore::Key> &leafKeys);
+
+private:
+  struct Job final {
+    datanodestore::DataNodeStore *nodeStore;
+    blockstore::Key leafKey;
+  };
+
+  static void _load(Job job);
+
+  cpputils::WorkQueue<Job> _queue;
+
+  DISALLOW_COPY_AND_ASSIGN(LeafPrefetcher);
+};
+
+}
+}
+}
+
+#endif
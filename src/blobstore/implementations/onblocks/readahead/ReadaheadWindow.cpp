@@ -0,0 +1,46 @@
+#include "ReadaheadWindow.h"
+#include <algorithm>
+#include <cpp-utils/assert/assert.h>
+
+using boost::optional;
+using boost::none;
+
+namespace blobstore {
+namespace onblocks {
+namespace readahead {
+
+constexpr unsigned int ReadaheadWindow::MIN_SEQUENTIAL_READS;
+constexpr uint64_t ReadaheadWindow::DEFAULT_INITIAL_SIZE;
+constexpr uint64_t ReadaheadWindow::DEFAULT_MAX_SIZE;
+
+ReadaheadWindow::ReadaheadWindow(uint64_t initialSize, uint64_t maxSize)
+  : _initialSize(initialSize), _maxSize(maxSize), _mutex(), _nextSequentialOffset(0), _numSequentialReads(0), _size(0), _prefetchedUntil(0) {
+  ASSERT(initialSize > 0 && initialSize <= maxSize, "Invalid readahead window size");
+}
+
+optional<ReadaheadWindow::Region> ReadaheadWindow::onRead(uint64_t offset, uint64_t count) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (offset != _nextSequentialOffset) {
+    _numSequentialReads = 0;
+    _size = 0;
+    _prefetchedUntil = 0;
+  }
+  _nextSequentialOffset = offset + count;
+  ++_numSequentialReads;
+  if (_numSequentialReads < MIN_SEQUENTIAL_READS) {
+    return none;
+  }
+
+  _size = (_size == 0) ? _initialSize : std::min(2 * _size, _maxSize);
+  uint64_t begin = std::max(_prefetchedUntil, _nextSequentialOffset);
+  uint64_t end = _nextSequentialOffset + _size;
+  if (begin >= end) {
+    return none;
+  }
+  _prefetchedUntil = end;
+  return Region{begin, end - begin};
+}
+
+}
+}
+}
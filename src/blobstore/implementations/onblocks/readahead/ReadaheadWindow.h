@@ -0,0 +1,51 @@
+#pragma once
+#ifndef MESSMER_BLOBSTORE_IMPLEMENTATIONS_ONBLOCKS_READAHEAD_READAHEADWINDOW_H_
+#define MESSMER_BLOBSTORE_IMPLEMENTATIONS_ONBLOCKS_READAHEAD_READAHEADWINDOW_H_
+
+#include <cstdint>
+#include <mutex>
+#include <boost/optional.hpp>
+#include <cpp-utils/macros.h>
+
+namespace blobstore {
+namespace onblocks {
+namespace readahead {
+
+// Watches the reads of one open file and decides what to read ahead.
+// Once a few reads followed each other sequentially, each read returns the region behind it that should be prefetched.
+// The region starts small and doubles with each sequential read, up to a maximum. A non-sequential read resets it.
+class ReadaheadWindow final {
+public:
+  struct Region final {
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  // Number of sequential reads (including the current one) before we start reading ahead
+  static constexpr unsigned int MIN_SEQUENTIAL_READS = 2;
+  static constexpr uint64_t DEFAULT_INITIAL_SIZE = 128 * 1024;
+  static constexpr uint64_t DEFAULT_MAX_SIZE = 4 * 1024 * 1024;
+
+  explicit ReadaheadWindow(uint64_t initialSize = DEFAULT_INITIAL_SIZE, uint64_t maxSize = DEFAULT_MAX_SIZE);
+
+  // Call this for each read. Returns the region to prefetch, if any. Parts of it that were already returned before
+  // aren't returned again.
+  boost::optional<Region> onRead(uint64_t offset, uint64_t count);
+
+private:
+  const uint64_t _initialSize;
+  const uint64_t _maxSize;
+  std::mutex _mutex;
+  uint64_t _nextSequentialOffset;
+  unsigned int _numSequentialReads;
+  uint64_t _size;
+  uint64_t _prefetchedUntil;
+
+  DISALLOW_COPY_AND_ASSIGN(ReadaheadWindow);
+};
+
+}
+}
+}
+
+#endif
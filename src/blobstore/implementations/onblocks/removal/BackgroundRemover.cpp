@@ -0,0 +1,102 @@
+#include "BackgroundRemover.h"
+#include "../parallelaccessdatatreestore/ParallelAccessDataTreeStore.h"
+#include "../parallelaccessdatatreestore/DataTreeRef.h"
+#include "../../../interface/Blob.h"
+#include <algorithm>
+#include <cpp-utils/assert/assert.h>
+#include <cpp-utils/logging/logging.h>
+
+using blockstore::Key;
+using cpputils::Data;
+using cpputils::unique_ref;
+using blobstore::onblocks::parallelaccessdatatreestore::ParallelAccessDataTreeStore;
+using blobstore::onblocks::parallelaccessdatatreestore::DataTreeRef;
+using boost::none;
+using namespace cpputils::logging;
+
+namespace blobstore {
+namespace onblocks {
+namespace removal {
+
+BackgroundRemover::BackgroundRemover(ParallelAccessDataTreeStore *dataTreeStore, unique_ref<Blob> journal)
+  : _dataTreeStore(dataTreeStore), _mutex(), _journal(std::move(journal)), _journalEntries(),
+    _removals(1, std::bind(&BackgroundRemover::_remove, this, std::placeholders::_1)) {
+  uint64_t numIncompleteBytes = _journal->size() % Key::BINARY_LENGTH;
+  if (numIncompleteBytes != 0) {
+    // Entries are always written completely, so this is a damaged journal. Keep the entries that are complete.
+    LOG(ERROR, "Removal journal {} has a size of {} bytes, which isn't a multiple of the entry size. Dropping the incomplete last entry.", _journal->key().ToString(), _journal->size());
+    _journal->resize(_journal->size() - numIncompleteBytes);
+    _journal->flush();
+  }
+  Data content = _journal->readAll();
+  for (uint64_t offset = 0; offset < content.size(); offset += Key::BINARY_LENGTH) {
+    _journalEntries.push_back(Key::FromBinary(content.dataOffset(offset)));
+  }
+  if (!_journalEntries.empty()) {
+    LOG(INFO, "Resuming removal of {} blobs", _journalEntries.size());
+  }
+  for (const Key &key : _journalEntries) {
+    _removals.push(key);
+  }
+}
+
+void BackgroundRemover::remove(unique_ref<DataTreeRef> tree) {
+  Key key = tree->key();
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _journalEntries.push_back(key);
+    _writeJournalEntry(_journalEntries.size() - 1);
+    _journal->flush();
+  }
+  _removals.push(key);
+  // Removing the tree on the background thread waits until we closed it
+  cpputils::destruct(std::move(tree));
+}
+
+void BackgroundRemover::waitUntilDone() {
+  _removals.waitUntilIdle();
+}
+
+void BackgroundRemover::_remove(const Key &key) {
+  bool removed = false;
+  try {
+    auto tree = _dataTreeStore->load(key);
+    // If the tree doesn't exist, a previous removal was interrupted after removing the root node
+    if (tree != none) {
+      _dataTreeStore->remove(std::move(*tree));
+    }
+    removed = true;
+  } catch (const std::exception &e) {
+    // The tree stays in the journal, so the removal is tried again next time the journal is opened
+    LOG(ERROR, "Removing blob {} failed: {}", key.ToString(), e.what());
+  }
+
+  if (removed) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _removeFromJournal(key);
+  }
+}
+
+void BackgroundRemover::_removeFromJournal(const Key &key) {
+  auto found = std::find(_journalEntries.begin(), _journalEntries.end(), key);
+  ASSERT(found != _journalEntries.end(), "Key isn't in the removal journal");
+  // Move the last entry into the gap, so we only have to write one entry
+  size_t index = found - _journalEntries.begin();
+  *found = _journalEntries.back();
+  _journalEntries.pop_back();
+  if (index < _journalEntries.size()) {
+    _writeJournalEntry(index);
+  }
+  _journal->resize(_journalEntries.size() * Key::BINARY_LENGTH);
+  _journal->flush();
+}
+
+void BackgroundRemover::_writeJournalEntry(size_t index) {
+  Data entry(Key::BINARY_LENGTH);
+  _journalEntries[index].ToBinary(entry.data());
+  _journal->write(entry.data(), index * Key::BINARY_LENGTH, entry.size());
+}
+
+}
+}
+}
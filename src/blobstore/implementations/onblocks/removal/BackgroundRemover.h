@@ -0,0 +1,59 @@
+#pragma once
+#ifndef MESSMER_BLOBSTORE_IMPLEMENTATIONS_ONBLOCKS_REMOVAL_BACKGROUNDREMOVER_H_
+#define MESSMER_BLOBSTORE_IMPLEMENTATIONS_ONBLOCKS_REMOVAL_BACKGROUNDREMOVER_H_
+
+#include <mutex>
+#include <vector>
+#include <blockstore/utils/Key.h>
+#include <cpp-utils/macros.h>
+#include <cpp-utils/pointer/unique_ref.h>
+#include <cpp-utils/thread/WorkQueue.h>
+
+namespace blobstore {
+class Blob;
+namespace onblocks {
+namespace parallelaccessdatatreestore {
+class ParallelAccessDataTreeStore;
+class DataTreeRef;
+}
+namespace removal {
+
+// Removes trees on a background thread, so that removing a large blob doesn't block the caller.
+// The keys of the trees that aren't completely removed yet are stored in a journal blob. When a BackgroundRemover
+// is created with a journal that still has entries (e.g. because the file system was unmounted while removing),
+// these removals are resumed.
+class BackgroundRemover final {
+public:
+  // The journal blob must not be used for anything else. The data tree store has to outlive the BackgroundRemover.
+  BackgroundRemover(parallelaccessdatatreestore::ParallelAccessDataTreeStore *dataTreeStore, cpputils::unique_ref<Blob> journal);
+
+  // Adds the tree to the journal and returns. Its nodes are removed later.
+  void remove(cpputils::unique_ref<parallelaccessdatatreestore::DataTreeRef> tree);
+
+  // Blocks until all scheduled removals are finished
+  void waitUntilDone();
+
+private:
+  void _remove(const blockstore::Key &key);
+  void _removeFromJournal(const blockstore::Key &key);
+  void _writeJournalEntry(size_t index);
+
+  parallelaccessdatatreestore::ParallelAccessDataTreeStore *_dataTreeStore;
+  // Protects the journal
+  std::mutex _mutex;
+  cpputils::unique_ref<Blob> _journal;
+  // Same content as the journal blob, so we don't have to read it to find entries
+  std::vector<blockstore::Key> _journalEntries;
+
+  // This member has to be last, so the thread is stopped before the other members are destructed.
+  // Destructing it finishes the removal that is currently running. Removals that didn't start yet stay in the journal.
+  cpputils::WorkQueue<blockstore::Key> _removals;
+
+  DISALLOW_COPY_AND_ASSIGN(BackgroundRemover);
+};
+
+}
+}
+}
+
+#endif
@@ -4,8 +4,10 @@
 
 #include <cstring>
 #include <cstdint>
+#include <functional>
 #include <blockstore/utils/Key.h>
 #include <cpp-utils/data/Data.h>
+#include <boost/optional.hpp>
 
 namespace blobstore {
 
@@ -23,6 +25,18 @@ public:
   virtual void read(void *target, uint64_t offset, uint64_t size) const = 0;
   virtual uint64_t tryRead(void *target, uint64_t offset, uint64_t size) const = 0;
   virtual void write(const void *source, uint64_t offset, uint64_t size) = 0;
+  // Like write(), but instead of copying from a source buffer, fill() is called to put the data directly into the
+  // storage (e.g. reading it from a file descriptor). fill() is called exactly once for each consecutive piece of the
+  // region, in order, and has to write all `size` bytes to `target`.
+  virtual void writeInPlace(uint64_t offset, uint64_t size, const std::function<void (void *target, uint64_t size)> &fill) = 0;
+
+  // Hint that the given region will be read soon. Implementations can start loading it in the background.
+  virtual void prefetch(uint64_t offset, uint64_t size) const = 0;
+
+  // Like lseek() with SEEK_DATA and SEEK_HOLE: Return the first offset at or after the given offset that is data
+  // (or that is in a hole), boost::none if there is none or if offset is outside the blob. The end of the blob counts as a hole.
+  virtual boost::optional<uint64_t> seekData(uint64_t offset) const = 0;
+  virtual boost::optional<uint64_t> seekHole(uint64_t offset) const = 0;
 
   virtual void flush() = 0;
 
@@ -6,15 +6,16 @@ using cpputils::unique_ref;
 namespace blockstore {
 namespace caching {
 
-CachedBlock::CachedBlock(unique_ref<Block> baseBlock, CachingBlockStore *blockStore)
+CachedBlock::CachedBlock(unique_ref<Block> baseBlock, CachingBlockStore *blockStore, bool dirty)
     :Block(baseBlock->key()),
      _blockStore(blockStore),
-     _baseBlock(std::move(baseBlock)) {
+     _baseBlock(std::move(baseBlock)),
+     _dirty(dirty) {
 }
 
 CachedBlock::~CachedBlock() {
   if (_baseBlock.get() != nullptr) {
-    _blockStore->release(std::move(_baseBlock));
+    _blockStore->release(std::move(_baseBlock), _dirty);
   }
 }
 
@@ -23,11 +24,18 @@ const void *CachedBlock::data() const {
 }
 
 void CachedBlock::write(const void *source, uint64_t offset, uint64_t size) {
+  _dirty = true;
   return _baseBlock->write(source, offset, size);
 }
 
+void CachedBlock::writeInPlace(uint64_t offset, uint64_t size, const std::function<void (void *target)> &fill) {
+  _dirty = true;
+  return _baseBlock->writeInPlace(offset, size, fill);
+}
+
 void CachedBlock::flush() {
-  return _baseBlock->flush();
+  _baseBlock->flush();
+  _dirty = false;
 }
 
 size_t CachedBlock::size() const {
@@ -35,7 +43,8 @@ size_t CachedBlock::size() const {
 }
 
 void CachedBlock::resize(size_t newSize) {
-    return _baseBlock->resize(newSize);
+  _dirty = true;
+  return _baseBlock->resize(newSize);
 }
 
 unique_ref<Block> CachedBlock::releaseBlock() {
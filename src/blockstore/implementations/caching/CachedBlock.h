@@ -13,11 +13,13 @@ class CachingBlockStore;
 class CachedBlock final: public Block {
 public:
   //TODO Storing key twice (in parent class and in object pointed to). Once would be enough.
-  CachedBlock(cpputils::unique_ref<Block> baseBlock, CachingBlockStore *blockStore);
+  // dirty says whether baseBlock has changes that weren't flushed yet
+  CachedBlock(cpputils::unique_ref<Block> baseBlock, CachingBlockStore *blockStore, bool dirty);
   ~CachedBlock();
 
   const void *data() const override;
   void write(const void *source, uint64_t offset, uint64_t size) override;
+  void writeInPlace(uint64_t offset, uint64_t size, const std::function<void (void *target)> &fill) override;
   void flush() override;
 
   size_t size() const override;
@@ -29,6 +31,7 @@ public:
 private:
   CachingBlockStore *_blockStore;
   cpputils::unique_ref<Block> _baseBlock;
+  bool _dirty;
 
   DISALLOW_COPY_AND_ASSIGN(CachedBlock);
 };
@@ -4,8 +4,11 @@
 #include "../../interface/Block.h"
 
 #include <algorithm>
+#include <limits>
+#include <thread>
 #include <cpp-utils/pointer/cast.h>
 #include <cpp-utils/assert/assert.h>
+#include <cpp-utils/logging/logging.h>
 
 using cpputils::dynamic_pointer_move;
 using cpputils::Data;
@@ -13,12 +16,33 @@ using boost::optional;
 using cpputils::unique_ref;
 using cpputils::make_unique_ref;
 using boost::none;
+using namespace cpputils::logging;
 
 namespace blockstore {
 namespace caching {
 
-CachingBlockStore::CachingBlockStore(cpputils::unique_ref<BlockStore> baseBlockStore)
-  :_baseBlockStore(std::move(baseBlockStore)), _cache(), _numNewBlocks(0) {
+const CacheConfig CachingBlockStore::DEFAULT_CACHE_CONFIG(1000, 16);
+const CacheConfig CachingBlockStore::DEFAULT_READ_CACHE_CONFIG(std::numeric_limits<uint32_t>::max(), 16, 64*1024*1024);
+constexpr uint32_t CachingBlockStore::MAX_WRITE_BACK_QUEUE_SIZE;
+
+namespace {
+// Memory used by a cached block. Besides its data, a cached block keeps the block of the base store,
+// which (for encrypted blocks) holds a ciphertext copy of about the same size. Counting only the data
+// would let the caches use about twice their memory budget.
+uint64_t blockMemoryUsage(const unique_ref<Block> &block) {
+  return 2 * block->size();
+}
+}
+
+CachingBlockStore::CachingBlockStore(cpputils::unique_ref<BlockStore> baseBlockStore, const CacheConfig &cacheConfig, const CacheConfig &readCacheConfig)
+  :_baseBlockStore(std::move(baseBlockStore)), _readCache(readCacheConfig, &blockMemoryUsage),
+   _writeBackPool(_numWriteBackThreads(), MAX_WRITE_BACK_QUEUE_SIZE, &CachingBlockStore::_writeBack, std::bind(&CachingBlockStore::_moveToReadCache, this, std::placeholders::_1)),
+   _cache(cacheConfig, &blockMemoryUsage, std::bind(&CachingBlockStore::_scheduleWriteBack, this, std::placeholders::_1)),
+   _numNewBlocks(0), _numHits(0), _numMisses(0) {
+}
+
+CachingBlockStore::~CachingBlockStore() {
+  _logStatistics();
 }
 
 Key CachingBlockStore::createKey() {
@@ -26,25 +50,37 @@ Key CachingBlockStore::createKey() {
 }
 
 optional<unique_ref<Block>> CachingBlockStore::tryCreate(const Key &key, Data data) {
-  ASSERT(_cache.pop(key) == none, "Key already exists in cache");
+  ASSERT(_cache.pop(key) == none && _writeBackPool.pop(key) == none && _readCache.pop(key) == none, "Key already exists in cache");
   //TODO Shouldn't we return boost::none if the key already exists?
   //TODO Key can also already exist but not be in the cache right now.
   ++_numNewBlocks;
-  return unique_ref<Block>(make_unique_ref<CachedBlock>(make_unique_ref<NewBlock>(key, std::move(data), this), this));
+  return unique_ref<Block>(make_unique_ref<CachedBlock>(make_unique_ref<NewBlock>(key, std::move(data), this), this, true));
 }
 
 optional<unique_ref<Block>> CachingBlockStore::load(const Key &key) {
   optional<unique_ref<Block>> optBlock = _cache.pop(key);
   //TODO an optional<> class with .getOrElse() would make this code simpler. boost::optional<>::value_or_eval didn't seem to work with unique_ptr members.
   if (optBlock != none) {
-    return optional<unique_ref<Block>>(make_unique_ref<CachedBlock>(std::move(*optBlock), this));
+    ++_numHits;
+    return optional<unique_ref<Block>>(make_unique_ref<CachedBlock>(std::move(*optBlock), this, true));
+  }
+  // If the block is currently being written back, this waits until that's done and the block is in the read cache.
+  optBlock = _writeBackPool.pop(key);
+  if (optBlock != none) {
+    ++_numHits;
+    return optional<unique_ref<Block>>(make_unique_ref<CachedBlock>(std::move(*optBlock), this, true));
+  }
+  optBlock = _readCache.pop(key);
+  if (optBlock != none) {
+    ++_numHits;
+    return optional<unique_ref<Block>>(make_unique_ref<CachedBlock>(std::move(*optBlock), this, false));
+  }
+  ++_numMisses;
+  auto block = _baseBlockStore->load(key);
+  if (block == none) {
+    return none;
   } else {
-    auto block = _baseBlockStore->load(key);
-    if (block == none) {
-      return none;
-    } else {
-      return optional<unique_ref<Block>>(make_unique_ref<CachedBlock>(std::move(*block), this));
-    }
+    return optional<unique_ref<Block>>(make_unique_ref<CachedBlock>(std::move(*block), this, false));
   }
 }
 
@@ -63,6 +99,22 @@ void CachingBlockStore::remove(cpputils::unique_ref<Block> block) {
   }
 }
 
+bool CachingBlockStore::remove(const Key &key) {
+  // A cached block might not be written to the base store yet, so it has to be removed like a loaded block
+  optional<unique_ref<Block>> cached = _cache.pop(key);
+  if (cached == none) {
+    cached = _writeBackPool.pop(key);
+  }
+  if (cached == none) {
+    cached = _readCache.pop(key);
+  }
+  if (cached != none) {
+    remove(make_unique_ref<CachedBlock>(std::move(*cached), this, false));
+    return true;
+  }
+  return _baseBlockStore->remove(key);
+}
+
 uint64_t CachingBlockStore::numBlocks() const {
   return _baseBlockStore->numBlocks() + _numNewBlocks;
 }
@@ -71,9 +123,28 @@ uint64_t CachingBlockStore::estimateNumFreeBytes() const {
   return _baseBlockStore->estimateNumFreeBytes();
 }
 
-void CachingBlockStore::release(unique_ref<Block> block) {
+void CachingBlockStore::release(unique_ref<Block> block, bool dirty) {
+  Key key = block->key();
+  if (dirty) {
+    _cache.push(key, std::move(block));
+  } else {
+    _readCache.push(key, std::move(block));
+  }
+}
+
+void CachingBlockStore::_scheduleWriteBack(unique_ref<Block> block) {
   Key key = block->key();
-  _cache.push(key, std::move(block));
+  _writeBackPool.push(key, std::move(block));
+}
+
+void CachingBlockStore::_writeBack(unique_ref<Block> &block) {
+  block->flush();
+}
+
+void CachingBlockStore::_moveToReadCache(unique_ref<Block> block) {
+  // The block is written back, so it's clean and can be evicted from the read cache without writing it.
+  Key key = block->key();
+  _readCache.push(key, std::move(block));
 }
 
 optional<unique_ref<Block>> CachingBlockStore::tryCreateInBaseStore(const Key &key, Data data) {
@@ -90,6 +161,45 @@ void CachingBlockStore::removeFromBaseStore(cpputils::unique_ref<Block> block) {
 
 void CachingBlockStore::flush() {
   _cache.flush();
+  _writeBackPool.flush();
+}
+
+void CachingBlockStore::flush(const std::vector<Key> &keys) {
+  for (const Key &key : keys) {
+    // If a background thread is currently writing the block back, this waits until it is done
+    optional<unique_ref<Block>> block = _cache.pop(key);
+    if (block == none) {
+      block = _writeBackPool.pop(key);
+    }
+    if (block == none) {
+      continue;
+    }
+    try {
+      _writeBack(*block);
+    } catch (...) {
+      release(std::move(*block), true);
+      throw;
+    }
+    _moveToReadCache(std::move(*block));
+  }
+  _baseBlockStore->flush(keys);
+}
+
+unsigned int CachingBlockStore::_numWriteBackThreads() {
+  // Twice the number of cores, so we use full CPU even if half the threads are doing I/O
+  return 2 * std::max(1u, std::thread::hardware_concurrency());
+}
+
+void CachingBlockStore::_logStatistics() const {
+  auto stats = statistics();
+  LOG(INFO, "Block cache: {} hits, {} misses, {} blocks evicted from the read cache, which holds {} bytes", stats.numHits, stats.numMisses, stats.numEvictions, stats.numBytes);
+}
+
+CacheStatistics CachingBlockStore::statistics() const {
+  CacheStatistics result = _readCache.statistics();
+  result.numHits = _numHits;
+  result.numMisses = _numMisses;
+  return result;
 }
 
 uint64_t CachingBlockStore::blockSizeFromPhysicalBlockSize(uint64_t blockSize) const {
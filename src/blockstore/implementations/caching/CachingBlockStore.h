@@ -3,7 +3,11 @@
 #define MESSMER_BLOCKSTORE_IMPLEMENTATIONS_CACHING_CACHINGBLOCKSTORE_H_
 
 #include "cache/Cache.h"
+#include "cache/TwoQueueCache.h"
+#include "cache/WriteBackPool.h"
+#include "cache/CacheStatistics.h"
 #include "../../interface/BlockStore.h"
+#include <atomic>
 
 namespace blockstore {
 namespace caching {
@@ -11,27 +15,60 @@ namespace caching {
 //TODO Check that this blockstore allows parallel destructing of blocks (otherwise we won't encrypt blocks in parallel)
 class CachingBlockStore final: public BlockStore {
 public:
-  explicit CachingBlockStore(cpputils::unique_ref<BlockStore> baseBlockStore);
+  static const CacheConfig DEFAULT_CACHE_CONFIG;
+  static const CacheConfig DEFAULT_READ_CACHE_CONFIG;
+  // Number of blocks evicted from the write-back cache that can wait for being written back.
+  // If more blocks are evicted, the evicting thread blocks.
+  static constexpr uint32_t MAX_WRITE_BACK_QUEUE_SIZE = 256;
+
+  // Blocks with changes are kept in a write-back cache (configured by cacheConfig) and written to the base store
+  // after a short time by a pool of background threads. Afterwards, and for blocks that were only read, they're kept
+  // in a read cache (configured by readCacheConfig), which only evicts blocks when its memory budget is exhausted.
+  explicit CachingBlockStore(cpputils::unique_ref<BlockStore> baseBlockStore, const CacheConfig &cacheConfig = DEFAULT_CACHE_CONFIG,
+                             const CacheConfig &readCacheConfig = DEFAULT_READ_CACHE_CONFIG);
+  // Logs the statistics
+  ~CachingBlockStore();
 
   Key createKey() override;
   boost::optional<cpputils::unique_ref<Block>> tryCreate(const Key &key, cpputils::Data data) override;
   boost::optional<cpputils::unique_ref<Block>> load(const Key &key) override;
   void remove(cpputils::unique_ref<Block> block) override;
+  bool remove(const Key &key) override;
   uint64_t numBlocks() const override;
   uint64_t estimateNumFreeBytes() const override;
   uint64_t blockSizeFromPhysicalBlockSize(uint64_t blockSize) const override;
+  // Writes back the given blocks if they're still in the write-back cache or queue, without waiting for other blocks.
+  // Throws if one of them can't be written back. It stays in the cache and is retried.
+  void flush(const std::vector<Key> &keys) override;
 
-  void release(cpputils::unique_ref<Block> block);
+  void release(cpputils::unique_ref<Block> block, bool dirty);
 
   boost::optional<cpputils::unique_ref<Block>> tryCreateInBaseStore(const Key &key, cpputils::Data data);
   void removeFromBaseStore(cpputils::unique_ref<Block> block);
 
+  // Throws if a block couldn't be written back. The block stays queued and is retried.
   void flush();
 
+  // Hits and misses count loads that were or weren't served from one of the caches.
+  // Evictions and size refer to the read cache.
+  CacheStatistics statistics() const;
+
 private:
+  void _scheduleWriteBack(cpputils::unique_ref<Block> block);
+  static void _writeBack(cpputils::unique_ref<Block> &block);
+  void _moveToReadCache(cpputils::unique_ref<Block> block);
+  static unsigned int _numWriteBackThreads();
+  void _logStatistics() const;
+
   cpputils::unique_ref<BlockStore> _baseBlockStore;
-  Cache<Key, cpputils::unique_ref<Block>, 1000> _cache;
+  // The declaration order is important. Blocks evicted from _cache are written back by _writeBackPool, which
+  // moves them to _readCache. This also happens when _cache and _writeBackPool are destructed.
+  TwoQueueCache<Key, cpputils::unique_ref<Block>> _readCache;
+  WriteBackPool<Key, cpputils::unique_ref<Block>> _writeBackPool;
+  Cache<Key, cpputils::unique_ref<Block>> _cache;
   uint32_t _numNewBlocks;
+  std::atomic<uint64_t> _numHits;
+  std::atomic<uint64_t> _numMisses;
 
   DISALLOW_COPY_AND_ASSIGN(CachingBlockStore);
 };
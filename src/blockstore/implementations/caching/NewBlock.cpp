@@ -31,6 +31,12 @@ void NewBlock::write(const void *source, uint64_t offset, uint64_t size) {
   _dataChanged = true;
 }
 
+void NewBlock::writeInPlace(uint64_t offset, uint64_t size, const std::function<void (void *target)> &fill) {
+  ASSERT(offset <= _data.size() && offset + size <= _data.size(), "Write outside of valid area");
+  fill((uint8_t*)_data.data()+offset);
+  _dataChanged = true;
+}
+
 void NewBlock::writeToBaseBlockIfChanged() {
   if (_dataChanged) {
     if (_baseBlock == none) {
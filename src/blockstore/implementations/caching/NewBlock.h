@@ -25,6 +25,7 @@ public:
 
   const void *data() const override;
   void write(const void *source, uint64_t offset, uint64_t size) override;
+  void writeInPlace(uint64_t offset, uint64_t size, const std::function<void (void *target)> &fill) override;
   void flush() override;
 
   size_t size() const override;
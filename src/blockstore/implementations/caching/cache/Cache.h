@@ -3,11 +3,12 @@
 #define MESSMER_BLOCKSTORE_IMPLEMENTATIONS_CACHING_CACHE_CACHE_H_
 
 #include "CacheEntry.h"
+#include "CacheConfig.h"
 #include "QueueMap.h"
 #include "PeriodicTask.h"
 #include <memory>
+#include <vector>
 #include <boost/optional.hpp>
-#include <future>
 #include <cpp-utils/assert/assert.h>
 #include <cpp-utils/lock/MutexPoolLock.h>
 #include <cpp-utils/pointer/gcc_4_8_compatibility.h>
@@ -15,7 +16,9 @@
 namespace blockstore {
 namespace caching {
 
-template<class Key, class Value, uint32_t MAX_ENTRIES>
+// The cache is split into shards by the hash of the key. Each shard has its own mutex and its own
+// share of the entry and byte budget, so threads accessing different shards don't contend.
+template<class Key, class Value>
 class Cache final {
 public:
   //TODO Current MAX_LIFETIME_SEC only considers time since the element was last pushed to the Cache. Also insert a real MAX_LIFETIME_SEC that forces resync of entries that have been pushed/popped often (e.g. the root blob)
@@ -24,10 +27,15 @@ public:
   static constexpr double PURGE_INTERVAL = 0.5; // With this interval, we check for entries to purge
   static constexpr double MAX_LIFETIME_SEC = PURGE_LIFETIME_SEC + PURGE_INTERVAL; // This is the oldest age an entry can reach (given purging works in an ideal world, i.e. with the ideal interval and in zero time)
 
-  Cache();
+  // sizeOfValue is used to account entries against config.maxBytes. If it isn't given, entries don't count against the byte budget.
+  // onEvict is called with each entry that is purged or evicted from the cache (outside of the cache lock).
+  // If it isn't given, evicted values are just destructed.
+  explicit Cache(const CacheConfig &config, std::function<uint64_t (const Value &)> sizeOfValue = nullptr,
+                 std::function<void (Value)> onEvict = nullptr);
   ~Cache();
 
   uint32_t size() const;
+  uint64_t sizeBytes() const;
 
   void push(const Key &key, Value value);
   boost::optional<Value> pop(const Key &key);
@@ -35,127 +43,159 @@ public:
   void flush();
 
 private:
-  void _makeSpaceForEntry(std::unique_lock<std::mutex> *lock);
-  void _deleteEntry(std::unique_lock<std::mutex> *lock);
-  void _deleteOldEntriesParallel();
-  void _deleteAllEntriesParallel();
-  void _deleteMatchingEntriesAtBeginningParallel(std::function<bool (const CacheEntry<Key, Value> &)> matches);
+  struct Shard final {
+    Shard(): mutex(), currentlyFlushingEntries(), cachedBlocks(), numBytes(0) {}
+
+    mutable std::mutex mutex;
+    cpputils::LockPool<Key> currentlyFlushingEntries;
+    QueueMap<Key, CacheEntry<Key, Value>> cachedBlocks;
+    uint64_t numBytes;
+
+    DISALLOW_COPY_AND_ASSIGN(Shard);
+  };
+
+  Shard *_shardFor(const Key &key);
+  bool _shardIsFull(const Shard &shard, uint64_t bytesToAdd) const;
+  void _makeSpaceForEntry(Shard *shard, uint64_t entrySizeBytes, std::unique_lock<std::mutex> *lock);
+  void _deleteEntry(Shard *shard, std::unique_lock<std::mutex> *lock);
+  void _deleteOldEntries();
+  void _deleteAllEntries();
   void _deleteMatchingEntriesAtBeginning(std::function<bool (const CacheEntry<Key, Value> &)> matches);
-  bool _deleteMatchingEntryAtBeginning(std::function<bool (const CacheEntry<Key, Value> &)> matches);
+  bool _deleteMatchingEntryAtBeginning(Shard *shard, std::function<bool (const CacheEntry<Key, Value> &)> matches);
 
-  mutable std::mutex _mutex;
-  cpputils::LockPool<Key> _currentlyFlushingEntries;
-  QueueMap<Key, CacheEntry<Key, Value>> _cachedBlocks;
+  const uint32_t _maxEntriesPerShard;
+  const uint64_t _maxBytesPerShard;
+  std::function<uint64_t (const Value &)> _sizeOfValue;
+  std::function<void (Value)> _onEvict;
+  std::vector<std::unique_ptr<Shard>> _shards;
   std::unique_ptr<PeriodicTask> _timeoutFlusher;
 
   DISALLOW_COPY_AND_ASSIGN(Cache);
 };
 
-template<class Key, class Value, uint32_t MAX_ENTRIES> constexpr double Cache<Key, Value, MAX_ENTRIES>::PURGE_LIFETIME_SEC;
-template<class Key, class Value, uint32_t MAX_ENTRIES> constexpr double Cache<Key, Value, MAX_ENTRIES>::PURGE_INTERVAL;
-template<class Key, class Value, uint32_t MAX_ENTRIES> constexpr double Cache<Key, Value, MAX_ENTRIES>::MAX_LIFETIME_SEC;
-
-template<class Key, class Value, uint32_t MAX_ENTRIES>
-Cache<Key, Value, MAX_ENTRIES>::Cache(): _mutex(), _currentlyFlushingEntries(), _cachedBlocks(), _timeoutFlusher(nullptr) {
+template<class Key, class Value> constexpr double Cache<Key, Value>::PURGE_LIFETIME_SEC;
+template<class Key, class Value> constexpr double Cache<Key, Value>::PURGE_INTERVAL;
+template<class Key, class Value> constexpr double Cache<Key, Value>::MAX_LIFETIME_SEC;
+
+template<class Key, class Value>
+Cache<Key, Value>::Cache(const CacheConfig &config, std::function<uint64_t (const Value &)> sizeOfValue, std::function<void (Value)> onEvict)
+  : _maxEntriesPerShard(config.maxEntriesPerShard()),
+    _maxBytesPerShard(config.maxBytesPerShard()),
+    _sizeOfValue(std::move(sizeOfValue)), _onEvict(std::move(onEvict)), _shards(), _timeoutFlusher(nullptr) {
+  ASSERT(config.numShards > 0, "Cache needs at least one shard");
+  for (uint32_t i = 0; i < std::max(1u, config.numShards); ++i) {
+    _shards.push_back(std::make_unique<Shard>());
+  }
   //Don't initialize timeoutFlusher in the initializer list,
   //because it then might already call Cache::popOldEntries() before Cache is done constructing.
-  _timeoutFlusher = std::make_unique<PeriodicTask>(std::bind(&Cache::_deleteOldEntriesParallel, this), PURGE_INTERVAL);
+  _timeoutFlusher = std::make_unique<PeriodicTask>(std::bind(&Cache::_deleteOldEntries, this), PURGE_INTERVAL);
+}
+
+template<class Key, class Value>
+Cache<Key, Value>::~Cache() {
+  _deleteAllEntries();
+  ASSERT(size() == 0, "Error in _deleteAllEntries()");
 }
 
-template<class Key, class Value, uint32_t MAX_ENTRIES>
-Cache<Key, Value, MAX_ENTRIES>::~Cache() {
-  _deleteAllEntriesParallel();
-  ASSERT(_cachedBlocks.size() == 0, "Error in _deleteAllEntriesParallel()");
+template<class Key, class Value>
+typename Cache<Key, Value>::Shard *Cache<Key, Value>::_shardFor(const Key &key) {
+  return _shards[std::hash<Key>()(key) % _shards.size()].get();
 }
 
-template<class Key, class Value, uint32_t MAX_ENTRIES>
-boost::optional<Value> Cache<Key, Value, MAX_ENTRIES>::pop(const Key &key) {
-  std::unique_lock<std::mutex> lock(_mutex);
-  cpputils::MutexPoolLock<Key> lockEntryFromBeingPopped(&_currentlyFlushingEntries, key, &lock);
+template<class Key, class Value>
+boost::optional<Value> Cache<Key, Value>::pop(const Key &key) {
+  Shard *shard = _shardFor(key);
+  std::unique_lock<std::mutex> lock(shard->mutex);
+  cpputils::MutexPoolLock<Key> lockEntryFromBeingPopped(&shard->currentlyFlushingEntries, key, &lock);
 
-  auto found = _cachedBlocks.pop(key);
+  auto found = shard->cachedBlocks.pop(key);
   if (!found) {
     return boost::none;
   }
+  shard->numBytes -= found->sizeBytes();
   return found->releaseValue();
 }
 
-template<class Key, class Value, uint32_t MAX_ENTRIES>
-void Cache<Key, Value, MAX_ENTRIES>::push(const Key &key, Value value) {
-  std::unique_lock<std::mutex> lock(_mutex);
-  ASSERT(_cachedBlocks.size() <= MAX_ENTRIES, "Cache too full");
-  _makeSpaceForEntry(&lock);
-  _cachedBlocks.push(key, CacheEntry<Key, Value>(std::move(value)));
+template<class Key, class Value>
+void Cache<Key, Value>::push(const Key &key, Value value) {
+  uint64_t entrySizeBytes = (_sizeOfValue == nullptr) ? 0 : _sizeOfValue(value);
+  Shard *shard = _shardFor(key);
+  std::unique_lock<std::mutex> lock(shard->mutex);
+  ASSERT(shard->cachedBlocks.size() <= _maxEntriesPerShard, "Cache too full");
+  _makeSpaceForEntry(shard, entrySizeBytes, &lock);
+  shard->cachedBlocks.push(key, CacheEntry<Key, Value>(std::move(value), entrySizeBytes));
+  shard->numBytes += entrySizeBytes;
+}
+
+template<class Key, class Value>
+bool Cache<Key, Value>::_shardIsFull(const Shard &shard, uint64_t bytesToAdd) const {
+  if (shard.cachedBlocks.size() >= _maxEntriesPerShard) {
+    return true;
+  }
+  // An entry larger than the whole byte budget of the shard is still cached, once the shard is empty.
+  return shard.cachedBlocks.size() > 0 && shard.numBytes + bytesToAdd > _maxBytesPerShard;
 }
 
-template<class Key, class Value, uint32_t MAX_ENTRIES>
-void Cache<Key, Value, MAX_ENTRIES>::_makeSpaceForEntry(std::unique_lock<std::mutex> *lock) {
+template<class Key, class Value>
+void Cache<Key, Value>::_makeSpaceForEntry(Shard *shard, uint64_t entrySizeBytes, std::unique_lock<std::mutex> *lock) {
   // _deleteEntry releases the lock while the Value destructor is running.
   // So we can destruct multiple entries in parallel and also call pop() or push() while doing so.
   // However, if another thread calls push() before we get the lock back, the cache is full again.
   // That's why we need the while() loop here.
-  while (_cachedBlocks.size() == MAX_ENTRIES) {
-    _deleteEntry(lock);
+  while (_shardIsFull(*shard, entrySizeBytes)) {
+    _deleteEntry(shard, lock);
   }
-  ASSERT(_cachedBlocks.size() < MAX_ENTRIES, "Removing entry from cache didn't work");
+  ASSERT(shard->cachedBlocks.size() < _maxEntriesPerShard, "Removing entry from cache didn't work");
 };
 
-template<class Key, class Value, uint32_t MAX_ENTRIES>
-void Cache<Key, Value, MAX_ENTRIES>::_deleteEntry(std::unique_lock<std::mutex> *lock) {
+template<class Key, class Value>
+void Cache<Key, Value>::_deleteEntry(Shard *shard, std::unique_lock<std::mutex> *lock) {
   ASSERT(lock->owns_lock(), "The operations in this function require a locked mutex");
-  auto key = _cachedBlocks.peekKey();
+  auto key = shard->cachedBlocks.peekKey();
   ASSERT(key != boost::none, "There was no entry to delete");
-  cpputils::MutexPoolLock<Key> lockEntryFromBeingPopped(&_currentlyFlushingEntries, *key);
-  auto value = _cachedBlocks.pop();
+  cpputils::MutexPoolLock<Key> lockEntryFromBeingPopped(&shard->currentlyFlushingEntries, *key);
+  auto value = shard->cachedBlocks.pop();
+  shard->numBytes -= value->sizeBytes();
   // Call destructor outside of the unique_lock,
   // i.e. pop() and push() can be called here, except for pop() on the element in _currentlyFlushingEntries
   lock->unlock();
+  if (_onEvict != nullptr) {
+    _onEvict(value->releaseValue());
+  }
   value = boost::none; // Call destructor
   lockEntryFromBeingPopped.unlock();  // unlock this one first to keep same locking oder (preventing potential deadlock)
   lock->lock();
 };
 
-template<class Key, class Value, uint32_t MAX_ENTRIES>
-void Cache<Key, Value, MAX_ENTRIES>::_deleteAllEntriesParallel() {
-  return _deleteMatchingEntriesAtBeginningParallel([] (const CacheEntry<Key, Value> &) {
+template<class Key, class Value>
+void Cache<Key, Value>::_deleteAllEntries() {
+  return _deleteMatchingEntriesAtBeginning([] (const CacheEntry<Key, Value> &) {
       return true;
   });
 }
 
-template<class Key, class Value, uint32_t MAX_ENTRIES>
-void Cache<Key, Value, MAX_ENTRIES>::_deleteOldEntriesParallel() {
-  return _deleteMatchingEntriesAtBeginningParallel([] (const CacheEntry<Key, Value> &entry) {
+template<class Key, class Value>
+void Cache<Key, Value>::_deleteOldEntries() {
+  return _deleteMatchingEntriesAtBeginning([] (const CacheEntry<Key, Value> &entry) {
       return entry.ageSeconds() > PURGE_LIFETIME_SEC;
   });
 }
 
-template<class Key, class Value, uint32_t MAX_ENTRIES>
-void Cache<Key, Value, MAX_ENTRIES>::_deleteMatchingEntriesAtBeginningParallel(std::function<bool (const CacheEntry<Key, Value> &)> matches) {
-  // Twice the number of cores, so we use full CPU even if half the threads are doing I/O
-  unsigned int numThreads = 2 * std::max(1u, std::thread::hardware_concurrency());
-  std::vector<std::future<void>> waitHandles;
-  for (unsigned int i = 0; i < numThreads; ++i) {
-    waitHandles.push_back(std::async(std::launch::async, [this, matches] {
-        _deleteMatchingEntriesAtBeginning(matches);
-    }));
-  }
-  for (auto & waitHandle : waitHandles) {
-    waitHandle.wait();
+template<class Key, class Value>
+void Cache<Key, Value>::_deleteMatchingEntriesAtBeginning(std::function<bool (const CacheEntry<Key, Value> &)> matches) {
+  // This runs in the calling thread. Users with expensive value destructors pass an onEvict callback
+  // that hands the values off to other threads (see CachingBlockStore).
+  for (const auto &shard : _shards) {
+    while (_deleteMatchingEntryAtBeginning(shard.get(), matches)) {}
   }
-};
-
-template<class Key, class Value, uint32_t MAX_ENTRIES>
-void Cache<Key, Value, MAX_ENTRIES>::_deleteMatchingEntriesAtBeginning(std::function<bool (const CacheEntry<Key, Value> &)> matches) {
-  while (_deleteMatchingEntryAtBeginning(matches)) {}
 }
 
-template<class Key, class Value, uint32_t MAX_ENTRIES>
-bool Cache<Key, Value, MAX_ENTRIES>::_deleteMatchingEntryAtBeginning(std::function<bool (const CacheEntry<Key, Value> &)> matches) {
-  // This function can be called in parallel by multiple threads and will then cause the Value destructors
-  // to be called in parallel. The call to _deleteEntry() releases the lock while the Value destructor is running.
-  std::unique_lock<std::mutex> lock(_mutex);
-  if (_cachedBlocks.size() > 0 && matches(*_cachedBlocks.peek())) {
-    _deleteEntry(&lock);
+template<class Key, class Value>
+bool Cache<Key, Value>::_deleteMatchingEntryAtBeginning(Shard *shard, std::function<bool (const CacheEntry<Key, Value> &)> matches) {
+  // The call to _deleteEntry() releases the lock while the Value destructor is running.
+  std::unique_lock<std::mutex> lock(shard->mutex);
+  if (shard->cachedBlocks.size() > 0 && matches(*shard->cachedBlocks.peek())) {
+    _deleteEntry(shard, &lock);
     ASSERT(lock.owns_lock(), "Something strange happened with the lock. It should be locked again when we come back.");
     return true;
   } else {
@@ -163,16 +203,30 @@ bool Cache<Key, Value, MAX_ENTRIES>::_deleteMatchingEntryAtBeginning(std::functi
   }
 };
 
-template<class Key, class Value, uint32_t MAX_ENTRIES>
-uint32_t Cache<Key, Value, MAX_ENTRIES>::size() const {
-  std::unique_lock<std::mutex> lock(_mutex);
-  return _cachedBlocks.size();
+template<class Key, class Value>
+uint32_t Cache<Key, Value>::size() const {
+  uint32_t result = 0;
+  for (const auto &shard : _shards) {
+    std::unique_lock<std::mutex> lock(shard->mutex);
+    result += shard->cachedBlocks.size();
+  }
+  return result;
+};
+
+template<class Key, class Value>
+uint64_t Cache<Key, Value>::sizeBytes() const {
+  uint64_t result = 0;
+  for (const auto &shard : _shards) {
+    std::unique_lock<std::mutex> lock(shard->mutex);
+    result += shard->numBytes;
+  }
+  return result;
 };
 
-template<class Key, class Value, uint32_t MAX_ENTRIES>
-void Cache<Key, Value, MAX_ENTRIES>::flush() {
+template<class Key, class Value>
+void Cache<Key, Value>::flush() {
   //TODO Test flush()
-  return _deleteAllEntriesParallel();
+  return _deleteAllEntries();
 };
 
 }
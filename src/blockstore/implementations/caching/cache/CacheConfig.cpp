@@ -0,0 +1,24 @@
+#include "CacheConfig.h"
+#include <algorithm>
+
+namespace blockstore {
+namespace caching {
+
+constexpr uint64_t CacheConfig::UNLIMITED_BYTES;
+
+uint32_t CacheConfig::maxEntriesPerShard() const {
+  uint64_t shards = std::max(1u, numShards);
+  // Compute in 64bit, because maxEntries + shards - 1 would overflow for maxEntries close to UINT32_MAX
+  uint64_t result = (static_cast<uint64_t>(maxEntries) + shards - 1) / shards;
+  return std::max(static_cast<uint32_t>(1u), static_cast<uint32_t>(result));
+}
+
+uint64_t CacheConfig::maxBytesPerShard() const {
+  if (maxBytes == UNLIMITED_BYTES) {
+    return UNLIMITED_BYTES;
+  }
+  return maxBytes / std::max(1u, numShards);
+}
+
+}
+}
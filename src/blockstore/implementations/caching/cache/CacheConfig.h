@@ -0,0 +1,33 @@
+#pragma once
+#ifndef MESSMER_BLOCKSTORE_IMPLEMENTATIONS_CACHING_CACHE_CACHECONFIG_H_
+#define MESSMER_BLOCKSTORE_IMPLEMENTATIONS_CACHING_CACHE_CACHECONFIG_H_
+
+#include <cstdint>
+#include <limits>
+
+namespace blockstore {
+namespace caching {
+
+// Runtime configuration for a Cache.
+// The cache is split into numShards independent shards (each with its own lock), and each shard
+// gets an equal part of the entry and byte budget. Entries are evicted per shard.
+struct CacheConfig final {
+  static constexpr uint64_t UNLIMITED_BYTES = std::numeric_limits<uint64_t>::max();
+
+  CacheConfig(uint32_t maxEntries_, uint32_t numShards_, uint64_t maxBytes_ = UNLIMITED_BYTES)
+    : maxEntries(maxEntries_), numShards(numShards_), maxBytes(maxBytes_) {
+  }
+
+  uint32_t maxEntries;
+  uint32_t numShards;
+  uint64_t maxBytes;
+
+  // The budget of a single shard. The entry budget is rounded up, so every shard can hold at least one entry.
+  uint32_t maxEntriesPerShard() const;
+  uint64_t maxBytesPerShard() const;
+};
+
+}
+}
+
+#endif
@@ -13,7 +13,7 @@ namespace caching {
 template<class Key, class Value>
 class CacheEntry final {
 public:
-  explicit CacheEntry(Value value): _lastAccess(currentTime()), _value(std::move(value)) {
+  CacheEntry(Value value, uint64_t sizeBytes): _lastAccess(currentTime()), _sizeBytes(sizeBytes), _value(std::move(value)) {
   }
 
   CacheEntry(CacheEntry &&) = default;
@@ -22,12 +22,17 @@ public:
     return ((double)(currentTime() - _lastAccess).total_nanoseconds()) / ((double)1000000000);
   }
 
+  uint64_t sizeBytes() const {
+    return _sizeBytes;
+  }
+
   Value releaseValue() {
     return std::move(_value);
   }
 
 private:
   boost::posix_time::ptime _lastAccess;
+  uint64_t _sizeBytes;
   Value _value;
 
   static boost::posix_time::ptime currentTime() {
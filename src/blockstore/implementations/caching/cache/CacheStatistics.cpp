@@ -0,0 +1 @@
+#include "CacheStatistics.h"
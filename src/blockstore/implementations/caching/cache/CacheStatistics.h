@@ -0,0 +1,23 @@
+#pragma once
+#ifndef MESSMER_BLOCKSTORE_IMPLEMENTATIONS_CACHING_CACHE_CACHESTATISTICS_H_
+#define MESSMER_BLOCKSTORE_IMPLEMENTATIONS_CACHING_CACHE_CACHESTATISTICS_H_
+
+#include <cstdint>
+
+namespace blockstore {
+namespace caching {
+
+struct CacheStatistics final {
+  CacheStatistics(): numHits(0), numMisses(0), numEvictions(0), numBytes(0) {
+  }
+
+  uint64_t numHits;
+  uint64_t numMisses;
+  uint64_t numEvictions;
+  uint64_t numBytes;
+};
+
+}
+}
+
+#endif
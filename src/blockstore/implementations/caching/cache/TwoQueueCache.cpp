@@ -0,0 +1 @@
+#include "TwoQueueCache.h"
@@ -0,0 +1,216 @@
+#pragma once
+#ifndef MESSMER_BLOCKSTORE_IMPLEMENTATIONS_CACHING_CACHE_TWOQUEUECACHE_H_
+#define MESSMER_BLOCKSTORE_IMPLEMENTATIONS_CACHING_CACHE_TWOQUEUECACHE_H_
+
+#include "CacheEntry.h"
+#include "CacheConfig.h"
+#include "CacheStatistics.h"
+#include "QueueMap.h"
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include <boost/optional.hpp>
+#include <cpp-utils/assert/assert.h>
+#include <cpp-utils/macros.h>
+#include <cpp-utils/pointer/gcc_4_8_compatibility.h>
+
+namespace blockstore {
+namespace caching {
+
+// A cache with a byte budget and the scan resistant 2Q replacement policy.
+// New entries are added to a FIFO queue (A1in). When an entry is evicted from A1in, its key is remembered in a ghost
+// queue (A1out). Entries that are pushed again while their key is a ghost go to an LRU queue (Am) instead.
+// So a sequential scan only cycles through A1in and doesn't throw out the frequently used entries in Am.
+//
+// Values are moved out of the cache with pop() while they're in use and pushed back afterwards. To keep an entry
+// of Am in Am, pop() remembers its key as a ghost. Entries are never purged by age, only evicted when the cache is full.
+// Evicted values are destructed, so only values that don't have to be written back should be pushed into this cache.
+//
+// Like Cache, it is split into shards by the hash of the key, each with its own lock and its own part of the budget.
+template<class Key, class Value>
+class TwoQueueCache final {
+public:
+  // Part of the entry and byte budget of a shard that A1in can use before its entries are evicted first.
+  static constexpr double RECENTLY_ADDED_SHARE = 0.25;
+  // Minimal number of ghost keys per shard. If there are more entries in the shard, there can be as many ghosts as entries.
+  static constexpr uint32_t MIN_NUM_GHOSTS = 64;
+
+  TwoQueueCache(const CacheConfig &config, std::function<uint64_t (const Value &)> sizeOfValue);
+
+  uint32_t size() const;
+  uint64_t sizeBytes() const;
+  CacheStatistics statistics() const;
+
+  void push(const Key &key, Value value);
+  boost::optional<Value> pop(const Key &key);
+
+private:
+  struct Shard final {
+    Shard(): mutex(), recentlyAdded(), frequentlyUsed(), ghosts(), recentlyAddedBytes(0), frequentlyUsedBytes(0), statistics() {}
+
+    mutable std::mutex mutex;
+    QueueMap<Key, CacheEntry<Key, Value>> recentlyAdded; // A1in, in insertion order
+    QueueMap<Key, CacheEntry<Key, Value>> frequentlyUsed; // Am, in order of last use
+    QueueMap<Key, bool> ghosts; // A1out, only keys
+    uint64_t recentlyAddedBytes;
+    uint64_t frequentlyUsedBytes;
+    CacheStatistics statistics;
+
+    DISALLOW_COPY_AND_ASSIGN(Shard);
+  };
+
+  Shard *_shardFor(const Key &key);
+  bool _isOverBudget(const Shard &shard) const;
+  bool _recentlyAddedIsOverShare(const Shard &shard) const;
+  void _evictEntry(Shard *shard, std::vector<Value> *evicted);
+  void _rememberGhost(Shard *shard, const Key &key);
+
+  const uint32_t _maxEntriesPerShard;
+  const uint64_t _maxBytesPerShard;
+  std::function<uint64_t (const Value &)> _sizeOfValue;
+  std::vector<std::unique_ptr<Shard>> _shards;
+
+  DISALLOW_COPY_AND_ASSIGN(TwoQueueCache);
+};
+
+template<class Key, class Value> constexpr double TwoQueueCache<Key, Value>::RECENTLY_ADDED_SHARE;
+template<class Key, class Value> constexpr uint32_t TwoQueueCache<Key, Value>::MIN_NUM_GHOSTS;
+
+template<class Key, class Value>
+TwoQueueCache<Key, Value>::TwoQueueCache(const CacheConfig &config, std::function<uint64_t (const Value &)> sizeOfValue)
+  : _maxEntriesPerShard(config.maxEntriesPerShard()),
+    _maxBytesPerShard(config.maxBytesPerShard()),
+    _sizeOfValue(std::move(sizeOfValue)), _shards() {
+  ASSERT(config.numShards > 0, "Cache needs at least one shard");
+  for (uint32_t i = 0; i < std::max(1u, config.numShards); ++i) {
+    _shards.push_back(std::make_unique<Shard>());
+  }
+}
+
+template<class Key, class Value>
+typename TwoQueueCache<Key, Value>::Shard *TwoQueueCache<Key, Value>::_shardFor(const Key &key) {
+  return _shards[std::hash<Key>()(key) % _shards.size()].get();
+}
+
+template<class Key, class Value>
+boost::optional<Value> TwoQueueCache<Key, Value>::pop(const Key &key) {
+  Shard *shard = _shardFor(key);
+  std::unique_lock<std::mutex> lock(shard->mutex);
+  auto foundRecentlyAdded = shard->recentlyAdded.pop(key);
+  if (foundRecentlyAdded != boost::none) {
+    shard->recentlyAddedBytes -= foundRecentlyAdded->sizeBytes();
+    ++shard->statistics.numHits;
+    return foundRecentlyAdded->releaseValue();
+  }
+  auto foundFrequentlyUsed = shard->frequentlyUsed.pop(key);
+  if (foundFrequentlyUsed != boost::none) {
+    shard->frequentlyUsedBytes -= foundFrequentlyUsed->sizeBytes();
+    ++shard->statistics.numHits;
+    // When the value is pushed back, this puts it back into Am
+    _rememberGhost(shard, key);
+    return foundFrequentlyUsed->releaseValue();
+  }
+  ++shard->statistics.numMisses;
+  return boost::none;
+}
+
+template<class Key, class Value>
+void TwoQueueCache<Key, Value>::push(const Key &key, Value value) {
+  uint64_t entrySizeBytes = _sizeOfValue(value);
+  Shard *shard = _shardFor(key);
+  // Declared before the lock, so evicted values are destructed after the lock is released.
+  std::vector<Value> evicted;
+  std::unique_lock<std::mutex> lock(shard->mutex);
+  if (shard->ghosts.pop(key) != boost::none) {
+    shard->frequentlyUsed.push(key, CacheEntry<Key, Value>(std::move(value), entrySizeBytes));
+    shard->frequentlyUsedBytes += entrySizeBytes;
+  } else {
+    shard->recentlyAdded.push(key, CacheEntry<Key, Value>(std::move(value), entrySizeBytes));
+    shard->recentlyAddedBytes += entrySizeBytes;
+  }
+  while (_isOverBudget(*shard)) {
+    _evictEntry(shard, &evicted);
+  }
+}
+
+template<class Key, class Value>
+bool TwoQueueCache<Key, Value>::_isOverBudget(const Shard &shard) const {
+  uint32_t numEntries = shard.recentlyAdded.size() + shard.frequentlyUsed.size();
+  // An entry larger than the whole byte budget of the shard is still cached, if it is the only one.
+  if (numEntries <= 1) {
+    return false;
+  }
+  return numEntries > _maxEntriesPerShard || shard.recentlyAddedBytes + shard.frequentlyUsedBytes > _maxBytesPerShard;
+}
+
+template<class Key, class Value>
+bool TwoQueueCache<Key, Value>::_recentlyAddedIsOverShare(const Shard &shard) const {
+  return shard.recentlyAdded.size() > RECENTLY_ADDED_SHARE * _maxEntriesPerShard
+      || shard.recentlyAddedBytes > RECENTLY_ADDED_SHARE * _maxBytesPerShard;
+}
+
+template<class Key, class Value>
+void TwoQueueCache<Key, Value>::_evictEntry(Shard *shard, std::vector<Value> *evicted) {
+  if (shard->recentlyAdded.size() > 0 && (shard->frequentlyUsed.size() == 0 || _recentlyAddedIsOverShare(*shard))) {
+    Key key = *shard->recentlyAdded.peekKey();
+    auto entry = shard->recentlyAdded.pop();
+    shard->recentlyAddedBytes -= entry->sizeBytes();
+    _rememberGhost(shard, key);
+    evicted->push_back(entry->releaseValue());
+  } else {
+    auto entry = shard->frequentlyUsed.pop();
+    ASSERT(entry != boost::none, "There was no entry to evict");
+    shard->frequentlyUsedBytes -= entry->sizeBytes();
+    evicted->push_back(entry->releaseValue());
+  }
+  ++shard->statistics.numEvictions;
+}
+
+template<class Key, class Value>
+void TwoQueueCache<Key, Value>::_rememberGhost(Shard *shard, const Key &key) {
+  shard->ghosts.pop(key);
+  shard->ghosts.push(key, true);
+  uint32_t maxNumGhosts = std::max(MIN_NUM_GHOSTS, shard->recentlyAdded.size() + shard->frequentlyUsed.size());
+  while (shard->ghosts.size() > maxNumGhosts) {
+    shard->ghosts.pop();
+  }
+}
+
+template<class Key, class Value>
+uint32_t TwoQueueCache<Key, Value>::size() const {
+  uint32_t result = 0;
+  for (const auto &shard : _shards) {
+    std::unique_lock<std::mutex> lock(shard->mutex);
+    result += shard->recentlyAdded.size() + shard->frequentlyUsed.size();
+  }
+  return result;
+}
+
+template<class Key, class Value>
+uint64_t TwoQueueCache<Key, Value>::sizeBytes() const {
+  uint64_t result = 0;
+  for (const auto &shard : _shards) {
+    std::unique_lock<std::mutex> lock(shard->mutex);
+    result += shard->recentlyAddedBytes + shard->frequentlyUsedBytes;
+  }
+  return result;
+}
+
+template<class Key, class Value>
+CacheStatistics TwoQueueCache<Key, Value>::statistics() const {
+  CacheStatistics result;
+  for (const auto &shard : _shards) {
+    std::unique_lock<std::mutex> lock(shard->mutex);
+    result.numHits += shard->statistics.numHits;
+    result.numMisses += shard->statistics.numMisses;
+    result.numEvictions += shard->statistics.numEvictions;
+    result.numBytes += shard->recentlyAddedBytes + shard->frequentlyUsedBytes;
+  }
+  return result;
+}
+
+}
+}
+
+#endif
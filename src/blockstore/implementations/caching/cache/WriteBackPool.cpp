@@ -0,0 +1 @@
+#include "WriteBackPool.h"
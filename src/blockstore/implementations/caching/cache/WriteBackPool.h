@@ -0,0 +1,211 @@
+#pragma once
+#ifndef MESSMER_BLOCKSTORE_IMPLEMENTATIONS_CACHING_CACHE_WRITEBACKPOOL_H_
+#define MESSMER_BLOCKSTORE_IMPLEMENTATIONS_CACHING_CACHE_WRITEBACKPOOL_H_
+
+#include "QueueMap.h"
+#include <memory>
+#include <vector>
+#include <unordered_set>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <boost/optional.hpp>
+#include <boost/thread.hpp>
+#include <cpp-utils/assert/assert.h>
+#include <cpp-utils/macros.h>
+#include <cpp-utils/thread/WorkQueue.h>
+#include <cpp-utils/logging/logging.h>
+
+namespace blockstore {
+namespace caching {
+
+// A bounded queue of values that are written back by a fixed set of background threads.
+// If writing back a value fails, the value goes back into the queue and is retried with an increasing delay,
+// so a temporary error (e.g. a full disk) doesn't lose it.
+template<class Key, class Value>
+class WriteBackPool final {
+public:
+  static constexpr unsigned int MIN_RETRY_DELAY_MSEC = 10;
+  static constexpr unsigned int MAX_RETRY_DELAY_MSEC = 1000;
+
+  // writeBack is called for each value and can throw. Once it succeeded, the value is passed to onWrittenBack.
+  // If onWrittenBack isn't given, written back values are just destructed.
+  WriteBackPool(unsigned int numThreads, uint32_t maxQueueSize, std::function<void (Value &)> writeBack,
+                std::function<void (Value)> onWrittenBack = nullptr);
+  // Writes back all queued values before returning. Values that can't be written back are lost.
+  ~WriteBackPool();
+
+  // Queues the value to be written back. Blocks while the queue is full.
+  void push(const Key &key, Value value);
+
+  // If the value for the key is still queued, it is taken out of the queue and returned without being written back.
+  // If it is currently being written back, this waits until it is done and then returns none.
+  boost::optional<Value> pop(const Key &key);
+
+  // Waits until all queued values are written back.
+  // Throws if writing back a value failed while waiting. The value stays queued and is retried.
+  void flush();
+
+  // Throws if there are queued values whose last write back failed.
+  void throwIfWriteBackFailed() const;
+
+  uint32_t size() const;
+
+private:
+  void _writeBackValue(const Key &key);
+  void _writeBackFailed(const Key &key, Value value, const std::string &error);
+
+  const uint32_t _maxQueueSize;
+  std::function<void (Value &)> _writeBack;
+  std::function<void (Value)> _onWrittenBack;
+  mutable std::mutex _mutex;
+  std::condition_variable _queueChanged;
+  std::condition_variable _writtenBack;
+  QueueMap<Key, Value> _queue;
+  std::unordered_set<Key> _currentlyWritingBack;
+  // Keys of queued values whose last write back failed
+  std::unordered_set<Key> _failed;
+  uint64_t _numFailures;
+  std::string _lastError;
+  unsigned int _retryDelayMsec;
+
+  // Gets the key of each pushed value. Values that were popped in the meantime are skipped.
+  // This member has to be last, so the threads are stopped before the other members are destructed.
+  cpputils::WorkQueue<Key> _keysToWriteBack;
+
+  DISALLOW_COPY_AND_ASSIGN(WriteBackPool);
+};
+
+template<class Key, class Value> constexpr unsigned int WriteBackPool<Key, Value>::MIN_RETRY_DELAY_MSEC;
+template<class Key, class Value> constexpr unsigned int WriteBackPool<Key, Value>::MAX_RETRY_DELAY_MSEC;
+
+template<class Key, class Value>
+WriteBackPool<Key, Value>::WriteBackPool(unsigned int numThreads, uint32_t maxQueueSize, std::function<void (Value &)> writeBack,
+                                         std::function<void (Value)> onWrittenBack)
+  : _maxQueueSize(maxQueueSize), _writeBack(std::move(writeBack)), _onWrittenBack(std::move(onWrittenBack)), _mutex(),
+    _queueChanged(), _writtenBack(), _queue(), _currentlyWritingBack(), _failed(), _numFailures(0), _lastError(),
+    _retryDelayMsec(MIN_RETRY_DELAY_MSEC),
+    _keysToWriteBack(numThreads, std::bind(&WriteBackPool::_writeBackValue, this, std::placeholders::_1)) {
+  ASSERT(maxQueueSize > 0, "Queue must be able to hold at least one value");
+}
+
+template<class Key, class Value>
+WriteBackPool<Key, Value>::~WriteBackPool() {
+  try {
+    flush();
+  } catch (const std::exception &e) {
+    cpputils::logging::LOG(cpputils::logging::ERROR, "Couldn't write back {} cache entries, they're lost: {}", size(), e.what());
+  }
+}
+
+template<class Key, class Value>
+void WriteBackPool<Key, Value>::push(const Key &key, Value value) {
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _queueChanged.wait(lock, [this] {return _queue.size() < _maxQueueSize;});
+    _queue.push(key, std::move(value));
+  }
+  _keysToWriteBack.push(key);
+}
+
+template<class Key, class Value>
+boost::optional<Value> WriteBackPool<Key, Value>::pop(const Key &key) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _writtenBack.wait(lock, [this, &key] {return _currentlyWritingBack.count(key) == 0;});
+  auto found = _queue.pop(key);
+  if (found != boost::none) {
+    // The caller takes over the value, including the responsibility to write it back
+    _failed.erase(key);
+    _queueChanged.notify_all();
+    _writtenBack.notify_all();
+  }
+  return found;
+}
+
+template<class Key, class Value>
+void WriteBackPool<Key, Value>::flush() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  uint64_t numFailuresBefore = _numFailures;
+  _writtenBack.wait(lock, [this, numFailuresBefore] {
+    return (_queue.size() == 0 && _currentlyWritingBack.size() == 0) || _numFailures != numFailuresBefore;
+  });
+  if (_numFailures != numFailuresBefore) {
+    throw std::runtime_error("Writing back cache entries failed: " + _lastError);
+  }
+}
+
+template<class Key, class Value>
+void WriteBackPool<Key, Value>::throwIfWriteBackFailed() const {
+  std::unique_lock<std::mutex> lock(_mutex);
+  if (!_failed.empty()) {
+    throw std::runtime_error("Writing back cache entries failed: " + _lastError);
+  }
+}
+
+template<class Key, class Value>
+uint32_t WriteBackPool<Key, Value>::size() const {
+  std::unique_lock<std::mutex> lock(_mutex);
+  return _queue.size() + _currentlyWritingBack.size();
+}
+
+template<class Key, class Value>
+void WriteBackPool<Key, Value>::_writeBackValue(const Key &key) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  auto value = _queue.pop(key);
+  if (value == boost::none) {
+    return; // It was popped before we got to it
+  }
+  _currentlyWritingBack.insert(key);
+  _queueChanged.notify_all();
+  lock.unlock();
+
+  try {
+    _writeBack(*value);
+  } catch (const std::exception &e) {
+    _writeBackFailed(key, std::move(*value), e.what());
+    return;
+  }
+  if (_onWrittenBack != nullptr) {
+    _onWrittenBack(std::move(*value));
+  }
+  value = boost::none; // Call destructor outside of the lock
+
+  lock.lock();
+  _currentlyWritingBack.erase(key);
+  _failed.erase(key);
+  _retryDelayMsec = MIN_RETRY_DELAY_MSEC;
+  _writtenBack.notify_all();
+}
+
+template<class Key, class Value>
+void WriteBackPool<Key, Value>::_writeBackFailed(const Key &key, Value value, const std::string &error) {
+  unsigned int retryDelayMsec;
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    // Put the value back, so it is retried and loads still get the newest version instead of the stale one on disk.
+    // This can exceed _maxQueueSize by the number of threads, which is fine.
+    _queue.push(key, std::move(value));
+    _currentlyWritingBack.erase(key);
+    _failed.insert(key);
+    ++_numFailures;
+    _lastError = error;
+    retryDelayMsec = _retryDelayMsec;
+    _retryDelayMsec = std::min(2 * _retryDelayMsec, MAX_RETRY_DELAY_MSEC);
+    _queueChanged.notify_all();
+    _writtenBack.notify_all();
+  }
+
+  cpputils::logging::LOG(cpputils::logging::ERROR, "Writing back a cache entry failed, retrying in {}ms: {}", retryDelayMsec, error);
+  // Interruptible, so the threads can be stopped while they wait.
+  // Only queue the key afterwards, otherwise another thread would retry it right away.
+  boost::this_thread::sleep_for(boost::chrono::milliseconds(retryDelayMsec));
+  _keysToWriteBack.push(key);
+}
+
+}
+}
+
+#endif
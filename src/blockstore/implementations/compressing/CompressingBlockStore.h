@@ -18,9 +18,11 @@ public:
     boost::optional<cpputils::unique_ref<Block>> tryCreate(const Key &key, cpputils::Data data) override;
     boost::optional<cpputils::unique_ref<Block>> load(const Key &key) override;
     void remove(cpputils::unique_ref<Block> block) override;
+    bool remove(const Key &key) override;
     uint64_t numBlocks() const override;
     uint64_t estimateNumFreeBytes() const override;
     uint64_t blockSizeFromPhysicalBlockSize(uint64_t blockSize) const override;
+    void flush(const std::vector<Key> &keys) override;
 
 private:
     cpputils::unique_ref<BlockStore> _baseBlockStore;
@@ -68,6 +70,12 @@ void CompressingBlockStore<Compressor>::remove(cpputils::unique_ref<Block> block
     return _baseBlockStore->remove(std::move(baseBlock));
 }
 
+template<class Compressor>
+bool CompressingBlockStore<Compressor>::remove(const Key &key) {
+    // No need to decompress a block we're removing
+    return _baseBlockStore->remove(key);
+}
+
 template<class Compressor>
 uint64_t CompressingBlockStore<Compressor>::numBlocks() const {
     return _baseBlockStore->numBlocks();
@@ -85,6 +93,11 @@ uint64_t CompressingBlockStore<Compressor>::blockSizeFromPhysicalBlockSize(uint6
     return _baseBlockStore->blockSizeFromPhysicalBlockSize(blockSize);
 }
 
+template<class Compressor>
+void CompressingBlockStore<Compressor>::flush(const std::vector<Key> &keys) {
+    _baseBlockStore->flush(keys);
+}
+
 }
 }
 
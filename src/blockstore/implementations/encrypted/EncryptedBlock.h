@@ -41,6 +41,7 @@ public:
 
   const void *data() const override;
   void write(const void *source, uint64_t offset, uint64_t count) override;
+  void writeInPlace(uint64_t offset, uint64_t count, const std::function<void (void *target)> &fill) override;
   void flush() override;
 
   size_t size() const override;
@@ -59,7 +60,10 @@ private:
   void _encryptToBaseBlock();
   static cpputils::Data _prependKeyHeaderToData(const Key &key, cpputils::Data data);
   static bool _keyHeaderIsCorrect(const Key &key, const cpputils::Data &data);
-  static cpputils::Data _prependFormatHeader(const cpputils::Data &data);
+  // Allocates one buffer sized for the format header and the ciphertext and encrypts into it behind the header, so the
+  // ciphertext is never copied to prepend the header. This isn't in-place encryption: the plaintext is kept, because the
+  // block serves reads and further writes from it.
+  static cpputils::Data _encryptIntoPresizedBuffer(const cpputils::Data &plaintextWithHeader, const typename Cipher::EncryptionKey &encKey);
   static void _checkFormatHeader(const void *data);
 
   // This header is prepended to blocks to allow future versions to have compatibility.
@@ -81,10 +85,8 @@ template<class Cipher>
 boost::optional<cpputils::unique_ref<EncryptedBlock<Cipher>>> EncryptedBlock<Cipher>::TryCreateNew(BlockStore *baseBlockStore, const Key &key, cpputils::Data data, const typename Cipher::EncryptionKey &encKey) {
   //TODO Is it possible to avoid copying the whole plaintext data into plaintextWithHeader? Maybe an encrypt() object that has an .addData() function and concatenates all data for encryption? Maybe Crypto++ offers this functionality already.
   cpputils::Data plaintextWithHeader = _prependKeyHeaderToData(key, std::move(data));
-  cpputils::Data encrypted = Cipher::encrypt((CryptoPP::byte*)plaintextWithHeader.data(), plaintextWithHeader.size(), encKey);
-  //TODO Avoid copying the whole encrypted block into a encryptedWithFormatHeader by creating a Data object with full size and then giving it as an encryption target to Cipher::encrypt()
-  cpputils::Data encryptedWithFormatHeader = _prependFormatHeader(std::move(encrypted));
-  auto baseBlock = baseBlockStore->tryCreate(key, std::move(encryptedWithFormatHeader));
+  cpputils::Data encrypted = _encryptIntoPresizedBuffer(plaintextWithHeader, encKey);
+  auto baseBlock = baseBlockStore->tryCreate(key, std::move(encrypted));
   if (baseBlock == boost::none) {
     //TODO Test this code branch
     return boost::none;
@@ -94,11 +96,11 @@ boost::optional<cpputils::unique_ref<EncryptedBlock<Cipher>>> EncryptedBlock<Cip
 }
 
 template<class Cipher>
-cpputils::Data EncryptedBlock<Cipher>::_prependFormatHeader(const cpputils::Data &data) {
-  cpputils::Data dataWithHeader(sizeof(FORMAT_VERSION_HEADER) + data.size());
-  std::memcpy(dataWithHeader.dataOffset(0), &FORMAT_VERSION_HEADER, sizeof(FORMAT_VERSION_HEADER));
-  std::memcpy(dataWithHeader.dataOffset(sizeof(FORMAT_VERSION_HEADER)), data.data(), data.size());
-  return dataWithHeader;
+cpputils::Data EncryptedBlock<Cipher>::_encryptIntoPresizedBuffer(const cpputils::Data &plaintextWithHeader, const typename Cipher::EncryptionKey &encKey) {
+  cpputils::Data encrypted(sizeof(FORMAT_VERSION_HEADER) + Cipher::ciphertextSize(plaintextWithHeader.size()));
+  std::memcpy(encrypted.dataOffset(0), &FORMAT_VERSION_HEADER, sizeof(FORMAT_VERSION_HEADER));
+  Cipher::encrypt((CryptoPP::byte*)plaintextWithHeader.data(), plaintextWithHeader.size(), (CryptoPP::byte*)encrypted.dataOffset(sizeof(FORMAT_VERSION_HEADER)), encKey);
+  return encrypted;
 }
 
 template<class Cipher>
@@ -167,6 +169,13 @@ void EncryptedBlock<Cipher>::write(const void *source, uint64_t offset, uint64_t
   _dataChanged = true;
 }
 
+template<class Cipher>
+void EncryptedBlock<Cipher>::writeInPlace(uint64_t offset, uint64_t count, const std::function<void (void *target)> &fill) {
+  ASSERT(offset <= size() && offset + count <= size(), "Write outside of valid area"); //Also check offset < size() because of possible overflow in the addition
+  fill((uint8_t*)_plaintextWithHeader.data()+HEADER_LENGTH+offset);
+  _dataChanged = true;
+}
+
 template<class Cipher>
 void EncryptedBlock<Cipher>::flush() {
   std::unique_lock<std::mutex> lock(_mutex);
@@ -188,12 +197,11 @@ void EncryptedBlock<Cipher>::resize(size_t newSize) {
 template<class Cipher>
 void EncryptedBlock<Cipher>::_encryptToBaseBlock() {
   if (_dataChanged) {
-    cpputils::Data encrypted = Cipher::encrypt((CryptoPP::byte*)_plaintextWithHeader.data(), _plaintextWithHeader.size(), _encKey);
-    if (_baseBlock->size() != sizeof(FORMAT_VERSION_HEADER) + encrypted.size()) {
-      _baseBlock->resize(sizeof(FORMAT_VERSION_HEADER) + encrypted.size());
+    cpputils::Data encrypted = _encryptIntoPresizedBuffer(_plaintextWithHeader, _encKey);
+    if (_baseBlock->size() != encrypted.size()) {
+      _baseBlock->resize(encrypted.size());
     }
-    _baseBlock->write(&FORMAT_VERSION_HEADER, 0, sizeof(FORMAT_VERSION_HEADER));
-    _baseBlock->write(encrypted.data(), sizeof(FORMAT_VERSION_HEADER), encrypted.size());
+    _baseBlock->write(encrypted.data(), 0, encrypted.size());
     _dataChanged = false;
   }
 }
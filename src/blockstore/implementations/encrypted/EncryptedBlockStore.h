@@ -21,9 +21,11 @@ public:
   boost::optional<cpputils::unique_ref<Block>> tryCreate(const Key &key, cpputils::Data data) override;
   boost::optional<cpputils::unique_ref<Block>> load(const Key &key) override;
   void remove(cpputils::unique_ref<Block> block) override;
+  bool remove(const Key &key) override;
   uint64_t numBlocks() const override;
   uint64_t estimateNumFreeBytes() const override;
   uint64_t blockSizeFromPhysicalBlockSize(uint64_t blockSize) const override;
+  void flush(const std::vector<Key> &keys) override;
 
   //This function should only be used by test cases
   void __setKey(const typename Cipher::EncryptionKey &encKey);
@@ -76,6 +78,12 @@ void EncryptedBlockStore<Cipher>::remove(cpputils::unique_ref<Block> block) {
   return _baseBlockStore->remove(std::move(baseBlock));
 }
 
+template<class Cipher>
+bool EncryptedBlockStore<Cipher>::remove(const Key &key) {
+  // No need to decrypt a block we're removing
+  return _baseBlockStore->remove(key);
+}
+
 template<class Cipher>
 uint64_t EncryptedBlockStore<Cipher>::numBlocks() const {
   return _baseBlockStore->numBlocks();
@@ -96,6 +104,11 @@ uint64_t EncryptedBlockStore<Cipher>::blockSizeFromPhysicalBlockSize(uint64_t bl
   return EncryptedBlock<Cipher>::blockSizeFromPhysicalBlockSize(_baseBlockStore->blockSizeFromPhysicalBlockSize(blockSize));
 }
 
+template<class Cipher>
+void EncryptedBlockStore<Cipher>::flush(const std::vector<Key> &keys) {
+  _baseBlockStore->flush(keys);
+}
+
 }
 }
 
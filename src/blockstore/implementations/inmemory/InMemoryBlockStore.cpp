@@ -49,6 +49,10 @@ void InMemoryBlockStore::remove(unique_ref<Block> block) {
   ASSERT(1==numRemoved, "Didn't find block to remove");
 }
 
+bool InMemoryBlockStore::remove(const Key &key) {
+  return 1 == _blocks.erase(key);
+}
+
 uint64_t InMemoryBlockStore::numBlocks() const {
   return _blocks.size();
 }
@@ -0,0 +1,344 @@
+#include "BlockIndex.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <boost/filesystem.hpp>
+#include <cpp-utils/logging/logging.h>
+
+namespace bf = boost::filesystem;
+using cpputils::Data;
+using boost::optional;
+using boost::none;
+using std::string;
+using namespace cpputils::logging;
+
+namespace blockstore {
+namespace logstructured {
+
+namespace {
+const string CHECKPOINT_FILENAME = "index";
+const string JOURNAL_FILENAME_PREFIX = "index.journal.";
+const string CHECKPOINT_HEADER = "cryfs;logstructured;index;0";
+const string JOURNAL_HEADER = "cryfs;logstructured;journal;0";
+
+constexpr uint8_t JOURNAL_PUT = 1;
+constexpr uint8_t JOURNAL_REMOVE = 2;
+constexpr size_t LOCATION_SIZE = sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint32_t);
+constexpr size_t CHECKPOINT_ENTRY_SIZE = Key::BINARY_LENGTH + LOCATION_SIZE;
+
+// Entries are written and read with a moving cursor. The header strings are stored including their null byte.
+template<class T> void write(uint8_t **cursor, const T &value) {
+  std::memcpy(*cursor, &value, sizeof(T));
+  *cursor += sizeof(T);
+}
+void writeHeader(uint8_t **cursor, const string &header) {
+  std::memcpy(*cursor, header.c_str(), header.size() + 1);
+  *cursor += header.size() + 1;
+}
+void writeKey(uint8_t **cursor, const Key &key) {
+  key.ToBinary(*cursor);
+  *cursor += Key::BINARY_LENGTH;
+}
+void writeLocation(uint8_t **cursor, const BlockLocation &location) {
+  write(cursor, location.segmentId);
+  write(cursor, location.dataOffset);
+  write(cursor, location.size);
+}
+template<class T> T read(const uint8_t **cursor) {
+  T value;
+  std::memcpy(&value, *cursor, sizeof(T));
+  *cursor += sizeof(T);
+  return value;
+}
+bool readHeader(const uint8_t **cursor, const uint8_t *end, const string &header) {
+  if (static_cast<size_t>(end - *cursor) < header.size() + 1 || 0 != std::memcmp(*cursor, header.c_str(), header.size() + 1)) {
+    return false;
+  }
+  *cursor += header.size() + 1;
+  return true;
+}
+Key readKey(const uint8_t **cursor) {
+  Key key = Key::FromBinary(*cursor);
+  *cursor += Key::BINARY_LENGTH;
+  return key;
+}
+BlockLocation readLocation(const uint8_t **cursor) {
+  uint32_t segmentId = read<uint32_t>(cursor);
+  uint64_t dataOffset = read<uint64_t>(cursor);
+  uint32_t size = read<uint32_t>(cursor);
+  return BlockLocation{segmentId, dataOffset, size};
+}
+
+void syncFile(const bf::path &path) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error("Could not open " + path.native() + ": " + std::strerror(errno));
+  }
+  int result = ::fsync(fd);
+  int error = errno;
+  ::close(fd);
+  if (0 != result) {
+    throw std::runtime_error("Could not sync " + path.native() + ": " + std::strerror(error));
+  }
+}
+
+// Writes the file under a temporary name first, so a crash never leaves a half written file behind.
+void storeAtomically(const Data &data, const bf::path &path) {
+  bf::path tmpPath = path.native() + ".tmp";
+  data.StoreToFile(tmpPath);
+  syncFile(tmpPath);
+  bf::rename(tmpPath, path);
+}
+}
+
+bool operator==(const BlockLocation &lhs, const BlockLocation &rhs) {
+  return lhs.segmentId == rhs.segmentId && lhs.dataOffset == rhs.dataOffset && lhs.size == rhs.size;
+}
+
+bool operator!=(const BlockLocation &lhs, const BlockLocation &rhs) {
+  return !operator==(lhs, rhs);
+}
+
+constexpr uint64_t BlockIndex::MIN_JOURNAL_ENTRIES_FOR_CHECKPOINT;
+
+BlockIndex::BlockIndex(const bf::path &rootdir)
+  : _rootdir(rootdir), _checkpointPath(rootdir / CHECKPOINT_FILENAME), _entries(), _generation(0), _journalFd(-1),
+    _numJournalEntries(0) {
+  if (!bf::exists(_checkpointPath)) {
+    checkpoint();
+    return;
+  }
+  _loadCheckpoint();
+  _removeJournalsBefore(_generation);
+  uint64_t checkpointGeneration = _generation;
+  uint64_t numReplayed = _replayJournal(_generation);
+  // If we crashed while a checkpoint was written, the changes after it are in the journal of the next generation
+  while (bf::exists(_journalPath(_generation + 1))) {
+    ++_generation;
+    numReplayed += _replayJournal(_generation);
+  }
+  if (numReplayed > 0 || _generation != checkpointGeneration) {
+    // Fold the replayed changes into a new checkpoint. This also removes an incomplete entry at the end of the journal.
+    checkpoint();
+  } else {
+    _openJournal();
+  }
+}
+
+BlockIndex::~BlockIndex() {
+  if (_journalFd >= 0) {
+    ::close(_journalFd);
+  }
+}
+
+bool BlockIndex::existsIn(const bf::path &rootdir) {
+  return bf::exists(rootdir / CHECKPOINT_FILENAME);
+}
+
+optional<BlockLocation> BlockIndex::find(const Key &key) const {
+  auto found = _entries.find(key);
+  if (found == _entries.end()) {
+    return none;
+  }
+  return found->second;
+}
+
+void BlockIndex::put(const Key &key, const BlockLocation &location) {
+  Data entry(1 + Key::BINARY_LENGTH + LOCATION_SIZE);
+  uint8_t *cursor = static_cast<uint8_t*>(entry.data());
+  write(&cursor, JOURNAL_PUT);
+  writeKey(&cursor, key);
+  writeLocation(&cursor, location);
+  _appendToJournal(entry);
+  _entries[key] = location;
+}
+
+optional<BlockLocation> BlockIndex::remove(const Key &key) {
+  auto found = _entries.find(key);
+  if (found == _entries.end()) {
+    return none;
+  }
+  Data entry(1 + Key::BINARY_LENGTH);
+  uint8_t *cursor = static_cast<uint8_t*>(entry.data());
+  write(&cursor, JOURNAL_REMOVE);
+  writeKey(&cursor, key);
+  _appendToJournal(entry);
+  BlockLocation location = found->second;
+  _entries.erase(found);
+  return location;
+}
+
+uint64_t BlockIndex::size() const {
+  return _entries.size();
+}
+
+const std::unordered_map<Key, BlockLocation> &BlockIndex::entries() const {
+  return _entries;
+}
+
+bool BlockIndex::checkpointIsDue() const {
+  return _numJournalEntries > std::max<uint64_t>(MIN_JOURNAL_ENTRIES_FOR_CHECKPOINT, _entries.size());
+}
+
+void BlockIndex::checkpoint() {
+  writeCheckpoint(startCheckpoint());
+}
+
+BlockIndex::Snapshot BlockIndex::startCheckpoint() {
+  ++_generation;
+  Data data = _serializeCheckpoint();
+  _createJournal();
+  return Snapshot{_generation, std::move(data)};
+}
+
+void BlockIndex::writeCheckpoint(const Snapshot &snapshot) const {
+  // The new journal has to be on disk before the checkpoint that refers to it
+  syncFile(_journalPath(snapshot.generation));
+  storeAtomically(snapshot.data, _checkpointPath);
+  // The old journal belongs to the previous generation and is ignored from now on, so it doesn't matter if we crash
+  // before it is deleted.
+  bf::remove(_journalPath(snapshot.generation - 1));
+}
+
+void BlockIndex::sync() {
+  if (0 != ::fsync(_journalFd)) {
+    throw std::runtime_error("Could not sync " + _journalPath(_generation).native() + ": " + std::strerror(errno));
+  }
+}
+
+bf::path BlockIndex::_journalPath(uint64_t generation) const {
+  return _rootdir / (JOURNAL_FILENAME_PREFIX + std::to_string(generation));
+}
+
+Data BlockIndex::_serializeCheckpoint() const {
+  Data result(CHECKPOINT_HEADER.size() + 1 + 2 * sizeof(uint64_t) + _entries.size() * CHECKPOINT_ENTRY_SIZE);
+  uint8_t *cursor = static_cast<uint8_t*>(result.data());
+  writeHeader(&cursor, CHECKPOINT_HEADER);
+  write(&cursor, _generation);
+  write(&cursor, static_cast<uint64_t>(_entries.size()));
+  for (const auto &entry : _entries) {
+    writeKey(&cursor, entry.first);
+    writeLocation(&cursor, entry.second);
+  }
+  return result;
+}
+
+void BlockIndex::_loadCheckpoint() {
+  auto data = Data::LoadFromFile(_checkpointPath);
+  if (data == none) {
+    throw std::runtime_error("Could not read block index " + _checkpointPath.native());
+  }
+  const uint8_t *cursor = static_cast<const uint8_t*>(data->data());
+  const uint8_t *end = cursor + data->size();
+  if (!readHeader(&cursor, end, CHECKPOINT_HEADER) || static_cast<size_t>(end - cursor) < 2 * sizeof(uint64_t)) {
+    throw std::runtime_error("This is not a valid block index: " + _checkpointPath.native() + ". Maybe it was created with a newer version of CryFS?");
+  }
+  _generation = read<uint64_t>(&cursor);
+  uint64_t numEntries = read<uint64_t>(&cursor);
+  if (static_cast<uint64_t>(end - cursor) != numEntries * CHECKPOINT_ENTRY_SIZE) {
+    throw std::runtime_error("Block index " + _checkpointPath.native() + " is corrupted");
+  }
+  _entries.reserve(numEntries);
+  for (uint64_t i = 0; i < numEntries; ++i) {
+    Key key = readKey(&cursor);
+    _entries.emplace(key, readLocation(&cursor));
+  }
+}
+
+uint64_t BlockIndex::_replayJournal(uint64_t generation) {
+  bf::path journalPath = _journalPath(generation);
+  auto data = Data::LoadFromFile(journalPath);
+  if (data == none) {
+    return 0;
+  }
+  const uint8_t *cursor = static_cast<const uint8_t*>(data->data());
+  const uint8_t *end = cursor + data->size();
+  if (!readHeader(&cursor, end, JOURNAL_HEADER) || static_cast<size_t>(end - cursor) < sizeof(uint64_t)) {
+    LOG(WARN, "Ignoring invalid journal {}", journalPath.native());
+    return 0;
+  }
+  if (read<uint64_t>(&cursor) != generation) {
+    LOG(WARN, "Ignoring journal {}, which belongs to a different generation", journalPath.native());
+    return 0;
+  }
+  uint64_t numReplayed = 0;
+  while (end - cursor >= static_cast<ptrdiff_t>(1 + Key::BINARY_LENGTH)) {
+    uint8_t type = read<uint8_t>(&cursor);
+    Key key = readKey(&cursor);
+    if (type == JOURNAL_PUT) {
+      if (static_cast<size_t>(end - cursor) < LOCATION_SIZE) {
+        break;
+      }
+      _entries[key] = readLocation(&cursor);
+    } else if (type == JOURNAL_REMOVE) {
+      _entries.erase(key);
+    } else {
+      LOG(WARN, "Journal {} has an invalid entry. Ignoring the rest of the journal.", journalPath.native());
+      break;
+    }
+    ++numReplayed;
+  }
+  return numReplayed;
+}
+
+void BlockIndex::_removeJournalsBefore(uint64_t generation) const {
+  for (auto entry = bf::directory_iterator(_rootdir); entry != bf::directory_iterator(); ++entry) {
+    string filename = entry->path().filename().native();
+    if (0 != filename.compare(0, JOURNAL_FILENAME_PREFIX.size(), JOURNAL_FILENAME_PREFIX)) {
+      continue;
+    }
+    string journalGeneration = filename.substr(JOURNAL_FILENAME_PREFIX.size());
+    if (!journalGeneration.empty() && journalGeneration.find_first_not_of("0123456789") == string::npos
+        && journalGeneration.size() <= 19 && std::stoull(journalGeneration) < generation) {
+      bf::remove(entry->path());
+    }
+  }
+}
+
+void BlockIndex::_createJournal() {
+  // Not synced here, because this is called while the index is locked. writeCheckpoint() syncs it.
+  if (_journalFd >= 0) {
+    ::close(_journalFd);
+  }
+  _journalFd = ::open(_journalPath(_generation).c_str(), O_WRONLY | O_APPEND | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+  if (_journalFd < 0) {
+    throw std::runtime_error("Could not create " + _journalPath(_generation).native() + ": " + std::strerror(errno));
+  }
+  Data header(JOURNAL_HEADER.size() + 1 + sizeof(uint64_t));
+  uint8_t *cursor = static_cast<uint8_t*>(header.data());
+  writeHeader(&cursor, JOURNAL_HEADER);
+  write(&cursor, _generation);
+  _appendToJournal(header);
+  _numJournalEntries = 0;
+}
+
+void BlockIndex::_openJournal() {
+  if (_journalFd >= 0) {
+    ::close(_journalFd);
+  }
+  _journalFd = ::open(_journalPath(_generation).c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+  if (_journalFd < 0) {
+    throw std::runtime_error("Could not open " + _journalPath(_generation).native() + ": " + std::strerror(errno));
+  }
+}
+
+void BlockIndex::_appendToJournal(const Data &entry) {
+  const uint8_t *source = static_cast<const uint8_t*>(entry.data());
+  size_t count = entry.size();
+  while (count > 0) {
+    ssize_t written = ::write(_journalFd, source, count);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error("Could not write to " + _journalPath(_generation).native() + ": " + std::strerror(errno));
+    }
+    source += written;
+    count -= written;
+  }
+  ++_numJournalEntries;
+}
+
+}
+}
@@ -0,0 +1,92 @@
+#pragma once
+#ifndef MESSMER_BLOCKSTORE_IMPLEMENTATIONS_LOGSTRUCTURED_BLOCKINDEX_H_
+#define MESSMER_BLOCKSTORE_IMPLEMENTATIONS_LOGSTRUCTURED_BLOCKINDEX_H_
+
+#include <unordered_map>
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+#include <cpp-utils/data/Data.h>
+#include <cpp-utils/macros.h>
+#include "../../utils/Key.h"
+
+namespace blockstore {
+namespace logstructured {
+
+struct BlockLocation final {
+  uint32_t segmentId;
+  uint64_t dataOffset;
+  uint32_t size;
+};
+
+bool operator==(const BlockLocation &lhs, const BlockLocation &rhs);
+bool operator!=(const BlockLocation &lhs, const BlockLocation &rhs);
+
+// Maps block keys to the place in the segments where the current version of the block is stored.
+// The index is kept in memory. On disk, there is a checkpoint of the whole index and a journal with the changes since
+// that checkpoint. Each change is appended to the journal, and when the journal gets large, a new checkpoint is written.
+// Each checkpoint starts a journal of its own. While a checkpoint is written, changes already go to its journal, and
+// until the checkpoint is complete, the old checkpoint and both journals are needed to restore the index.
+// This class isn't thread safe, except for writeCheckpoint().
+class BlockIndex final {
+public:
+  // Journals with less entries than this are never checkpointed. Otherwise, they're checkpointed once they have more
+  // entries than the index, so rewriting the index costs a constant amount per change.
+  static constexpr uint64_t MIN_JOURNAL_ENTRIES_FOR_CHECKPOINT = 100000;
+
+  // Loads the index from the given directory, or creates an empty index if there is none.
+  explicit BlockIndex(const boost::filesystem::path &rootdir);
+  ~BlockIndex();
+
+  static bool existsIn(const boost::filesystem::path &rootdir);
+
+  boost::optional<BlockLocation> find(const Key &key) const;
+  void put(const Key &key, const BlockLocation &location);
+  boost::optional<BlockLocation> remove(const Key &key);
+  uint64_t size() const;
+  const std::unordered_map<Key, BlockLocation> &entries() const;
+
+  // A copy of the index taken by startCheckpoint(), which is stored on disk by writeCheckpoint()
+  struct Snapshot final {
+    uint64_t generation;
+    cpputils::Data data;
+  };
+
+  // Writes the whole index to disk and starts a new journal
+  void checkpoint();
+  // Does the same as checkpoint() in two steps, so that writing the checkpoint doesn't block changes to the index.
+  // startCheckpoint() copies the index and starts the journal for the changes after the copy.
+  Snapshot startCheckpoint();
+  // Stores the copy as the new checkpoint and deletes the journal it replaces. This doesn't access the index, so it can
+  // run in parallel to the other functions, but the snapshots have to be written one at a time and in order.
+  void writeCheckpoint(const Snapshot &snapshot) const;
+  bool checkpointIsDue() const;
+  // Makes sure that all changes are persisted on disk
+  void sync();
+
+private:
+  void _loadCheckpoint();
+  // Returns the number of changes that were applied from the journal
+  uint64_t _replayJournal(uint64_t generation);
+  // Deletes journals that are left over from checkpoints older than the given generation
+  void _removeJournalsBefore(uint64_t generation) const;
+  void _appendToJournal(const cpputils::Data &entry);
+  void _createJournal();
+  void _openJournal();
+  cpputils::Data _serializeCheckpoint() const;
+  boost::filesystem::path _journalPath(uint64_t generation) const;
+
+  const boost::filesystem::path _rootdir;
+  const boost::filesystem::path _checkpointPath;
+  std::unordered_map<Key, BlockLocation> _entries;
+  // Each checkpoint gets a new generation number. A journal is only valid for the checkpoint with the same generation.
+  uint64_t _generation;
+  int _journalFd;
+  uint64_t _numJournalEntries;
+
+  DISALLOW_COPY_AND_ASSIGN(BlockIndex);
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,47 @@
+#include "LogStructuredBlock.h"
+#include "LogStructuredBlockStore.h"
+#include <cpp-utils/assert/assert.h>
+#include <cpp-utils/data/DataUtils.h>
+
+using cpputils::Data;
+
+namespace blockstore {
+namespace logstructured {
+
+LogStructuredBlock::LogStructuredBlock(LogStructuredBlockStore *store, const Key &key, Data data)
+ : Block(key), _store(store), _data(std::move(data)), _dataChanged(false), _mutex() {
+}
+
+LogStructuredBlock::~LogStructuredBlock() {
+  flush();
+}
+
+const void *LogStructuredBlock::data() const {
+  return _data.data();
+}
+
+void LogStructuredBlock::write(const void *source, uint64_t offset, uint64_t size) {
+  ASSERT(offset <= _data.size() && offset + size <= _data.size(), "Write outside of valid area"); //Also check offset < _data->size() because of possible overflow in the addition
+  std::memcpy(_data.dataOffset(offset), source, size);
+  _dataChanged = true;
+}
+
+size_t LogStructuredBlock::size() const {
+  return _data.size();
+}
+
+void LogStructuredBlock::resize(size_t newSize) {
+  _data = cpputils::DataUtils::resize(std::move(_data), newSize);
+  _dataChanged = true;
+}
+
+void LogStructuredBlock::flush() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  if (_dataChanged) {
+    _store->_store(key(), _data);
+    _dataChanged = false;
+  }
+}
+
+}
+}
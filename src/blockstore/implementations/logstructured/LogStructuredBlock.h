@@ -0,0 +1,39 @@
+#pragma once
+#ifndef MESSMER_BLOCKSTORE_IMPLEMENTATIONS_LOGSTRUCTURED_LOGSTRUCTUREDBLOCK_H_
+#define MESSMER_BLOCKSTORE_IMPLEMENTATIONS_LOGSTRUCTURED_LOGSTRUCTUREDBLOCK_H_
+
+#include "../../interface/Block.h"
+#include <cpp-utils/data/Data.h>
+#include <cpp-utils/macros.h>
+#include <mutex>
+
+namespace blockstore {
+namespace logstructured {
+class LogStructuredBlockStore;
+
+class LogStructuredBlock final: public Block {
+public:
+  LogStructuredBlock(LogStructuredBlockStore *store, const Key &key, cpputils::Data data);
+  ~LogStructuredBlock();
+
+  const void *data() const override;
+  void write(const void *source, uint64_t offset, uint64_t size) override;
+
+  void flush() override;
+
+  size_t size() const override;
+  void resize(size_t newSize) override;
+
+private:
+  LogStructuredBlockStore *_store;
+  cpputils::Data _data;
+  bool _dataChanged;
+  std::mutex _mutex;
+
+  DISALLOW_COPY_AND_ASSIGN(LogStructuredBlock);
+};
+
+}
+}
+
+#endif
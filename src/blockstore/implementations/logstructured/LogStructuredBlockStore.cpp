@@ -0,0 +1,360 @@
+#include "LogStructuredBlockStore.h"
+#include "LogStructuredBlock.h"
+#include <sys/statvfs.h>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <cpp-utils/assert/assert.h>
+#include <cpp-utils/logging/logging.h>
+
+namespace bf = boost::filesystem;
+using cpputils::Data;
+using cpputils::unique_ref;
+using cpputils::make_unique_ref;
+using boost::optional;
+using boost::none;
+using std::string;
+using std::shared_ptr;
+using namespace cpputils::logging;
+
+namespace blockstore {
+namespace logstructured {
+
+namespace {
+const string SEGMENT_FILENAME_PREFIX = "segment-";
+
+optional<uint32_t> parseSegmentFilename(const string &filename) {
+  if (filename.size() <= SEGMENT_FILENAME_PREFIX.size() || 0 != filename.compare(0, SEGMENT_FILENAME_PREFIX.size(), SEGMENT_FILENAME_PREFIX)) {
+    return none;
+  }
+  string id = filename.substr(SEGMENT_FILENAME_PREFIX.size());
+  if (id.find_first_not_of("0123456789") != string::npos || id.size() > 9) {
+    return none;
+  }
+  return static_cast<uint32_t>(std::stoul(id));
+}
+
+uint64_t recordSize(const BlockLocation &location) {
+  return Segment::RECORD_HEADER_SIZE + location.size;
+}
+}
+
+constexpr uint64_t LogStructuredBlockStore::DEFAULT_SEGMENT_SIZE;
+constexpr double LogStructuredBlockStore::COMPACTION_THRESHOLD;
+
+LogStructuredBlockStore::LogStructuredBlockStore(const bf::path &rootdir, uint64_t segmentSize)
+ : _rootdir(rootdir), _segmentSize(segmentSize), _mutex(), _compactionMutex(),
+   _index(_checkRootdir(rootdir)), _segments(), _activeSegment(nullptr),
+   _compactionRequests(1, std::bind(&LogStructuredBlockStore::_compact, this, std::placeholders::_1), 1) {
+  {
+    // The compaction thread already runs and must not see the segments before they're loaded
+    boost::unique_lock<boost::mutex> lock(_mutex);
+    _loadSegments();
+  }
+  _compactionRequests.push(CompactionRequest{});
+}
+
+LogStructuredBlockStore::~LogStructuredBlockStore() {
+  _compactionRequests.stop();
+  boost::unique_lock<boost::mutex> lock(_mutex);
+  try {
+    _activeSegment->sync();
+    _index.checkpoint();
+  } catch (const std::exception &e) {
+    LOG(ERROR, "Couldn't write block index: {}", e.what());
+  }
+}
+
+const bf::path &LogStructuredBlockStore::_checkRootdir(const bf::path &rootdir) {
+  if (!bf::exists(rootdir)) {
+    throw std::runtime_error("Base directory not found");
+  }
+  if (!bf::is_directory(rootdir)) {
+    throw std::runtime_error("Base directory is not a directory");
+  }
+  if (!BlockIndex::existsIn(rootdir)) {
+    for (auto entry = bf::directory_iterator(rootdir); entry != bf::directory_iterator(); ++entry) {
+      if (parseSegmentFilename(entry->path().filename().native()) != none) {
+        throw std::runtime_error("Base directory contains segments, but no block index");
+      }
+    }
+  }
+  return rootdir;
+}
+
+void LogStructuredBlockStore::_loadSegments() {
+  for (auto entry = bf::directory_iterator(_rootdir); entry != bf::directory_iterator(); ++entry) {
+    auto segmentId = parseSegmentFilename(entry->path().filename().native());
+    if (segmentId != none) {
+      _segments.emplace(*segmentId, SegmentInfo{cpputils::to_unique_ptr(Segment::Open(entry->path(), *segmentId)), 0, false});
+    }
+  }
+  // Segments are synced before the next one is started, so only the last one can have lost writes in a crash.
+  if (!_segments.empty()) {
+    _segments.rbegin()->second.segment->truncateInvalidTail();
+  }
+
+  std::vector<Key> lostBlocks;
+  for (const auto &entry : _index.entries()) {
+    auto found = _segments.find(entry.second.segmentId);
+    if (found == _segments.end()) {
+      throw std::runtime_error("Block " + entry.first.ToString() + " is stored in segment " + std::to_string(entry.second.segmentId) + ", which doesn't exist");
+    }
+    if (entry.second.dataOffset + entry.second.size > found->second.segment->size()) {
+      // The index entry reached the disk, but the record it points to didn't
+      lostBlocks.push_back(entry.first);
+      continue;
+    }
+    found->second.liveBytes += recordSize(entry.second);
+  }
+  for (const Key &key : lostBlocks) {
+    LOG(ERROR, "Block {} wasn't completely written to its segment before a crash. Removing it.", key.ToString());
+    _index.remove(key);
+  }
+
+  if (_segments.empty() || _segments.rbegin()->second.segment->size() >= _segmentSize) {
+    _startNewSegmentLocked();
+  } else {
+    _activeSegment = _segments.rbegin()->second.segment;
+    _activeSegment->openForAppending();
+  }
+}
+
+bf::path LogStructuredBlockStore::_segmentPath(uint32_t segmentId) const {
+  return _rootdir / (SEGMENT_FILENAME_PREFIX + std::to_string(segmentId));
+}
+
+optional<unique_ref<Block>> LogStructuredBlockStore::tryCreate(const Key &key, Data data) {
+  {
+    boost::unique_lock<boost::mutex> lock(_mutex);
+    if (_index.find(key) != none) {
+      return none;
+    }
+    _index.put(key, _appendLocked(key, data));
+    _requestCheckpointIfDueLocked();
+  }
+  return unique_ref<Block>(make_unique_ref<LogStructuredBlock>(this, key, std::move(data)));
+}
+
+optional<unique_ref<Block>> LogStructuredBlockStore::load(const Key &key) {
+  boost::unique_lock<boost::mutex> lock(_mutex);
+  auto location = _index.find(key);
+  if (location == none) {
+    return none;
+  }
+  // Holding on to the segment keeps its file from being deleted, even if the segment is compacted while we read from it.
+  shared_ptr<Segment> segment = _segments.at(location->segmentId).segment;
+  lock.unlock();
+
+  Data data = segment->read(location->dataOffset, location->size);
+  return optional<unique_ref<Block>>(make_unique_ref<LogStructuredBlock>(this, key, std::move(data)));
+}
+
+void LogStructuredBlockStore::_store(const Key &key, const Data &data) {
+  boost::unique_lock<boost::mutex> lock(_mutex);
+  auto oldLocation = _index.find(key);
+  _index.put(key, _appendLocked(key, data));
+  if (oldLocation != none) {
+    _markDeadLocked(*oldLocation);
+  }
+  _requestCheckpointIfDueLocked();
+}
+
+void LogStructuredBlockStore::remove(unique_ref<Block> block) {
+  Key key = block->key();
+  cpputils::destruct(std::move(block));
+  bool removed = remove(key);
+  ASSERT(removed, "Block not found in index");
+}
+
+bool LogStructuredBlockStore::remove(const Key &key) {
+  boost::unique_lock<boost::mutex> lock(_mutex);
+  auto location = _index.remove(key);
+  if (location == none) {
+    return false;
+  }
+  _markDeadLocked(*location);
+  _requestCheckpointIfDueLocked();
+  return true;
+}
+
+uint64_t LogStructuredBlockStore::numBlocks() const {
+  boost::unique_lock<boost::mutex> lock(_mutex);
+  return _index.size();
+}
+
+uint64_t LogStructuredBlockStore::estimateNumFreeBytes() const {
+  struct statvfs stat;
+  ::statvfs(_rootdir.c_str(), &stat);
+  return stat.f_bsize*stat.f_bavail;
+}
+
+uint64_t LogStructuredBlockStore::blockSizeFromPhysicalBlockSize(uint64_t blockSize) const {
+  if (blockSize <= Segment::RECORD_HEADER_SIZE) {
+    return 0;
+  }
+  return blockSize - Segment::RECORD_HEADER_SIZE;
+}
+
+uint32_t LogStructuredBlockStore::numSegments() const {
+  boost::unique_lock<boost::mutex> lock(_mutex);
+  return _segments.size();
+}
+
+BlockLocation LogStructuredBlockStore::_appendLocked(const Key &key, const Data &data) {
+  // A block that is larger than a whole segment gets a segment of its own
+  bool activeSegmentIsEmpty = _activeSegment->size() <= Segment::formatVersionHeaderSize();
+  if (!activeSegmentIsEmpty && _activeSegment->size() + Segment::RECORD_HEADER_SIZE + data.size() > _segmentSize) {
+    _startNewSegmentLocked();
+  }
+  auto record = _activeSegment->append(key, data);
+  BlockLocation location{_activeSegment->id(), record.dataOffset, record.size};
+  _segments.at(location.segmentId).liveBytes += recordSize(location);
+  return location;
+}
+
+void LogStructuredBlockStore::_startNewSegmentLocked() {
+  if (_activeSegment != nullptr) {
+    _activeSegment->seal();
+  }
+  uint32_t segmentId = _segments.empty() ? 0 : _segments.rbegin()->first + 1;
+  _activeSegment = cpputils::to_unique_ptr(Segment::Create(_segmentPath(segmentId), segmentId));
+  _segments.emplace(segmentId, SegmentInfo{_activeSegment, 0, false});
+  // The previous segment might have been waiting to become inactive
+  _compactionRequests.push(CompactionRequest{});
+}
+
+void LogStructuredBlockStore::_markDeadLocked(const BlockLocation &location) {
+  auto &info = _segments.at(location.segmentId);
+  ASSERT(info.liveBytes >= recordSize(location), "Live bytes of segment got out of sync");
+  info.liveBytes -= recordSize(location);
+  if (_needsCompactionLocked(info)) {
+    _compactionRequests.push(CompactionRequest{});
+  }
+}
+
+bool LogStructuredBlockStore::_needsCompactionLocked(const SegmentInfo &info) const {
+  if (info.segment == _activeSegment || info.skipCompaction) {
+    return false;
+  }
+  uint64_t usableSize = info.segment->size() - Segment::formatVersionHeaderSize();
+  return info.liveBytes < COMPACTION_THRESHOLD * usableSize || info.liveBytes == 0;
+}
+
+shared_ptr<Segment> LogStructuredBlockStore::_findSegmentToCompactLocked() const {
+  const SegmentInfo *result = nullptr;
+  for (const auto &entry : _segments) {
+    if (_needsCompactionLocked(entry.second) && (result == nullptr || entry.second.liveBytes < result->liveBytes)) {
+      result = &entry.second;
+    }
+  }
+  if (result == nullptr) {
+    return nullptr;
+  }
+  return result->segment;
+}
+
+bool LogStructuredBlockStore::compactNextSegment() {
+  boost::unique_lock<boost::mutex> compactionLock(_compactionMutex);
+  shared_ptr<Segment> segment;
+  {
+    boost::unique_lock<boost::mutex> lock(_mutex);
+    segment = _findSegmentToCompactLocked();
+  }
+  if (segment == nullptr) {
+    return false;
+  }
+  try {
+    return _compactSegment(segment);
+  } catch (const std::exception &e) {
+    LOG(ERROR, "Compacting segment {} failed: {}", segment->path().native(), e.what());
+    boost::unique_lock<boost::mutex> lock(_mutex);
+    _segments.at(segment->id()).skipCompaction = true;
+    return false;
+  }
+}
+
+bool LogStructuredBlockStore::_compactSegment(const shared_ptr<Segment> &segment) {
+  std::map<uint32_t, shared_ptr<Segment>> targetSegments;
+  uint64_t recordOffset = Segment::formatVersionHeaderSize();
+  for (auto record = segment->readRecordHeader(recordOffset); record != none; record = segment->readRecordHeader(recordOffset)) {
+    recordOffset = record->dataOffset + record->size;
+    BlockLocation oldLocation{segment->id(), record->dataOffset, record->size};
+    {
+      boost::unique_lock<boost::mutex> lock(_mutex);
+      if (_index.find(record->key) != oldLocation) {
+        continue; // This version of the block is dead
+      }
+    }
+    Data data = segment->read(record->dataOffset, record->size);
+    boost::unique_lock<boost::mutex> lock(_mutex);
+    if (_index.find(record->key) != oldLocation) {
+      continue; // The block was written or removed while we read it
+    }
+    BlockLocation newLocation = _appendLocked(record->key, data);
+    _index.put(record->key, newLocation);
+    _markDeadLocked(oldLocation);
+    targetSegments[newLocation.segmentId] = _activeSegment;
+  }
+
+  // The moved blocks and the index entries pointing to them have to be on disk before we delete the old segment.
+  // Sync under the lock, because the active segment could be sealed (and its file closed) concurrently.
+  boost::unique_lock<boost::mutex> lock(_mutex);
+  for (const auto &target : targetSegments) {
+    target.second->sync();
+  }
+  _index.sync();
+  auto &info = _segments.at(segment->id());
+  if (info.liveBytes != 0) {
+    LOG(ERROR, "Segment {} still has {} live bytes after compaction. Not deleting it.", segment->path().native(), info.liveBytes);
+    info.skipCompaction = true;
+    return false;
+  }
+  _segments.erase(segment->id());
+  segment->removeWhenUnused();
+  _requestCheckpointIfDueLocked();
+  return true;
+}
+
+void LogStructuredBlockStore::_requestCheckpointIfDueLocked() {
+  if (_index.checkpointIsDue()) {
+    _compactionRequests.push(CompactionRequest{});
+  }
+}
+
+void LogStructuredBlockStore::_checkpointIfDue() {
+  shared_ptr<Segment> activeSegment;
+  optional<BlockIndex::Snapshot> snapshot = none;
+  {
+    boost::unique_lock<boost::mutex> lock(_mutex);
+    if (!_index.checkpointIsDue()) {
+      return;
+    }
+    activeSegment = _activeSegment;
+    snapshot = _index.startCheckpoint();
+  }
+  try {
+    // The checkpoint has to point to records that are on disk. Older segments were synced when they were sealed.
+    activeSegment->syncConcurrently();
+    _index.writeCheckpoint(*snapshot);
+  } catch (const std::exception &e) {
+    // The old checkpoint and the journals still have all changes, so we go on and write them with the next checkpoint
+    LOG(ERROR, "Couldn't write block index: {}", e.what());
+  }
+}
+
+void LogStructuredBlockStore::_compact(CompactionRequest) {
+  while (true) {
+    _checkpointIfDue();
+    {
+      boost::unique_lock<boost::mutex> lock(_mutex);
+      if (_findSegmentToCompactLocked() == nullptr) {
+        return;
+      }
+    }
+    // If this fails, the segment is skipped from now on and the next one is compacted
+    compactNextSegment();
+  }
+}
+
+}
+}
@@ -0,0 +1,95 @@
+#pragma once
+#ifndef MESSMER_BLOCKSTORE_IMPLEMENTATIONS_LOGSTRUCTURED_LOGSTRUCTUREDBLOCKSTORE_H_
+#define MESSMER_BLOCKSTORE_IMPLEMENTATIONS_LOGSTRUCTURED_LOGSTRUCTUREDBLOCKSTORE_H_
+
+#include <map>
+#include <memory>
+#include <boost/filesystem/path.hpp>
+#include <boost/thread.hpp>
+#include "../../interface/helpers/BlockStoreWithRandomKeys.h"
+#include <cpp-utils/macros.h>
+#include <cpp-utils/thread/WorkQueue.h>
+#include "Segment.h"
+#include "BlockIndex.h"
+
+namespace blockstore {
+namespace logstructured {
+
+// Stores blocks in a few large segment files instead of one file per block. Writing a block appends it to the current
+// segment and points the block index to the new version, so small writes don't need to create or rewrite a file.
+// Old versions of a block stay in their segment until a background thread compacts the segment, i.e. moves the blocks
+// that are still live to the current segment and deletes the old segment file.
+// Appends and index changes are serialized by one mutex. They're sequential writes to the same file anyway.
+// Reads only hold the mutex to look up the block location, so they run in parallel.
+// Checkpoints of the block index are written by the background thread as well. It only holds the mutex while copying
+// the index, so writes don't wait for the checkpoint to reach the disk.
+class LogStructuredBlockStore final: public BlockStoreWithRandomKeys {
+public:
+  static constexpr uint64_t DEFAULT_SEGMENT_SIZE = 64 * 1024 * 1024;
+  // Segments are compacted once less than this fraction of them is used by live blocks
+  static constexpr double COMPACTION_THRESHOLD = 0.5;
+
+  explicit LogStructuredBlockStore(const boost::filesystem::path &rootdir, uint64_t segmentSize = DEFAULT_SEGMENT_SIZE);
+  ~LogStructuredBlockStore();
+
+  boost::optional<cpputils::unique_ref<Block>> tryCreate(const Key &key, cpputils::Data data) override;
+  boost::optional<cpputils::unique_ref<Block>> load(const Key &key) override;
+  void remove(cpputils::unique_ref<Block> block) override;
+  bool remove(const Key &key) override;
+  uint64_t numBlocks() const override;
+  uint64_t estimateNumFreeBytes() const override;
+  uint64_t blockSizeFromPhysicalBlockSize(uint64_t blockSize) const override;
+
+  // Compacts the segment with the least live data, if there is one below COMPACTION_THRESHOLD.
+  // This is usually done by the background thread, but can be called to compact segments right away.
+  // Returns true if a segment was compacted.
+  bool compactNextSegment();
+  uint32_t numSegments() const;
+
+private:
+  struct SegmentInfo final {
+    std::shared_ptr<Segment> segment;
+    uint64_t liveBytes;
+    // Set if compaction didn't free the segment, so we don't try it again and again
+    bool skipCompaction;
+  };
+  struct CompactionRequest final {
+  };
+
+  friend class LogStructuredBlock;
+  void _store(const Key &key, const cpputils::Data &data);
+
+  static const boost::filesystem::path &_checkRootdir(const boost::filesystem::path &rootdir);
+  void _loadSegments();
+  boost::filesystem::path _segmentPath(uint32_t segmentId) const;
+  BlockLocation _appendLocked(const Key &key, const cpputils::Data &data);
+  void _startNewSegmentLocked();
+  void _markDeadLocked(const BlockLocation &location);
+  bool _needsCompactionLocked(const SegmentInfo &info) const;
+  std::shared_ptr<Segment> _findSegmentToCompactLocked() const;
+  bool _compactSegment(const std::shared_ptr<Segment> &segment);
+  void _requestCheckpointIfDueLocked();
+  void _checkpointIfDue();
+  void _compact(CompactionRequest);
+
+  const boost::filesystem::path _rootdir;
+  const uint64_t _segmentSize;
+  mutable boost::mutex _mutex;
+  // Only one segment is compacted at a time
+  boost::mutex _compactionMutex;
+  BlockIndex _index;
+  std::map<uint32_t, SegmentInfo> _segments;
+  std::shared_ptr<Segment> _activeSegment;
+
+  // Holds at most one request, because a compaction compacts all segments that need it and writes a checkpoint of the
+  // index if one is due.
+  // This member has to be last, so the thread is stopped before the other members are destructed.
+  cpputils::WorkQueue<CompactionRequest> _compactionRequests;
+
+  DISALLOW_COPY_AND_ASSIGN(LogStructuredBlockStore);
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,257 @@
+#include "Segment.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <limits>
+#include <cstring>
+#include <boost/crc.hpp>
+#include <boost/filesystem.hpp>
+#include <cpp-utils/assert/assert.h>
+#include <cpp-utils/logging/logging.h>
+
+namespace bf = boost::filesystem;
+using cpputils::Data;
+using cpputils::unique_ref;
+using cpputils::make_unique_ref;
+using boost::optional;
+using boost::none;
+using std::string;
+using namespace cpputils::logging;
+
+namespace blockstore {
+namespace logstructured {
+
+// A file descriptor that is closed when it goes out of scope
+class Segment::File final {
+public:
+  File(const bf::path &path, int flags): _fd(::open(path.c_str(), flags | O_CLOEXEC)) {
+    if (_fd < 0) {
+      throw std::runtime_error("Could not open segment " + path.native() + ": " + std::strerror(errno));
+    }
+  }
+  ~File() {
+    ::close(_fd);
+  }
+  int fd() const {
+    return _fd;
+  }
+private:
+  const int _fd;
+
+  DISALLOW_COPY_AND_ASSIGN(File);
+};
+
+const string Segment::FORMAT_VERSION_HEADER = "cryfs;logstructured;segment;1";
+constexpr unsigned int Segment::RECORD_HEADER_SIZE;
+
+unsigned int Segment::formatVersionHeaderSize() {
+  return FORMAT_VERSION_HEADER.size() + 1; // +1 because of the null byte
+}
+
+unique_ref<Segment> Segment::Create(const bf::path &path, uint32_t id) {
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    throw std::runtime_error("Could not create segment " + path.native() + ": " + std::strerror(errno));
+  }
+  auto segment = make_unique_ref<Segment>(path, id, fd, 0);
+  _pwrite(fd, path, FORMAT_VERSION_HEADER.c_str(), formatVersionHeaderSize(), 0);
+  segment->_size = formatVersionHeaderSize();
+  return segment;
+}
+
+unique_ref<Segment> Segment::Open(const bf::path &path, uint32_t id) {
+  File file(path, O_RDONLY);
+  off_t size = ::lseek(file.fd(), 0, SEEK_END);
+  Data header(formatVersionHeaderSize());
+  if (!_pread(file.fd(), path, header.data(), header.size(), 0) || 0 != std::memcmp(header.data(), FORMAT_VERSION_HEADER.c_str(), formatVersionHeaderSize())) {
+    throw std::runtime_error("This is not a valid segment: " + path.native() + ". Maybe it was created with a different version of CryFS?");
+  }
+  return make_unique_ref<Segment>(path, id, -1, (size < 0) ? 0 : size);
+}
+
+Segment::Segment(const bf::path &path, uint32_t id, int fd, uint64_t size)
+  : _path(path), _id(id), _fd(fd), _size(size), _removeWhenUnused(false) {
+}
+
+Segment::~Segment() {
+  if (_fd >= 0) {
+    ::close(_fd);
+  }
+  if (_removeWhenUnused) {
+    boost::system::error_code error;
+    bf::remove(_path, error);
+    if (error) {
+      LOG(ERROR, "Could not remove segment {}: {}", _path.native(), error.message());
+    }
+  }
+}
+
+uint32_t Segment::id() const {
+  return _id;
+}
+
+const bf::path &Segment::path() const {
+  return _path;
+}
+
+uint64_t Segment::size() const {
+  return _size;
+}
+
+void Segment::openForAppending() {
+  ASSERT(_fd < 0, "Segment is already open for appending");
+  _fd = ::open(_path.c_str(), O_RDWR | O_CLOEXEC);
+  if (_fd < 0) {
+    throw std::runtime_error("Could not open segment " + _path.native() + ": " + std::strerror(errno));
+  }
+}
+
+void Segment::seal() {
+  ASSERT(_fd >= 0, "Segment isn't open for appending");
+  sync();
+  ::close(_fd);
+  _fd = -1;
+}
+
+void Segment::removeWhenUnused() {
+  _removeWhenUnused = true;
+}
+
+uint32_t Segment::_checksum(const Key &key, uint32_t size, const void *data) {
+  boost::crc_32_type crc;
+  crc.process_bytes(key.data(), Key::BINARY_LENGTH);
+  crc.process_bytes(&size, sizeof(size));
+  crc.process_bytes(data, size);
+  return crc.checksum();
+}
+
+Segment::Record Segment::append(const Key &key, const Data &data) {
+  ASSERT(_fd >= 0, "Segment isn't open for appending");
+  ASSERT(data.size() <= std::numeric_limits<uint32_t>::max(), "Block too large for a segment");
+  uint32_t size = data.size();
+  uint32_t checksum = _checksum(key, size, data.data());
+  uint64_t recordOffset = _size;
+  uint8_t header[RECORD_HEADER_SIZE];
+  std::memcpy(header, key.data(), Key::BINARY_LENGTH);
+  std::memcpy(header + Key::BINARY_LENGTH, &size, sizeof(size));
+  std::memcpy(header + Key::BINARY_LENGTH + sizeof(size), &checksum, sizeof(checksum));
+  _pwrite(_fd, _path, header, RECORD_HEADER_SIZE, recordOffset);
+  _pwrite(_fd, _path, data.data(), size, recordOffset + RECORD_HEADER_SIZE);
+  _size = recordOffset + RECORD_HEADER_SIZE + size;
+  return Record{key, recordOffset + RECORD_HEADER_SIZE, size, checksum};
+}
+
+Data Segment::read(uint64_t dataOffset, uint32_t size) const {
+  File file(_path, O_RDONLY);
+  Data result(size);
+  if (!_pread(file.fd(), _path, result.data(), size, dataOffset)) {
+    throw std::runtime_error("Segment " + _path.native() + " is shorter than expected");
+  }
+  return result;
+}
+
+optional<Segment::Record> Segment::readRecordHeader(uint64_t recordOffset) const {
+  File file(_path, O_RDONLY);
+  return _readRecordHeader(file, recordOffset);
+}
+
+optional<Segment::Record> Segment::_readRecordHeader(const File &file, uint64_t recordOffset) const {
+  uint64_t size = _size;
+  if (recordOffset + RECORD_HEADER_SIZE > size) {
+    return none;
+  }
+  uint8_t header[RECORD_HEADER_SIZE];
+  if (!_pread(file.fd(), _path, header, RECORD_HEADER_SIZE, recordOffset)) {
+    return none;
+  }
+  uint32_t dataSize;
+  std::memcpy(&dataSize, header + Key::BINARY_LENGTH, sizeof(dataSize));
+  uint32_t checksum;
+  std::memcpy(&checksum, header + Key::BINARY_LENGTH + sizeof(dataSize), sizeof(checksum));
+  uint64_t dataOffset = recordOffset + RECORD_HEADER_SIZE;
+  if (dataOffset + dataSize > size) {
+    return none;
+  }
+  return Record{Key::FromBinary(header), dataOffset, dataSize, checksum};
+}
+
+void Segment::truncateInvalidTail() {
+  File file(_path, O_RDWR);
+  uint64_t end = formatVersionHeaderSize();
+  for (auto record = _readRecordHeader(file, end); record != none; record = _readRecordHeader(file, end)) {
+    Data data(record->size);
+    if (!_pread(file.fd(), _path, data.data(), data.size(), record->dataOffset) ||
+        _checksum(record->key, record->size, data.data()) != record->checksum) {
+      break;
+    }
+    end = record->dataOffset + record->size;
+  }
+  if (end != _size) {
+    LOG(WARN, "Segment {} has an incomplete or corrupted record at the end. Removing it.", _path.native());
+    if (0 != ::ftruncate(file.fd(), end)) {
+      throw std::runtime_error("Could not truncate segment " + _path.native() + ": " + std::strerror(errno));
+    }
+    _size = end;
+  }
+  // The records we checked might only be in the page cache. Index entries that are written from now on rely on them.
+  if (0 != ::fsync(file.fd())) {
+    throw std::runtime_error("Could not sync segment " + _path.native() + ": " + std::strerror(errno));
+  }
+}
+
+void Segment::sync() {
+  if (_fd < 0) {
+    // Sealed segments were synced when they were sealed
+    return;
+  }
+  if (0 != ::fsync(_fd)) {
+    throw std::runtime_error("Could not sync segment " + _path.native() + ": " + std::strerror(errno));
+  }
+}
+
+void Segment::syncConcurrently() const {
+  // fsync() writes back the whole file, no matter which file descriptor it is called on
+  File file(_path, O_RDONLY);
+  if (0 != ::fsync(file.fd())) {
+    throw std::runtime_error("Could not sync segment " + _path.native() + ": " + std::strerror(errno));
+  }
+}
+
+void Segment::_pwrite(int fd, const bf::path &path, const void *data, size_t count, uint64_t offset) {
+  const uint8_t *source = static_cast<const uint8_t*>(data);
+  while (count > 0) {
+    ssize_t written = ::pwrite(fd, source, count, offset);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error("Could not write to segment " + path.native() + ": " + std::strerror(errno));
+    }
+    source += written;
+    count -= written;
+    offset += written;
+  }
+}
+
+bool Segment::_pread(int fd, const bf::path &path, void *target, size_t count, uint64_t offset) {
+  uint8_t *dest = static_cast<uint8_t*>(target);
+  while (count > 0) {
+    ssize_t numRead = ::pread(fd, dest, count, offset);
+    if (numRead < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error("Could not read from segment " + path.native() + ": " + std::strerror(errno));
+    }
+    if (numRead == 0) {
+      return false;
+    }
+    dest += numRead;
+    count -= numRead;
+    offset += numRead;
+  }
+  return true;
+}
+
+}
+}
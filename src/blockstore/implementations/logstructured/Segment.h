@@ -0,0 +1,87 @@
+#pragma once
+#ifndef MESSMER_BLOCKSTORE_IMPLEMENTATIONS_LOGSTRUCTURED_SEGMENT_H_
+#define MESSMER_BLOCKSTORE_IMPLEMENTATIONS_LOGSTRUCTURED_SEGMENT_H_
+
+#include <atomic>
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+#include <cpp-utils/data/Data.h>
+#include <cpp-utils/pointer/unique_ref.h>
+#include <cpp-utils/macros.h>
+#include "../../utils/Key.h"
+
+namespace blockstore {
+namespace logstructured {
+
+// A segment is a file that blocks are appended to. Each record consists of the block key, the data size, a checksum
+// and the data. The checksum covers key, size and data, so a record that was only partly written is detected.
+// Appending isn't thread safe, but reading is and can happen in parallel to appending.
+// Only the segment that is appended to keeps its file open. Reads open the file on demand, so a store with many
+// segments doesn't run out of file descriptors.
+class Segment final {
+public:
+  struct Record final {
+    Key key;
+    uint64_t dataOffset;
+    uint32_t size;
+    uint32_t checksum;
+  };
+
+  static const std::string FORMAT_VERSION_HEADER;
+  static unsigned int formatVersionHeaderSize();
+  static constexpr unsigned int RECORD_HEADER_SIZE = Key::BINARY_LENGTH + 2 * sizeof(uint32_t);
+
+  // Creates a new segment, which is open for appending
+  static cpputils::unique_ref<Segment> Create(const boost::filesystem::path &path, uint32_t id);
+  // Opens an existing segment. It is read only until openForAppending() is called.
+  static cpputils::unique_ref<Segment> Open(const boost::filesystem::path &path, uint32_t id);
+
+  Segment(const boost::filesystem::path &path, uint32_t id, int fd, uint64_t size);
+  ~Segment();
+
+  uint32_t id() const;
+  const boost::filesystem::path &path() const;
+  // Number of bytes in the segment file, including the format header
+  uint64_t size() const;
+
+  void openForAppending();
+  // Syncs the segment and closes its file. Afterwards, the segment is read only.
+  void seal();
+  // Deletes the segment file once the last reference to the segment is gone, so reads that already started can finish.
+  void removeWhenUnused();
+
+  // Appends a record and returns where its data was stored
+  Record append(const Key &key, const cpputils::Data &data);
+  cpputils::Data read(uint64_t dataOffset, uint32_t size) const;
+  // Returns the record starting at the given offset, or none if there is no complete record at the offset.
+  // The next record starts at record.dataOffset + record.size.
+  boost::optional<Record> readRecordHeader(uint64_t recordOffset) const;
+  // Cuts off records at the end that are incomplete or don't match their checksum, which could be left over if the
+  // process crashed while appending.
+  void truncateInvalidTail();
+  void sync();
+  // Like sync(), but doesn't use the file that is appended to, so it can be called in parallel to append() and seal()
+  void syncConcurrently() const;
+
+private:
+  class File;
+
+  static uint32_t _checksum(const Key &key, uint32_t size, const void *data);
+  static void _pwrite(int fd, const boost::filesystem::path &path, const void *data, size_t count, uint64_t offset);
+  static bool _pread(int fd, const boost::filesystem::path &path, void *target, size_t count, uint64_t offset);
+  boost::optional<Record> _readRecordHeader(const File &file, uint64_t recordOffset) const;
+
+  const boost::filesystem::path _path;
+  const uint32_t _id;
+  // Only open while the segment is appended to
+  int _fd;
+  std::atomic<uint64_t> _size;
+  std::atomic<bool> _removeWhenUnused;
+
+  DISALLOW_COPY_AND_ASSIGN(Segment);
+};
+
+}
+}
+
+#endif
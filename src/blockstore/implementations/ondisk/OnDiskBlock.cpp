@@ -1,18 +1,17 @@
 #include <cstring>
-#include <fstream>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <boost/filesystem.hpp>
 #include "OnDiskBlock.h"
 #include "OnDiskBlockStore.h"
-#include "../../utils/FileDoesntExistException.h"
+#include "PendingRenames.h"
 #include <cpp-utils/data/DataUtils.h>
 #include <cpp-utils/assert/assert.h>
 #include <cpp-utils/logging/logging.h>
 
-using std::istream;
-using std::ostream;
-using std::ifstream;
-using std::ofstream;
-using std::ios;
 using std::string;
 using cpputils::Data;
 using cpputils::make_unique_ref;
@@ -28,9 +27,26 @@ namespace ondisk {
 
 const string OnDiskBlock::FORMAT_VERSION_HEADER_PREFIX = "cryfs;block;";
 const string OnDiskBlock::FORMAT_VERSION_HEADER = OnDiskBlock::FORMAT_VERSION_HEADER_PREFIX + "0";
+const string OnDiskBlock::TMP_FILE_SUFFIX = ".tmp";
 
-OnDiskBlock::OnDiskBlock(const Key &key, const bf::path &filepath, Data data)
- : Block(key), _filepath(filepath), _data(std::move(data)), _dataChanged(false), _mutex() {
+namespace {
+// Same permissions std::ofstream used to create block files with
+constexpr mode_t FILE_MODE = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH;
+
+// Closes the file descriptor when it goes out of scope
+struct FileDescriptor final {
+  explicit FileDescriptor(int fd_): fd(fd_) {}
+  ~FileDescriptor() {
+    ::close(fd);
+  }
+  const int fd;
+
+  DISALLOW_COPY_AND_ASSIGN(FileDescriptor);
+};
+}
+
+OnDiskBlock::OnDiskBlock(const Key &key, const bf::path &filepath, Data data, PendingRenames *pendingRenames)
+ : Block(key), _filepath(filepath), _data(std::move(data)), _dataChanged(false), _pendingRenames(pendingRenames), _mutex() {
 }
 
 OnDiskBlock::~OnDiskBlock() {
@@ -61,34 +77,54 @@ bf::path OnDiskBlock::_getFilepath(const bf::path &rootdir, const Key &key) {
   return rootdir / keyStr.substr(0,3) / keyStr.substr(3);
 }
 
-optional<unique_ref<OnDiskBlock>> OnDiskBlock::LoadFromDisk(const bf::path &rootdir, const Key &key) {
+optional<unique_ref<OnDiskBlock>> OnDiskBlock::LoadFromDisk(const bf::path &rootdir, const Key &key, PendingRenames *pendingRenames) {
   auto filepath = _getFilepath(rootdir, key);
-  try {
-    boost::optional<Data> data = _loadFromDisk(filepath);
-    if (data == none) {
-      return none;
-    }
-    return make_unique_ref<OnDiskBlock>(key, filepath, std::move(*data));
-  } catch (const FileDoesntExistException &e) {
+  boost::optional<Data> data = none;
+  if (pendingRenames == nullptr) {
+    data = _loadFromDisk(filepath);
+  } else {
+    auto lock = pendingRenames->lockFiles();
+    data = _loadFromDisk(pendingRenames->pathToLoad(filepath));
+  }
+  if (data == none) {
     return none;
   }
+  return make_unique_ref<OnDiskBlock>(key, filepath, std::move(*data), pendingRenames);
 }
 
-optional<unique_ref<OnDiskBlock>> OnDiskBlock::CreateOnDisk(const bf::path &rootdir, const Key &key, Data data) {
+optional<unique_ref<OnDiskBlock>> OnDiskBlock::CreateOnDisk(const bf::path &rootdir, const Key &key, Data data, PendingRenames *pendingRenames) {
   auto filepath = _getFilepath(rootdir, key);
-  bf::create_directory(filepath.parent_path());
-  if (bf::exists(filepath)) {
-    return none;
+  // O_EXCL makes checking that the block doesn't exist and creating it one atomic operation
+  int fd = ::open(filepath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, FILE_MODE);
+  if (fd < 0 && errno == ENOENT) {
+    bf::create_directory(filepath.parent_path());
+    fd = ::open(filepath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, FILE_MODE);
   }
+  if (fd < 0) {
+    if (errno == EEXIST) {
+      return none;
+    }
+    throw std::runtime_error("Could not create block " + filepath.native() + ": " + std::strerror(errno));
+  }
+  FileDescriptor file(fd);
 
-  auto block = make_unique_ref<OnDiskBlock>(key, filepath, std::move(data));
-  block->_storeToDisk();
+  // A new block doesn't need the temporary file for atomic writes, because if we crash while writing it, it isn't
+  // referenced by any other block yet. PendingRenames::sync() syncs it before the blocks referencing it are renamed.
+  auto block = make_unique_ref<OnDiskBlock>(key, filepath, std::move(data), pendingRenames);
+  block->_writeToFile(file.fd, filepath);
   return std::move(block);
 }
 
-void OnDiskBlock::RemoveFromDisk(const bf::path &rootdir, const Key &key) {
+bool OnDiskBlock::RemoveFromDisk(const bf::path &rootdir, const Key &key, PendingRenames *pendingRenames) {
   auto filepath = _getFilepath(rootdir, key);
-  ASSERT(bf::is_regular_file(filepath), "Block not found on disk");
+  boost::shared_lock<boost::shared_mutex> lock;
+  if (pendingRenames != nullptr) {
+    lock = pendingRenames->lockFiles();
+    pendingRenames->discard(filepath);
+  }
+  if (!bf::is_regular_file(filepath)) {
+    return false;
+  }
   bool retval = bf::remove(filepath);
   if (!retval) {
     LOG(ERROR, "Couldn't find block {} to remove", key.ToString());
@@ -96,43 +132,137 @@ void OnDiskBlock::RemoveFromDisk(const bf::path &rootdir, const Key &key) {
   if (bf::is_empty(filepath.parent_path())) {
     bf::remove(filepath.parent_path());
   }
+  return retval;
 }
 
 void OnDiskBlock::_storeToDisk() const {
-  std::ofstream file(_filepath.c_str(), std::ios::binary | std::ios::trunc);
-  if (!file.good()) {
-    throw std::runtime_error("Could not open file for writing");
+  if (_pendingRenames != nullptr) {
+    _storeToDiskAtomically();
+  } else {
+    _storeToDiskInPlace();
+  }
+}
+
+void OnDiskBlock::_storeToDiskInPlace() const {
+  // Don't truncate the file when opening it. Overwriting it and only cutting off what's left over afterwards saves
+  // the file system from freeing and reallocating the blocks of the file.
+  int fd = ::open(_filepath.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, FILE_MODE);
+  if (fd < 0) {
+    throw std::runtime_error("Could not open file for writing: " + _filepath.native() + ": " + std::strerror(errno));
+  }
+  FileDescriptor file(fd);
+  _writeToFile(file.fd, _filepath);
+  if (0 != ::ftruncate(file.fd, formatVersionHeaderSize() + _data.size())) {
+    throw std::runtime_error("Could not resize block " + _filepath.native() + ": " + std::strerror(errno));
+  }
+}
+
+void OnDiskBlock::_storeToDiskAtomically() const {
+  // Write the new version to a temporary file that replaces the old version in PendingRenames::sync(), so that a crash
+  // while writing doesn't leave a truncated block behind.
+  bool syncNow = false;
+  {
+    auto lock = _pendingRenames->lockFiles();
+    bf::path tmpFilepath = PendingRenames::tmpFilepath(_filepath);
+    int fd = ::open(tmpFilepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, FILE_MODE);
+    if (fd < 0) {
+      throw std::runtime_error("Could not open file for writing: " + tmpFilepath.native() + ": " + std::strerror(errno));
+    }
+    try {
+      FileDescriptor file(fd);
+      _writeToFile(file.fd, tmpFilepath);
+    } catch (...) {
+      _pendingRenames->discard(_filepath);
+      throw;
+    }
+    syncNow = _pendingRenames->add(_filepath);
   }
-  file.write(FORMAT_VERSION_HEADER.c_str(), formatVersionHeaderSize());
-  if (!file.good()) {
-    throw std::runtime_error("Error writing block header");
+  if (syncNow) {
+    _pendingRenames->sync();
   }
-  _data.StoreToStream(file);
-  if (!file.good()) {
-    throw std::runtime_error("Error writing block data");
+}
+
+void OnDiskBlock::_writeToFile(int fd, const bf::path &filepath) const {
+  // Write header and data with one syscall
+  struct iovec parts[2];
+  parts[0].iov_base = const_cast<char*>(FORMAT_VERSION_HEADER.c_str());
+  parts[0].iov_len = formatVersionHeaderSize();
+  parts[1].iov_base = const_cast<void*>(_data.data());
+  parts[1].iov_len = _data.size();
+  struct iovec *remaining = parts;
+  int numRemaining = 2;
+  while (numRemaining > 0) {
+    ssize_t written = ::writev(fd, remaining, numRemaining);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error("Error writing block " + filepath.native() + ": " + std::strerror(errno));
+    }
+    // Skip what was written, in case the write was short
+    while (numRemaining > 0 && static_cast<size_t>(written) >= remaining->iov_len) {
+      written -= remaining->iov_len;
+      ++remaining;
+      --numRemaining;
+    }
+    if (numRemaining > 0) {
+      remaining->iov_base = static_cast<char*>(remaining->iov_base) + written;
+      remaining->iov_len -= written;
+    }
   }
 }
 
 optional<Data> OnDiskBlock::_loadFromDisk(const bf::path &filepath) {
-  //If it isn't a file, ifstream::good() would return false. We still need this extra check
-  //upfront, because ifstream::good() doesn't crash if we give it the path of a directory
-  //instead the path of a file.
-  if(!bf::is_regular_file(filepath)) {
-    return none;
+  int fd = ::open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    if (errno == ENOENT || errno == ENOTDIR) {
+      return none;
+    }
+    throw std::runtime_error("Could not open block " + filepath.native() + ": " + std::strerror(errno));
+  }
+  FileDescriptor file(fd);
+  struct stat fileStat;
+  if (0 != ::fstat(file.fd, &fileStat)) {
+    throw std::runtime_error("Could not stat block " + filepath.native() + ": " + std::strerror(errno));
   }
-  ifstream file(filepath.c_str(), ios::binary);
-  if (!file.good()) {
+  if (!S_ISREG(fileStat.st_mode)) {
     return none;
   }
-  _checkHeader(&file);
-  Data result = Data::LoadFromStream(file);
-  //TODO With newer compilers, "return result;" would be enough
-  return boost::optional<Data>(std::move(result));
-}
+  uint64_t fileSize = fileStat.st_size;
 
-void OnDiskBlock::_checkHeader(istream *str) {
   Data header(formatVersionHeaderSize());
-  str->read(reinterpret_cast<char*>(header.data()), formatVersionHeaderSize());
+  if (fileSize < header.size() || !_readFromFile(file.fd, header.data(), header.size(), 0)) {
+    throw std::runtime_error("This is not a valid block.");
+  }
+  _checkHeader(header);
+  Data result(fileSize - header.size());
+  if (!_readFromFile(file.fd, result.data(), result.size(), header.size())) {
+    throw std::runtime_error("Block " + filepath.native() + " got shorter while reading it");
+  }
+  return std::move(result);
+}
+
+bool OnDiskBlock::_readFromFile(int fd, void *target, uint64_t size, uint64_t offset) {
+  uint8_t *dest = static_cast<uint8_t*>(target);
+  while (size > 0) {
+    ssize_t numRead = ::pread(fd, dest, size, offset);
+    if (numRead < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error(string("Error reading block: ") + std::strerror(errno));
+    }
+    if (numRead == 0) {
+      return false;
+    }
+    dest += numRead;
+    size -= numRead;
+    offset += numRead;
+  }
+  return true;
+}
+
+void OnDiskBlock::_checkHeader(const Data &header) {
   if (!_isAcceptedCryfsHeader(header)) {
     if (_isOtherCryfsHeader(header)) {
       throw std::runtime_error("This block is not supported yet. Maybe it was created with a newer version of CryFS?");
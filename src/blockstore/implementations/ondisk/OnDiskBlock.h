@@ -13,20 +13,26 @@
 namespace blockstore {
 namespace ondisk {
 class OnDiskBlockStore;
+class PendingRenames;
 
 class OnDiskBlock final: public Block {
 public:
-  OnDiskBlock(const Key &key, const boost::filesystem::path &filepath, cpputils::Data data);
+  OnDiskBlock(const Key &key, const boost::filesystem::path &filepath, cpputils::Data data, PendingRenames *pendingRenames);
   ~OnDiskBlock();
 
   static const std::string FORMAT_VERSION_HEADER_PREFIX;
   static const std::string FORMAT_VERSION_HEADER;
+  // With atomic writes, blocks are written to a file with this suffix first, see PendingRenames
+  static const std::string TMP_FILE_SUFFIX;
   static unsigned int formatVersionHeaderSize();
   static uint64_t blockSizeFromPhysicalBlockSize(uint64_t blockSize);
 
-  static boost::optional<cpputils::unique_ref<OnDiskBlock>> LoadFromDisk(const boost::filesystem::path &rootdir, const Key &key);
-  static boost::optional<cpputils::unique_ref<OnDiskBlock>> CreateOnDisk(const boost::filesystem::path &rootdir, const Key &key, cpputils::Data data);
-  static void RemoveFromDisk(const boost::filesystem::path &rootdir, const Key &key);
+  // Without pendingRenames, flushing the block overwrites the block file in place. With it, flushing writes a temporary
+  // file that replaces the block file in PendingRenames::sync(), so a crash can't leave a partially written block behind.
+  static boost::optional<cpputils::unique_ref<OnDiskBlock>> LoadFromDisk(const boost::filesystem::path &rootdir, const Key &key, PendingRenames *pendingRenames = nullptr);
+  static boost::optional<cpputils::unique_ref<OnDiskBlock>> CreateOnDisk(const boost::filesystem::path &rootdir, const Key &key, cpputils::Data data, PendingRenames *pendingRenames = nullptr);
+  // Returns false if the block didn't exist
+  static bool RemoveFromDisk(const boost::filesystem::path &rootdir, const Key &key, PendingRenames *pendingRenames = nullptr);
 
   const void *data() const override;
   void write(const void *source, uint64_t offset, uint64_t size) override;
@@ -40,15 +46,21 @@ private:
 
   static bool _isAcceptedCryfsHeader(const cpputils::Data &data);
   static bool _isOtherCryfsHeader(const cpputils::Data &data);
-  static void _checkHeader(std::istream *str);
+  static void _checkHeader(const cpputils::Data &header);
   static boost::filesystem::path _getFilepath(const boost::filesystem::path &rootdir, const Key &key);
 
   const boost::filesystem::path _filepath;
   cpputils::Data _data;
   bool _dataChanged;
+  PendingRenames *_pendingRenames;
 
   static boost::optional<cpputils::Data> _loadFromDisk(const boost::filesystem::path &filepath);
+  // Returns false if the file ended before size bytes were read
+  static bool _readFromFile(int fd, void *target, uint64_t size, uint64_t offset);
   void _storeToDisk() const;
+  void _storeToDiskInPlace() const;
+  void _storeToDiskAtomically() const;
+  void _writeToFile(int fd, const boost::filesystem::path &filepath) const;
 
   std::mutex _mutex;
 
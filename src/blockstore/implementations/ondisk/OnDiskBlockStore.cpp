@@ -1,6 +1,10 @@
 #include "OnDiskBlock.h"
 #include "OnDiskBlockStore.h"
 #include <sys/statvfs.h>
+#include <cpp-utils/data/Serializer.h>
+#include <cpp-utils/data/Deserializer.h>
+#include <cpp-utils/logging/logging.h>
+#include <cpp-utils/assert/assert.h>
 
 using std::string;
 using cpputils::Data;
@@ -8,14 +12,23 @@ using cpputils::unique_ref;
 using boost::optional;
 using boost::none;
 using std::vector;
+using cpputils::Serializer;
+using cpputils::Deserializer;
+using namespace cpputils::logging;
 
 namespace bf = boost::filesystem;
 
 namespace blockstore {
 namespace ondisk {
 
-OnDiskBlockStore::OnDiskBlockStore(const boost::filesystem::path &rootdir)
- : _rootdir(rootdir) {
+const string OnDiskBlockStore::BLOCK_COUNT_FILENAME = "cryfs.blockcount";
+
+namespace {
+const string BLOCK_COUNT_HEADER = "cryfs;blockcount;0";
+}
+
+OnDiskBlockStore::OnDiskBlockStore(const boost::filesystem::path &rootdir, WriteMode writeMode)
+ : _rootdir(rootdir), _writeMode(writeMode), _pendingRenames(rootdir), _numBlocks(0) {
   if (!bf::exists(rootdir)) {
     throw std::runtime_error("Base directory not found");
   }
@@ -26,6 +39,55 @@ OnDiskBlockStore::OnDiskBlockStore(const boost::filesystem::path &rootdir)
 #ifndef CRYFS_NO_COMPATIBILITY
   _migrateBlockStore();
 #endif
+  if (!_loadBlockCount()) {
+    // The last mount didn't shut down cleanly. Unfinished atomic writes left their temporary files behind.
+    _numBlocks = _removeTemporaryFilesAndCountBlocks();
+  }
+}
+
+OnDiskBlockStore::~OnDiskBlockStore() {
+  try {
+    _pendingRenames.sync();
+  } catch (const std::exception &e) {
+    LOG(ERROR, "Couldn't write changed blocks: {}", e.what());
+  }
+  try {
+    _storeBlockCount();
+  } catch (const std::exception &e) {
+    LOG(ERROR, "Couldn't store block count: {}", e.what());
+  }
+}
+
+bool OnDiskBlockStore::_loadBlockCount() {
+  bf::path path = _rootdir / BLOCK_COUNT_FILENAME;
+  auto data = Data::LoadFromFile(path);
+  if (data == none) {
+    return false;
+  }
+  bool valid = false;
+  try {
+    Deserializer deserializer(&*data);
+    if (deserializer.readString() == BLOCK_COUNT_HEADER) {
+      uint64_t numBlocks = deserializer.readUint64();
+      deserializer.finished();
+      _numBlocks = numBlocks;
+      valid = true;
+    }
+  } catch (const std::exception &e) {
+    LOG(WARN, "Invalid block count file, counting blocks again: {}", e.what());
+  }
+  // Delete it while the filesystem is mounted, so we don't trust an outdated count after a crash
+  return bf::remove(path) && valid;
+}
+
+void OnDiskBlockStore::_storeBlockCount() const {
+  uint64_t numBlocks = this->numBlocks();
+  Serializer serializer(Serializer::StringSize(BLOCK_COUNT_HEADER) + sizeof(uint64_t));
+  serializer.writeString(BLOCK_COUNT_HEADER);
+  serializer.writeUint64(numBlocks);
+  bf::path tmpPath = _rootdir / (BLOCK_COUNT_FILENAME + ".tmp");
+  serializer.finished().StoreToFile(tmpPath);
+  bf::rename(tmpPath, _rootdir / BLOCK_COUNT_FILENAME);
 }
 
 #ifndef CRYFS_NO_COMPATIBILITY
@@ -56,30 +118,58 @@ bool OnDiskBlockStore::_isValidBlockKey(const string &key) {
 
 //TODO Do I have to lock tryCreate/remove and/or load? Or does ParallelAccessBlockStore take care of that?
 
+PendingRenames *OnDiskBlockStore::_pendingRenamesForBlocks() {
+  if (_writeMode == WriteMode::ATOMIC) {
+    return &_pendingRenames;
+  }
+  return nullptr;
+}
+
 optional<unique_ref<Block>> OnDiskBlockStore::tryCreate(const Key &key, Data data) {
   //TODO Easier implementation? This is only so complicated because of the cast OnDiskBlock -> Block
-  auto result = OnDiskBlock::CreateOnDisk(_rootdir, key, std::move(data));
+  auto result = OnDiskBlock::CreateOnDisk(_rootdir, key, std::move(data), _pendingRenamesForBlocks());
   if (result == boost::none) {
     return boost::none;
   }
+  ++_numBlocks;
   return unique_ref<Block>(std::move(*result));
 }
 
 optional<unique_ref<Block>> OnDiskBlockStore::load(const Key &key) {
-  return optional<unique_ref<Block>>(OnDiskBlock::LoadFromDisk(_rootdir, key));
+  return optional<unique_ref<Block>>(OnDiskBlock::LoadFromDisk(_rootdir, key, _pendingRenamesForBlocks()));
 }
 
 void OnDiskBlockStore::remove(unique_ref<Block> block) {
   Key key = block->key();
   cpputils::destruct(std::move(block));
-  OnDiskBlock::RemoveFromDisk(_rootdir, key);
+  bool removed = remove(key);
+  ASSERT(removed, "Block not found on disk");
+}
+
+bool OnDiskBlockStore::remove(const Key &key) {
+  if (!OnDiskBlock::RemoveFromDisk(_rootdir, key, _pendingRenamesForBlocks())) {
+    return false;
+  }
+  --_numBlocks;
+  return true;
 }
 
 uint64_t OnDiskBlockStore::numBlocks() const {
+  return _numBlocks;
+}
+
+uint64_t OnDiskBlockStore::_removeTemporaryFilesAndCountBlocks() {
   uint64_t count = 0;
   for (auto entry = bf::directory_iterator(_rootdir); entry != bf::directory_iterator(); ++entry) {
     if (bf::is_directory(entry->path())) {
-      count += std::distance(bf::directory_iterator(entry->path()), bf::directory_iterator());
+      for (auto blockFile = bf::directory_iterator(entry->path()); blockFile != bf::directory_iterator(); ++blockFile) {
+        if (blockFile->path().extension() == OnDiskBlock::TMP_FILE_SUFFIX) {
+          // The block file still has the version from before the write
+          bf::remove(blockFile->path());
+        } else {
+          ++count;
+        }
+      }
     }
   }
   return count;
@@ -95,5 +185,9 @@ uint64_t OnDiskBlockStore::blockSizeFromPhysicalBlockSize(uint64_t blockSize) co
   return OnDiskBlock::blockSizeFromPhysicalBlockSize(blockSize);
 }
 
+void OnDiskBlockStore::flush(const std::vector<Key> &/*keys*/) {
+  _pendingRenames.sync();
+}
+
 }
 }
@@ -3,7 +3,9 @@
 #define MESSMER_BLOCKSTORE_IMPLEMENTATIONS_ONDISK_ONDISKBLOCKSTORE_H_
 
 #include <boost/filesystem.hpp>
+#include <atomic>
 #include "../../interface/helpers/BlockStoreWithRandomKeys.h"
+#include "PendingRenames.h"
 
 #include <cpp-utils/macros.h>
 
@@ -12,18 +14,43 @@ namespace ondisk {
 
 class OnDiskBlockStore final: public BlockStoreWithRandomKeys {
 public:
-  explicit OnDiskBlockStore(const boost::filesystem::path &rootdir);
+  enum class WriteMode {
+    // Overwrite block files in place. A crash while writing can leave a partially written block behind.
+    IN_PLACE,
+    // Write changed blocks to temporary files and rename them over the block files in flush(), see PendingRenames.
+    ATOMIC
+  };
+
+  explicit OnDiskBlockStore(const boost::filesystem::path &rootdir, WriteMode writeMode = WriteMode::IN_PLACE);
+  ~OnDiskBlockStore();
+
+  static const std::string BLOCK_COUNT_FILENAME;
 
   boost::optional<cpputils::unique_ref<Block>> tryCreate(const Key &key, cpputils::Data data) override;
   boost::optional<cpputils::unique_ref<Block>> load(const Key &key) override;
   //TODO Can we make this faster by allowing to delete blocks by only having theiy Key? So we wouldn't have to load it first?
   void remove(cpputils::unique_ref<Block> block) override;
+  bool remove(const Key &key) override;
   uint64_t numBlocks() const override;
   uint64_t estimateNumFreeBytes() const override;
   uint64_t blockSizeFromPhysicalBlockSize(uint64_t blockSize) const override;
+  // With atomic writes, this syncs all changed blocks to disk at once, no matter which keys are given.
+  void flush(const std::vector<Key> &keys) override;
 
 private:
+  // Returns false if there is no valid block count
+  bool _loadBlockCount();
+  void _storeBlockCount() const;
+  uint64_t _removeTemporaryFilesAndCountBlocks();
+  PendingRenames *_pendingRenamesForBlocks();
+
   const boost::filesystem::path _rootdir;
+  const WriteMode _writeMode;
+  PendingRenames _pendingRenames;
+  // Counting the block files takes long for large filesystems, but statfs needs the number of blocks every time.
+  // So we keep the count up to date. On unmount, the count is stored in the base directory and it is deleted again
+  // when mounting, so after a crash, the blocks are counted again.
+  std::atomic<uint64_t> _numBlocks;
 #ifndef CRYFS_NO_COMPATIBILITY
   void _migrateBlockStore();
   bool _isValidBlockKey(const std::string &key);
@@ -0,0 +1,89 @@
+#include "PendingRenames.h"
+#include "OnDiskBlock.h"
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdexcept>
+
+using std::string;
+using boost::shared_lock;
+using boost::unique_lock;
+using boost::shared_mutex;
+
+namespace bf = boost::filesystem;
+
+namespace blockstore {
+namespace ondisk {
+
+constexpr size_t PendingRenames::MAX_PENDING_RENAMES;
+
+PendingRenames::PendingRenames(const bf::path &rootdir)
+  : _rootdir(rootdir), _filesMutex(), _pendingMutex(), _pending() {
+}
+
+shared_lock<shared_mutex> PendingRenames::lockFiles() const {
+  return shared_lock<shared_mutex>(_filesMutex);
+}
+
+bf::path PendingRenames::tmpFilepath(const bf::path &filepath) {
+  return filepath.native() + OnDiskBlock::TMP_FILE_SUFFIX;
+}
+
+bf::path PendingRenames::pathToLoad(const bf::path &filepath) const {
+  std::unique_lock<std::mutex> lock(_pendingMutex);
+  if (_pending.count(filepath.native()) != 0) {
+    return tmpFilepath(filepath);
+  }
+  return filepath;
+}
+
+bool PendingRenames::add(const bf::path &filepath) {
+  std::unique_lock<std::mutex> lock(_pendingMutex);
+  _pending.insert(filepath.native());
+  return _pending.size() >= MAX_PENDING_RENAMES;
+}
+
+void PendingRenames::discard(const bf::path &filepath) {
+  std::unique_lock<std::mutex> lock(_pendingMutex);
+  _pending.erase(filepath.native());
+  ::unlink(tmpFilepath(filepath).c_str());
+}
+
+void PendingRenames::sync() {
+  unique_lock<shared_mutex> lock(_filesMutex);
+  if (_pending.empty()) {
+    return;
+  }
+  // Without syncing first, the renames could reach the disk before the data and a crash would leave empty blocks behind
+  _syncFileSystem();
+  for (auto filepath = _pending.begin(); filepath != _pending.end(); filepath = _pending.erase(filepath)) {
+    // If this fails, the block and all blocks after it stay pending and are renamed in the next sync()
+    if (0 != ::rename(tmpFilepath(*filepath).c_str(), filepath->c_str())) {
+      throw std::runtime_error("Could not replace block " + *filepath + ": " + std::strerror(errno));
+    }
+  }
+  // Sync the renames as well, so the new versions of the blocks are stored when we return
+  _syncFileSystem();
+}
+
+void PendingRenames::_syncFileSystem() const {
+#ifdef __linux__
+  int fd = ::open(_rootdir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error("Could not open base directory " + _rootdir.native() + ": " + std::strerror(errno));
+  }
+  int result = ::syncfs(fd);
+  int error = errno;
+  ::close(fd);
+  if (0 != result) {
+    throw std::runtime_error("Could not sync base directory " + _rootdir.native() + ": " + std::strerror(error));
+  }
+#else
+  // Without syncfs(), we can only sync all file systems
+  ::sync();
+#endif
+}
+
+}
+}
@@ -0,0 +1,58 @@
+#pragma once
+#ifndef MESSMER_BLOCKSTORE_IMPLEMENTATIONS_ONDISK_PENDINGRENAMES_H_
+#define MESSMER_BLOCKSTORE_IMPLEMENTATIONS_ONDISK_PENDINGRENAMES_H_
+
+#include <boost/filesystem/path.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <cpp-utils/macros.h>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+namespace blockstore {
+namespace ondisk {
+
+// With atomic writes, a flushed block is written to a temporary file next to its block file. The temporary files
+// replace the block files in sync(), which syncs the file system once for all of them instead of once per block.
+// A crash before that leaves the old versions of the blocks behind.
+class PendingRenames final {
+public:
+  // If this many blocks are waiting for their rename, the next write syncs them
+  static constexpr size_t MAX_PENDING_RENAMES = 1024;
+
+  explicit PendingRenames(const boost::filesystem::path &rootdir);
+
+  // sync() waits for threads holding this lock, so it doesn't rename a file while it is read or written
+  boost::shared_lock<boost::shared_mutex> lockFiles() const;
+
+  // The following functions have to be called while holding lockFiles()
+
+  // Returns the file the newest version of the block is stored in
+  boost::filesystem::path pathToLoad(const boost::filesystem::path &filepath) const;
+  // Remembers that the temporary file of the block was written and has to replace the block file in the next sync().
+  // Returns true if the caller should call sync() after releasing the lock.
+  bool add(const boost::filesystem::path &filepath);
+  // Forgets about the temporary file of the block and deletes it, e.g. because the block is removed or writing the
+  // temporary file failed.
+  void discard(const boost::filesystem::path &filepath);
+
+  // Syncs the temporary files to disk and renames them over their block files
+  void sync();
+
+  static boost::filesystem::path tmpFilepath(const boost::filesystem::path &filepath);
+
+private:
+  void _syncFileSystem() const;
+
+  const boost::filesystem::path _rootdir;
+  mutable boost::shared_mutex _filesMutex;
+  mutable std::mutex _pendingMutex;
+  std::unordered_set<std::string> _pending;
+
+  DISALLOW_COPY_AND_ASSIGN(PendingRenames);
+};
+
+}
+}
+
+#endif
@@ -24,6 +24,10 @@ public:
 	return _baseBlock->write(source, offset, size);
   }
 
+  void writeInPlace(uint64_t offset, uint64_t size, const std::function<void (void *target)> &fill) override {
+    return _baseBlock->writeInPlace(offset, size, fill);
+  }
+
   void flush() override {
 	return _baseBlock->flush();
   }
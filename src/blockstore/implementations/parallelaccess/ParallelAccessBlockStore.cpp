@@ -52,6 +52,13 @@ void ParallelAccessBlockStore::remove(unique_ref<Block> block) {
   return _parallelAccessStore.remove(key, std::move(*block_ref));
 }
 
+bool ParallelAccessBlockStore::remove(const Key &key) {
+  // If somebody is using the block, this waits until they're done
+  return _parallelAccessStore.remove(key, [this, &key] {
+    return _baseBlockStore->remove(key);
+  });
+}
+
 uint64_t ParallelAccessBlockStore::numBlocks() const {
   return _baseBlockStore->numBlocks();
 }
@@ -64,5 +71,9 @@ uint64_t ParallelAccessBlockStore::blockSizeFromPhysicalBlockSize(uint64_t block
   return _baseBlockStore->blockSizeFromPhysicalBlockSize(blockSize);
 }
 
+void ParallelAccessBlockStore::flush(const std::vector<Key> &keys) {
+  _baseBlockStore->flush(keys);
+}
+
 }
 }
@@ -3,7 +3,9 @@
 #define MESSMER_BLOCKSTORE_INTERFACE_BLOCK_H_
 
 #include "../utils/Key.h"
+#include <cpp-utils/data/Data.h>
 #include <cstring>
+#include <functional>
 
 namespace blockstore {
 
@@ -16,6 +18,14 @@ public:
 
   virtual const void *data() const = 0;
   virtual void write(const void *source, uint64_t offset, uint64_t size) = 0;
+  // Calls fill() with a pointer to the given block region, so the caller can produce the data right there
+  // (e.g. read it from a file descriptor) instead of handing over a buffer that is then copied into the block.
+  // Blocks that keep their data in memory override this. The default implementation goes through a temporary buffer.
+  virtual void writeInPlace(uint64_t offset, uint64_t size, const std::function<void (void *target)> &fill) {
+    cpputils::Data buffer(size);
+    fill(buffer.data());
+    write(buffer.data(), offset, size);
+  }
 
   virtual void flush() = 0;
 
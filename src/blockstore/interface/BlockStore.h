@@ -4,9 +4,11 @@
 
 #include "Block.h"
 #include <string>
+#include <vector>
 #include <boost/optional.hpp>
 #include <cpp-utils/pointer/unique_ref.h>
 #include <cpp-utils/data/Data.h>
+#include <cpp-utils/macros.h>
 
 namespace blockstore {
 
@@ -21,6 +23,16 @@ public:
   // Return nullptr if block with this key doesn't exists
   virtual boost::optional<cpputils::unique_ref<Block>> load(const Key &key) = 0;
   virtual void remove(cpputils::unique_ref<Block> block) = 0;
+  // Removes the block without handing it out first. Returns false if the block doesn't exist.
+  // Block stores that can do this without loading (e.g. decrypting) the block should override it.
+  virtual bool remove(const Key &key) {
+    auto block = load(key);
+    if (block == boost::none) {
+      return false;
+    }
+    remove(std::move(*block));
+    return true;
+  }
   virtual uint64_t numBlocks() const = 0;
   //TODO Test estimateNumFreeBytes in all block stores
   virtual uint64_t estimateNumFreeBytes() const = 0;
@@ -29,6 +41,13 @@ public:
   // This can be used to create blocks with a certain physical block size.
   virtual uint64_t blockSizeFromPhysicalBlockSize(uint64_t blockSize) const = 0;
 
+  // Stores changes of the given blocks persistently, including blocks that were already released. Changes of blocks that
+  // are still loaded are only stored after they're flushed. Block stores that keep changes of released blocks in memory
+  // or in temporary files override this.
+  virtual void flush(const std::vector<Key> &keys) {
+    UNUSED(keys);
+  }
+
   cpputils::unique_ref<Block> create(const cpputils::Data &data) {
     while(true) {
       //TODO Copy (data.copy()) necessary?
@@ -9,6 +9,7 @@
 #include <boost/optional.hpp>
 #include <cryptopp/modes.h>
 #include "Cipher.h"
+#include "ThreadLocalCipherMode.h"
 
 namespace cpputils {
 
@@ -31,6 +32,8 @@ public:
 
   static Data encrypt(const CryptoPP::byte *plaintext, unsigned int plaintextSize, const EncryptionKey &encKey);
   static boost::optional<Data> decrypt(const CryptoPP::byte *ciphertext, unsigned int ciphertextSize, const EncryptionKey &encKey);
+  static void encrypt(const CryptoPP::byte *plaintext, unsigned int plaintextSize, CryptoPP::byte *ciphertext, const EncryptionKey &encKey);
+  static bool decrypt(const CryptoPP::byte *ciphertext, unsigned int ciphertextSize, CryptoPP::byte *plaintext, const EncryptionKey &encKey);
 
 private:
   static constexpr unsigned int IV_SIZE = BlockCipher::BLOCKSIZE;
@@ -38,28 +41,43 @@ private:
 
 template<typename BlockCipher, unsigned int KeySize>
 Data CFB_Cipher<BlockCipher, KeySize>::encrypt(const CryptoPP::byte *plaintext, unsigned int plaintextSize, const EncryptionKey &encKey) {
-  FixedSizeData<IV_SIZE> iv = Random::PseudoRandom().getFixedSize<IV_SIZE>();
-  auto encryption = typename CryptoPP::CFB_Mode<BlockCipher>::Encryption(encKey.data(), encKey.BINARY_LENGTH, iv.data());
   Data ciphertext(ciphertextSize(plaintextSize));
-  std::memcpy(ciphertext.data(), iv.data(), IV_SIZE);
-  encryption.ProcessData((CryptoPP::byte*)ciphertext.data() + IV_SIZE, plaintext, plaintextSize);
+  encrypt(plaintext, plaintextSize, (CryptoPP::byte*)ciphertext.data(), encKey);
   return ciphertext;
 }
 
+template<typename BlockCipher, unsigned int KeySize>
+void CFB_Cipher<BlockCipher, KeySize>::encrypt(const CryptoPP::byte *plaintext, unsigned int plaintextSize, CryptoPP::byte *ciphertext, const EncryptionKey &encKey) {
+  FixedSizeData<IV_SIZE> iv = Random::PseudoRandom().getFixedSize<IV_SIZE>();
+  auto &encryption = threadLocalCipherMode<typename CryptoPP::CFB_Mode<BlockCipher>::Encryption>(encKey, iv.data(), IV_SIZE);
+  std::memcpy(ciphertext, iv.data(), IV_SIZE);
+  encryption.ProcessData(ciphertext + IV_SIZE, plaintext, plaintextSize);
+}
+
 template<typename BlockCipher, unsigned int KeySize>
 boost::optional<Data> CFB_Cipher<BlockCipher, KeySize>::decrypt(const CryptoPP::byte *ciphertext, unsigned int ciphertextSize, const EncryptionKey &encKey) {
   if (ciphertextSize < IV_SIZE) {
     return boost::none;
   }
 
-  const CryptoPP::byte *ciphertextIV = ciphertext;
-  const CryptoPP::byte *ciphertextData = ciphertext + IV_SIZE;
-  auto decryption = typename CryptoPP::CFB_Mode<BlockCipher>::Decryption((CryptoPP::byte*)encKey.data(), encKey.BINARY_LENGTH, ciphertextIV);
   Data plaintext(plaintextSize(ciphertextSize));
-  decryption.ProcessData((CryptoPP::byte*)plaintext.data(), ciphertextData, plaintext.size());
+  decrypt(ciphertext, ciphertextSize, (CryptoPP::byte*)plaintext.data(), encKey);
   return std::move(plaintext);
 }
 
+template<typename BlockCipher, unsigned int KeySize>
+bool CFB_Cipher<BlockCipher, KeySize>::decrypt(const CryptoPP::byte *ciphertext, unsigned int ciphertextSize, CryptoPP::byte *plaintext, const EncryptionKey &encKey) {
+  if (ciphertextSize < IV_SIZE) {
+    return false;
+  }
+
+  const CryptoPP::byte *ciphertextIV = ciphertext;
+  const CryptoPP::byte *ciphertextData = ciphertext + IV_SIZE;
+  auto &decryption = threadLocalCipherMode<typename CryptoPP::CFB_Mode<BlockCipher>::Decryption>(encKey, ciphertextIV, IV_SIZE);
+  decryption.ProcessData(plaintext, ciphertextData, plaintextSize(ciphertextSize));
+  return true;
+}
+
 }
 
 #endif
@@ -20,6 +20,10 @@ public:
     typename X::EncryptionKey key = X::CreateKey(Random::OSRandom());
     same_type(Data(0), X::encrypt((uint8_t*)nullptr, UINT32_C(0), key));
     same_type(boost::optional<Data>(Data(0)), X::decrypt((uint8_t*)nullptr, UINT32_C(0), key));
+    // Encrypt into / decrypt into a buffer given by the caller. The target buffer has to have room for
+    // ciphertextSize(plaintextSize) or plaintextSize(ciphertextSize) bytes, and must not overlap the source.
+    X::encrypt((uint8_t*)nullptr, UINT32_C(0), (uint8_t*)nullptr, key);
+    same_type(true, X::decrypt((uint8_t*)nullptr, UINT32_C(0), (uint8_t*)nullptr, key));
     string name = X::NAME;
   }
 
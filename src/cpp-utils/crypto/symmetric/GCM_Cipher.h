@@ -8,6 +8,7 @@
 #include "../../random/Random.h"
 #include <cryptopp/gcm.h>
 #include "Cipher.h"
+#include "ThreadLocalCipherMode.h"
 
 namespace cpputils {
 
@@ -30,6 +31,8 @@ public:
 
     static Data encrypt(const CryptoPP::byte *plaintext, unsigned int plaintextSize, const EncryptionKey &encKey);
     static boost::optional<Data> decrypt(const CryptoPP::byte *ciphertext, unsigned int ciphertextSize, const EncryptionKey &encKey);
+    static void encrypt(const CryptoPP::byte *plaintext, unsigned int plaintextSize, CryptoPP::byte *ciphertext, const EncryptionKey &encKey);
+    static bool decrypt(const CryptoPP::byte *ciphertext, unsigned int ciphertextSize, CryptoPP::byte *plaintext, const EncryptionKey &encKey);
 
 private:
     static constexpr unsigned int IV_SIZE = BlockCipher::BLOCKSIZE;
@@ -38,44 +41,46 @@ private:
 
 template<typename BlockCipher, unsigned int KeySize>
 Data GCM_Cipher<BlockCipher, KeySize>::encrypt(const CryptoPP::byte *plaintext, unsigned int plaintextSize, const EncryptionKey &encKey) {
-    FixedSizeData<IV_SIZE> iv = Random::PseudoRandom().getFixedSize<IV_SIZE>();
-    typename CryptoPP::GCM<BlockCipher, CryptoPP::GCM_64K_Tables>::Encryption encryption;
-    encryption.SetKeyWithIV(encKey.data(), encKey.BINARY_LENGTH, iv.data(), IV_SIZE);
     Data ciphertext(ciphertextSize(plaintextSize));
-
-    std::memcpy(ciphertext.data(), iv.data(), IV_SIZE);
-    CryptoPP::ArraySource(plaintext, plaintextSize, true,
-      new CryptoPP::AuthenticatedEncryptionFilter(encryption,
-        new CryptoPP::ArraySink((CryptoPP::byte*)ciphertext.data() + IV_SIZE, ciphertext.size() - IV_SIZE),
-        false, TAG_SIZE
-      )
-    );
+    encrypt(plaintext, plaintextSize, (CryptoPP::byte*)ciphertext.data(), encKey);
     return ciphertext;
 }
 
+template<typename BlockCipher, unsigned int KeySize>
+void GCM_Cipher<BlockCipher, KeySize>::encrypt(const CryptoPP::byte *plaintext, unsigned int plaintextSize, CryptoPP::byte *ciphertext, const EncryptionKey &encKey) {
+    FixedSizeData<IV_SIZE> iv = Random::PseudoRandom().getFixedSize<IV_SIZE>();
+    auto &encryption = threadLocalCipherMode<typename CryptoPP::GCM<BlockCipher, CryptoPP::GCM_64K_Tables>::Encryption>(encKey, iv.data(), IV_SIZE);
+
+    std::memcpy(ciphertext, iv.data(), IV_SIZE);
+    encryption.EncryptAndAuthenticate(ciphertext + IV_SIZE, ciphertext + IV_SIZE + plaintextSize, TAG_SIZE,
+                                      iv.data(), IV_SIZE, nullptr, 0, plaintext, plaintextSize);
+}
+
 template<typename BlockCipher, unsigned int KeySize>
 boost::optional<Data> GCM_Cipher<BlockCipher, KeySize>::decrypt(const CryptoPP::byte *ciphertext, unsigned int ciphertextSize, const EncryptionKey &encKey) {
     if (ciphertextSize < IV_SIZE + TAG_SIZE) {
       return boost::none;
     }
 
-    const CryptoPP::byte *ciphertextIV = ciphertext;
-    const CryptoPP::byte *ciphertextData = ciphertext + IV_SIZE;
-    typename CryptoPP::GCM<BlockCipher, CryptoPP::GCM_64K_Tables>::Decryption decryption;
-    decryption.SetKeyWithIV((CryptoPP::byte*)encKey.data(), encKey.BINARY_LENGTH, ciphertextIV, IV_SIZE);
     Data plaintext(plaintextSize(ciphertextSize));
-
-    try {
-        CryptoPP::ArraySource((CryptoPP::byte*)ciphertextData, ciphertextSize - IV_SIZE, true,
-        new CryptoPP::AuthenticatedDecryptionFilter(decryption,
-          new CryptoPP::ArraySink((CryptoPP::byte*)plaintext.data(), plaintext.size()),
-          CryptoPP::AuthenticatedDecryptionFilter::DEFAULT_FLAGS, TAG_SIZE
-        )
-      );
-      return std::move(plaintext);
-    } catch (const CryptoPP::HashVerificationFilter::HashVerificationFailed &e) {
+    if (!decrypt(ciphertext, ciphertextSize, (CryptoPP::byte*)plaintext.data(), encKey)) {
       return boost::none;
     }
+    return std::move(plaintext);
+}
+
+template<typename BlockCipher, unsigned int KeySize>
+bool GCM_Cipher<BlockCipher, KeySize>::decrypt(const CryptoPP::byte *ciphertext, unsigned int ciphertextSize, CryptoPP::byte *plaintext, const EncryptionKey &encKey) {
+    if (ciphertextSize < IV_SIZE + TAG_SIZE) {
+      return false;
+    }
+
+    const CryptoPP::byte *ciphertextIV = ciphertext;
+    const CryptoPP::byte *ciphertextData = ciphertext + IV_SIZE;
+    const CryptoPP::byte *ciphertextTag = ciphertext + ciphertextSize - TAG_SIZE;
+    auto &decryption = threadLocalCipherMode<typename CryptoPP::GCM<BlockCipher, CryptoPP::GCM_64K_Tables>::Decryption>(encKey, ciphertextIV, IV_SIZE);
+    return decryption.DecryptAndVerify(plaintext, ciphertextTag, TAG_SIZE, ciphertextIV, IV_SIZE, nullptr, 0,
+                                       ciphertextData, plaintextSize(ciphertextSize));
 }
     
 }
@@ -0,0 +1,40 @@
+#pragma once
+#ifndef MESSMER_CPPUTILS_CRYPTO_SYMMETRIC_THREADLOCALCIPHERMODE_H_
+#define MESSMER_CPPUTILS_CRYPTO_SYMMETRIC_THREADLOCALCIPHERMODE_H_
+
+#include "cpp-utils/crypto/cryptopp_byte.h"
+#include <cryptopp/misc.h>
+#include <cryptopp/sha.h>
+#include <cstring>
+
+namespace cpputils {
+
+// Setting up the key schedule of a cipher mode is expensive (e.g. GCM_64K_Tables precomputes 64KB of tables),
+// so each thread keeps one Mode object and only sets up the key again when it is called with a different key.
+// The returned object is keyed with the given key and set to the given IV.
+// The thread doesn't keep a copy of the key, which would stay in memory until the thread exits. To notice a key
+// change, it only keeps a SHA-256 fingerprint of the key and compares it in constant time.
+template<class Mode, class EncryptionKey>
+Mode &threadLocalCipherMode(const EncryptionKey &encKey, const CryptoPP::byte *iv, unsigned int ivSize) {
+  struct State final {
+    bool isKeyed = false;
+    CryptoPP::byte keyFingerprint[CryptoPP::SHA256::DIGESTSIZE];
+    Mode mode;
+  };
+  static thread_local State state;
+  CryptoPP::byte keyFingerprint[CryptoPP::SHA256::DIGESTSIZE];
+  CryptoPP::SHA256().CalculateDigest(keyFingerprint, encKey.data(), EncryptionKey::BINARY_LENGTH);
+  if (!state.isKeyed || !CryptoPP::VerifyBufsEqual(keyFingerprint, state.keyFingerprint, sizeof(keyFingerprint))) {
+    state.isKeyed = false;
+    state.mode.SetKeyWithIV(encKey.data(), EncryptionKey::BINARY_LENGTH, iv, ivSize);
+    std::memcpy(state.keyFingerprint, keyFingerprint, sizeof(keyFingerprint));
+    state.isKeyed = true;
+  } else {
+    state.mode.Resynchronize(iv, ivSize);
+  }
+  return state.mode;
+}
+
+}
+
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+#ifndef MESSMER_CPPUTILS_CRYPTO_SYMMETRIC_XCHACHA20POLY1305CIPHER_H_
+#define MESSMER_CPPUTILS_CRYPTO_SYMMETRIC_XCHACHA20POLY1305CIPHER_H_
+
+#include "cpp-utils/crypto/cryptopp_byte.h"
+#include "../../data/FixedSizeData.h"
+#include "../../data/Data.h"
+#include "../../random/Random.h"
+#include <boost/optional.hpp>
+#include <cryptopp/chachapoly.h>
+#include "Cipher.h"
+#include "ThreadLocalCipherMode.h"
+
+namespace cpputils {
+
+// ChaCha20-Poly1305 is fast in software, so it is a good choice on CPUs without AES instructions.
+// We use the XChaCha20 variant, because its 192 bit nonce is large enough to be chosen randomly for each block.
+class XChaCha20Poly1305_Cipher {
+public:
+    using EncryptionKey = FixedSizeData<32>;
+
+    static EncryptionKey CreateKey(RandomGenerator &randomGenerator) {
+        return randomGenerator.getFixedSize<EncryptionKey::BINARY_LENGTH>();
+    }
+
+    static constexpr unsigned int ciphertextSize(unsigned int plaintextBlockSize) {
+        return plaintextBlockSize + IV_SIZE + TAG_SIZE;
+    }
+
+    static constexpr unsigned int plaintextSize(unsigned int ciphertextBlockSize) {
+        return ciphertextBlockSize - IV_SIZE - TAG_SIZE;
+    }
+
+    static Data encrypt(const CryptoPP::byte *plaintext, unsigned int plaintextSize, const EncryptionKey &encKey) {
+        Data ciphertext(ciphertextSize(plaintextSize));
+        encrypt(plaintext, plaintextSize, (CryptoPP::byte*)ciphertext.data(), encKey);
+        return ciphertext;
+    }
+
+    static boost::optional<Data> decrypt(const CryptoPP::byte *ciphertext, unsigned int ciphertextSize, const EncryptionKey &encKey) {
+        if (ciphertextSize < IV_SIZE + TAG_SIZE) {
+            return boost::none;
+        }
+
+        Data plaintext(plaintextSize(ciphertextSize));
+        if (!decrypt(ciphertext, ciphertextSize, (CryptoPP::byte*)plaintext.data(), encKey)) {
+            return boost::none;
+        }
+        return std::move(plaintext);
+    }
+
+    static void encrypt(const CryptoPP::byte *plaintext, unsigned int plaintextSize, CryptoPP::byte *ciphertext, const EncryptionKey &encKey) {
+        FixedSizeData<IV_SIZE> iv = Random::PseudoRandom().getFixedSize<IV_SIZE>();
+        auto &encryption = threadLocalCipherMode<CryptoPP::XChaCha20Poly1305::Encryption>(encKey, iv.data(), IV_SIZE);
+
+        std::memcpy(ciphertext, iv.data(), IV_SIZE);
+        encryption.EncryptAndAuthenticate(ciphertext + IV_SIZE, ciphertext + IV_SIZE + plaintextSize, TAG_SIZE,
+                                          iv.data(), IV_SIZE, nullptr, 0, plaintext, plaintextSize);
+    }
+
+    static bool decrypt(const CryptoPP::byte *ciphertext, unsigned int ciphertextSize, CryptoPP::byte *plaintext, const EncryptionKey &encKey) {
+        if (ciphertextSize < IV_SIZE + TAG_SIZE) {
+            return false;
+        }
+
+        const CryptoPP::byte *ciphertextIV = ciphertext;
+        const CryptoPP::byte *ciphertextData = ciphertext + IV_SIZE;
+        const CryptoPP::byte *ciphertextTag = ciphertext + ciphertextSize - TAG_SIZE;
+        auto &decryption = threadLocalCipherMode<CryptoPP::XChaCha20Poly1305::Decryption>(encKey, ciphertextIV, IV_SIZE);
+        return decryption.DecryptAndVerify(plaintext, ciphertextTag, TAG_SIZE, ciphertextIV, IV_SIZE, nullptr, 0,
+                                           ciphertextData, plaintextSize(ciphertextSize));
+    }
+
+private:
+    static constexpr unsigned int IV_SIZE = 24;
+    static constexpr unsigned int TAG_SIZE = 16;
+};
+
+}
+
+#endif
@@ -34,4 +34,8 @@ namespace cpputils {
     DEFINE_CIPHER(Mars128_GCM);
     DEFINE_CIPHER(Mars128_CFB);
 
+#if CRYPTOPP_VERSION >= 810
+    DEFINE_CIPHER(XChaCha20Poly1305);
+#endif
+
 }
@@ -9,6 +9,9 @@
 #include <cryptopp/mars.h>
 #include "GCM_Cipher.h"
 #include "CFB_Cipher.h"
+#if CRYPTOPP_VERSION >= 810
+#include "XChaCha20Poly1305_Cipher.h"
+#endif
 
 #define DECLARE_CIPHER(InstanceName, StringName, Mode, Base, Keysize) \
     class InstanceName final: public Mode<Base, Keysize> {            \
@@ -51,6 +54,14 @@ DECLARE_CIPHER(Mars256_CFB, "mars-256-cfb", CFB_Cipher, CryptoPP::MARS, 32);
 DECLARE_CIPHER(Mars128_GCM, "mars-128-gcm", GCM_Cipher, CryptoPP::MARS, 16);
 DECLARE_CIPHER(Mars128_CFB, "mars-128-cfb", CFB_Cipher, CryptoPP::MARS, 16);
 
+#if CRYPTOPP_VERSION >= 810
+class XChaCha20Poly1305 final: public XChaCha20Poly1305_Cipher {
+public:
+    BOOST_CONCEPT_ASSERT((CipherConcept<XChaCha20Poly1305>));
+    static constexpr const char *NAME = "xchacha20-poly1305";
+};
+#endif
+
 }
 
 #endif
@@ -0,0 +1,24 @@
+#include "hardware_acceleration.h"
+#include <cryptopp/cpu.h>
+
+namespace cpputils {
+    namespace hardware_acceleration {
+#if CRYPTOPP_BOOL_X86 || CRYPTOPP_BOOL_X32 || CRYPTOPP_BOOL_X64
+        bool hasAesInstructions() {
+            return CryptoPP::HasAESNI();
+        }
+
+        bool hasCarrylessMultiplication() {
+            return CryptoPP::HasCLMUL();
+        }
+#else
+        bool hasAesInstructions() {
+            return false;
+        }
+
+        bool hasCarrylessMultiplication() {
+            return false;
+        }
+#endif
+    }
+}
@@ -0,0 +1,14 @@
+#pragma once
+#ifndef MESSMER_CPPUTILS_CRYPTO_SYMMETRIC_HARDWAREACCELERATION_H_
+#define MESSMER_CPPUTILS_CRYPTO_SYMMETRIC_HARDWAREACCELERATION_H_
+
+namespace cpputils {
+    namespace hardware_acceleration {
+        // Crypto++ detects these CPU features at runtime and then uses them for AES (AES-NI) and GCM (PCLMULQDQ).
+        // Without them, ciphers run in software and xchacha20-poly1305 is usually faster than the AES ciphers.
+        bool hasAesInstructions();
+        bool hasCarrylessMultiplication();
+    }
+}
+
+#endif
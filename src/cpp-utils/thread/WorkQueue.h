@@ -0,0 +1,118 @@
+#pragma once
+#ifndef MESSMER_CPPUTILS_THREAD_WORKQUEUE_H
+#define MESSMER_CPPUTILS_THREAD_WORKQUEUE_H
+
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <boost/thread.hpp>
+#include "LoopThread.h"
+#include "../assert/assert.h"
+#include "../logging/logging.h"
+#include "../macros.h"
+#include "../pointer/gcc_4_8_compatibility.h"
+
+namespace cpputils {
+
+    // Runs jobs on a fixed set of background threads, in the order they were pushed.
+    // The threads are started once and use LoopThread, so they survive a fork() of the process.
+    // When the WorkQueue is destructed, the threads are stopped and jobs that are still queued don't run anymore.
+    template<class Job>
+    class WorkQueue final {
+    public:
+        static constexpr size_t UNLIMITED = std::numeric_limits<size_t>::max();
+
+        // runJob is called on one of the threads for each job. If it throws, the error is logged.
+        WorkQueue(unsigned int numThreads, std::function<void (Job)> runJob, size_t maxQueueSize = UNLIMITED);
+
+        // Returns false and drops the job if maxQueueSize jobs are already waiting
+        bool push(Job job);
+
+        // Blocks until no job is queued or running anymore
+        void waitUntilIdle();
+
+        // Stops the threads and returns the jobs that didn't run yet
+        std::deque<Job> stop();
+
+    private:
+        bool _loopIteration();
+
+        const std::function<void (Job)> _runJob;
+        const size_t _maxQueueSize;
+        boost::mutex _mutex;
+        // These have to be boost::condition_variable and not std::condition_variable, because waiting has to be
+        // interruptible, so LoopThread can stop the threads.
+        boost::condition_variable _jobAdded;
+        boost::condition_variable _jobFinished;
+        std::deque<Job> _queue;
+        unsigned int _numRunning;
+
+        // This member has to be last, so the threads are destructed first.
+        std::vector<std::unique_ptr<LoopThread>> _threads;
+
+        DISALLOW_COPY_AND_ASSIGN(WorkQueue);
+    };
+
+    template<class Job> constexpr size_t WorkQueue<Job>::UNLIMITED;
+
+    template<class Job>
+    WorkQueue<Job>::WorkQueue(unsigned int numThreads, std::function<void (Job)> runJob, size_t maxQueueSize)
+        : _runJob(std::move(runJob)), _maxQueueSize(maxQueueSize), _mutex(), _jobAdded(), _jobFinished(), _queue(),
+          _numRunning(0), _threads() {
+        ASSERT(numThreads > 0, "Need at least one thread");
+        for (unsigned int i = 0; i < numThreads; ++i) {
+            _threads.push_back(std::make_unique<LoopThread>(std::bind(&WorkQueue::_loopIteration, this)));
+            _threads.back()->start();
+        }
+    }
+
+    template<class Job>
+    bool WorkQueue<Job>::push(Job job) {
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        if (_queue.size() >= _maxQueueSize) {
+            return false;
+        }
+        _queue.push_back(std::move(job));
+        _jobAdded.notify_one();
+        return true;
+    }
+
+    template<class Job>
+    void WorkQueue<Job>::waitUntilIdle() {
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        _jobFinished.wait(lock, [this] {return _queue.empty() && _numRunning == 0;});
+    }
+
+    template<class Job>
+    std::deque<Job> WorkQueue<Job>::stop() {
+        // Destructing the LoopThreads stops them
+        _threads.clear();
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        return std::move(_queue);
+    }
+
+    template<class Job>
+    bool WorkQueue<Job>::_loopIteration() {
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        _jobAdded.wait(lock, [this] {return !_queue.empty();});
+        Job job = std::move(_queue.front());
+        _queue.pop_front();
+        ++_numRunning;
+        lock.unlock();
+
+        try {
+            _runJob(std::move(job));
+        } catch (const std::exception &e) {
+            logging::LOG(logging::ERROR, "Background job failed: {}", e.what());
+        }
+
+        lock.lock();
+        --_numRunning;
+        _jobFinished.notify_all();
+        return true; // Run another iteration (don't terminate thread)
+    }
+}
+
+#endif
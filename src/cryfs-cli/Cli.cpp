@@ -1,6 +1,7 @@
 #include "Cli.h"
 
 #include <blockstore/implementations/ondisk/OnDiskBlockStore.h>
+#include <blockstore/implementations/logstructured/LogStructuredBlockStore.h>
 #include <blockstore/implementations/inmemory/InMemoryBlockStore.h>
 #include <blockstore/implementations/inmemory/InMemoryBlock.h>
 #include <cmath>
@@ -9,6 +10,7 @@
 #include <cpp-utils/assert/backtrace.h>
 
 #include <fspp/fuse/Fuse.h>
+#include <fspp/fuse/FuseLowLevel.h>
 #include <fspp/impl/FilesystemImpl.h>
 #include <cpp-utils/process/subprocess.h>
 #include <cpp-utils/io/DontEchoStdinToStdoutRAII.h>
@@ -33,6 +35,8 @@ namespace bf = boost::filesystem;
 using namespace cpputils::logging;
 
 using blockstore::ondisk::OnDiskBlockStore;
+using blockstore::logstructured::LogStructuredBlockStore;
+using blockstore::BlockStore;
 using blockstore::inmemory::InMemoryBlockStore;
 using program_options::ProgramOptions;
 
@@ -73,6 +77,11 @@ using gitversion::VersionCompare;
 
 namespace cryfs {
 
+    // Same default as libfuse uses for the high-level API
+    constexpr double DEFAULT_FUSE_TIMEOUT_SECONDS = 1.0;
+    // libfuse caps write requests at this size
+    constexpr uint64_t MAX_FUSE_WRITE_BYTES = 128 * 1024;
+
     Cli::Cli(RandomGenerator &keyGenerator, const SCryptSettings &scryptSettings, shared_ptr<Console> console, shared_ptr<HttpClient> httpClient):
             _keyGenerator(keyGenerator), _scryptSettings(scryptSettings), _console(), _httpClient(httpClient), _noninteractive(false) {
         _noninteractive = Environment::isNoninteractive();
@@ -201,7 +210,7 @@ namespace cryfs {
     CryConfigFile Cli::_loadOrCreateConfig(const ProgramOptions &options) {
         try {
             auto configFile = _determineConfigFile(options);
-            auto config = _loadOrCreateConfigFile(configFile, options.cipher(), options.blocksizeBytes());
+            auto config = _loadOrCreateConfigFile(configFile, options.cipher(), options.blocksizeBytes(), options.blockstoreLayout());
             if (config == none) {
                 std::cerr << "Could not load config file. Did you enter the correct password?" << std::endl;
                 exit(1);
@@ -213,44 +222,47 @@ namespace cryfs {
         }
     }
 
-    optional<CryConfigFile> Cli::_loadOrCreateConfigFile(const bf::path &configFilePath, const optional<string> &cipher, const optional<uint32_t> &blocksizeBytes) {
+    optional<CryConfigFile> Cli::_loadOrCreateConfigFile(const bf::path &configFilePath, const optional<string> &cipher, const optional<uint32_t> &blocksizeBytes, const optional<string> &blockstoreLayout) {
         if (_noninteractive) {
             return CryConfigLoader(_console, _keyGenerator, _scryptSettings,
                                    &Cli::_askPasswordNoninteractive,
                                    &Cli::_askPasswordNoninteractive,
-                                   cipher, blocksizeBytes).loadOrCreate(configFilePath);
+                                   cipher, blocksizeBytes, blockstoreLayout).loadOrCreate(configFilePath);
         } else {
             return CryConfigLoader(_console, _keyGenerator, _scryptSettings,
                                    &Cli::_askPasswordForExistingFilesystem,
                                    &Cli::_askPasswordForNewFilesystem,
-                                   cipher, blocksizeBytes).loadOrCreate(configFilePath);
+                                   cipher, blocksizeBytes, blockstoreLayout).loadOrCreate(configFilePath);
         }
     }
 
+    unique_ref<BlockStore> Cli::_createBlockStore(const ProgramOptions &options, const CryConfig &config) {
+        if (config.BlockstoreLayout() == CryConfig::BLOCKSTORE_LAYOUT_LOG_STRUCTURED) {
+            return make_unique_ref<LogStructuredBlockStore>(options.baseDir());
+        }
+        if (config.BlockstoreLayout() != CryConfig::BLOCKSTORE_LAYOUT_FILE_PER_BLOCK) {
+            throw std::runtime_error("Unknown blockstore layout " + config.BlockstoreLayout() + ". Maybe the filesystem was created with a newer version of CryFS?");
+        }
+        auto writeMode = options.atomicWrites() ? OnDiskBlockStore::WriteMode::ATOMIC : OnDiskBlockStore::WriteMode::IN_PLACE;
+        return make_unique_ref<OnDiskBlockStore>(options.baseDir(), writeMode);
+    }
+
     void Cli::_runFilesystem(const ProgramOptions &options) {
         try {
-            auto blockStore = make_unique_ref<OnDiskBlockStore>(options.baseDir());
+            // The config has to be loaded first, because it says how the blocks are stored in the base directory
             auto config = _loadOrCreateConfig(options);
-            CryDevice device(std::move(config), std::move(blockStore));
+            auto blockStore = _createBlockStore(options, *config.config());
+            CryDevice device(std::move(config), std::move(blockStore), options.cacheSizeBytes(), _atimeBehavior(options.atimeBehavior()), options.lazytime());
             _sanityCheckFilesystem(&device);
             fspp::FilesystemImpl fsimpl(&device);
-            fspp::fuse::Fuse fuse(&fsimpl, "cryfs", "cryfs@"+options.baseDir().native());
-
-            _initLogfile(options);
-
-            //TODO Test auto unmounting after idle timeout
-            //TODO This can fail due to a race condition if the filesystem isn't started yet (e.g. passing --unmount-idle 0").
-            auto idleUnmounter = _createIdleCallback(options.unmountAfterIdleMinutes(), [&fuse] {fuse.stop();});
-            if (idleUnmounter != none) {
-                device.onFsAction(std::bind(&CallAfterTimeout::resetTimer, idleUnmounter->get()));
+            string fsname = "cryfs@"+options.baseDir().native();
+            if (options.fuseLowLevel()) {
+                fspp::fuse::FuseLowLevel fuse(&fsimpl, "cryfs", fsname, options.entryTimeoutSeconds().value_or(DEFAULT_FUSE_TIMEOUT_SECONDS), options.attrTimeoutSeconds().value_or(DEFAULT_FUSE_TIMEOUT_SECONDS), _fuseMaxWriteBytes(device), options.fuseThreads());
+                _mountAndRun(&fuse, &device, options);
+            } else {
+                fspp::fuse::Fuse fuse(&fsimpl, "cryfs", fsname, _fuseMaxWriteBytes(device), options.fuseThreads());
+                _mountAndRun(&fuse, &device, options);
             }
-
-#ifdef __APPLE__
-            std::cout << "\nMounting filesystem. To unmount, call:\n$ umount " << options.mountDir() << "\n" << std::endl;
-#else
-            std::cout << "\nMounting filesystem. To unmount, call:\n$ fusermount -u " << options.mountDir() << "\n" << std::endl;
-#endif
-            fuse.run(options.mountDir(), options.fuseOptions());
         } catch (const std::exception &e) {
             LOG(ERROR, "Crashed: {}", e.what());
         } catch (...) {
@@ -258,6 +270,48 @@ namespace cryfs {
         }
     }
 
+    uint32_t Cli::_fuseMaxWriteBytes(const CryDevice &device) {
+        // Let write requests cover whole leaves, so each leaf is filled from a single request
+        uint64_t leafSize = device.leafSizeBytes();
+        if (leafSize >= MAX_FUSE_WRITE_BYTES) {
+            return MAX_FUSE_WRITE_BYTES;
+        }
+        return MAX_FUSE_WRITE_BYTES / leafSize * leafSize;
+    }
+
+    fsblobstore::AtimeUpdateBehavior Cli::_atimeBehavior(const optional<string> &atimeBehavior) {
+        // Like Linux, default to relatime, so that reading files doesn't write to their directory each time
+        if (atimeBehavior == none || *atimeBehavior == "relatime") {
+            return fsblobstore::AtimeUpdateBehavior::RELATIME;
+        }
+        if (*atimeBehavior == "strictatime") {
+            return fsblobstore::AtimeUpdateBehavior::STRICTATIME;
+        }
+        if (*atimeBehavior == "noatime") {
+            return fsblobstore::AtimeUpdateBehavior::NOATIME;
+        }
+        throw std::runtime_error("Unknown atime behavior " + *atimeBehavior);
+    }
+
+    template<class FuseBackend>
+    void Cli::_mountAndRun(FuseBackend *fuse, CryDevice *device, const ProgramOptions &options) {
+        _initLogfile(options);
+
+        //TODO Test auto unmounting after idle timeout
+        //TODO This can fail due to a race condition if the filesystem isn't started yet (e.g. passing --unmount-idle 0").
+        auto idleUnmounter = _createIdleCallback(options.unmountAfterIdleMinutes(), [fuse] {fuse->stop();});
+        if (idleUnmounter != none) {
+            device->onFsAction(std::bind(&CallAfterTimeout::resetTimer, idleUnmounter->get()));
+        }
+
+#ifdef __APPLE__
+        std::cout << "\nMounting filesystem. To unmount, call:\n$ umount " << options.mountDir() << "\n" << std::endl;
+#else
+        std::cout << "\nMounting filesystem. To unmount, call:\n$ fusermount -u " << options.mountDir() << "\n" << std::endl;
+#endif
+        fuse->run(options.mountDir(), options.fuseOptions());
+    }
+
     void Cli::_sanityCheckFilesystem(CryDevice *device) {
         //Try to list contents of base directory
         auto _rootDir = device->Load("/"); // this might throw an exception if the root blob doesn't exist
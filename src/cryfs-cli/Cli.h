@@ -21,8 +21,12 @@ namespace cryfs {
     private:
         void _checkForUpdates();
         void _runFilesystem(const program_options::ProgramOptions &options);
+        static uint32_t _fuseMaxWriteBytes(const CryDevice &device);
+        static fsblobstore::AtimeUpdateBehavior _atimeBehavior(const boost::optional<std::string> &atimeBehavior);
+        template<class FuseBackend> void _mountAndRun(FuseBackend *fuse, CryDevice *device, const program_options::ProgramOptions &options);
         CryConfigFile _loadOrCreateConfig(const program_options::ProgramOptions &options);
-        boost::optional<CryConfigFile> _loadOrCreateConfigFile(const boost::filesystem::path &configFilePath, const boost::optional<std::string> &cipher, const boost::optional<uint32_t> &blocksizeBytes);
+        boost::optional<CryConfigFile> _loadOrCreateConfigFile(const boost::filesystem::path &configFilePath, const boost::optional<std::string> &cipher, const boost::optional<uint32_t> &blocksizeBytes, const boost::optional<std::string> &blockstoreLayout);
+        cpputils::unique_ref<blockstore::BlockStore> _createBlockStore(const program_options::ProgramOptions &options, const CryConfig &config);
         boost::filesystem::path _determineConfigFile(const program_options::ProgramOptions &options);
         static std::string _askPasswordForExistingFilesystem();
         static std::string _askPasswordForNewFilesystem();
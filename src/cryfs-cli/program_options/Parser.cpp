@@ -3,12 +3,17 @@
 #include <iostream>
 #include <boost/optional.hpp>
 #include <cryfs/config/CryConfigConsole.h>
+#include <cryfs/config/CryCipher.h>
+#include <cryfs/config/CryConfig.h>
+#include <cpp-utils/crypto/symmetric/hardware_acceleration.h>
+#include <iomanip>
 #include <cryfs-cli/Environment.h>
 
 namespace po = boost::program_options;
 namespace bf = boost::filesystem;
 using namespace cryfs::program_options;
 using cryfs::CryConfigConsole;
+using cryfs::CryConfig;
 using std::pair;
 using std::vector;
 using std::cerr;
@@ -69,7 +74,35 @@ ProgramOptions Parser::parse(const vector<string> &supportedCiphers) const {
         blocksizeBytes = vm["blocksize"].as<uint32_t>();
     }
 
-    return ProgramOptions(baseDir, mountDir, configfile, foreground, unmountAfterIdleMinutes, logfile, cipher, blocksizeBytes, options.second);
+    optional<string> blockstoreLayout = none;
+    if (vm.count("blockstore-layout")) {
+        blockstoreLayout = vm["blockstore-layout"].as<string>();
+        _checkValidBlockstoreLayout(*blockstoreLayout);
+    }
+
+    MountOptions mountOptions;
+    if (vm.count("cache-size")) {
+        mountOptions.cacheSizeBytes = _parseCacheSize(vm["cache-size"].as<string>());
+    }
+    mountOptions.fuseLowLevel = vm.count("fuse-lowlevel");
+    if (vm.count("entry-timeout")) {
+        mountOptions.entryTimeoutSeconds = vm["entry-timeout"].as<double>();
+    }
+    if (vm.count("attr-timeout")) {
+        mountOptions.attrTimeoutSeconds = vm["attr-timeout"].as<double>();
+    }
+    if (vm.count("fuse-threads")) {
+        mountOptions.fuseThreads = vm["fuse-threads"].as<uint32_t>();
+        _checkValidFuseThreads(*mountOptions.fuseThreads);
+    }
+    if (vm.count("atime")) {
+        mountOptions.atimeBehavior = vm["atime"].as<string>();
+        _checkValidAtimeBehavior(*mountOptions.atimeBehavior);
+    }
+    mountOptions.lazytime = vm.count("lazytime");
+    mountOptions.atomicWrites = vm.count("atomic-writes");
+
+    return ProgramOptions(baseDir, mountDir, configfile, foreground, unmountAfterIdleMinutes, logfile, cipher, blocksizeBytes, blockstoreLayout, mountOptions, options.second);
 }
 
 void Parser::_checkValidCipher(const string &cipher, const vector<string> &supportedCiphers) {
@@ -79,6 +112,36 @@ void Parser::_checkValidCipher(const string &cipher, const vector<string> &suppo
     }
 }
 
+void Parser::_checkValidBlockstoreLayout(const string &blockstoreLayout) {
+    if (blockstoreLayout != CryConfig::BLOCKSTORE_LAYOUT_FILE_PER_BLOCK && blockstoreLayout != CryConfig::BLOCKSTORE_LAYOUT_LOG_STRUCTURED) {
+        std::cerr << "Invalid blockstore layout: " << blockstoreLayout << std::endl;
+        exit(1);
+    }
+}
+
+void Parser::_checkValidFuseThreads(uint32_t fuseThreads) {
+    if (fuseThreads == 0) {
+        std::cerr << "Invalid number of FUSE threads: " << fuseThreads << std::endl;
+        exit(1);
+    }
+}
+
+void Parser::_checkValidAtimeBehavior(const string &atimeBehavior) {
+    if (atimeBehavior != "strictatime" && atimeBehavior != "relatime" && atimeBehavior != "noatime") {
+        std::cerr << "Invalid atime behavior: " << atimeBehavior << std::endl;
+        exit(1);
+    }
+}
+
+uint64_t Parser::_parseCacheSize(const string &cacheSize) {
+    optional<uint64_t> result = parseByteSize(cacheSize);
+    if (result == none) {
+        std::cerr << "Invalid cache size: " << cacheSize << std::endl;
+        exit(1);
+    }
+    return *result;
+}
+
 po::variables_map Parser::_parseOptionsOrShowHelp(const vector<string> &options, const vector<string> &supportedCiphers) {
     try {
         return _parseOptions(options, supportedCiphers);
@@ -104,6 +167,13 @@ po::variables_map Parser::_parseOptions(const vector<string> &options, const vec
     if (vm.count("show-ciphers")) {
         _showCiphersAndExit(supportedCiphers);
     }
+    if (vm.count("benchmark-ciphers")) {
+        uint32_t blocksizeBytes = CryConfigConsole::DEFAULT_BLOCKSIZE_BYTES;
+        if (vm.count("blocksize")) {
+            blocksizeBytes = vm["blocksize"].as<uint32_t>();
+        }
+        _benchmarkCiphersAndExit(supportedCiphers, blocksizeBytes);
+    }
     po::notify(vm);
 
     return vm;
@@ -130,8 +200,18 @@ void Parser::_addAllowedOptions(po::options_description *desc) {
             ("foreground,f", "Run CryFS in foreground.")
             ("cipher", po::value<string>(), cipher_description.c_str())
             ("blocksize", po::value<uint32_t>(), blocksize_description.c_str())
+            ("cache-size", po::value<string>(), "Memory used for caching blocks (decrypted data and ciphertext), e.g. 512M or 2G. Default: 64M")
+            ("blockstore-layout", po::value<string>(), "How blocks are stored in the base directory when creating a new filesystem. \"file-per-block\" stores each block in its own file, \"log-structured\" packs many blocks into large segment files. Default: file-per-block")
             ("show-ciphers", "Show list of supported ciphers.")
+            ("benchmark-ciphers", "Measure how fast each supported cipher is on this machine, using the block size given with --blocksize.")
             ("unmount-idle", po::value<double>(), "Automatically unmount after specified number of idle minutes.")
+            ("fuse-lowlevel", "Run on the FUSE low-level API. The kernel then caches lookups and file attributes for the time given with --entry-timeout and --attr-timeout.")
+            ("entry-timeout", po::value<double>(), "Seconds the kernel caches directory entries when running with --fuse-lowlevel. Default: 1")
+            ("attr-timeout", po::value<double>(), "Seconds the kernel caches file attributes when running with --fuse-lowlevel. Default: 1")
+            ("fuse-threads", po::value<uint32_t>(), "Number of threads processing filesystem requests, e.g. the number of CPU cores. Default: started on demand by libfuse")
+            ("atime", po::value<string>(), "When reading a file updates its access timestamp, like the mount options of the same name: strictatime, relatime or noatime. Default: relatime")
+            ("lazytime", "Keep timestamp and size updates of open files in memory and only store them when the file is flushed or closed, or after a minute.")
+            ("atomic-writes", "Replace changed blocks by renaming a new block file over the old one, so a crash can't leave a partially written block behind. Slower. Only for the file-per-block layout.")
             ("logfile", po::value<string>(), "Specify the file to write log messages to. If this is not specified, log messages will go to stdout, or syslog if CryFS is running in the background.")
             ;
     desc->add(options);
@@ -155,6 +235,21 @@ void Parser::_addPositionalOptionForBaseDir(po::options_description *desc, po::p
     exit(0);
 }
 
+[[noreturn]] void Parser::_benchmarkCiphersAndExit(const vector<string> &supportedCiphers, uint32_t blocksizeBytes) {
+    constexpr std::chrono::milliseconds DURATION(250);
+    auto yesNo = [] (bool value) {return value ? "yes" : "no";};
+    std::cerr << "Benchmarking ciphers with a block size of " << blocksizeBytes << " bytes"
+              << " (AES instructions: " << yesNo(cpputils::hardware_acceleration::hasAesInstructions())
+              << ", carry-less multiplication: " << yesNo(cpputils::hardware_acceleration::hasCarrylessMultiplication()) << ")\n";
+    std::cerr << std::left << std::setw(22) << "Cipher" << std::right << std::setw(14) << "Encrypt MB/s" << std::setw(14) << "Decrypt MB/s" << "\n";
+    std::cerr << std::fixed << std::setprecision(1);
+    for (const auto &cipher : supportedCiphers) {
+        auto throughput = cryfs::CryCiphers::find(cipher).benchmark(blocksizeBytes, DURATION);
+        std::cerr << std::left << std::setw(22) << cipher << std::right << std::setw(14) << throughput.encryptMBps << std::setw(14) << throughput.decryptMBps << std::endl;
+    }
+    exit(0);
+}
+
 [[noreturn]] void Parser::_showHelpAndExit() {
     cerr << "Usage: cryfs [options] baseDir mountPoint [-- [FUSE Mount Options]]\n";
     po::options_description desc;
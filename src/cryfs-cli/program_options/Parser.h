@@ -21,9 +21,14 @@ namespace cryfs {
                                                        boost::program_options::positional_options_description *positional);
             [[noreturn]] static void _showHelpAndExit();
             [[noreturn]] static void _showCiphersAndExit(const std::vector<std::string> &supportedCiphers);
+            [[noreturn]] static void _benchmarkCiphersAndExit(const std::vector<std::string> &supportedCiphers, uint32_t blocksizeBytes);
             static boost::program_options::variables_map _parseOptionsOrShowHelp(const std::vector<std::string> &options, const std::vector<std::string> &supportedCiphers);
             static boost::program_options::variables_map _parseOptions(const std::vector<std::string> &options, const std::vector<std::string> &supportedCiphers);
             static void _checkValidCipher(const std::string &cipher, const std::vector<std::string> &supportedCiphers);
+            static void _checkValidBlockstoreLayout(const std::string &blockstoreLayout);
+            static void _checkValidFuseThreads(uint32_t fuseThreads);
+            static void _checkValidAtimeBehavior(const std::string &atimeBehavior);
+            static uint64_t _parseCacheSize(const std::string &cacheSize);
 
             std::vector<std::string> _options;
 
@@ -12,10 +12,13 @@ ProgramOptions::ProgramOptions(const bf::path &baseDir, const bf::path &mountDir
                                bool foreground, const optional<double> &unmountAfterIdleMinutes,
                                const optional<bf::path> &logFile, const optional<string> &cipher,
                                const optional<uint32_t> &blocksizeBytes,
+                               const optional<string> &blockstoreLayout,
+                               const MountOptions &mountOptions,
                                const vector<string> &fuseOptions)
     :_baseDir(baseDir), _mountDir(mountDir), _configFile(configFile), _foreground(foreground),
-     _cipher(cipher), _blocksizeBytes(blocksizeBytes), _unmountAfterIdleMinutes(unmountAfterIdleMinutes),
-     _logFile(logFile), _fuseOptions(fuseOptions) {
+     _cipher(cipher), _blocksizeBytes(blocksizeBytes), _blockstoreLayout(blockstoreLayout),
+     _unmountAfterIdleMinutes(unmountAfterIdleMinutes),
+     _logFile(logFile), _mountOptions(mountOptions), _fuseOptions(fuseOptions) {
 }
 
 const bf::path &ProgramOptions::baseDir() const {
@@ -50,6 +53,42 @@ const optional<uint32_t> &ProgramOptions::blocksizeBytes() const {
     return _blocksizeBytes;
 }
 
+const optional<uint64_t> &ProgramOptions::cacheSizeBytes() const {
+    return _mountOptions.cacheSizeBytes;
+}
+
+const optional<string> &ProgramOptions::blockstoreLayout() const {
+    return _blockstoreLayout;
+}
+
+bool ProgramOptions::fuseLowLevel() const {
+    return _mountOptions.fuseLowLevel;
+}
+
+const optional<double> &ProgramOptions::entryTimeoutSeconds() const {
+    return _mountOptions.entryTimeoutSeconds;
+}
+
+const optional<double> &ProgramOptions::attrTimeoutSeconds() const {
+    return _mountOptions.attrTimeoutSeconds;
+}
+
+const optional<uint32_t> &ProgramOptions::fuseThreads() const {
+    return _mountOptions.fuseThreads;
+}
+
+const optional<string> &ProgramOptions::atimeBehavior() const {
+    return _mountOptions.atimeBehavior;
+}
+
+bool ProgramOptions::lazytime() const {
+    return _mountOptions.lazytime;
+}
+
+bool ProgramOptions::atomicWrites() const {
+    return _mountOptions.atomicWrites;
+}
+
 const vector<string> &ProgramOptions::fuseOptions() const {
     return _fuseOptions;
 }
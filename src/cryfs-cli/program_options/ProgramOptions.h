@@ -10,6 +10,19 @@
 
 namespace cryfs {
     namespace program_options {
+        // Settings for how the file system is mounted and cached. They don't change what is stored.
+        // Settings that weren't given on the command line keep these defaults.
+        struct MountOptions final {
+            boost::optional<uint64_t> cacheSizeBytes = boost::none;
+            bool fuseLowLevel = false;
+            boost::optional<double> entryTimeoutSeconds = boost::none;
+            boost::optional<double> attrTimeoutSeconds = boost::none;
+            boost::optional<uint32_t> fuseThreads = boost::none;
+            boost::optional<std::string> atimeBehavior = boost::none;
+            bool lazytime = false;
+            bool atomicWrites = false;
+        };
+
         class ProgramOptions final {
         public:
             ProgramOptions(const boost::filesystem::path &baseDir, const boost::filesystem::path &mountDir,
@@ -18,6 +31,8 @@ namespace cryfs {
                            const boost::optional<boost::filesystem::path> &logFile,
                            const boost::optional<std::string> &cipher,
                            const boost::optional<uint32_t> &blocksizeBytes,
+                           const boost::optional<std::string> &blockstoreLayout,
+                           const MountOptions &mountOptions,
                            const std::vector<std::string> &fuseOptions);
             ProgramOptions(ProgramOptions &&rhs) = default;
 
@@ -27,8 +42,17 @@ namespace cryfs {
             bool foreground() const;
             const boost::optional<std::string> &cipher() const;
             const boost::optional<uint32_t> &blocksizeBytes() const;
+            const boost::optional<uint64_t> &cacheSizeBytes() const;
+            const boost::optional<std::string> &blockstoreLayout() const;
             const boost::optional<double> &unmountAfterIdleMinutes() const;
             const boost::optional<boost::filesystem::path> &logFile() const;
+            bool fuseLowLevel() const;
+            const boost::optional<double> &entryTimeoutSeconds() const;
+            const boost::optional<double> &attrTimeoutSeconds() const;
+            const boost::optional<uint32_t> &fuseThreads() const;
+            const boost::optional<std::string> &atimeBehavior() const;
+            bool lazytime() const;
+            bool atomicWrites() const;
             const std::vector<std::string> &fuseOptions() const;
 
         private:
@@ -38,8 +62,10 @@ namespace cryfs {
             bool _foreground;
             boost::optional<std::string> _cipher;
             boost::optional<uint32_t> _blocksizeBytes;
+            boost::optional<std::string> _blockstoreLayout;
             boost::optional<double> _unmountAfterIdleMinutes;
             boost::optional<boost::filesystem::path> _logFile;
+            MountOptions _mountOptions;
             std::vector<std::string> _fuseOptions;
 
             DISALLOW_COPY_AND_ASSIGN(ProgramOptions);
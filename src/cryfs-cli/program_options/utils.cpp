@@ -1,11 +1,15 @@
 #include "utils.h"
 #include <algorithm>
 #include <string>
+#include <cctype>
+#include <limits>
 
 using std::pair;
 using std::make_pair;
 using std::vector;
 using std::string;
+using boost::optional;
+using boost::none;
 
 namespace cryfs {
     namespace program_options {
@@ -23,5 +27,36 @@ namespace cryfs {
             );
         }
 
+        optional<uint64_t> parseByteSize(const string &size) {
+            if (size.empty() || !std::isdigit(static_cast<unsigned char>(size[0]))) {
+                return none;
+            }
+            size_t numberEnd = 0;
+            uint64_t number = 0;
+            try {
+                number = std::stoull(size, &numberEnd);
+            } catch (const std::out_of_range &) {
+                return none;
+            }
+            string suffix = size.substr(numberEnd);
+            unsigned int shift = 0;
+            if (suffix == "") {
+                shift = 0;
+            } else if (suffix == "K" || suffix == "k") {
+                shift = 10;
+            } else if (suffix == "M" || suffix == "m") {
+                shift = 20;
+            } else if (suffix == "G" || suffix == "g") {
+                shift = 30;
+            } else if (suffix == "T" || suffix == "t") {
+                shift = 40;
+            } else {
+                return none;
+            }
+            if (number > (std::numeric_limits<uint64_t>::max() >> shift)) {
+                return none;
+            }
+            return number << shift;
+        }
     }
 }
@@ -5,6 +5,8 @@
 #include <utility>
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <boost/optional.hpp>
 
 namespace cryfs {
     namespace program_options {
@@ -12,6 +14,12 @@ namespace cryfs {
          * Splits an array of program options into two arrays of program options, split at a double dash '--' option.
          */
         std::pair<std::vector<std::string>, std::vector<std::string>> splitAtDoubleDash(const std::vector<std::string> &options);
+
+        /**
+         * Parses a size in bytes with an optional binary suffix, e.g. "4096", "512K", "512M" or "2G".
+         * Returns none if the size isn't valid.
+         */
+        boost::optional<uint64_t> parseByteSize(const std::string &size);
     }
 }
 
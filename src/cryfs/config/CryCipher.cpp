@@ -3,6 +3,7 @@
 #include <cpp-utils/crypto/symmetric/ciphers.h>
 #include <blockstore/implementations/encrypted/EncryptedBlockStore.h>
 #include "crypto/inner/ConcreteInnerEncryptor.h"
+#include <functional>
 
 using std::vector;
 using std::string;
@@ -21,6 +22,22 @@ using namespace cpputils;
 
 constexpr size_t CryCiphers::MAX_KEY_SIZE;
 
+namespace {
+    // Runs the operation repeatedly for the given duration and returns the number of MB processed per second
+    double _measureMBps(uint32_t bytesPerOperation, std::chrono::milliseconds duration, const std::function<void()> &operation) {
+        uint64_t numBytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        auto elapsed = std::chrono::steady_clock::duration::zero();
+        do {
+            operation();
+            numBytes += bytesPerOperation;
+            elapsed = std::chrono::steady_clock::now() - start;
+        } while (elapsed < duration);
+        double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(elapsed).count();
+        return static_cast<double>(numBytes) / seconds / (1024 * 1024);
+    }
+}
+
 template<typename Cipher>
 class CryCipherInstance: public CryCipher {
 public:
@@ -51,6 +68,23 @@ public:
         return make_unique_ref<ConcreteInnerEncryptor<Cipher>>(key.take<Cipher::EncryptionKey::BINARY_LENGTH>());
     }
 
+    CryCipherThroughput benchmark(uint32_t blocksizeBytes, std::chrono::milliseconds duration) const override {
+        auto encKey = Cipher::CreateKey(Random::PseudoRandom());
+        uint32_t plaintextSize = (blocksizeBytes > Cipher::ciphertextSize(0)) ? Cipher::plaintextSize(blocksizeBytes) : 0;
+        Data plaintext = Random::PseudoRandom().get(plaintextSize);
+        Data ciphertext(Cipher::ciphertextSize(plaintextSize));
+
+        CryCipherThroughput result;
+        result.encryptMBps = _measureMBps(plaintextSize, duration, [&] {
+            Cipher::encrypt(static_cast<const CryptoPP::byte*>(plaintext.data()), plaintext.size(), static_cast<CryptoPP::byte*>(ciphertext.data()), encKey);
+        });
+        result.decryptMBps = _measureMBps(plaintextSize, duration, [&] {
+            bool success = Cipher::decrypt(static_cast<const CryptoPP::byte*>(ciphertext.data()), ciphertext.size(), static_cast<CryptoPP::byte*>(plaintext.data()), encKey);
+            ASSERT(success, "Decrypting the benchmark data failed");
+        });
+        return result;
+    }
+
 private:
     optional<string> _warning;
 };
@@ -80,7 +114,10 @@ const vector<shared_ptr<CryCipher>> CryCiphers::SUPPORTED_CIPHERS = {
         make_shared<CryCipherInstance<Mars256_GCM>>(),
         make_shared<CryCipherInstance<Mars256_CFB>>(INTEGRITY_WARNING),
         make_shared<CryCipherInstance<Mars128_GCM>>(),
-        make_shared<CryCipherInstance<Mars128_CFB>>(INTEGRITY_WARNING)
+        make_shared<CryCipherInstance<Mars128_CFB>>(INTEGRITY_WARNING),
+#if CRYPTOPP_VERSION >= 810
+        make_shared<CryCipherInstance<XChaCha20Poly1305>>()
+#endif
 };
 
 const CryCipher& CryCiphers::find(const string &cipherName) {
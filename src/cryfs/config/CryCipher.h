@@ -4,6 +4,7 @@
 
 #include <vector>
 #include <string>
+#include <chrono>
 #include <cpp-utils/pointer/unique_ref.h>
 #include <blockstore/interface/BlockStore.h>
 #include <cpp-utils/random/RandomGenerator.h>
@@ -30,6 +31,11 @@ private:
 };
 
 
+struct CryCipherThroughput final {
+    double encryptMBps;
+    double decryptMBps;
+};
+
 class CryCipher {
 public:
     virtual ~CryCipher() {}
@@ -39,6 +45,9 @@ public:
     virtual cpputils::unique_ref<blockstore::BlockStore> createEncryptedBlockstore(cpputils::unique_ref<blockstore::BlockStore> baseBlockStore, const std::string &encKey) const = 0;
     virtual std::string createKey(cpputils::RandomGenerator &randomGenerator) const = 0;
     virtual cpputils::unique_ref<InnerEncryptor> createInnerConfigEncryptor(const cpputils::FixedSizeData<CryCiphers::MAX_KEY_SIZE> &key) const = 0;
+    // Measures how fast blocks with a ciphertext size of blocksizeBytes are encrypted and decrypted on this machine.
+    // Each of the two measurements runs for the given duration.
+    virtual CryCipherThroughput benchmark(uint32_t blocksizeBytes, std::chrono::milliseconds duration) const = 0;
 };
 
 
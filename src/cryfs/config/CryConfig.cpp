@@ -20,16 +20,19 @@ using cpputils::Random;
 
 namespace cryfs {
 
+const string CryConfig::BLOCKSTORE_LAYOUT_FILE_PER_BLOCK = "file-per-block";
+const string CryConfig::BLOCKSTORE_LAYOUT_LOG_STRUCTURED = "log-structured";
+
 CryConfig::CryConfig()
-: _rootBlob(""), _encKey(""), _cipher(""), _version(""), _createdWithVersion(""), _blocksizeBytes(0), _filesystemId(FilesystemID::Null()) {
+: _rootBlob(""), _removalJournalBlob(""), _encKey(""), _cipher(""), _version(""), _createdWithVersion(""), _blocksizeBytes(0), _filesystemId(FilesystemID::Null()), _blockstoreLayout("") {
 }
 
 CryConfig::CryConfig(CryConfig &&rhs)
-: _rootBlob(std::move(rhs._rootBlob)), _encKey(std::move(rhs._encKey)), _cipher(std::move(rhs._cipher)), _version(std::move(rhs._version)), _createdWithVersion(std::move(rhs._createdWithVersion)), _blocksizeBytes(rhs._blocksizeBytes), _filesystemId(std::move(rhs._filesystemId)) {
+: _rootBlob(std::move(rhs._rootBlob)), _removalJournalBlob(std::move(rhs._removalJournalBlob)), _encKey(std::move(rhs._encKey)), _cipher(std::move(rhs._cipher)), _version(std::move(rhs._version)), _createdWithVersion(std::move(rhs._createdWithVersion)), _blocksizeBytes(rhs._blocksizeBytes), _filesystemId(std::move(rhs._filesystemId)), _blockstoreLayout(std::move(rhs._blockstoreLayout)) {
 }
 
 CryConfig::CryConfig(const CryConfig &rhs)
-        : _rootBlob(rhs._rootBlob), _encKey(rhs._encKey), _cipher(rhs._cipher), _version(rhs._version), _createdWithVersion(rhs._createdWithVersion), _blocksizeBytes(rhs._blocksizeBytes), _filesystemId(rhs._filesystemId) {
+        : _rootBlob(rhs._rootBlob), _removalJournalBlob(rhs._removalJournalBlob), _encKey(rhs._encKey), _cipher(rhs._cipher), _version(rhs._version), _createdWithVersion(rhs._createdWithVersion), _blocksizeBytes(rhs._blocksizeBytes), _filesystemId(rhs._filesystemId), _blockstoreLayout(rhs._blockstoreLayout) {
 }
 
 CryConfig CryConfig::load(const Data &data) {
@@ -40,6 +43,7 @@ CryConfig CryConfig::load(const Data &data) {
 
   CryConfig cfg;
   cfg._rootBlob = pt.get<string>("cryfs.rootblob");
+  cfg._removalJournalBlob = pt.get<string>("cryfs.removalJournalBlob", ""); // Older file systems get a removal journal when they're mounted
   cfg._encKey = pt.get<string>("cryfs.key");
   cfg._cipher = pt.get<string>("cryfs.cipher");
   cfg._version = pt.get<string>("cryfs.version", "0.8"); // CryFS 0.8 didn't specify this field, so if the field doesn't exist, it's 0.8.
@@ -53,6 +57,8 @@ CryConfig CryConfig::load(const Data &data) {
     cfg._filesystemId = FilesystemID::FromString(*filesystemIdOpt);
   }
 
+  cfg._blockstoreLayout = pt.get<string>("cryfs.blockstoreLayout", BLOCKSTORE_LAYOUT_FILE_PER_BLOCK); // CryFS <= 0.9.7 only supported one file per block
+
   return cfg;
 }
 
@@ -60,12 +66,14 @@ Data CryConfig::save() const {
   ptree pt;
 
   pt.put<string>("cryfs.rootblob", _rootBlob);
+  pt.put<string>("cryfs.removalJournalBlob", _removalJournalBlob);
   pt.put<string>("cryfs.key", _encKey);
   pt.put<string>("cryfs.cipher", _cipher);
   pt.put<string>("cryfs.version", _version);
   pt.put<string>("cryfs.createdWithVersion", _createdWithVersion);
   pt.put<uint64_t>("cryfs.blocksizeBytes", _blocksizeBytes);
   pt.put<string>("cryfs.filesystemId", _filesystemId.ToString());
+  pt.put<string>("cryfs.blockstoreLayout", _blockstoreLayout);
 
   stringstream stream;
   write_json(stream, pt);
@@ -80,6 +88,14 @@ void CryConfig::SetRootBlob(const std::string &value) {
   _rootBlob = value;
 }
 
+const std::string &CryConfig::RemovalJournalBlob() const {
+  return _removalJournalBlob;
+}
+
+void CryConfig::SetRemovalJournalBlob(const std::string &value) {
+  _removalJournalBlob = value;
+}
+
 const string &CryConfig::EncryptionKey() const {
   return _encKey;
 }
@@ -128,4 +144,12 @@ void CryConfig::SetFilesystemId(const FilesystemID &value) {
   _filesystemId = value;
 }
 
+const std::string &CryConfig::BlockstoreLayout() const {
+  return _blockstoreLayout;
+}
+
+void CryConfig::SetBlockstoreLayout(const std::string &value) {
+  _blockstoreLayout = value;
+}
+
 }
@@ -20,6 +20,11 @@ public:
   const std::string &RootBlob() const;
   void SetRootBlob(const std::string &value);
 
+  // Key of the blob that remembers which blobs are still being removed in the background.
+  // Empty if the file system doesn't have one yet.
+  const std::string &RemovalJournalBlob() const;
+  void SetRemovalJournalBlob(const std::string &value);
+
   const std::string &EncryptionKey() const;
   void SetEncryptionKey(const std::string &value);
 
@@ -39,17 +44,25 @@ public:
   const FilesystemID &FilesystemId() const;
   void SetFilesystemId(const FilesystemID &value);
 
+  // How the blocks are stored in the base directory
+  static const std::string BLOCKSTORE_LAYOUT_FILE_PER_BLOCK;
+  static const std::string BLOCKSTORE_LAYOUT_LOG_STRUCTURED;
+  const std::string &BlockstoreLayout() const;
+  void SetBlockstoreLayout(const std::string &value);
+
   static CryConfig load(const cpputils::Data &data);
   cpputils::Data save() const;
 
 private:
   std::string _rootBlob;
+  std::string _removalJournalBlob;
   std::string _encKey;
   std::string _cipher;
   std::string _version;
   std::string _createdWithVersion;
   uint64_t _blocksizeBytes;
   FilesystemID _filesystemId;
+  std::string _blockstoreLayout;
 
   CryConfig &operator=(const CryConfig &rhs) = delete;
 };
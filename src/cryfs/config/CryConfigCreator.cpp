@@ -19,7 +19,7 @@ namespace cryfs {
         :_console(console), _configConsole(console), _encryptionKeyGenerator(encryptionKeyGenerator) {
     }
 
-    CryConfig CryConfigCreator::create(const optional<string> &cipherFromCommandLine, const optional<uint32_t> &blocksizeBytesFromCommandLine) {
+    CryConfig CryConfigCreator::create(const optional<string> &cipherFromCommandLine, const optional<uint32_t> &blocksizeBytesFromCommandLine, const optional<string> &blockstoreLayoutFromCommandLine) {
         CryConfig config;
         config.SetCipher(_generateCipher(cipherFromCommandLine));
         config.SetVersion(gitversion::VersionString());
@@ -28,6 +28,7 @@ namespace cryfs {
         config.SetRootBlob(_generateRootBlobKey());
         config.SetEncryptionKey(_generateEncKey(config.Cipher()));
         config.SetFilesystemId(_generateFilesystemID());
+        config.SetBlockstoreLayout(_generateBlockstoreLayout(blockstoreLayoutFromCommandLine));
         return config;
     }
 
@@ -64,4 +65,13 @@ namespace cryfs {
     CryConfig::FilesystemID CryConfigCreator::_generateFilesystemID() {
         return Random::PseudoRandom().getFixedSize<CryConfig::FilesystemID::BINARY_LENGTH>();
     }
+
+    string CryConfigCreator::_generateBlockstoreLayout(const optional<string> &blockstoreLayoutFromCommandLine) {
+        if (blockstoreLayoutFromCommandLine != none) {
+            ASSERT(*blockstoreLayoutFromCommandLine == CryConfig::BLOCKSTORE_LAYOUT_FILE_PER_BLOCK || *blockstoreLayoutFromCommandLine == CryConfig::BLOCKSTORE_LAYOUT_LOG_STRUCTURED, "Invalid blockstore layout");
+            return *blockstoreLayoutFromCommandLine;
+        } else {
+            return CryConfig::BLOCKSTORE_LAYOUT_FILE_PER_BLOCK;
+        }
+    }
 }
@@ -26,10 +26,11 @@ using namespace cpputils::logging;
 
 namespace cryfs {
 
-CryConfigLoader::CryConfigLoader(shared_ptr<Console> console, RandomGenerator &keyGenerator, const SCryptSettings &scryptSettings, function<string()> askPasswordForExistingFilesystem, function<string()> askPasswordForNewFilesystem, const optional<string> &cipherFromCommandLine, const boost::optional<uint32_t> &blocksizeBytesFromCommandLine)
+CryConfigLoader::CryConfigLoader(shared_ptr<Console> console, RandomGenerator &keyGenerator, const SCryptSettings &scryptSettings, function<string()> askPasswordForExistingFilesystem, function<string()> askPasswordForNewFilesystem, const optional<string> &cipherFromCommandLine, const boost::optional<uint32_t> &blocksizeBytesFromCommandLine, const optional<string> &blockstoreLayoutFromCommandLine)
     : _console(console), _creator(console, keyGenerator), _scryptSettings(scryptSettings),
       _askPasswordForExistingFilesystem(askPasswordForExistingFilesystem), _askPasswordForNewFilesystem(askPasswordForNewFilesystem),
-      _cipherFromCommandLine(cipherFromCommandLine), _blocksizeBytesFromCommandLine(blocksizeBytesFromCommandLine) {
+      _cipherFromCommandLine(cipherFromCommandLine), _blocksizeBytesFromCommandLine(blocksizeBytesFromCommandLine),
+      _blockstoreLayoutFromCommandLine(blockstoreLayoutFromCommandLine) {
 }
 
 optional<CryConfigFile> CryConfigLoader::_loadConfig(const bf::path &filename) {
@@ -52,6 +53,7 @@ optional<CryConfigFile> CryConfigLoader::_loadConfig(const bf::path &filename) {
     config->save();
   }
   _checkCipher(*config->config());
+  _checkBlockstoreLayout(*config->config());
   return std::move(*config);
 }
 
@@ -74,6 +76,12 @@ void CryConfigLoader::_checkCipher(const CryConfig &config) const {
   }
 }
 
+void CryConfigLoader::_checkBlockstoreLayout(const CryConfig &config) const {
+  if (_blockstoreLayoutFromCommandLine != none && config.BlockstoreLayout() != *_blockstoreLayoutFromCommandLine) {
+    throw std::runtime_error(string() + "Filesystem uses the " + config.BlockstoreLayout() + " blockstore layout and not " + *_blockstoreLayoutFromCommandLine + " as specified.");
+  }
+}
+
 optional<CryConfigFile> CryConfigLoader::loadOrCreate(const bf::path &filename) {
   if (bf::exists(filename)) {
     return _loadConfig(filename);
@@ -83,7 +91,7 @@ optional<CryConfigFile> CryConfigLoader::loadOrCreate(const bf::path &filename)
 }
 
 CryConfigFile CryConfigLoader::_createConfig(const bf::path &filename) {
-  auto config = _creator.create(_cipherFromCommandLine, _blocksizeBytesFromCommandLine);
+  auto config = _creator.create(_cipherFromCommandLine, _blocksizeBytesFromCommandLine, _blockstoreLayoutFromCommandLine);
   //TODO Ask confirmation if using insecure password (<8 characters)
   string password = _askPasswordForNewFilesystem();
   std::cout << "Creating config file (this can take some time)..." << std::flush;
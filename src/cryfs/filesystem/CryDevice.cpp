@@ -39,25 +39,57 @@ using cryfs::parallelaccessfsblobstore::FileBlobRef;
 using cryfs::parallelaccessfsblobstore::DirBlobRef;
 using cryfs::parallelaccessfsblobstore::SymlinkBlobRef;
 using cryfs::parallelaccessfsblobstore::FsBlobRef;
+using cryfs::dentrycache::DentryCache;
+using cryfs::lazytime::LazyTimestamps;
+using cryfs::fsblobstore::AtimeUpdateBehavior;
 using namespace cpputils::logging;
 
 namespace bf = boost::filesystem;
 
 namespace cryfs {
 
-CryDevice::CryDevice(CryConfigFile configFile, unique_ref<BlockStore> blockStore)
-: _fsBlobStore(
+constexpr std::chrono::seconds CryDevice::LAZYTIME_MAX_DELAY;
+
+CryDevice::CryDevice(CryConfigFile configFile, unique_ref<BlockStore> blockStore, const optional<uint64_t> &cacheSizeBytes, AtimeUpdateBehavior atimeBehavior, bool lazytime)
+: CryDevice(&configFile, CreateBlobStore(*configFile.config(), std::move(blockStore), cacheSizeBytes), atimeBehavior, lazytime) {
+}
+
+CryDevice::CryDevice(CryConfigFile *configFile, unique_ref<BlobStoreOnBlocks> blobStore, AtimeUpdateBehavior atimeBehavior, bool lazytime)
+: _blobStore(blobStore.get()),
+  _fsBlobStore(
       make_unique_ref<ParallelAccessFsBlobStore>(
         make_unique_ref<CachingFsBlobStore>(
-          make_unique_ref<FsBlobStore>(
-            make_unique_ref<BlobStoreOnBlocks>(
-              make_unique_ref<CachingBlockStore>(
-                CreateEncryptedBlockStore(*configFile.config(), std::move(blockStore))
-              ), configFile.config()->BlocksizeBytes())))
+          make_unique_ref<FsBlobStore>(std::move(blobStore))
         )
-      ),
-  _rootKey(GetOrCreateRootKey(&configFile)),
-  _onFsAction() {
+      )
+  ),
+  _rootKey(GetOrCreateRootKey(configFile)),
+  _dentryCache(_rootKey),
+  _onFsAction(),
+  _atimeBehavior(atimeBehavior),
+  _lazyTimestamps(lazytime ? std::make_unique<LazyTimestamps>(LAZYTIME_MAX_DELAY) : nullptr) {
+  MigrateDirectories();
+  EnableBackgroundRemoval(configFile);
+}
+
+CryDevice::~CryDevice() {
+  LogDentryCacheStatistics();
+}
+
+unique_ref<BlobStoreOnBlocks> CryDevice::CreateBlobStore(const CryConfig &config, unique_ref<BlockStore> blockStore, const optional<uint64_t> &cacheSizeBytes) {
+  return make_unique_ref<BlobStoreOnBlocks>(
+    make_unique_ref<CachingBlockStore>(
+      CreateEncryptedBlockStore(config, std::move(blockStore)),
+      CachingBlockStore::DEFAULT_CACHE_CONFIG, CreateReadCacheConfig(cacheSizeBytes)
+    ), config.BlocksizeBytes());
+}
+
+blockstore::caching::CacheConfig CryDevice::CreateReadCacheConfig(const optional<uint64_t> &cacheSizeBytes) {
+  blockstore::caching::CacheConfig config = CachingBlockStore::DEFAULT_READ_CACHE_CONFIG;
+  if (cacheSizeBytes != none) {
+    config.maxBytes = *cacheSizeBytes;
+  }
+  return config;
 }
 
 Key CryDevice::CreateRootBlobAndReturnKey() {
@@ -114,23 +146,32 @@ optional<unique_ref<fspp::Node>> CryDevice::Load(const bf::path &path) {
     return optional<unique_ref<fspp::Node>>(make_unique_ref<CryDir>(this, none, none, _rootKey));
   }
 
+  uint64_t generation = _dentryCache.generation();
   auto parentWithGrandparent = LoadDirBlobWithParent(path.parent_path());
   auto parent = std::move(parentWithGrandparent.blob);
   auto grandparent = std::move(parentWithGrandparent.parent);
 
-  auto optEntry = parent->GetChild(path.filename().native());
-  if (optEntry == boost::none) {
-    return boost::none;
+  auto entry = _dentryCache.lookup(path);
+  if (entry == none || entry->parentKey != parent->key()) {
+    auto child = parent->GetChild(path.filename().native());
+    if (child == none) {
+      entry = DentryCache::Entry{none, parent->key(), fspp::Dir::EntryType::FILE};
+    } else {
+      entry = DentryCache::Entry{child->key(), parent->key(), child->type()};
+    }
+    _dentryCache.insert(path, *entry, generation);
+  }
+  if (!entry->exists()) {
+    return none;
   }
-  const auto &entry = *optEntry;
 
-  switch(entry.type()) {
+  switch(entry->type) {
     case fspp::Dir::EntryType::DIR:
-      return optional<unique_ref<fspp::Node>>(make_unique_ref<CryDir>(this, std::move(parent), std::move(grandparent), entry.key()));
+      return optional<unique_ref<fspp::Node>>(make_unique_ref<CryDir>(this, std::move(parent), std::move(grandparent), *entry->key));
     case fspp::Dir::EntryType::FILE:
-      return optional<unique_ref<fspp::Node>>(make_unique_ref<CryFile>(this, std::move(parent), std::move(grandparent), entry.key()));
+      return optional<unique_ref<fspp::Node>>(make_unique_ref<CryFile>(this, std::move(parent), std::move(grandparent), *entry->key));
     case  fspp::Dir::EntryType::SYMLINK:
-	  return optional<unique_ref<fspp::Node>>(make_unique_ref<CrySymlink>(this, std::move(parent), std::move(grandparent), entry.key()));
+	  return optional<unique_ref<fspp::Node>>(make_unique_ref<CrySymlink>(this, std::move(parent), std::move(grandparent), *entry->key));
   }
   ASSERT(false, "Switch/case not exhaustive");
 }
@@ -145,22 +186,63 @@ CryDevice::DirBlobWithParent CryDevice::LoadDirBlobWithParent(const bf::path &pa
 }
 
 CryDevice::BlobWithParent CryDevice::LoadBlobWithParent(const bf::path &path) {
-  optional<unique_ref<DirBlobRef>> parentBlob = none;
-  optional<unique_ref<FsBlobRef>> currentBlobOpt = _fsBlobStore->load(_rootKey);
-  if (currentBlobOpt == none) {
+  uint64_t generation = _dentryCache.generation();
+  auto cached = LoadClosestCachedBlobWithParent(path);
+  if (cached != none) {
+    return WalkToBlobWithParent(std::move(cached->second), cached->first, path, generation);
+  }
+  return WalkToBlobWithParent(LoadRootBlob(), "/", path, generation);
+}
+
+optional<std::pair<bf::path, CryDevice::BlobWithParent>> CryDevice::LoadClosestCachedBlobWithParent(const bf::path &path) {
+  auto cached = _dentryCache.lookupClosest(path);
+  if (cached == none) {
+    return none;
+  }
+  const DentryCache::Entry &entry = cached->second;
+  if (!entry.exists()) {
+    throw FuseErrnoException(ENOENT); // The path or one of its parent directories doesn't exist
+  }
+  auto blob = _fsBlobStore->load(*entry.key);
+  auto parent = _fsBlobStore->load(entry.parentKey);
+  if (blob == none || parent == none) {
+    return none;
+  }
+  auto parentDir = dynamic_pointer_move<DirBlobRef>(*parent);
+  ASSERT(parentDir != none, "Cached parent is not a directory");
+  return std::make_pair(cached->first, BlobWithParent{std::move(*blob), std::move(*parentDir)});
+}
+
+CryDevice::BlobWithParent CryDevice::LoadRootBlob() {
+  auto rootBlob = _fsBlobStore->load(_rootKey);
+  if (rootBlob == none) {
     LOG(ERROR, "Could not load root blob. Is the base directory accessible?");
     throw FuseErrnoException(EIO);
   }
-  unique_ref<FsBlobRef> currentBlob = std::move(*currentBlobOpt);
+  return BlobWithParent{std::move(*rootBlob), none};
+}
+
+CryDevice::BlobWithParent CryDevice::WalkToBlobWithParent(BlobWithParent start, const bf::path &startPath, const bf::path &path, uint64_t generation) {
+  optional<unique_ref<DirBlobRef>> parentBlob = std::move(start.parent);
+  unique_ref<FsBlobRef> currentBlob = std::move(start.blob);
+  bf::path currentPath = startPath;
+
+  // startPath is a prefix of path, skip its components
+  auto component = path.begin();
+  for (auto startComponent = startPath.begin(); startComponent != startPath.end(); ++startComponent) {
+    ++component;
+  }
 
-  for (const bf::path &component : path.relative_path()) {
+  for (; component != path.end(); ++component) {
     auto currentDir = dynamic_pointer_move<DirBlobRef>(currentBlob);
     if (currentDir == none) {
       throw FuseErrnoException(ENOTDIR); // Path component is not a dir
     }
+    currentPath /= *component;
 
-    auto childOpt = (*currentDir)->GetChild(component.c_str());
+    auto childOpt = (*currentDir)->GetChild(component->c_str());
     if (childOpt == boost::none) {
+      _dentryCache.insert(currentPath, DentryCache::Entry{none, (*currentDir)->key(), fspp::Dir::EntryType::FILE}, generation);
       throw FuseErrnoException(ENOENT); // Child entry in directory not found
     }
     Key childKey = childOpt->key();
@@ -168,6 +250,7 @@ CryDevice::BlobWithParent CryDevice::LoadBlobWithParent(const bf::path &path) {
     if (nextBlob == none) {
       throw FuseErrnoException(ENOENT); // Blob for directory entry not found
     }
+    _dentryCache.insert(currentPath, DentryCache::Entry{childKey, (*currentDir)->key(), childOpt->type()}, generation);
     parentBlob = std::move(*currentDir);
     currentBlob = std::move(*nextBlob);
   }
@@ -217,6 +300,23 @@ unique_ref<FsBlobRef> CryDevice::LoadBlob(const blockstore::Key &key) {
   return std::move(*blob);
 }
 
+void CryDevice::onEntryChanged(const blockstore::Key &key) {
+  _dentryCache.invalidate(key);
+}
+
+void CryDevice::onChildChanged(const blockstore::Key &dirKey, const string &name) {
+  _dentryCache.invalidateChild(dirKey, name);
+}
+
+blockstore::caching::CacheStatistics CryDevice::dentryCacheStatistics() const {
+  return _dentryCache.statistics();
+}
+
+void CryDevice::LogDentryCacheStatistics() const {
+  auto stats = dentryCacheStatistics();
+  LOG(INFO, "Dentry cache: {} hits, {} misses, {} entries evicted, holds {} bytes", stats.numHits, stats.numMisses, stats.numEvictions, stats.numBytes);
+}
+
 void CryDevice::RemoveBlob(const blockstore::Key &key) {
   auto blob = _fsBlobStore->load(key);
   if (blob == none) {
@@ -238,6 +338,33 @@ Key CryDevice::GetOrCreateRootKey(CryConfigFile *configFile) {
   return Key::FromString(root_key);
 }
 
+void CryDevice::MigrateDirectories() {
+  // Only file systems created by older CryFS versions have directories in the old format. When loading their config,
+  // CryConfigLoader already asked whether to migrate the file system, so they're converted here, before mounting it.
+  // Afterwards, older CryFS versions refuse to load these directories.
+  FsBlobStore::MigrateDirectories(_blobStore, _rootKey);
+}
+
+void CryDevice::EnableBackgroundRemoval(CryConfigFile *configFile) {
+  // Removals that were still pending when the file system was unmounted are resumed.
+  _blobStore->removeInBackground(GetOrCreateRemovalJournalKey(configFile));
+}
+
+Key CryDevice::GetOrCreateRemovalJournalKey(CryConfigFile *configFile) {
+  // The journal gets a random key like any other blob, so file systems can't be recognized by it
+  string journal_key = configFile->config()->RemovalJournalBlob();
+  if (journal_key == "") {
+    auto journal = _blobStore->create();
+    journal->flush();
+    auto new_key = journal->key();
+    configFile->config()->SetRemovalJournalBlob(new_key.ToString());
+    configFile->save();
+    return new_key;
+  }
+
+  return Key::FromString(journal_key);
+}
+
 cpputils::unique_ref<blockstore::BlockStore> CryDevice::CreateEncryptedBlockStore(const CryConfig &config, unique_ref<BlockStore> baseBlockStore) {
   //TODO Test that CryFS is using the specified cipher
   return CryCiphers::find(config.Cipher()).createEncryptedBlockstore(std::move(baseBlockStore), config.EncryptionKey());
@@ -257,4 +384,36 @@ uint64_t CryDevice::numBlocks() const {
   return _fsBlobStore->numBlocks();
 }
 
+AtimeUpdateBehavior CryDevice::atimeBehavior() const {
+  return _atimeBehavior;
+}
+
+LazyTimestamps *CryDevice::lazyTimestamps() const {
+  return _lazyTimestamps.get();
+}
+
+void CryDevice::writeLazyTimestamps(const Key &key, DirBlobRef *parent) const {
+  if (_lazyTimestamps == nullptr) {
+    return;
+  }
+  auto updates = _lazyTimestamps->take(key);
+  if (updates != none) {
+    parent->setDeferredTimestampsForChild(key, updates->lastAccessTime, updates->lastModificationTime, _atimeBehavior);
+  }
+}
+
+void CryDevice::applyLazyTimestamps(const Key &key, struct ::stat *result) const {
+  if (_lazyTimestamps != nullptr) {
+    _lazyTimestamps->applyTo(key, _atimeBehavior, result);
+  }
+}
+
+uint64_t CryDevice::leafSizeBytes() const {
+  return _fsBlobStore->virtualBlocksizeBytes();
+}
+
+void CryDevice::waitForPendingRemovals() {
+  _blobStore->waitForPendingRemovals();
+}
+
 }
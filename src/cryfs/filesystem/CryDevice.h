@@ -3,6 +3,7 @@
 #define MESSMER_CRYFS_FILESYSTEM_CRYDEVICE_H_
 
 #include <blockstore/interface/BlockStore.h>
+#include <blockstore/implementations/caching/cache/CacheConfig.h>
 #include "../config/CryConfigFile.h"
 
 #include <boost/filesystem.hpp>
@@ -12,12 +13,29 @@
 #include "parallelaccessfsblobstore/DirBlobRef.h"
 #include "parallelaccessfsblobstore/FileBlobRef.h"
 #include "parallelaccessfsblobstore/SymlinkBlobRef.h"
+#include "dentrycache/DentryCache.h"
+#include "lazytime/LazyTimestamps.h"
+#include "fsblobstore/utils/TimestampUpdateBehavior.h"
+
+namespace blobstore {
+  namespace onblocks {
+    class BlobStoreOnBlocks;
+  }
+}
 
 namespace cryfs {
 
 class CryDevice final: public fspp::Device {
 public:
-  CryDevice(CryConfigFile config, cpputils::unique_ref<blockstore::BlockStore> blockStore);
+  // cacheSizeBytes is the memory budget of the block cache (decrypted data and ciphertext). If it isn't given, a default is used.
+  // atimeBehavior decides when reads update the access timestamp.
+  // With lazytime, open files keep their timestamp updates in memory and only write them to the directory entry
+  // on flush, fsync and close, or once they are older than LAZYTIME_MAX_DELAY.
+  CryDevice(CryConfigFile config, cpputils::unique_ref<blockstore::BlockStore> blockStore, const boost::optional<uint64_t> &cacheSizeBytes = boost::none,
+            fsblobstore::AtimeUpdateBehavior atimeBehavior = fsblobstore::AtimeUpdateBehavior::STRICTATIME, bool lazytime = false);
+  ~CryDevice();
+
+  static constexpr std::chrono::seconds LAZYTIME_MAX_DELAY = std::chrono::seconds(60);
 
   void statfs(const boost::filesystem::path &path, struct ::statvfs *fsstat) override;
 
@@ -32,8 +50,22 @@ public:
   DirBlobWithParent LoadDirBlobWithParent(const boost::filesystem::path &path);
   void RemoveBlob(const blockstore::Key &key);
 
+  // Have to be called after changing a directory entry, so the cached path lookups stay valid.
+  void onEntryChanged(const blockstore::Key &key);
+  void onChildChanged(const blockstore::Key &dirKey, const std::string &name);
+  blockstore::caching::CacheStatistics dentryCacheStatistics() const;
+
   void onFsAction(std::function<void()> callback);
 
+  fsblobstore::AtimeUpdateBehavior atimeBehavior() const;
+  // nullptr if lazytime isn't enabled
+  lazytime::LazyTimestamps *lazyTimestamps() const;
+  // Writes the timestamp updates that lazytime kept in memory to the directory entry.
+  // Has to be called before changing these values in the directory entry directly, so they don't get overwritten with older values later.
+  void writeLazyTimestamps(const blockstore::Key &key, parallelaccessfsblobstore::DirBlobRef *parent) const;
+  // Applies the timestamp updates that lazytime kept in memory to stat values read from the directory entry
+  void applyLazyTimestamps(const blockstore::Key &key, struct ::stat *result) const;
+
   boost::optional<cpputils::unique_ref<fspp::Node>> Load(const boost::filesystem::path &path) override;
   boost::optional<cpputils::unique_ref<fspp::File>> LoadFile(const boost::filesystem::path &path) override;
   boost::optional<cpputils::unique_ref<fspp::Dir>> LoadDir(const boost::filesystem::path &path) override;
@@ -42,16 +74,32 @@ public:
   void callFsActionCallbacks() const;
 
   uint64_t numBlocks() const;
+  // Number of file bytes stored in one leaf block
+  uint64_t leafSizeBytes() const;
+  // Blobs are removed in the background. This blocks until all removals are finished.
+  void waitForPendingRemovals();
 
 private:
+  CryDevice(CryConfigFile *configFile, cpputils::unique_ref<blobstore::onblocks::BlobStoreOnBlocks> blobStore, fsblobstore::AtimeUpdateBehavior atimeBehavior, bool lazytime);
 
+  // Owned by _fsBlobStore
+  blobstore::onblocks::BlobStoreOnBlocks *_blobStore;
   cpputils::unique_ref<parallelaccessfsblobstore::ParallelAccessFsBlobStore> _fsBlobStore;
 
   blockstore::Key _rootKey;
+  dentrycache::DentryCache _dentryCache;
   std::vector<std::function<void()>> _onFsAction;
+  fsblobstore::AtimeUpdateBehavior _atimeBehavior;
+  std::unique_ptr<lazytime::LazyTimestamps> _lazyTimestamps;
 
   blockstore::Key GetOrCreateRootKey(CryConfigFile *config);
   blockstore::Key CreateRootBlobAndReturnKey();
+  void MigrateDirectories();
+  void EnableBackgroundRemoval(CryConfigFile *configFile);
+  void LogDentryCacheStatistics() const;
+  blockstore::Key GetOrCreateRemovalJournalKey(CryConfigFile *configFile);
+  static cpputils::unique_ref<blobstore::onblocks::BlobStoreOnBlocks> CreateBlobStore(const CryConfig &config, cpputils::unique_ref<blockstore::BlockStore> blockStore, const boost::optional<uint64_t> &cacheSizeBytes);
+  static blockstore::caching::CacheConfig CreateReadCacheConfig(const boost::optional<uint64_t> &cacheSizeBytes);
   static cpputils::unique_ref<blockstore::BlockStore> CreateEncryptedBlockStore(const CryConfig &config, cpputils::unique_ref<blockstore::BlockStore> baseBlockStore);
 
   struct BlobWithParent {
@@ -59,6 +107,11 @@ private:
       boost::optional<cpputils::unique_ref<parallelaccessfsblobstore::DirBlobRef>> parent;
   };
   BlobWithParent LoadBlobWithParent(const boost::filesystem::path &path);
+  // Loads the path or the closest of its parent directories that is in the dentry cache, together with the path it loaded
+  boost::optional<std::pair<boost::filesystem::path, BlobWithParent>> LoadClosestCachedBlobWithParent(const boost::filesystem::path &path);
+  BlobWithParent LoadRootBlob();
+  // Walks from startPath, which has to be a prefix of path, through the directories to path
+  BlobWithParent WalkToBlobWithParent(BlobWithParent start, const boost::filesystem::path &startPath, const boost::filesystem::path &path, uint64_t generation);
 
   DISALLOW_COPY_AND_ASSIGN(CryDevice);
 };
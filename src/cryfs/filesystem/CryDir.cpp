@@ -47,6 +47,7 @@ unique_ref<fspp::OpenFile> CryDir::createAndOpenFile(const string &name, mode_t
   auto now = cpputils::time::now();
   auto dirBlob = LoadBlob();
   dirBlob->AddChildFile(name, child->key(), mode, uid, gid, now, now);
+  device()->onChildChanged(key(), name);
   return make_unique_ref<CryOpenFile>(device(), cpputils::to_unique_ptr(std::move(dirBlob)), std::move(child));
 }
 
@@ -60,6 +61,7 @@ void CryDir::createDir(const string &name, mode_t mode, uid_t uid, gid_t gid) {
   auto child = device()->CreateDirBlob();
   auto now = cpputils::time::now();
   blob->AddChildDir(name, child->key(), mode, uid, gid, now, now);
+  device()->onChildChanged(key(), name);
 }
 
 unique_ref<DirBlobRef> CryDir::LoadBlob() const {
@@ -73,7 +75,7 @@ unique_ref<vector<fspp::Dir::Entry>> CryDir::children() {
   device()->callFsActionCallbacks();
   if (!isRootDir()) {
     //TODO Instead of doing nothing when we're the root directory, handle timestamps in the root dir correctly (and delete isRootDir() function)
-    parent()->updateAccessTimestampForChild(key());
+    parent()->updateAccessTimestampForChild(key(), device()->atimeBehavior());
   }
   auto children = make_unique_ref<vector<fspp::Dir::Entry>>();
   children->push_back(fspp::Dir::Entry(fspp::Dir::EntryType::DIR, "."));
@@ -83,6 +85,15 @@ unique_ref<vector<fspp::Dir::Entry>> CryDir::children() {
   return children;
 }
 
+void CryDir::fsync() {
+  device()->callFsActionCallbacks();
+  LoadBlob()->flush();
+  if (!isRootDir()) {
+    // The timestamps of the directory are stored in its parent
+    parent()->flush();
+  }
+}
+
 fspp::Dir::EntryType CryDir::getType() const {
   device()->callFsActionCallbacks();
   return fspp::Dir::EntryType::DIR;
@@ -98,6 +109,7 @@ void CryDir::createSymlink(const string &name, const bf::path &target, uid_t uid
   auto child = device()->CreateSymlinkBlob(target);
   auto now = cpputils::time::now();
   blob->AddChildSymlink(name, child->key(), uid, gid, now, now);
+  device()->onChildChanged(key(), name);
 }
 
 void CryDir::remove() {
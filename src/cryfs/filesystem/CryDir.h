@@ -21,6 +21,8 @@ public:
   //TODO Make Entry a public class instead of hidden in DirBlob (which is not publicly visible)
   cpputils::unique_ref<std::vector<fspp::Dir::Entry>> children() override;
 
+  void fsync() override;
+
   fspp::Dir::EntryType getType() const override;
 
   void remove() override;
@@ -47,7 +47,8 @@ void CryFile::truncate(off_t size) {
   device()->callFsActionCallbacks();
   auto blob = LoadBlob();
   blob->resize(size);
-  parent()->updateModificationTimestampForChild(key());
+  device()->writeLazyTimestamps(key(), parent().get());
+  parent()->updateModificationTimestampAndSizeForChild(key(), size);
 }
 
 fspp::Dir::EntryType CryFile::getType() const {
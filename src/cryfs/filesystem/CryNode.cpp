@@ -83,6 +83,8 @@ void CryNode::rename(const bf::path &to) {
   auto targetDir = std::move(targetDirWithParent.blob);
   auto targetDirParent = std::move(targetDirWithParent.parent);
 
+  // The entry is copied below, so it has to contain the updates lazytime kept in memory
+  _device->writeLazyTimestamps(_key, _parent->get());
   auto old = (*_parent)->GetChild(_key);
   if (old == boost::none) {
     throw FuseErrnoException(EIO);
@@ -92,16 +94,19 @@ void CryNode::rename(const bf::path &to) {
       device()->RemoveBlob(key);
   };
   _updateParentModificationTimestamp();
+  Key targetDirKey = targetDir->key();
   if (targetDir->key() == (*_parent)->key()) {
     targetDir->RenameChild(oldEntry.key(), to.filename().native(), onOverwritten);
   } else {
     _updateTargetDirModificationTimestamp(*targetDir, std::move(targetDirParent));
     targetDir->AddOrOverwriteChild(to.filename().native(), oldEntry.key(), oldEntry.type(), oldEntry.mode(), oldEntry.uid(), oldEntry.gid(),
-                                   oldEntry.lastAccessTime(), oldEntry.lastModificationTime(), onOverwritten);
+                                   oldEntry.lastAccessTime(), oldEntry.lastModificationTime(), oldEntry.size(), onOverwritten);
     (*_parent)->RemoveChild(oldEntry.name());
     // targetDir is now the new parent for this node. Adapt to it, so we can call further operations on this node object.
     _parent = cpputils::to_unique_ptr(std::move(targetDir));
   }
+  _device->onEntryChanged(_key);
+  _device->onChildChanged(targetDirKey, to.filename().native());
 }
 
 void CryNode::_updateParentModificationTimestamp() {
@@ -126,6 +131,7 @@ void CryNode::utimens(timespec lastAccessTime, timespec lastModificationTime) {
     //TODO What should we do?
     throw FuseErrnoException(EIO);
   }
+  _device->writeLazyTimestamps(_key, _parent->get());
   (*_parent)->utimensChild(_key, lastAccessTime, lastModificationTime);
 }
 
@@ -136,7 +142,11 @@ void CryNode::removeNode() {
     //TODO What should we do?
     throw FuseErrnoException(EIO);
   }
+  if (_device->lazyTimestamps() != nullptr) {
+    _device->lazyTimestamps()->discard(_key);
+  }
   (*_parent)->RemoveChild(_key);
+  _device->onEntryChanged(_key);
   _device->RemoveBlob(_key);
 }
 
@@ -174,7 +184,9 @@ void CryNode::stat(struct ::stat *result) const {
     result->st_ctim = now;
   } else {
     (*_parent)->statChild(_key, result);
+    _device->applyLazyTimestamps(_key, result);
   }
+  result->st_ino = fsblobstore::DirEntry::inodeNumber(_key);
 }
 
 void CryNode::chmod(mode_t mode) {
@@ -5,6 +5,7 @@
 
 #include "CryDevice.h"
 #include <fspp/fuse/FuseErrnoException.h>
+#include <cpp-utils/logging/logging.h>
 
 namespace bf = boost::filesystem;
 
@@ -12,6 +13,8 @@ using std::shared_ptr;
 using cpputils::unique_ref;
 using cryfs::parallelaccessfsblobstore::FileBlobRef;
 using cryfs::parallelaccessfsblobstore::DirBlobRef;
+using boost::none;
+using namespace cpputils::logging;
 
 //TODO Get rid of this in favor of a exception hierarchy
 using fspp::fuse::CHECK_RETVAL;
@@ -20,16 +23,33 @@ using fspp::fuse::FuseErrnoException;
 namespace cryfs {
 
 CryOpenFile::CryOpenFile(const CryDevice *device, shared_ptr<DirBlobRef> parent, unique_ref<FileBlobRef> fileBlob)
-: _device(device), _parent(parent), _fileBlob(std::move(fileBlob)) {
+: _device(device), _parent(parent), _fileBlob(std::move(fileBlob)), _readahead(), _lazyWriteBackId(none) {
+  auto lazyTimestamps = _device->lazyTimestamps();
+  if (lazyTimestamps != nullptr) {
+    _lazyWriteBackId = lazyTimestamps->addWriteBack(_fileBlob->key(), [this] {
+      _device->writeLazyTimestamps(_fileBlob->key(), _parent.get());
+    });
+  }
 }
 
 CryOpenFile::~CryOpenFile() {
-  //TODO
+  if (_lazyWriteBackId != none) {
+    _device->lazyTimestamps()->removeWriteBack(*_lazyWriteBackId);
+  }
+  try {
+    _device->writeLazyTimestamps(_fileBlob->key(), _parent.get());
+  } catch (const std::exception &e) {
+    // Closing the file can't fail, so the timestamp updates are lost. The file content isn't affected.
+    LOG(ERROR, "Failed to store timestamps when closing file {}: {}", _fileBlob->key().ToString(), e.what());
+  }
 }
 
 void CryOpenFile::flush() {
   _device->callFsActionCallbacks();
   _fileBlob->flush();
+  _device->writeLazyTimestamps(_fileBlob->key(), _parent.get());
+  // Writes already updated the size in the directory entry, but concurrent writes could have stored them out of order
+  _parent->setSizeForChild(_fileBlob->key(), _fileBlob->size());
   _parent->flush();
 }
 
@@ -37,35 +57,99 @@ void CryOpenFile::stat(struct ::stat *result) const {
   _device->callFsActionCallbacks();
   result->st_size = _fileBlob->size();
   _parent->statChildWithSizeAlreadySet(_fileBlob->key(), result);
+  _device->applyLazyTimestamps(_fileBlob->key(), result);
 }
 
 void CryOpenFile::truncate(off_t size) const {
   _device->callFsActionCallbacks();
   _fileBlob->resize(size);
-  _parent->updateModificationTimestampForChild(_fileBlob->key());
+  _device->writeLazyTimestamps(_fileBlob->key(), _parent.get());
+  _parent->updateModificationTimestampAndSizeForChild(_fileBlob->key(), size);
 }
 
 size_t CryOpenFile::read(void *buf, size_t count, off_t offset) const {
   _device->callFsActionCallbacks();
-  _parent->updateAccessTimestampForChild(_fileBlob->key());
+  _updateAccessTimestamp();
+  auto readahead = _readahead.onRead(offset, count);
+  if (readahead != boost::none) {
+    _fileBlob->prefetch(readahead->offset, readahead->size);
+  }
   return _fileBlob->read(buf, offset, count);
 }
 
 void CryOpenFile::write(const void *buf, size_t count, off_t offset) {
   _device->callFsActionCallbacks();
-  _parent->updateModificationTimestampForChild(_fileBlob->key());
   _fileBlob->write(buf, offset, count);
+  _updateModificationTimestampAndSize();
+}
+
+void CryOpenFile::writeInPlace(size_t count, off_t offset, const std::function<void (void *target, size_t size)> &fill) {
+  _device->callFsActionCallbacks();
+  _fileBlob->writeInPlace(offset, count, [&fill] (void *target, uint64_t size) {
+    fill(target, size);
+  });
+  _updateModificationTimestampAndSize();
+}
+
+void CryOpenFile::_updateAccessTimestamp() const {
+  auto lazyTimestamps = _device->lazyTimestamps();
+  if (lazyTimestamps == nullptr) {
+    _parent->updateAccessTimestampForChild(_fileBlob->key(), _device->atimeBehavior());
+  } else if (_device->atimeBehavior() != fsblobstore::AtimeUpdateBehavior::NOATIME) {
+    lazyTimestamps->accessed(_fileBlob->key(), cpputils::time::now());
+  }
+}
+
+void CryOpenFile::_updateModificationTimestampAndSize() {
+  auto lazyTimestamps = _device->lazyTimestamps();
+  if (lazyTimestamps == nullptr) {
+    // Keep the size in the directory entry up to date, so stat doesn't have to load the file blob
+    _parent->updateModificationTimestampAndSizeForChild(_fileBlob->key(), _fileBlob->size());
+  } else {
+    lazyTimestamps->modified(_fileBlob->key(), cpputils::time::now());
+    // Only the timestamp is deferred. Setting the size doesn't modify the directory blob if it didn't change.
+    _parent->setSizeForChild(_fileBlob->key(), _fileBlob->size());
+  }
 }
 
 void CryOpenFile::fsync() {
   _device->callFsActionCallbacks();
   _fileBlob->flush();
+  _device->writeLazyTimestamps(_fileBlob->key(), _parent.get());
   _parent->flush();
 }
 
 void CryOpenFile::fdatasync() {
   _device->callFsActionCallbacks();
   _fileBlob->flush();
+  // Timestamps don't have to be stored, but the size does, because the data can't be read back correctly without it.
+  // Writes already stored it, but concurrent writes could have stored them out of order.
+  _parent->setSizeForChild(_fileBlob->key(), _fileBlob->size());
+  _parent->flush();
+}
+
+off_t CryOpenFile::seekData(off_t offset) const {
+  _device->callFsActionCallbacks();
+  if (offset < 0) {
+    throw FuseErrnoException(ENXIO);
+  }
+  auto result = _fileBlob->seekData(offset);
+  if (result == boost::none) {
+    throw FuseErrnoException(ENXIO);
+  }
+  return *result;
+}
+
+off_t CryOpenFile::seekHole(off_t offset) const {
+  _device->callFsActionCallbacks();
+  if (offset < 0) {
+    throw FuseErrnoException(ENXIO);
+  }
+  auto result = _fileBlob->seekHole(offset);
+  if (result == boost::none) {
+    throw FuseErrnoException(ENXIO);
+  }
+  return *result;
 }
 
 }
@@ -5,6 +5,7 @@
 #include <fspp/fs_interface/OpenFile.h>
 #include "parallelaccessfsblobstore/FileBlobRef.h"
 #include "parallelaccessfsblobstore/DirBlobRef.h"
+#include <blobstore/implementations/onblocks/readahead/ReadaheadWindow.h>
 
 namespace cryfs {
 class CryDevice;
@@ -18,14 +19,24 @@ public:
   void truncate(off_t size) const override;
   size_t read(void *buf, size_t count, off_t offset) const override;
   void write(const void *buf, size_t count, off_t offset) override;
+  void writeInPlace(size_t count, off_t offset, const std::function<void (void *target, size_t size)> &fill) override;
   void flush() override;
   void fsync() override;
   void fdatasync() override;
+  off_t seekData(off_t offset) const override;
+  off_t seekHole(off_t offset) const override;
 
 private:
+  void _updateAccessTimestamp() const;
+  void _updateModificationTimestampAndSize();
+
   const CryDevice *_device;
   std::shared_ptr<parallelaccessfsblobstore::DirBlobRef> _parent;
   cpputils::unique_ref<parallelaccessfsblobstore::FileBlobRef> _fileBlob;
+  // Detects sequential reads of this open file, so we can load the following blocks in the background.
+  mutable blobstore::onblocks::readahead::ReadaheadWindow _readahead;
+  // Registered with lazytime, so expired timestamp updates are written back even if the file isn't accessed anymore
+  boost::optional<uint64_t> _lazyWriteBackId;
 
   DISALLOW_COPY_AND_ASSIGN(CryOpenFile);
 };
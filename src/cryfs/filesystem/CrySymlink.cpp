@@ -46,7 +46,7 @@ fspp::Dir::EntryType CrySymlink::getType() const {
 
 bf::path CrySymlink::target() {
   device()->callFsActionCallbacks();
-  parent()->updateAccessTimestampForChild(key());
+  parent()->updateAccessTimestampForChild(key(), device()->atimeBehavior());
   auto blob = LoadBlob();
   return blob->target();
 }
@@ -19,6 +19,9 @@ using cryfs::fsblobstore::SymlinkBlob;
 namespace cryfs {
 namespace cachingfsblobstore {
 
+    // Blobs aren't accounted by size (computing the size of a blob is expensive), so only limit the number of entries.
+    const blockstore::caching::CacheConfig CachingFsBlobStore::DEFAULT_CACHE_CONFIG(50, 4);
+
     optional<unique_ref<FsBlobRef>> CachingFsBlobStore::load(const Key &key) {
         auto fromCache = _cache.pop(key);
         if (fromCache != none) {
@@ -16,7 +16,9 @@ namespace cryfs {
         //TODO Inherit from same interface as FsBlobStore?
         class CachingFsBlobStore final {
         public:
-            CachingFsBlobStore(cpputils::unique_ref<fsblobstore::FsBlobStore> baseBlobStore);
+            static const blockstore::caching::CacheConfig DEFAULT_CACHE_CONFIG;
+
+            CachingFsBlobStore(cpputils::unique_ref<fsblobstore::FsBlobStore> baseBlobStore, const blockstore::caching::CacheConfig &cacheConfig = DEFAULT_CACHE_CONFIG);
             ~CachingFsBlobStore();
 
             cpputils::unique_ref<FileBlobRef> createFileBlob();
@@ -36,15 +38,14 @@ namespace cryfs {
             cpputils::unique_ref<fsblobstore::FsBlobStore> _baseBlobStore;
 
             //TODO Move Cache to some common location, not in blockstore
-            //TODO Use other cache config (i.e. smaller max number of entries) here than in blockstore
-            blockstore::caching::Cache<blockstore::Key, cpputils::unique_ref<fsblobstore::FsBlob>, 50> _cache;
+            blockstore::caching::Cache<blockstore::Key, cpputils::unique_ref<fsblobstore::FsBlob>> _cache;
 
             DISALLOW_COPY_AND_ASSIGN(CachingFsBlobStore);
         };
 
 
-        inline CachingFsBlobStore::CachingFsBlobStore(cpputils::unique_ref<fsblobstore::FsBlobStore> baseBlobStore)
-                : _baseBlobStore(std::move(baseBlobStore)), _cache() {
+        inline CachingFsBlobStore::CachingFsBlobStore(cpputils::unique_ref<fsblobstore::FsBlobStore> baseBlobStore, const blockstore::caching::CacheConfig &cacheConfig)
+                : _baseBlobStore(std::move(baseBlobStore)), _cache(cacheConfig) {
         }
 
         inline CachingFsBlobStore::~CachingFsBlobStore() {
@@ -18,11 +18,11 @@ public:
 
     using Entry = fsblobstore::DirEntry;
 
-    boost::optional<const Entry&> GetChild(const std::string &name) const {
+    boost::optional<Entry> GetChild(const std::string &name) const {
         return _base->GetChild(name);
     }
 
-    boost::optional<const Entry&> GetChild(const blockstore::Key &key) const {
+    boost::optional<Entry> GetChild(const blockstore::Key &key) const {
         return _base->GetChild(key);
     }
 
@@ -44,15 +44,15 @@ public:
 
     void AddOrOverwriteChild(const std::string &name, const blockstore::Key &blobKey, fspp::Dir::EntryType type,
                   mode_t mode, uid_t uid, gid_t gid, timespec lastAccessTime, timespec lastModificationTime,
-                  std::function<void (const blockstore::Key &key)> onOverwritten) {
-        return _base->AddOrOverwriteChild(name, blobKey, type, mode, uid, gid, lastAccessTime, lastModificationTime, onOverwritten);
+                  boost::optional<uint64_t> size, std::function<void (const blockstore::Key &key)> onOverwritten) {
+        return _base->AddOrOverwriteChild(name, blobKey, type, mode, uid, gid, lastAccessTime, lastModificationTime, size, onOverwritten);
     }
 
     void RenameChild(const blockstore::Key &key, const std::string &newName, std::function<void (const blockstore::Key &key)> onOverwritten) {
         return _base->RenameChild(key, newName, onOverwritten);
     }
 
-    void statChild(const blockstore::Key &key, struct ::stat *result) const {
+    void statChild(const blockstore::Key &key, struct ::stat *result) {
         return _base->statChild(key, result);
     }
 
@@ -60,14 +60,26 @@ public:
         return _base->statChildWithSizeAlreadySet(key, result);
     }
 
-    void updateAccessTimestampForChild(const blockstore::Key &key) {
-        return _base->updateAccessTimestampForChild(key);
+    void updateAccessTimestampForChild(const blockstore::Key &key, fsblobstore::AtimeUpdateBehavior atimeBehavior) {
+        return _base->updateAccessTimestampForChild(key, atimeBehavior);
     }
 
     void updateModificationTimestampForChild(const blockstore::Key &key) {
         return _base->updateModificationTimestampForChild(key);
     }
 
+    void updateModificationTimestampAndSizeForChild(const blockstore::Key &key, uint64_t size) {
+        return _base->updateModificationTimestampAndSizeForChild(key, size);
+    }
+
+    void setSizeForChild(const blockstore::Key &key, uint64_t size) {
+        return _base->setSizeForChild(key, size);
+    }
+
+    void setDeferredTimestampsForChild(const blockstore::Key &key, boost::optional<timespec> lastAccessTime, boost::optional<timespec> lastModificationTime, fsblobstore::AtimeUpdateBehavior atimeBehavior) {
+        return _base->setDeferredTimestampsForChild(key, lastAccessTime, lastModificationTime, atimeBehavior);
+    }
+
     void chmodChild(const blockstore::Key &key, mode_t mode) {
         return _base->chmodChild(key, mode);
     }
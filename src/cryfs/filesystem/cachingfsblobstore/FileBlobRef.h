@@ -32,6 +32,22 @@ public:
         return _base->write(source, offset, count);
     }
 
+    void writeInPlace(uint64_t offset, uint64_t count, const std::function<void (void *target, uint64_t size)> &fill) {
+        return _base->writeInPlace(offset, count, fill);
+    }
+
+    void prefetch(uint64_t offset, uint64_t count) const {
+        return _base->prefetch(offset, count);
+    }
+
+    boost::optional<uint64_t> seekData(uint64_t offset) const {
+        return _base->seekData(offset);
+    }
+
+    boost::optional<uint64_t> seekHole(uint64_t offset) const {
+        return _base->seekHole(offset);
+    }
+
     void flush() {
         return _base->flush();
     }
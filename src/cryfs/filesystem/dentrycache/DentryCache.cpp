@@ -0,0 +1,154 @@
+#include "DentryCache.h"
+
+using blockstore::Key;
+using blockstore::caching::CacheStatistics;
+using boost::optional;
+using boost::none;
+using std::string;
+using std::unique_lock;
+using std::mutex;
+
+namespace bf = boost::filesystem;
+
+namespace cryfs {
+namespace dentrycache {
+
+constexpr size_t DentryCache::MAX_ENTRIES;
+
+DentryCache::DentryCache(const Key &rootKey)
+    : _mutex(), _rootKey(rootKey), _generation(0), _entries(), _pathsByKey(), _statistics() {
+}
+
+uint64_t DentryCache::generation() const {
+    unique_lock<mutex> lock(_mutex);
+    return _generation;
+}
+
+optional<DentryCache::Entry> DentryCache::lookup(const bf::path &path) {
+    unique_lock<mutex> lock(_mutex);
+    auto found = _entries.find(path.string());
+    if (found == _entries.end()) {
+        ++_statistics.numMisses;
+        return none;
+    }
+    ++_statistics.numHits;
+    return found->second;
+}
+
+optional<std::pair<bf::path, DentryCache::Entry>> DentryCache::lookupClosest(const bf::path &path) {
+    unique_lock<mutex> lock(_mutex);
+    for (bf::path current = path; current.has_relative_path(); current = current.parent_path()) {
+        auto found = _entries.find(current.string());
+        if (found != _entries.end()) {
+            if (current == path) {
+                ++_statistics.numHits;
+            } else {
+                ++_statistics.numMisses;
+            }
+            return std::make_pair(current, found->second);
+        }
+    }
+    ++_statistics.numMisses;
+    return none;
+}
+
+void DentryCache::insert(const bf::path &path, const Entry &entry, uint64_t generation) {
+    unique_lock<mutex> lock(_mutex);
+    if (generation != _generation) {
+        return;
+    }
+    if (entry.parentKey != _rootKey && _pathsByKey.count(entry.parentKey) == 0) {
+        // Invalidating the parent wouldn't find this entry
+        return;
+    }
+    string pathStr = path.string();
+    auto found = _entries.find(pathStr);
+    if (found != _entries.end()) {
+        if (found->second.key == entry.key) {
+            // Walking to a path inserts all directories on the way again, this keeps the entries below them
+            found->second = entry;
+            return;
+        }
+        // The entries below belong to the blob that was there before
+        _invalidate(pathStr);
+    }
+    if (_entries.size() >= MAX_ENTRIES) {
+        _clear();
+    }
+    _entries.emplace(pathStr, entry);
+    _statistics.numBytes += _numBytes(pathStr, entry);
+    if (entry.exists()) {
+        _pathsByKey.emplace(*entry.key, pathStr);
+    }
+}
+
+void DentryCache::invalidate(const Key &key) {
+    unique_lock<mutex> lock(_mutex);
+    ++_generation;
+    auto path = _pathOf(key);
+    if (path != none) {
+        _invalidate(*path);
+    }
+}
+
+void DentryCache::invalidateChild(const Key &parentKey, const string &name) {
+    unique_lock<mutex> lock(_mutex);
+    ++_generation;
+    auto parentPath = _pathOf(parentKey);
+    if (parentPath != none) {
+        _invalidate((bf::path(*parentPath) / name).string());
+    }
+}
+
+optional<string> DentryCache::_pathOf(const Key &key) const {
+    if (key == _rootKey) {
+        return string("/");
+    }
+    auto found = _pathsByKey.find(key);
+    if (found == _pathsByKey.end()) {
+        return none;
+    }
+    return found->second;
+}
+
+void DentryCache::_invalidate(const string &path) {
+    // All paths below "/a/b" start with "/a/b/" and sort before "/a/b0", because '0' follows '/'
+    auto begin = _entries.lower_bound(path);
+    auto end = _entries.lower_bound(path + '0');
+    for (auto entry = begin; entry != end; ) {
+        bool isPathOrBelow = entry->first == path || (entry->first.size() > path.size() && entry->first[path.size()] == '/');
+        if (!isPathOrBelow) {
+            ++entry;
+            continue;
+        }
+        if (entry->second.exists()) {
+            _pathsByKey.erase(*entry->second.key);
+        }
+        ++_statistics.numEvictions;
+        _statistics.numBytes -= _numBytes(entry->first, entry->second);
+        entry = _entries.erase(entry);
+    }
+}
+
+void DentryCache::_clear() {
+    _statistics.numEvictions += _entries.size();
+    _statistics.numBytes = 0;
+    _entries.clear();
+    _pathsByKey.clear();
+}
+
+uint64_t DentryCache::_numBytes(const string &path, const Entry &entry) {
+    uint64_t result = sizeof(string) + path.size() + sizeof(Entry);
+    if (entry.exists()) {
+        result += sizeof(Key) + sizeof(string) + path.size();
+    }
+    return result;
+}
+
+CacheStatistics DentryCache::statistics() const {
+    unique_lock<mutex> lock(_mutex);
+    return _statistics;
+}
+
+}
+}
@@ -0,0 +1,82 @@
+#pragma once
+#ifndef MESSMER_CRYFS_FILESYSTEM_DENTRYCACHE_DENTRYCACHE_H
+#define MESSMER_CRYFS_FILESYSTEM_DENTRYCACHE_DENTRYCACHE_H
+
+#include <blockstore/utils/Key.h>
+#include <blockstore/implementations/caching/cache/CacheStatistics.h>
+#include <fspp/fs_interface/Dir.h>
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+#include <cpp-utils/macros.h>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace cryfs {
+    namespace dentrycache {
+
+        // Caches which blob a path resolves to, so that loading a node doesn't have to walk
+        // through all directories on its path. Also caches paths that don't exist.
+        //
+        // Entries are never outdated, because they're invalidated when a directory entry changes.
+        // To not cache the result of a lookup that raced with such a change, lookups take the
+        // generation() before reading the directories and pass it to insert().
+        class DentryCache final {
+        public:
+            struct Entry final {
+                // none if the path doesn't exist
+                boost::optional<blockstore::Key> key;
+                // The directory containing the entry (or in which the entry wasn't found)
+                blockstore::Key parentKey;
+                // Only meaningful if the path exists
+                fspp::Dir::EntryType type;
+
+                bool exists() const {
+                    return key != boost::none;
+                }
+            };
+
+            static constexpr size_t MAX_ENTRIES = 10000;
+
+            explicit DentryCache(const blockstore::Key &rootKey);
+
+            uint64_t generation() const;
+            boost::optional<Entry> lookup(const boost::filesystem::path &path);
+            // Looks up the path or, if it isn't cached, the closest of its parent directories that is.
+            // Returns the path that was found together with its entry.
+            boost::optional<std::pair<boost::filesystem::path, Entry>> lookupClosest(const boost::filesystem::path &path);
+            // Doesn't insert anything if an entry was invalidated since the given generation.
+            // Replaces an existing entry for the path. The entries below it are only removed if it refers to a different blob now.
+            void insert(const boost::filesystem::path &path, const Entry &entry, uint64_t generation);
+
+            // Call these after the directory entry was changed.
+            // Invalidates the entry of the given blob and all entries below it
+            void invalidate(const blockstore::Key &key);
+            // Invalidates the entry with the given name in the given directory and all entries below it
+            void invalidateChild(const blockstore::Key &parentKey, const std::string &name);
+
+            blockstore::caching::CacheStatistics statistics() const;
+
+        private:
+            void _invalidate(const std::string &path);
+            void _clear();
+            boost::optional<std::string> _pathOf(const blockstore::Key &key) const;
+            // Memory used by an entry. The path is stored twice for existing entries, in _entries and in _pathsByKey.
+            static uint64_t _numBytes(const std::string &path, const Entry &entry);
+
+            mutable std::mutex _mutex;
+            const blockstore::Key _rootKey;
+            uint64_t _generation;
+            // Ordered, so the entries below a path can be found with a range query
+            std::map<std::string, Entry> _entries;
+            std::unordered_map<blockstore::Key, std::string> _pathsByKey;
+            blockstore::caching::CacheStatistics _statistics;
+
+            DISALLOW_COPY_AND_ASSIGN(DentryCache);
+        };
+
+    }
+}
+
+#endif
@@ -22,6 +22,7 @@ using cpputils::Data;
 using cpputils::unique_ref;
 using cpputils::make_unique_ref;
 using boost::none;
+using boost::optional;
 
 namespace cryfs {
 namespace fsblobstore {
@@ -29,9 +30,8 @@ namespace fsblobstore {
 constexpr off_t DirBlob::DIR_LSTAT_SIZE;
 
 DirBlob::DirBlob(FsBlobStore *fsBlobStore, unique_ref<Blob> blob, std::function<off_t (const blockstore::Key&)> getLstatSize) :
-    FsBlob(std::move(blob)), _fsBlobStore(fsBlobStore), _getLstatSize(getLstatSize), _entries(), _mutex(), _changed(false) {
+    FsBlob(std::move(blob)), _fsBlobStore(fsBlobStore), _getLstatSize(getLstatSize), _entries(&baseBlob()), _mutex() {
   ASSERT(baseBlob().blobType() == FsBlobView::BlobType::DIR, "Loaded blob is not a directory");
-  _readEntriesFromBlob();
 }
 
 DirBlob::~DirBlob() {
@@ -47,65 +47,54 @@ void DirBlob::flush() {
 
 unique_ref<DirBlob> DirBlob::InitializeEmptyDir(FsBlobStore *fsBlobStore, unique_ref<Blob> blob, std::function<off_t(const blockstore::Key&)> getLstatSize) {
   InitializeBlob(blob.get(), FsBlobView::BlobType::DIR);
-  return make_unique_ref<DirBlob>(fsBlobStore, std::move(blob), getLstatSize);
+  FsBlobView view(std::move(blob));
+  dirtree::DirEntryTree::Initialize(&view, {});
+  return make_unique_ref<DirBlob>(fsBlobStore, view.releaseBaseBlob(), getLstatSize);
 }
 
 void DirBlob::_writeEntriesToBlob() {
-  if (_changed) {
-    Data serialized = _entries.serialize();
-    baseBlob().resize(serialized.size());
-    baseBlob().write(serialized.data(), 0, serialized.size());
-    _changed = false;
-  }
-}
-
-void DirBlob::_readEntriesFromBlob() {
-  //No lock needed, because this is only called from the constructor.
-  Data data = baseBlob().readAll();
-  _entries.deserializeFrom(static_cast<uint8_t*>(data.data()), data.size());
+  _entries.flush();
 }
 
 void DirBlob::AddChildDir(const std::string &name, const Key &blobKey, mode_t mode, uid_t uid, gid_t gid, timespec lastAccessTime, timespec lastModificationTime) {
   std::unique_lock<std::mutex> lock(_mutex);
-  _addChild(name, blobKey, fspp::Dir::EntryType::DIR, mode, uid, gid, lastAccessTime, lastModificationTime);
+  _addChild(name, blobKey, fspp::Dir::EntryType::DIR, mode, uid, gid, lastAccessTime, lastModificationTime, static_cast<uint64_t>(DIR_LSTAT_SIZE));
 }
 
 void DirBlob::AddChildFile(const std::string &name, const Key &blobKey, mode_t mode, uid_t uid, gid_t gid, timespec lastAccessTime, timespec lastModificationTime) {
   std::unique_lock<std::mutex> lock(_mutex);
-  _addChild(name, blobKey, fspp::Dir::EntryType::FILE, mode, uid, gid, lastAccessTime, lastModificationTime);
+  _addChild(name, blobKey, fspp::Dir::EntryType::FILE, mode, uid, gid, lastAccessTime, lastModificationTime, UINT64_C(0));
 }
 
 void DirBlob::AddChildSymlink(const std::string &name, const blockstore::Key &blobKey, uid_t uid, gid_t gid, timespec lastAccessTime, timespec lastModificationTime) {
   std::unique_lock<std::mutex> lock(_mutex);
-  _addChild(name, blobKey, fspp::Dir::EntryType::SYMLINK, S_IFLNK | S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IWOTH | S_IXOTH, uid, gid, lastAccessTime, lastModificationTime);
+  _addChild(name, blobKey, fspp::Dir::EntryType::SYMLINK, S_IFLNK | S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IWOTH | S_IXOTH, uid, gid, lastAccessTime, lastModificationTime, none);
 }
 
 void DirBlob::_addChild(const std::string &name, const Key &blobKey,
-    fspp::Dir::EntryType entryType, mode_t mode, uid_t uid, gid_t gid, timespec lastAccessTime, timespec lastModificationTime) {
-  _entries.add(name, blobKey, entryType, mode, uid, gid, lastAccessTime, lastModificationTime);
-  _changed = true;
+    fspp::Dir::EntryType entryType, mode_t mode, uid_t uid, gid_t gid, timespec lastAccessTime, timespec lastModificationTime,
+    boost::optional<uint64_t> size) {
+  _entries.add(name, blobKey, entryType, mode, uid, gid, lastAccessTime, lastModificationTime, size);
 }
 
 void DirBlob::AddOrOverwriteChild(const std::string &name, const Key &blobKey, fspp::Dir::EntryType entryType,
                                   mode_t mode, uid_t uid, gid_t gid, timespec lastAccessTime, timespec lastModificationTime,
-                                  std::function<void (const blockstore::Key &key)> onOverwritten) {
+                                  boost::optional<uint64_t> size, std::function<void (const blockstore::Key &key)> onOverwritten) {
   std::unique_lock<std::mutex> lock(_mutex);
-  _entries.addOrOverwrite(name, blobKey, entryType, mode, uid, gid, lastAccessTime, lastModificationTime, onOverwritten);
-  _changed = true;
+  _entries.addOrOverwrite(name, blobKey, entryType, mode, uid, gid, lastAccessTime, lastModificationTime, size, onOverwritten);
 }
 
 void DirBlob::RenameChild(const blockstore::Key &key, const std::string &newName, std::function<void (const blockstore::Key &key)> onOverwritten) {
   std::unique_lock<std::mutex> lock(_mutex);
   _entries.rename(key, newName, onOverwritten);
-  _changed = true;
 }
 
-boost::optional<const DirEntry&> DirBlob::GetChild(const string &name) const {
+boost::optional<DirEntry> DirBlob::GetChild(const string &name) const {
   std::unique_lock<std::mutex> lock(_mutex);
   return _entries.get(name);
 }
 
-boost::optional<const DirEntry&> DirBlob::GetChild(const Key &key) const {
+boost::optional<DirEntry> DirBlob::GetChild(const Key &key) const {
   std::unique_lock<std::mutex> lock(_mutex);
   return _entries.get(key);
 }
@@ -113,38 +102,58 @@ boost::optional<const DirEntry&> DirBlob::GetChild(const Key &key) const {
 void DirBlob::RemoveChild(const string &name) {
   std::unique_lock<std::mutex> lock(_mutex);
   _entries.remove(name);
-  _changed = true;
 }
 
 void DirBlob::RemoveChild(const Key &key) {
   std::unique_lock<std::mutex> lock(_mutex);
   _entries.remove(key);
-  _changed = true;
 }
 
 void DirBlob::AppendChildrenTo(vector<fspp::Dir::Entry> *result) const {
   std::unique_lock<std::mutex> lock(_mutex);
   result->reserve(result->size() + _entries.size());
-  for (const auto &entry : _entries) {
-    result->emplace_back(entry.type(), entry.name());
-  }
+  _entries.forEach([result] (const DirEntry &entry) {
+    result->emplace_back(entry.type(), entry.name(), DirEntry::inodeNumber(entry.key()));
+  });
 }
 
 off_t DirBlob::lstat_size() const {
   return DIR_LSTAT_SIZE;
 }
 
-void DirBlob::statChild(const Key &key, struct ::stat *result) const {
-  result->st_size = _getLstatSize(key);
-  statChildWithSizeAlreadySet(key, result);
+void DirBlob::statChild(const Key &key, struct ::stat *result) {
+  auto child = GetChild(key);
+  if (child == boost::none) {
+    throw fspp::fuse::FuseErrnoException(ENOENT);
+  }
+  result->st_size = _lstatSize(*child);
+  _statChild(*child, result);
+}
+
+off_t DirBlob::_lstatSize(const DirEntry &child) {
+  if (child.size() != none) {
+    return *child.size();
+  }
+  if (child.type() == fspp::Dir::EntryType::DIR) {
+    return DIR_LSTAT_SIZE;
+  }
+  // The entry was stored by an older CryFS version. Load the blob once and remember its size.
+  off_t size = _getLstatSize(child.key());
+  std::unique_lock<std::mutex> lock(_mutex);
+  // The entry could have been unlinked or renamed meanwhile, or a concurrent write could have set the size
+  _entries.setSizeIfUnknown(child.key(), size);
+  return size;
 }
 
 void DirBlob::statChildWithSizeAlreadySet(const Key &key, struct ::stat *result) const {
-  auto childOpt = GetChild(key);
-  if (childOpt == boost::none) {
+  auto child = GetChild(key);
+  if (child == boost::none) {
     throw fspp::fuse::FuseErrnoException(ENOENT);
   }
-  const auto &child = *childOpt;
+  _statChild(*child, result);
+}
+
+void DirBlob::_statChild(const DirEntry &child, struct ::stat *result) const {
   result->st_mode = child.mode();
   result->st_uid = child.uid();
   result->st_gid = child.gid();
@@ -158,35 +167,44 @@ void DirBlob::statChildWithSizeAlreadySet(const Key &key, struct ::stat *result)
   result->st_blksize = _fsBlobStore->virtualBlocksizeBytes();
 }
 
-void DirBlob::updateAccessTimestampForChild(const Key &key) {
+void DirBlob::updateAccessTimestampForChild(const Key &key, AtimeUpdateBehavior atimeBehavior) {
   std::unique_lock<std::mutex> lock(_mutex);
-  _entries.updateAccessTimestampForChild(key);
-  _changed = true;
+  _entries.updateAccessTimestampForChild(key, atimeBehavior);
 }
 
 void DirBlob::updateModificationTimestampForChild(const Key &key) {
   std::unique_lock<std::mutex> lock(_mutex);
   _entries.updateModificationTimestampForChild(key);
-  _changed = true;
+}
+
+void DirBlob::updateModificationTimestampAndSizeForChild(const Key &key, uint64_t size) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _entries.updateModificationTimestampAndSizeForChild(key, size);
+}
+
+void DirBlob::setSizeForChild(const Key &key, uint64_t size) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _entries.setSize(key, size);
+}
+
+void DirBlob::setDeferredTimestampsForChild(const Key &key, optional<timespec> lastAccessTime, optional<timespec> lastModificationTime, AtimeUpdateBehavior atimeBehavior) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _entries.setDeferredTimestamps(key, lastAccessTime, lastModificationTime, atimeBehavior);
 }
 
 void DirBlob::chmodChild(const Key &key, mode_t mode) {
   std::unique_lock<std::mutex> lock(_mutex);
   _entries.setMode(key, mode);
-  _changed = true;
 }
 
 void DirBlob::chownChild(const Key &key, uid_t uid, gid_t gid) {
   std::unique_lock<std::mutex> lock(_mutex);
-  if(_entries.setUidGid(key, uid, gid)) {
-    _changed = true;
-  }
+  _entries.setUidGid(key, uid, gid);
 }
 
 void DirBlob::utimensChild(const Key &key, timespec lastAccessTime, timespec lastModificationTime) {
   std::unique_lock<std::mutex> lock(_mutex);
   _entries.setAccessTimes(key, lastAccessTime, lastModificationTime);
-  _changed = true;
 }
 
 void DirBlob::setLstatSizeGetter(std::function<off_t(const blockstore::Key&)> getLstatSize) {
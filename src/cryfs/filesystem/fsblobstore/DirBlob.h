@@ -6,7 +6,7 @@
 #include <cpp-utils/macros.h>
 #include <fspp/fs_interface/Dir.h>
 #include "FsBlob.h"
-#include "utils/DirEntryList.h"
+#include "utils/dirtree/DirEntryTree.h"
 #include <mutex>
 
 namespace cryfs {
@@ -31,9 +31,9 @@ namespace cryfs {
             //TODO Test NumChildren()
             size_t NumChildren() const;
 
-            boost::optional<const DirEntry&> GetChild(const std::string &name) const;
+            boost::optional<DirEntry> GetChild(const std::string &name) const;
 
-            boost::optional<const DirEntry&> GetChild(const blockstore::Key &key) const;
+            boost::optional<DirEntry> GetChild(const blockstore::Key &key) const;
 
             void AddChildDir(const std::string &name, const blockstore::Key &blobKey, mode_t mode, uid_t uid,
                              gid_t gid, timespec lastAccessTime, timespec lastModificationTime);
@@ -45,7 +45,7 @@ namespace cryfs {
 
             void AddOrOverwriteChild(const std::string &name, const blockstore::Key &blobKey, fspp::Dir::EntryType type,
                           mode_t mode, uid_t uid, gid_t gid, timespec lastAccessTime, timespec lastModificationTime,
-                          std::function<void (const blockstore::Key &key)> onOverwritten);
+                          boost::optional<uint64_t> size, std::function<void (const blockstore::Key &key)> onOverwritten);
 
             void RenameChild(const blockstore::Key &key, const std::string &newName, std::function<void (const blockstore::Key &key)> onOverwritten);
 
@@ -55,14 +55,21 @@ namespace cryfs {
 
             void flush();
 
-            void statChild(const blockstore::Key &key, struct ::stat *result) const;
+            // Entries stored by older CryFS versions don't know their size yet. It is looked up and stored on the first call.
+            void statChild(const blockstore::Key &key, struct ::stat *result);
 
             void statChildWithSizeAlreadySet(const blockstore::Key &key, struct ::stat *result) const;
 
-            void updateAccessTimestampForChild(const blockstore::Key &key);
+            void updateAccessTimestampForChild(const blockstore::Key &key, AtimeUpdateBehavior atimeBehavior);
 
             void updateModificationTimestampForChild(const blockstore::Key &key);
 
+            void updateModificationTimestampAndSizeForChild(const blockstore::Key &key, uint64_t size);
+
+            void setSizeForChild(const blockstore::Key &key, uint64_t size);
+
+            void setDeferredTimestampsForChild(const blockstore::Key &key, boost::optional<timespec> lastAccessTime, boost::optional<timespec> lastModificationTime, AtimeUpdateBehavior atimeBehavior);
+
             void chmodChild(const blockstore::Key &key, mode_t mode);
 
             void chownChild(const blockstore::Key &key, uid_t uid, gid_t gid);
@@ -74,17 +81,18 @@ namespace cryfs {
         private:
 
             void _addChild(const std::string &name, const blockstore::Key &blobKey, fspp::Dir::EntryType type,
-                          mode_t mode, uid_t uid, gid_t gid, timespec lastAccessTime, timespec lastModificationTime);
-            void _readEntriesFromBlob();
+                          mode_t mode, uid_t uid, gid_t gid, timespec lastAccessTime, timespec lastModificationTime,
+                          boost::optional<uint64_t> size);
+            void _statChild(const DirEntry &child, struct ::stat *result) const;
+            off_t _lstatSize(const DirEntry &child);
             void _writeEntriesToBlob();
 
             cpputils::unique_ref<blobstore::Blob> releaseBaseBlob() override;
 
             FsBlobStore *_fsBlobStore;
             std::function<off_t (const blockstore::Key&)> _getLstatSize;
-            DirEntryList _entries;
+            dirtree::DirEntryTree _entries;
             mutable std::mutex _mutex;
-            bool _changed;
 
             DISALLOW_COPY_AND_ASSIGN(DirBlob);
         };
@@ -29,6 +29,22 @@ void FileBlob::write(const void *source, uint64_t offset, uint64_t count) {
   baseBlob().write(source, offset, count);
 }
 
+void FileBlob::writeInPlace(uint64_t offset, uint64_t count, const std::function<void (void *target, uint64_t size)> &fill) {
+  baseBlob().writeInPlace(offset, count, fill);
+}
+
+void FileBlob::prefetch(uint64_t offset, uint64_t count) const {
+  baseBlob().prefetch(offset, count);
+}
+
+boost::optional<uint64_t> FileBlob::seekData(uint64_t offset) const {
+  return baseBlob().seekData(offset);
+}
+
+boost::optional<uint64_t> FileBlob::seekHole(uint64_t offset) const {
+  return baseBlob().seekHole(offset);
+}
+
 void FileBlob::flush() {
   baseBlob().flush();
 }
@@ -17,6 +17,14 @@ namespace cryfs {
 
             void write(const void *source, uint64_t offset, uint64_t count);
 
+            void writeInPlace(uint64_t offset, uint64_t count, const std::function<void (void *target, uint64_t size)> &fill);
+
+            void prefetch(uint64_t offset, uint64_t count) const;
+
+            boost::optional<uint64_t> seekData(uint64_t offset) const;
+
+            boost::optional<uint64_t> seekHole(uint64_t offset) const;
+
             void flush();
 
             void resize(off_t size);
@@ -2,6 +2,8 @@
 #include "FileBlob.h"
 #include "DirBlob.h"
 #include "SymlinkBlob.h"
+#include "utils/DirEntryList.h"
+#include <cpp-utils/logging/logging.h>
 
 namespace bf = boost::filesystem;
 using cpputils::unique_ref;
@@ -10,6 +12,10 @@ using blobstore::BlobStore;
 using blockstore::Key;
 using boost::none;
 using std::function;
+using std::vector;
+using blobstore::Blob;
+using cpputils::Data;
+using namespace cpputils::logging;
 
 namespace cryfs {
 namespace fsblobstore {
@@ -23,6 +29,9 @@ boost::optional<unique_ref<FsBlob>> FsBlobStore::load(const blockstore::Key &key
     if (blobType == FsBlobView::BlobType::FILE) {
         return unique_ref<FsBlob>(make_unique_ref<FileBlob>(std::move(*blob)));
     } else if (blobType == FsBlobView::BlobType::DIR) {
+        if (FsBlobView::formatVersion(**blob) == FsBlobView::FORMAT_VERSION_HEADER_FLAT_DIRS) {
+            throw std::runtime_error("Directory " + key.ToString() + " is stored in the format of an older CryFS version and has to be migrated.");
+        }
         return unique_ref<FsBlob>(make_unique_ref<DirBlob>(this, std::move(*blob), _getLstatSize()));
     } else if (blobType == FsBlobView::BlobType::SYMLINK) {
         return unique_ref<FsBlob>(make_unique_ref<SymlinkBlob>(std::move(*blob)));
@@ -31,5 +40,43 @@ boost::optional<unique_ref<FsBlob>> FsBlobStore::load(const blockstore::Key &key
     }
 }
 
+void FsBlobStore::MigrateDirectories(BlobStore *baseBlobStore, const Key &rootKey) {
+    auto root = baseBlobStore->load(rootKey);
+    if (root == none) {
+        throw std::runtime_error("Could not load the root directory. Is the base directory accessible?");
+    }
+    if (FsBlobView::formatVersion(**root) != FsBlobView::FORMAT_VERSION_HEADER_FLAT_DIRS) {
+        return;
+    }
+    LOG(INFO, "Converting directories to the new directory format");
+    _migrateDir(baseBlobStore, std::move(*root));
+    LOG(INFO, "Converting directories finished");
+}
+
+void FsBlobStore::_migrateDir(BlobStore *baseBlobStore, unique_ref<Blob> blob) {
+    FsBlobView view(std::move(blob));
+    ASSERT(view.blobType() == FsBlobView::BlobType::DIR, "Blob is not a directory");
+    Data flat = view.readAll();
+    DirEntryList entries;
+    entries.deserializeFrom(flat.data(), flat.size());
+    for (const auto &entry : entries) {
+        if (entry.type() != fspp::Dir::EntryType::DIR) {
+            continue;
+        }
+        auto child = baseBlobStore->load(entry.key());
+        if (child == none) {
+            LOG(ERROR, "Directory {} not found while converting directories", entry.key().ToString());
+            continue;
+        }
+        if (FsBlobView::formatVersion(**child) == FsBlobView::FORMAT_VERSION_HEADER_FLAT_DIRS) {
+            _migrateDir(baseBlobStore, std::move(*child));
+        }
+    }
+    dirtree::DirEntryTree::Initialize(&view, vector<DirEntry>(entries.begin(), entries.end()));
+    // Only now the directory counts as converted, see MigrateDirectories()
+    view.upgradeFormatVersion();
+    view.flush();
+}
+
 }
 }
\ No newline at end of file
@@ -27,8 +27,16 @@ namespace cryfs {
 
             uint64_t virtualBlocksizeBytes() const;
 
+            // File systems created by CryFS 0.9.7 and older store directory entries one after the other.
+            // This converts all directories that are still stored that way. Subdirectories are converted before
+            // their parent, so an interrupted migration continues on the next call, and if the root directory
+            // is converted, there is nothing left to do.
+            static void MigrateDirectories(blobstore::BlobStore *baseBlobStore, const blockstore::Key &rootKey);
+
         private:
 
+            static void _migrateDir(blobstore::BlobStore *baseBlobStore, cpputils::unique_ref<blobstore::Blob> blob);
+
             std::function<off_t(const blockstore::Key &)> _getLstatSize();
 
             cpputils::unique_ref<blobstore::BlobStore> _baseBlobStore;
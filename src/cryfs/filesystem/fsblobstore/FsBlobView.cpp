@@ -2,4 +2,5 @@
 
 namespace cryfs {
     constexpr uint16_t FsBlobView::FORMAT_VERSION_HEADER;
+    constexpr uint16_t FsBlobView::FORMAT_VERSION_HEADER_FLAT_DIRS;
 }
\ No newline at end of file
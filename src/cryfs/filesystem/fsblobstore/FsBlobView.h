@@ -37,6 +37,25 @@ namespace cryfs {
             return _blobType(*_baseBlob);
         }
 
+        static uint16_t formatVersion(const blobstore::Blob &blob) {
+            _checkHeader(blob);
+            return _formatVersion(blob);
+        }
+
+        uint16_t formatVersion() const {
+            return _formatVersion(*_baseBlob);
+        }
+
+        // Marks the blob as stored in the current format. Call this after converting its content.
+        void upgradeFormatVersion() {
+            _baseBlob->write(&FORMAT_VERSION_HEADER, 0, sizeof(FORMAT_VERSION_HEADER));
+        }
+
+        // Version 1 stores directories in pages (see DirEntryTree).
+        // Version 0 stored directory entries one after the other. Files and symlinks didn't change.
+        static constexpr uint16_t FORMAT_VERSION_HEADER = 1;
+        static constexpr uint16_t FORMAT_VERSION_HEADER_FLAT_DIRS = 0;
+
         const blockstore::Key &key() const override {
             return _baseBlob->key();
         }
@@ -69,6 +88,22 @@ namespace cryfs {
             return _baseBlob->write(source, offset + sizeof(FORMAT_VERSION_HEADER) + 1, size);
         }
 
+        void writeInPlace(uint64_t offset, uint64_t size, const std::function<void (void *target, uint64_t size)> &fill) override {
+            return _baseBlob->writeInPlace(offset + sizeof(FORMAT_VERSION_HEADER) + 1, size, fill);
+        }
+
+        void prefetch(uint64_t offset, uint64_t size) const override {
+            return _baseBlob->prefetch(offset + sizeof(FORMAT_VERSION_HEADER) + 1, size);
+        }
+
+        boost::optional<uint64_t> seekData(uint64_t offset) const override {
+            return _fromBaseOffset(_baseBlob->seekData(offset + sizeof(FORMAT_VERSION_HEADER) + 1));
+        }
+
+        boost::optional<uint64_t> seekHole(uint64_t offset) const override {
+            return _fromBaseOffset(_baseBlob->seekHole(offset + sizeof(FORMAT_VERSION_HEADER) + 1));
+        }
+
         void flush() override {
             return _baseBlob->flush();
         }
@@ -78,17 +113,27 @@ namespace cryfs {
         }
 
     private:
-        static constexpr uint16_t FORMAT_VERSION_HEADER = 0;
-
         static void _checkHeader(const blobstore::Blob &blob) {
-            static_assert(sizeof(uint16_t) == sizeof(FORMAT_VERSION_HEADER), "Wrong type used to read format version header");
-            uint16_t actualFormatVersion;
-            blob.read(&actualFormatVersion, 0, sizeof(FORMAT_VERSION_HEADER));
-            if (FORMAT_VERSION_HEADER != actualFormatVersion) {
+            uint16_t actualFormatVersion = _formatVersion(blob);
+            if (FORMAT_VERSION_HEADER != actualFormatVersion && FORMAT_VERSION_HEADER_FLAT_DIRS != actualFormatVersion) {
                 throw std::runtime_error("This file system entity has the wrong format. Was it created with a newer version of CryFS?");
             }
         }
 
+        static uint16_t _formatVersion(const blobstore::Blob &blob) {
+            static_assert(sizeof(uint16_t) == sizeof(FORMAT_VERSION_HEADER), "Wrong type used to read format version header");
+            uint16_t formatVersion;
+            blob.read(&formatVersion, 0, sizeof(FORMAT_VERSION_HEADER));
+            return formatVersion;
+        }
+
+        static boost::optional<uint64_t> _fromBaseOffset(boost::optional<uint64_t> offset) {
+            if (offset == boost::none) {
+                return boost::none;
+            }
+            return *offset - sizeof(FORMAT_VERSION_HEADER) - 1;
+        }
+
         static BlobType _blobType(const blobstore::Blob &blob) {
             uint8_t result;
             blob.read(&result, sizeof(FORMAT_VERSION_HEADER), 1);
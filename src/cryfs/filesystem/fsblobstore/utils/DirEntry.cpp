@@ -1,4 +1,6 @@
 #include "DirEntry.h"
+#include <algorithm>
+#include <cstring>
 
 using std::vector;
 using std::string;
@@ -42,6 +44,15 @@ namespace cryfs {
             return pos;
         }
 
+        ino_t DirEntry::inodeNumber(const Key &key) {
+            // Blob keys are random, so their first bytes are as good as a hash and inode numbers stay stable across renames and remounts.
+            // 0 isn't a valid inode number and FUSE reserves 1 for the root directory.
+            ino_t result;
+            static_assert(sizeof(result) <= Key::BINARY_LENGTH, "Key too short to derive an inode number from");
+            std::memcpy(&result, key.data(), sizeof(result));
+            return std::max(result, (ino_t)2);
+        }
+
         unsigned int DirEntry::_serializeTimeValue(uint8_t *dest, timespec value) {
             unsigned int offset = 0;
             *reinterpret_cast<uint64_t*>(dest+offset) = value.tv_sec;
@@ -5,10 +5,9 @@
 #include <blockstore/utils/Key.h>
 #include <fspp/fs_interface/Dir.h>
 #include <cpp-utils/system/time.h>
+#include <boost/optional.hpp>
 #include <sys/stat.h>
 
-// TODO Implement (and test) atime, noatime, strictatime, relatime mount options
-
 namespace cryfs {
     namespace fsblobstore {
 
@@ -22,6 +21,9 @@ namespace cryfs {
             size_t serializedSize() const;
             static const char *deserializeAndAddToVector(const char *pos, std::vector<DirEntry> *result);
 
+            // Inode number reported for the blob with the given key
+            static ino_t inodeNumber(const blockstore::Key &key);
+
             fspp::Dir::EntryType type() const;
             void setType(fspp::Dir::EntryType value);
 
@@ -47,6 +49,11 @@ namespace cryfs {
 
             timespec lastMetadataChangeTime() const;
 
+            // Size reported by lstat, so it can be returned without loading the blob.
+            // It isn't part of serialize() and is none for entries that were stored without it.
+            boost::optional<uint64_t> size() const;
+            void setSize(boost::optional<uint64_t> value);
+
         private:
             static size_t _serializedTimeValueSize();
             static unsigned int _serializeTimeValue(uint8_t *dest, timespec value);
@@ -71,13 +78,14 @@ namespace cryfs {
             timespec _lastAccessTime;
             timespec _lastModificationTime;
             timespec _lastMetadataChangeTime;
+            boost::optional<uint64_t> _size;
         };
 
         inline DirEntry::DirEntry(fspp::Dir::EntryType type, const std::string &name, const blockstore::Key &key, mode_t mode,
             uid_t uid, gid_t gid, timespec lastAccessTime, timespec lastModificationTime,
             timespec lastMetadataChangeTime)
                 : _type(type), _name(name), _key(key), _mode(mode), _uid(uid), _gid(gid), _lastAccessTime(lastAccessTime),
-                _lastModificationTime(lastModificationTime), _lastMetadataChangeTime(lastMetadataChangeTime) {
+                _lastModificationTime(lastModificationTime), _lastMetadataChangeTime(lastMetadataChangeTime), _size(boost::none) {
             switch (_type) {
                 case fspp::Dir::EntryType::FILE:
                     _mode |= S_IFREG;
@@ -130,6 +138,14 @@ namespace cryfs {
             return _lastMetadataChangeTime;
         }
 
+        inline boost::optional<uint64_t> DirEntry::size() const {
+            return _size;
+        }
+
+        inline void DirEntry::setSize(boost::optional<uint64_t> value) {
+            _size = value;
+        }
+
         inline void DirEntry::setType(fspp::Dir::EntryType value) {
             _type = value;
             _updateLastMetadataChangeTime();
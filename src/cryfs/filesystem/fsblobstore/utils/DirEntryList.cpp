@@ -77,7 +77,7 @@ void DirEntryList::addOrOverwrite(const string &name, const Key &blobKey, fspp::
 void DirEntryList::rename(const blockstore::Key &key, const std::string &name, std::function<void (const blockstore::Key &key)> onOverwritten) {
     auto foundSameName = _findByName(name);
     if (foundSameName != _entries.end() && foundSameName->key() != key) {
-        _checkAllowedOverwrite(foundSameName->type(), _findByKey(key)->type());
+        checkAllowedOverwrite(foundSameName->type(), _findByKey(key)->type());
         onOverwritten(foundSameName->key());
         _entries.erase(foundSameName);
     }
@@ -85,7 +85,7 @@ void DirEntryList::rename(const blockstore::Key &key, const std::string &name, s
     _findByKey(key)->setName(name);
 }
 
-void DirEntryList::_checkAllowedOverwrite(fspp::Dir::EntryType oldType, fspp::Dir::EntryType newType) {
+void DirEntryList::checkAllowedOverwrite(fspp::Dir::EntryType oldType, fspp::Dir::EntryType newType) {
     if (oldType != newType) {
         if (oldType == fspp::Dir::EntryType::DIR) {
             // new path is an existing directory, but old path is not a directory
@@ -100,7 +100,7 @@ void DirEntryList::_checkAllowedOverwrite(fspp::Dir::EntryType oldType, fspp::Di
 
 void DirEntryList::_overwrite(vector<DirEntry>::iterator entry, const string &name, const Key &blobKey, fspp::Dir::EntryType entryType, mode_t mode,
                         uid_t uid, gid_t gid, timespec lastAccessTime, timespec lastModificationTime) {
-    _checkAllowedOverwrite(entry->type(), entryType);
+    checkAllowedOverwrite(entry->type(), entryType);
     // The new entry has possibly a different key, so it has to be in a different list position (list is ordered by keys).
     // That's why we remove-and-add instead of just modifying the existing entry.
     _entries.erase(entry);
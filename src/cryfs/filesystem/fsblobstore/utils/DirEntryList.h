@@ -32,6 +32,9 @@ namespace cryfs {
             void remove(const std::string &name);
             void remove(const blockstore::Key &key);
 
+            // Throws if an entry of type oldType can't be overwritten with an entry of type newType
+            static void checkAllowedOverwrite(fspp::Dir::EntryType oldType, fspp::Dir::EntryType newType);
+
             size_t size() const;
             const_iterator begin() const;
             const_iterator end() const;
@@ -56,7 +59,6 @@ namespace cryfs {
                      mode_t mode, uid_t uid, gid_t gid, timespec lastAccessTime, timespec lastModificationTime);
             void _overwrite(std::vector<DirEntry>::iterator entry, const std::string &name, const blockstore::Key &blobKey, fspp::Dir::EntryType entryType,
                       mode_t mode, uid_t uid, gid_t gid, timespec lastAccessTime, timespec lastModificationTime);
-            static void _checkAllowedOverwrite(fspp::Dir::EntryType oldType, fspp::Dir::EntryType newType);
 
             std::vector<DirEntry> _entries;
 
@@ -0,0 +1,41 @@
+#pragma once
+#ifndef MESSMER_CRYFS_FILESYSTEM_FSBLOBSTORE_UTILS_TIMESTAMPUPDATEBEHAVIOR_H
+#define MESSMER_CRYFS_FILESYSTEM_FSBLOBSTORE_UTILS_TIMESTAMPUPDATEBEHAVIOR_H
+
+#include <cpp-utils/system/time.h>
+#include <cstdint>
+
+namespace cryfs {
+    namespace fsblobstore {
+
+        // When reading a node updates its access timestamp. These behave like the Linux mount options of the same name.
+        enum class AtimeUpdateBehavior : uint8_t {
+            // Every read updates it
+            STRICTATIME,
+            // A read only updates it if it isn't newer than the modification or metadata change timestamp,
+            // or if it is older than a day. Tools checking whether a file was read since it was modified keep working.
+            RELATIME,
+            // Reads never update it
+            NOATIME
+        };
+
+        constexpr time_t RELATIME_MAX_AGE_SECONDS = 24 * 60 * 60;
+
+        inline bool shouldUpdateAccessTimestamp(AtimeUpdateBehavior behavior, timespec lastAccessTime, timespec lastModificationTime, timespec lastMetadataChangeTime, timespec now) {
+            switch (behavior) {
+                case AtimeUpdateBehavior::STRICTATIME:
+                    return true;
+                case AtimeUpdateBehavior::NOATIME:
+                    return false;
+                case AtimeUpdateBehavior::RELATIME:
+                    return lastAccessTime <= lastModificationTime
+                        || lastAccessTime <= lastMetadataChangeTime
+                        || now.tv_sec - lastAccessTime.tv_sec >= RELATIME_MAX_AGE_SECONDS;
+            }
+            return true;
+        }
+
+    }
+}
+
+#endif
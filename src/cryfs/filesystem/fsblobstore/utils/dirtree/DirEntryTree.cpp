@@ -0,0 +1,545 @@
+#include "DirEntryTree.h"
+#include "../DirEntryList.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <cpp-utils/logging/logging.h>
+#include <cpp-utils/random/Random.h>
+#include <cpp-utils/system/time.h>
+
+//TODO Get rid of that in favor of better error handling
+#include <fspp/fuse/FuseErrnoException.h>
+
+using blobstore::Blob;
+using blockstore::Key;
+using cpputils::Data;
+using cpputils::make_unique_ref;
+using std::string;
+using std::vector;
+using std::function;
+using boost::optional;
+using boost::none;
+using namespace cpputils::logging;
+
+namespace cryfs {
+namespace fsblobstore {
+namespace dirtree {
+
+constexpr uint32_t DirEntryTree::FORMAT_VERSION;
+
+namespace {
+    static_assert(sizeof(uint32_t) * 4 + sizeof(uint64_t) * 2 == 32, "Header layout changed");
+    constexpr uint64_t HEADER_OFFSET = PageStore::HEADER_SIZE;
+    // Small directories store their entries in the header page, behind the header
+    constexpr uint64_t INLINE_ENTRIES_OFFSET = HEADER_OFFSET + 32;
+    // Stored instead of the size for entries whose size isn't known yet
+    constexpr uint64_t UNKNOWN_SIZE = std::numeric_limits<uint64_t>::max();
+}
+
+void DirEntryTree::Initialize(Blob *blob, const vector<DirEntry> &entries) {
+    PageStore::Initialize(blob);
+    {
+        PageStore pages(blob);
+        Header header;
+        header.nameTreeRoot = 0;
+        header.keyTreeRoot = 0;
+        header.numEntries = 0;
+        header.formatVersion = FORMAT_VERSION;
+        header.reserved = 0;
+        auto salt = cpputils::Random::PseudoRandom().getFixedSize<sizeof(uint64_t)>();
+        std::memcpy(&header.hashSalt, salt.data(), sizeof(header.hashSalt));
+        Data headerPage = pages.read(0).copy();
+        std::memcpy(headerPage.dataOffset(HEADER_OFFSET), &header, sizeof(header));
+        pages.write(0, std::move(headerPage));
+        pages.flush();
+    }
+    if (!entries.empty()) {
+        DirEntryTree tree(blob);
+        for (const auto &entry : entries) {
+            tree._insert(entry);
+            tree._finishModification();
+        }
+        tree.flush();
+    }
+}
+
+DirEntryTree::DirEntryTree(Blob *blob)
+    : _pages(blob), _header(_loadHeader(&_pages)), _storedHeader(_header), _nameTree(none), _keyTree(none), _inlineEntries(), _inlineEntriesChanged(false) {
+    if (_header.formatVersion > FORMAT_VERSION) {
+        throw std::runtime_error("Directory " + blob->key().ToString() + " was stored by a newer CryFS version. Please update CryFS.");
+    }
+    if (_header.nameTreeRoot == 0) {
+        _inlineEntries = _loadInlineEntries();
+    } else {
+        _nameTree = make_unique_ref<HashBTree>(&_pages, _header.nameTreeRoot);
+        _keyTree = make_unique_ref<HashBTree>(&_pages, _header.keyTreeRoot);
+    }
+    if (_header.formatVersion < FORMAT_VERSION) {
+        // Entries stored without a size are read as entries with unknown size, so they don't have to be rewritten
+        _header.formatVersion = FORMAT_VERSION;
+        _finishModification();
+    }
+}
+
+DirEntryTree::Header DirEntryTree::_loadHeader(PageStore *pages) {
+    Header header;
+    std::memcpy(&header, pages->read(0).dataOffset(HEADER_OFFSET), sizeof(header));
+    return header;
+}
+
+void DirEntryTree::_storeHeaderIfChanged() {
+    if (_nameTree != none) {
+        _header.nameTreeRoot = (*_nameTree)->rootPage();
+        _header.keyTreeRoot = (*_keyTree)->rootPage();
+    }
+    if (!_inlineEntriesChanged && 0 == std::memcmp(&_header, &_storedHeader, sizeof(_header))) {
+        return;
+    }
+    Data headerPage = _pages.read(0).copy();
+    std::memcpy(headerPage.dataOffset(HEADER_OFFSET), &_header, sizeof(_header));
+    if (_inlineEntriesChanged) {
+        _serializeInlineEntries(&headerPage);
+        _inlineEntriesChanged = false;
+    }
+    _pages.write(0, std::move(headerPage));
+    _storedHeader = _header;
+}
+
+vector<DirEntry> DirEntryTree::_loadInlineEntries() {
+    vector<DirEntry> entries;
+    entries.reserve(_header.numEntries);
+    const Data &headerPage = _pages.read(0);
+    const char *pos = static_cast<const char*>(headerPage.dataOffset(INLINE_ENTRIES_OFFSET));
+    const char *end = static_cast<const char*>(headerPage.dataOffset(PageStore::PAGE_SIZE));
+    for (uint64_t i = 0; i < _header.numEntries; ++i) {
+        pos = DirEntry::deserializeAndAddToVector(pos, &entries);
+        uint64_t size;
+        if (pos + sizeof(size) > end) {
+            throw std::runtime_error("The entries of a directory don't fit into its header page. The directory is corrupted.");
+        }
+        std::memcpy(&size, pos, sizeof(size));
+        pos += sizeof(size);
+        if (size != UNKNOWN_SIZE) {
+            entries.back().setSize(size);
+        }
+    }
+    return entries;
+}
+
+void DirEntryTree::_serializeInlineEntries(Data *headerPage) const {
+    uint64_t offset = INLINE_ENTRIES_OFFSET;
+    for (const auto &entry : _inlineEntries) {
+        Data serialized = _serializeEntry(entry);
+        ASSERT(offset + serialized.size() <= PageStore::PAGE_SIZE, "Entries don't fit into the header page");
+        std::memcpy(headerPage->dataOffset(offset), serialized.data(), serialized.size());
+        offset += serialized.size();
+    }
+    std::memset(headerPage->dataOffset(offset), 0, PageStore::PAGE_SIZE - offset);
+}
+
+bool DirEntryTree::_inlineEntriesFit() const {
+    uint64_t size = INLINE_ENTRIES_OFFSET;
+    for (const auto &entry : _inlineEntries) {
+        size += entry.serializedSize() + sizeof(uint64_t);
+    }
+    return size <= PageStore::PAGE_SIZE;
+}
+
+void DirEntryTree::_createTrees() {
+    _nameTree = make_unique_ref<HashBTree>(&_pages, HashBTree::CreateEmpty(&_pages));
+    _keyTree = make_unique_ref<HashBTree>(&_pages, HashBTree::CreateEmpty(&_pages));
+    for (const auto &entry : _inlineEntries) {
+        _insertIntoTrees(entry);
+    }
+    _inlineEntries.clear();
+    _inlineEntriesChanged = true;
+}
+
+void DirEntryTree::_finishModification() {
+    _storeHeaderIfChanged();
+    _finishOperation();
+}
+
+void DirEntryTree::_finishOperation() const {
+    _pages.trim();
+}
+
+void DirEntryTree::flush() {
+    _storeHeaderIfChanged();
+    _pages.flush();
+}
+
+uint64_t DirEntryTree::_hashName(const string &name) const {
+    // FNV-1a, seeded with the salt of this directory and followed by the MurmurHash3 finalizer to spread the bits.
+    // This is not a cryptographic hash, but collisions only cost performance.
+    uint64_t hash = 14695981039346656037ULL ^ _header.hashSalt;
+    for (unsigned char c : name) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+uint64_t DirEntryTree::_hashKey(const Key &key) {
+    // Keys are random already
+    uint64_t hash;
+    std::memcpy(&hash, key.data(), sizeof(hash));
+    return hash;
+}
+
+void DirEntryTree::_checkFits(const DirEntry &entry) {
+    if (entry.serializedSize() + sizeof(uint64_t) > HashBTree::MAX_VALUE_SIZE) {
+        throw fspp::fuse::FuseErrnoException(ENAMETOOLONG);
+    }
+}
+
+Data DirEntryTree::_serializeEntry(const DirEntry &entry) {
+    _checkFits(entry);
+    Data serialized(entry.serializedSize() + sizeof(uint64_t));
+    entry.serialize(static_cast<uint8_t*>(serialized.data()));
+    uint64_t size = entry.size().value_or(UNKNOWN_SIZE);
+    std::memcpy(serialized.dataOffset(entry.serializedSize()), &size, sizeof(size));
+    return serialized;
+}
+
+DirEntry DirEntryTree::_deserializeEntry(const Data &data) {
+    vector<DirEntry> result;
+    const char *end = DirEntry::deserializeAndAddToVector(static_cast<const char*>(data.data()), &result);
+    size_t entrySize = end - static_cast<const char*>(data.data());
+    // Entries stored with format version 0 don't have a size
+    if (data.size() >= entrySize + sizeof(uint64_t)) {
+        uint64_t size;
+        std::memcpy(&size, end, sizeof(size));
+        if (size != UNKNOWN_SIZE) {
+            result[0].setSize(size);
+        }
+    }
+    return std::move(result[0]);
+}
+
+Data DirEntryTree::_keyTreeValue(const Key &key, uint64_t nameHash) {
+    Data value(Key::BINARY_LENGTH + sizeof(nameHash));
+    key.ToBinary(value.data());
+    std::memcpy(value.dataOffset(Key::BINARY_LENGTH), &nameHash, sizeof(nameHash));
+    return value;
+}
+
+optional<DirEntry> DirEntryTree::_findByName(const string &name) const {
+    if (_nameTree == none) {
+        auto found = std::find_if(_inlineEntries.begin(), _inlineEntries.end(), [&name] (const DirEntry &entry) {
+            return entry.name() == name;
+        });
+        if (found == _inlineEntries.end()) {
+            return none;
+        }
+        return *found;
+    }
+    // Different names can have the same hash, so check the names
+    for (const auto &value : (*_nameTree)->find(_hashName(name))) {
+        DirEntry entry = _deserializeEntry(value);
+        if (entry.name() == name) {
+            return entry;
+        }
+    }
+    return none;
+}
+
+optional<DirEntry> DirEntryTree::_findByKey(const Key &key) const {
+    if (_nameTree == none) {
+        auto found = std::find_if(_inlineEntries.begin(), _inlineEntries.end(), [&key] (const DirEntry &entry) {
+            return entry.key() == key;
+        });
+        if (found == _inlineEntries.end()) {
+            return none;
+        }
+        return *found;
+    }
+    for (const auto &value : (*_keyTree)->find(_hashKey(key))) {
+        if (Key::FromBinary(value.data()) != key) {
+            continue;
+        }
+        uint64_t nameHash;
+        std::memcpy(&nameHash, value.dataOffset(Key::BINARY_LENGTH), sizeof(nameHash));
+        for (const auto &entryValue : (*_nameTree)->find(nameHash)) {
+            DirEntry entry = _deserializeEntry(entryValue);
+            if (entry.key() == key) {
+                return entry;
+            }
+        }
+        ASSERT(false, "Key tree references an entry that doesn't exist");
+    }
+    return none;
+}
+
+DirEntry DirEntryTree::_getByKey(const Key &key) const {
+    auto found = _findByKey(key);
+    if (found == none) {
+        throw fspp::fuse::FuseErrnoException(ENOENT);
+    }
+    return std::move(*found);
+}
+
+void DirEntryTree::_insert(const DirEntry &entry) {
+    ++_header.numEntries;
+    if (_nameTree == none) {
+        _inlineEntries.push_back(entry);
+        _inlineEntriesChanged = true;
+        if (!_inlineEntriesFit()) {
+            _createTrees();
+        }
+        return;
+    }
+    _insertIntoTrees(entry);
+}
+
+void DirEntryTree::_insertIntoTrees(const DirEntry &entry) {
+    uint64_t nameHash = _hashName(entry.name());
+    (*_nameTree)->insert(nameHash, _serializeEntry(entry));
+    (*_keyTree)->insert(_hashKey(entry.key()), _keyTreeValue(entry.key(), nameHash));
+}
+
+void DirEntryTree::_erase(const DirEntry &entry) {
+    --_header.numEntries;
+    if (_nameTree == none) {
+        auto found = std::find_if(_inlineEntries.begin(), _inlineEntries.end(), [&entry] (const DirEntry &inlineEntry) {
+            return inlineEntry.name() == entry.name();
+        });
+        ASSERT(found != _inlineEntries.end(), "Entry not found");
+        _inlineEntries.erase(found);
+        _inlineEntriesChanged = true;
+        return;
+    }
+    uint64_t nameHash = _hashName(entry.name());
+    bool removed = (*_nameTree)->removeIf(nameHash, [&entry] (const Data &value) {
+        return _deserializeEntry(value).name() == entry.name();
+    });
+    ASSERT(removed, "Entry not found");
+    Data keyTreeValue = _keyTreeValue(entry.key(), nameHash);
+    removed = (*_keyTree)->removeIf(_hashKey(entry.key()), [&keyTreeValue] (const Data &value) {
+        return value == keyTreeValue;
+    });
+    ASSERT(removed, "Entry not found in key tree");
+}
+
+void DirEntryTree::_update(const DirEntry &entry) {
+    if (_nameTree == none) {
+        // The name didn't change, so the entry keeps its serialized size and still fits
+        auto found = std::find_if(_inlineEntries.begin(), _inlineEntries.end(), [&entry] (const DirEntry &inlineEntry) {
+            return inlineEntry.name() == entry.name();
+        });
+        ASSERT(found != _inlineEntries.end(), "Entry not found");
+        *found = entry;
+        _inlineEntriesChanged = true;
+        return;
+    }
+    bool replaced = (*_nameTree)->replaceIf(_hashName(entry.name()), [&entry] (const Data &value) {
+        return _deserializeEntry(value).name() == entry.name();
+    }, _serializeEntry(entry));
+    ASSERT(replaced, "Entry not found");
+}
+
+void DirEntryTree::add(const string &name, const Key &blobKey, fspp::Dir::EntryType entryType, mode_t mode,
+                       uid_t uid, gid_t gid, timespec lastAccessTime, timespec lastModificationTime, optional<uint64_t> size) {
+    if (_findByName(name) != none) {
+        throw fspp::fuse::FuseErrnoException(EEXIST);
+    }
+    DirEntry entry(entryType, name, blobKey, mode, uid, gid, lastAccessTime, lastModificationTime, cpputils::time::now());
+    entry.setSize(size);
+    _insert(entry);
+    _finishModification();
+}
+
+void DirEntryTree::addOrOverwrite(const string &name, const Key &blobKey, fspp::Dir::EntryType entryType, mode_t mode,
+                                  uid_t uid, gid_t gid, timespec lastAccessTime, timespec lastModificationTime,
+                                  optional<uint64_t> size, function<void (const blockstore::Key &key)> onOverwritten) {
+    DirEntry newEntry(entryType, name, blobKey, mode, uid, gid, lastAccessTime, lastModificationTime, cpputils::time::now());
+    newEntry.setSize(size);
+    _checkFits(newEntry); // Fail before removing the old entry
+    auto found = _findByName(name);
+    if (found != none) {
+        DirEntryList::checkAllowedOverwrite(found->type(), entryType);
+        onOverwritten(found->key());
+        _erase(*found);
+    }
+    _insert(newEntry);
+    _finishModification();
+}
+
+void DirEntryTree::rename(const Key &key, const string &name, function<void (const blockstore::Key &key)> onOverwritten) {
+    DirEntry entry = _getByKey(key);
+    DirEntry renamed = entry;
+    renamed.setName(name);
+    _checkFits(renamed); // Fail before removing an overwritten entry
+
+    auto foundSameName = _findByName(name);
+    if (foundSameName != none && foundSameName->key() != key) {
+        DirEntryList::checkAllowedOverwrite(foundSameName->type(), entry.type());
+        onOverwritten(foundSameName->key());
+        _erase(*foundSameName);
+    }
+
+    // The entry is stored at the hash of its name, so renaming moves it
+    _erase(entry);
+    _insert(renamed);
+    _finishModification();
+}
+
+optional<DirEntry> DirEntryTree::get(const string &name) const {
+    auto found = _findByName(name);
+    _finishOperation();
+    return found;
+}
+
+optional<DirEntry> DirEntryTree::get(const Key &key) const {
+    auto found = _getByKey(key);
+    _finishOperation();
+    return found;
+}
+
+void DirEntryTree::remove(const string &name) {
+    auto found = _findByName(name);
+    if (found == none) {
+        throw fspp::fuse::FuseErrnoException(ENOENT);
+    }
+    _erase(*found);
+    _finishModification();
+}
+
+void DirEntryTree::remove(const Key &key) {
+    for (auto found = _findByKey(key); found != none; found = _findByKey(key)) {
+        _erase(*found);
+    }
+    _finishModification();
+}
+
+uint64_t DirEntryTree::size() const {
+    return _header.numEntries;
+}
+
+void DirEntryTree::forEach(function<void (const DirEntry &entry)> callback) const {
+    if (_nameTree == none) {
+        for (const auto &entry : _inlineEntries) {
+            callback(entry);
+        }
+    } else {
+        (*_nameTree)->forEach([&callback] (uint64_t, const Data &value) {
+            callback(_deserializeEntry(value));
+        });
+    }
+    _finishOperation();
+}
+
+void DirEntryTree::setMode(const Key &key, mode_t mode) {
+    DirEntry entry = _getByKey(key);
+    ASSERT ((S_ISREG(mode) && S_ISREG(entry.mode())) || (S_ISDIR(mode) && S_ISDIR(entry.mode())) || (S_ISLNK(mode)), "Unknown mode in entry");
+    entry.setMode(mode);
+    _update(entry);
+    _finishModification();
+}
+
+void DirEntryTree::setUidGid(const Key &key, uid_t uid, gid_t gid) {
+    DirEntry entry = _getByKey(key);
+    bool changed = false;
+    if (uid != (uid_t)-1) {
+        entry.setUid(uid);
+        changed = true;
+    }
+    if (gid != (gid_t)-1) {
+        entry.setGid(gid);
+        changed = true;
+    }
+    if (changed) {
+        _update(entry);
+    }
+    _finishModification();
+}
+
+void DirEntryTree::setAccessTimes(const Key &key, timespec lastAccessTime, timespec lastModificationTime) {
+    DirEntry entry = _getByKey(key);
+    entry.setLastAccessTime(lastAccessTime);
+    entry.setLastModificationTime(lastModificationTime);
+    _update(entry);
+    _finishModification();
+}
+
+void DirEntryTree::updateAccessTimestampForChild(const Key &key, AtimeUpdateBehavior atimeBehavior) {
+    DirEntry entry = _getByKey(key);
+    timespec now = cpputils::time::now();
+    if (!shouldUpdateAccessTimestamp(atimeBehavior, entry.lastAccessTime(), entry.lastModificationTime(), entry.lastMetadataChangeTime(), now)) {
+        // Leaves the directory unmodified, so it doesn't have to be written back
+        _finishOperation();
+        return;
+    }
+    entry.setLastAccessTime(now);
+    _update(entry);
+    _finishModification();
+}
+
+void DirEntryTree::updateModificationTimestampForChild(const Key &key) {
+    DirEntry entry = _getByKey(key);
+    entry.setLastModificationTime(cpputils::time::now());
+    _update(entry);
+    _finishModification();
+}
+
+void DirEntryTree::updateModificationTimestampAndSizeForChild(const Key &key, uint64_t size) {
+    DirEntry entry = _getByKey(key);
+    entry.setLastModificationTime(cpputils::time::now());
+    entry.setSize(size);
+    _update(entry);
+    _finishModification();
+}
+
+void DirEntryTree::setSize(const Key &key, uint64_t size) {
+    auto entry = _findByKey(key);
+    if (entry == none || entry->size() == size) {
+        _finishOperation();
+        return;
+    }
+    entry->setSize(size);
+    _update(*entry);
+    _finishModification();
+}
+
+void DirEntryTree::setSizeIfUnknown(const Key &key, uint64_t size) {
+    auto entry = _findByKey(key);
+    if (entry == none || entry->size() != none) {
+        _finishOperation();
+        return;
+    }
+    entry->setSize(size);
+    _update(*entry);
+    _finishModification();
+}
+
+void DirEntryTree::setDeferredTimestamps(const Key &key, optional<timespec> lastAccessTime, optional<timespec> lastModificationTime, AtimeUpdateBehavior atimeBehavior) {
+    auto entry = _findByKey(key);
+    if (entry == none) {
+        _finishOperation();
+        return;
+    }
+    bool changed = false;
+    if (lastModificationTime != none && *lastModificationTime != entry->lastModificationTime()) {
+        entry->setLastModificationTime(*lastModificationTime);
+        changed = true;
+    }
+    if (lastAccessTime != none && *lastAccessTime != entry->lastAccessTime() && shouldUpdateAccessTimestamp(atimeBehavior, entry->lastAccessTime(), entry->lastModificationTime(), entry->lastMetadataChangeTime(), *lastAccessTime)) {
+        entry->setLastAccessTime(*lastAccessTime);
+        changed = true;
+    }
+    if (!changed) {
+        _finishOperation();
+        return;
+    }
+    _update(*entry);
+    _finishModification();
+}
+
+}
+}
+}
@@ -0,0 +1,124 @@
+#pragma once
+#ifndef MESSMER_CRYFS_FILESYSTEM_FSBLOBSTORE_UTILS_DIRTREE_DIRENTRYTREE_H
+#define MESSMER_CRYFS_FILESYSTEM_FSBLOBSTORE_UTILS_DIRTREE_DIRENTRYTREE_H
+
+#include "PageStore.h"
+#include "HashBTree.h"
+#include "../DirEntry.h"
+#include "../TimestampUpdateBehavior.h"
+#include <boost/optional.hpp>
+#include <cpp-utils/pointer/unique_ref.h>
+#include <vector>
+
+namespace cryfs {
+    namespace fsblobstore {
+        namespace dirtree {
+
+            // Stores the entries of a directory in a blob, so that looking up, adding or removing an entry only
+            // touches O(log n) pages instead of loading the whole directory.
+            // Entries are stored in a B+ tree ordered by the hash of their name. A second tree maps blob keys
+            // to name hashes, so entries can also be found by the key of their blob.
+            // Small directories store their entries in the header page instead. The trees are only created once
+            // the entries don't fit there anymore, so most directories only take one page.
+            class DirEntryTree final {
+            public:
+                // Creates a directory with the given entries in the blob. The previous content of the blob is discarded.
+                static void Initialize(blobstore::Blob *blob, const std::vector<DirEntry> &entries);
+
+                // The blob has to contain a directory created with Initialize() and has to outlive the DirEntryTree.
+                explicit DirEntryTree(blobstore::Blob *blob);
+
+                // Version of the entry format. Version 0 didn't store the size of entries.
+                static constexpr uint32_t FORMAT_VERSION = 1;
+
+                void add(const std::string &name, const blockstore::Key &blobKey, fspp::Dir::EntryType entryType,
+                         mode_t mode, uid_t uid, gid_t gid, timespec lastAccessTime, timespec lastModificationTime,
+                         boost::optional<uint64_t> size);
+                void addOrOverwrite(const std::string &name, const blockstore::Key &blobKey, fspp::Dir::EntryType entryType,
+                         mode_t mode, uid_t uid, gid_t gid, timespec lastAccessTime, timespec lastModificationTime,
+                         boost::optional<uint64_t> size, std::function<void (const blockstore::Key &key)> onOverwritten);
+                void rename(const blockstore::Key &key, const std::string &name, std::function<void (const blockstore::Key &key)> onOverwritten);
+                boost::optional<DirEntry> get(const std::string &name) const;
+                boost::optional<DirEntry> get(const blockstore::Key &key) const;
+                void remove(const std::string &name);
+                void remove(const blockstore::Key &key);
+
+                uint64_t size() const;
+                // Calls the callback for all entries, in no particular order.
+                void forEach(std::function<void (const DirEntry &entry)> callback) const;
+
+                void setMode(const blockstore::Key &key, mode_t mode);
+                void setUidGid(const blockstore::Key &key, uid_t uid, gid_t gid);
+                void setAccessTimes(const blockstore::Key &key, timespec lastAccessTime, timespec lastModificationTime);
+                void updateAccessTimestampForChild(const blockstore::Key &key, AtimeUpdateBehavior atimeBehavior);
+                void updateModificationTimestampForChild(const blockstore::Key &key);
+                void updateModificationTimestampAndSizeForChild(const blockstore::Key &key, uint64_t size);
+                // Does nothing if there is no entry for this key (anymore)
+                void setSize(const blockstore::Key &key, uint64_t size);
+                // Does nothing if there is no entry for this key (anymore) or if its size is already known
+                void setSizeIfUnknown(const blockstore::Key &key, uint64_t size);
+                // Stores timestamps that were collected in memory. The access timestamp is only stored if
+                // atimeBehavior allows it. Does nothing if there is no entry for this key (anymore) or nothing changes.
+                void setDeferredTimestamps(const blockstore::Key &key, boost::optional<timespec> lastAccessTime,
+                         boost::optional<timespec> lastModificationTime, AtimeUpdateBehavior atimeBehavior);
+
+                void flush();
+
+            private:
+                struct Header final {
+                    // Both are 0 if the entries are stored in the header page
+                    uint32_t nameTreeRoot;
+                    uint32_t keyTreeRoot;
+                    uint64_t numEntries;
+                    // Random per directory, so names with colliding hashes can't be prepared up front
+                    uint64_t hashSalt;
+                    uint32_t formatVersion;
+                    uint32_t reserved;
+                };
+
+                static Header _loadHeader(PageStore *pages);
+                void _storeHeaderIfChanged();
+                std::vector<DirEntry> _loadInlineEntries();
+                void _serializeInlineEntries(cpputils::Data *headerPage) const;
+                bool _inlineEntriesFit() const;
+                // Moves the entries from the header page into newly created trees
+                void _createTrees();
+                // Called after each operation to keep the page cache from growing
+                void _finishOperation() const;
+                void _finishModification();
+
+                uint64_t _hashName(const std::string &name) const;
+                static uint64_t _hashKey(const blockstore::Key &key);
+                // Throws if the entry is too large (i.e. its name is too long) to be stored
+                static void _checkFits(const DirEntry &entry);
+                static cpputils::Data _serializeEntry(const DirEntry &entry);
+                static DirEntry _deserializeEntry(const cpputils::Data &data);
+                static cpputils::Data _keyTreeValue(const blockstore::Key &key, uint64_t nameHash);
+
+                boost::optional<DirEntry> _findByName(const std::string &name) const;
+                boost::optional<DirEntry> _findByKey(const blockstore::Key &key) const;
+                DirEntry _getByKey(const blockstore::Key &key) const;
+                void _insert(const DirEntry &entry);
+                void _insertIntoTrees(const DirEntry &entry);
+                void _erase(const DirEntry &entry);
+                // Stores the changed entry. Its name and key have to be unchanged.
+                void _update(const DirEntry &entry);
+
+                mutable PageStore _pages;
+                Header _header;
+                // Header as it is in the header page
+                Header _storedHeader;
+                // none as long as the entries are stored in the header page
+                boost::optional<cpputils::unique_ref<HashBTree>> _nameTree;
+                boost::optional<cpputils::unique_ref<HashBTree>> _keyTree;
+                std::vector<DirEntry> _inlineEntries;
+                bool _inlineEntriesChanged;
+
+                DISALLOW_COPY_AND_ASSIGN(DirEntryTree);
+            };
+
+        }
+    }
+}
+
+#endif
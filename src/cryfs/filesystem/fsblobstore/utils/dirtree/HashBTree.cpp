@@ -0,0 +1,320 @@
+#include "HashBTree.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <cpp-utils/assert/assert.h>
+
+using cpputils::Data;
+using std::vector;
+using std::function;
+
+namespace cryfs {
+namespace fsblobstore {
+namespace dirtree {
+
+constexpr uint32_t HashBTree::MAX_VALUE_SIZE;
+
+namespace {
+    constexpr uint8_t LEAF_NODE = 1;
+    constexpr uint8_t INNER_NODE = 2;
+    constexpr size_t NODE_HEADER_SIZE = sizeof(uint8_t) + sizeof(uint16_t);
+    constexpr size_t LEAF_ENTRY_HEADER_SIZE = sizeof(uint64_t) + sizeof(uint16_t);
+    constexpr size_t INNER_ENTRY_SIZE = sizeof(uint64_t) + sizeof(uint32_t);
+
+    template<typename T> void serialize(Data *dest, size_t *offset, T value) {
+        std::memcpy(dest->dataOffset(*offset), &value, sizeof(T));
+        *offset += sizeof(T);
+    }
+
+    template<typename T> T deserialize(const Data &source, size_t *offset) {
+        T value;
+        std::memcpy(&value, source.dataOffset(*offset), sizeof(T));
+        *offset += sizeof(T);
+        return value;
+    }
+}
+
+uint32_t HashBTree::CreateEmpty(PageStore *pages) {
+    uint32_t page = pages->allocate();
+    HashBTree tree(pages, page);
+    tree._storeNode(page, Node{true, {}, {}, {}});
+    return page;
+}
+
+HashBTree::HashBTree(PageStore *pages, uint32_t rootPage)
+    : _pages(pages), _rootPage(rootPage) {
+}
+
+uint32_t HashBTree::rootPage() const {
+    return _rootPage;
+}
+
+HashBTree::Node HashBTree::_loadNode(uint32_t page) const {
+    const Data &data = _pages->read(page);
+    size_t offset = 0;
+    uint8_t type = deserialize<uint8_t>(data, &offset);
+    uint16_t count = deserialize<uint16_t>(data, &offset);
+    Node node{type == LEAF_NODE, {}, {}, {}};
+    if (node.isLeaf) {
+        node.entries.reserve(count);
+        for (uint16_t i = 0; i < count; ++i) {
+            uint64_t hash = deserialize<uint64_t>(data, &offset);
+            uint16_t size = deserialize<uint16_t>(data, &offset);
+            Data value(size);
+            std::memcpy(value.data(), data.dataOffset(offset), size);
+            offset += size;
+            node.entries.push_back(LeafEntry{hash, std::move(value)});
+        }
+    } else {
+        ASSERT(type == INNER_NODE && count > 0, "Invalid node");
+        node.children.reserve(count);
+        node.separators.reserve(count - 1);
+        node.children.push_back(deserialize<uint32_t>(data, &offset));
+        for (uint16_t i = 1; i < count; ++i) {
+            node.separators.push_back(deserialize<uint64_t>(data, &offset));
+            node.children.push_back(deserialize<uint32_t>(data, &offset));
+        }
+    }
+    return node;
+}
+
+void HashBTree::_storeNode(uint32_t page, const Node &node) {
+    ASSERT(_fits(node), "Node doesn't fit into a page");
+    Data data(PageStore::PAGE_SIZE);
+    data.FillWithZeroes();
+    size_t offset = 0;
+    if (node.isLeaf) {
+        serialize<uint8_t>(&data, &offset, LEAF_NODE);
+        serialize<uint16_t>(&data, &offset, node.entries.size());
+        for (const auto &entry : node.entries) {
+            serialize<uint64_t>(&data, &offset, entry.hash);
+            serialize<uint16_t>(&data, &offset, entry.value.size());
+            std::memcpy(data.dataOffset(offset), entry.value.data(), entry.value.size());
+            offset += entry.value.size();
+        }
+    } else {
+        ASSERT(node.children.size() == node.separators.size() + 1, "Wrong number of separators");
+        serialize<uint8_t>(&data, &offset, INNER_NODE);
+        serialize<uint16_t>(&data, &offset, node.children.size());
+        serialize<uint32_t>(&data, &offset, node.children[0]);
+        for (size_t i = 1; i < node.children.size(); ++i) {
+            serialize<uint64_t>(&data, &offset, node.separators[i-1]);
+            serialize<uint32_t>(&data, &offset, node.children[i]);
+        }
+    }
+    _pages->write(page, std::move(data));
+}
+
+size_t HashBTree::_serializedSize(const Node &node) {
+    size_t size = NODE_HEADER_SIZE;
+    if (node.isLeaf) {
+        for (const auto &entry : node.entries) {
+            size += LEAF_ENTRY_HEADER_SIZE + entry.value.size();
+        }
+    } else {
+        size += sizeof(uint32_t) + node.separators.size() * INNER_ENTRY_SIZE;
+    }
+    return size;
+}
+
+bool HashBTree::_fits(const Node &node) {
+    return _serializedSize(node) <= PageStore::PAGE_SIZE;
+}
+
+uint32_t HashBTree::_findLeaf(uint64_t hash, vector<PathEntry> *path) const {
+    uint32_t page = _rootPage;
+    while (true) {
+        Node node = _loadNode(page);
+        if (node.isLeaf) {
+            return page;
+        }
+        size_t childIndex = std::upper_bound(node.separators.begin(), node.separators.end(), hash) - node.separators.begin();
+        if (path != nullptr) {
+            path->push_back(PathEntry{page, childIndex});
+        }
+        page = node.children[childIndex];
+    }
+}
+
+vector<Data> HashBTree::find(uint64_t hash) const {
+    Node leaf = _loadNode(_findLeaf(hash, nullptr));
+    vector<Data> result;
+    for (auto &entry : leaf.entries) {
+        if (entry.hash == hash) {
+            result.push_back(std::move(entry.value));
+        }
+    }
+    return result;
+}
+
+void HashBTree::insert(uint64_t hash, const Data &value) {
+    ASSERT(value.size() <= MAX_VALUE_SIZE, "Value too large");
+    _modifyLeaf(hash, [hash, &value] (vector<LeafEntry> *entries) {
+        auto pos = std::upper_bound(entries->begin(), entries->end(), hash, [] (uint64_t hash, const LeafEntry &entry) {
+            return hash < entry.hash;
+        });
+        entries->insert(pos, LeafEntry{hash, value.copy()});
+        return true;
+    });
+}
+
+bool HashBTree::replaceIf(uint64_t hash, function<bool (const Data &value)> pred, const Data &newValue) {
+    ASSERT(newValue.size() <= MAX_VALUE_SIZE, "Value too large");
+    return _modifyLeaf(hash, [hash, &pred, &newValue] (vector<LeafEntry> *entries) {
+        for (auto &entry : *entries) {
+            if (entry.hash == hash && pred(entry.value)) {
+                entry.value = newValue.copy();
+                return true;
+            }
+        }
+        return false;
+    });
+}
+
+bool HashBTree::removeIf(uint64_t hash, function<bool (const Data &value)> pred) {
+    return _modifyLeaf(hash, [hash, &pred] (vector<LeafEntry> *entries) {
+        for (auto iter = entries->begin(); iter != entries->end(); ++iter) {
+            if (iter->hash == hash && pred(iter->value)) {
+                entries->erase(iter);
+                return true;
+            }
+        }
+        return false;
+    });
+}
+
+bool HashBTree::_modifyLeaf(uint64_t hash, function<bool (vector<LeafEntry> *entries)> modify) {
+    vector<PathEntry> path;
+    uint32_t page = _findLeaf(hash, &path);
+    Node leaf = _loadNode(page);
+    if (!modify(&leaf.entries)) {
+        return false;
+    }
+    _storeModifiedLeaf(page, std::move(leaf), std::move(path));
+    return true;
+}
+
+void HashBTree::_storeModifiedLeaf(uint32_t page, Node leaf, vector<PathEntry> path) {
+    if (leaf.entries.empty() && !path.empty()) {
+        _pages->free(page);
+        _removeNode(page, std::move(path));
+    } else if (_fits(leaf)) {
+        _storeNode(page, leaf);
+    } else {
+        _splitAndStore(page, std::move(leaf), std::move(path));
+    }
+}
+
+void HashBTree::_splitAndStore(uint32_t page, Node node, vector<PathEntry> path) {
+    Node right{node.isLeaf, {}, {}, {}};
+    uint64_t separator;
+    if (node.isLeaf) {
+        // Split where both halves are about the same size, but never between two values with the same hash
+        size_t totalSize = _serializedSize(node);
+        size_t leftSize = NODE_HEADER_SIZE;
+        size_t bestSplit = 0;
+        size_t bestDistance = std::numeric_limits<size_t>::max();
+        for (size_t i = 1; i < node.entries.size(); ++i) {
+            leftSize += LEAF_ENTRY_HEADER_SIZE + node.entries[i-1].value.size();
+            size_t rightSize = totalSize - leftSize + NODE_HEADER_SIZE;
+            if (node.entries[i-1].hash == node.entries[i].hash || leftSize > PageStore::PAGE_SIZE || rightSize > PageStore::PAGE_SIZE) {
+                continue;
+            }
+            size_t distance = (leftSize > rightSize) ? (leftSize - rightSize) : (rightSize - leftSize);
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                bestSplit = i;
+            }
+        }
+        if (bestSplit == 0) {
+            throw std::runtime_error("Too many directory entries with the same hash");
+        }
+        std::move(node.entries.begin() + bestSplit, node.entries.end(), std::back_inserter(right.entries));
+        node.entries.erase(node.entries.begin() + bestSplit, node.entries.end());
+        separator = right.entries.front().hash;
+    } else {
+        size_t middle = node.children.size() / 2;
+        separator = node.separators[middle - 1];
+        right.children.assign(node.children.begin() + middle, node.children.end());
+        right.separators.assign(node.separators.begin() + middle, node.separators.end());
+        node.children.erase(node.children.begin() + middle, node.children.end());
+        node.separators.erase(node.separators.begin() + middle - 1, node.separators.end());
+    }
+    uint32_t rightPage = _pages->allocate();
+    _storeNode(page, node);
+    _storeNode(rightPage, right);
+
+    if (path.empty()) {
+        // We split the root, the tree grows by one level
+        uint32_t newRoot = _pages->allocate();
+        _storeNode(newRoot, Node{false, {}, {page, rightPage}, {separator}});
+        _rootPage = newRoot;
+        return;
+    }
+    PathEntry parentEntry = path.back();
+    path.pop_back();
+    Node parent = _loadNode(parentEntry.page);
+    parent.children.insert(parent.children.begin() + parentEntry.childIndex + 1, rightPage);
+    parent.separators.insert(parent.separators.begin() + parentEntry.childIndex, separator);
+    if (_fits(parent)) {
+        _storeNode(parentEntry.page, parent);
+    } else {
+        _splitAndStore(parentEntry.page, std::move(parent), std::move(path));
+    }
+}
+
+void HashBTree::_removeNode(uint32_t page, vector<PathEntry> path) {
+    ASSERT(!path.empty(), "Can't remove the root node");
+    PathEntry parentEntry = path.back();
+    path.pop_back();
+    Node parent = _loadNode(parentEntry.page);
+    ASSERT(parent.children[parentEntry.childIndex] == page, "Wrong path");
+    parent.children.erase(parent.children.begin() + parentEntry.childIndex);
+    if (!parent.separators.empty()) {
+        // The keys of the removed child now belong to its left neighbour. If it was the leftmost child, its right neighbour takes over.
+        size_t separatorIndex = (parentEntry.childIndex == 0) ? 0 : parentEntry.childIndex - 1;
+        parent.separators.erase(parent.separators.begin() + separatorIndex);
+    }
+    if (parent.children.empty()) {
+        _pages->free(parentEntry.page);
+        _removeNode(parentEntry.page, std::move(path));
+        return;
+    }
+    _storeNode(parentEntry.page, parent);
+    if (path.empty()) {
+        _collapseRoot();
+    }
+}
+
+void HashBTree::_collapseRoot() {
+    while (true) {
+        Node root = _loadNode(_rootPage);
+        if (root.isLeaf || root.children.size() > 1) {
+            return;
+        }
+        _pages->free(_rootPage);
+        _rootPage = root.children[0];
+    }
+}
+
+void HashBTree::forEach(function<void (uint64_t hash, const Data &value)> callback) const {
+    _forEach(_rootPage, callback);
+}
+
+void HashBTree::_forEach(uint32_t page, function<void (uint64_t hash, const Data &value)> callback) const {
+    Node node = _loadNode(page);
+    if (node.isLeaf) {
+        for (const auto &entry : node.entries) {
+            callback(entry.hash, entry.value);
+        }
+    } else {
+        for (uint32_t child : node.children) {
+            _forEach(child, callback);
+        }
+    }
+}
+
+}
+}
+}
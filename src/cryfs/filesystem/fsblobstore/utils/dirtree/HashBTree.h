@@ -0,0 +1,79 @@
+#pragma once
+#ifndef MESSMER_CRYFS_FILESYSTEM_FSBLOBSTORE_UTILS_DIRTREE_HASHBTREE_H
+#define MESSMER_CRYFS_FILESYSTEM_FSBLOBSTORE_UTILS_DIRTREE_HASHBTREE_H
+
+#include "PageStore.h"
+#include <functional>
+#include <vector>
+
+namespace cryfs {
+    namespace fsblobstore {
+        namespace dirtree {
+
+            // B+ tree mapping 64bit hashes to values, stored in the pages of a PageStore.
+            // A hash can have multiple values. All values of a hash are kept in the same leaf, so lookups only
+            // touch one page per tree level. Leaves that become empty are removed, but nodes aren't merged.
+            class HashBTree final {
+            public:
+                // Values can't be larger than this, so that a leaf with two values always fits into a page
+                static constexpr uint32_t MAX_VALUE_SIZE = 1024;
+
+                // Creates an empty tree and returns its root page
+                static uint32_t CreateEmpty(PageStore *pages);
+
+                HashBTree(PageStore *pages, uint32_t rootPage);
+
+                // The root page changes when the tree grows or shrinks. Callers have to store it after modifying the tree.
+                uint32_t rootPage() const;
+
+                std::vector<cpputils::Data> find(uint64_t hash) const;
+                void insert(uint64_t hash, const cpputils::Data &value);
+                // Replaces the first value with the given hash for which the predicate is true. Returns false if there is none.
+                bool replaceIf(uint64_t hash, std::function<bool (const cpputils::Data &value)> pred, const cpputils::Data &newValue);
+                // Removes the first value with the given hash for which the predicate is true. Returns false if there is none.
+                bool removeIf(uint64_t hash, std::function<bool (const cpputils::Data &value)> pred);
+                // Calls the callback for all values, ordered by hash
+                void forEach(std::function<void (uint64_t hash, const cpputils::Data &value)> callback) const;
+
+            private:
+                struct LeafEntry final {
+                    uint64_t hash;
+                    cpputils::Data value;
+                };
+                struct Node final {
+                    bool isLeaf;
+                    // Only for leaves
+                    std::vector<LeafEntry> entries;
+                    // Only for inner nodes. separators[i] is the smallest hash that can be in children[i+1].
+                    std::vector<uint32_t> children;
+                    std::vector<uint64_t> separators;
+                };
+                struct PathEntry final {
+                    uint32_t page;
+                    size_t childIndex;
+                };
+
+                Node _loadNode(uint32_t page) const;
+                void _storeNode(uint32_t page, const Node &node);
+                static size_t _serializedSize(const Node &node);
+                static bool _fits(const Node &node);
+
+                uint32_t _findLeaf(uint64_t hash, std::vector<PathEntry> *path) const;
+                bool _modifyLeaf(uint64_t hash, std::function<bool (std::vector<LeafEntry> *entries)> modify);
+                void _storeModifiedLeaf(uint32_t page, Node leaf, std::vector<PathEntry> path);
+                void _splitAndStore(uint32_t page, Node node, std::vector<PathEntry> path);
+                void _removeNode(uint32_t page, std::vector<PathEntry> path);
+                void _collapseRoot();
+                void _forEach(uint32_t page, std::function<void (uint64_t hash, const cpputils::Data &value)> callback) const;
+
+                PageStore *_pages;
+                uint32_t _rootPage;
+
+                DISALLOW_COPY_AND_ASSIGN(HashBTree);
+            };
+
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,137 @@
+#include "PageStore.h"
+#include <cpp-utils/assert/assert.h>
+#include <algorithm>
+#include <cstring>
+
+using blobstore::Blob;
+using cpputils::Data;
+
+namespace cryfs {
+namespace fsblobstore {
+namespace dirtree {
+
+constexpr uint32_t PageStore::PAGE_SIZE;
+constexpr uint32_t PageStore::HEADER_SIZE;
+
+namespace {
+    // The old directory format starts with the entry type (0, 1 or 2), so this can't be confused with it.
+    constexpr char MAGIC[8] = {'c', 'r', 'y', 'f', 's', 'd', 'i', 'r'};
+    constexpr uint64_t FREE_LIST_HEAD_OFFSET = sizeof(MAGIC);
+    // Writing back the cached pages when there are more than this, so the cache takes at most 1MB
+    constexpr size_t MAX_CACHED_PAGES = 256;
+}
+
+bool PageStore::IsPageStore(const Blob &blob) {
+    if (blob.size() < PAGE_SIZE) {
+        return false;
+    }
+    char magic[sizeof(MAGIC)];
+    blob.read(magic, 0, sizeof(MAGIC));
+    return 0 == std::memcmp(magic, MAGIC, sizeof(MAGIC));
+}
+
+void PageStore::Initialize(Blob *blob) {
+    Data header(PAGE_SIZE);
+    header.FillWithZeroes();
+    std::memcpy(header.data(), MAGIC, sizeof(MAGIC));
+    blob->resize(PAGE_SIZE);
+    blob->write(header.data(), 0, PAGE_SIZE);
+}
+
+PageStore::PageStore(Blob *blob)
+    : _blob(blob), _numPages(blob->size() / PAGE_SIZE), _freeListHead(0), _headerChanged(false), _cache() {
+    ASSERT(IsPageStore(*blob), "Blob doesn't contain a page store");
+    ASSERT(blob->size() % PAGE_SIZE == 0, "Blob size isn't a multiple of the page size");
+    _blob->read(&_freeListHead, FREE_LIST_HEAD_OFFSET, sizeof(_freeListHead));
+}
+
+PageStore::~PageStore() {
+    flush();
+}
+
+PageStore::CachedPage &PageStore::_load(uint32_t page) {
+    ASSERT(page < _numPages, "Page out of range");
+    auto found = _cache.find(page);
+    if (found != _cache.end()) {
+        return found->second;
+    }
+    Data data(PAGE_SIZE);
+    _blob->read(data.data(), static_cast<uint64_t>(page) * PAGE_SIZE, PAGE_SIZE);
+    return _cache.emplace(page, CachedPage{std::move(data), false}).first->second;
+}
+
+const Data &PageStore::read(uint32_t page) {
+    return _load(page).data;
+}
+
+void PageStore::write(uint32_t page, Data data) {
+    ASSERT(data.size() == PAGE_SIZE, "Wrong page size");
+    CachedPage &cached = _load(page);
+    cached.data = std::move(data);
+    cached.dirty = true;
+}
+
+uint32_t PageStore::allocate() {
+    _headerChanged = true;
+    if (_freeListHead != 0) {
+        uint32_t page = _freeListHead;
+        std::memcpy(&_freeListHead, read(page).data(), sizeof(_freeListHead));
+        return page;
+    }
+    uint32_t page = _numPages++;
+    Data data(PAGE_SIZE);
+    data.FillWithZeroes();
+    _cache.emplace(page, CachedPage{std::move(data), true});
+    return page;
+}
+
+void PageStore::free(uint32_t page) {
+    ASSERT(page != 0, "Can't free the header page");
+    Data data(PAGE_SIZE);
+    data.FillWithZeroes();
+    std::memcpy(data.data(), &_freeListHead, sizeof(_freeListHead));
+    write(page, std::move(data));
+    _freeListHead = page;
+    _headerChanged = true;
+}
+
+void PageStore::_writeHeader() {
+    CachedPage &header = _load(0);
+    std::memcpy(header.data.dataOffset(FREE_LIST_HEAD_OFFSET), &_freeListHead, sizeof(_freeListHead));
+    header.dirty = true;
+    _headerChanged = false;
+}
+
+void PageStore::flush() {
+    if (_headerChanged) {
+        _writeHeader();
+    }
+    bool anyDirty = std::any_of(_cache.begin(), _cache.end(), [] (const std::pair<const uint32_t, CachedPage> &cached) {
+        return cached.second.dirty;
+    });
+    if (!anyDirty) {
+        // Don't touch the blob, it might already be released by the owner if there weren't any changes
+        return;
+    }
+    uint64_t size = static_cast<uint64_t>(_numPages) * PAGE_SIZE;
+    if (_blob->size() < size) {
+        _blob->resize(size);
+    }
+    for (auto &cached : _cache) {
+        if (cached.second.dirty) {
+            _blob->write(cached.second.data.data(), static_cast<uint64_t>(cached.first) * PAGE_SIZE, PAGE_SIZE);
+            cached.second.dirty = false;
+        }
+    }
+}
+
+void PageStore::trim() {
+    if (_cache.size() > MAX_CACHED_PAGES) {
+        flush();
+        _cache.clear();
+    }
+}
+
+}
+}
+}
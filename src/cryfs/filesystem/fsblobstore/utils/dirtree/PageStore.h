@@ -0,0 +1,65 @@
+#pragma once
+#ifndef MESSMER_CRYFS_FILESYSTEM_FSBLOBSTORE_UTILS_DIRTREE_PAGESTORE_H
+#define MESSMER_CRYFS_FILESYSTEM_FSBLOBSTORE_UTILS_DIRTREE_PAGESTORE_H
+
+#include <blobstore/interface/Blob.h>
+#include <cpp-utils/data/Data.h>
+#include <cpp-utils/macros.h>
+#include <unordered_map>
+
+namespace cryfs {
+    namespace fsblobstore {
+        namespace dirtree {
+
+            // Divides a blob into fixed size pages. Page 0 starts with the page store header (format marker and free list),
+            // the rest of page 0 can be used by the user of the page store.
+            // Pages are cached in memory and only written back to the blob on flush().
+            class PageStore final {
+            public:
+                static constexpr uint32_t PAGE_SIZE = 4096;
+                static constexpr uint32_t HEADER_SIZE = 16;
+
+                // Returns true if the blob contains a page store (as opposed to e.g. being empty)
+                static bool IsPageStore(const blobstore::Blob &blob);
+                // Creates a new page store in the blob. The previous content of the blob is discarded.
+                static void Initialize(blobstore::Blob *blob);
+
+                // The blob has to contain a page store and has to outlive the PageStore
+                explicit PageStore(blobstore::Blob *blob);
+                ~PageStore();
+
+                // The returned reference is valid until the next call to write(), free(), flush() or trim()
+                const cpputils::Data &read(uint32_t page);
+                void write(uint32_t page, cpputils::Data data);
+
+                uint32_t allocate();
+                void free(uint32_t page);
+
+                void flush();
+                // Flushes and forgets cached pages if too many are cached. Call this between operations, it invalidates references returned by read().
+                void trim();
+
+            private:
+                struct CachedPage final {
+                    cpputils::Data data;
+                    bool dirty;
+                };
+
+                CachedPage &_load(uint32_t page);
+                void _writeHeader();
+
+                blobstore::Blob *_blob;
+                uint32_t _numPages;
+                // Index of the first free page. Free pages store the index of the next free page. 0 means there is none.
+                uint32_t _freeListHead;
+                bool _headerChanged;
+                std::unordered_map<uint32_t, CachedPage> _cache;
+
+                DISALLOW_COPY_AND_ASSIGN(PageStore);
+            };
+
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,119 @@
+#include "LazyTimestamps.h"
+#include <algorithm>
+#include <cpp-utils/logging/logging.h>
+
+using blockstore::Key;
+using boost::optional;
+using boost::none;
+using std::unique_lock;
+using std::mutex;
+using std::chrono::steady_clock;
+using std::function;
+using blockstore::caching::PeriodicTask;
+using cryfs::fsblobstore::AtimeUpdateBehavior;
+using namespace cpputils::logging;
+
+namespace cryfs {
+    namespace lazytime {
+
+        namespace {
+            // Expired updates are written back at most half of maxDelay late. The lower bound keeps the task from spinning.
+            double writeBackIntervalSec(steady_clock::duration maxDelay) {
+                return std::max(0.01, std::chrono::duration<double>(maxDelay).count() / 2);
+            }
+        }
+
+        LazyTimestamps::LazyTimestamps(steady_clock::duration maxDelay)
+            : _maxDelay(maxDelay), _mutex(), _entries(), _writeBacksMutex(), _writeBacks(), _nextWriteBackId(0),
+              _writeBackTask(std::make_unique<PeriodicTask>(std::bind(&LazyTimestamps::_writeBackExpired, this), writeBackIntervalSec(maxDelay))) {
+        }
+
+        void LazyTimestamps::accessed(const Key &key, timespec time) {
+            unique_lock<mutex> lock(_mutex);
+            _getOrCreate(key).updates.lastAccessTime = time;
+        }
+
+        void LazyTimestamps::modified(const Key &key, timespec time) {
+            unique_lock<mutex> lock(_mutex);
+            _getOrCreate(key).updates.lastModificationTime = time;
+        }
+
+        LazyTimestamps::Entry &LazyTimestamps::_getOrCreate(const Key &key) {
+            auto found = _entries.find(key);
+            if (found != _entries.end()) {
+                return found->second;
+            }
+            return _entries.emplace(key, Entry{Updates{none, none}, steady_clock::now()}).first->second;
+        }
+
+        bool LazyTimestamps::expired(const Key &key) const {
+            unique_lock<mutex> lock(_mutex);
+            auto found = _entries.find(key);
+            if (found == _entries.end()) {
+                return false;
+            }
+            return steady_clock::now() - found->second.firstUpdate >= _maxDelay;
+        }
+
+        optional<LazyTimestamps::Updates> LazyTimestamps::take(const Key &key) {
+            unique_lock<mutex> lock(_mutex);
+            auto found = _entries.find(key);
+            if (found == _entries.end()) {
+                return none;
+            }
+            Updates result = found->second.updates;
+            _entries.erase(found);
+            return result;
+        }
+
+        void LazyTimestamps::discard(const Key &key) {
+            unique_lock<mutex> lock(_mutex);
+            _entries.erase(key);
+        }
+
+        void LazyTimestamps::applyTo(const Key &key, AtimeUpdateBehavior atimeBehavior, struct ::stat *result) const {
+            unique_lock<mutex> lock(_mutex);
+            auto found = _entries.find(key);
+            if (found == _entries.end()) {
+                return;
+            }
+            const Updates &updates = found->second.updates;
+            if (updates.lastModificationTime != none) {
+                result->st_mtim = *updates.lastModificationTime;
+                // Storing the modification timestamp also updates the metadata change timestamp
+                result->st_ctim = std::max(result->st_ctim, *updates.lastModificationTime);
+            }
+            // Same decision as when the update is written back
+            if (updates.lastAccessTime != none && fsblobstore::shouldUpdateAccessTimestamp(atimeBehavior, result->st_atim, result->st_mtim, result->st_ctim, *updates.lastAccessTime)) {
+                result->st_atim = *updates.lastAccessTime;
+            }
+        }
+
+        uint64_t LazyTimestamps::addWriteBack(const Key &key, function<void ()> writeBack) {
+            unique_lock<mutex> lock(_writeBacksMutex);
+            uint64_t id = _nextWriteBackId++;
+            _writeBacks.emplace(id, WriteBack{key, std::move(writeBack)});
+            return id;
+        }
+
+        void LazyTimestamps::removeWriteBack(uint64_t id) {
+            unique_lock<mutex> lock(_writeBacksMutex);
+            _writeBacks.erase(id);
+        }
+
+        void LazyTimestamps::_writeBackExpired() {
+            unique_lock<mutex> lock(_writeBacksMutex);
+            for (const auto &writeBack : _writeBacks) {
+                if (!expired(writeBack.second.key)) {
+                    continue;
+                }
+                try {
+                    writeBack.second.writeBack();
+                } catch (const std::exception &e) {
+                    LOG(ERROR, "Failed to write back timestamps of {}: {}", writeBack.second.key.ToString(), e.what());
+                }
+            }
+        }
+
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+#ifndef MESSMER_CRYFS_FILESYSTEM_LAZYTIME_LAZYTIMESTAMPS_H
+#define MESSMER_CRYFS_FILESYSTEM_LAZYTIME_LAZYTIMESTAMPS_H
+
+#include <blockstore/utils/Key.h>
+#include <boost/optional.hpp>
+#include <blockstore/implementations/caching/cache/PeriodicTask.h>
+#include <cpp-utils/macros.h>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <sys/stat.h>
+#include "../fsblobstore/utils/TimestampUpdateBehavior.h"
+
+namespace cryfs {
+    namespace lazytime {
+
+        // Collects timestamp updates of open files in memory (like the lazytime mount option in Linux).
+        // Writing them to the directory entry each time would modify the directory blob on every read and write.
+        // The size isn't collected here, because the file can't be read back correctly after a crash without it.
+        // The owner of the open file writes them back on flush/fsync and when it is closed. Updates that are
+        // older than maxDelay are written back by a background task, so a crash only loses recent ones.
+        // Until they're written back, stat() has to apply them to the values from the directory entry.
+        class LazyTimestamps final {
+        public:
+            struct Updates final {
+                boost::optional<timespec> lastAccessTime;
+                boost::optional<timespec> lastModificationTime;
+            };
+
+            explicit LazyTimestamps(std::chrono::steady_clock::duration maxDelay);
+
+            void accessed(const blockstore::Key &key, timespec time);
+            void modified(const blockstore::Key &key, timespec time);
+            // Returns true if the node has updates that are waiting for longer than maxDelay
+            bool expired(const blockstore::Key &key) const;
+            // Removes the updates of a node, so they can be written to its directory entry
+            boost::optional<Updates> take(const blockstore::Key &key);
+            void discard(const blockstore::Key &key);
+            // Overwrites the stat values read from the directory entry with the updates that weren't written yet
+            void applyTo(const blockstore::Key &key, fsblobstore::AtimeUpdateBehavior atimeBehavior, struct ::stat *result) const;
+
+            // Open files register how their updates are written back, so the background task can write back expired
+            // updates even if the file isn't read or written anymore. Returns an id for removeWriteBack().
+            uint64_t addWriteBack(const blockstore::Key &key, std::function<void ()> writeBack);
+            // After this returns, the background task doesn't call the write back anymore
+            void removeWriteBack(uint64_t id);
+
+        private:
+            struct Entry final {
+                Updates updates;
+                std::chrono::steady_clock::time_point firstUpdate;
+            };
+
+            struct WriteBack final {
+                blockstore::Key key;
+                std::function<void ()> writeBack;
+            };
+
+            Entry &_getOrCreate(const blockstore::Key &key);
+            void _writeBackExpired();
+
+            const std::chrono::steady_clock::duration _maxDelay;
+            mutable std::mutex _mutex;
+            std::unordered_map<blockstore::Key, Entry> _entries;
+
+            // Held while a write back runs, so removeWriteBack() waits for it
+            std::mutex _writeBacksMutex;
+            std::unordered_map<uint64_t, WriteBack> _writeBacks;
+            uint64_t _nextWriteBackId;
+
+            //This member has to be last, so the task is stopped before the other members are destructed.
+            std::unique_ptr<blockstore::caching::PeriodicTask> _writeBackTask;
+
+            DISALLOW_COPY_AND_ASSIGN(LazyTimestamps);
+        };
+
+    }
+}
+
+#endif
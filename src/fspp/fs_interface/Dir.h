@@ -4,6 +4,7 @@
 
 #include <cpp-utils/pointer/unique_ref.h>
 #include <string>
+#include <sys/types.h>
 #include <boost/filesystem/path.hpp>
 
 namespace fspp {
@@ -21,9 +22,11 @@ public:
   };
 
   struct Entry {
-    Entry(EntryType type_, const std::string &name_): type(type_), name(name_) {}
+    Entry(EntryType type_, const std::string &name_, ino_t inode_ = 0): type(type_), name(name_), inode(inode_) {}
     EntryType type;
     std::string name;
+    // Same inode number as stat() returns for the entry, or 0 if the file system doesn't know it
+    ino_t inode;
   };
 
   virtual cpputils::unique_ref<OpenFile> createAndOpenFile(const std::string &name, mode_t mode, uid_t uid, gid_t gid) = 0;
@@ -33,6 +36,9 @@ public:
   //TODO Allow alternative implementation returning only children names without more information
   //virtual std::unique_ptr<std::vector<std::string>> children() const = 0;
   virtual cpputils::unique_ref<std::vector<Entry>> children() = 0;
+
+  // Stores the entries of the directory, so that they are kept if the system crashes
+  virtual void fsync() = 0;
 };
 
 }
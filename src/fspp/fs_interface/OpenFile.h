@@ -4,6 +4,7 @@
 
 #include <boost/filesystem.hpp>
 #include <sys/stat.h>
+#include <functional>
 
 namespace fspp {
 class Device;
@@ -16,9 +17,16 @@ public:
   virtual void truncate(off_t size) const = 0;
   virtual size_t read(void *buf, size_t count, off_t offset) const = 0;
   virtual void write(const void *buf, size_t count, off_t offset) = 0;
+  // Like write(), but fill() is called to put the data directly where the file stores it. It is called once
+  // for each consecutive piece of the region, in order, and has to write all `size` bytes to `target`.
+  virtual void writeInPlace(size_t count, off_t offset, const std::function<void (void *target, size_t size)> &fill) = 0;
   virtual void flush() = 0;
   virtual void fsync() = 0;
   virtual void fdatasync() = 0;
+  // Like lseek() with SEEK_DATA and SEEK_HOLE: Return the first offset at or after the given offset that is data
+  // (or that is in a hole). The end of the file counts as a hole. Throw ENXIO if there is none.
+  virtual off_t seekData(off_t offset) const = 0;
+  virtual off_t seekHole(off_t offset) const = 0;
 };
 
 }
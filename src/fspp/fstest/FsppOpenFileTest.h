@@ -3,6 +3,8 @@
 #define MESSMER_FSPP_FSTEST_FSPPOPENFILETEST_H_
 
 #include "testutils/FileTest.h"
+#include <fspp/fuse/FuseErrnoException.h>
+#include <cpp-utils/data/DataFixture.h>
 
 template<class ConcreteFileSystemTestFixture>
 class FsppOpenFileTest: public FileSystemTest<ConcreteFileSystemTestFixture> {
@@ -28,6 +30,23 @@ public:
         //and check that it only read the expected size (but also not less)
         EXPECT_EQ(expectedSize, (uint64_t)readBytes);
     }
+
+    // Writes data with writeInPlace() and checks that the pieces it asks for are consecutive and cover everything
+    void WRITE_IN_PLACE(fspp::OpenFile *openFile, const cpputils::Data &data, off_t offset) {
+        size_t alreadyWritten = 0;
+        openFile->writeInPlace(data.size(), offset, [&data, &alreadyWritten] (void *target, size_t size) {
+            ASSERT_LE(alreadyWritten + size, data.size());
+            std::memcpy(target, data.dataOffset(alreadyWritten), size);
+            alreadyWritten += size;
+        });
+        EXPECT_EQ(data.size(), alreadyWritten);
+    }
+
+    void EXPECT_READS_AS(const cpputils::Data &expected, fspp::OpenFile *openFile, off_t offset) {
+        cpputils::Data read(expected.size());
+        EXPECT_EQ(expected.size(), openFile->read(read.data(), read.size(), offset));
+        EXPECT_EQ(expected, read);
+    }
 };
 
 TYPED_TEST_CASE_P(FsppOpenFileTest);
@@ -46,9 +65,52 @@ TYPED_TEST_P(FsppOpenFileTest, FileIsFile) {
     });
 }
 
+TYPED_TEST_P(FsppOpenFileTest, SeekDataAndHoleInFileWithoutHoles) {
+    auto file = this->CreateFile("/myfile");
+    auto openFile = this->LoadFile("/myfile")->open(O_RDWR);
+    cpputils::Data data(10);
+    openFile->write(data.data(), data.size(), 0);
+    EXPECT_EQ(3, openFile->seekData(3));
+    EXPECT_EQ(10, openFile->seekHole(3));
+}
+
+TYPED_TEST_P(FsppOpenFileTest, SeekDataAndHoleAtEndOfFile) {
+    auto file = this->CreateFile("/myfile");
+    auto openFile = this->LoadFile("/myfile")->open(O_RDWR);
+    cpputils::Data data(10);
+    openFile->write(data.data(), data.size(), 0);
+    EXPECT_THROW(openFile->seekData(10), fspp::fuse::FuseErrnoException);
+    EXPECT_THROW(openFile->seekHole(10), fspp::fuse::FuseErrnoException);
+}
+
+TYPED_TEST_P(FsppOpenFileTest, WriteInPlace) {
+    auto file = this->CreateFile("/myfile");
+    auto openFile = this->LoadFile("/myfile")->open(O_RDWR);
+    cpputils::Data data = cpputils::DataFixture::generate(100*1024);
+    this->WRITE_IN_PLACE(openFile.get(), data, 0);
+    this->EXPECT_SIZE(data.size(), openFile.get());
+    this->EXPECT_READS_AS(data, openFile.get(), 0);
+}
+
+TYPED_TEST_P(FsppOpenFileTest, WriteInPlaceBehindHole) {
+    auto file = this->CreateFile("/myfile");
+    auto openFile = this->LoadFile("/myfile")->open(O_RDWR);
+    cpputils::Data data = cpputils::DataFixture::generate(100*1024);
+    this->WRITE_IN_PLACE(openFile.get(), data, 0);
+    openFile->truncate(200*1024);
+    // The region starts in existing leaves and continues into the hole the truncate created
+    this->WRITE_IN_PLACE(openFile.get(), data, 50*1024);
+    this->EXPECT_SIZE(200*1024, openFile.get());
+    this->EXPECT_READS_AS(data, openFile.get(), 50*1024);
+}
+
 REGISTER_TYPED_TEST_CASE_P(FsppOpenFileTest,
     CreatedFileIsEmpty,
-    FileIsFile
+    FileIsFile,
+    SeekDataAndHoleInFileWithoutHoles,
+    SeekDataAndHoleAtEndOfFile,
+    WriteInPlace,
+    WriteInPlaceBehindHole
 );
 
 //TODO Test stat
@@ -0,0 +1,27 @@
+#include "BufferVector.h"
+#include "FuseErrnoException.h"
+
+namespace fspp {
+namespace fuse {
+
+void copyFromBufferVector(fuse_bufvec *source, void *target, size_t size) {
+  fuse_bufvec destination;
+  destination.count = 1;
+  destination.idx = 0;
+  destination.off = 0;
+  destination.buf[0].size = size;
+  destination.buf[0].flags = static_cast<fuse_buf_flags>(0);
+  destination.buf[0].mem = target;
+  destination.buf[0].fd = -1;
+  destination.buf[0].pos = 0;
+  ssize_t copied = fuse_buf_copy(&destination, source, static_cast<fuse_buf_copy_flags>(0));
+  if (copied < 0) {
+    throw FuseErrnoException(-copied);
+  }
+  if (static_cast<size_t>(copied) != size) {
+    throw FuseErrnoException(EIO);
+  }
+}
+
+}
+}
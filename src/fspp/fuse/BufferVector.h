@@ -0,0 +1,18 @@
+#pragma once
+#ifndef MESSMER_FSPP_FUSE_BUFFERVECTOR_H_
+#define MESSMER_FSPP_FUSE_BUFFERVECTOR_H_
+
+#include "params.h"
+
+namespace fspp {
+namespace fuse {
+
+// Copies the next `size` bytes of `source` to `target` and advances `source` behind them.
+// If the kernel spliced the data into a pipe, `source` refers to the pipe and the data is read from it directly into `target`.
+// Throws FuseErrnoException if `source` doesn't have enough data.
+void copyFromBufferVector(fuse_bufvec *source, void *target, size_t size);
+
+}
+}
+
+#endif
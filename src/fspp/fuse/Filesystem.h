@@ -6,6 +6,7 @@
 #include <cpp-utils/pointer/unique_ref.h>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
+#include <functional>
 #include "../fs_interface/Dir.h"
 
 namespace fspp {
@@ -29,8 +30,11 @@ public:
   virtual void ftruncate(int descriptor, off_t size) = 0;
   virtual size_t read(int descriptor, void *buf, size_t count, off_t offset) = 0;
   virtual void write(int descriptor, const void *buf, size_t count, off_t offset) = 0;
+  // See OpenFile::writeInPlace()
+  virtual void writeInPlace(int descriptor, size_t count, off_t offset, const std::function<void (void *target, size_t size)> &fill) = 0;
   virtual void fsync(int descriptor) = 0;
   virtual void fdatasync(int descriptor) = 0;
+  virtual off_t lseek(int descriptor, off_t offset, int whence) = 0;
   virtual void access(const boost::filesystem::path &path, int mask) = 0;
   //TODO Test uid/gid parameters of mkdir
   virtual void mkdir(const boost::filesystem::path &path, mode_t mode, uid_t uid, gid_t gid) = 0;
@@ -41,6 +45,7 @@ public:
   virtual void statfs(const boost::filesystem::path &path, struct statvfs *fsstat) = 0;
   //TODO We shouldn't use Dir::Entry here, that's in another layer
   virtual cpputils::unique_ref<std::vector<Dir::Entry>> readDir(const boost::filesystem::path &path) = 0;
+  virtual void fsyncDir(const boost::filesystem::path &path) = 0;
   //TODO Test createSymlink
   virtual void createSymlink(const boost::filesystem::path &to, const boost::filesystem::path &from, uid_t uid, gid_t gid) = 0;
   //TODO Test readSymlink
@@ -4,6 +4,8 @@
 
 #include "FuseErrnoException.h"
 #include "Filesystem.h"
+#include "BufferVector.h"
+#include "SessionLoop.h"
 #include <iostream>
 #include <cpp-utils/assert/assert.h>
 #include <cpp-utils/logging/logging.h>
@@ -153,11 +155,14 @@ int fusepp_create(const char *path, mode_t mode, fuse_file_info *fileinfo) {
   return FUSE_OBJ->create(bf::path(path), mode, fileinfo);
 }
 
+int fusepp_write_buf(const char *path, fuse_bufvec *buf, off_t offset, fuse_file_info *fileinfo) {
+  return FUSE_OBJ->write_buf(bf::path(path), buf, offset, fileinfo);
+}
+
 /*int fusepp_lock(const char*, fuse_file_info*, int cmd, flock*)
 int fusepp_bmap(const char*, size_t blocksize, uint64_t *idx)
 int fusepp_ioctl(const char*, int cmd, void *arg, fuse_file_info*, unsigned int flags, void *data)
 int fusepp_poll(const char*, fuse_file_info*, fuse_pollhandle *ph, unsigned *reventsp)
-int fusepp_write_buf(const char*, fuse_bufvec *buf, off_t off, fuse_file_info*)
 int fusepp_read_buf(const chas*, struct fuse_bufvec **bufp, size_t size, off_T off, fuse_file_info*)
 int fusepp_flock(const char*, fuse_file_info*, int op)
 int fusepp_fallocate(const char*, int, off_t, off_t, fuse_file_info*)*/
@@ -184,6 +189,7 @@ fuse_operations *operations() {
     singleton->open = &fusepp_open;
     singleton->read = &fusepp_read;
     singleton->write = &fusepp_write;
+    singleton->write_buf = &fusepp_write_buf;
     singleton->statfs = &fusepp_statfs;
     singleton->flush = &fusepp_flush;
     singleton->release = &fusepp_release;
@@ -217,8 +223,8 @@ Fuse::~Fuse() {
   _argv.clear();
 }
 
-Fuse::Fuse(Filesystem *fs, const std::string &fstype, const boost::optional<std::string> &fsname)
-  :_fs(fs), _mountdir(), _running(false), _fstype(fstype), _fsname(fsname) {
+Fuse::Fuse(Filesystem *fs, const std::string &fstype, const boost::optional<std::string> &fsname, const boost::optional<uint32_t> &maxWriteBytes, const boost::optional<uint32_t> &numThreads)
+  :_fs(fs), _mountdir(), _running(false), _fstype(fstype), _fsname(fsname), _maxWriteBytes(maxWriteBytes), _numThreads(numThreads) {
 }
 
 void Fuse::_logException(const std::exception &e) {
@@ -236,12 +242,32 @@ void Fuse::run(const bf::path &mountdir, const vector<string> &fuseOptions) {
 
   _argv = _build_argv(mountdir, fuseOptions);
 
-  fuse_main(_argv.size(), _argv.data(), operations(), (void*)this);
+  if (_numThreads == boost::none) {
+    fuse_main(_argv.size(), _argv.data(), operations(), (void*)this);
+    return;
+  }
+
+  // Same as fuse_main(), but with our own multi-threaded session loop
+  char *mountpoint = nullptr;
+  int multithreaded = 0;
+  struct fuse *fuse = fuse_setup(_argv.size(), _argv.data(), operations(), sizeof(fuse_operations), &mountpoint, &multithreaded, (void*)this);
+  if (fuse == nullptr) {
+    return;
+  }
+  if (multithreaded) {
+    if (fuse_start_cleanup_thread(fuse) == 0) {
+      SessionLoop(fuse_get_session(fuse), *_numThreads).run();
+      fuse_stop_cleanup_thread(fuse);
+    }
+  } else {
+    fuse_loop(fuse);
+  }
+  fuse_teardown(fuse, mountpoint);
 }
 
 vector<char *> Fuse::_build_argv(const bf::path &mountdir, const vector<string> &fuseOptions) {
   vector<char *> argv;
-  argv.reserve(6 + fuseOptions.size()); // fuseOptions + executable name + mountdir + 2x fuse options (subtype, fsname), each taking 2 entries ("-o", "key=value").
+  argv.reserve(10 + fuseOptions.size()); // fuseOptions + executable name + mountdir + 4x fuse options (subtype, fsname, big_writes, max_write), each taking 2 entries ("-o", "key=value").
   argv.push_back(_create_c_string(_fstype)); // The first argument (executable name) is the file system type
   argv.push_back(_create_c_string(mountdir.native())); // The second argument is the mountdir
   for (const string &option : fuseOptions) {
@@ -249,6 +275,14 @@ vector<char *> Fuse::_build_argv(const bf::path &mountdir, const vector<string>
   }
   _add_fuse_option_if_not_exists(&argv, "subtype", _fstype);
   _add_fuse_option_if_not_exists(&argv, "fsname", _fsname.get_value_or(_fstype));
+#ifndef __APPLE__
+  // Without big_writes, the kernel splits writes into single pages
+  argv.push_back(_create_c_string("-o"));
+  argv.push_back(_create_c_string("big_writes"));
+  if (_maxWriteBytes != boost::none) {
+    _add_fuse_option_if_not_exists(&argv, "max_write", std::to_string(*_maxWriteBytes));
+  }
+#endif
   return argv;
 }
 
@@ -686,6 +720,32 @@ int Fuse::write(const bf::path &path, const char *buf, size_t size, off_t offset
   }
 }
 
+int Fuse::write_buf(const bf::path &path, fuse_bufvec *buf, off_t offset, fuse_file_info *fileinfo) {
+#ifdef FSPP_LOG
+  LOG(DEBUG, "write_buf({}, _, {}, _)", path, offset);
+#endif
+  UNUSED(path);
+  try {
+    // The data goes from the FUSE buffer (or the pipe the kernel spliced it into) directly into the leaf blocks
+    size_t size = fuse_buf_size(buf);
+    _fs->writeInPlace(fileinfo->fh, size, offset, [buf] (void *target, size_t count) {
+      copyFromBufferVector(buf, target, count);
+    });
+    return size;
+  } catch(const cpputils::AssertFailed &e) {
+    LOG(ERROR, "AssertFailed in Fuse::write_buf: {}", e.what());
+    return -EIO;
+  } catch (FuseErrnoException &e) {
+    return -e.getErrno();
+  } catch(const std::exception &e) {
+    _logException(e);
+    return -EIO;
+  } catch(...) {
+    _logUnknownException();
+    return -EIO;
+  }
+}
+
 //TODO
 int Fuse::statfs(const bf::path &path, struct statvfs *fsstat) {
 #ifdef FSPP_LOG
@@ -787,6 +847,7 @@ int Fuse::readdir(const bf::path &path, void *buf, fuse_fill_dir_t filler, off_t
       } else {
         ASSERT(false, "Unknown entry type");
       }
+      stbuf.st_ino = entry.inode;
       if (filler(buf, entry.name.c_str(), &stbuf, 0) != 0) {
         return -ENOMEM;
       }
@@ -816,15 +877,38 @@ int Fuse::releasedir(const bf::path &path, fuse_file_info *fileinfo) {
 
 //TODO
 int Fuse::fsyncdir(const bf::path &path, int datasync, fuse_file_info *fileinfo) {
+#ifdef FSPP_LOG
+  LOG(DEBUG, "fsyncdir({}, {}, _)", path, datasync);
+#endif
   UNUSED(fileinfo);
+  // The entries are the data of a directory, so datasync doesn't allow skipping anything
   UNUSED(datasync);
-  UNUSED(path);
-  //LOG(WARN, "Called non-implemented fsyncdir({}, {}, _)", path, datasync);
-  return 0;
+  try {
+    _fs->fsyncDir(path);
+    return 0;
+  } catch(const cpputils::AssertFailed &e) {
+    LOG(ERROR, "AssertFailed in Fuse::fsyncdir: {}", e.what());
+    return -EIO;
+  } catch (FuseErrnoException &e) {
+    return -e.getErrno();
+  } catch(const std::exception &e) {
+    _logException(e);
+    return -EIO;
+  } catch(...) {
+    _logUnknownException();
+    return -EIO;
+  }
 }
 
 void Fuse::init(fuse_conn_info *conn) {
+  // Let the kernel splice write data into a pipe, write_buf() then reads it from there directly into the leaf blocks
+#ifdef FUSE_CAP_SPLICE_READ
+  if (conn->capable & FUSE_CAP_SPLICE_READ) {
+    conn->want |= FUSE_CAP_SPLICE_READ;
+  }
+#else
   UNUSED(conn);
+#endif
   LOG(INFO, "Filesystem started.");
 
   _running = true;
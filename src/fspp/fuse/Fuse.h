@@ -19,7 +19,10 @@ class Filesystem;
 
 class Fuse final {
 public:
-  explicit Fuse(Filesystem *fs, const std::string &fstype, const boost::optional<std::string> &fsname);
+  // maxWriteBytes limits how much data the kernel sends with one write request.
+  // numThreads is the number of threads processing requests, unless the filesystem runs single-threaded ("-s").
+  // If it isn't given, libfuse starts threads on demand.
+  explicit Fuse(Filesystem *fs, const std::string &fstype, const boost::optional<std::string> &fsname, const boost::optional<uint32_t> &maxWriteBytes = boost::none, const boost::optional<uint32_t> &numThreads = boost::none);
   ~Fuse();
 
   void run(const boost::filesystem::path &mountdir, const std::vector<std::string> &fuseOptions);
@@ -45,6 +48,7 @@ public:
   int release(const boost::filesystem::path &path, fuse_file_info *fileinfo);
   int read(const boost::filesystem::path &path, char *buf, size_t size, off_t offset, fuse_file_info *fileinfo);
   int write(const boost::filesystem::path &path, const char *buf, size_t size, off_t offset, fuse_file_info *fileinfo);
+  int write_buf(const boost::filesystem::path &path, fuse_bufvec *buf, off_t offset, fuse_file_info *fileinfo);
   int statfs(const boost::filesystem::path &path, struct statvfs *fsstat);
   int flush(const boost::filesystem::path &path, fuse_file_info *fileinfo);
   int fsync(const boost::filesystem::path &path, int flags, fuse_file_info *fileinfo);
@@ -72,6 +76,8 @@ private:
   bool _running;
   std::string _fstype;
   boost::optional<std::string> _fsname;
+  boost::optional<uint32_t> _maxWriteBytes;
+  boost::optional<uint32_t> _numThreads;
 
   DISALLOW_COPY_AND_ASSIGN(Fuse);
 };
@@ -0,0 +1,640 @@
+#include "FuseLowLevel.h"
+#include "Filesystem.h"
+#include "FuseErrnoException.h"
+#include "BufferVector.h"
+#include "SessionLoop.h"
+#include <cpp-utils/assert/assert.h>
+#include <cpp-utils/logging/logging.h>
+#include <cpp-utils/system/clock_gettime.h>
+#include <boost/algorithm/string/predicate.hpp>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+using std::vector;
+using std::string;
+using boost::optional;
+using boost::none;
+
+namespace bf = boost::filesystem;
+using namespace cpputils::logging;
+using namespace fspp::fuse;
+
+#define FUSE_LL_OBJ(req) ((FuseLowLevel *) fuse_req_userdata(req))
+
+namespace {
+// Same value libfuse uses in the high-level API for directory entries whose inode number isn't known
+constexpr fuse_ino_t UNKNOWN_INODE = 0xffffffff;
+
+void fusepp_ll_init(void *userdata, fuse_conn_info *conn) {
+  ((FuseLowLevel *) userdata)->init(conn);
+}
+
+void fusepp_ll_destroy(void *userdata) {
+  ((FuseLowLevel *) userdata)->destroy();
+}
+
+void fusepp_ll_lookup(fuse_req_t req, fuse_ino_t parent, const char *name) {
+  FUSE_LL_OBJ(req)->lookup(req, parent, name);
+}
+
+void fusepp_ll_forget(fuse_req_t req, fuse_ino_t ino, unsigned long nlookup) {
+  FUSE_LL_OBJ(req)->forget(req, ino, nlookup);
+}
+
+void fusepp_ll_getattr(fuse_req_t req, fuse_ino_t ino, fuse_file_info *fileinfo) {
+  FUSE_LL_OBJ(req)->getattr(req, ino, fileinfo);
+}
+
+void fusepp_ll_setattr(fuse_req_t req, fuse_ino_t ino, struct stat *attr, int to_set, fuse_file_info *fileinfo) {
+  FUSE_LL_OBJ(req)->setattr(req, ino, attr, to_set, fileinfo);
+}
+
+void fusepp_ll_readlink(fuse_req_t req, fuse_ino_t ino) {
+  FUSE_LL_OBJ(req)->readlink(req, ino);
+}
+
+void fusepp_ll_mknod(fuse_req_t req, fuse_ino_t parent, const char *name, mode_t mode, dev_t rdev) {
+  FUSE_LL_OBJ(req)->mknod(req, parent, name, mode, rdev);
+}
+
+void fusepp_ll_mkdir(fuse_req_t req, fuse_ino_t parent, const char *name, mode_t mode) {
+  FUSE_LL_OBJ(req)->mkdir(req, parent, name, mode);
+}
+
+void fusepp_ll_unlink(fuse_req_t req, fuse_ino_t parent, const char *name) {
+  FUSE_LL_OBJ(req)->unlink(req, parent, name);
+}
+
+void fusepp_ll_rmdir(fuse_req_t req, fuse_ino_t parent, const char *name) {
+  FUSE_LL_OBJ(req)->rmdir(req, parent, name);
+}
+
+void fusepp_ll_symlink(fuse_req_t req, const char *link, fuse_ino_t parent, const char *name) {
+  FUSE_LL_OBJ(req)->symlink(req, link, parent, name);
+}
+
+void fusepp_ll_rename(fuse_req_t req, fuse_ino_t parent, const char *name, fuse_ino_t newparent, const char *newname) {
+  FUSE_LL_OBJ(req)->rename(req, parent, name, newparent, newname);
+}
+
+void fusepp_ll_link(fuse_req_t req, fuse_ino_t ino, fuse_ino_t newparent, const char *newname) {
+  FUSE_LL_OBJ(req)->link(req, ino, newparent, newname);
+}
+
+void fusepp_ll_open(fuse_req_t req, fuse_ino_t ino, fuse_file_info *fileinfo) {
+  FUSE_LL_OBJ(req)->open(req, ino, fileinfo);
+}
+
+void fusepp_ll_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, fuse_file_info *fileinfo) {
+  FUSE_LL_OBJ(req)->read(req, ino, size, offset, fileinfo);
+}
+
+void fusepp_ll_write(fuse_req_t req, fuse_ino_t ino, const char *buf, size_t size, off_t offset, fuse_file_info *fileinfo) {
+  FUSE_LL_OBJ(req)->write(req, ino, buf, size, offset, fileinfo);
+}
+
+void fusepp_ll_write_buf(fuse_req_t req, fuse_ino_t ino, fuse_bufvec *buf, off_t offset, fuse_file_info *fileinfo) {
+  FUSE_LL_OBJ(req)->write_buf(req, ino, buf, offset, fileinfo);
+}
+
+void fusepp_ll_flush(fuse_req_t req, fuse_ino_t ino, fuse_file_info *fileinfo) {
+  FUSE_LL_OBJ(req)->flush(req, ino, fileinfo);
+}
+
+void fusepp_ll_release(fuse_req_t req, fuse_ino_t ino, fuse_file_info *fileinfo) {
+  FUSE_LL_OBJ(req)->release(req, ino, fileinfo);
+}
+
+void fusepp_ll_fsync(fuse_req_t req, fuse_ino_t ino, int datasync, fuse_file_info *fileinfo) {
+  FUSE_LL_OBJ(req)->fsync(req, ino, datasync, fileinfo);
+}
+
+void fusepp_ll_opendir(fuse_req_t req, fuse_ino_t ino, fuse_file_info *fileinfo) {
+  FUSE_LL_OBJ(req)->opendir(req, ino, fileinfo);
+}
+
+void fusepp_ll_readdir(fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, fuse_file_info *fileinfo) {
+  FUSE_LL_OBJ(req)->readdir(req, ino, size, offset, fileinfo);
+}
+
+void fusepp_ll_releasedir(fuse_req_t req, fuse_ino_t ino, fuse_file_info *fileinfo) {
+  FUSE_LL_OBJ(req)->releasedir(req, ino, fileinfo);
+}
+
+void fusepp_ll_fsyncdir(fuse_req_t req, fuse_ino_t ino, int datasync, fuse_file_info *fileinfo) {
+  FUSE_LL_OBJ(req)->fsyncdir(req, ino, datasync, fileinfo);
+}
+
+void fusepp_ll_statfs(fuse_req_t req, fuse_ino_t ino) {
+  FUSE_LL_OBJ(req)->statfs(req, ino);
+}
+
+void fusepp_ll_access(fuse_req_t req, fuse_ino_t ino, int mask) {
+  FUSE_LL_OBJ(req)->access(req, ino, mask);
+}
+
+void fusepp_ll_create(fuse_req_t req, fuse_ino_t parent, const char *name, mode_t mode, fuse_file_info *fileinfo) {
+  FUSE_LL_OBJ(req)->create(req, parent, name, mode, fileinfo);
+}
+
+fuse_lowlevel_ops *operations() {
+  static std::unique_ptr<fuse_lowlevel_ops> singleton(nullptr);
+
+  if (!singleton) {
+    singleton = std::make_unique<fuse_lowlevel_ops>();
+    std::memset(singleton.get(), 0, sizeof(fuse_lowlevel_ops));
+    singleton->init = &fusepp_ll_init;
+    singleton->destroy = &fusepp_ll_destroy;
+    singleton->lookup = &fusepp_ll_lookup;
+    singleton->forget = &fusepp_ll_forget;
+    singleton->getattr = &fusepp_ll_getattr;
+    singleton->setattr = &fusepp_ll_setattr;
+    singleton->readlink = &fusepp_ll_readlink;
+    singleton->mknod = &fusepp_ll_mknod;
+    singleton->mkdir = &fusepp_ll_mkdir;
+    singleton->unlink = &fusepp_ll_unlink;
+    singleton->rmdir = &fusepp_ll_rmdir;
+    singleton->symlink = &fusepp_ll_symlink;
+    singleton->rename = &fusepp_ll_rename;
+    singleton->link = &fusepp_ll_link;
+    singleton->open = &fusepp_ll_open;
+    singleton->read = &fusepp_ll_read;
+    singleton->write = &fusepp_ll_write;
+    singleton->write_buf = &fusepp_ll_write_buf;
+    singleton->flush = &fusepp_ll_flush;
+    singleton->release = &fusepp_ll_release;
+    singleton->fsync = &fusepp_ll_fsync;
+    singleton->opendir = &fusepp_ll_opendir;
+    singleton->readdir = &fusepp_ll_readdir;
+    singleton->releasedir = &fusepp_ll_releasedir;
+    singleton->fsyncdir = &fusepp_ll_fsyncdir;
+    singleton->statfs = &fusepp_ll_statfs;
+    singleton->access = &fusepp_ll_access;
+    singleton->create = &fusepp_ll_create;
+  }
+
+  return singleton.get();
+}
+
+bool hasOption(const vector<string> &args, const string &key) {
+  // The fuse option can either be present as "-okey=value" or as "-o key=value", we have to check both.
+  return std::any_of(args.begin(), args.end(), [&key] (const string &arg) {
+    return boost::starts_with(arg, key + "=") || boost::starts_with(arg, "-o" + key + "=");
+  });
+}
+
+mode_t fileTypeBits(fspp::Dir::EntryType type) {
+  switch (type) {
+    case fspp::Dir::EntryType::DIR: return S_IFDIR;
+    case fspp::Dir::EntryType::FILE: return S_IFREG;
+    case fspp::Dir::EntryType::SYMLINK: return S_IFLNK;
+  }
+  ASSERT(false, "Unknown entry type");
+  return 0;
+}
+}
+
+FuseLowLevel::FuseLowLevel(Filesystem *fs, const string &fstype, const optional<string> &fsname, double entryTimeout, double attrTimeout, const optional<uint32_t> &maxWriteBytes, const optional<uint32_t> &numThreads)
+  :_fs(fs), _fstype(fstype), _fsname(fsname), _entryTimeout(entryTimeout), _attrTimeout(attrTimeout), _maxWriteBytes(maxWriteBytes), _numThreads(numThreads), _mountdir(), _running(false),
+   _inodes(), _openDirs() {
+}
+
+FuseLowLevel::~FuseLowLevel() {
+}
+
+void FuseLowLevel::run(const bf::path &mountdir, const vector<string> &fuseOptions) {
+  _mountdir = mountdir;
+
+  vector<string> args = _buildArgs(mountdir, fuseOptions);
+  vector<char*> argv;
+  argv.reserve(args.size());
+  for (string &arg : args) {
+    argv.push_back(const_cast<char*>(arg.c_str()));
+  }
+  fuse_args fuseArgs = FUSE_ARGS_INIT(static_cast<int>(argv.size()), argv.data());
+
+  char *mountpoint = nullptr;
+  int multithreaded = 0;
+  int foreground = 0;
+  if (fuse_parse_cmdline(&fuseArgs, &mountpoint, &multithreaded, &foreground) == -1) {
+    LOG(ERROR, "Could not parse fuse options");
+    fuse_opt_free_args(&fuseArgs);
+    return;
+  }
+  fuse_chan *channel = fuse_mount(mountpoint, &fuseArgs);
+  if (channel == nullptr) {
+    LOG(ERROR, "Could not mount filesystem");
+  } else {
+    fuse_session *session = fuse_lowlevel_new(&fuseArgs, operations(), sizeof(fuse_lowlevel_ops), this);
+    if (session == nullptr) {
+      LOG(ERROR, "Could not create fuse session");
+    } else {
+      if (fuse_set_signal_handlers(session) != -1) {
+        fuse_session_add_chan(session, channel);
+        if (fuse_daemonize(foreground) != -1) {
+          if (multithreaded && _numThreads != none) {
+            SessionLoop(session, *_numThreads).run();
+          } else if (multithreaded) {
+            fuse_session_loop_mt(session);
+          } else {
+            fuse_session_loop(session);
+          }
+        }
+        fuse_remove_signal_handlers(session);
+        fuse_session_remove_chan(channel);
+      }
+      fuse_session_destroy(session);
+    }
+    fuse_unmount(mountpoint, channel);
+  }
+  free(mountpoint);
+  fuse_opt_free_args(&fuseArgs);
+}
+
+vector<string> FuseLowLevel::_buildArgs(const bf::path &mountdir, const vector<string> &fuseOptions) const {
+  vector<string> args;
+  args.push_back(_fstype); // The first argument (executable name) is the file system type
+  args.push_back(mountdir.native()); // The second argument is the mountdir
+  args.insert(args.end(), fuseOptions.begin(), fuseOptions.end());
+  if (!hasOption(args, "subtype")) {
+    args.push_back("-o");
+    args.push_back("subtype=" + _fstype);
+  }
+  if (!hasOption(args, "fsname")) {
+    args.push_back("-o");
+    args.push_back("fsname=" + _fsname.get_value_or(_fstype));
+  }
+#ifndef __APPLE__
+  // Without big_writes, the kernel splits writes into single pages
+  args.push_back("-o");
+  args.push_back("big_writes");
+  if (_maxWriteBytes != none && !hasOption(args, "max_write")) {
+    args.push_back("-o");
+    args.push_back("max_write=" + std::to_string(*_maxWriteBytes));
+  }
+#endif
+  return args;
+}
+
+bool FuseLowLevel::running() const {
+  return _running;
+}
+
+void FuseLowLevel::stop() {
+  //TODO Find better way to unmount (i.e. don't use external fusermount). See Fuse::stop().
+#ifdef __APPLE__
+  int ret = system(("umount " + _mountdir.native()).c_str());
+#else
+  int ret = system(("fusermount -z -u " + _mountdir.native()).c_str()); // "-z" takes care that if the filesystem can't be unmounted right now because something is opened, it will be unmounted as soon as it can be.
+#endif
+  if (ret != 0) {
+    LOG(ERROR, "Could not unmount filesystem");
+  }
+}
+
+template<class Func>
+void FuseLowLevel::_handle(fuse_req_t req, const char *operation, Func &&func) {
+  try {
+    func();
+  } catch(const cpputils::AssertFailed &e) {
+    LOG(ERROR, "AssertFailed in FuseLowLevel::{}: {}", operation, e.what());
+    fuse_reply_err(req, EIO);
+  } catch(const FuseErrnoException &e) {
+    fuse_reply_err(req, e.getErrno());
+  } catch(const std::exception &e) {
+    LOG(ERROR, "Exception thrown in FuseLowLevel::{}: {}", operation, e.what());
+    fuse_reply_err(req, EIO);
+  } catch(...) {
+    LOG(ERROR, "Unknown exception thrown in FuseLowLevel::{}", operation);
+    fuse_reply_err(req, EIO);
+  }
+}
+
+bf::path FuseLowLevel::_path(fuse_ino_t ino) const {
+  auto path = _inodes.path(ino);
+  if (path == none) {
+    throw FuseErrnoException(ENOENT);
+  }
+  return *path;
+}
+
+bf::path FuseLowLevel::_childPath(fuse_ino_t parent, const char *name) const {
+  return _path(parent) / name;
+}
+
+fuse_entry_param FuseLowLevel::_lookupEntry(fuse_ino_t parent, const char *name) {
+  fuse_entry_param entry;
+  std::memset(&entry, 0, sizeof(entry));
+  _fs->lstat(_childPath(parent, name), &entry.attr);
+  entry.ino = _inodes.addLookup(parent, name, entry.attr.st_ino);
+  entry.attr.st_ino = entry.ino;
+  entry.attr_timeout = _attrTimeout;
+  entry.entry_timeout = _entryTimeout;
+  return entry;
+}
+
+void FuseLowLevel::_stat(fuse_ino_t ino, fuse_file_info *fileinfo, struct stat *stbuf) {
+  if (fileinfo != nullptr) {
+    _fs->fstat(fileinfo->fh, stbuf);
+  } else {
+    _fs->lstat(_path(ino), stbuf);
+  }
+  stbuf->st_ino = ino;
+}
+
+void FuseLowLevel::init(fuse_conn_info *conn) {
+  // Let the kernel splice write data into a pipe, write_buf() then reads it from there directly into the leaf blocks
+#ifdef FUSE_CAP_SPLICE_READ
+  if (conn->capable & FUSE_CAP_SPLICE_READ) {
+    conn->want |= FUSE_CAP_SPLICE_READ;
+  }
+#else
+  UNUSED(conn);
+#endif
+  LOG(INFO, "Filesystem started.");
+  _running = true;
+}
+
+void FuseLowLevel::destroy() {
+  LOG(INFO, "Filesystem stopped.");
+  _running = false;
+}
+
+void FuseLowLevel::lookup(fuse_req_t req, fuse_ino_t parent, const char *name) {
+  _handle(req, "lookup", [&] {
+    fuse_entry_param entry;
+    try {
+      entry = _lookupEntry(parent, name);
+    } catch (const FuseErrnoException &e) {
+      if (e.getErrno() != ENOENT) {
+        throw;
+      }
+      // Inode number 0 tells the kernel to cache that the entry doesn't exist
+      std::memset(&entry, 0, sizeof(entry));
+      entry.entry_timeout = _entryTimeout;
+    }
+    fuse_reply_entry(req, &entry);
+  });
+}
+
+void FuseLowLevel::forget(fuse_req_t req, fuse_ino_t ino, unsigned long nlookup) {
+  _inodes.forget(ino, nlookup);
+  fuse_reply_none(req);
+}
+
+void FuseLowLevel::getattr(fuse_req_t req, fuse_ino_t ino, fuse_file_info *fileinfo) {
+  _handle(req, "getattr", [&] {
+    struct stat stbuf;
+    _stat(ino, fileinfo, &stbuf);
+    fuse_reply_attr(req, &stbuf, _attrTimeout);
+  });
+}
+
+void FuseLowLevel::setattr(fuse_req_t req, fuse_ino_t ino, struct stat *attr, int to_set, fuse_file_info *fileinfo) {
+  _handle(req, "setattr", [&] {
+    if (to_set & FUSE_SET_ATTR_MODE) {
+      _fs->chmod(_path(ino), attr->st_mode);
+    }
+    if (to_set & (FUSE_SET_ATTR_UID | FUSE_SET_ATTR_GID)) {
+      uid_t uid = (to_set & FUSE_SET_ATTR_UID) ? attr->st_uid : (uid_t)-1;
+      gid_t gid = (to_set & FUSE_SET_ATTR_GID) ? attr->st_gid : (gid_t)-1;
+      _fs->chown(_path(ino), uid, gid);
+    }
+    if (to_set & FUSE_SET_ATTR_SIZE) {
+      if (fileinfo != nullptr) {
+        _fs->ftruncate(fileinfo->fh, attr->st_size);
+      } else {
+        _fs->truncate(_path(ino), attr->st_size);
+      }
+    }
+    if (to_set & (FUSE_SET_ATTR_ATIME | FUSE_SET_ATTR_MTIME | FUSE_SET_ATTR_ATIME_NOW | FUSE_SET_ATTR_MTIME_NOW)) {
+      bf::path path = _path(ino);
+      struct stat current;
+      _fs->lstat(path, &current);
+      struct timespec now;
+      clock_gettime(CLOCK_REALTIME, &now);
+      timespec atime = (to_set & FUSE_SET_ATTR_ATIME_NOW) ? now : (to_set & FUSE_SET_ATTR_ATIME) ? attr->st_atim : current.st_atim;
+      timespec mtime = (to_set & FUSE_SET_ATTR_MTIME_NOW) ? now : (to_set & FUSE_SET_ATTR_MTIME) ? attr->st_mtim : current.st_mtim;
+      _fs->utimens(path, atime, mtime);
+    }
+    struct stat stbuf;
+    _stat(ino, fileinfo, &stbuf);
+    fuse_reply_attr(req, &stbuf, _attrTimeout);
+  });
+}
+
+void FuseLowLevel::readlink(fuse_req_t req, fuse_ino_t ino) {
+  _handle(req, "readlink", [&] {
+    char buf[PATH_MAX + 1];
+    _fs->readSymlink(_path(ino), buf, sizeof(buf));
+    fuse_reply_readlink(req, buf);
+  });
+}
+
+void FuseLowLevel::mknod(fuse_req_t req, fuse_ino_t parent, const char *name, mode_t mode, dev_t rdev) {
+  UNUSED(parent);
+  UNUSED(rdev);
+  LOG(WARN, "Called non-implemented mknod({}, {}, _)", name, mode);
+  fuse_reply_err(req, ENOSYS);
+}
+
+void FuseLowLevel::mkdir(fuse_req_t req, fuse_ino_t parent, const char *name, mode_t mode) {
+  _handle(req, "mkdir", [&] {
+    auto context = fuse_req_ctx(req);
+    _fs->mkdir(_childPath(parent, name), mode, context->uid, context->gid);
+    fuse_entry_param entry = _lookupEntry(parent, name);
+    fuse_reply_entry(req, &entry);
+  });
+}
+
+void FuseLowLevel::unlink(fuse_req_t req, fuse_ino_t parent, const char *name) {
+  _handle(req, "unlink", [&] {
+    _fs->unlink(_childPath(parent, name));
+    _inodes.remove(parent, name);
+    fuse_reply_err(req, 0);
+  });
+}
+
+void FuseLowLevel::rmdir(fuse_req_t req, fuse_ino_t parent, const char *name) {
+  _handle(req, "rmdir", [&] {
+    _fs->rmdir(_childPath(parent, name));
+    _inodes.remove(parent, name);
+    fuse_reply_err(req, 0);
+  });
+}
+
+void FuseLowLevel::symlink(fuse_req_t req, const char *link, fuse_ino_t parent, const char *name) {
+  _handle(req, "symlink", [&] {
+    auto context = fuse_req_ctx(req);
+    _fs->createSymlink(link, _childPath(parent, name), context->uid, context->gid);
+    fuse_entry_param entry = _lookupEntry(parent, name);
+    fuse_reply_entry(req, &entry);
+  });
+}
+
+void FuseLowLevel::rename(fuse_req_t req, fuse_ino_t parent, const char *name, fuse_ino_t newparent, const char *newname) {
+  _handle(req, "rename", [&] {
+    _fs->rename(_childPath(parent, name), _childPath(newparent, newname));
+    _inodes.rename(parent, name, newparent, newname);
+    fuse_reply_err(req, 0);
+  });
+}
+
+void FuseLowLevel::link(fuse_req_t req, fuse_ino_t ino, fuse_ino_t newparent, const char *newname) {
+  UNUSED(ino);
+  UNUSED(newparent);
+  LOG(WARN, "NOT IMPLEMENTED: link(_, _, {})", newname);
+  fuse_reply_err(req, ENOSYS);
+}
+
+void FuseLowLevel::open(fuse_req_t req, fuse_ino_t ino, fuse_file_info *fileinfo) {
+  _handle(req, "open", [&] {
+    fileinfo->fh = _fs->openFile(_path(ino), fileinfo->flags);
+    fuse_reply_open(req, fileinfo);
+  });
+}
+
+void FuseLowLevel::read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, fuse_file_info *fileinfo) {
+  UNUSED(ino);
+  _handle(req, "read", [&] {
+    vector<char> buf(size);
+    size_t numRead = _fs->read(fileinfo->fh, buf.data(), size, offset);
+    fuse_reply_buf(req, buf.data(), numRead);
+  });
+}
+
+void FuseLowLevel::write(fuse_req_t req, fuse_ino_t ino, const char *buf, size_t size, off_t offset, fuse_file_info *fileinfo) {
+  UNUSED(ino);
+  _handle(req, "write", [&] {
+    _fs->write(fileinfo->fh, buf, size, offset);
+    fuse_reply_write(req, size);
+  });
+}
+
+void FuseLowLevel::write_buf(fuse_req_t req, fuse_ino_t ino, fuse_bufvec *buf, off_t offset, fuse_file_info *fileinfo) {
+  UNUSED(ino);
+  _handle(req, "write_buf", [&] {
+    // The data goes from the FUSE buffer (or the pipe the kernel spliced it into) directly into the leaf blocks
+    size_t size = fuse_buf_size(buf);
+    _fs->writeInPlace(fileinfo->fh, size, offset, [buf] (void *target, size_t count) {
+      copyFromBufferVector(buf, target, count);
+    });
+    fuse_reply_write(req, size);
+  });
+}
+
+void FuseLowLevel::flush(fuse_req_t req, fuse_ino_t ino, fuse_file_info *fileinfo) {
+  UNUSED(ino);
+  _handle(req, "flush", [&] {
+    _fs->flush(fileinfo->fh);
+    fuse_reply_err(req, 0);
+  });
+}
+
+void FuseLowLevel::release(fuse_req_t req, fuse_ino_t ino, fuse_file_info *fileinfo) {
+  UNUSED(ino);
+  _handle(req, "release", [&] {
+    _fs->closeFile(fileinfo->fh);
+    fuse_reply_err(req, 0);
+  });
+}
+
+void FuseLowLevel::fsync(fuse_req_t req, fuse_ino_t ino, int datasync, fuse_file_info *fileinfo) {
+  UNUSED(ino);
+  _handle(req, "fsync", [&] {
+    if (datasync) {
+      _fs->fdatasync(fileinfo->fh);
+    } else {
+      _fs->fsync(fileinfo->fh);
+    }
+    fuse_reply_err(req, 0);
+  });
+}
+
+void FuseLowLevel::opendir(fuse_req_t req, fuse_ino_t ino, fuse_file_info *fileinfo) {
+  _handle(req, "opendir", [&] {
+    fileinfo->fh = _openDirs.add(_fs->readDir(_path(ino)));
+    fuse_reply_open(req, fileinfo);
+  });
+}
+
+void FuseLowLevel::readdir(fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, fuse_file_info *fileinfo) {
+  _handle(req, "readdir", [&] {
+    const vector<Dir::Entry> &entries = *_openDirs.get(fileinfo->fh);
+    vector<char> buf(size);
+    size_t bufUsed = 0;
+    for (size_t index = offset; index < entries.size(); ++index) {
+      const Dir::Entry &entry = entries[index];
+      //The kernel only looks at the file type bits and the inode number. Lookups that follow fill in the rest.
+      struct stat stbuf;
+      std::memset(&stbuf, 0, sizeof(stbuf));
+      stbuf.st_mode = fileTypeBits(entry.type);
+      if (entry.name == ".") {
+        stbuf.st_ino = ino;
+      } else if (entry.name == "..") {
+        stbuf.st_ino = (ino == InodeTable::ROOT_INODE) ? ino : _inodes.parent(ino).get_value_or(UNKNOWN_INODE);
+      } else if (entry.inode != 0) {
+        // Same inode number lookup() and getattr() report
+        stbuf.st_ino = entry.inode;
+      } else {
+        stbuf.st_ino = _inodes.child(ino, entry.name).get_value_or(UNKNOWN_INODE);
+      }
+      // The offset of an entry is the offset to continue reading at, i.e. the index of the next entry.
+      size_t entrySize = fuse_add_direntry(req, buf.data() + bufUsed, size - bufUsed, entry.name.c_str(), &stbuf, index + 1);
+      if (entrySize > size - bufUsed) {
+        break;
+      }
+      bufUsed += entrySize;
+    }
+    fuse_reply_buf(req, buf.data(), bufUsed);
+  });
+}
+
+void FuseLowLevel::releasedir(fuse_req_t req, fuse_ino_t ino, fuse_file_info *fileinfo) {
+  UNUSED(ino);
+  _handle(req, "releasedir", [&] {
+    _openDirs.remove(fileinfo->fh);
+    fuse_reply_err(req, 0);
+  });
+}
+
+void FuseLowLevel::fsyncdir(fuse_req_t req, fuse_ino_t ino, int datasync, fuse_file_info *fileinfo) {
+  // The entries are the data of a directory, so datasync doesn't allow skipping anything
+  UNUSED(datasync);
+  UNUSED(fileinfo);
+  _handle(req, "fsyncdir", [&] {
+    _fs->fsyncDir(_path(ino));
+    fuse_reply_err(req, 0);
+  });
+}
+
+void FuseLowLevel::statfs(fuse_req_t req, fuse_ino_t ino) {
+  _handle(req, "statfs", [&] {
+    struct statvfs fsstat;
+    _fs->statfs(_path(ino), &fsstat);
+    fuse_reply_statfs(req, &fsstat);
+  });
+}
+
+void FuseLowLevel::access(fuse_req_t req, fuse_ino_t ino, int mask) {
+  _handle(req, "access", [&] {
+    _fs->access(_path(ino), mask);
+    fuse_reply_err(req, 0);
+  });
+}
+
+void FuseLowLevel::create(fuse_req_t req, fuse_ino_t parent, const char *name, mode_t mode, fuse_file_info *fileinfo) {
+  _handle(req, "create", [&] {
+    auto context = fuse_req_ctx(req);
+    fileinfo->fh = _fs->createAndOpenFile(_childPath(parent, name), mode, context->uid, context->gid);
+    fuse_entry_param entry;
+    try {
+      entry = _lookupEntry(parent, name);
+    } catch (...) {
+      _fs->closeFile(fileinfo->fh);
+      throw;
+    }
+    fuse_reply_create(req, &entry, fileinfo);
+  });
+}
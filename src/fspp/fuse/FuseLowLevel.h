@@ -0,0 +1,94 @@
+#pragma once
+#ifndef MESSMER_FSPP_FUSE_FUSELOWLEVEL_H_
+#define MESSMER_FSPP_FUSE_FUSELOWLEVEL_H_
+
+#include "params.h"
+#include "InodeTable.h"
+#include "../fs_interface/Dir.h"
+#include "../impl/IdList.h"
+#include <string>
+#include <vector>
+#include <atomic>
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+#include <cpp-utils/macros.h>
+
+namespace fspp {
+namespace fuse {
+class Filesystem;
+
+// Alternative to the Fuse class that runs on the FUSE low-level API.
+// The kernel identifies nodes by inode number instead of by path. We pass it the st_ino the filesystem returns
+// from lstat() and remember in an InodeTable where these inodes are in the directory tree.
+// Lookups return the full attributes, which the kernel caches for the configured timeouts, so it doesn't have to
+// call getattr() for each entry after a lookup. All changes go through the kernel, which updates its caches itself.
+class FuseLowLevel final {
+public:
+  // Timeouts are in seconds. They say how long the kernel may cache directory entries and node attributes.
+  // maxWriteBytes limits how much data the kernel sends with one write request.
+  // numThreads is the number of threads processing requests, unless the filesystem runs single-threaded ("-s").
+  // If it isn't given, libfuse starts threads on demand.
+  FuseLowLevel(Filesystem *fs, const std::string &fstype, const boost::optional<std::string> &fsname, double entryTimeout, double attrTimeout, const boost::optional<uint32_t> &maxWriteBytes, const boost::optional<uint32_t> &numThreads);
+  ~FuseLowLevel();
+
+  void run(const boost::filesystem::path &mountdir, const std::vector<std::string> &fuseOptions);
+  bool running() const;
+  void stop();
+
+  void init(fuse_conn_info *conn);
+  void destroy();
+  void lookup(fuse_req_t req, fuse_ino_t parent, const char *name);
+  void forget(fuse_req_t req, fuse_ino_t ino, unsigned long nlookup);
+  void getattr(fuse_req_t req, fuse_ino_t ino, fuse_file_info *fileinfo);
+  void setattr(fuse_req_t req, fuse_ino_t ino, struct stat *attr, int to_set, fuse_file_info *fileinfo);
+  void readlink(fuse_req_t req, fuse_ino_t ino);
+  void mknod(fuse_req_t req, fuse_ino_t parent, const char *name, mode_t mode, dev_t rdev);
+  void mkdir(fuse_req_t req, fuse_ino_t parent, const char *name, mode_t mode);
+  void unlink(fuse_req_t req, fuse_ino_t parent, const char *name);
+  void rmdir(fuse_req_t req, fuse_ino_t parent, const char *name);
+  void symlink(fuse_req_t req, const char *link, fuse_ino_t parent, const char *name);
+  void rename(fuse_req_t req, fuse_ino_t parent, const char *name, fuse_ino_t newparent, const char *newname);
+  void link(fuse_req_t req, fuse_ino_t ino, fuse_ino_t newparent, const char *newname);
+  void open(fuse_req_t req, fuse_ino_t ino, fuse_file_info *fileinfo);
+  void read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, fuse_file_info *fileinfo);
+  void write(fuse_req_t req, fuse_ino_t ino, const char *buf, size_t size, off_t offset, fuse_file_info *fileinfo);
+  void write_buf(fuse_req_t req, fuse_ino_t ino, fuse_bufvec *buf, off_t offset, fuse_file_info *fileinfo);
+  void flush(fuse_req_t req, fuse_ino_t ino, fuse_file_info *fileinfo);
+  void release(fuse_req_t req, fuse_ino_t ino, fuse_file_info *fileinfo);
+  void fsync(fuse_req_t req, fuse_ino_t ino, int datasync, fuse_file_info *fileinfo);
+  void opendir(fuse_req_t req, fuse_ino_t ino, fuse_file_info *fileinfo);
+  void readdir(fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset, fuse_file_info *fileinfo);
+  void releasedir(fuse_req_t req, fuse_ino_t ino, fuse_file_info *fileinfo);
+  void fsyncdir(fuse_req_t req, fuse_ino_t ino, int datasync, fuse_file_info *fileinfo);
+  void statfs(fuse_req_t req, fuse_ino_t ino);
+  void access(fuse_req_t req, fuse_ino_t ino, int mask);
+  void create(fuse_req_t req, fuse_ino_t parent, const char *name, mode_t mode, fuse_file_info *fileinfo);
+
+private:
+  template<class Func> static void _handle(fuse_req_t req, const char *operation, Func &&func);
+  boost::filesystem::path _path(fuse_ino_t ino) const;
+  boost::filesystem::path _childPath(fuse_ino_t parent, const char *name) const;
+  fuse_entry_param _lookupEntry(fuse_ino_t parent, const char *name);
+  void _stat(fuse_ino_t ino, fuse_file_info *fileinfo, struct stat *stbuf);
+  std::vector<std::string> _buildArgs(const boost::filesystem::path &mountdir, const std::vector<std::string> &fuseOptions) const;
+
+  Filesystem *_fs;
+  std::string _fstype;
+  boost::optional<std::string> _fsname;
+  double _entryTimeout;
+  double _attrTimeout;
+  boost::optional<uint32_t> _maxWriteBytes;
+  boost::optional<uint32_t> _numThreads;
+  boost::filesystem::path _mountdir;
+  std::atomic<bool> _running;
+  InodeTable _inodes;
+  // Directory listings are read when the directory is opened, so readdir() offsets stay valid while it is changed
+  IdList<std::vector<Dir::Entry>> _openDirs;
+
+  DISALLOW_COPY_AND_ASSIGN(FuseLowLevel);
+};
+
+}
+}
+
+#endif
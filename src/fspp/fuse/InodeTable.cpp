@@ -0,0 +1,151 @@
+#include "InodeTable.h"
+#include <cpp-utils/assert/assert.h>
+#include <vector>
+
+namespace bf = boost::filesystem;
+using boost::optional;
+using boost::none;
+using std::string;
+using std::vector;
+using std::unique_lock;
+using std::mutex;
+
+namespace fspp {
+namespace fuse {
+
+constexpr uint64_t InodeTable::ROOT_INODE;
+
+InodeTable::InodeTable(): _inodes(), _inodesByLocation(), _nextGeneratedInode(ROOT_INODE + 1), _mutex() {
+  // The root directory is never forgotten
+  _inodes.emplace(ROOT_INODE, Inode{ROOT_INODE, "", 1, true});
+}
+
+uint64_t InodeTable::addLookup(uint64_t parent, const string &name, uint64_t inode) {
+  unique_lock<mutex> lock(_mutex);
+  auto existingAtLocation = _inodesByLocation.find(Location(parent, name));
+  if (inode == 0) {
+    inode = (existingAtLocation != _inodesByLocation.end()) ? existingAtLocation->second : _nextGeneratedInode++;
+  }
+  ASSERT(inode != ROOT_INODE, "The root directory can't be looked up in a directory");
+  if (existingAtLocation != _inodesByLocation.end() && existingAtLocation->second != inode) {
+    // The entry was replaced without us noticing
+    _unlink(existingAtLocation->second);
+  }
+  auto found = _inodes.find(inode);
+  if (found == _inodes.end()) {
+    _inodes.emplace(inode, Inode{parent, name, 1, true});
+  } else {
+    if (found->second.linked && (found->second.parent != parent || found->second.name != name)) {
+      _unlink(inode);
+    }
+    found->second.parent = parent;
+    found->second.name = name;
+    found->second.linked = true;
+    ++found->second.numLookups;
+  }
+  _inodesByLocation[Location(parent, name)] = inode;
+  return inode;
+}
+
+void InodeTable::forget(uint64_t inode, uint64_t numLookups) {
+  unique_lock<mutex> lock(_mutex);
+  if (inode == ROOT_INODE) {
+    return;
+  }
+  auto found = _inodes.find(inode);
+  if (found == _inodes.end()) {
+    return;
+  }
+  found->second.numLookups -= std::min(found->second.numLookups, numLookups);
+  if (found->second.numLookups == 0) {
+    _unlink(inode);
+    _inodes.erase(found);
+  }
+}
+
+optional<bf::path> InodeTable::path(uint64_t inode) const {
+  unique_lock<mutex> lock(_mutex);
+  vector<const string*> components;
+  while (inode != ROOT_INODE) {
+    auto found = _inodes.find(inode);
+    if (found == _inodes.end() || !found->second.linked) {
+      return none;
+    }
+    components.push_back(&found->second.name);
+    inode = found->second.parent;
+  }
+  bf::path result("/");
+  for (auto component = components.rbegin(); component != components.rend(); ++component) {
+    result /= **component;
+  }
+  return result;
+}
+
+optional<uint64_t> InodeTable::child(uint64_t parent, const string &name) const {
+  unique_lock<mutex> lock(_mutex);
+  auto found = _inodesByLocation.find(Location(parent, name));
+  if (found == _inodesByLocation.end()) {
+    return none;
+  }
+  return found->second;
+}
+
+optional<uint64_t> InodeTable::parent(uint64_t inode) const {
+  unique_lock<mutex> lock(_mutex);
+  auto found = _inodes.find(inode);
+  if (found == _inodes.end() || !found->second.linked) {
+    return none;
+  }
+  return found->second.parent;
+}
+
+optional<uint64_t> InodeTable::remove(uint64_t parent, const string &name) {
+  unique_lock<mutex> lock(_mutex);
+  auto found = _inodesByLocation.find(Location(parent, name));
+  if (found == _inodesByLocation.end()) {
+    return none;
+  }
+  uint64_t inode = found->second;
+  _unlink(inode);
+  return inode;
+}
+
+optional<uint64_t> InodeTable::rename(uint64_t parent, const string &name, uint64_t newParent, const string &newName) {
+  unique_lock<mutex> lock(_mutex);
+  optional<uint64_t> overwritten = none;
+  auto foundTarget = _inodesByLocation.find(Location(newParent, newName));
+  if (foundTarget != _inodesByLocation.end()) {
+    overwritten = foundTarget->second;
+    _unlink(*overwritten);
+  }
+  auto foundSource = _inodesByLocation.find(Location(parent, name));
+  if (foundSource != _inodesByLocation.end()) {
+    uint64_t inode = foundSource->second;
+    _inodesByLocation.erase(foundSource);
+    Inode &moved = _inodes.at(inode);
+    moved.parent = newParent;
+    moved.name = newName;
+    _inodesByLocation[Location(newParent, newName)] = inode;
+  }
+  return overwritten;
+}
+
+size_t InodeTable::size() const {
+  unique_lock<mutex> lock(_mutex);
+  return _inodes.size();
+}
+
+void InodeTable::_unlink(uint64_t inode) {
+  auto found = _inodes.find(inode);
+  if (found == _inodes.end() || !found->second.linked) {
+    return;
+  }
+  auto location = _inodesByLocation.find(Location(found->second.parent, found->second.name));
+  if (location != _inodesByLocation.end() && location->second == inode) {
+    _inodesByLocation.erase(location);
+  }
+  found->second.linked = false;
+}
+
+}
+}
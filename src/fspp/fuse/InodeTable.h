@@ -0,0 +1,64 @@
+#pragma once
+#ifndef MESSMER_FSPP_FUSE_INODETABLE_H_
+#define MESSMER_FSPP_FUSE_INODETABLE_H_
+
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+#include <cpp-utils/macros.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace fspp {
+namespace fuse {
+
+// Remembers which inode numbers the kernel knows about and where they are in the directory tree,
+// so the low-level FUSE backend can translate inode numbers back to the paths fspp works with.
+// An inode stays in the table until the kernel forgets all lookups of it, even after it was unlinked.
+class InodeTable final {
+public:
+  static constexpr uint64_t ROOT_INODE = 1;
+
+  InodeTable();
+
+  // Registers that the kernel looked up `name` in directory `parent` and got inode `inode`.
+  // If `inode` is 0, the filesystem didn't provide inode numbers and one is generated.
+  // Returns the inode number the kernel was given.
+  uint64_t addLookup(uint64_t parent, const std::string &name, uint64_t inode);
+  void forget(uint64_t inode, uint64_t numLookups);
+
+  // Returns none if the inode isn't known or was unlinked
+  boost::optional<boost::filesystem::path> path(uint64_t inode) const;
+  boost::optional<uint64_t> child(uint64_t parent, const std::string &name) const;
+  boost::optional<uint64_t> parent(uint64_t inode) const;
+
+  // Both return the inode that was removed from the directory tree, if the kernel knew it
+  boost::optional<uint64_t> remove(uint64_t parent, const std::string &name);
+  boost::optional<uint64_t> rename(uint64_t parent, const std::string &name, uint64_t newParent, const std::string &newName);
+
+  size_t size() const;
+
+private:
+  struct Inode {
+    uint64_t parent;
+    std::string name;
+    uint64_t numLookups;
+    bool linked;
+  };
+  using Location = std::pair<uint64_t, std::string>;
+
+  void _unlink(uint64_t inode);
+
+  std::unordered_map<uint64_t, Inode> _inodes;
+  std::map<Location, uint64_t> _inodesByLocation;
+  uint64_t _nextGeneratedInode;
+  mutable std::mutex _mutex;
+
+  DISALLOW_COPY_AND_ASSIGN(InodeTable);
+};
+
+}
+}
+
+#endif
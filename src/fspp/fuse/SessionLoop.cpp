@@ -0,0 +1,139 @@
+#include "SessionLoop.h"
+#include "../impl/Profiler.h"
+#include <cpp-utils/assert/assert.h>
+#include <cpp-utils/logging/logging.h>
+#include <csignal>
+#include <cerrno>
+
+using std::vector;
+using namespace cpputils::logging;
+
+namespace fspp {
+namespace fuse {
+
+SessionLoop::SessionLoop(fuse_session *session, uint32_t numThreads)
+  : _session(session), _channel(fuse_session_next_chan(session, nullptr)), _numThreads(numThreads), _workers(),
+    _numBusyWorkers(0), _numRequestsOccupyingLastWorker(0), _workerFinished() {
+  ASSERT(_numThreads > 0, "Need at least one worker thread");
+  sem_init(&_workerFinished, 0, 0);
+}
+
+SessionLoop::~SessionLoop() {
+  sem_destroy(&_workerFinished);
+}
+
+int SessionLoop::run() {
+  ASSERT(_workers.empty(), "Session loop already ran");
+  int result = 0;
+  for (uint32_t i = 0; i < _numThreads; ++i) {
+    auto worker = std::make_unique<Worker>();
+    worker->loop = this;
+    worker->numRequests = 0;
+    worker->busyNanosec = 0;
+    if (!_startWorker(worker.get())) {
+      LOG(ERROR, "Could not start FUSE worker thread");
+      fuse_session_exit(_session);
+      result = -1;
+      break;
+    }
+    _workers.push_back(std::move(worker));
+  }
+
+  // The signal handlers libfuse installed exit the session and interrupt this wait
+  while (!fuse_session_exited(_session)) {
+    sem_wait(&_workerFinished);
+  }
+
+  // Workers blocked in reading the next request don't notice that the session exited.
+  // They only allow cancellation while waiting for a request, so no request is interrupted.
+  for (const auto &worker : _workers) {
+    pthread_cancel(worker->thread);
+  }
+  for (const auto &worker : _workers) {
+    pthread_join(worker->thread, nullptr);
+  }
+  fuse_session_reset(_session);
+
+  _logStatistics();
+  return result;
+}
+
+bool SessionLoop::_startWorker(Worker *worker) {
+  // Signals should be handled by the main thread, so workers start with all signals blocked
+  sigset_t allSignals, oldMask;
+  sigfillset(&allSignals);
+  pthread_sigmask(SIG_BLOCK, &allSignals, &oldMask);
+  int result = pthread_create(&worker->thread, nullptr, &SessionLoop::_workerMain, worker);
+  pthread_sigmask(SIG_SETMASK, &oldMask, nullptr);
+  return result == 0;
+}
+
+void *SessionLoop::_workerMain(void *worker) {
+  Worker *self = static_cast<Worker*>(worker);
+  self->loop->_work(self);
+  return nullptr;
+}
+
+void SessionLoop::_work(Worker *worker) {
+  pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, nullptr);
+  vector<char> buffer(fuse_chan_bufsize(_channel));
+
+  while (!fuse_session_exited(_session)) {
+    fuse_chan *channel = _channel;
+    fuse_buf request;
+    request.size = buffer.size();
+    request.flags = static_cast<fuse_buf_flags>(0);
+    request.mem = buffer.data();
+    request.fd = -1;
+    request.pos = 0;
+
+    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, nullptr);
+    int received = fuse_session_receive_buf(_session, &request, &channel);
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, nullptr);
+    if (received == -EINTR) {
+      continue;
+    }
+    if (received <= 0) {
+      if (received < 0) {
+        fuse_session_exit(_session);
+      }
+      break;
+    }
+
+    if (++_numBusyWorkers == _numThreads) {
+      ++_numRequestsOccupyingLastWorker;
+    }
+    {
+      Profiler profiler(&worker->busyNanosec);
+      fuse_session_process_buf(_session, &request, channel);
+    }
+    --_numBusyWorkers;
+    ++worker->numRequests;
+  }
+
+  sem_post(&_workerFinished);
+}
+
+vector<SessionLoop::WorkerStatistics> SessionLoop::statistics() const {
+  vector<WorkerStatistics> result;
+  result.reserve(_workers.size());
+  for (const auto &worker : _workers) {
+    result.push_back(WorkerStatistics{worker->numRequests, worker->busyNanosec});
+  }
+  return result;
+}
+
+uint64_t SessionLoop::numRequestsOccupyingLastWorker() const {
+  return _numRequestsOccupyingLastWorker;
+}
+
+void SessionLoop::_logStatistics() const {
+  auto workers = statistics();
+  for (size_t i = 0; i < workers.size(); ++i) {
+    LOG(INFO, "FUSE worker {}: {} requests, busy for {} s", i, workers[i].numRequests, static_cast<double>(workers[i].busyNanosec)/1000000000);
+  }
+  LOG(INFO, "{} requests occupied the last idle FUSE worker", numRequestsOccupyingLastWorker());
+}
+
+}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#ifndef MESSMER_FSPP_FUSE_SESSIONLOOP_H_
+#define MESSMER_FSPP_FUSE_SESSIONLOOP_H_
+
+#include "params.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <pthread.h>
+#include <semaphore.h>
+#include <cpp-utils/macros.h>
+
+namespace fspp {
+namespace fuse {
+
+// Processes FUSE requests with a fixed number of worker threads.
+// libfuse's own multi-threaded loop starts and stops workers on demand, which doesn't allow tuning the concurrency
+// to the machine. This loop also counts per worker how many requests it processed and how long it was busy,
+// and how often a request occupied the last idle worker, i.e. further requests had to queue in the kernel.
+class SessionLoop final {
+public:
+  struct WorkerStatistics {
+    uint64_t numRequests;
+    uint64_t busyNanosec;
+  };
+
+  SessionLoop(fuse_session *session, uint32_t numThreads);
+  ~SessionLoop();
+
+  // Blocks until the session exits, i.e. until the filesystem is unmounted or a termination signal arrives.
+  // Returns 0 on success and -1 if a worker couldn't be started.
+  int run();
+
+  std::vector<WorkerStatistics> statistics() const;
+  uint64_t numRequestsOccupyingLastWorker() const;
+
+private:
+  struct Worker {
+    SessionLoop *loop;
+    pthread_t thread;
+    std::atomic_uint_fast64_t numRequests;
+    std::atomic_uint_fast64_t busyNanosec;
+  };
+
+  static void *_workerMain(void *worker);
+  void _work(Worker *worker);
+  bool _startWorker(Worker *worker);
+  void _logStatistics() const;
+
+  fuse_session *_session;
+  fuse_chan *_channel;
+  uint32_t _numThreads;
+  std::vector<std::unique_ptr<Worker>> _workers;
+  std::atomic<uint32_t> _numBusyWorkers;
+  std::atomic_uint_fast64_t _numRequestsOccupyingLastWorker;
+  // Posted by workers when they stop because the session exited
+  sem_t _workerFinished;
+
+  DISALLOW_COPY_AND_ASSIGN(SessionLoop);
+};
+
+}
+}
+
+#endif
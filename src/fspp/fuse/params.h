@@ -5,8 +5,10 @@
 #define FUSE_USE_VERSION 26
 #if defined(__linux__) || defined(__FreeBSD__)
 #include <fuse.h>
+#include <fuse_lowlevel.h>
 #elif __APPLE__
 #include <osxfuse/fuse.h>
+#include <osxfuse/fuse_lowlevel.h>
 #else
 #error System not supported
 #endif
@@ -1,6 +1,7 @@
 #include "FilesystemImpl.h"
 
 #include <fcntl.h>
+#include <unistd.h>
 #include "../fs_interface/Device.h"
 #include "../fs_interface/Dir.h"
 #include "../fs_interface/Symlink.h"
@@ -38,10 +39,10 @@ FilesystemImpl::FilesystemImpl(Device *device)
 #ifdef FSPP_PROFILE
    _loadFileNanosec(0), _loadDirNanosec(0), _loadSymlinkNanosec(0), _openFileNanosec(0), _flushNanosec(0),
    _closeFileNanosec(0), _lstatNanosec(0), _fstatNanosec(0), _chmodNanosec(0), _chownNanosec(0), _truncateNanosec(0),
-   _ftruncateNanosec(0), _readNanosec(0), _writeNanosec(0), _fsyncNanosec(0), _fdatasyncNanosec(0), _accessNanosec(0),
+   _ftruncateNanosec(0), _readNanosec(0), _writeNanosec(0), _fsyncNanosec(0), _fdatasyncNanosec(0), _lseekNanosec(0), _accessNanosec(0),
    _createAndOpenFileNanosec(0), _createAndOpenFileNanosec_withoutLoading(0), _mkdirNanosec(0),
    _mkdirNanosec_withoutLoading(0), _rmdirNanosec(0), _rmdirNanosec_withoutLoading(0), _unlinkNanosec(0),
-   _unlinkNanosec_withoutLoading(0), _renameNanosec(0), _readDirNanosec(0), _readDirNanosec_withoutLoading(0),
+   _unlinkNanosec_withoutLoading(0), _renameNanosec(0), _readDirNanosec(0), _readDirNanosec_withoutLoading(0), _fsyncDirNanosec(0),
    _utimensNanosec(0), _statfsNanosec(0), _createSymlinkNanosec(0), _createSymlinkNanosec_withoutLoading(0),
    _readSymlinkNanosec(0), _readSymlinkNanosec_withoutLoading(0),
 #endif
@@ -70,6 +71,7 @@ FilesystemImpl::~FilesystemImpl() {
     << std::setw(40) << "Write: " << static_cast<double>(_writeNanosec)/1000000000 << "\n"
     << std::setw(40) << "Fsync: " << static_cast<double>(_fsyncNanosec)/1000000000 << "\n"
     << std::setw(40) << "Fdatasync: " << static_cast<double>(_fdatasyncNanosec)/1000000000 << "\n"
+    << std::setw(40) << "Lseek: " << static_cast<double>(_lseekNanosec)/1000000000 << "\n"
     << std::setw(40) << "Access: " << static_cast<double>(_accessNanosec)/1000000000 << "\n"
     << std::setw(40) << "CreateAndOpenFile: " << static_cast<double>(_createAndOpenFileNanosec)/1000000000 << "\n"
     << std::setw(40) << "CreateAndOpenFile (without loading): " << static_cast<double>(_createAndOpenFileNanosec_withoutLoading)/1000000000 << "\n"
@@ -82,6 +84,7 @@ FilesystemImpl::~FilesystemImpl() {
     << std::setw(40) << "Rename: " << static_cast<double>(_renameNanosec)/1000000000 << "\n"
     << std::setw(40) << "ReadDir: " << static_cast<double>(_readDirNanosec)/1000000000 << "\n"
     << std::setw(40) << "ReadDir (without loading): " << static_cast<double>(_readDirNanosec_withoutLoading)/1000000000 << "\n"
+    << std::setw(40) << "FsyncDir: " << static_cast<double>(_fsyncDirNanosec)/1000000000 << "\n"
     << std::setw(40) << "Utimens: " << static_cast<double>(_utimensNanosec)/1000000000 << "\n"
     << std::setw(40) << "Statfs: " << static_cast<double>(_statfsNanosec)/1000000000 << "\n"
     << std::setw(40) << "CreateSymlink: " << static_cast<double>(_createSymlinkNanosec)/1000000000 << "\n"
@@ -194,6 +197,11 @@ void FilesystemImpl::write(int descriptor, const void *buf, size_t count, off_t
   _open_files.get(descriptor)->write(buf, count, offset);
 }
 
+void FilesystemImpl::writeInPlace(int descriptor, size_t count, off_t offset, const std::function<void (void *target, size_t size)> &fill) {
+  PROFILE(_writeNanosec);
+  _open_files.get(descriptor)->writeInPlace(count, offset, fill);
+}
+
 void FilesystemImpl::fsync(int descriptor) {
   PROFILE(_fsyncNanosec);
   _open_files.get(descriptor)->fsync();
@@ -204,6 +212,19 @@ void FilesystemImpl::fdatasync(int descriptor) {
   _open_files.get(descriptor)->fdatasync();
 }
 
+off_t FilesystemImpl::lseek(int descriptor, off_t offset, int whence) {
+  PROFILE(_lseekNanosec);
+  switch (whence) {
+    case SEEK_DATA:
+      return _open_files.get(descriptor)->seekData(offset);
+    case SEEK_HOLE:
+      return _open_files.get(descriptor)->seekHole(offset);
+    default:
+      // The kernel handles the other modes itself, because they only need the file size
+      throw fuse::FuseErrnoException(EINVAL);
+  }
+}
+
 void FilesystemImpl::access(const bf::path &path, int mask) {
   PROFILE(_accessNanosec);
   auto node = _device->Load(path);
@@ -268,6 +289,11 @@ unique_ref<vector<Dir::Entry>> FilesystemImpl::readDir(const bf::path &path) {
   return dir->children();
 }
 
+void FilesystemImpl::fsyncDir(const bf::path &path) {
+  PROFILE(_fsyncDirNanosec);
+  LoadDir(path)->fsync();
+}
+
 void FilesystemImpl::utimens(const bf::path &path, timespec lastAccessTime, timespec lastModificationTime) {
   PROFILE(_utimensNanosec);
   auto node = _device->Load(path);
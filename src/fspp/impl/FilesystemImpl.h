@@ -35,8 +35,10 @@ public:
 	void ftruncate(int descriptor, off_t size) override;
 	size_t read(int descriptor, void *buf, size_t count, off_t offset) override;
 	void write(int descriptor, const void *buf, size_t count, off_t offset) override;
+	void writeInPlace(int descriptor, size_t count, off_t offset, const std::function<void (void *target, size_t size)> &fill) override;
 	void fsync(int descriptor) override;
 	void fdatasync(int descriptor) override;
+	off_t lseek(int descriptor, off_t offset, int whence) override;
 	void access(const boost::filesystem::path &path, int mask) override;
 	int createAndOpenFile(const boost::filesystem::path &path, mode_t mode, uid_t uid, gid_t gid) override;
 	void mkdir(const boost::filesystem::path &path, mode_t mode, uid_t uid, gid_t gid) override;
@@ -44,6 +46,7 @@ public:
 	void unlink(const boost::filesystem::path &path) override;
 	void rename(const boost::filesystem::path &from, const boost::filesystem::path &to) override;
 	cpputils::unique_ref<std::vector<Dir::Entry>> readDir(const boost::filesystem::path &path) override;
+	void fsyncDir(const boost::filesystem::path &path) override;
 	void utimens(const boost::filesystem::path &path, timespec lastAccessTime, timespec lastModificationTime) override;
 	void statfs(const boost::filesystem::path &path, struct statvfs *fsstat) override;
     void createSymlink(const boost::filesystem::path &to, const boost::filesystem::path &from, uid_t uid, gid_t gid) override;
@@ -73,6 +76,7 @@ private:
     std::atomic<uint64_t> _writeNanosec;
     std::atomic<uint64_t> _fsyncNanosec;
     std::atomic<uint64_t> _fdatasyncNanosec;
+    std::atomic<uint64_t> _lseekNanosec;
     std::atomic<uint64_t> _accessNanosec;
     std::atomic<uint64_t> _createAndOpenFileNanosec;
     std::atomic<uint64_t> _createAndOpenFileNanosec_withoutLoading;
@@ -85,6 +89,7 @@ private:
     std::atomic<uint64_t> _renameNanosec;
     std::atomic<uint64_t> _readDirNanosec;
     std::atomic<uint64_t> _readDirNanosec_withoutLoading;
+    std::atomic<uint64_t> _fsyncDirNanosec;
     std::atomic<uint64_t> _utimensNanosec;
     std::atomic<uint64_t> _statfsNanosec;
     std::atomic<uint64_t> _createSymlinkNanosec;
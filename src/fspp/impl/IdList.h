@@ -2,46 +2,120 @@
 #ifndef MESSMER_FSPP_IMPL_IDLIST_H_
 #define MESSMER_FSPP_IMPL_IDLIST_H_
 
-#include <map>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <queue>
 #include <stdexcept>
+#include <vector>
 #include <cpp-utils/pointer/unique_ref.h>
 
 namespace fspp {
 
+// Maps IDs (i.e. file descriptors) to entries.
+// Entries are stored in an array of slots indexed by ID, so get() only needs two atomic loads and no lock.
+// This array is split into chunks that are allocated when first needed and never moved or freed before the
+// IdList is destructed, so growing it doesn't invalidate concurrent lookups.
+// get() doesn't protect the entry itself. Callers have to make sure that an entry isn't removed while they use it,
+// which FUSE guarantees for file descriptors.
 template<class Entry>
 class IdList final {
 public:
+  static constexpr int CHUNK_SIZE = 1024;
+  static constexpr int MAX_CHUNKS = 1024;
+
   IdList();
   virtual ~IdList();
 
+  // Like POSIX file descriptors, this returns the lowest ID that isn't in use. IDs of removed entries are reused.
   int add(cpputils::unique_ref<Entry> entry);
   Entry *get(int id);
   const Entry *get(int id) const;
   void remove(int id);
 private:
-  std::map<int, cpputils::unique_ref<Entry>> _entries;
-  int _id_counter;
-  mutable std::mutex _mutex;
+  using Slot = std::atomic<Entry*>;
+  using Chunk = std::array<Slot, CHUNK_SIZE>;
+
+  // nullptr if the chunk for this ID isn't allocated
+  Slot *_slot(int id) const;
+  Slot *_allocateSlot(int id);
+
+  std::array<std::atomic<Chunk*>, MAX_CHUNKS> _chunks;
+  // Only add() and remove() lock this
+  std::mutex _mutex;
+  std::priority_queue<int, std::vector<int>, std::greater<int>> _freeIds;
+  int _nextUnusedId;
 
   DISALLOW_COPY_AND_ASSIGN(IdList<Entry>);
 };
 
+template<class Entry> constexpr int IdList<Entry>::CHUNK_SIZE;
+template<class Entry> constexpr int IdList<Entry>::MAX_CHUNKS;
+
 template<class Entry>
 IdList<Entry>::IdList()
-  : _entries(), _id_counter(0), _mutex() {
+  : _chunks(), _mutex(), _freeIds(), _nextUnusedId(1) {
+  for (auto &chunk : _chunks) {
+    chunk.store(nullptr, std::memory_order_relaxed);
+  }
 }
 
 template<class Entry>
 IdList<Entry>::~IdList() {
+  for (auto &chunk : _chunks) {
+    Chunk *loaded = chunk.load(std::memory_order_relaxed);
+    if (loaded == nullptr) {
+      continue;
+    }
+    for (auto &slot : *loaded) {
+      delete slot.load(std::memory_order_relaxed);
+    }
+    delete loaded;
+  }
+}
+
+template<class Entry>
+typename IdList<Entry>::Slot *IdList<Entry>::_slot(int id) const {
+  if (id <= 0 || id >= CHUNK_SIZE * MAX_CHUNKS) {
+    return nullptr;
+  }
+  Chunk *chunk = _chunks[id / CHUNK_SIZE].load(std::memory_order_acquire);
+  if (chunk == nullptr) {
+    return nullptr;
+  }
+  return &(*chunk)[id % CHUNK_SIZE];
+}
+
+template<class Entry>
+typename IdList<Entry>::Slot *IdList<Entry>::_allocateSlot(int id) {
+  auto &chunk = _chunks[id / CHUNK_SIZE];
+  if (chunk.load(std::memory_order_relaxed) == nullptr) {
+    auto newChunk = std::make_unique<Chunk>();
+    for (auto &slot : *newChunk) {
+      slot.store(nullptr, std::memory_order_relaxed);
+    }
+    chunk.store(newChunk.release(), std::memory_order_release);
+  }
+  return _slot(id);
 }
 
 template<class Entry>
 int IdList<Entry>::add(cpputils::unique_ref<Entry> entry) {
+  std::unique_ptr<Entry> owned = cpputils::to_unique_ptr(std::move(entry));
   std::lock_guard<std::mutex> lock(_mutex);
-  //TODO Reuse IDs (ids = descriptors)
-  int new_id = ++_id_counter;
-  _entries.insert(std::make_pair(new_id, std::move(entry)));
+  int new_id;
+  if (!_freeIds.empty()) {
+    new_id = _freeIds.top();
+    _freeIds.pop();
+  } else {
+    if (_nextUnusedId >= CHUNK_SIZE * MAX_CHUNKS) {
+      throw std::length_error("IdList is full");
+    }
+    new_id = _nextUnusedId++;
+  }
+  _allocateSlot(new_id)->store(owned.release(), std::memory_order_release);
   return new_id;
 }
 
@@ -52,19 +126,27 @@ Entry *IdList<Entry>::get(int id) {
 
 template<class Entry>
 const Entry *IdList<Entry>::get(int id) const {
-  std::lock_guard<std::mutex> lock(_mutex);
-  const Entry *result = _entries.at(id).get();
+  Slot *slot = _slot(id);
+  const Entry *result = (slot == nullptr) ? nullptr : slot->load(std::memory_order_acquire);
+  if (result == nullptr) {
+    throw std::out_of_range("Called IdList::get() with an invalid ID");
+  }
   return result;
 }
 
 template<class Entry>
 void IdList<Entry>::remove(int id) {
-  std::lock_guard<std::mutex> lock(_mutex);
-  auto found_iter = _entries.find(id);
-  if (found_iter == _entries.end()) {
-    throw std::out_of_range("Called IdList::remove() with an invalid ID");
+  std::unique_ptr<Entry> removed;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    Slot *slot = _slot(id);
+    if (slot == nullptr || slot->load(std::memory_order_relaxed) == nullptr) {
+      throw std::out_of_range("Called IdList::remove() with an invalid ID");
+    }
+    removed.reset(slot->exchange(nullptr, std::memory_order_acq_rel));
+    _freeIds.push(id);
   }
-  _entries.erase(found_iter);
+  // Destructing the entry can take a while (e.g. closing a file), so it happens after releasing the lock
 }
 
 }
@@ -26,6 +26,7 @@ public:
     ~ParallelAccessStore() {
         ASSERT(_openResources.size() == 0, "Still resources open when trying to destruct");
         ASSERT(_resourcesToRemove.size() == 0, "Still resources to remove when trying to destruct");
+        ASSERT(_loadingResources.size() == 0, "Still resources being loaded when trying to destruct");
     };
 
   class ResourceRefBase {
@@ -54,6 +55,10 @@ public:
   boost::optional<cpputils::unique_ref<ResourceRef>> load(const Key &key);
   boost::optional<cpputils::unique_ref<ResourceRef>> load(const Key &key, std::function<cpputils::unique_ref<ResourceRef>(Resource*)> createResourceRef);
   void remove(const Key &key, cpputils::unique_ref<ResourceRef> block);
+  // Removes the resource without needing a reference to it. If it is opened, this waits until all users released it
+  // and removes it from the base store. If it isn't opened, removeUnopened is called to remove it and load() returns
+  // none for the key until it returns. Returns false if the resource didn't exist.
+  bool remove(const Key &key, std::function<bool ()> removeUnopened);
 
 private:
   class OpenResource final {
@@ -89,6 +94,9 @@ private:
 
   std::unordered_map<Key, OpenResource> _openResources;
   std::map<Key, std::promise<cpputils::unique_ref<Resource>>> _resourcesToRemove;
+  // Keys that are currently being loaded from the base store (without holding _mutex).
+  // Other threads loading the same key wait for this future instead of loading it a second time.
+  std::unordered_map<Key, std::shared_future<void>> _loadingResources;
 
   template<class ActualResourceRef>
   cpputils::unique_ref<ActualResourceRef> _add(const Key &key, cpputils::unique_ref<Resource> resource, std::function<cpputils::unique_ref<ActualResourceRef>(Resource*)> createResourceRef);
@@ -104,7 +112,8 @@ ParallelAccessStore<Resource, ResourceRef, Key>::ParallelAccessStore(cpputils::u
   : _mutex(),
   _baseStore(std::move(baseStore)),
   _openResources(),
-  _resourcesToRemove() {
+  _resourcesToRemove(),
+  _loadingResources() {
   static_assert(std::is_base_of<ResourceRefBase, ResourceRef>::value, "ResourceRef must inherit from ResourceRefBase");
 }
 
@@ -149,20 +158,49 @@ boost::optional<cpputils::unique_ref<ResourceRef>> ParallelAccessStore<Resource,
 
 template<class Resource, class ResourceRef, class Key>
 boost::optional<cpputils::unique_ref<ResourceRef>> ParallelAccessStore<Resource, ResourceRef, Key>::load(const Key &key, std::function<cpputils::unique_ref<ResourceRef>(Resource*)> createResourceRef) {
-  //TODO This lock doesn't allow loading different blocks in parallel. Can we only lock the requested key?
-  std::lock_guard<std::mutex> lock(_mutex);
-  auto found = _openResources.find(key);
-  if (found == _openResources.end()) {
-    auto resource = _baseStore->loadFromBaseStore(key);
-    if (resource == boost::none) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (true) {
+    auto found = _openResources.find(key);
+    if (found != _openResources.end()) {
+      auto resourceRef = createResourceRef(found->second.getReference());
+      resourceRef->init(this, key);
+      return std::move(resourceRef);
+    }
+    if (_resourcesToRemove.find(key) != _resourcesToRemove.end()) {
+      // The resource was released by its last user and is about to be removed from the base store.
       return boost::none;
     }
-  	return _add(key, std::move(*resource), createResourceRef);
-  } else {
-    auto resourceRef = createResourceRef(found->second.getReference());
-    resourceRef->init(this, key);
-    return std::move(resourceRef);
+    auto loading = _loadingResources.find(key);
+    if (loading == _loadingResources.end()) {
+      break;
+    }
+    // Another thread is loading this key. Wait for it and then look again.
+    std::shared_future<void> loadingFinished = loading->second;
+    lock.unlock();
+    loadingFinished.wait();
+    lock.lock();
   }
+
+  // Load the resource from the base store without holding the lock, so different keys can be loaded in parallel.
+  std::promise<void> loadingFinished;
+  _loadingResources.emplace(key, loadingFinished.get_future().share());
+  lock.unlock();
+  boost::optional<cpputils::unique_ref<Resource>> resource = boost::none;
+  try {
+    resource = _baseStore->loadFromBaseStore(key);
+  } catch (...) {
+    lock.lock();
+    _loadingResources.erase(key);
+    loadingFinished.set_value();
+    throw;
+  }
+  lock.lock();
+  _loadingResources.erase(key);
+  loadingFinished.set_value();
+  if (resource == boost::none) {
+    return boost::none;
+  }
+  return _add(key, std::move(*resource), createResourceRef);
 }
 
 template<class Resource, class ResourceRef, class Key>
@@ -178,10 +216,62 @@ void ParallelAccessStore<Resource, ResourceRef, Key>::remove(const Key &key, cpp
   //Wait for last resource user to release it
   auto resourceToRemove = resourceToRemoveFuture.get();
 
-  std::lock_guard<std::mutex> lock(_mutex); // TODO Just added this as a precaution on a whim, but I seriously need to rethink locking here.
-  _resourcesToRemove.erase(key); //TODO Is this erase causing a race condition?
+  // The key stays in _resourcesToRemove until the base store removed it, so concurrent load() calls
+  // for it return none instead of loading it from the base store while it is being removed.
+  try {
+    _baseStore->removeFromBaseStore(std::move(resourceToRemove));
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _resourcesToRemove.erase(key);
+    throw;
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  _resourcesToRemove.erase(key);
+}
 
-  _baseStore->removeFromBaseStore(std::move(resourceToRemove));
+template<class Resource, class ResourceRef, class Key>
+bool ParallelAccessStore<Resource, ResourceRef, Key>::remove(const Key &key, std::function<bool ()> removeUnopened) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (true) {
+    auto found = _openResources.find(key);
+    if (found != _openResources.end()) {
+      auto resourceRef = cpputils::make_unique_ref<ResourceRef>(found->second.getReference());
+      resourceRef->init(this, key);
+      lock.unlock();
+      remove(key, std::move(resourceRef));
+      return true;
+    }
+    if (_resourcesToRemove.find(key) != _resourcesToRemove.end()) {
+      // Somebody else is already removing it.
+      return false;
+    }
+    auto loading = _loadingResources.find(key);
+    if (loading == _loadingResources.end()) {
+      break;
+    }
+    // Another thread is loading this key. Wait for it and then look again.
+    std::shared_future<void> loadingFinished = loading->second;
+    lock.unlock();
+    loadingFinished.wait();
+    lock.lock();
+  }
+
+  // Nobody has the resource opened. Checking that and removing it has to be atomic, so we block load() calls for
+  // the key until it is removed. Nobody will set the value of this promise, because nobody can open the resource.
+  _resourcesToRemove.emplace(key, std::promise<cpputils::unique_ref<Resource>>());
+  lock.unlock();
+  bool removed = false;
+  try {
+    removed = removeUnopened();
+  } catch (...) {
+    lock.lock();
+    _resourcesToRemove.erase(key);
+    throw;
+  }
+  lock.lock();
+  _resourcesToRemove.erase(key);
+  return removed;
 }
 
 template<class Resource, class ResourceRef, class Key>
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include "blobstore/implementations/onblocks/BlobStoreOnBlocks.h"
+#include <blockstore/implementations/ondisk/OnDiskBlockStore.h>
+#include <blockstore/implementations/testfake/FakeBlockStore.h>
+#include <cpp-utils/data/DataFixture.h>
+#include <cpp-utils/tempfile/TempDir.h>
+
+using blobstore::Blob;
+using blobstore::onblocks::BlobStoreOnBlocks;
+using blockstore::Key;
+using blockstore::ondisk::OnDiskBlockStore;
+using blockstore::testfake::FakeBlockStore;
+using cpputils::DataFixture;
+using cpputils::TempDir;
+using cpputils::make_unique_ref;
+using cpputils::unique_ref;
+using boost::none;
+
+class BackgroundRemovalTest: public ::testing::Test {
+public:
+  static constexpr uint32_t BLOCKSIZE_BYTES = 4096;
+
+  BackgroundRemovalTest(): baseDir() {}
+
+  unique_ref<BlobStoreOnBlocks> CreateBlobStore() {
+    return make_unique_ref<BlobStoreOnBlocks>(make_unique_ref<OnDiskBlockStore>(baseDir.path()), BLOCKSIZE_BYTES);
+  }
+
+  unique_ref<Blob> CreateBlobWithSize(BlobStoreOnBlocks *blobStore, uint64_t size) {
+    auto blob = blobStore->create();
+    auto data = DataFixture::generate(size);
+    blob->write(data.data(), 0, size);
+    return blob;
+  }
+
+  TempDir baseDir;
+  const Key journalKey = Key::FromString("1491BB4932A389EE14BC7090AC772972");
+};
+
+constexpr uint32_t BackgroundRemovalTest::BLOCKSIZE_BYTES;
+
+TEST_F(BackgroundRemovalTest, RemovesBlob) {
+  BlobStoreOnBlocks blobStore(make_unique_ref<FakeBlockStore>(), BLOCKSIZE_BYTES);
+  blobStore.removeInBackground(journalKey);
+  auto blob = CreateBlobWithSize(&blobStore, 100 * BLOCKSIZE_BYTES);
+  Key key = blob->key();
+  blobStore.remove(std::move(blob));
+  blobStore.waitForPendingRemovals();
+  EXPECT_EQ(none, blobStore.load(key));
+  EXPECT_EQ(1u, blobStore.numBlocks()); // Only the journal is left
+}
+
+TEST_F(BackgroundRemovalTest, RemovesManyBlobs) {
+  BlobStoreOnBlocks blobStore(make_unique_ref<FakeBlockStore>(), BLOCKSIZE_BYTES);
+  blobStore.removeInBackground(journalKey);
+  for (int i = 0; i < 10; ++i) {
+    blobStore.remove(CreateBlobWithSize(&blobStore, 10 * BLOCKSIZE_BYTES));
+  }
+  blobStore.waitForPendingRemovals();
+  EXPECT_EQ(1u, blobStore.numBlocks()); // Only the journal is left
+}
+
+TEST_F(BackgroundRemovalTest, JournalIsEmptyAfterRemoval) {
+  BlobStoreOnBlocks blobStore(make_unique_ref<FakeBlockStore>(), BLOCKSIZE_BYTES);
+  blobStore.removeInBackground(journalKey);
+  blobStore.remove(CreateBlobWithSize(&blobStore, 10 * BLOCKSIZE_BYTES));
+  blobStore.waitForPendingRemovals();
+  EXPECT_EQ(0u, blobStore.load(journalKey).value()->size());
+}
+
+TEST_F(BackgroundRemovalTest, CreatesJournalWithGivenKey) {
+  auto blobStore = CreateBlobStore();
+  blobStore->removeInBackground(journalKey);
+  EXPECT_NE(none, blobStore->load(journalKey));
+}
+
+TEST_F(BackgroundRemovalTest, ReusesExistingJournal) {
+  CreateBlobStore()->removeInBackground(journalKey);
+  auto blobStore = CreateBlobStore();
+  blobStore->removeInBackground(journalKey);
+  EXPECT_EQ(1u, blobStore->numBlocks());
+}
+
+TEST_F(BackgroundRemovalTest, ResumesRemovalFromJournal) {
+  Key blobKey = Key::Null();
+  {
+    // Simulate a removal that was scheduled, but didn't run before unmounting
+    auto blobStore = CreateBlobStore();
+    blobKey = CreateBlobWithSize(blobStore.get(), 10 * BLOCKSIZE_BYTES)->key();
+    blobStore->removeInBackground(journalKey);
+    blobStore->load(journalKey).value()->write(blobKey.data(), 0, Key::BINARY_LENGTH);
+  }
+  auto blobStore = CreateBlobStore();
+  blobStore->removeInBackground(journalKey);
+  blobStore->waitForPendingRemovals();
+  EXPECT_EQ(none, blobStore->load(blobKey));
+  EXPECT_EQ(0u, blobStore->load(journalKey).value()->size());
+  EXPECT_EQ(1u, blobStore->numBlocks()); // Only the journal is left
+}
+
+TEST_F(BackgroundRemovalTest, DropsIncompleteJournalEntry) {
+  Key blobKey = Key::Null();
+  {
+    auto blobStore = CreateBlobStore();
+    blobKey = CreateBlobWithSize(blobStore.get(), 10 * BLOCKSIZE_BYTES)->key();
+    blobStore->removeInBackground(journalKey);
+    auto journal = blobStore->load(journalKey).value();
+    journal->write(blobKey.data(), 0, Key::BINARY_LENGTH);
+    journal->write(blobKey.data(), Key::BINARY_LENGTH, 3);
+  }
+  auto blobStore = CreateBlobStore();
+  blobStore->removeInBackground(journalKey);
+  blobStore->waitForPendingRemovals();
+  EXPECT_EQ(none, blobStore->load(blobKey));
+  EXPECT_EQ(0u, blobStore->load(journalKey).value()->size());
+}
@@ -0,0 +1,37 @@
+#include <gtest/gtest.h>
+#include "blobstore/implementations/onblocks/BlobStoreOnBlocks.h"
+#include <blockstore/implementations/caching/CachingBlockStore.h>
+#include <blockstore/implementations/testfake/FakeBlockStore.h>
+#include <cpp-utils/data/DataFixture.h>
+
+using blobstore::onblocks::BlobStoreOnBlocks;
+using blockstore::caching::CachingBlockStore;
+using blockstore::testfake::FakeBlockStore;
+using cpputils::Data;
+using cpputils::DataFixture;
+using cpputils::make_unique_ref;
+
+class BlobFlushTest: public ::testing::Test {
+public:
+  static constexpr uint32_t BLOCKSIZE_BYTES = 4096;
+
+  BlobFlushTest()
+    : baseBlockStore(new FakeBlockStore),
+      blobStore(make_unique_ref<CachingBlockStore>(cpputils::nullcheck(std::unique_ptr<FakeBlockStore>(baseBlockStore)).value()), BLOCKSIZE_BYTES) {
+  }
+
+  FakeBlockStore *baseBlockStore;
+  BlobStoreOnBlocks blobStore;
+};
+
+constexpr uint32_t BlobFlushTest::BLOCKSIZE_BYTES;
+
+TEST_F(BlobFlushTest, FlushStoresReleasedNodes) {
+  auto blob = blobStore.create();
+  Data data = DataFixture::generate(100 * BLOCKSIZE_BYTES);
+  blob->write(data.data(), 0, data.size());
+  // The caching block store would only write the released leaves back after a while
+  EXPECT_GT(blobStore.numBlocks(), baseBlockStore->numBlocks());
+  blob->flush();
+  EXPECT_EQ(blobStore.numBlocks(), baseBlockStore->numBlocks());
+}
@@ -0,0 +1,86 @@
+#include "testutils/BlobStoreTest.h"
+#include <cpp-utils/data/Data.h>
+#include <cpp-utils/data/DataFixture.h>
+#include "blobstore/implementations/onblocks/datanodestore/DataNodeView.h"
+
+using namespace blobstore;
+using blobstore::onblocks::datanodestore::DataNodeLayout;
+using cpputils::Data;
+using cpputils::DataFixture;
+using cpputils::unique_ref;
+using boost::none;
+
+class BlobHolesTest: public BlobStoreTest {
+public:
+  static constexpr DataNodeLayout LAYOUT = DataNodeLayout(BLOCKSIZE_BYTES);
+  static constexpr uint64_t NUM_LEAVES = 100;
+
+  BlobHolesTest(): blob(blobStore->create()), leafSize(LAYOUT.maxBytesPerLeaf()) {}
+
+  void WriteDataToLeaf(uint64_t leafIndex) {
+    Data data = DataFixture::generate(leafSize);
+    blob->write(data.data(), leafIndex * leafSize, leafSize);
+  }
+
+  unique_ref<Blob> blob;
+  uint64_t leafSize;
+};
+constexpr DataNodeLayout BlobHolesTest::LAYOUT;
+constexpr uint64_t BlobHolesTest::NUM_LEAVES;
+
+TEST_F(BlobHolesTest, HolesReadAsZeroes) {
+  blob->resize(NUM_LEAVES * leafSize);
+  Data read(blob->size());
+  blob->read(read.data(), 0, read.size());
+  Data zeroes(blob->size());
+  zeroes.FillWithZeroes();
+  EXPECT_EQ(zeroes, read);
+}
+
+TEST_F(BlobHolesTest, WritingIntoHoleKeepsNeighboursZero) {
+  blob->resize(NUM_LEAVES * leafSize);
+  Data data = DataFixture::generate(10);
+  blob->write(data.data(), 50 * leafSize - 5, data.size());
+  Data read(20);
+  blob->read(read.data(), 50 * leafSize - 10, read.size());
+  Data zeroes(5);
+  zeroes.FillWithZeroes();
+  EXPECT_EQ(0, std::memcmp(zeroes.data(), read.data(), 5));
+  EXPECT_EQ(0, std::memcmp(data.data(), read.dataOffset(5), data.size()));
+  EXPECT_EQ(0, std::memcmp(zeroes.data(), read.dataOffset(15), 5));
+}
+
+TEST_F(BlobHolesTest, SeekInEmptyBlob) {
+  EXPECT_EQ(none, blob->seekData(0));
+  EXPECT_EQ(none, blob->seekHole(0));
+}
+
+TEST_F(BlobHolesTest, SeekInBlobWithoutHoles) {
+  Data data = DataFixture::generate(3 * leafSize);
+  blob->write(data.data(), 0, data.size());
+  EXPECT_EQ(5u, blob->seekData(5).value());
+  EXPECT_EQ(3 * leafSize, blob->seekHole(5).value());
+  EXPECT_EQ(none, blob->seekData(3 * leafSize));
+  EXPECT_EQ(none, blob->seekHole(3 * leafSize));
+}
+
+TEST_F(BlobHolesTest, SeekInSparseBlob) {
+  blob->resize(NUM_LEAVES * leafSize);
+  WriteDataToLeaf(50);
+  EXPECT_EQ(0u, blob->seekData(0).value());
+  EXPECT_EQ(leafSize, blob->seekHole(0).value());
+  EXPECT_EQ(50 * leafSize, blob->seekData(leafSize + 3).value());
+  EXPECT_EQ(50 * leafSize + 3, blob->seekData(50 * leafSize + 3).value());
+  EXPECT_EQ(51 * leafSize, blob->seekHole(50 * leafSize + 3).value());
+  EXPECT_EQ((NUM_LEAVES - 1) * leafSize, blob->seekData(51 * leafSize).value());
+  EXPECT_EQ(NUM_LEAVES * leafSize, blob->seekHole((NUM_LEAVES - 1) * leafSize).value());
+}
+
+TEST_F(BlobHolesTest, OverwritingWithZeroesCreatesHole) {
+  blob->resize(NUM_LEAVES * leafSize);
+  WriteDataToLeaf(50);
+  Data zeroes(leafSize);
+  zeroes.FillWithZeroes();
+  blob->write(zeroes.data(), 50 * leafSize, leafSize);
+  EXPECT_EQ((NUM_LEAVES - 1) * leafSize, blob->seekData(leafSize).value());
+}
@@ -2,6 +2,7 @@
 #include <cpp-utils/data/Data.h>
 #include <cpp-utils/data/DataFixture.h>
 #include "blobstore/implementations/onblocks/datanodestore/DataNodeView.h"
+#include <thread>
 
 using cpputils::unique_ref;
 using ::testing::WithParamInterface;
@@ -36,6 +37,17 @@ public:
     EXPECT_EQ(0, std::memcmp(expected.data(), read.data(), size));
   }
 
+  // Writes data with writeInPlace() and checks that the pieces it asks for are consecutive and cover everything
+  void writeInPlace(Blob *blob, const void *data, uint64_t offset, uint64_t size) {
+    uint64_t alreadyWritten = 0;
+    blob->writeInPlace(offset, size, [data, size, &alreadyWritten] (void *target, uint64_t pieceSize) {
+      ASSERT_LE(alreadyWritten + pieceSize, size);
+      std::memcpy(target, (const uint8_t*)data + alreadyWritten, pieceSize);
+      alreadyWritten += pieceSize;
+    });
+    EXPECT_EQ(size, alreadyWritten);
+  }
+
   Data randomData;
   unique_ref<Blob> blob;
 };
@@ -147,6 +159,24 @@ TEST_P(BlobReadWriteDataTest, OverwriteAndRead) {
   EXPECT_DATA_READS_AS_OUTSIDE_OF(this->backgroundData, *blob, GetParam().offset, GetParam().count);
 }
 
+TEST_P(BlobReadWriteDataTest, WriteInPlaceAndReadImmediately) {
+  blob->resize(GetParam().blobsize);
+  writeInPlace(blob.get(), this->foregroundData.data(), GetParam().offset, GetParam().count);
+
+  EXPECT_EQ(GetParam().blobsize, blob->size());
+  EXPECT_DATA_READS_AS(this->foregroundData, *blob, GetParam().offset, GetParam().count);
+  EXPECT_DATA_IS_ZEROES_OUTSIDE_OF(*blob, GetParam().offset, GetParam().count);
+}
+
+TEST_P(BlobReadWriteDataTest, WriteInPlaceAndReadAfterLoading) {
+  blob->resize(GetParam().blobsize);
+  writeInPlace(blob.get(), this->foregroundData.data(), GetParam().offset, GetParam().count);
+  auto loaded = loadBlob(blob->key());
+
+  EXPECT_DATA_READS_AS(this->foregroundData, *loaded, GetParam().offset, GetParam().count);
+  EXPECT_DATA_IS_ZEROES_OUTSIDE_OF(*loaded, GetParam().offset, GetParam().count);
+}
+
 TEST_P(BlobReadWriteDataTest, WriteWholeAndReadPart) {
   blob->resize(GetParam().blobsize);
   blob->write(this->backgroundData.data(), 0, GetParam().blobsize);
@@ -164,3 +194,67 @@ TEST_P(BlobReadWriteDataTest, WritePartAndReadWhole) {
   EXPECT_EQ(0, std::memcmp((uint8_t*)read.data()+GetParam().offset, this->foregroundData.data(), GetParam().count));
   EXPECT_EQ(0, std::memcmp((uint8_t*)read.data()+GetParam().offset+GetParam().count, (uint8_t*)this->backgroundData.data()+GetParam().offset+GetParam().count, GetParam().blobsize-GetParam().count-GetParam().offset));
 }
+
+TEST_F(BlobReadWriteTest, WriteInPlaceGrowsBlob) {
+  blob->resize(100);
+  writeInPlace(blob.get(), randomData.data(), 50, LARGE_SIZE/2);
+  EXPECT_EQ(50 + LARGE_SIZE/2, blob->size());
+  EXPECT_DATA_READS_AS(randomData, *blob, 50, LARGE_SIZE/2);
+}
+
+TEST_F(BlobReadWriteTest, PrefetchingDoesntChangeBlob) {
+  blob->resize(LARGE_SIZE);
+  blob->write(randomData.data(), 0, LARGE_SIZE);
+  blob->prefetch(100, LARGE_SIZE - 200);
+  EXPECT_EQ(LARGE_SIZE, blob->size());
+  EXPECT_DATA_READS_AS(randomData, *blob, 0, LARGE_SIZE);
+}
+
+TEST_F(BlobReadWriteTest, PrefetchingBehindEndDoesntGrowBlob) {
+  blob->resize(5);
+  blob->write(randomData.data(), 0, 5);
+  blob->prefetch(0, LARGE_SIZE);
+  blob->prefetch(LARGE_SIZE, LARGE_SIZE);
+  EXPECT_EQ(5u, blob->size());
+  EXPECT_DATA_READS_AS(randomData, *blob, 0, 5);
+}
+
+TEST_F(BlobReadWriteTest, ConcurrentWritesToDisjointRegions) {
+  constexpr unsigned int NUM_THREADS = 8;
+  uint64_t regionSize = LARGE_SIZE / NUM_THREADS;
+  blob->resize(LARGE_SIZE);
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < NUM_THREADS; ++i) {
+    threads.emplace_back([this, i, regionSize] {
+      // Writing in small pieces makes sure the threads actually write at the same time
+      for (uint64_t offset = i * regionSize; offset < (i+1) * regionSize; offset += 1000) {
+        uint64_t count = std::min(UINT64_C(1000), (i+1) * regionSize - offset);
+        blob->write(randomData.dataOffset(offset), offset, count);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(LARGE_SIZE, blob->size());
+  EXPECT_DATA_READS_AS(randomData, *blob, 0, NUM_THREADS * regionSize);
+}
+
+TEST_F(BlobReadWriteTest, ConcurrentReads) {
+  constexpr unsigned int NUM_THREADS = 8;
+  blob->resize(LARGE_SIZE);
+  blob->write(randomData.data(), 0, LARGE_SIZE);
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < NUM_THREADS; ++i) {
+    threads.emplace_back([this, i] {
+      for (uint64_t offset = i * 1000; offset + 100000 <= LARGE_SIZE; offset += 500000) {
+        Data read(100000);
+        blob->read(read.data(), offset, read.size());
+        EXPECT_EQ(0, std::memcmp(randomData.dataOffset(offset), read.data(), read.size()));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+#include "blobstore/implementations/onblocks/BlobStoreOnBlocks.h"
+#include <blockstore/implementations/caching/CachingBlockStore.h>
+#include <blockstore/implementations/compressing/CompressingBlockStore.h>
+#include <blockstore/implementations/compressing/compressors/RunLengthEncoding.h>
+#include <blockstore/implementations/inmemory/InMemoryBlockStore.h>
+#include <chrono>
+#include <iostream>
+
+using cpputils::make_unique_ref;
+using blockstore::caching::CachingBlockStore;
+using blockstore::compressing::CompressingBlockStore;
+using blockstore::compressing::RunLengthEncoding;
+using blockstore::inmemory::InMemoryBlockStore;
+using blobstore::onblocks::BlobStoreOnBlocks;
+
+// Microbenchmark for growing a blob with resize(), like truncate or fallocate do it.
+// The new leaves are holes and only the right border of the tree is stored.
+// It is disabled by default because it takes a while and doesn't check anything.
+// Run it with --gtest_also_run_disabled_tests --gtest_filter=*BlobResizeBenchmark*
+class BlobResizeBenchmark: public ::testing::Test {
+public:
+  static constexpr uint64_t BLOCKSIZE_BYTES = 32 * 1024;
+  static constexpr uint64_t GB = 1024 * 1024 * 1024;
+
+  // Returns the number of seconds it took
+  double growBlob(uint64_t size) {
+    BlobStoreOnBlocks blobStore(
+      make_unique_ref<CachingBlockStore>(make_unique_ref<CompressingBlockStore<RunLengthEncoding>>(make_unique_ref<InMemoryBlockStore>())),
+      BLOCKSIZE_BYTES);
+    auto blob = blobStore.create();
+    auto start = std::chrono::steady_clock::now();
+    blob->resize(size);
+    blob->flush();
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    return duration.count();
+  }
+};
+
+constexpr uint64_t BlobResizeBenchmark::BLOCKSIZE_BYTES;
+constexpr uint64_t BlobResizeBenchmark::GB;
+
+TEST_F(BlobResizeBenchmark, DISABLED_Grow) {
+  for (uint64_t size : {1 * GB, 10 * GB, 100 * GB}) {
+    std::cout << "growing to " << size / GB << "GB: " << growBlob(size) << "s" << std::endl;
+  }
+}
@@ -100,6 +100,14 @@ public:
     return node->key();
   }
 
+  uint16_t FormatVersionOf(const Key &key) {
+    return DataNodeView(blockStore->load(key).value()).FormatVersion();
+  }
+
+  void SetFormatVersionOf(const Key &key, uint16_t formatVersion) {
+    DataNodeView(blockStore->load(key).value()).setFormatVersion(formatVersion);
+  }
+
   unique_ref<BlockStore> _blockStore;
   BlockStore *blockStore;
   unique_ref<DataNodeStore> nodeStore;
@@ -239,3 +247,30 @@ TEST_F(DataInnerNodeTest, LastChildWhenThreeChildren) {
   Key key = AddALeafTo(node.get());
   EXPECT_EQ(key, node->LastChild()->key());
 }
+
+TEST_F(DataInnerNodeTest, LoadsNodeFromVersionWithoutHoles) {
+  Key key = CreateNewInnerNodeReturnKey(*leaf);
+  SetFormatVersionOf(key, 0);
+  auto loaded = LoadInnerNode(key);
+  EXPECT_EQ(leaf->key(), loaded->getChild(0)->key());
+}
+
+TEST_F(DataInnerNodeTest, AddingAHoleUpgradesFormatVersion) {
+  Key key = CreateNewInnerNodeReturnKey(*leaf);
+  SetFormatVersionOf(key, 0);
+  LoadInnerNode(key)->addHole();
+  EXPECT_EQ(1, FormatVersionOf(key));
+}
+
+TEST_F(DataInnerNodeTest, AddingAChildDoesntUpgradeFormatVersion) {
+  Key key = CreateNewInnerNodeReturnKey(*leaf);
+  SetFormatVersionOf(key, 0);
+  AddALeafTo(LoadInnerNode(key).get());
+  EXPECT_EQ(0, FormatVersionOf(key));
+}
+
+TEST_F(DataInnerNodeTest, RejectsUnknownFormatVersion) {
+  Key key = CreateNewInnerNodeReturnKey(*leaf);
+  SetFormatVersionOf(key, 2);
+  EXPECT_THROW(nodeStore->load(key), std::runtime_error);
+}
@@ -136,6 +136,32 @@ TEST_F(DataNodeStoreTest, NumNodesIsCorrectAfterRemovingANode) {
   EXPECT_EQ(1u, nodeStore->numNodes());
 }
 
+TEST_F(DataNodeStoreTest, RemoveSubtreeRemovesAllNodes) {
+  auto leaf1 = nodeStore->createNewLeafNode();
+  auto leaf2 = nodeStore->createNewLeafNode();
+  auto inner = nodeStore->createNewInnerNode(*leaf1);
+  inner->addChild(*leaf2);
+  auto root = nodeStore->createNewInnerNode(*inner);
+  cpputils::destruct(std::move(leaf1));
+  cpputils::destruct(std::move(leaf2));
+  cpputils::destruct(std::move(inner));
+  nodeStore->removeSubtree(std::move(root));
+  EXPECT_EQ(0u, nodeStore->numNodes());
+}
+
+TEST_F(DataNodeStoreTest, RemoveSubtreeByKeySkipsNodesThatAreAlreadyRemoved) {
+  auto leaf1 = nodeStore->createNewLeafNode();
+  auto leaf2 = nodeStore->createNewLeafNode();
+  auto inner = nodeStore->createNewInnerNode(*leaf1);
+  inner->addChild(*leaf2);
+  Key innerKey = inner->key();
+  cpputils::destruct(std::move(inner));
+  cpputils::destruct(std::move(leaf2));
+  nodeStore->remove(std::move(leaf1));
+  nodeStore->removeSubtree(1, innerKey);
+  EXPECT_EQ(0u, nodeStore->numNodes());
+}
+
 TEST_F(DataNodeStoreTest, PhysicalBlockSize_Leaf) {
   auto leaf = nodeStore->createNewLeafNode();
   auto block = blockStore->load(leaf->key()).value();
@@ -0,0 +1,168 @@
+#include "testutils/DataTreeTest.h"
+#include <cpp-utils/data/Data.h>
+#include <cpp-utils/data/DataFixture.h>
+
+using blobstore::onblocks::datanodestore::DataLeafNode;
+using blobstore::onblocks::datatreestore::DataTree;
+using blobstore::onblocks::datatreestore::LeafAccess;
+using cpputils::Data;
+using cpputils::DataFixture;
+using cpputils::unique_ref;
+using boost::none;
+
+class DataTreeTest_Holes: public DataTreeTest {
+public:
+  DataTreeTest_Holes(): tree(treeStore.createNewTree()) {}
+
+  uint32_t maxChildren() const {
+    return nodeStore->layout().maxChildrenPerInnerNode();
+  }
+
+  uint64_t maxBytesPerLeaf() const {
+    return nodeStore->layout().maxBytesPerLeaf();
+  }
+
+  // Grows the tree to a full three level tree
+  void GrowToFullThreeLevelTree() {
+    tree->resizeNumBytes(maxChildren() * maxChildren() * maxBytesPerLeaf());
+  }
+
+  void WriteLeaf(uint32_t leafIndex, const Data &data) {
+    tree->traverseLeaves(leafIndex, leafIndex+1, [&data] (DataLeafNode *leaf, uint32_t) {
+      leaf->write(data.data(), 0, data.size());
+    });
+  }
+
+  Data ReadLeaf(uint32_t leafIndex) {
+    Data result(maxBytesPerLeaf());
+    EXPECT_TRUE(tree->traverseExistingLeaves(leafIndex, leafIndex+1, 0, LeafAccess::READ, [&result] (DataLeafNode *leaf, uint32_t) {
+      if (leaf == nullptr) {
+        result.FillWithZeroes();
+      } else {
+        leaf->read(result.data(), 0, result.size());
+      }
+    }));
+    return result;
+  }
+
+  Data Zeroes() {
+    Data zeroes(maxBytesPerLeaf());
+    zeroes.FillWithZeroes();
+    return zeroes;
+  }
+
+  unique_ref<DataTree> tree;
+};
+
+TEST_F(DataTreeTest_Holes, GrowingOnlyStoresRightBorder) {
+  GrowToFullThreeLevelTree();
+  EXPECT_EQ(maxChildren() * maxChildren(), tree->numLeaves());
+  // Root, first and last inner node, the old leaf and the new last leaf
+  EXPECT_EQ(5u, nodeStore->numNodes());
+}
+
+TEST_F(DataTreeTest_Holes, HolesAreReadAsZeroes) {
+  GrowToFullThreeLevelTree();
+  uint32_t numHoles = 0;
+  EXPECT_TRUE(tree->traverseExistingLeaves(0, tree->numLeaves(), 0, LeafAccess::READ, [&numHoles] (DataLeafNode *leaf, uint32_t) {
+    if (leaf == nullptr) {
+      ++numHoles;
+    }
+  }));
+  EXPECT_EQ(tree->numLeaves() - 2, numHoles);
+  EXPECT_EQ(Zeroes(), ReadLeaf(0));
+  EXPECT_EQ(Zeroes(), ReadLeaf(5));
+  EXPECT_EQ(Zeroes(), ReadLeaf(tree->numLeaves() - 1));
+}
+
+TEST_F(DataTreeTest_Holes, WritingToHoleStoresLeaf) {
+  GrowToFullThreeLevelTree();
+  uint64_t numNodes = nodeStore->numNodes();
+  Data data = DataFixture::generate(maxBytesPerLeaf());
+  WriteLeaf(5, data);
+  EXPECT_EQ(numNodes + 1, nodeStore->numNodes());
+  EXPECT_EQ(data, ReadLeaf(5));
+  EXPECT_EQ(Zeroes(), ReadLeaf(4));
+}
+
+TEST_F(DataTreeTest_Holes, WritingToHoleInHoleSubtreeStoresPath) {
+  GrowToFullThreeLevelTree();
+  uint64_t numNodes = nodeStore->numNodes();
+  Data data = DataFixture::generate(maxBytesPerLeaf());
+  WriteLeaf(maxChildren() + 3, data);
+  EXPECT_EQ(numNodes + 2, nodeStore->numNodes());
+  EXPECT_EQ(data, ReadLeaf(maxChildren() + 3));
+}
+
+TEST_F(DataTreeTest_Holes, WritingZeroesTurnsLeafIntoHole) {
+  GrowToFullThreeLevelTree();
+  Data data = DataFixture::generate(maxBytesPerLeaf());
+  WriteLeaf(5, data);
+  uint64_t numNodes = nodeStore->numNodes();
+  WriteLeaf(5, Zeroes());
+  EXPECT_EQ(numNodes - 1, nodeStore->numNodes());
+  EXPECT_EQ(Zeroes(), ReadLeaf(5));
+}
+
+TEST_F(DataTreeTest_Holes, InnerNodeWithOnlyHolesTurnsIntoHole) {
+  GrowToFullThreeLevelTree();
+  uint64_t numNodes = nodeStore->numNodes();
+  WriteLeaf(maxChildren() + 3, DataFixture::generate(maxBytesPerLeaf()));
+  WriteLeaf(maxChildren() + 3, Zeroes());
+  EXPECT_EQ(numNodes, nodeStore->numNodes());
+}
+
+TEST_F(DataTreeTest_Holes, WritingZeroesInPlaceTurnsLeafIntoHole) {
+  GrowToFullThreeLevelTree();
+  WriteLeaf(5, DataFixture::generate(maxBytesPerLeaf()));
+  uint64_t numNodes = nodeStore->numNodes();
+  Data zeroes = Zeroes();
+  EXPECT_TRUE(tree->traverseExistingLeaves(5, 6, 0, LeafAccess::WRITE, [&zeroes] (DataLeafNode *leaf, uint32_t) {
+    leaf->write(zeroes.data(), 0, zeroes.size());
+  }));
+  EXPECT_EQ(numNodes - 1, nodeStore->numNodes());
+}
+
+TEST_F(DataTreeTest_Holes, WritingInPlaceStopsAtHole) {
+  GrowToFullThreeLevelTree();
+  EXPECT_FALSE(tree->traverseExistingLeaves(0, 5, 0, LeafAccess::WRITE, [] (DataLeafNode*, uint32_t) {}));
+}
+
+TEST_F(DataTreeTest_Holes, LastLeafIsNeverAHole) {
+  GrowToFullThreeLevelTree();
+  uint32_t lastLeaf = tree->numLeaves() - 1;
+  WriteLeaf(lastLeaf, Zeroes());
+  EXPECT_EQ(lastLeaf, tree->nextDataLeaf(lastLeaf).value());
+  EXPECT_EQ(maxChildren() * maxChildren() * maxBytesPerLeaf(), tree->numStoredBytes());
+}
+
+TEST_F(DataTreeTest_Holes, ShrinkingIntoHole) {
+  GrowToFullThreeLevelTree();
+  tree->resizeNumBytes(maxChildren() * maxBytesPerLeaf() + 10);
+  EXPECT_EQ(maxChildren() + 1, tree->numLeaves());
+  EXPECT_EQ(maxChildren() * maxBytesPerLeaf() + 10, tree->numStoredBytes());
+  // Root, first inner node with the old leaf, and the new right border
+  EXPECT_EQ(5u, nodeStore->numNodes());
+  EXPECT_EQ(Zeroes(), ReadLeaf(maxChildren() - 1));
+}
+
+TEST_F(DataTreeTest_Holes, ShrinkingToOneLeaf) {
+  GrowToFullThreeLevelTree();
+  tree->resizeNumBytes(10);
+  EXPECT_EQ(1u, tree->numLeaves());
+  EXPECT_EQ(10u, tree->numStoredBytes());
+  EXPECT_EQ(1u, nodeStore->numNodes());
+}
+
+TEST_F(DataTreeTest_Holes, NextDataLeafAndNextHoleLeaf) {
+  GrowToFullThreeLevelTree();
+  uint32_t lastLeaf = tree->numLeaves() - 1;
+  WriteLeaf(maxChildren() + 3, DataFixture::generate(maxBytesPerLeaf()));
+  EXPECT_EQ(0u, tree->nextDataLeaf(0).value());
+  EXPECT_EQ(maxChildren() + 3, tree->nextDataLeaf(1).value());
+  EXPECT_EQ(lastLeaf, tree->nextDataLeaf(maxChildren() + 4).value());
+  EXPECT_EQ(1u, tree->nextHoleLeaf(0).value());
+  EXPECT_EQ(maxChildren() + 4, tree->nextHoleLeaf(maxChildren() + 3).value());
+  EXPECT_EQ(none, tree->nextHoleLeaf(lastLeaf));
+  EXPECT_EQ(none, tree->nextDataLeaf(lastLeaf + 1));
+}
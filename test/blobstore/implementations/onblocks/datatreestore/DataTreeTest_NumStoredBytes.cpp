@@ -73,3 +73,50 @@ TEST_P(DataTreeTest_NumStoredBytes_P, FourLevelMinDataTree) {
   auto tree = treeStore.load(key).value();
   EXPECT_EQ(nodeStore->layout().maxBytesPerLeaf()*nodeStore->layout().maxChildrenPerInnerNode()*nodeStore->layout().maxChildrenPerInnerNode() + GetParam(), tree->numStoredBytes());
 }
+
+// The tree caches its size, so check that the cache is kept up to date when the tree changes
+
+TEST_F(DataTreeTest_NumStoredBytes, AfterResizing) {
+  auto tree = treeStore.createNewTree();
+  EXPECT_EQ(0u, tree->numStoredBytes());
+  tree->resizeNumBytes(nodeStore->layout().maxBytesPerLeaf() * 5 + 10);
+  EXPECT_EQ(nodeStore->layout().maxBytesPerLeaf() * 5 + 10, tree->numStoredBytes());
+  EXPECT_EQ(6u, tree->numLeaves());
+  tree->resizeNumBytes(nodeStore->layout().maxBytesPerLeaf() * 2);
+  EXPECT_EQ(nodeStore->layout().maxBytesPerLeaf() * 2, tree->numStoredBytes());
+  EXPECT_EQ(2u, tree->numLeaves());
+}
+
+TEST_F(DataTreeTest_NumStoredBytes, AfterTraversingPastTheEnd) {
+  auto tree = treeStore.createNewTree();
+  EXPECT_EQ(0u, tree->numStoredBytes());
+  tree->traverseLeaves(3, 5, [] (DataLeafNode *leaf, uint32_t index) {
+    if (index == 4) {
+      leaf->resize(10);
+    }
+  });
+  EXPECT_EQ(nodeStore->layout().maxBytesPerLeaf() * 4 + 10, tree->numStoredBytes());
+  EXPECT_EQ(5u, tree->numLeaves());
+}
+
+TEST_F(DataTreeTest_NumStoredBytes, AfterTraversingTheLastLeaf) {
+  auto tree = treeStore.createNewTree();
+  tree->resizeNumBytes(nodeStore->layout().maxBytesPerLeaf() + 5);
+  tree->traverseLeaves(1, 2, [] (DataLeafNode *leaf, uint32_t) {
+    leaf->resize(20);
+  });
+  EXPECT_EQ(nodeStore->layout().maxBytesPerLeaf() + 20, tree->numStoredBytes());
+  EXPECT_EQ(2u, tree->numLeaves());
+}
+
+TEST_F(DataTreeTest_NumStoredBytes, AfterReloading) {
+  Key key = Key::Null();
+  {
+    auto tree = treeStore.createNewTree();
+    key = tree->key();
+    tree->resizeNumBytes(nodeStore->layout().maxBytesPerLeaf() * 3 + 7);
+  }
+  auto tree = treeStore.load(key).value();
+  EXPECT_EQ(nodeStore->layout().maxBytesPerLeaf() * 3 + 7, tree->numStoredBytes());
+  EXPECT_EQ(4u, tree->numLeaves());
+}
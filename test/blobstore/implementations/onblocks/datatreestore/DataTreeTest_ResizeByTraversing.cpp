@@ -69,7 +69,10 @@ public:
     DataInnerNode *inner = dynamic_cast<DataInnerNode*>(root.get());
     if (inner != nullptr) {
       for (uint32_t i = 0; i < inner->numChildren()-1; ++i) {
-        EXPECT_IS_MAXDATA_TREE(inner->getChild(i)->key());
+        // Holes are full subtrees by definition
+        if (!inner->getChild(i)->isHole()) {
+          EXPECT_IS_MAXDATA_TREE(inner->getChild(i)->key());
+        }
       }
       EXPECT_IS_LEFTMAXDATA_TREE(inner->LastChild()->key());
     }
@@ -80,7 +83,9 @@ public:
     DataInnerNode *inner = dynamic_cast<DataInnerNode*>(root.get());
     if (inner != nullptr) {
       for (uint32_t i = 0; i < inner->numChildren(); ++i) {
-        EXPECT_IS_MAXDATA_TREE(inner->getChild(i)->key());
+        if (!inner->getChild(i)->isHole()) {
+          EXPECT_IS_MAXDATA_TREE(inner->getChild(i)->key());
+        }
       }
     } else {
       DataLeafNode *leaf = dynamic_cast<DataLeafNode*>(root.get());
@@ -7,6 +7,7 @@ using blobstore::onblocks::datanodestore::DataLeafNode;
 using blobstore::onblocks::datanodestore::DataInnerNode;
 using blobstore::onblocks::datanodestore::DataNode;
 using blobstore::onblocks::datatreestore::DataTree;
+using blobstore::onblocks::datatreestore::LeafAccess;
 using blockstore::Key;
 
 using cpputils::unique_ref;
@@ -64,6 +65,14 @@ public:
     });
   }
 
+  bool TraverseExistingLeaves(DataNode *root, uint32_t beginIndex, uint32_t endIndex, uint64_t minNumStoredBytes = 0) {
+    root->flush();
+    auto tree = treeStore.load(root->key()).value();
+    return tree->traverseExistingLeaves(beginIndex, endIndex, minNumStoredBytes, LeafAccess::READ, [this] (DataLeafNode *leaf, uint32_t nodeIndex) {
+      traversor.called(leaf, nodeIndex);
+    });
+  }
+
   TraversorMock traversor;
 };
 
@@ -384,3 +393,37 @@ TEST_F(DataTreeTest_TraverseLeaves, TraverseMiddlePartOfFourLevelTree) {
 }
 
 //TODO Refactor the test cases that are too long
+
+TEST_F(DataTreeTest_TraverseLeaves, TraverseExistingLeavesOfThreelevelTree) {
+  auto root = CreateThreeLevel();
+  auto child = LoadInnerNode(root->getChild(1)->key());
+  for(unsigned int i = 5; i < nodeStore->layout().maxChildrenPerInnerNode(); ++i) {
+    EXPECT_TRAVERSE_LEAF(child->getChild(i)->key(), nodeStore->layout().maxChildrenPerInnerNode() + i);
+  }
+  EXPECT_TRAVERSE_ALL_CHILDREN_OF(*LoadInnerNode(root->getChild(2)->key()), 2 * nodeStore->layout().maxChildrenPerInnerNode());
+
+  EXPECT_TRUE(TraverseExistingLeaves(root.get(), nodeStore->layout().maxChildrenPerInnerNode() + 5, 3 * nodeStore->layout().maxChildrenPerInnerNode()));
+}
+
+TEST_F(DataTreeTest_TraverseLeaves, TraverseExistingLeavesUpToLastLeaf) {
+  auto root = CreateThreeLevel();
+  EXPECT_TRAVERSE_ALL_CHILDREN_OF(*LoadInnerNode(root->getChild(5)->key()), 5 * nodeStore->layout().maxChildrenPerInnerNode());
+
+  EXPECT_TRUE(TraverseExistingLeaves(root.get(), 5 * nodeStore->layout().maxChildrenPerInnerNode(), 5 * nodeStore->layout().maxChildrenPerInnerNode() + 3));
+}
+
+TEST_F(DataTreeTest_TraverseLeaves, TraverseExistingLeavesBehindEndDoesntTraverseOrGrow) {
+  auto root = CreateThreeLevel();
+  Key key = root->key();
+  EXPECT_DONT_TRAVERSE_ANY_LEAVES();
+
+  EXPECT_FALSE(TraverseExistingLeaves(root.get(), 0, 5 * nodeStore->layout().maxChildrenPerInnerNode() + 4));
+  EXPECT_EQ(5 * nodeStore->layout().maxChildrenPerInnerNode() + 3, treeStore.load(key).value()->numLeaves());
+}
+
+TEST_F(DataTreeTest_TraverseLeaves, TraverseExistingLeavesNeedingMoreBytesThanStoredDoesntTraverse) {
+  auto root = CreateLeafWithSize(10);
+  EXPECT_DONT_TRAVERSE_ANY_LEAVES();
+
+  EXPECT_FALSE(TraverseExistingLeaves(root.get(), 0, 1, 11));
+}
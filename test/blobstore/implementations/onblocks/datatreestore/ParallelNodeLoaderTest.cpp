@@ -0,0 +1,86 @@
+#include "testutils/DataTreeTest.h"
+
+#include "blobstore/implementations/onblocks/datatreestore/ParallelNodeLoader.h"
+#include <cpp-utils/data/DataFixture.h>
+#include <thread>
+
+using blobstore::onblocks::datanodestore::DataNode;
+using blobstore::onblocks::datanodestore::DataLeafNode;
+using blobstore::onblocks::datatreestore::ParallelNodeLoader;
+using blockstore::Key;
+using cpputils::DataFixture;
+using boost::none;
+using std::vector;
+
+class ParallelNodeLoaderTest: public DataTreeTest {
+public:
+  static constexpr unsigned int NUM_THREADS = 4;
+
+  ParallelNodeLoaderTest(): loader(NUM_THREADS) {}
+
+  vector<Key> CreateLeaves(unsigned int count) {
+    vector<Key> keys;
+    for (unsigned int i = 0; i < count; ++i) {
+      keys.push_back(CreateLeafWithSize(i % nodeStore->layout().maxBytesPerLeaf())->key());
+    }
+    return keys;
+  }
+
+  void EXPECT_LOADED(const vector<Key> &keys, const vector<boost::optional<cpputils::unique_ref<DataNode>>> &nodes) {
+    ASSERT_EQ(keys.size(), nodes.size());
+    for (unsigned int i = 0; i < keys.size(); ++i) {
+      ASSERT_NE(none, nodes[i]);
+      EXPECT_EQ(keys[i], (*nodes[i])->key());
+      EXPECT_EQ(i % nodeStore->layout().maxBytesPerLeaf(), dynamic_cast<const DataLeafNode&>(**nodes[i]).numBytes());
+    }
+  }
+
+  ParallelNodeLoader loader;
+};
+
+constexpr unsigned int ParallelNodeLoaderTest::NUM_THREADS;
+
+TEST_F(ParallelNodeLoaderTest, NoNodes) {
+  EXPECT_EQ(0u, loader.load(nodeStore, {}).size());
+}
+
+TEST_F(ParallelNodeLoaderTest, OneNode) {
+  auto keys = CreateLeaves(1);
+  EXPECT_LOADED(keys, loader.load(nodeStore, keys));
+}
+
+TEST_F(ParallelNodeLoaderTest, FewerNodesThanThreads) {
+  auto keys = CreateLeaves(NUM_THREADS - 1);
+  EXPECT_LOADED(keys, loader.load(nodeStore, keys));
+}
+
+TEST_F(ParallelNodeLoaderTest, MoreNodesThanThreads) {
+  auto keys = CreateLeaves(100);
+  EXPECT_LOADED(keys, loader.load(nodeStore, keys));
+}
+
+TEST_F(ParallelNodeLoaderTest, NonexistingNodes) {
+  auto keys = CreateLeaves(10);
+  Key nonexisting = Key::FromBinary(DataFixture::generate(Key::BINARY_LENGTH).data());
+  auto nodes = loader.load(nodeStore, {keys[0], nonexisting, keys[1]});
+  ASSERT_EQ(3u, nodes.size());
+  EXPECT_EQ(keys[0], (*nodes[0])->key());
+  EXPECT_EQ(none, nodes[1]);
+  EXPECT_EQ(keys[1], (*nodes[2])->key());
+}
+
+TEST_F(ParallelNodeLoaderTest, ConcurrentCallers) {
+  vector<vector<Key>> keys;
+  for (unsigned int i = 0; i < 2 * NUM_THREADS; ++i) {
+    keys.push_back(CreateLeaves(20));
+  }
+  vector<std::thread> callers;
+  for (const auto &callerKeys : keys) {
+    callers.emplace_back([this, &callerKeys] {
+      EXPECT_LOADED(callerKeys, loader.load(nodeStore, callerKeys));
+    });
+  }
+  for (auto &caller : callers) {
+    caller.join();
+  }
+}
@@ -229,7 +229,9 @@ void DataTreeTest::CHECK_DEPTH(int depth, const Key &key) {
     auto node = LoadInnerNode(key);
     EXPECT_EQ(depth, node->depth());
     for (uint32_t i = 0; i < node->numChildren(); ++i) {
-      CHECK_DEPTH(depth-1, node->getChild(i)->key());
+      if (!node->getChild(i)->isHole()) {
+        CHECK_DEPTH(depth-1, node->getChild(i)->key());
+      }
     }
   }
 }
@@ -51,6 +51,15 @@ private:
       auto inner = dynamic_cast<blobstore::onblocks::datanodestore::DataInnerNode*>(node);
       int leafIndex = firstLeafIndex;
       for (uint32_t i = 0; i < inner->numChildren(); ++i) {
+        if (inner->getChild(i)->isHole()) {
+          // Holes don't store any data, skip over their leaves
+          int nextLeafIndex = leafIndex + numLeavesPerChild(inner->depth());
+          if (leafIndex <= endLeafIndex && nextLeafIndex > endLeafIndex) {
+            nextLeafIndex = endLeafIndex;
+          }
+          leafIndex = nextLeafIndex;
+          continue;
+        }
         auto child = _dataNodeStore->load(inner->getChild(i)->key()).value();
         leafIndex = ForEachLeaf(child.get(), leafIndex, endLeafIndex, action);
       }
@@ -58,6 +67,14 @@ private:
     }
   }
 
+  int numLeavesPerChild(uint8_t depth) {
+    int result = 1;
+    for (uint8_t i = 1; i < depth; ++i) {
+      result *= _dataNodeStore->layout().maxChildrenPerInnerNode();
+    }
+    return result;
+  }
+
   blobstore::onblocks::datanodestore::DataNodeStore *_dataNodeStore;
   int _iv;
   SizePolicy _sizePolicy;
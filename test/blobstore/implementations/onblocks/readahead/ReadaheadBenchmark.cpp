@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include "blobstore/implementations/onblocks/BlobStoreOnBlocks.h"
+#include "blobstore/implementations/onblocks/readahead/ReadaheadWindow.h"
+#include <blockstore/implementations/caching/CachingBlockStore.h>
+#include <blockstore/implementations/inmemory/InMemoryBlockStore.h>
+#include <cpp-utils/data/DataFixture.h>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+using cpputils::Data;
+using cpputils::DataFixture;
+using cpputils::unique_ref;
+using cpputils::make_unique_ref;
+using boost::optional;
+using blockstore::Block;
+using blockstore::BlockStore;
+using blockstore::Key;
+using blockstore::caching::CachingBlockStore;
+using blockstore::inmemory::InMemoryBlockStore;
+using blobstore::onblocks::BlobStoreOnBlocks;
+using blobstore::onblocks::readahead::ReadaheadWindow;
+
+namespace {
+// Delays each load from the base store, like a slow disk would
+class LatencyBlockStore final: public BlockStore {
+public:
+  LatencyBlockStore(BlockStore *baseBlockStore, std::chrono::microseconds loadLatency)
+    : _baseBlockStore(baseBlockStore), _loadLatency(loadLatency) {}
+
+  Key createKey() override {
+    return _baseBlockStore->createKey();
+  }
+  optional<unique_ref<Block>> tryCreate(const Key &key, Data data) override {
+    return _baseBlockStore->tryCreate(key, std::move(data));
+  }
+  optional<unique_ref<Block>> load(const Key &key) override {
+    std::this_thread::sleep_for(_loadLatency);
+    return _baseBlockStore->load(key);
+  }
+  void remove(unique_ref<Block> block) override {
+    return _baseBlockStore->remove(std::move(block));
+  }
+  uint64_t numBlocks() const override {
+    return _baseBlockStore->numBlocks();
+  }
+  uint64_t estimateNumFreeBytes() const override {
+    return _baseBlockStore->estimateNumFreeBytes();
+  }
+  uint64_t blockSizeFromPhysicalBlockSize(uint64_t blockSize) const override {
+    return _baseBlockStore->blockSizeFromPhysicalBlockSize(blockSize);
+  }
+
+private:
+  BlockStore *_baseBlockStore;
+  std::chrono::microseconds _loadLatency;
+
+  DISALLOW_COPY_AND_ASSIGN(LatencyBlockStore);
+};
+}
+
+// Microbenchmark for reading a blob sequentially from a block store with high latency, with and without readahead.
+// It is disabled by default because it takes a while and doesn't check anything.
+// Run it with --gtest_also_run_disabled_tests --gtest_filter=*ReadaheadBenchmark*
+class ReadaheadBenchmark: public ::testing::Test {
+public:
+  static constexpr uint64_t BLOCKSIZE_BYTES = 32 * 1024;
+  static constexpr uint64_t BLOB_SIZE = 16 * 1024 * 1024;
+  // Size of a read like FUSE does it
+  static constexpr uint64_t READ_SIZE = 128 * 1024;
+  static constexpr std::chrono::microseconds LOAD_LATENCY = std::chrono::microseconds(1000);
+
+  ReadaheadBenchmark(): baseBlockStore(), blobKey(createBlob()) {}
+
+  unique_ref<BlobStoreOnBlocks> createBlobStore(std::chrono::microseconds loadLatency) {
+    return make_unique_ref<BlobStoreOnBlocks>(
+      make_unique_ref<CachingBlockStore>(make_unique_ref<LatencyBlockStore>(&baseBlockStore, loadLatency)),
+      BLOCKSIZE_BYTES);
+  }
+
+  Key createBlob() {
+    auto blobStore = createBlobStore(std::chrono::microseconds(0));
+    auto blob = blobStore->create();
+    Data data = DataFixture::generate(BLOB_SIZE);
+    blob->write(data.data(), 0, data.size());
+    return blob->key();
+  }
+
+  // Returns the read throughput in MB/s
+  double readSequentially(bool useReadahead) {
+    // Use a new blob store, so the blob isn't in the cache yet
+    auto blobStore = createBlobStore(LOAD_LATENCY);
+    auto blob = blobStore->load(blobKey).value();
+    ReadaheadWindow readahead;
+    Data buffer(READ_SIZE);
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t offset = 0; offset < BLOB_SIZE; offset += READ_SIZE) {
+      if (useReadahead) {
+        auto region = readahead.onRead(offset, READ_SIZE);
+        if (region != boost::none) {
+          blob->prefetch(region->offset, region->size);
+        }
+      }
+      blob->read(buffer.data(), offset, READ_SIZE);
+    }
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    return BLOB_SIZE / duration.count() / 1024 / 1024;
+  }
+
+  InMemoryBlockStore baseBlockStore;
+  Key blobKey;
+};
+
+constexpr uint64_t ReadaheadBenchmark::BLOCKSIZE_BYTES;
+constexpr uint64_t ReadaheadBenchmark::BLOB_SIZE;
+constexpr uint64_t ReadaheadBenchmark::READ_SIZE;
+constexpr std::chrono::microseconds ReadaheadBenchmark::LOAD_LATENCY;
+
+TEST_F(ReadaheadBenchmark, DISABLED_SequentialRead) {
+  std::cout << "without readahead: " << readSequentially(false) << " MB/s" << std::endl;
+  std::cout << "with readahead: " << readSequentially(true) << " MB/s" << std::endl;
+}
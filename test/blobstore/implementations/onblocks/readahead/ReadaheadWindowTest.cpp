@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include "blobstore/implementations/onblocks/readahead/ReadaheadWindow.h"
+
+using ::testing::Test;
+using boost::none;
+
+using blobstore::onblocks::readahead::ReadaheadWindow;
+
+class ReadaheadWindowTest: public Test {
+public:
+  static constexpr uint64_t INITIAL_SIZE = 100;
+  static constexpr uint64_t MAX_SIZE = 1000;
+
+  ReadaheadWindowTest(): window(INITIAL_SIZE, MAX_SIZE) {}
+
+  void EXPECT_REGION(uint64_t expectedOffset, uint64_t expectedSize, boost::optional<ReadaheadWindow::Region> actual) {
+    ASSERT_NE(none, actual);
+    EXPECT_EQ(expectedOffset, actual->offset);
+    EXPECT_EQ(expectedSize, actual->size);
+  }
+
+  ReadaheadWindow window;
+};
+
+constexpr uint64_t ReadaheadWindowTest::INITIAL_SIZE;
+constexpr uint64_t ReadaheadWindowTest::MAX_SIZE;
+
+TEST_F(ReadaheadWindowTest, FirstReadDoesntReadAhead) {
+  EXPECT_EQ(none, window.onRead(0, 10));
+}
+
+TEST_F(ReadaheadWindowTest, SecondSequentialReadReadsAhead) {
+  window.onRead(0, 10);
+  EXPECT_REGION(20, INITIAL_SIZE, window.onRead(10, 10));
+}
+
+TEST_F(ReadaheadWindowTest, SequentialReadsInTheMiddleOfTheFileReadAhead) {
+  window.onRead(5000, 10);
+  EXPECT_REGION(5020, INITIAL_SIZE, window.onRead(5010, 10));
+}
+
+TEST_F(ReadaheadWindowTest, RandomReadsDontReadAhead) {
+  EXPECT_EQ(none, window.onRead(500, 10));
+  EXPECT_EQ(none, window.onRead(100, 10));
+  EXPECT_EQ(none, window.onRead(300, 10));
+  EXPECT_EQ(none, window.onRead(0, 10));
+}
+
+TEST_F(ReadaheadWindowTest, WindowGrowsAndOnlyReturnsNewRegions) {
+  window.onRead(0, 10);
+  EXPECT_REGION(20, 100, window.onRead(10, 10));
+  // window size 200, so prefetch until 230. 20-120 was already prefetched.
+  EXPECT_REGION(120, 110, window.onRead(20, 10));
+  // window size 400, so prefetch until 440
+  EXPECT_REGION(230, 210, window.onRead(30, 10));
+}
+
+TEST_F(ReadaheadWindowTest, WindowIsLimitedByMaxSize) {
+  uint64_t offset = 0;
+  for (int i = 0; i < 10; ++i) {
+    window.onRead(offset, 10);
+    offset += 10;
+  }
+  EXPECT_REGION(MAX_SIZE + offset, 10, window.onRead(offset, 10));
+}
+
+TEST_F(ReadaheadWindowTest, RandomReadResetsWindow) {
+  window.onRead(0, 10);
+  window.onRead(10, 10);
+  window.onRead(20, 10);
+  EXPECT_EQ(none, window.onRead(5000, 10));
+  EXPECT_REGION(5020, INITIAL_SIZE, window.onRead(5010, 10));
+}
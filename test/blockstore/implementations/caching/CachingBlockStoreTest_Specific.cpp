@@ -54,3 +54,70 @@ TEST_F(CachingBlockStoreTest, PhysicalBlockSize_positive) {
     auto base = baseBlockStore->load(key).value();
     EXPECT_EQ(10*1024u, blockStore.blockSizeFromPhysicalBlockSize(base->size()));
 }
+
+TEST_F(CachingBlockStoreTest, LoadingNonexistingBlockIsMiss) {
+    EXPECT_EQ(boost::none, blockStore.load(blockstore::Key::FromString("1491BB4932A389EE14BC7090AC772972")));
+    EXPECT_EQ(0u, blockStore.statistics().numHits);
+    EXPECT_EQ(1u, blockStore.statistics().numMisses);
+}
+
+TEST_F(CachingBlockStoreTest, FlushedBlockStaysCached) {
+    auto key = CreateBlockReturnKey(Data(1024));
+    blockStore.flush();
+    EXPECT_NE(boost::none, blockStore.load(key));
+    EXPECT_EQ(1u, blockStore.statistics().numHits);
+    EXPECT_EQ(0u, blockStore.statistics().numMisses);
+    EXPECT_EQ(2*1024u, blockStore.statistics().numBytes); // data and base block
+}
+
+TEST_F(CachingBlockStoreTest, ModifiedBlockIsWrittenBackAndStaysCached) {
+    auto key = CreateBlockReturnKey(Data(1024).FillWithZeroes());
+    {
+        auto block = blockStore.load(key).value();
+        uint8_t value = 5;
+        block->write(&value, 0, 1);
+    }
+    blockStore.flush();
+    EXPECT_EQ(5, *static_cast<const uint8_t*>(baseBlockStore->load(key).value()->data()));
+    auto block = blockStore.load(key).value();
+    EXPECT_EQ(5, *static_cast<const uint8_t*>(block->data()));
+    EXPECT_EQ(2u, blockStore.statistics().numHits);
+    EXPECT_EQ(0u, blockStore.statistics().numMisses);
+}
+
+TEST_F(CachingBlockStoreTest, ReadCacheEvictsBlocksWhenFull) {
+    CachingBlockStore smallBlockStore(cpputils::make_unique_ref<FakeBlockStore>(), CachingBlockStore::DEFAULT_CACHE_CONFIG, CacheConfig(100, 1, 4*2*1024)); // 4 blocks with data and base block
+    for (int i = 0; i < 10; ++i) {
+        smallBlockStore.create(Data(1024))->flush();
+    }
+    EXPECT_EQ(6u, smallBlockStore.statistics().numEvictions);
+    EXPECT_EQ(4*2*1024u, smallBlockStore.statistics().numBytes);
+}
+
+TEST_F(CachingBlockStoreTest, FlushingKeysWritesBackReleasedBlocks) {
+    auto key = CreateBlockReturnKey(Data(1024).FillWithZeroes());
+    {
+        auto block = blockStore.load(key).value();
+        uint8_t value = 5;
+        block->write(&value, 0, 1);
+    }
+    blockStore.flush({key});
+    EXPECT_EQ(5, *static_cast<const uint8_t*>(baseBlockStore->load(key).value()->data()));
+    EXPECT_NE(boost::none, blockStore.load(key));
+}
+
+TEST_F(CachingBlockStoreTest, DefaultReadCacheHoldsMoreBlocksThanShards) {
+    // The default read cache config has an unlimited number of entries. Splitting that into shards once overflowed
+    // and left room for only one block per shard.
+    const uint32_t numBlocks = 10 * CachingBlockStore::DEFAULT_READ_CACHE_CONFIG.numShards;
+    std::vector<blockstore::Key> keys;
+    for (uint32_t i = 0; i < numBlocks; ++i) {
+        keys.push_back(CreateBlockReturnKey(Data(1024)));
+    }
+    blockStore.flush();
+    for (const auto &key : keys) {
+        EXPECT_NE(boost::none, blockStore.load(key));
+    }
+    EXPECT_EQ(numBlocks, blockStore.statistics().numHits);
+    EXPECT_EQ(0u, blockStore.statistics().numMisses);
+}
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+#include "blockstore/implementations/caching/cache/Cache.h"
+#include <chrono>
+#include <future>
+#include <iostream>
+
+using namespace blockstore::caching;
+using std::vector;
+using std::future;
+
+// Microbenchmark for lock contention in the Cache. It is disabled by default because it takes a while and doesn't
+// check anything. Run it with --gtest_also_run_disabled_tests --gtest_filter=*CacheTest_ContentionBenchmark*
+class CacheTest_ContentionBenchmark: public ::testing::Test {
+public:
+  static constexpr unsigned int NUM_OPERATIONS_PER_THREAD = 200000;
+  static constexpr unsigned int MAX_ENTRIES = 1000;
+
+  // Returns the number of push/pop pairs per second
+  double measure(uint32_t numShards, unsigned int numThreads) {
+    Cache<int, int> cache(CacheConfig(MAX_ENTRIES, numShards));
+    auto start = std::chrono::steady_clock::now();
+    vector<future<void>> threads;
+    for (unsigned int thread = 0; thread < numThreads; ++thread) {
+      threads.push_back(std::async(std::launch::async, [&cache, thread] {
+        for (unsigned int i = 0; i < NUM_OPERATIONS_PER_THREAD; ++i) {
+          int key = thread * NUM_OPERATIONS_PER_THREAD + i;
+          cache.push(key, i);
+          cache.pop(key);
+        }
+      }));
+    }
+    for (auto &thread : threads) {
+      thread.wait();
+    }
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    return numThreads * NUM_OPERATIONS_PER_THREAD / duration.count();
+  }
+};
+
+TEST_F(CacheTest_ContentionBenchmark, DISABLED_PushAndPop) {
+  for (unsigned int numThreads : {1u, 2u, 4u, 8u, 16u, 32u}) {
+    for (uint32_t numShards : {1u, 4u, 16u, 64u}) {
+      std::cout << "threads: " << numThreads << ", shards: " << numShards << ", push+pop per second: " << measure(numShards, numThreads) << std::endl;
+    }
+  }
+}
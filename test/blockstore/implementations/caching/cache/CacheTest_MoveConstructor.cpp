@@ -13,10 +13,10 @@ using ::testing::Test;
 //Test that Cache uses a move constructor for Value if possible
 class CacheTest_MoveConstructor: public Test {
 public:
-  CacheTest_MoveConstructor(): cache(make_unique_ref<Cache<MinimalKeyType, CopyableMovableValueType, 100>>()) {
+  CacheTest_MoveConstructor(): cache(make_unique_ref<Cache<MinimalKeyType, CopyableMovableValueType>>(CacheConfig(100, 1))) {
     CopyableMovableValueType::numCopyConstructorCalled = 0;
   }
-  unique_ref<Cache<MinimalKeyType, CopyableMovableValueType, 100>> cache;
+  unique_ref<Cache<MinimalKeyType, CopyableMovableValueType>> cache;
 };
 
 TEST_F(CacheTest_MoveConstructor, MoveIntoCache) {
@@ -36,11 +36,11 @@ private:
 
 class CacheTest_RaceCondition: public ::testing::Test {
 public:
-    CacheTest_RaceCondition(): cache(), destructorStarted(), destructorFinished(false) {}
+    CacheTest_RaceCondition(): cache(CacheConfig(MAX_ENTRIES, 1)), destructorStarted(), destructorFinished(false) {}
 
     static constexpr unsigned int MAX_ENTRIES = 100;
 
-    Cache<int, unique_ptr<ObjectWithLongDestructor>, MAX_ENTRIES> cache;
+    Cache<int, unique_ptr<ObjectWithLongDestructor>> cache;
     ConditionBarrier destructorStarted;
     bool destructorFinished;
 
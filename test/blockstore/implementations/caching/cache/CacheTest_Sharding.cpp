@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include "blockstore/implementations/caching/cache/Cache.h"
+#include "testutils/MinimalKeyType.h"
+#include "testutils/MinimalValueType.h"
+#include <limits>
+
+using namespace blockstore::caching;
+using ::testing::Test;
+using boost::none;
+
+// MinimalKeyType hashes to its value, so key k is stored in shard (k % numShards).
+class CacheTest_Sharding: public Test {
+public:
+  using ShardedCache = Cache<MinimalKeyType, MinimalValueType>;
+
+  // Each value counts as many bytes as its value
+  static uint64_t sizeOf(const MinimalValueType &value) {
+    return value.value();
+  }
+
+  void push(ShardedCache *cache, int key, int value) {
+    cache->push(MinimalKeyType::create(key), MinimalValueType::create(value));
+  }
+
+  boost::optional<int> pop(ShardedCache *cache, int key) {
+    auto entry = cache->pop(MinimalKeyType::create(key));
+    if (entry == none) {
+      return none;
+    }
+    return entry->value();
+  }
+};
+
+TEST_F(CacheTest_Sharding, PushAndPopWithManyShards) {
+  ShardedCache cache(CacheConfig(100, 8));
+  for (int i = 0; i < 50; ++i) {
+    push(&cache, i, 2*i);
+  }
+  EXPECT_EQ(50u, cache.size());
+  for (int i = 0; i < 50; ++i) {
+    EXPECT_EQ(2*i, pop(&cache, i).value());
+  }
+  EXPECT_EQ(0u, cache.size());
+}
+
+TEST_F(CacheTest_Sharding, FullShardEvictsOnlyFromItself) {
+  ShardedCache cache(CacheConfig(4, 2)); // two entries per shard
+  push(&cache, 1, 10); // shard 1
+  push(&cache, 0, 0); // shard 0
+  push(&cache, 2, 20); // shard 0
+  push(&cache, 4, 40); // shard 0, evicts key 0
+  EXPECT_EQ(none, pop(&cache, 0));
+  EXPECT_EQ(20, pop(&cache, 2).value());
+  EXPECT_EQ(40, pop(&cache, 4).value());
+  EXPECT_EQ(10, pop(&cache, 1).value());
+}
+
+TEST_F(CacheTest_Sharding, ByteBudgetEvictsOldestEntries) {
+  ShardedCache cache(CacheConfig(100, 1, 10), &sizeOf);
+  push(&cache, 1, 4);
+  push(&cache, 2, 4);
+  EXPECT_EQ(8u, cache.sizeBytes());
+  push(&cache, 3, 4); // exceeds the budget, evicts key 1
+  EXPECT_EQ(8u, cache.sizeBytes());
+  EXPECT_EQ(none, pop(&cache, 1));
+  EXPECT_EQ(4, pop(&cache, 2).value());
+  EXPECT_EQ(4, pop(&cache, 3).value());
+  EXPECT_EQ(0u, cache.sizeBytes());
+}
+
+TEST_F(CacheTest_Sharding, ByteBudgetIsPerShard) {
+  ShardedCache cache(CacheConfig(100, 2, 20), &sizeOf); // 10 bytes per shard
+  push(&cache, 0, 6); // shard 0
+  push(&cache, 1, 6); // shard 1
+  push(&cache, 3, 3); // shard 1, still fits
+  EXPECT_EQ(6, pop(&cache, 0).value());
+  EXPECT_EQ(6, pop(&cache, 1).value());
+  EXPECT_EQ(3, pop(&cache, 3).value());
+}
+
+TEST_F(CacheTest_Sharding, EntryLargerThanByteBudgetIsCachedAlone) {
+  ShardedCache cache(CacheConfig(100, 1, 10), &sizeOf);
+  push(&cache, 1, 4);
+  push(&cache, 2, 50);
+  EXPECT_EQ(1u, cache.size());
+  EXPECT_EQ(none, pop(&cache, 1));
+  EXPECT_EQ(50, pop(&cache, 2).value());
+}
+
+TEST_F(CacheTest_Sharding, PerShardBudgetIsRoundedUp) {
+  EXPECT_EQ(3u, CacheConfig(5, 2).maxEntriesPerShard());
+  EXPECT_EQ(1u, CacheConfig(0, 4).maxEntriesPerShard());
+  EXPECT_EQ(5u, CacheConfig(100, 2, 10).maxBytesPerShard());
+  EXPECT_EQ(CacheConfig::UNLIMITED_BYTES, CacheConfig(100, 2).maxBytesPerShard());
+}
+
+TEST_F(CacheTest_Sharding, PerShardBudgetDoesntOverflowForUnlimitedEntries) {
+  CacheConfig config(std::numeric_limits<uint32_t>::max(), 16);
+  EXPECT_EQ(std::numeric_limits<uint32_t>::max() / 16 + 1, config.maxEntriesPerShard());
+}
@@ -0,0 +1,198 @@
+#include <gtest/gtest.h>
+#include "blockstore/implementations/caching/cache/TwoQueueCache.h"
+#include "testutils/MinimalKeyType.h"
+#include "testutils/MinimalValueType.h"
+#include <chrono>
+#include <limits>
+#include <thread>
+
+using namespace blockstore::caching;
+using ::testing::Test;
+using boost::none;
+
+// MinimalKeyType hashes to its value, so key k is stored in shard (k % numShards).
+class TwoQueueCacheTest: public Test {
+public:
+  using TestCache = TwoQueueCache<MinimalKeyType, MinimalValueType>;
+
+  // Each value counts as many bytes as its value
+  static uint64_t sizeOf(const MinimalValueType &value) {
+    return value.value();
+  }
+
+  void push(TestCache *cache, int key, int value) {
+    cache->push(MinimalKeyType::create(key), MinimalValueType::create(value));
+  }
+
+  boost::optional<int> pop(TestCache *cache, int key) {
+    auto entry = cache->pop(MinimalKeyType::create(key));
+    if (entry == none) {
+      return none;
+    }
+    return entry->value();
+  }
+
+  // Pops an entry and pushes it back, like CachingBlockStore does when a block is loaded and released again.
+  void use(TestCache *cache, int key) {
+    int value = pop(cache, key).value();
+    push(cache, key, value);
+  }
+};
+
+TEST_F(TwoQueueCacheTest, PushAndPop) {
+  TestCache cache(CacheConfig(100, 4), &sizeOf);
+  for (int i = 0; i < 50; ++i) {
+    push(&cache, i, i+1);
+  }
+  EXPECT_EQ(50u, cache.size());
+  for (int i = 0; i < 50; ++i) {
+    EXPECT_EQ(i+1, pop(&cache, i).value());
+  }
+  EXPECT_EQ(0u, cache.size());
+  EXPECT_EQ(0u, cache.sizeBytes());
+}
+
+TEST_F(TwoQueueCacheTest, PopNonexisting) {
+  TestCache cache(CacheConfig(100, 1), &sizeOf);
+  push(&cache, 1, 1);
+  EXPECT_EQ(none, pop(&cache, 2));
+}
+
+TEST_F(TwoQueueCacheTest, EntriesArentPurgedByAge) {
+  TestCache cache(CacheConfig(100, 1), &sizeOf);
+  push(&cache, 1, 1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+  EXPECT_EQ(1, pop(&cache, 1).value());
+}
+
+TEST_F(TwoQueueCacheTest, ByteBudgetEvictsOldestEntries) {
+  TestCache cache(CacheConfig(100, 1, 10), &sizeOf);
+  push(&cache, 1, 4);
+  push(&cache, 2, 4);
+  EXPECT_EQ(8u, cache.sizeBytes());
+  push(&cache, 3, 4); // exceeds the budget, evicts key 1
+  EXPECT_EQ(8u, cache.sizeBytes());
+  EXPECT_EQ(none, pop(&cache, 1));
+  EXPECT_EQ(4, pop(&cache, 2).value());
+  EXPECT_EQ(4, pop(&cache, 3).value());
+}
+
+TEST_F(TwoQueueCacheTest, ByteBudgetIsPerShard) {
+  TestCache cache(CacheConfig(100, 2, 20), &sizeOf); // 10 bytes per shard
+  push(&cache, 0, 6); // shard 0
+  push(&cache, 1, 6); // shard 1
+  push(&cache, 3, 3); // shard 1, still fits
+  EXPECT_EQ(6, pop(&cache, 0).value());
+  EXPECT_EQ(6, pop(&cache, 1).value());
+  EXPECT_EQ(3, pop(&cache, 3).value());
+}
+
+TEST_F(TwoQueueCacheTest, UnlimitedNumberOfEntries) {
+  // The entry limit is only given by the byte budget. This must not overflow when it is split into shards.
+  TestCache cache(CacheConfig(std::numeric_limits<uint32_t>::max(), 4, 1000), &sizeOf);
+  for (int i = 0; i < 50; ++i) {
+    push(&cache, i, 1);
+  }
+  EXPECT_EQ(50u, cache.size());
+}
+
+TEST_F(TwoQueueCacheTest, EntryLargerThanByteBudgetIsCachedAlone) {
+  TestCache cache(CacheConfig(100, 1, 10), &sizeOf);
+  push(&cache, 1, 4);
+  push(&cache, 2, 50);
+  EXPECT_EQ(1u, cache.size());
+  EXPECT_EQ(none, pop(&cache, 1));
+  EXPECT_EQ(50, pop(&cache, 2).value());
+}
+
+TEST_F(TwoQueueCacheTest, EntryReusedAfterEvictionIsProtectedFromScan) {
+  TestCache cache(CacheConfig(8, 1), &sizeOf);
+  for (int i = 0; i < 9; ++i) {
+    push(&cache, i, 1);
+  }
+  // Key 0 was evicted, but is still remembered. Using it again makes it a frequently used entry.
+  EXPECT_EQ(none, pop(&cache, 0));
+  push(&cache, 0, 1);
+
+  // A long scan only evicts entries that were used once
+  for (int i = 100; i < 200; ++i) {
+    push(&cache, i, 1);
+  }
+  EXPECT_EQ(1, pop(&cache, 0).value());
+  EXPECT_EQ(none, pop(&cache, 1));
+  EXPECT_EQ(1, pop(&cache, 199).value());
+}
+
+TEST_F(TwoQueueCacheTest, FrequentlyUsedEntriesStayFrequentlyUsedWhenPoppedAndPushedBack) {
+  TestCache cache(CacheConfig(8, 1), &sizeOf);
+  for (int i = 0; i < 9; ++i) {
+    push(&cache, i, 1);
+  }
+  EXPECT_EQ(none, pop(&cache, 0));
+  push(&cache, 0, 1);
+  for (int i = 100; i < 200; ++i) {
+    push(&cache, i, 1);
+    use(&cache, 0);
+  }
+  EXPECT_EQ(1, pop(&cache, 0).value());
+}
+
+TEST_F(TwoQueueCacheTest, RepeatedlyUsingNewEntryDoesntProtectItFromScan) {
+  // Entries are popped and pushed back each time they're used, e.g. for each read on a block.
+  // That alone doesn't make them frequently used entries.
+  TestCache cache(CacheConfig(8, 1), &sizeOf);
+  push(&cache, 0, 1);
+  for (int i = 0; i < 10; ++i) {
+    use(&cache, 0);
+  }
+  for (int i = 100; i < 200; ++i) {
+    push(&cache, i, 1);
+  }
+  EXPECT_EQ(none, pop(&cache, 0));
+}
+
+TEST_F(TwoQueueCacheTest, FrequentlyUsedEntriesAreEvictedInLruOrder) {
+  TestCache cache(CacheConfig(8, 1), &sizeOf);
+  for (int i = 0; i < 16; ++i) {
+    push(&cache, i, 1);
+  }
+  // Keys 0-7 were evicted. Using keys 0-5 again makes them frequently used entries and evicts keys 8-13.
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(none, pop(&cache, i));
+    push(&cache, i, 1);
+  }
+  use(&cache, 0);
+  // Key 1 is now the least recently used entry, and there are only few recently added entries left.
+  EXPECT_EQ(none, pop(&cache, 6));
+  push(&cache, 6, 1);
+  EXPECT_EQ(none, pop(&cache, 1));
+  for (int i : {0, 2, 3, 4, 5, 6, 14, 15}) {
+    EXPECT_EQ(1, pop(&cache, i).value());
+  }
+}
+
+TEST_F(TwoQueueCacheTest, Statistics) {
+  TestCache cache(CacheConfig(100, 2, 10), &sizeOf);
+  push(&cache, 0, 6);
+  push(&cache, 2, 6); // evicts key 0
+  push(&cache, 1, 3);
+  pop(&cache, 0);
+  pop(&cache, 2);
+  pop(&cache, 5);
+  CacheStatistics statistics = cache.statistics();
+  EXPECT_EQ(1u, statistics.numHits);
+  EXPECT_EQ(2u, statistics.numMisses);
+  EXPECT_EQ(1u, statistics.numEvictions);
+  EXPECT_EQ(3u, statistics.numBytes);
+}
+
+TEST_F(TwoQueueCacheTest, DestructsAllValues) {
+  int instancesBefore = MinimalValueType::instances;
+  {
+    TestCache cache(CacheConfig(4, 2), &sizeOf);
+    for (int i = 0; i < 20; ++i) {
+      push(&cache, i, 1);
+    }
+  }
+  EXPECT_EQ(instancesBefore, MinimalValueType::instances);
+}
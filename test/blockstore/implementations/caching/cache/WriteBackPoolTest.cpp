@@ -0,0 +1,264 @@
+#include <gtest/gtest.h>
+#include "blockstore/implementations/caching/cache/WriteBackPool.h"
+#include "testutils/MinimalKeyType.h"
+#include "testutils/MinimalValueType.h"
+#include <cpp-utils/lock/ConditionBarrier.h>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace blockstore::caching;
+using ::testing::Test;
+using cpputils::ConditionBarrier;
+using boost::none;
+using std::mutex;
+using std::unique_lock;
+using std::condition_variable;
+using std::chrono::seconds;
+
+class WriteBackPoolTest: public Test {
+public:
+  using Pool = WriteBackPool<MinimalKeyType, MinimalValueType>;
+
+  WriteBackPoolTest(): writtenBack(), writtenBackMutex() {}
+
+  std::function<void (MinimalValueType &)> recordWriteBack() {
+    return [this] (MinimalValueType &value) {
+      unique_lock<mutex> lock(writtenBackMutex);
+      writtenBack.insert(value.value());
+    };
+  }
+
+  void push(Pool *pool, int key, int value) {
+    pool->push(MinimalKeyType::create(key), MinimalValueType::create(value));
+  }
+
+  boost::optional<int> pop(Pool *pool, int key) {
+    auto entry = pool->pop(MinimalKeyType::create(key));
+    if (entry == none) {
+      return none;
+    }
+    return entry->value();
+  }
+
+  std::set<int> writtenBack;
+  mutex writtenBackMutex;
+};
+
+TEST_F(WriteBackPoolTest, FlushWritesBackAllValues) {
+  Pool pool(4, 100, recordWriteBack());
+  for (int i = 0; i < 50; ++i) {
+    push(&pool, i, i);
+  }
+  pool.flush();
+  EXPECT_EQ(0u, pool.size());
+  EXPECT_EQ(50u, writtenBack.size());
+}
+
+TEST_F(WriteBackPoolTest, DestructorWritesBackAllValues) {
+  {
+    Pool pool(4, 100, recordWriteBack());
+    for (int i = 0; i < 50; ++i) {
+      push(&pool, i, i);
+    }
+  }
+  EXPECT_EQ(50u, writtenBack.size());
+}
+
+TEST_F(WriteBackPoolTest, DoesntLeakValues) {
+  int instancesBefore = MinimalValueType::instances;
+  {
+    Pool pool(4, 100, recordWriteBack());
+    for (int i = 0; i < 50; ++i) {
+      push(&pool, i, i);
+    }
+  }
+  EXPECT_EQ(instancesBefore, MinimalValueType::instances);
+}
+
+TEST_F(WriteBackPoolTest, WritesBackInParallel) {
+  constexpr unsigned int NUM_THREADS = 4;
+  mutex runningMutex;
+  condition_variable runningCv;
+  unsigned int numRunning = 0;
+  unsigned int maxRunning = 0;
+  // Each write back blocks until NUM_THREADS write backs are running at the same time (or a timeout passes)
+  Pool pool(NUM_THREADS, 100, [&] (MinimalValueType &) {
+    unique_lock<mutex> lock(runningMutex);
+    ++numRunning;
+    maxRunning = std::max(maxRunning, numRunning);
+    runningCv.notify_all();
+    runningCv.wait_for(lock, seconds(5), [&] {return maxRunning >= NUM_THREADS;});
+    --numRunning;
+  });
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned int i = 0; i < NUM_THREADS; ++i) {
+    push(&pool, i, i);
+  }
+  pool.flush();
+  EXPECT_EQ(NUM_THREADS, maxRunning);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, seconds(5));
+}
+
+TEST_F(WriteBackPoolTest, PopReturnsQueuedValueWithoutWritingItBack) {
+  ConditionBarrier firstWriteBackStarted;
+  ConditionBarrier finishFirstWriteBack;
+  Pool pool(1, 100, [&] (MinimalValueType &value) {
+    if (value.value() == 0) {
+      firstWriteBackStarted.release();
+      finishFirstWriteBack.wait();
+    }
+    unique_lock<mutex> lock(writtenBackMutex);
+    writtenBack.insert(value.value());
+  });
+  push(&pool, 0, 0);
+  firstWriteBackStarted.wait();
+  // The only thread is busy, so this value stays queued
+  push(&pool, 1, 10);
+  EXPECT_EQ(10, pop(&pool, 1).value());
+  finishFirstWriteBack.release();
+  pool.flush();
+  EXPECT_EQ(std::set<int>({0}), writtenBack);
+}
+
+TEST_F(WriteBackPoolTest, PopWaitsWhileValueIsWrittenBack) {
+  ConditionBarrier writeBackStarted;
+  ConditionBarrier finishWriteBack;
+  Pool pool(1, 100, [&] (MinimalValueType &value) {
+    writeBackStarted.release();
+    finishWriteBack.wait();
+    unique_lock<mutex> lock(writtenBackMutex);
+    writtenBack.insert(value.value());
+  });
+  push(&pool, 0, 0);
+  writeBackStarted.wait();
+  auto popped = std::async(std::launch::async, [&] {return pop(&pool, 0);});
+  EXPECT_EQ(std::future_status::timeout, popped.wait_for(std::chrono::milliseconds(100)));
+  finishWriteBack.release();
+  EXPECT_EQ(none, popped.get());
+  EXPECT_EQ(1u, writtenBack.size());
+}
+
+TEST_F(WriteBackPoolTest, PushBlocksWhileQueueIsFull) {
+  ConditionBarrier writeBackStarted;
+  ConditionBarrier finishWriteBack;
+  Pool pool(1, 2, [&] (MinimalValueType &) {
+    writeBackStarted.release();
+    finishWriteBack.wait();
+  });
+  push(&pool, 0, 0);
+  writeBackStarted.wait();
+  push(&pool, 1, 1);
+  push(&pool, 2, 2);
+  auto pushed = std::async(std::launch::async, [&] {push(&pool, 3, 3);});
+  EXPECT_EQ(std::future_status::timeout, pushed.wait_for(std::chrono::milliseconds(100)));
+  finishWriteBack.release();
+  pushed.get();
+  pool.flush();
+}
+
+TEST_F(WriteBackPoolTest, WriteBackThatThrowsDoesntStopThePool) {
+  Pool pool(1, 100, [this] (MinimalValueType &value) {
+    if (value.value() == 0) {
+      throw std::runtime_error("Test error");
+    }
+    unique_lock<mutex> lock(writtenBackMutex);
+    writtenBack.insert(value.value());
+  });
+  push(&pool, 0, 0);
+  push(&pool, 1, 1);
+  EXPECT_THROW(pool.flush(), std::runtime_error);
+  // Value 0 is retried again and again, but doesn't block value 1
+  while (pool.size() > 1) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(std::set<int>({1}), writtenBack);
+  EXPECT_EQ(0, pop(&pool, 0).value());
+}
+
+TEST_F(WriteBackPoolTest, FailedWriteBackIsRetried) {
+  int numFailures = 0;
+  Pool pool(1, 100, [&] (MinimalValueType &value) {
+    unique_lock<mutex> lock(writtenBackMutex);
+    if (numFailures < 3) {
+      ++numFailures;
+      throw std::runtime_error("Test error");
+    }
+    writtenBack.insert(value.value());
+  });
+  push(&pool, 0, 0);
+  int numFlushErrors = 0;
+  while (true) {
+    try {
+      pool.flush();
+      break;
+    } catch (const std::runtime_error &) {
+      ++numFlushErrors;
+    }
+  }
+  EXPECT_LE(1, numFlushErrors);
+  EXPECT_EQ(std::set<int>({0}), writtenBack);
+  EXPECT_NO_THROW(pool.throwIfWriteBackFailed());
+}
+
+TEST_F(WriteBackPoolTest, FailedWriteBackIsRetriedAfterDelay) {
+  std::vector<std::chrono::steady_clock::time_point> attempts;
+  Pool pool(4, 100, [&] (MinimalValueType &value) {
+    unique_lock<mutex> lock(writtenBackMutex);
+    attempts.push_back(std::chrono::steady_clock::now());
+    if (attempts.size() < 2) {
+      throw std::runtime_error("Test error");
+    }
+    writtenBack.insert(value.value());
+  });
+  push(&pool, 0, 0);
+  while (true) {
+    try {
+      pool.flush();
+      break;
+    } catch (const std::runtime_error &) {
+    }
+  }
+  ASSERT_EQ(2u, attempts.size());
+  // Other threads must not pick up the value before the delay is over
+  EXPECT_LE(std::chrono::milliseconds(Pool::MIN_RETRY_DELAY_MSEC), attempts[1] - attempts[0]);
+}
+
+TEST_F(WriteBackPoolTest, FailedValueCanBePopped) {
+  Pool pool(1, 100, [] (MinimalValueType &) {
+    throw std::runtime_error("Test error");
+  });
+  push(&pool, 0, 10);
+  EXPECT_THROW(pool.flush(), std::runtime_error);
+  EXPECT_THROW(pool.throwIfWriteBackFailed(), std::runtime_error);
+  EXPECT_EQ(10, pop(&pool, 0).value());
+  EXPECT_NO_THROW(pool.throwIfWriteBackFailed());
+  EXPECT_NO_THROW(pool.flush());
+}
+
+TEST_F(WriteBackPoolTest, WrittenBackValuesArePassedOn) {
+  std::set<int> passedOn;
+  Pool pool(2, 100, recordWriteBack(), [&] (MinimalValueType value) {
+    unique_lock<mutex> lock(writtenBackMutex);
+    passedOn.insert(value.value());
+  });
+  push(&pool, 0, 0);
+  push(&pool, 1, 1);
+  pool.flush();
+  EXPECT_EQ(std::set<int>({0, 1}), passedOn);
+}
+
+TEST_F(WriteBackPoolTest, DestructorDoesntThrowIfWriteBackFails) {
+  int instancesBefore = MinimalValueType::instances;
+  {
+    Pool pool(1, 100, [] (MinimalValueType &) {
+      throw std::runtime_error("Test error");
+    });
+    push(&pool, 0, 0);
+  }
+  EXPECT_EQ(instancesBefore, MinimalValueType::instances);
+}
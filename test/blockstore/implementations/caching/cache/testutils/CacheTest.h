@@ -13,14 +13,15 @@
 // Furthermore, the class checks that there are no memory leaks left after destructing the QueueMap (by counting leftover instances of Keys/Values).
 class CacheTest: public ::testing::Test {
 public:
-  CacheTest(): _cache() {}
+  // Use only one shard, so entries are evicted in exactly the order they were pushed
+  CacheTest(): _cache(blockstore::caching::CacheConfig(MAX_ENTRIES, 1)) {}
 
   void push(int key, int value);
   boost::optional<int> pop(int key);
 
   static constexpr unsigned int MAX_ENTRIES = 100;
 
-  using Cache = blockstore::caching::Cache<MinimalKeyType, MinimalValueType, MAX_ENTRIES>;
+  using Cache = blockstore::caching::Cache<MinimalKeyType, MinimalValueType>;
 
 private:
   Cache _cache;
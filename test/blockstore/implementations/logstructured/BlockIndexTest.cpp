@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include "blockstore/implementations/logstructured/BlockIndex.h"
+#include <cpp-utils/tempfile/TempDir.h>
+#include <boost/filesystem.hpp>
+#include <string>
+
+using ::testing::Test;
+
+using cpputils::TempDir;
+using blockstore::Key;
+using boost::none;
+
+using namespace blockstore::logstructured;
+
+namespace bf = boost::filesystem;
+
+class BlockIndexTest: public Test {
+public:
+  BlockIndexTest(): baseDir(), index(baseDir.path()) {}
+
+  TempDir baseDir;
+  BlockIndex index;
+
+  const Key key1 = Key::FromString("1491BB4932A389EE14BC7090AC772972");
+  const Key key2 = Key::FromString("272EE5517627CFA147A971A8E6E747E0");
+  const Key key3 = Key::FromString("E10FA9C17E4D4C7F9C6A6D8B5E6F1A2B");
+
+  // Simulates a crash by copying the files while the index is still in use
+  void copyFilesTo(const bf::path &target) {
+    for (auto entry = bf::directory_iterator(baseDir.path()); entry != bf::directory_iterator(); ++entry) {
+      bf::copy_file(entry->path(), target / entry->path().filename());
+    }
+  }
+
+  static unsigned int numJournals(const bf::path &dir) {
+    unsigned int result = 0;
+    for (auto entry = bf::directory_iterator(dir); entry != bf::directory_iterator(); ++entry) {
+      if (entry->path().filename().native().find("index.journal.") == 0) {
+        ++result;
+      }
+    }
+    return result;
+  }
+};
+
+TEST_F(BlockIndexTest, ReplaysJournalAfterCrash) {
+  index.put(key1, BlockLocation{0, 10, 100});
+  index.put(key2, BlockLocation{0, 200, 100});
+  index.remove(key1);
+  TempDir crashedDir;
+  copyFilesTo(crashedDir.path());
+  BlockIndex recovered(crashedDir.path());
+  EXPECT_EQ(1u, recovered.size());
+  EXPECT_EQ(none, recovered.find(key1));
+  EXPECT_EQ(BlockLocation({0, 200, 100}), recovered.find(key2).value());
+}
+
+TEST_F(BlockIndexTest, KeepsChangesMadeWhileCheckpointIsWritten) {
+  index.put(key1, BlockLocation{0, 10, 100});
+  index.put(key2, BlockLocation{0, 200, 100});
+  auto snapshot = index.startCheckpoint();
+  index.remove(key1);
+  index.put(key3, BlockLocation{1, 10, 100});
+  // Crash before the checkpoint reached the disk
+  TempDir crashedDir;
+  copyFilesTo(crashedDir.path());
+  BlockIndex recovered(crashedDir.path());
+  EXPECT_EQ(2u, recovered.size());
+  EXPECT_EQ(none, recovered.find(key1));
+  EXPECT_EQ(BlockLocation({0, 200, 100}), recovered.find(key2).value());
+  EXPECT_EQ(BlockLocation({1, 10, 100}), recovered.find(key3).value());
+}
+
+TEST_F(BlockIndexTest, KeepsChangesMadeAfterCheckpointWasWritten) {
+  index.put(key1, BlockLocation{0, 10, 100});
+  auto snapshot = index.startCheckpoint();
+  index.put(key2, BlockLocation{0, 200, 100});
+  index.writeCheckpoint(snapshot);
+  index.put(key3, BlockLocation{1, 10, 100});
+  TempDir crashedDir;
+  copyFilesTo(crashedDir.path());
+  BlockIndex recovered(crashedDir.path());
+  EXPECT_EQ(3u, recovered.size());
+  EXPECT_EQ(BlockLocation({0, 10, 100}), recovered.find(key1).value());
+  EXPECT_EQ(BlockLocation({0, 200, 100}), recovered.find(key2).value());
+  EXPECT_EQ(BlockLocation({1, 10, 100}), recovered.find(key3).value());
+}
+
+TEST_F(BlockIndexTest, WritingCheckpointDeletesOldJournal) {
+  index.put(key1, BlockLocation{0, 10, 100});
+  auto snapshot = index.startCheckpoint();
+  EXPECT_EQ(2u, numJournals(baseDir.path()));
+  index.writeCheckpoint(snapshot);
+  EXPECT_EQ(1u, numJournals(baseDir.path()));
+}
+
+TEST_F(BlockIndexTest, LoadingDeletesJournalsOfUnfinishedCheckpoints) {
+  index.put(key1, BlockLocation{0, 10, 100});
+  auto snapshot = index.startCheckpoint();
+  index.put(key2, BlockLocation{0, 200, 100});
+  TempDir crashedDir;
+  copyFilesTo(crashedDir.path());
+  {
+    BlockIndex recovered(crashedDir.path());
+  }
+  BlockIndex reloaded(crashedDir.path());
+  EXPECT_EQ(2u, reloaded.size());
+  EXPECT_EQ(1u, numJournals(crashedDir.path()));
+}
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include "blockstore/implementations/logstructured/LogStructuredBlockStore.h"
+#include "blockstore/implementations/ondisk/OnDiskBlockStore.h"
+#include <cpp-utils/tempfile/TempDir.h>
+#include <cpp-utils/data/DataFixture.h>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+using cpputils::TempDir;
+using cpputils::Data;
+using cpputils::DataFixture;
+using cpputils::unique_ref;
+using cpputils::make_unique_ref;
+using blockstore::BlockStore;
+using blockstore::Key;
+using blockstore::ondisk::OnDiskBlockStore;
+using blockstore::logstructured::LogStructuredBlockStore;
+using std::vector;
+using std::function;
+
+// Microbenchmark comparing the file-per-block OnDiskBlockStore with the LogStructuredBlockStore. It is disabled by
+// default because it takes a while and doesn't check anything.
+// Run it with --gtest_also_run_disabled_tests --gtest_filter=*LogStructuredBlockStoreTest_Benchmark*
+class LogStructuredBlockStoreTest_Benchmark: public ::testing::Test {
+public:
+  static constexpr unsigned int NUM_BLOCKS = 5000;
+  static constexpr unsigned int NUM_RANDOM_WRITES = 20000;
+
+  // Returns the number of operations per second
+  double measure(unsigned int numOperations, function<void()> operations) {
+    auto start = std::chrono::steady_clock::now();
+    operations();
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    return numOperations / duration.count();
+  }
+
+  vector<Key> createBlocks(BlockStore *blockStore, size_t blockSize) {
+    vector<Key> keys;
+    keys.reserve(NUM_BLOCKS);
+    Data data = DataFixture::generate(blockSize);
+    for (unsigned int i = 0; i < NUM_BLOCKS; ++i) {
+      keys.push_back(blockStore->create(data)->key());
+    }
+    return keys;
+  }
+
+  void randomSmallWrites(BlockStore *blockStore, const vector<Key> &keys) {
+    std::mt19937 random(0);
+    std::uniform_int_distribution<size_t> chooseBlock(0, keys.size() - 1);
+    Data data = DataFixture::generate(16);
+    for (unsigned int i = 0; i < NUM_RANDOM_WRITES; ++i) {
+      auto block = blockStore->load(keys[chooseBlock(random)]).value();
+      block->write(data.data(), random() % (block->size() - data.size()), data.size());
+    }
+  }
+
+  void sequentialReads(BlockStore *blockStore, const vector<Key> &keys) {
+    for (const Key &key : keys) {
+      blockStore->load(key).value();
+    }
+  }
+
+  void run(const std::string &name, function<unique_ref<BlockStore>(const TempDir &)> createBlockStore) {
+    for (size_t blockSize : {4u * 1024u, 32u * 1024u}) {
+      TempDir dir;
+      auto blockStore = createBlockStore(dir);
+      vector<Key> keys;
+      double createsPerSecond = measure(NUM_BLOCKS, [&] {keys = createBlocks(blockStore.get(), blockSize);});
+      double writesPerSecond = measure(NUM_RANDOM_WRITES, [&] {randomSmallWrites(blockStore.get(), keys);});
+      double readsPerSecond = measure(NUM_BLOCKS, [&] {sequentialReads(blockStore.get(), keys);});
+      std::cout << name << ", block size " << blockSize << ": "
+                << "sequential create " << createsPerSecond * blockSize / 1024 / 1024 << " MB/s, "
+                << "random small writes " << writesPerSecond << " per second, "
+                << "sequential read " << readsPerSecond * blockSize / 1024 / 1024 << " MB/s" << std::endl;
+    }
+  }
+};
+
+TEST_F(LogStructuredBlockStoreTest_Benchmark, DISABLED_CompareWithOnDiskBlockStore) {
+  run("file-per-block", [] (const TempDir &dir) -> unique_ref<BlockStore> {
+    return make_unique_ref<OnDiskBlockStore>(dir.path());
+  });
+  run("log-structured", [] (const TempDir &dir) -> unique_ref<BlockStore> {
+    return make_unique_ref<LogStructuredBlockStore>(dir.path());
+  });
+}
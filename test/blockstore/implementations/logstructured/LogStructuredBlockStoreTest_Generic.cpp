@@ -0,0 +1,41 @@
+#include "blockstore/implementations/logstructured/LogStructuredBlockStore.h"
+#include "../../testutils/BlockStoreTest.h"
+#include "../../testutils/BlockStoreWithRandomKeysTest.h"
+#include <gtest/gtest.h>
+
+#include <cpp-utils/tempfile/TempDir.h>
+
+
+using blockstore::BlockStore;
+using blockstore::BlockStoreWithRandomKeys;
+using blockstore::logstructured::LogStructuredBlockStore;
+
+using cpputils::TempDir;
+using cpputils::unique_ref;
+using cpputils::make_unique_ref;
+
+class LogStructuredBlockStoreTestFixture: public BlockStoreTestFixture {
+public:
+  LogStructuredBlockStoreTestFixture(): tempdir() {}
+
+  unique_ref<BlockStore> createBlockStore() override {
+    return make_unique_ref<LogStructuredBlockStore>(tempdir.path());
+  }
+private:
+  TempDir tempdir;
+};
+
+INSTANTIATE_TYPED_TEST_CASE_P(LogStructured, BlockStoreTest, LogStructuredBlockStoreTestFixture);
+
+class LogStructuredBlockStoreWithRandomKeysTestFixture: public BlockStoreWithRandomKeysTestFixture {
+public:
+  LogStructuredBlockStoreWithRandomKeysTestFixture(): tempdir() {}
+  
+  unique_ref<BlockStoreWithRandomKeys> createBlockStore() override {
+    return make_unique_ref<LogStructuredBlockStore>(tempdir.path());
+  }
+private:
+  TempDir tempdir;
+};
+
+INSTANTIATE_TYPED_TEST_CASE_P(LogStructured, BlockStoreWithRandomKeysTest, LogStructuredBlockStoreWithRandomKeysTestFixture);
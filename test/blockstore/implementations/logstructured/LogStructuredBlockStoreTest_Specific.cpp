@@ -0,0 +1,218 @@
+#include <gtest/gtest.h>
+#include "blockstore/implementations/logstructured/LogStructuredBlockStore.h"
+#include <cpp-utils/tempfile/TempDir.h>
+#include <cpp-utils/data/DataFixture.h>
+#include <boost/filesystem.hpp>
+#include <string>
+
+using ::testing::Test;
+
+using cpputils::TempDir;
+using cpputils::Data;
+using cpputils::DataFixture;
+using cpputils::make_unique_ref;
+using cpputils::unique_ref;
+using blockstore::Key;
+using std::vector;
+
+using namespace blockstore::logstructured;
+
+namespace bf = boost::filesystem;
+
+class LogStructuredBlockStoreTest: public Test {
+public:
+  static constexpr uint64_t SEGMENT_SIZE = 16 * 1024;
+  static constexpr size_t BLOCK_SIZE = 1000;
+
+  LogStructuredBlockStoreTest(): baseDir(), blockStore(make_unique_ref<LogStructuredBlockStore>(baseDir.path(), SEGMENT_SIZE)) {}
+
+  TempDir baseDir;
+  unique_ref<LogStructuredBlockStore> blockStore;
+
+  void reopen() {
+    cpputils::destruct(std::move(blockStore));
+    blockStore = make_unique_ref<LogStructuredBlockStore>(baseDir.path(), SEGMENT_SIZE);
+  }
+
+  vector<Key> createBlocks(unsigned int count) {
+    vector<Key> keys;
+    for (unsigned int i = 0; i < count; ++i) {
+      keys.push_back(blockStore->create(DataFixture::generate(BLOCK_SIZE, i))->key());
+    }
+    return keys;
+  }
+
+  void overwriteBlock(const Key &key, long long int seed) {
+    auto block = blockStore->load(key).value();
+    Data data = DataFixture::generate(BLOCK_SIZE, seed);
+    block->write(data.data(), 0, data.size());
+  }
+
+  void expectBlockData(const Key &key, long long int seed) {
+    expectBlockData(blockStore.get(), key, seed);
+  }
+
+  void expectBlockData(LogStructuredBlockStore *store, const Key &key, long long int seed) {
+    auto block = store->load(key).value();
+    Data expected = DataFixture::generate(BLOCK_SIZE, seed);
+    EXPECT_EQ(expected.size(), block->size());
+    EXPECT_EQ(0, std::memcmp(expected.data(), block->data(), expected.size()));
+  }
+
+  // Simulates a crash by copying the files while the store is still running, i.e. without a checkpoint of the index
+  void copyFilesTo(const bf::path &target) {
+    for (auto entry = bf::directory_iterator(baseDir.path()); entry != bf::directory_iterator(); ++entry) {
+      bf::copy_file(entry->path(), target / entry->path().filename());
+    }
+  }
+
+  static bf::path lastSegment(const bf::path &dir) {
+    bf::path result;
+    for (auto entry = bf::directory_iterator(dir); entry != bf::directory_iterator(); ++entry) {
+      std::string filename = entry->path().filename().native();
+      if (filename.find("segment-") == 0 && (result.empty() || std::stoul(filename.substr(8)) > std::stoul(result.filename().native().substr(8)))) {
+        result = entry->path();
+      }
+    }
+    return result;
+  }
+
+  void compactAll() {
+    while (blockStore->compactNextSegment()) {
+    }
+  }
+};
+
+constexpr uint64_t LogStructuredBlockStoreTest::SEGMENT_SIZE;
+constexpr size_t LogStructuredBlockStoreTest::BLOCK_SIZE;
+
+TEST_F(LogStructuredBlockStoreTest, StoresManyBlocksPerSegment) {
+  createBlocks(10);
+  EXPECT_EQ(1u, blockStore->numSegments());
+}
+
+TEST_F(LogStructuredBlockStoreTest, StartsNewSegmentWhenSegmentIsFull) {
+  createBlocks(50);
+  EXPECT_LE(3u, blockStore->numSegments());
+}
+
+TEST_F(LogStructuredBlockStoreTest, NumBlocks) {
+  auto keys = createBlocks(50);
+  EXPECT_EQ(50u, blockStore->numBlocks());
+  blockStore->remove(blockStore->load(keys[3]).value());
+  EXPECT_EQ(49u, blockStore->numBlocks());
+}
+
+TEST_F(LogStructuredBlockStoreTest, BlocksArePersistedAcrossReopen) {
+  auto keys = createBlocks(50);
+  overwriteBlock(keys[5], 100);
+  blockStore->remove(blockStore->load(keys[6]).value());
+  reopen();
+  EXPECT_EQ(49u, blockStore->numBlocks());
+  expectBlockData(keys[4], 4);
+  expectBlockData(keys[5], 100);
+  EXPECT_EQ(boost::none, blockStore->load(keys[6]));
+}
+
+TEST_F(LogStructuredBlockStoreTest, ReplaysJournalAfterCrash) {
+  auto keys = createBlocks(10);
+  overwriteBlock(keys[2], 100);
+  blockStore->remove(blockStore->load(keys[3]).value());
+  TempDir crashedDir;
+  copyFilesTo(crashedDir.path());
+  LogStructuredBlockStore recovered(crashedDir.path(), SEGMENT_SIZE);
+  EXPECT_EQ(9u, recovered.numBlocks());
+  expectBlockData(&recovered, keys[1], 1);
+  expectBlockData(&recovered, keys[2], 100);
+  EXPECT_EQ(boost::none, recovered.load(keys[3]));
+}
+
+TEST_F(LogStructuredBlockStoreTest, DropsBlocksWhoseRecordWasCutOffInACrash) {
+  auto keys = createBlocks(5);
+  TempDir crashedDir;
+  copyFilesTo(crashedDir.path());
+  // The index entry of the last block reached the disk, but its data didn't completely
+  bf::path segment = lastSegment(crashedDir.path());
+  bf::resize_file(segment, bf::file_size(segment) - BLOCK_SIZE / 2);
+  LogStructuredBlockStore recovered(crashedDir.path(), SEGMENT_SIZE);
+  EXPECT_EQ(4u, recovered.numBlocks());
+  EXPECT_EQ(boost::none, recovered.load(keys[4]));
+  expectBlockData(&recovered, keys[3], 3);
+  // Writing after the recovery works
+  Key newKey = recovered.create(DataFixture::generate(BLOCK_SIZE, 10))->key();
+  expectBlockData(&recovered, newKey, 10);
+}
+
+TEST_F(LogStructuredBlockStoreTest, DropsBlocksWithCorruptedRecordAfterCrash) {
+  auto keys = createBlocks(5);
+  TempDir crashedDir;
+  copyFilesTo(crashedDir.path());
+  // The record of the last block has the right length, but its data is garbage
+  bf::path segment = lastSegment(crashedDir.path());
+  Data content = Data::LoadFromFile(segment).value();
+  static_cast<uint8_t*>(content.data())[content.size() - 1] ^= 0xff;
+  content.StoreToFile(segment);
+  LogStructuredBlockStore recovered(crashedDir.path(), SEGMENT_SIZE);
+  EXPECT_EQ(4u, recovered.numBlocks());
+  EXPECT_EQ(boost::none, recovered.load(keys[4]));
+  expectBlockData(&recovered, keys[3], 3);
+}
+
+TEST_F(LogStructuredBlockStoreTest, CompactionRemovesSegmentsWithOverwrittenBlocks) {
+  auto keys = createBlocks(10);
+  for (long long int round = 1; round <= 10; ++round) {
+    for (unsigned int i = 0; i < keys.size(); ++i) {
+      overwriteBlock(keys[i], round * 100 + i);
+    }
+  }
+  compactAll();
+  // 10 blocks fit into one segment, so after compaction, there should only be a few segments left
+  EXPECT_GE(3u, blockStore->numSegments());
+  for (unsigned int i = 0; i < keys.size(); ++i) {
+    expectBlockData(keys[i], 1000 + i);
+  }
+  reopen();
+  for (unsigned int i = 0; i < keys.size(); ++i) {
+    expectBlockData(keys[i], 1000 + i);
+  }
+}
+
+TEST_F(LogStructuredBlockStoreTest, CompactionRemovesSegmentsWithRemovedBlocks) {
+  auto keys = createBlocks(100);
+  for (const auto &key : keys) {
+    blockStore->remove(blockStore->load(key).value());
+  }
+  compactAll();
+  EXPECT_EQ(1u, blockStore->numSegments());
+  EXPECT_EQ(0u, blockStore->numBlocks());
+}
+
+TEST_F(LogStructuredBlockStoreTest, BlockLargerThanSegment) {
+  Data data = DataFixture::generate(2 * SEGMENT_SIZE);
+  Key key = blockStore->create(data)->key();
+  reopen();
+  auto block = blockStore->load(key).value();
+  EXPECT_EQ(0, std::memcmp(data.data(), block->data(), data.size()));
+}
+
+TEST_F(LogStructuredBlockStoreTest, RefusesSegmentsWithoutIndex) {
+  createBlocks(10);
+  cpputils::destruct(std::move(blockStore));
+  bf::remove(baseDir.path() / "index");
+  EXPECT_ANY_THROW(
+    LogStructuredBlockStore(baseDir.path(), SEGMENT_SIZE)
+  );
+}
+
+TEST_F(LogStructuredBlockStoreTest, PhysicalBlockSize_zerophysical) {
+  EXPECT_EQ(0u, blockStore->blockSizeFromPhysicalBlockSize(0));
+}
+
+TEST_F(LogStructuredBlockStoreTest, PhysicalBlockSize_boundaries) {
+  EXPECT_EQ(0u, blockStore->blockSizeFromPhysicalBlockSize(Segment::RECORD_HEADER_SIZE));
+  EXPECT_EQ(1u, blockStore->blockSizeFromPhysicalBlockSize(Segment::RECORD_HEADER_SIZE + 1));
+}
+
+TEST_F(LogStructuredBlockStoreTest, PhysicalBlockSize_positive) {
+  EXPECT_EQ(10*1024u, blockStore->blockSizeFromPhysicalBlockSize(10*1024u + Segment::RECORD_HEADER_SIZE));
+}
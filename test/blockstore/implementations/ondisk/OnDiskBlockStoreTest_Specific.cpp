@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include "blockstore/implementations/ondisk/OnDiskBlockStore.h"
+#include "blockstore/implementations/ondisk/OnDiskBlock.h"
 #include <cpp-utils/tempfile/TempDir.h>
 
 using ::testing::Test;
@@ -24,6 +25,14 @@ public:
     return blockStore.create(initData)->key();
   }
 
+  static boost::filesystem::path getBlockFilepath(const boost::filesystem::path &rootdir, const Key &key) {
+    return rootdir / key.ToString().substr(0,3) / key.ToString().substr(3);
+  }
+
+  boost::filesystem::path getBlockFilepath(const Key &key) {
+    return getBlockFilepath(baseDir.path(), key);
+  }
+
   uint64_t getPhysicalBlockSize(const Key &key) {
     ifstream stream((baseDir.path() / key.ToString().substr(0,3) / key.ToString().substr(3)).c_str());
     stream.seekg(0, stream.end);
@@ -65,3 +74,98 @@ TEST_F(OnDiskBlockStoreTest, NumBlocksIsCorrectAfterAddingTwoBlocksWithSameKeyPr
   EXPECT_NE(boost::none, blockStore.tryCreate(key2, cpputils::Data(0)));
   EXPECT_EQ(2u, blockStore.numBlocks());
 }
+
+TEST_F(OnDiskBlockStoreTest, NumBlocksIsStoredOnUnmount) {
+  TempDir dir;
+  {
+    OnDiskBlockStore store(dir.path());
+    store.create(Data(10));
+    store.create(Data(10));
+    EXPECT_FALSE(boost::filesystem::exists(dir.path() / OnDiskBlockStore::BLOCK_COUNT_FILENAME));
+  }
+  EXPECT_TRUE(boost::filesystem::exists(dir.path() / OnDiskBlockStore::BLOCK_COUNT_FILENAME));
+  OnDiskBlockStore store(dir.path());
+  // The count is removed while mounted, so a crash doesn't leave an outdated count behind
+  EXPECT_FALSE(boost::filesystem::exists(dir.path() / OnDiskBlockStore::BLOCK_COUNT_FILENAME));
+  EXPECT_EQ(2u, store.numBlocks());
+}
+
+TEST_F(OnDiskBlockStoreTest, NumBlocksIsCountedIfNotStored) {
+  TempDir dir;
+  {
+    OnDiskBlockStore store(dir.path());
+    store.create(Data(10));
+    store.create(Data(10));
+  }
+  boost::filesystem::remove(dir.path() / OnDiskBlockStore::BLOCK_COUNT_FILENAME);
+  OnDiskBlockStore store(dir.path());
+  EXPECT_EQ(2u, store.numBlocks());
+  store.create(Data(10));
+  EXPECT_EQ(3u, store.numBlocks());
+}
+
+TEST_F(OnDiskBlockStoreTest, NumBlocksIsCountedIfStoredCountIsInvalid) {
+  TempDir dir;
+  {
+    OnDiskBlockStore store(dir.path());
+    store.create(Data(10));
+  }
+  Data invalid(7);
+  std::memcpy(invalid.data(), "invalid", 7);
+  invalid.StoreToFile(dir.path() / OnDiskBlockStore::BLOCK_COUNT_FILENAME);
+  OnDiskBlockStore store(dir.path());
+  EXPECT_EQ(1u, store.numBlocks());
+}
+
+TEST_F(OnDiskBlockStoreTest, InPlaceWritesDontLeaveTemporaryFiles) {
+  auto block = blockStore.create(Data(10));
+  Key key = block->key();
+  block->write("abc", 0, 3);
+  block->flush();
+  cpputils::destruct(std::move(block));
+  EXPECT_FALSE(boost::filesystem::exists(getBlockFilepath(key).native() + OnDiskBlock::TMP_FILE_SUFFIX));
+}
+
+TEST_F(OnDiskBlockStoreTest, AtomicWritesAreStoredOnFlush) {
+  TempDir dir;
+  OnDiskBlockStore store(dir.path(), OnDiskBlockStore::WriteMode::ATOMIC);
+  Key key = store.create(Data(10).FillWithZeroes())->key();
+  {
+    auto block = store.load(key).value();
+    block->write("abc", 0, 3);
+  }
+  EXPECT_TRUE(boost::filesystem::exists(getBlockFilepath(dir.path(), key).native() + OnDiskBlock::TMP_FILE_SUFFIX));
+  // Loading before the flush returns the new version
+  EXPECT_EQ(0, std::memcmp("abc", store.load(key).value()->data(), 3));
+  store.flush({key});
+  EXPECT_FALSE(boost::filesystem::exists(getBlockFilepath(dir.path(), key).native() + OnDiskBlock::TMP_FILE_SUFFIX));
+  EXPECT_EQ(0, std::memcmp("abc", store.load(key).value()->data(), 3));
+}
+
+TEST_F(OnDiskBlockStoreTest, AtomicWritesAreStoredOnUnmount) {
+  TempDir dir;
+  Key key = Key::Null();
+  {
+    OnDiskBlockStore store(dir.path(), OnDiskBlockStore::WriteMode::ATOMIC);
+    key = store.create(Data(10).FillWithZeroes())->key();
+    store.load(key).value()->write("abc", 0, 3);
+  }
+  EXPECT_FALSE(boost::filesystem::exists(getBlockFilepath(dir.path(), key).native() + OnDiskBlock::TMP_FILE_SUFFIX));
+  OnDiskBlockStore store(dir.path());
+  EXPECT_EQ(0, std::memcmp("abc", store.load(key).value()->data(), 3));
+}
+
+TEST_F(OnDiskBlockStoreTest, TemporaryFilesOfUnfinishedWritesAreRemovedAfterCrash) {
+  TempDir dir;
+  Key key = Key::Null();
+  {
+    OnDiskBlockStore store(dir.path());
+    key = store.create(Data(10).FillWithZeroes())->key();
+  }
+  // Simulate a crash while a block was written
+  Data(10).FillWithZeroes().StoreToFile(getBlockFilepath(dir.path(), key).native() + OnDiskBlock::TMP_FILE_SUFFIX);
+  boost::filesystem::remove(dir.path() / OnDiskBlockStore::BLOCK_COUNT_FILENAME);
+  OnDiskBlockStore store(dir.path());
+  EXPECT_FALSE(boost::filesystem::exists(getBlockFilepath(dir.path(), key).native() + OnDiskBlock::TMP_FILE_SUFFIX));
+  EXPECT_EQ(1u, store.numBlocks());
+}
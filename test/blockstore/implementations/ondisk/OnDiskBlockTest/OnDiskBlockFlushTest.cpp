@@ -1,4 +1,5 @@
 #include "blockstore/implementations/ondisk/OnDiskBlock.h"
+#include "blockstore/implementations/ondisk/PendingRenames.h"
 #include <cpp-utils/data/DataFixture.h>
 #include <gtest/gtest.h>
 
@@ -115,3 +116,58 @@ TEST_P(OnDiskBlockFlushTest, AfterLoad_FlushesWhenDestructed) {
   }
   EXPECT_STORED_FILE_DATA_CORRECT();
 }
+
+TEST_P(OnDiskBlockFlushTest, AfterShrinking_FlushingWritesCorrectData) {
+  {
+    auto block = OnDiskBlock::CreateOnDisk(dir.path(), key, DataFixture::generate(GetParam() + 1024, 1)).value();
+  }
+  {
+    auto block = OnDiskBlock::LoadFromDisk(dir.path(), key).value();
+    block->resize(randomData.size());
+    WriteDataToBlock(block);
+  }
+  EXPECT_STORED_FILE_DATA_CORRECT();
+}
+
+TEST_P(OnDiskBlockFlushTest, WithAtomicWrites_SyncingWritesCorrectData) {
+  PendingRenames pendingRenames(dir.path());
+  {
+    OnDiskBlock::CreateOnDisk(dir.path(), key, DataFixture::generate(GetParam(), 1), &pendingRenames).value();
+  }
+  {
+    auto block = OnDiskBlock::LoadFromDisk(dir.path(), key, &pendingRenames).value();
+    WriteDataToBlock(block);
+  }
+  EXPECT_TRUE(bf::exists(file.path().native() + OnDiskBlock::TMP_FILE_SUFFIX));
+  pendingRenames.sync();
+  EXPECT_STORED_FILE_DATA_CORRECT();
+  EXPECT_FALSE(bf::exists(file.path().native() + OnDiskBlock::TMP_FILE_SUFFIX));
+}
+
+TEST_P(OnDiskBlockFlushTest, WithAtomicWrites_LoadingBeforeSyncReturnsNewData) {
+  PendingRenames pendingRenames(dir.path());
+  {
+    OnDiskBlock::CreateOnDisk(dir.path(), key, DataFixture::generate(GetParam(), 1), &pendingRenames).value();
+  }
+  {
+    auto block = OnDiskBlock::LoadFromDisk(dir.path(), key, &pendingRenames).value();
+    WriteDataToBlock(block);
+  }
+  auto block = OnDiskBlock::LoadFromDisk(dir.path(), key, &pendingRenames).value();
+  EXPECT_BLOCK_DATA_CORRECT(block);
+}
+
+TEST_P(OnDiskBlockFlushTest, WithAtomicWrites_RemovingBeforeSyncRemovesTemporaryFile) {
+  PendingRenames pendingRenames(dir.path());
+  {
+    OnDiskBlock::CreateOnDisk(dir.path(), key, DataFixture::generate(GetParam(), 1), &pendingRenames).value();
+  }
+  {
+    auto block = OnDiskBlock::LoadFromDisk(dir.path(), key, &pendingRenames).value();
+    WriteDataToBlock(block);
+  }
+  EXPECT_TRUE(OnDiskBlock::RemoveFromDisk(dir.path(), key, &pendingRenames));
+  pendingRenames.sync();
+  EXPECT_FALSE(bf::exists(file.path()));
+  EXPECT_FALSE(bf::exists(file.path().native() + OnDiskBlock::TMP_FILE_SUFFIX));
+}
@@ -0,0 +1,71 @@
+#include "blockstore/implementations/ondisk/OnDiskBlock.h"
+#include "blockstore/implementations/ondisk/PendingRenames.h"
+#include <cpp-utils/data/DataFixture.h>
+#include <cpp-utils/tempfile/TempDir.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using cpputils::Data;
+using cpputils::DataFixture;
+using cpputils::TempDir;
+using std::vector;
+
+using namespace blockstore;
+using namespace blockstore::ondisk;
+
+// Microbenchmark for the latency of storing and loading a single block. It is disabled by default because it takes a
+// while and doesn't check anything. Run it with --gtest_also_run_disabled_tests --gtest_filter=*OnDiskBlockLatencyBenchmark*
+class OnDiskBlockLatencyBenchmark: public ::testing::Test {
+public:
+  static constexpr unsigned int NUM_BLOCKS = 2000;
+
+  vector<Key> createKeys() {
+    vector<Key> keys;
+    for (unsigned int i = 0; i < NUM_BLOCKS; ++i) {
+      keys.push_back(Key::FromBinary(DataFixture::generate(Key::BINARY_LENGTH, i).data()));
+    }
+    return keys;
+  }
+
+  // Returns the average number of microseconds per block
+  template<class Operation>
+  double measure(const vector<Key> &keys, Operation operation) {
+    auto start = std::chrono::steady_clock::now();
+    for (const Key &key : keys) {
+      operation(key);
+    }
+    std::chrono::duration<double, std::micro> duration = std::chrono::steady_clock::now() - start;
+    return duration.count() / keys.size();
+  }
+};
+
+TEST_F(OnDiskBlockLatencyBenchmark, DISABLED_CreateLoadAndStore) {
+  for (bool atomicWrites : {false, true}) {
+  for (size_t blockSize : {4u * 1024u, 32u * 1024u, 1024u * 1024u}) {
+    TempDir dir;
+    PendingRenames pendingRenames(dir.path());
+    PendingRenames *atomic = atomicWrites ? &pendingRenames : nullptr;
+    Data data = DataFixture::generate(blockSize);
+    vector<Key> keys = createKeys();
+    double create = measure(keys, [&] (const Key &key) {
+      OnDiskBlock::CreateOnDisk(dir.path(), key, data.copy(), atomic).value();
+    });
+    double load = measure(keys, [&] (const Key &key) {
+      OnDiskBlock::LoadFromDisk(dir.path(), key).value();
+    });
+    double store = measure(keys, [&] (const Key &key) {
+      auto block = OnDiskBlock::LoadFromDisk(dir.path(), key, atomic).value();
+      block->write(data.data(), 0, 1);
+      block->flush();
+    });
+    // With atomic writes, the blocks are only synced and renamed in batches, so this is part of the cost of storing them
+    auto syncStart = std::chrono::steady_clock::now();
+    pendingRenames.sync();
+    std::chrono::duration<double, std::micro> sync = std::chrono::steady_clock::now() - syncStart;
+    store += sync.count() / keys.size();
+    std::cout << (atomicWrites ? "atomic writes" : "in-place writes") << ", block size " << blockSize << ": create " << create << "us, load " << load << "us, load+store " << store << "us" << std::endl;
+  }
+  }
+}
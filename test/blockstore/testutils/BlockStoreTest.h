@@ -124,6 +124,39 @@ TYPED_TEST_P(BlockStoreTest, CanRemoveModifiedBlock) {
     EXPECT_EQ(0u, blockStore->numBlocks());
 }
 
+TYPED_TEST_P(BlockStoreTest, BlockIsNotLoadableAfterDeletingByKey) {
+  auto blockStore = this->fixture.createBlockStore();
+  auto blockkey = blockStore->create(cpputils::Data(1024))->key();
+  EXPECT_TRUE(blockStore->remove(blockkey));
+  EXPECT_EQ(boost::none, blockStore->load(blockkey));
+}
+
+TYPED_TEST_P(BlockStoreTest, NumBlocksIsCorrectAfterRemovingABlockByKey) {
+  auto blockStore = this->fixture.createBlockStore();
+  auto blockkey = blockStore->create(cpputils::Data(1))->key();
+  blockStore->create(cpputils::Data(1));
+  EXPECT_TRUE(blockStore->remove(blockkey));
+  EXPECT_EQ(1u, blockStore->numBlocks());
+}
+
+TYPED_TEST_P(BlockStoreTest, CanRemoveModifiedBlockByKey) {
+  auto blockStore = this->fixture.createBlockStore();
+  auto block = blockStore->create(cpputils::Data(5));
+  block->write("data", 0, 4);
+  auto blockkey = block->key();
+  cpputils::destruct(std::move(block));
+  EXPECT_TRUE(blockStore->remove(blockkey));
+  EXPECT_EQ(0u, blockStore->numBlocks());
+}
+
+TYPED_TEST_P(BlockStoreTest, RemovingNonexistingBlockByKey) {
+  auto blockStore = this->fixture.createBlockStore();
+  auto blockkey = blockStore->create(cpputils::Data(1))->key();
+  EXPECT_TRUE(blockStore->remove(blockkey));
+  EXPECT_FALSE(blockStore->remove(blockkey));
+  EXPECT_EQ(0u, blockStore->numBlocks());
+}
+
 TYPED_TEST_P(BlockStoreTest, Resize_Larger_FromZero) {
   auto blockStore = this->fixture.createBlockStore();
   auto block = blockStore->create(cpputils::Data(0));
@@ -210,7 +243,13 @@ REGISTER_TYPED_TEST_CASE_P(BlockStoreTest,
     WriteAndReadImmediately,
     WriteAndReadAfterLoading,
     OverwriteAndRead,
+    WriteInPlaceAndReadImmediately,
+    WriteInPlaceAndReadAfterLoading,
     CanRemoveModifiedBlock,
+    BlockIsNotLoadableAfterDeletingByKey,
+    NumBlocksIsCorrectAfterRemovingABlockByKey,
+    CanRemoveModifiedBlockByKey,
+    RemovingNonexistingBlockByKey,
     Resize_Larger_FromZero,
     Resize_Larger_FromZero_BlockIsStillUsable,
     Resize_Larger,
@@ -43,6 +43,26 @@ public:
     EXPECT_DATA_READS_AS_OUTSIDE_OF(backgroundData, *block, testData.offset, testData.count);
   }
 
+  void TestWriteInPlaceAndReadImmediately() {
+    auto block = blockStore->create(cpputils::Data(testData.blocksize).FillWithZeroes());
+    WriteForegroundDataInPlace(block.get());
+
+    EXPECT_DATA_READS_AS(foregroundData, *block, testData.offset, testData.count);
+    EXPECT_DATA_IS_ZEROES_OUTSIDE_OF(*block, testData.offset, testData.count);
+  }
+
+  void TestWriteInPlaceAndReadAfterLoading() {
+    blockstore::Key key = blockStore->create(cpputils::Data(testData.blocksize).FillWithZeroes())->key();
+    {
+      auto block = blockStore->load(key).value();
+      WriteForegroundDataInPlace(block.get());
+    }
+
+    auto loaded_block = blockStore->load(key).value();
+    EXPECT_DATA_READS_AS(foregroundData, *loaded_block, testData.offset, testData.count);
+    EXPECT_DATA_IS_ZEROES_OUTSIDE_OF(*loaded_block, testData.offset, testData.count);
+  }
+
 private:
   cpputils::unique_ref<blockstore::BlockStore> blockStore;
   DataRange testData;
@@ -56,6 +76,15 @@ private:
     return newblock->key();
   }
 
+  void WriteForegroundDataInPlace(blockstore::Block *block) {
+    uint32_t numCalls = 0;
+    block->writeInPlace(testData.offset, testData.count, [this, &numCalls] (void *target) {
+      std::memcpy(target, foregroundData.data(), testData.count);
+      ++numCalls;
+    });
+    EXPECT_EQ(1u, numCalls);
+  }
+
   void EXPECT_DATA_READS_AS(const cpputils::Data &expected, const blockstore::Block &block, off_t offset, size_t count) {
     cpputils::Data read(count);
     std::memcpy(read.data(), (uint8_t*)block.data() + offset, count);
@@ -103,5 +132,7 @@ inline std::vector<DataRange> DATA_RANGES() {
 TYPED_TEST_P_FOR_ALL_DATA_RANGES(WriteAndReadImmediately);
 TYPED_TEST_P_FOR_ALL_DATA_RANGES(WriteAndReadAfterLoading);
 TYPED_TEST_P_FOR_ALL_DATA_RANGES(OverwriteAndRead);
+TYPED_TEST_P_FOR_ALL_DATA_RANGES(WriteInPlaceAndReadImmediately);
+TYPED_TEST_P_FOR_ALL_DATA_RANGES(WriteInPlaceAndReadAfterLoading);
 
 #endif
@@ -42,6 +42,12 @@ public:
   void ExpectDoesntDecrypt(const Data &ciphertext) {
     auto decrypted = Cipher::decrypt((CryptoPP::byte*)ciphertext.data(), ciphertext.size(), this->encKey);
     EXPECT_FALSE(decrypted);
+    if (ciphertext.size() >= Cipher::ciphertextSize(0)) {
+      Data plaintext(Cipher::plaintextSize(ciphertext.size()));
+      EXPECT_FALSE(Cipher::decrypt((CryptoPP::byte*)ciphertext.data(), ciphertext.size(), (CryptoPP::byte*)plaintext.data(), this->encKey));
+    } else {
+      EXPECT_FALSE(Cipher::decrypt((CryptoPP::byte*)ciphertext.data(), ciphertext.size(), nullptr, this->encKey));
+    }
   }
 
   Data Encrypt(const Data &plaintext) {
@@ -124,6 +130,43 @@ TYPED_TEST_P(CipherTest, TryDecryptDataThatIsMuchTooSmall_1) {
   this->ExpectDoesntDecrypt(tooSmallCiphertext);
 }
 
+TYPED_TEST_P(CipherTest, EncryptIntoBufferWithReservedHeader) {
+  constexpr unsigned int HEADER_SIZE = 3;
+  for (auto size: SIZES) {
+    Data plaintext = this->CreateData(size);
+    Data buffer(HEADER_SIZE + TypeParam::ciphertextSize(size));
+    std::memset(buffer.data(), 0xAB, HEADER_SIZE);
+    TypeParam::encrypt((CryptoPP::byte*)plaintext.data(), plaintext.size(), (CryptoPP::byte*)buffer.dataOffset(HEADER_SIZE), this->encKey);
+    for (unsigned int i = 0; i < HEADER_SIZE; ++i) {
+      EXPECT_EQ(0xAB, ((CryptoPP::byte*)buffer.data())[i]);
+    }
+    Data decrypted = TypeParam::decrypt((CryptoPP::byte*)buffer.dataOffset(HEADER_SIZE), buffer.size() - HEADER_SIZE, this->encKey).value();
+    EXPECT_EQ(plaintext, decrypted);
+  }
+}
+
+TYPED_TEST_P(CipherTest, DecryptIntoBuffer) {
+  for (auto size: SIZES) {
+    Data plaintext = this->CreateData(size);
+    Data ciphertext = this->Encrypt(plaintext);
+    Data decrypted(size);
+    EXPECT_TRUE(TypeParam::decrypt((CryptoPP::byte*)ciphertext.data(), ciphertext.size(), (CryptoPP::byte*)decrypted.data(), this->encKey));
+    EXPECT_EQ(plaintext, decrypted);
+  }
+}
+
+TYPED_TEST_P(CipherTest, EncryptAndDecryptWithAlternatingKeys) {
+  // Ciphers may cache the key setup per thread, this checks that switching keys works
+  auto encKey2 = this->createKeyFixture(1);
+  Data plaintext = this->CreateData(1024);
+  Data ciphertext1 = TypeParam::encrypt((CryptoPP::byte*)plaintext.data(), plaintext.size(), this->encKey);
+  Data ciphertext2 = TypeParam::encrypt((CryptoPP::byte*)plaintext.data(), plaintext.size(), encKey2);
+  Data ciphertext3 = TypeParam::encrypt((CryptoPP::byte*)plaintext.data(), plaintext.size(), this->encKey);
+  EXPECT_EQ(plaintext, TypeParam::decrypt((CryptoPP::byte*)ciphertext2.data(), ciphertext2.size(), encKey2).value());
+  EXPECT_EQ(plaintext, TypeParam::decrypt((CryptoPP::byte*)ciphertext1.data(), ciphertext1.size(), this->encKey).value());
+  EXPECT_EQ(plaintext, TypeParam::decrypt((CryptoPP::byte*)ciphertext3.data(), ciphertext3.size(), this->encKey).value());
+}
+
 REGISTER_TYPED_TEST_CASE_P(CipherTest,
     Size,
     EncryptThenDecrypt_Zeroes,
@@ -133,7 +176,10 @@ REGISTER_TYPED_TEST_CASE_P(CipherTest,
     EncryptedSize,
     TryDecryptDataThatIsTooSmall,
     TryDecryptDataThatIsMuchTooSmall_0,
-    TryDecryptDataThatIsMuchTooSmall_1
+    TryDecryptDataThatIsMuchTooSmall_1,
+    EncryptIntoBufferWithReservedHeader,
+    DecryptIntoBuffer,
+    EncryptAndDecryptWithAlternatingKeys
 );
 
 template<class Cipher>
@@ -257,6 +303,11 @@ INSTANTIATE_TYPED_TEST_CASE_P(Mars128_CFB, CipherTest, Mars128_CFB); //CFB mode
 INSTANTIATE_TYPED_TEST_CASE_P(Mars128_GCM, CipherTest, Mars128_GCM);
 INSTANTIATE_TYPED_TEST_CASE_P(Mars128_GCM, AuthenticatedCipherTest, Mars128_GCM);
 
+#if CRYPTOPP_VERSION >= 810
+INSTANTIATE_TYPED_TEST_CASE_P(XChaCha20Poly1305, CipherTest, XChaCha20Poly1305);
+INSTANTIATE_TYPED_TEST_CASE_P(XChaCha20Poly1305, AuthenticatedCipherTest, XChaCha20Poly1305);
+#endif
+
 
 // Test cipher names
 TEST(CipherNameTest, TestCipherNames) {
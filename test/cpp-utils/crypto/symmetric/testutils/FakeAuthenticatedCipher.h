@@ -50,19 +50,22 @@ namespace cpputils {
 
         static Data encrypt(const CryptoPP::byte *plaintext, unsigned int plaintextSize, const EncryptionKey &encKey) {
           Data result(ciphertextSize(plaintextSize));
+          encrypt(plaintext, plaintextSize, (CryptoPP::byte *) result.data(), encKey);
+          return result;
+        }
 
+        static void encrypt(const CryptoPP::byte *plaintext, unsigned int plaintextSize, CryptoPP::byte *ciphertext,
+                            const EncryptionKey &encKey) {
           //Add a random IV
           uint8_t iv = rand();
-          std::memcpy(result.data(), &iv, 1);
+          std::memcpy(ciphertext, &iv, 1);
 
           //Use caesar chiffre on plaintext
-          _caesar((CryptoPP::byte *) result.data() + 1, plaintext, plaintextSize, encKey.value + iv);
+          _caesar(ciphertext + 1, plaintext, plaintextSize, encKey.value + iv);
 
           //Add parity information
-          int32_t parity = _parity((CryptoPP::byte *) result.data(), plaintextSize + 1);
-          std::memcpy((CryptoPP::byte *) result.data() + plaintextSize + 1, &parity, 4);
-
-          return result;
+          int32_t parity = _parity(ciphertext, plaintextSize + 1);
+          std::memcpy(ciphertext + plaintextSize + 1, &parity, 4);
         }
 
         static boost::optional <Data> decrypt(const CryptoPP::byte *ciphertext, unsigned int ciphertextSize,
@@ -72,18 +75,31 @@ namespace cpputils {
             return boost::none;
           }
 
+          Data result(plaintextSize(ciphertextSize));
+          if (!decrypt(ciphertext, ciphertextSize, (CryptoPP::byte *) result.data(), encKey)) {
+            return boost::none;
+          }
+          return std::move(result);
+        }
+
+        static bool decrypt(const CryptoPP::byte *ciphertext, unsigned int ciphertextSize, CryptoPP::byte *plaintext,
+                            const EncryptionKey &encKey) {
+          //We need at least 5 bytes (iv + parity)
+          if (ciphertextSize < 5) {
+            return false;
+          }
+
           //Check parity
           int32_t expectedParity = _parity(ciphertext, plaintextSize(ciphertextSize) + 1);
           int32_t actualParity = *(int32_t * )(ciphertext + plaintextSize(ciphertextSize) + 1);
           if (expectedParity != actualParity) {
-            return boost::none;
+            return false;
           }
 
           //Decrypt caesar chiffre from ciphertext
           int32_t iv = *(int32_t *) ciphertext;
-          Data result(plaintextSize(ciphertextSize));
-          _caesar((CryptoPP::byte *) result.data(), ciphertext + 1, plaintextSize(ciphertextSize), -(encKey.value + iv));
-          return std::move(result);
+          _caesar(plaintext, ciphertext + 1, plaintextSize(ciphertextSize), -(encKey.value + iv));
+          return true;
         }
 
         static constexpr const char *NAME = "FakeAuthenticatedCipher";
@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include "cpp-utils/thread/WorkQueue.h"
+#include "cpp-utils/lock/ConditionBarrier.h"
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <set>
+
+using cpputils::WorkQueue;
+using cpputils::ConditionBarrier;
+using std::mutex;
+using std::unique_lock;
+using std::condition_variable;
+using std::chrono::seconds;
+
+class WorkQueueTest: public ::testing::Test {
+public:
+    WorkQueueTest(): done(), doneMutex() {}
+
+    std::function<void (int)> recordDone() {
+        return [this] (int job) {
+            unique_lock<mutex> lock(doneMutex);
+            done.insert(job);
+        };
+    }
+
+    std::set<int> done;
+    mutex doneMutex;
+};
+
+TEST_F(WorkQueueTest, RunsAllJobs) {
+    WorkQueue<int> queue(4, recordDone());
+    for (int i = 0; i < 50; ++i) {
+        EXPECT_TRUE(queue.push(i));
+    }
+    queue.waitUntilIdle();
+    EXPECT_EQ(50u, done.size());
+}
+
+TEST_F(WorkQueueTest, WaitUntilIdleWithoutJobs) {
+    WorkQueue<int> queue(1, recordDone());
+    queue.waitUntilIdle();
+    EXPECT_EQ(0u, done.size());
+}
+
+TEST_F(WorkQueueTest, RunsJobsInParallel) {
+    constexpr unsigned int NUM_THREADS = 4;
+    mutex runningMutex;
+    condition_variable runningCv;
+    unsigned int numRunning = 0;
+    unsigned int maxRunning = 0;
+    // Each job blocks until NUM_THREADS jobs are running at the same time (or a timeout passes)
+    WorkQueue<int> queue(NUM_THREADS, [&] (int) {
+        unique_lock<mutex> lock(runningMutex);
+        ++numRunning;
+        maxRunning = std::max(maxRunning, numRunning);
+        runningCv.notify_all();
+        runningCv.wait_for(lock, seconds(5), [&] {return maxRunning >= NUM_THREADS;});
+        --numRunning;
+    });
+    for (unsigned int i = 0; i < NUM_THREADS; ++i) {
+        queue.push(i);
+    }
+    queue.waitUntilIdle();
+    EXPECT_EQ(NUM_THREADS, maxRunning);
+}
+
+TEST_F(WorkQueueTest, WaitUntilIdleWaitsForRunningJob) {
+    ConditionBarrier jobStarted;
+    ConditionBarrier finishJob;
+    WorkQueue<int> queue(1, [&] (int) {
+        jobStarted.release();
+        finishJob.wait();
+    });
+    queue.push(0);
+    jobStarted.wait();
+    auto idle = std::async(std::launch::async, [&] {queue.waitUntilIdle();});
+    EXPECT_EQ(std::future_status::timeout, idle.wait_for(std::chrono::milliseconds(100)));
+    finishJob.release();
+    idle.get();
+}
+
+TEST_F(WorkQueueTest, DropsJobsIfQueueIsFull) {
+    ConditionBarrier jobStarted;
+    ConditionBarrier finishJob;
+    WorkQueue<int> queue(1, [&] (int) {
+        jobStarted.release();
+        finishJob.wait();
+    }, 2);
+    queue.push(0);
+    jobStarted.wait();
+    EXPECT_TRUE(queue.push(1));
+    EXPECT_TRUE(queue.push(2));
+    EXPECT_FALSE(queue.push(3));
+    finishJob.release();
+    queue.waitUntilIdle();
+}
+
+TEST_F(WorkQueueTest, StopReturnsJobsThatDidntRun) {
+    ConditionBarrier jobStarted;
+    WorkQueue<int> queue(1, [&] (int) {
+        jobStarted.release();
+        // Interruptible, so stop() doesn't have to wait for it
+        boost::this_thread::sleep_for(boost::chrono::seconds(60));
+    });
+    queue.push(0);
+    jobStarted.wait();
+    queue.push(1);
+    queue.push(2);
+    EXPECT_EQ(std::deque<int>({1, 2}), queue.stop());
+}
+
+TEST_F(WorkQueueTest, JobThatThrowsDoesntStopTheThread) {
+    WorkQueue<int> queue(1, [this] (int job) {
+        if (job == 0) {
+            throw std::runtime_error("Test error");
+        }
+        unique_lock<mutex> lock(doneMutex);
+        done.insert(job);
+    });
+    queue.push(0);
+    queue.push(1);
+    queue.waitUntilIdle();
+    EXPECT_EQ(std::set<int>({1}), done);
+}
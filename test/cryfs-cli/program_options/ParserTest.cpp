@@ -54,6 +54,15 @@ TEST_F(ProgramOptionsParserTest, ShowCiphers) {
     );
 }
 
+TEST_F(ProgramOptionsParserTest, BenchmarkCiphers) {
+    vector<const char*> options = {"./myExecutable", "--benchmark-ciphers", "--blocksize", "4096"};
+    EXPECT_EXIT(
+        Parser(options.size(), options.data()).parse({"aes-256-gcm"}),
+        ::testing::ExitedWithCode(0),
+        "block size of 4096 bytes(.|\n)*aes-256-gcm"
+    );
+}
+
 TEST_F(ProgramOptionsParserTest, BaseDir_Absolute) {
     ProgramOptions options = parse({"./myExecutable", "/home/user/baseDir", "/home/user/mountDir"});
     EXPECT_EQ("/home/user/baseDir", options.baseDir());
@@ -146,6 +155,120 @@ TEST_F(ProgramOptionsParserTest, BlocksizeNotGiven) {
     EXPECT_EQ(none, options.blocksizeBytes());
 }
 
+TEST_F(ProgramOptionsParserTest, CacheSizeGiven) {
+    ProgramOptions options = parse({"./myExecutable", "/home/user/baseDir", "--cache-size", "512M", "/home/user/mountDir"});
+    EXPECT_EQ(512*1024*1024u, options.cacheSizeBytes().value());
+}
+
+TEST_F(ProgramOptionsParserTest, CacheSizeNotGiven) {
+    ProgramOptions options = parse({"./myExecutable", "/home/user/baseDir", "/home/user/mountDir"});
+    EXPECT_EQ(none, options.cacheSizeBytes());
+}
+
+TEST_F(ProgramOptionsParserTest, CacheSizeInvalid) {
+    EXPECT_EXIT(
+        parse({"./myExecutable", "/home/user/baseDir", "--cache-size", "512X", "/home/user/mountDir"}),
+        ::testing::ExitedWithCode(1),
+        "Invalid cache size: 512X"
+    );
+}
+
+TEST_F(ProgramOptionsParserTest, BlockstoreLayoutGiven) {
+    ProgramOptions options = parse({"./myExecutable", "/home/user/baseDir", "--blockstore-layout", "log-structured", "/home/user/mountDir"});
+    EXPECT_EQ("log-structured", options.blockstoreLayout().value());
+}
+
+TEST_F(ProgramOptionsParserTest, BlockstoreLayoutNotGiven) {
+    ProgramOptions options = parse({"./myExecutable", "/home/user/baseDir", "/home/user/mountDir"});
+    EXPECT_EQ(none, options.blockstoreLayout());
+}
+
+TEST_F(ProgramOptionsParserTest, BlockstoreLayoutInvalid) {
+    EXPECT_EXIT(
+        parse({"./myExecutable", "/home/user/baseDir", "--blockstore-layout", "invalid-layout", "/home/user/mountDir"}),
+        ::testing::ExitedWithCode(1),
+        "Invalid blockstore layout: invalid-layout"
+    );
+}
+
+TEST_F(ProgramOptionsParserTest, FuseLowLevelGiven) {
+    ProgramOptions options = parse({"./myExecutable", "/home/user/baseDir", "--fuse-lowlevel", "/home/user/mountDir"});
+    EXPECT_TRUE(options.fuseLowLevel());
+}
+
+TEST_F(ProgramOptionsParserTest, FuseLowLevelNotGiven) {
+    ProgramOptions options = parse({"./myExecutable", "/home/user/baseDir", "/home/user/mountDir"});
+    EXPECT_FALSE(options.fuseLowLevel());
+}
+
+TEST_F(ProgramOptionsParserTest, TimeoutsGiven) {
+    ProgramOptions options = parse({"./myExecutable", "/home/user/baseDir", "--entry-timeout", "10", "--attr-timeout", "0.5", "/home/user/mountDir"});
+    EXPECT_EQ(10, options.entryTimeoutSeconds().value());
+    EXPECT_EQ(0.5, options.attrTimeoutSeconds().value());
+}
+
+TEST_F(ProgramOptionsParserTest, TimeoutsNotGiven) {
+    ProgramOptions options = parse({"./myExecutable", "/home/user/baseDir", "/home/user/mountDir"});
+    EXPECT_EQ(none, options.entryTimeoutSeconds());
+    EXPECT_EQ(none, options.attrTimeoutSeconds());
+}
+
+TEST_F(ProgramOptionsParserTest, FuseThreadsGiven) {
+    ProgramOptions options = parse({"./myExecutable", "/home/user/baseDir", "--fuse-threads", "8", "/home/user/mountDir"});
+    EXPECT_EQ(8u, options.fuseThreads().value());
+}
+
+TEST_F(ProgramOptionsParserTest, FuseThreadsNotGiven) {
+    ProgramOptions options = parse({"./myExecutable", "/home/user/baseDir", "/home/user/mountDir"});
+    EXPECT_EQ(none, options.fuseThreads());
+}
+
+TEST_F(ProgramOptionsParserTest, FuseThreadsZero) {
+    EXPECT_EXIT(
+        parse({"./myExecutable", "/home/user/baseDir", "--fuse-threads", "0", "/home/user/mountDir"}),
+        ::testing::ExitedWithCode(1),
+        "Invalid number of FUSE threads: 0"
+    );
+}
+
+TEST_F(ProgramOptionsParserTest, AtimeGiven) {
+    ProgramOptions options = parse({"./myExecutable", "/home/user/baseDir", "--atime", "noatime", "/home/user/mountDir"});
+    EXPECT_EQ("noatime", options.atimeBehavior().value());
+}
+
+TEST_F(ProgramOptionsParserTest, AtimeNotGiven) {
+    ProgramOptions options = parse({"./myExecutable", "/home/user/baseDir", "/home/user/mountDir"});
+    EXPECT_EQ(none, options.atimeBehavior());
+}
+
+TEST_F(ProgramOptionsParserTest, AtimeInvalid) {
+    EXPECT_EXIT(
+        parse({"./myExecutable", "/home/user/baseDir", "--atime", "sometimes", "/home/user/mountDir"}),
+        ::testing::ExitedWithCode(1),
+        "Invalid atime behavior: sometimes"
+    );
+}
+
+TEST_F(ProgramOptionsParserTest, LazytimeGiven) {
+    ProgramOptions options = parse({"./myExecutable", "/home/user/baseDir", "--lazytime", "/home/user/mountDir"});
+    EXPECT_TRUE(options.lazytime());
+}
+
+TEST_F(ProgramOptionsParserTest, LazytimeNotGiven) {
+    ProgramOptions options = parse({"./myExecutable", "/home/user/baseDir", "/home/user/mountDir"});
+    EXPECT_FALSE(options.lazytime());
+}
+
+TEST_F(ProgramOptionsParserTest, AtomicWritesGiven) {
+    ProgramOptions options = parse({"./myExecutable", "/home/user/baseDir", "--atomic-writes", "/home/user/mountDir"});
+    EXPECT_TRUE(options.atomicWrites());
+}
+
+TEST_F(ProgramOptionsParserTest, AtomicWritesNotGiven) {
+    ProgramOptions options = parse({"./myExecutable", "/home/user/baseDir", "/home/user/mountDir"});
+    EXPECT_FALSE(options.atomicWrites());
+}
+
 TEST_F(ProgramOptionsParserTest, FuseOptionGiven) {
     ProgramOptions options = parse({"./myExecutable", "/home/user/baseDir", "/home/user/mountDir", "--", "-f"});
     EXPECT_EQ("/home/user/baseDir", options.baseDir());
@@ -23,83 +23,183 @@ namespace boost {
 class ProgramOptionsTest: public ProgramOptionsTestBase {};
 
 TEST_F(ProgramOptionsTest, BaseDir) {
-    ProgramOptions testobj("/home/user/mydir", "", none, false, none, none, none, none, {"./myExecutable"});
+    ProgramOptions testobj("/home/user/mydir", "", none, false, none, none, none, none, none, MountOptions(), {"./myExecutable"});
     EXPECT_EQ("/home/user/mydir", testobj.baseDir());
 }
 
 TEST_F(ProgramOptionsTest, MountDir) {
-    ProgramOptions testobj("", "/home/user/mydir", none, false, none, none, none, none, {"./myExecutable"});
+    ProgramOptions testobj("", "/home/user/mydir", none, false, none, none, none, none, none, MountOptions(), {"./myExecutable"});
     EXPECT_EQ("/home/user/mydir", testobj.mountDir());
 }
 
 TEST_F(ProgramOptionsTest, ConfigfileNone) {
-    ProgramOptions testobj("", "", none, true, none, none, none, none, {"./myExecutable"});
+    ProgramOptions testobj("", "", none, true, none, none, none, none, none, MountOptions(), {"./myExecutable"});
     EXPECT_EQ(none, testobj.configFile());
 }
 
 TEST_F(ProgramOptionsTest, ConfigfileSome) {
-    ProgramOptions testobj("", "", bf::path("/home/user/configfile"), true, none, none, none, none, {"./myExecutable"});
+    ProgramOptions testobj("", "", bf::path("/home/user/configfile"), true, none, none, none, none, none, MountOptions(), {"./myExecutable"});
     EXPECT_EQ("/home/user/configfile", testobj.configFile().get());
 }
 
 TEST_F(ProgramOptionsTest, ForegroundFalse) {
-    ProgramOptions testobj("", "", none, false, none, none, none, none, {"./myExecutable"});
+    ProgramOptions testobj("", "", none, false, none, none, none, none, none, MountOptions(), {"./myExecutable"});
     EXPECT_FALSE(testobj.foreground());
 }
 
 TEST_F(ProgramOptionsTest, ForegroundTrue) {
-    ProgramOptions testobj("", "", none, true, none, none, none, none, {"./myExecutable"});
+    ProgramOptions testobj("", "", none, true, none, none, none, none, none, MountOptions(), {"./myExecutable"});
     EXPECT_TRUE(testobj.foreground());
 }
 
 TEST_F(ProgramOptionsTest, LogfileNone) {
-    ProgramOptions testobj("", "", none, true, none, none, none, none, {"./myExecutable"});
+    ProgramOptions testobj("", "", none, true, none, none, none, none, none, MountOptions(), {"./myExecutable"});
     EXPECT_EQ(none, testobj.logFile());
 }
 
 TEST_F(ProgramOptionsTest, LogfileSome) {
-    ProgramOptions testobj("", "", none, true, none, bf::path("logfile"), none, none, {"./myExecutable"});
+    ProgramOptions testobj("", "", none, true, none, bf::path("logfile"), none, none, none, MountOptions(), {"./myExecutable"});
     EXPECT_EQ("logfile", testobj.logFile().get());
 }
 
 TEST_F(ProgramOptionsTest, UnmountAfterIdleMinutesNone) {
-ProgramOptions testobj("", "", none, true, none, none, none, none, {"./myExecutable"});
+ProgramOptions testobj("", "", none, true, none, none, none, none, none, MountOptions(), {"./myExecutable"});
 EXPECT_EQ(none, testobj.unmountAfterIdleMinutes());
 }
 
 TEST_F(ProgramOptionsTest, UnmountAfterIdleMinutesSome) {
-    ProgramOptions testobj("", "", none, true, 10, none, none, none, {"./myExecutable"});
+    ProgramOptions testobj("", "", none, true, 10, none, none, none, none, MountOptions(), {"./myExecutable"});
     EXPECT_EQ(10, testobj.unmountAfterIdleMinutes().get());
 }
 
 TEST_F(ProgramOptionsTest, CipherNone) {
-    ProgramOptions testobj("", "", none, true, none, none, none, none, {"./myExecutable"});
+    ProgramOptions testobj("", "", none, true, none, none, none, none, none, MountOptions(), {"./myExecutable"});
     EXPECT_EQ(none, testobj.cipher());
 }
 
 TEST_F(ProgramOptionsTest, CipherSome) {
-    ProgramOptions testobj("", "", none, true, none, none, string("aes-256-gcm"), none, {"./myExecutable"});
+    ProgramOptions testobj("", "", none, true, none, none, string("aes-256-gcm"), none, none, MountOptions(), {"./myExecutable"});
     EXPECT_EQ("aes-256-gcm", testobj.cipher().get());
 }
 
 TEST_F(ProgramOptionsTest, BlocksizeBytesNone) {
-    ProgramOptions testobj("", "", none, true, none, none, none, none, {"./myExecutable"});
+    ProgramOptions testobj("", "", none, true, none, none, none, none, none, MountOptions(), {"./myExecutable"});
     EXPECT_EQ(none, testobj.blocksizeBytes());
 }
 
 TEST_F(ProgramOptionsTest, BlocksizeSome) {
-    ProgramOptions testobj("", "", none, true, none, none, none, 10*1024, {"./myExecutable"});
+    ProgramOptions testobj("", "", none, true, none, none, none, 10*1024, none, MountOptions(), {"./myExecutable"});
     EXPECT_EQ(10*1024u, testobj.blocksizeBytes().get());
 }
 
+TEST_F(ProgramOptionsTest, CacheSizeBytesNone) {
+    ProgramOptions testobj("", "", none, true, none, none, none, none, none, MountOptions(), {"./myExecutable"});
+    EXPECT_EQ(none, testobj.cacheSizeBytes());
+}
+
+TEST_F(ProgramOptionsTest, CacheSizeBytesSome) {
+    MountOptions mountOptions;
+    mountOptions.cacheSizeBytes = uint64_t(512*1024*1024);
+    ProgramOptions testobj("", "", none, true, none, none, none, none, none, mountOptions, {"./myExecutable"});
+    EXPECT_EQ(512*1024*1024u, testobj.cacheSizeBytes().get());
+}
+
+TEST_F(ProgramOptionsTest, BlockstoreLayoutNone) {
+    ProgramOptions testobj("", "", none, true, none, none, none, none, none, MountOptions(), {"./myExecutable"});
+    EXPECT_EQ(none, testobj.blockstoreLayout());
+}
+
+TEST_F(ProgramOptionsTest, BlockstoreLayoutSome) {
+    ProgramOptions testobj("", "", none, true, none, none, none, none, string("log-structured"), MountOptions(), {"./myExecutable"});
+    EXPECT_EQ("log-structured", testobj.blockstoreLayout().get());
+}
+
+TEST_F(ProgramOptionsTest, FuseLowLevelFalse) {
+    ProgramOptions testobj("", "", none, true, none, none, none, none, none, MountOptions(), {"./myExecutable"});
+    EXPECT_FALSE(testobj.fuseLowLevel());
+}
+
+TEST_F(ProgramOptionsTest, FuseLowLevelTrue) {
+    MountOptions mountOptions;
+    mountOptions.fuseLowLevel = true;
+    ProgramOptions testobj("", "", none, true, none, none, none, none, none, mountOptions, {"./myExecutable"});
+    EXPECT_TRUE(testobj.fuseLowLevel());
+}
+
+TEST_F(ProgramOptionsTest, TimeoutsNone) {
+    MountOptions mountOptions;
+    mountOptions.fuseLowLevel = true;
+    ProgramOptions testobj("", "", none, true, none, none, none, none, none, mountOptions, {"./myExecutable"});
+    EXPECT_EQ(none, testobj.entryTimeoutSeconds());
+    EXPECT_EQ(none, testobj.attrTimeoutSeconds());
+}
+
+TEST_F(ProgramOptionsTest, TimeoutsSome) {
+    MountOptions mountOptions;
+    mountOptions.fuseLowLevel = true;
+    mountOptions.entryTimeoutSeconds = 10.5;
+    mountOptions.attrTimeoutSeconds = 2.0;
+    ProgramOptions testobj("", "", none, true, none, none, none, none, none, mountOptions, {"./myExecutable"});
+    EXPECT_EQ(10.5, testobj.entryTimeoutSeconds().get());
+    EXPECT_EQ(2.0, testobj.attrTimeoutSeconds().get());
+}
+
+TEST_F(ProgramOptionsTest, FuseThreadsNone) {
+    ProgramOptions testobj("", "", none, true, none, none, none, none, none, MountOptions(), {"./myExecutable"});
+    EXPECT_EQ(none, testobj.fuseThreads());
+}
+
+TEST_F(ProgramOptionsTest, FuseThreadsSome) {
+    MountOptions mountOptions;
+    mountOptions.fuseThreads = 8u;
+    ProgramOptions testobj("", "", none, true, none, none, none, none, none, mountOptions, {"./myExecutable"});
+    EXPECT_EQ(8u, testobj.fuseThreads().get());
+}
+
+TEST_F(ProgramOptionsTest, AtimeBehaviorNone) {
+    ProgramOptions testobj("", "", none, true, none, none, none, none, none, MountOptions(), {"./myExecutable"});
+    EXPECT_EQ(none, testobj.atimeBehavior());
+}
+
+TEST_F(ProgramOptionsTest, AtimeBehaviorSome) {
+    MountOptions mountOptions;
+    mountOptions.atimeBehavior = string("noatime");
+    ProgramOptions testobj("", "", none, true, none, none, none, none, none, mountOptions, {"./myExecutable"});
+    EXPECT_EQ("noatime", testobj.atimeBehavior().get());
+}
+
+TEST_F(ProgramOptionsTest, LazytimeFalse) {
+    ProgramOptions testobj("", "", none, true, none, none, none, none, none, MountOptions(), {"./myExecutable"});
+    EXPECT_FALSE(testobj.lazytime());
+}
+
+TEST_F(ProgramOptionsTest, LazytimeTrue) {
+    MountOptions mountOptions;
+    mountOptions.lazytime = true;
+    ProgramOptions testobj("", "", none, true, none, none, none, none, none, mountOptions, {"./myExecutable"});
+    EXPECT_TRUE(testobj.lazytime());
+}
+
+TEST_F(ProgramOptionsTest, AtomicWritesFalse) {
+    ProgramOptions testobj("", "", none, true, none, none, none, none, none, MountOptions(), {"./myExecutable"});
+    EXPECT_FALSE(testobj.atomicWrites());
+}
+
+TEST_F(ProgramOptionsTest, AtomicWritesTrue) {
+    MountOptions mountOptions;
+    mountOptions.atomicWrites = true;
+    ProgramOptions testobj("", "", none, true, none, none, none, none, none, mountOptions, {"./myExecutable"});
+    EXPECT_TRUE(testobj.atomicWrites());
+}
+
 TEST_F(ProgramOptionsTest, EmptyFuseOptions) {
-    ProgramOptions testobj("/rootDir", "/home/user/mydir", none, false, none, none, none, none, {});
+    ProgramOptions testobj("/rootDir", "/home/user/mydir", none, false, none, none, none, none, none, MountOptions(), {});
     //Fuse should have the mount dir as first parameter
     EXPECT_VECTOR_EQ({}, testobj.fuseOptions());
 }
 
 TEST_F(ProgramOptionsTest, SomeFuseOptions) {
-    ProgramOptions testobj("/rootDir", "/home/user/mydir", none, false, none, none, none, none, {"-f", "--longoption"});
+    ProgramOptions testobj("/rootDir", "/home/user/mydir", none, false, none, none, none, none, none, MountOptions(), {"-f", "--longoption"});
     //Fuse should have the mount dir as first parameter
     EXPECT_VECTOR_EQ({"-f", "--longoption"}, testobj.fuseOptions());
 }
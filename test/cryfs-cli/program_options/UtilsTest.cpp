@@ -5,6 +5,7 @@ using namespace cryfs::program_options;
 using std::pair;
 using std::vector;
 using std::string;
+using boost::none;
 
 class ProgramOptionsUtilsTest: public ProgramOptionsTestBase {};
 
@@ -112,3 +113,35 @@ TEST_F(ProgramOptionsUtilsTest, SplitAtDoubleDash_RealisticCryfsOptions) {
     EXPECT_VECTOR_EQ({"./executableName", "rootDir", "mountDir"}, result.first);
     EXPECT_VECTOR_EQ({"-f"}, result.second);
 }
+
+TEST_F(ProgramOptionsUtilsTest, ParseByteSize_WithoutSuffix) {
+    EXPECT_EQ(4096u, parseByteSize("4096").value());
+}
+
+TEST_F(ProgramOptionsUtilsTest, ParseByteSize_Zero) {
+    EXPECT_EQ(0u, parseByteSize("0").value());
+}
+
+TEST_F(ProgramOptionsUtilsTest, ParseByteSize_Suffixes) {
+    EXPECT_EQ(512*1024u, parseByteSize("512K").value());
+    EXPECT_EQ(512*1024*1024u, parseByteSize("512M").value());
+    EXPECT_EQ(2*1024*1024*1024ul, parseByteSize("2G").value());
+    EXPECT_EQ(1024ul*1024*1024*1024, parseByteSize("1T").value());
+}
+
+TEST_F(ProgramOptionsUtilsTest, ParseByteSize_LowercaseSuffix) {
+    EXPECT_EQ(512*1024*1024u, parseByteSize("512m").value());
+}
+
+TEST_F(ProgramOptionsUtilsTest, ParseByteSize_Invalid) {
+    EXPECT_EQ(none, parseByteSize(""));
+    EXPECT_EQ(none, parseByteSize("M"));
+    EXPECT_EQ(none, parseByteSize("-5"));
+    EXPECT_EQ(none, parseByteSize("512X"));
+    EXPECT_EQ(none, parseByteSize("512MB"));
+}
+
+TEST_F(ProgramOptionsUtilsTest, ParseByteSize_Overflow) {
+    EXPECT_EQ(none, parseByteSize("100000000000000000000"));
+    EXPECT_EQ(none, parseByteSize("100000000T"));
+}
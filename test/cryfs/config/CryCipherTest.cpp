@@ -108,6 +108,28 @@ TEST_F(CryCipherTest, CreatesCorrectEncryptedBlockStore) {
     EXPECT_CREATES_CORRECT_ENCRYPTED_BLOCKSTORE<Mars256_CFB>("mars-256-cfb");
     EXPECT_CREATES_CORRECT_ENCRYPTED_BLOCKSTORE<Mars128_GCM>("mars-128-gcm");
     EXPECT_CREATES_CORRECT_ENCRYPTED_BLOCKSTORE<Mars128_CFB>("mars-128-cfb");
+#if CRYPTOPP_VERSION >= 810
+    EXPECT_CREATES_CORRECT_ENCRYPTED_BLOCKSTORE<XChaCha20Poly1305>("xchacha20-poly1305");
+#endif
+}
+
+#if CRYPTOPP_VERSION >= 810
+TEST_F(CryCipherTest, FindsXChaCha20Poly1305) {
+    EXPECT_FINDS_CORRECT_CIPHER("xchacha20-poly1305");
+    EXPECT_EQ(none, CryCiphers::find("xchacha20-poly1305").warning());
+}
+#endif
+
+TEST_F(CryCipherTest, BenchmarkMeasuresThroughput) {
+    auto throughput = CryCiphers::find("aes-256-gcm").benchmark(32768, std::chrono::milliseconds(10));
+    EXPECT_GT(throughput.encryptMBps, 0);
+    EXPECT_GT(throughput.decryptMBps, 0);
+}
+
+TEST_F(CryCipherTest, BenchmarkWithBlocksizeTooSmallForCipher) {
+    auto throughput = CryCiphers::find("aes-256-gcm").benchmark(1, std::chrono::milliseconds(10));
+    EXPECT_EQ(0, throughput.encryptMBps);
+    EXPECT_EQ(0, throughput.decryptMBps);
 }
 
 TEST_F(CryCipherTest, SupportedCipherNamesContainsACipher) {
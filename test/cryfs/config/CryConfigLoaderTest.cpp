@@ -44,10 +44,10 @@ public:
         auto askPassword = [password] { return password;};
         if(noninteractive) {
             return CryConfigLoader(make_shared<NoninteractiveConsole>(console), cpputils::Random::PseudoRandom(), SCrypt::TestSettings, askPassword,
-                                   askPassword, cipher, none);
+                                   askPassword, cipher, none, none);
         } else {
             return CryConfigLoader(console, cpputils::Random::PseudoRandom(), SCrypt::TestSettings, askPassword,
-                                   askPassword, cipher, none);
+                                   askPassword, cipher, none, none);
         }
     }
 
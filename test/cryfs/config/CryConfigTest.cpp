@@ -37,6 +37,34 @@ TEST_F(CryConfigTest, RootBlob_AfterSaveAndLoad) {
     EXPECT_EQ("rootblobid", loaded.RootBlob());
 }
 
+TEST_F(CryConfigTest, RemovalJournalBlob_Init) {
+    EXPECT_EQ("", cfg.RemovalJournalBlob());
+}
+
+TEST_F(CryConfigTest, RemovalJournalBlob) {
+    cfg.SetRemovalJournalBlob("journalblobid");
+    EXPECT_EQ("journalblobid", cfg.RemovalJournalBlob());
+}
+
+TEST_F(CryConfigTest, RemovalJournalBlob_AfterMove) {
+    cfg.SetRemovalJournalBlob("journalblobid");
+    CryConfig moved = std::move(cfg);
+    EXPECT_EQ("journalblobid", moved.RemovalJournalBlob());
+}
+
+TEST_F(CryConfigTest, RemovalJournalBlob_AfterSaveAndLoad) {
+    cfg.SetRemovalJournalBlob("journalblobid");
+    CryConfig loaded = SaveAndLoad(std::move(cfg));
+    EXPECT_EQ("journalblobid", loaded.RemovalJournalBlob());
+}
+
+TEST_F(CryConfigTest, RemovalJournalBlob_EmptyForOldConfigs) {
+    // Config files from before this field was introduced don't have it
+    std::stringstream stream(R"({"cryfs": {"rootblob": "", "key": "", "cipher": "aes-256-gcm"}})");
+    CryConfig loaded = CryConfig::load(Data::LoadFromStream(stream));
+    EXPECT_EQ("", loaded.RemovalJournalBlob());
+}
+
 TEST_F(CryConfigTest, EncryptionKey_Init) {
     EXPECT_EQ("", cfg.EncryptionKey());
 }
@@ -165,3 +193,31 @@ TEST_F(CryConfigTest, FilesystemID_AfterSaveAndLoad) {
     CryConfig loaded = SaveAndLoad(std::move(cfg));
     EXPECT_EQ(fixture, loaded.FilesystemId());
 }
+
+TEST_F(CryConfigTest, BlockstoreLayout_Init) {
+    EXPECT_EQ("", cfg.BlockstoreLayout());
+}
+
+TEST_F(CryConfigTest, BlockstoreLayout) {
+    cfg.SetBlockstoreLayout("log-structured");
+    EXPECT_EQ("log-structured", cfg.BlockstoreLayout());
+}
+
+TEST_F(CryConfigTest, BlockstoreLayout_AfterMove) {
+    cfg.SetBlockstoreLayout("log-structured");
+    CryConfig moved = std::move(cfg);
+    EXPECT_EQ("log-structured", moved.BlockstoreLayout());
+}
+
+TEST_F(CryConfigTest, BlockstoreLayout_AfterSaveAndLoad) {
+    cfg.SetBlockstoreLayout("log-structured");
+    CryConfig loaded = SaveAndLoad(std::move(cfg));
+    EXPECT_EQ("log-structured", loaded.BlockstoreLayout());
+}
+
+TEST_F(CryConfigTest, BlockstoreLayout_DefaultsToFilePerBlockForOldConfigs) {
+    // Config files from before this field was introduced don't have it
+    std::stringstream stream(R"({"cryfs": {"rootblob": "", "key": "", "cipher": "aes-256-gcm"}})");
+    CryConfig loaded = CryConfig::load(Data::LoadFromStream(stream));
+    EXPECT_EQ("file-per-block", loaded.BlockstoreLayout());
+}
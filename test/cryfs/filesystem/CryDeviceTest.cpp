@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include "testutils/CryTestBase.h"
+#include <cryfs/filesystem/CryDir.h>
+#include <cryfs/filesystem/CryFile.h>
+#include <cryfs/filesystem/CryOpenFile.h>
+
+using namespace cryfs;
+using boost::none;
+namespace bf = boost::filesystem;
+
+// Tests that path lookups of CryDevice stay correct while they're cached
+class CryDeviceTest : public ::testing::Test, public CryTestBase {
+public:
+    static constexpr mode_t MODE_PUBLIC = S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IWOTH | S_IXOTH;
+
+    void CreateFile(const bf::path &path) {
+        device().LoadDir(path.parent_path()).value()->createAndOpenFile(path.filename().native(), MODE_PUBLIC, 0, 0);
+    }
+
+    void CreateDir(const bf::path &path) {
+        device().LoadDir(path.parent_path()).value()->createDir(path.filename().native(), MODE_PUBLIC, 0, 0);
+    }
+};
+
+TEST_F(CryDeviceTest, RepeatedLoadHitsCache) {
+    CreateDir("/dir");
+    CreateDir("/dir/subdir");
+    CreateFile("/dir/subdir/file");
+    EXPECT_NE(none, device().Load("/dir/subdir/file"));
+    uint64_t hits = device().dentryCacheStatistics().numHits;
+    EXPECT_NE(none, device().Load("/dir/subdir/file"));
+    EXPECT_LT(hits, device().dentryCacheStatistics().numHits);
+}
+
+TEST_F(CryDeviceTest, RemovalJournalKeyIsStoredInConfig) {
+    EXPECT_NE("", loadConfig().RemovalJournalBlob());
+}
+
+TEST_F(CryDeviceTest, FileSystemsHaveDifferentRemovalJournalKeys) {
+    CryTestBase otherFileSystem;
+    EXPECT_NE(loadConfig().RemovalJournalBlob(), otherFileSystem.loadConfig().RemovalJournalBlob());
+}
+
+TEST_F(CryDeviceTest, LoadAfterCreatingPreviouslyNonexistingFile) {
+    EXPECT_EQ(none, device().Load("/file"));
+    CreateFile("/file");
+    EXPECT_NE(none, device().Load("/file"));
+}
+
+TEST_F(CryDeviceTest, LoadAfterCreatingInPreviouslyNonexistingDir) {
+    EXPECT_ANY_THROW(device().Load("/dir/file"));
+    CreateDir("/dir");
+    EXPECT_EQ(none, device().Load("/dir/file"));
+    CreateFile("/dir/file");
+    EXPECT_NE(none, device().Load("/dir/file"));
+}
+
+TEST_F(CryDeviceTest, LoadAfterRemoving) {
+    CreateFile("/file");
+    EXPECT_NE(none, device().Load("/file"));
+    device().Load("/file").value()->remove();
+    EXPECT_EQ(none, device().Load("/file"));
+}
+
+TEST_F(CryDeviceTest, LoadAfterRenamingDir) {
+    CreateDir("/dir");
+    CreateFile("/dir/file");
+    EXPECT_NE(none, device().Load("/dir/file"));
+    device().Load("/dir").value()->rename("/newdir");
+    EXPECT_ANY_THROW(device().Load("/dir/file"));
+    EXPECT_NE(none, device().Load("/newdir/file"));
+}
+
+TEST_F(CryDeviceTest, LoadAfterRenameOverwrites) {
+    CreateFile("/file1");
+    CreateFile("/file2");
+    device().Load("/file1").value()->chmod(S_IFREG | S_IRUSR);
+    EXPECT_NE(none, device().Load("/file2"));
+    device().Load("/file1").value()->rename("/file2");
+    EXPECT_EQ(none, device().Load("/file1"));
+    struct ::stat stat;
+    device().Load("/file2").value()->stat(&stat);
+    EXPECT_EQ(static_cast<mode_t>(S_IFREG | S_IRUSR), stat.st_mode);
+}
+
+TEST_F(CryDeviceTest, LoadAfterRemovingAndRecreatingDir) {
+    CreateDir("/dir");
+    CreateFile("/dir/file");
+    EXPECT_NE(none, device().Load("/dir/file"));
+    device().Load("/dir/file").value()->remove();
+    device().Load("/dir").value()->remove();
+    CreateDir("/dir");
+    EXPECT_EQ(none, device().Load("/dir/file"));
+}
+
+TEST_F(CryDeviceTest, LoadNewFileInCachedDir) {
+    CreateDir("/dir");
+    CreateDir("/dir/subdir");
+    EXPECT_NE(none, device().Load("/dir/subdir"));
+    CreateFile("/dir/subdir/file");
+    EXPECT_NE(none, device().Load("/dir/subdir/file"));
+}
+
+TEST_F(CryDeviceTest, LoadBelowCachedFile) {
+    CreateFile("/file");
+    EXPECT_NE(none, device().Load("/file"));
+    EXPECT_ANY_THROW(device().Load("/file/child"));
+}
+
+TEST_F(CryDeviceTest, LoadBelowCachedNonexistingDir) {
+    EXPECT_EQ(none, device().Load("/dir"));
+    EXPECT_ANY_THROW(device().Load("/dir/subdir/file"));
+}
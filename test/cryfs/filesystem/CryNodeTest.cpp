@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <algorithm>
 #include "testutils/CryTestBase.h"
 #include <cryfs/filesystem/CryDir.h>
 #include <cryfs/filesystem/CryFile.h>
@@ -26,9 +27,10 @@ public:
 
 TEST_F(CryNodeTest, Rename_DoesntLeaveBlocksOver) {
     auto node = CreateFile("/oldname");
-    EXPECT_EQ(2u, device().numBlocks()); // In the beginning, there is two blocks (the root block and the created file). If that is not true anymore, we'll have to adapt the test case.
+    EXPECT_EQ(3u, device().numBlocks()); // In the beginning, there is three blocks (the root block, the removal journal and the created file). If that is not true anymore, we'll have to adapt the test case.
     node->rename("/newname");
-    EXPECT_EQ(2u, device().numBlocks()); // Still same number of blocks
+    device().waitForPendingRemovals();
+    EXPECT_EQ(3u, device().numBlocks()); // Still same number of blocks
 }
 
 // TODO Add similar test cases (i.e. checking number of blocks) for other situations in rename, and also for other operations (e.g. deleting files).
@@ -36,7 +38,58 @@ TEST_F(CryNodeTest, Rename_DoesntLeaveBlocksOver) {
 TEST_F(CryNodeTest, Rename_Overwrite_DoesntLeaveBlocksOver) {
     auto node = CreateFile("/oldname");
     CreateFile("/newexistingname");
-    EXPECT_EQ(3u, device().numBlocks()); // In the beginning, there is three blocks (the root block and the two created files). If that is not true anymore, we'll have to adapt the test case.
+    EXPECT_EQ(4u, device().numBlocks()); // In the beginning, there is four blocks (the root block, the removal journal and the two created files). If that is not true anymore, we'll have to adapt the test case.
     node->rename("/newexistingname");
-    EXPECT_EQ(2u, device().numBlocks()); // Only the blocks of one file are left
+    device().waitForPendingRemovals();
+    EXPECT_EQ(3u, device().numBlocks()); // Only the blocks of one file are left
+}
+
+TEST_F(CryNodeTest, Stat_SizeAfterWriting) {
+    auto node = CreateFile("/file");
+    {
+        auto openFile = dynamic_pointer_move<CryFile>(node).value()->open(O_RDWR);
+        openFile->write("0123456789", 10, 5);
+    }
+    struct ::stat stat;
+    device().Load("/file").value()->stat(&stat);
+    EXPECT_EQ(15, stat.st_size);
+}
+
+TEST_F(CryNodeTest, Stat_SizeAfterTruncating) {
+    auto node = CreateFile("/file");
+    dynamic_pointer_move<CryFile>(node).value()->truncate(1000);
+    struct ::stat stat;
+    device().Load("/file").value()->stat(&stat);
+    EXPECT_EQ(1000, stat.st_size);
+}
+
+TEST_F(CryNodeTest, Stat_InodeNumberStaysSameAfterRename) {
+    auto node = CreateFile("/oldname");
+    struct ::stat stat;
+    node->stat(&stat);
+    ino_t inode = stat.st_ino;
+    node->rename("/newname");
+    device().Load("/newname").value()->stat(&stat);
+    EXPECT_EQ(inode, stat.st_ino);
+}
+
+TEST_F(CryNodeTest, Stat_InodeNumbersAreDistinct) {
+    struct ::stat stat1, stat2, rootStat;
+    CreateFile("/file1")->stat(&stat1);
+    CreateFile("/file2")->stat(&stat2);
+    device().Load("/").value()->stat(&rootStat);
+    EXPECT_NE(stat1.st_ino, stat2.st_ino);
+    EXPECT_NE(stat1.st_ino, rootStat.st_ino);
+    EXPECT_LT(1u, stat1.st_ino); // FUSE reserves 1 for the root directory
+}
+
+TEST_F(CryNodeTest, Children_ReportSameInodeNumberAsStat) {
+    struct ::stat stat;
+    CreateFile("/file")->stat(&stat);
+    auto children = device().LoadDir("/").value()->children();
+    auto found = std::find_if(children->begin(), children->end(), [] (const fspp::Dir::Entry &entry) {
+        return entry.name == "file";
+    });
+    ASSERT_NE(children->end(), found);
+    EXPECT_EQ(stat.st_ino, found->inode);
 }
@@ -0,0 +1,212 @@
+#include <gtest/gtest.h>
+#include "testutils/CryTestBase.h"
+#include <cryfs/filesystem/CryDir.h>
+#include <cryfs/filesystem/CryFile.h>
+#include <cryfs/filesystem/CryOpenFile.h>
+#include <cpp-utils/system/stat.h>
+#include <thread>
+
+using cpputils::unique_ref;
+using cryfs::fsblobstore::AtimeUpdateBehavior;
+using boost::none;
+namespace bf = boost::filesystem;
+
+// The generic timestamp behavior (strictatime, without lazytime) is covered in Fspp fstest.
+// These test cases cover the atime behaviors and lazytime, which only CryFS offers.
+
+class CryTimestampsTest : public CryTestBase {
+public:
+    static constexpr mode_t MODE_PUBLIC = S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IWOTH | S_IXOTH;
+
+    CryTimestampsTest(AtimeUpdateBehavior atimeBehavior, bool lazytime): CryTestBase(atimeBehavior, lazytime) {}
+
+    unique_ref<fspp::OpenFile> CreateAndOpenFile(const bf::path &path) {
+        auto file = device().LoadDir(path.parent_path()).value()->createAndOpenFile(path.filename().native(), MODE_PUBLIC, 0, 0);
+        file->write("content", 7, 0);
+        // Make sure timestamps taken after this are different
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return file;
+    }
+
+    struct ::stat StatPath(const bf::path &path) {
+        struct ::stat result;
+        device().Load(path).value()->stat(&result);
+        return result;
+    }
+
+    struct ::stat StatOpenFile(const fspp::OpenFile &file) {
+        struct ::stat result;
+        file.stat(&result);
+        return result;
+    }
+
+    // Returns the directory entry as it is stored, without the updates lazytime keeps in memory
+    cryfs::fsblobstore::DirEntry StoredEntry(const bf::path &path) {
+        auto parent = device().LoadDirBlobWithParent(path.parent_path()).blob;
+        return parent->GetChild(path.filename().native()).value();
+    }
+
+    void Read(fspp::OpenFile *file) {
+        char buffer[7];
+        file->read(buffer, 7, 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+};
+
+class CryTimestampsTest_Strictatime : public ::testing::Test, public CryTimestampsTest {
+public:
+    CryTimestampsTest_Strictatime(): CryTimestampsTest(AtimeUpdateBehavior::STRICTATIME, false) {}
+};
+
+TEST_F(CryTimestampsTest_Strictatime, ReadUpdatesAccessTimestampEachTime) {
+    auto file = CreateAndOpenFile("/file");
+    Read(file.get());
+    timespec firstRead = StatOpenFile(*file).st_atim;
+    Read(file.get());
+    EXPECT_LT(firstRead, StatOpenFile(*file).st_atim);
+}
+
+class CryTimestampsTest_Relatime : public ::testing::Test, public CryTimestampsTest {
+public:
+    CryTimestampsTest_Relatime(): CryTimestampsTest(AtimeUpdateBehavior::RELATIME, false) {}
+};
+
+TEST_F(CryTimestampsTest_Relatime, FirstReadAfterModificationUpdatesAccessTimestamp) {
+    auto file = CreateAndOpenFile("/file");
+    timespec beforeRead = StatOpenFile(*file).st_atim;
+    Read(file.get());
+    EXPECT_LT(beforeRead, StatOpenFile(*file).st_atim);
+}
+
+TEST_F(CryTimestampsTest_Relatime, SecondReadDoesntUpdateAccessTimestamp) {
+    auto file = CreateAndOpenFile("/file");
+    Read(file.get());
+    timespec firstRead = StatOpenFile(*file).st_atim;
+    Read(file.get());
+    EXPECT_EQ(firstRead, StatOpenFile(*file).st_atim);
+}
+
+TEST_F(CryTimestampsTest_Relatime, ReadAfterWriteUpdatesAccessTimestamp) {
+    auto file = CreateAndOpenFile("/file");
+    Read(file.get());
+    file->write("other", 5, 0);
+    timespec afterWrite = StatOpenFile(*file).st_atim;
+    Read(file.get());
+    EXPECT_LT(afterWrite, StatOpenFile(*file).st_atim);
+}
+
+class CryTimestampsTest_Noatime : public ::testing::Test, public CryTimestampsTest {
+public:
+    CryTimestampsTest_Noatime(): CryTimestampsTest(AtimeUpdateBehavior::NOATIME, false) {}
+};
+
+TEST_F(CryTimestampsTest_Noatime, ReadDoesntUpdateAccessTimestamp) {
+    auto file = CreateAndOpenFile("/file");
+    timespec beforeRead = StatOpenFile(*file).st_atim;
+    Read(file.get());
+    EXPECT_EQ(beforeRead, StatOpenFile(*file).st_atim);
+}
+
+TEST_F(CryTimestampsTest_Noatime, ListingDirDoesntUpdateAccessTimestamp) {
+    device().LoadDir("/").value()->createDir("dir", MODE_PUBLIC, 0, 0);
+    timespec beforeListing = StatPath("/dir").st_atim;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    device().LoadDir("/dir").value()->children();
+    EXPECT_EQ(beforeListing, StatPath("/dir").st_atim);
+}
+
+class CryTimestampsTest_Lazytime : public ::testing::Test, public CryTimestampsTest {
+public:
+    CryTimestampsTest_Lazytime(): CryTimestampsTest(AtimeUpdateBehavior::STRICTATIME, true) {}
+};
+
+TEST_F(CryTimestampsTest_Lazytime, WriteOnlyStoresSize) {
+    auto file = CreateAndOpenFile("/file");
+    auto before = StoredEntry("/file");
+    file->write("longer content", 14, 0);
+    auto after = StoredEntry("/file");
+    EXPECT_EQ(before.lastModificationTime(), after.lastModificationTime());
+    EXPECT_EQ(14u, after.size().value());
+}
+
+TEST_F(CryTimestampsTest_Lazytime, ReadDoesntChangeStoredEntry) {
+    auto file = CreateAndOpenFile("/file");
+    auto before = StoredEntry("/file");
+    Read(file.get());
+    EXPECT_EQ(before.lastAccessTime(), StoredEntry("/file").lastAccessTime());
+}
+
+TEST_F(CryTimestampsTest_Lazytime, StatShowsUpdates) {
+    auto file = CreateAndOpenFile("/file");
+    timespec beforeWrite = StatPath("/file").st_mtim;
+    file->write("longer content", 14, 0);
+    Read(file.get());
+    struct ::stat pathStat = StatPath("/file");
+    EXPECT_EQ(14, pathStat.st_size);
+    EXPECT_LT(beforeWrite, pathStat.st_mtim);
+    EXPECT_LT(beforeWrite, pathStat.st_atim);
+    struct ::stat openFileStat = StatOpenFile(*file);
+    EXPECT_EQ(pathStat.st_mtim, openFileStat.st_mtim);
+    EXPECT_EQ(pathStat.st_atim, openFileStat.st_atim);
+}
+
+TEST_F(CryTimestampsTest_Lazytime, FlushStoresUpdates) {
+    auto file = CreateAndOpenFile("/file");
+    file->write("longer content", 14, 0);
+    Read(file.get());
+    struct ::stat expected = StatPath("/file");
+    file->flush();
+    auto stored = StoredEntry("/file");
+    EXPECT_EQ(14u, stored.size().value());
+    EXPECT_EQ(expected.st_mtim, stored.lastModificationTime());
+    EXPECT_EQ(expected.st_atim, stored.lastAccessTime());
+}
+
+TEST_F(CryTimestampsTest_Lazytime, FsyncStoresUpdates) {
+    auto file = CreateAndOpenFile("/file");
+    file->write("longer content", 14, 0);
+    file->fsync();
+    EXPECT_EQ(14u, StoredEntry("/file").size().value());
+}
+
+TEST_F(CryTimestampsTest_Lazytime, FdatasyncStoresSize) {
+    auto file = CreateAndOpenFile("/file");
+    file->write("longer content", 14, 0);
+    file->fdatasync();
+    EXPECT_EQ(14u, StoredEntry("/file").size().value());
+}
+
+TEST_F(CryTimestampsTest_Lazytime, CloseStoresUpdates) {
+    auto file = CreateAndOpenFile("/file");
+    file->write("longer content", 14, 0);
+    cpputils::destruct(std::move(file));
+    EXPECT_EQ(14u, StoredEntry("/file").size().value());
+}
+
+TEST_F(CryTimestampsTest_Lazytime, UpdatesAreKeptWhenRenaming) {
+    auto file = CreateAndOpenFile("/file");
+    file->write("longer content", 14, 0);
+    device().LoadDir("/").value()->createDir("dir", MODE_PUBLIC, 0, 0);
+    device().Load("/file").value()->rename("/dir/file");
+    EXPECT_EQ(14u, StoredEntry("/dir/file").size().value());
+}
+
+TEST_F(CryTimestampsTest_Lazytime, UtimensOverwritesUpdates) {
+    auto file = CreateAndOpenFile("/file");
+    file->write("longer content", 14, 0);
+    device().Load("/file").value()->utimens(timespec{100, 0}, timespec{200, 0});
+    cpputils::destruct(std::move(file));
+    auto stored = StoredEntry("/file");
+    EXPECT_EQ(14u, stored.size().value());
+    EXPECT_EQ((timespec{100, 0}), stored.lastAccessTime());
+    EXPECT_EQ((timespec{200, 0}), stored.lastModificationTime());
+}
+
+TEST_F(CryTimestampsTest_Lazytime, TruncateOverwritesUpdates) {
+    auto file = CreateAndOpenFile("/file");
+    file->write("longer content", 14, 0);
+    file->truncate(3);
+    cpputils::destruct(std::move(file));
+    EXPECT_EQ(3u, StoredEntry("/file").size().value());
+    EXPECT_EQ(3, StatPath("/file").st_size);
+}
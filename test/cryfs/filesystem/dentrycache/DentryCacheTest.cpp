@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+#include <cryfs/filesystem/dentrycache/DentryCache.h>
+#include <cpp-utils/data/DataFixture.h>
+
+using cryfs::dentrycache::DentryCache;
+using blockstore::Key;
+using cpputils::DataFixture;
+using fspp::Dir;
+using boost::none;
+
+class DentryCacheTest: public ::testing::Test {
+public:
+    DentryCacheTest(): seed(0), rootKey(RandomKey()), cache(rootKey) {}
+
+    Key RandomKey() {
+        return DataFixture::generateFixedSize<Key::BINARY_LENGTH>(++seed);
+    }
+
+    Key InsertDir(const std::string &path, const Key &parentKey) {
+        Key key = RandomKey();
+        cache.insert(path, DentryCache::Entry{key, parentKey, Dir::EntryType::DIR}, cache.generation());
+        return key;
+    }
+
+    void InsertNonexisting(const std::string &path, const Key &parentKey) {
+        cache.insert(path, DentryCache::Entry{none, parentKey, Dir::EntryType::FILE}, cache.generation());
+    }
+
+    int seed;
+    Key rootKey;
+    DentryCache cache;
+};
+
+TEST_F(DentryCacheTest, Miss) {
+    EXPECT_EQ(none, cache.lookup("/nonexisting"));
+    EXPECT_EQ(1u, cache.statistics().numMisses);
+}
+
+TEST_F(DentryCacheTest, Hit) {
+    Key key = InsertDir("/dir", rootKey);
+    auto entry = cache.lookup("/dir").value();
+    EXPECT_EQ(key, entry.key.value());
+    EXPECT_EQ(rootKey, entry.parentKey);
+    EXPECT_EQ(Dir::EntryType::DIR, entry.type);
+    EXPECT_EQ(1u, cache.statistics().numHits);
+}
+
+TEST_F(DentryCacheTest, NegativeEntry) {
+    InsertNonexisting("/nonexisting", rootKey);
+    EXPECT_FALSE(cache.lookup("/nonexisting").value().exists());
+}
+
+TEST_F(DentryCacheTest, InvalidateChildRemovesNegativeEntry) {
+    Key dir = InsertDir("/dir", rootKey);
+    InsertNonexisting("/dir/file", dir);
+    cache.invalidateChild(dir, "file");
+    EXPECT_EQ(none, cache.lookup("/dir/file"));
+    EXPECT_NE(none, cache.lookup("/dir"));
+}
+
+TEST_F(DentryCacheTest, InvalidateChildOfRoot) {
+    InsertNonexisting("/file", rootKey);
+    cache.invalidateChild(rootKey, "file");
+    EXPECT_EQ(none, cache.lookup("/file"));
+}
+
+TEST_F(DentryCacheTest, InvalidateRemovesEntriesBelow) {
+    Key dir = InsertDir("/dir", rootKey);
+    Key subdir = InsertDir("/dir/subdir", dir);
+    InsertNonexisting("/dir/subdir/file", subdir);
+    InsertDir("/dir-sibling", rootKey);
+    InsertDir("/dirsibling", rootKey);
+    cache.invalidate(dir);
+    EXPECT_EQ(none, cache.lookup("/dir"));
+    EXPECT_EQ(none, cache.lookup("/dir/subdir"));
+    EXPECT_EQ(none, cache.lookup("/dir/subdir/file"));
+    EXPECT_NE(none, cache.lookup("/dir-sibling"));
+    EXPECT_NE(none, cache.lookup("/dirsibling"));
+}
+
+TEST_F(DentryCacheTest, InvalidateUnknownKey) {
+    Key dir = InsertDir("/dir", rootKey);
+    cache.invalidate(RandomKey());
+    EXPECT_EQ(dir, cache.lookup("/dir").value().key.value());
+}
+
+TEST_F(DentryCacheTest, DoesntInsertAfterConcurrentInvalidation) {
+    uint64_t generation = cache.generation();
+    cache.invalidateChild(rootKey, "file");
+    cache.insert("/file", DentryCache::Entry{none, rootKey, Dir::EntryType::FILE}, generation);
+    EXPECT_EQ(none, cache.lookup("/file"));
+}
+
+TEST_F(DentryCacheTest, DoesntInsertIfParentIsUnknown) {
+    InsertNonexisting("/dir/file", RandomKey());
+    EXPECT_EQ(none, cache.lookup("/dir/file"));
+}
+
+TEST_F(DentryCacheTest, IsLimitedInSize) {
+    for (size_t i = 0; i <= DentryCache::MAX_ENTRIES; ++i) {
+        InsertNonexisting("/file" + std::to_string(i), rootKey);
+    }
+    EXPECT_GE(DentryCache::MAX_ENTRIES * sizeof(DentryCache::Entry), cache.statistics().numBytes);
+    EXPECT_LT(0u, cache.statistics().numEvictions);
+}
+
+TEST_F(DentryCacheTest, NumBytesCountsPaths) {
+    InsertDir("/dir", rootKey);
+    uint64_t shortPathBytes = cache.statistics().numBytes;
+    InsertDir("/" + std::string(1000, 'a'), rootKey);
+    uint64_t longPathBytes = cache.statistics().numBytes - shortPathBytes;
+    // The paths of existing entries are stored twice
+    EXPECT_EQ(2u * (1001 - 4), longPathBytes - shortPathBytes);
+}
+
+TEST_F(DentryCacheTest, NumBytesIsZeroAfterInvalidatingAllEntries) {
+    Key dir = InsertDir("/dir", rootKey);
+    InsertDir("/dir/subdir", dir);
+    InsertNonexisting("/dir/file", dir);
+    EXPECT_LT(0u, cache.statistics().numBytes);
+    cache.invalidate(dir);
+    EXPECT_EQ(0u, cache.statistics().numBytes);
+}
+
+TEST_F(DentryCacheTest, InsertingSameBlobAgainKeepsEntriesBelow) {
+    Key dir = InsertDir("/dir", rootKey);
+    InsertNonexisting("/dir/file", dir);
+    cache.insert("/dir", DentryCache::Entry{dir, rootKey, Dir::EntryType::DIR}, cache.generation());
+    EXPECT_EQ(dir, cache.lookup("/dir").value().key.value());
+    EXPECT_NE(none, cache.lookup("/dir/file"));
+    EXPECT_EQ(0u, cache.statistics().numEvictions);
+}
+
+TEST_F(DentryCacheTest, InsertingDifferentBlobRemovesEntriesBelow) {
+    Key dir = InsertDir("/dir", rootKey);
+    InsertNonexisting("/dir/file", dir);
+    Key newDir = InsertDir("/dir", rootKey);
+    EXPECT_EQ(newDir, cache.lookup("/dir").value().key.value());
+    EXPECT_EQ(none, cache.lookup("/dir/file"));
+}
+
+TEST_F(DentryCacheTest, LookupClosestFindsPath) {
+    Key dir = InsertDir("/dir", rootKey);
+    Key subdir = InsertDir("/dir/subdir", dir);
+    auto found = cache.lookupClosest("/dir/subdir").value();
+    EXPECT_EQ("/dir/subdir", found.first);
+    EXPECT_EQ(subdir, found.second.key.value());
+    EXPECT_EQ(1u, cache.statistics().numHits);
+}
+
+TEST_F(DentryCacheTest, LookupClosestFindsParentDirectory) {
+    Key dir = InsertDir("/dir", rootKey);
+    InsertDir("/dir/subdir", dir);
+    auto found = cache.lookupClosest("/dir/subdir/a/b").value();
+    EXPECT_EQ("/dir/subdir", found.first);
+    EXPECT_EQ(1u, cache.statistics().numMisses);
+}
+
+TEST_F(DentryCacheTest, LookupClosestFindsNonexistingParentDirectory) {
+    InsertNonexisting("/dir", rootKey);
+    auto found = cache.lookupClosest("/dir/file").value();
+    EXPECT_EQ("/dir", found.first);
+    EXPECT_FALSE(found.second.exists());
+}
+
+TEST_F(DentryCacheTest, LookupClosestMiss) {
+    InsertDir("/otherdir", rootKey);
+    EXPECT_EQ(none, cache.lookupClosest("/dir/file"));
+    EXPECT_EQ(none, cache.lookupClosest("/"));
+}
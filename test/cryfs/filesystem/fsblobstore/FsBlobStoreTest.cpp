@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include <cryfs/filesystem/fsblobstore/FsBlobStore.h>
+#include <cryfs/filesystem/fsblobstore/utils/DirEntryList.h>
+#include <blobstore/implementations/onblocks/BlobStoreOnBlocks.h>
+#include <blockstore/implementations/testfake/FakeBlockStore.h>
+#include <cpp-utils/data/DataFixture.h>
+#include <cpp-utils/pointer/cast.h>
+
+using cryfs::FsBlobView;
+using cryfs::fsblobstore::FsBlobStore;
+using cryfs::fsblobstore::DirBlob;
+using cryfs::fsblobstore::DirEntryList;
+using blobstore::BlobStore;
+using blobstore::onblocks::BlobStoreOnBlocks;
+using blockstore::Key;
+using blockstore::testfake::FakeBlockStore;
+using cpputils::Data;
+using cpputils::DataFixture;
+using cpputils::dynamic_pointer_move;
+using cpputils::make_unique_ref;
+using cpputils::unique_ref;
+
+class FsBlobStoreTest: public ::testing::Test {
+public:
+    FsBlobStoreTest(): baseBlobStore(nullptr), fsBlobStore(CreateFsBlobStore()), seed(0) {}
+
+    unique_ref<FsBlobStore> CreateFsBlobStore() {
+        auto blobStore = make_unique_ref<BlobStoreOnBlocks>(make_unique_ref<FakeBlockStore>(), 4096);
+        baseBlobStore = blobStore.get();
+        return make_unique_ref<FsBlobStore>(std::move(blobStore));
+    }
+
+    Key RandomKey() {
+        return DataFixture::generateFixedSize<Key::BINARY_LENGTH>(++seed);
+    }
+
+    void AddEntry(DirEntryList *entries, const std::string &name, const Key &key, fspp::Dir::EntryType type) {
+        entries->add(name, key, type, type == fspp::Dir::EntryType::DIR ? S_IFDIR : S_IFREG, 0, 0, cpputils::time::now(), cpputils::time::now());
+    }
+
+    // Creates a directory the way CryFS 0.9.7 and older stored it
+    Key CreateFlatDir(const DirEntryList &entries) {
+        auto blob = baseBlobStore->create();
+        FsBlobView::InitializeBlob(blob.get(), FsBlobView::BlobType::DIR);
+        uint16_t formatVersion = FsBlobView::FORMAT_VERSION_HEADER_FLAT_DIRS;
+        blob->write(&formatVersion, 0, sizeof(formatVersion));
+        FsBlobView view(std::move(blob));
+        Data serialized = entries.serialize();
+        view.resize(serialized.size());
+        view.write(serialized.data(), 0, serialized.size());
+        return view.key();
+    }
+
+    unique_ref<DirBlob> LoadDir(const Key &key) {
+        auto blob = fsBlobStore->load(key).value();
+        return dynamic_pointer_move<DirBlob>(blob).value();
+    }
+
+    uint16_t FormatVersion(const Key &key) {
+        return FsBlobView::formatVersion(*baseBlobStore->load(key).value());
+    }
+
+    BlobStore *baseBlobStore;
+    unique_ref<FsBlobStore> fsBlobStore;
+    int seed;
+};
+
+TEST_F(FsBlobStoreTest, NewDirectoryHasCurrentFormat) {
+    Key key = fsBlobStore->createDirBlob()->key();
+    EXPECT_EQ(FsBlobView::FORMAT_VERSION_HEADER, FormatVersion(key));
+}
+
+TEST_F(FsBlobStoreTest, LoadingFlatDirectoryFails) {
+    Key key = CreateFlatDir(DirEntryList());
+    EXPECT_ANY_THROW(fsBlobStore->load(key));
+}
+
+TEST_F(FsBlobStoreTest, MigratesDirectories) {
+    Key fileKey = RandomKey();
+    DirEntryList subdirEntries;
+    AddEntry(&subdirEntries, "file", fileKey, fspp::Dir::EntryType::FILE);
+    Key subdirKey = CreateFlatDir(subdirEntries);
+    DirEntryList rootEntries;
+    AddEntry(&rootEntries, "subdir", subdirKey, fspp::Dir::EntryType::DIR);
+    Key rootKey = CreateFlatDir(rootEntries);
+
+    FsBlobStore::MigrateDirectories(baseBlobStore, rootKey);
+
+    EXPECT_EQ(FsBlobView::FORMAT_VERSION_HEADER, FormatVersion(rootKey));
+    EXPECT_EQ(FsBlobView::FORMAT_VERSION_HEADER, FormatVersion(subdirKey));
+    EXPECT_EQ(subdirKey, LoadDir(rootKey)->GetChild("subdir")->key());
+    EXPECT_EQ(fileKey, LoadDir(subdirKey)->GetChild("file")->key());
+}
+
+TEST_F(FsBlobStoreTest, ContinuesInterruptedMigration) {
+    Key fileKey = RandomKey();
+    Key subdirKey = [&] {
+        // This directory was converted before the migration was interrupted
+        auto subdir = fsBlobStore->createDirBlob();
+        subdir->AddChildFile("file", fileKey, S_IFREG, 0, 0, cpputils::time::now(), cpputils::time::now());
+        return subdir->key();
+    }();
+    DirEntryList rootEntries;
+    AddEntry(&rootEntries, "subdir", subdirKey, fspp::Dir::EntryType::DIR);
+    Key rootKey = CreateFlatDir(rootEntries);
+
+    FsBlobStore::MigrateDirectories(baseBlobStore, rootKey);
+
+    EXPECT_EQ(subdirKey, LoadDir(rootKey)->GetChild("subdir")->key());
+    EXPECT_EQ(fileKey, LoadDir(subdirKey)->GetChild("file")->key());
+}
+
+TEST_F(FsBlobStoreTest, MigratingConvertedFileSystemDoesNothing) {
+    Key rootKey = fsBlobStore->createDirBlob()->key();
+    FsBlobStore::MigrateDirectories(baseBlobStore, rootKey);
+    EXPECT_EQ(0u, LoadDir(rootKey)->NumChildren());
+}
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include <cryfs/filesystem/fsblobstore/utils/TimestampUpdateBehavior.h>
+
+using cryfs::fsblobstore::AtimeUpdateBehavior;
+using cryfs::fsblobstore::shouldUpdateAccessTimestamp;
+
+class TimestampUpdateBehaviorTest: public ::testing::Test {
+public:
+    static timespec At(time_t seconds) {
+        return timespec{seconds, 0};
+    }
+
+    static constexpr time_t DAY = 24 * 60 * 60;
+};
+
+TEST_F(TimestampUpdateBehaviorTest, Strictatime_UpdatesRecentlyAccessed) {
+    EXPECT_TRUE(shouldUpdateAccessTimestamp(AtimeUpdateBehavior::STRICTATIME, At(200), At(100), At(100), At(300)));
+}
+
+TEST_F(TimestampUpdateBehaviorTest, Noatime_DoesntUpdateModified) {
+    EXPECT_FALSE(shouldUpdateAccessTimestamp(AtimeUpdateBehavior::NOATIME, At(100), At(200), At(200), At(300)));
+}
+
+TEST_F(TimestampUpdateBehaviorTest, Noatime_DoesntUpdateOld) {
+    EXPECT_FALSE(shouldUpdateAccessTimestamp(AtimeUpdateBehavior::NOATIME, At(100), At(100), At(100), At(100 + 2 * DAY)));
+}
+
+TEST_F(TimestampUpdateBehaviorTest, Relatime_DoesntUpdateRecentlyAccessed) {
+    EXPECT_FALSE(shouldUpdateAccessTimestamp(AtimeUpdateBehavior::RELATIME, At(200), At(100), At(100), At(300)));
+}
+
+TEST_F(TimestampUpdateBehaviorTest, Relatime_UpdatesIfModifiedSinceAccess) {
+    EXPECT_TRUE(shouldUpdateAccessTimestamp(AtimeUpdateBehavior::RELATIME, At(100), At(200), At(100), At(300)));
+}
+
+TEST_F(TimestampUpdateBehaviorTest, Relatime_UpdatesIfModifiedAtAccess) {
+    EXPECT_TRUE(shouldUpdateAccessTimestamp(AtimeUpdateBehavior::RELATIME, At(100), At(100), At(50), At(300)));
+}
+
+TEST_F(TimestampUpdateBehaviorTest, Relatime_UpdatesIfMetadataChangedSinceAccess) {
+    EXPECT_TRUE(shouldUpdateAccessTimestamp(AtimeUpdateBehavior::RELATIME, At(100), At(50), At(200), At(300)));
+}
+
+TEST_F(TimestampUpdateBehaviorTest, Relatime_UpdatesIfOlderThanADay) {
+    EXPECT_TRUE(shouldUpdateAccessTimestamp(AtimeUpdateBehavior::RELATIME, At(200), At(100), At(100), At(200 + DAY)));
+}
+
+TEST_F(TimestampUpdateBehaviorTest, Relatime_DoesntUpdateIfYoungerThanADay) {
+    EXPECT_FALSE(shouldUpdateAccessTimestamp(AtimeUpdateBehavior::RELATIME, At(200), At(100), At(100), At(200 + DAY - 1)));
+}
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include <cryfs/filesystem/fsblobstore/utils/dirtree/DirEntryTree.h>
+#include <blobstore/implementations/onblocks/BlobStoreOnBlocks.h>
+#include <blockstore/implementations/caching/CachingBlockStore.h>
+#include <blockstore/implementations/inmemory/InMemoryBlockStore.h>
+#include <cpp-utils/data/DataFixture.h>
+#include <chrono>
+#include <iostream>
+
+using cryfs::fsblobstore::dirtree::DirEntryTree;
+using blobstore::onblocks::BlobStoreOnBlocks;
+using blockstore::Key;
+using blockstore::caching::CachingBlockStore;
+using blockstore::inmemory::InMemoryBlockStore;
+using cpputils::DataFixture;
+using cpputils::make_unique_ref;
+
+// Microbenchmark for creating, looking up and removing entries in large directories.
+// It is disabled by default because it takes a while and doesn't check anything.
+// Run it with --gtest_also_run_disabled_tests --gtest_filter=*DirEntryTreeBenchmark*
+class DirEntryTreeBenchmark: public ::testing::Test {
+public:
+  template<class Func>
+  static double measure(Func func) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    return duration.count();
+  }
+
+  void run(uint64_t numEntries) {
+    BlobStoreOnBlocks blobStore(make_unique_ref<CachingBlockStore>(make_unique_ref<InMemoryBlockStore>()), 32 * 1024);
+    auto blob = blobStore.create();
+    DirEntryTree::Initialize(blob.get(), {});
+    DirEntryTree entries(blob.get());
+    std::vector<Key> keys;
+    keys.reserve(numEntries);
+    for (uint64_t i = 0; i < numEntries; ++i) {
+      keys.push_back(DataFixture::generateFixedSize<Key::BINARY_LENGTH>(i));
+    }
+    auto now = cpputils::time::now();
+    double create = measure([&] {
+      for (uint64_t i = 0; i < numEntries; ++i) {
+        entries.add("file" + std::to_string(i), keys[i], fspp::Dir::EntryType::FILE, S_IFREG, 0, 0, now, now, UINT64_C(0));
+      }
+      entries.flush();
+    });
+    double lookup = measure([&] {
+      for (uint64_t i = 0; i < numEntries; ++i) {
+        entries.get("file" + std::to_string(i));
+      }
+    });
+    double remove = measure([&] {
+      for (uint64_t i = 0; i < numEntries; ++i) {
+        entries.remove(keys[i]);
+      }
+      entries.flush();
+    });
+    std::cout << numEntries << " entries: create " << create << "s, lookup " << lookup << "s, remove " << remove << "s" << std::endl;
+  }
+};
+
+TEST_F(DirEntryTreeBenchmark, DISABLED_CreateLookupRemove) {
+  for (uint64_t numEntries : {10000, 100000, 1000000}) {
+    run(numEntries);
+  }
+}
@@ -0,0 +1,336 @@
+#include <gtest/gtest.h>
+#include <cryfs/filesystem/fsblobstore/utils/dirtree/DirEntryTree.h>
+#include <cryfs/filesystem/fsblobstore/utils/DirEntryList.h>
+#include <blobstore/implementations/onblocks/BlobStoreOnBlocks.h>
+#include <blockstore/implementations/testfake/FakeBlockStore.h>
+#include <cpp-utils/data/DataFixture.h>
+#include <set>
+
+using cryfs::fsblobstore::dirtree::DirEntryTree;
+using cryfs::fsblobstore::dirtree::PageStore;
+using cryfs::fsblobstore::DirEntry;
+using cryfs::fsblobstore::DirEntryList;
+using cryfs::fsblobstore::AtimeUpdateBehavior;
+using blobstore::Blob;
+using blobstore::onblocks::BlobStoreOnBlocks;
+using blockstore::Key;
+using blockstore::testfake::FakeBlockStore;
+using cpputils::Data;
+using cpputils::DataFixture;
+using cpputils::make_unique_ref;
+using cpputils::unique_ref;
+using boost::none;
+
+// Counts the bytes read from and written to the blob
+class AccessCountingBlob final: public Blob {
+public:
+    explicit AccessCountingBlob(Blob *baseBlob): baseBlob(baseBlob), bytesRead(0), bytesWritten(0) {}
+
+    const Key &key() const override { return baseBlob->key(); }
+    uint64_t size() const override { return baseBlob->size(); }
+    void resize(uint64_t numBytes) override { baseBlob->resize(numBytes); }
+    Data readAll() const override { bytesRead += size(); return baseBlob->readAll(); }
+    void read(void *target, uint64_t offset, uint64_t size) const override { bytesRead += size; baseBlob->read(target, offset, size); }
+    uint64_t tryRead(void *target, uint64_t offset, uint64_t size) const override { bytesRead += size; return baseBlob->tryRead(target, offset, size); }
+    void write(const void *source, uint64_t offset, uint64_t size) override { bytesWritten += size; baseBlob->write(source, offset, size); }
+    void writeInPlace(uint64_t offset, uint64_t size, const std::function<void (void *target, uint64_t size)> &fill) override { bytesWritten += size; baseBlob->writeInPlace(offset, size, fill); }
+    void prefetch(uint64_t offset, uint64_t size) const override { baseBlob->prefetch(offset, size); }
+    boost::optional<uint64_t> seekData(uint64_t offset) const override { return baseBlob->seekData(offset); }
+    boost::optional<uint64_t> seekHole(uint64_t offset) const override { return baseBlob->seekHole(offset); }
+    void flush() override { baseBlob->flush(); }
+
+    Blob *baseBlob;
+    mutable uint64_t bytesRead;
+    uint64_t bytesWritten;
+};
+
+class DirEntryTreeTest: public ::testing::Test {
+public:
+    DirEntryTreeTest(): blobStore(make_unique_ref<FakeBlockStore>(), 4096), blob(CreateDirectory({})), entries(blob.get()), seed(0) {}
+
+    unique_ref<Blob> CreateDirectory(const std::vector<DirEntry> &initialEntries) {
+        auto created = blobStore.create();
+        DirEntryTree::Initialize(created.get(), initialEntries);
+        return created;
+    }
+
+    Key RandomKey() {
+        return DataFixture::generateFixedSize<Key::BINARY_LENGTH>(++seed);
+    }
+
+    void Add(const std::string &name, const Key &key) {
+        entries.add(name, key, fspp::Dir::EntryType::FILE, S_IFREG, 0, 0, cpputils::time::now(), cpputils::time::now(), UINT64_C(0));
+    }
+
+    std::vector<Key> AddMany(int count) {
+        std::vector<Key> keys;
+        for (int i = 0; i < count; ++i) {
+            keys.push_back(RandomKey());
+            Add("entry" + std::to_string(i), keys.back());
+        }
+        return keys;
+    }
+
+    BlobStoreOnBlocks blobStore;
+    unique_ref<Blob> blob;
+    DirEntryTree entries;
+    int seed;
+};
+
+TEST_F(DirEntryTreeTest, InitializedDirectoryIsEmpty) {
+    EXPECT_TRUE(PageStore::IsPageStore(*blob));
+    EXPECT_EQ(0u, entries.size());
+    EXPECT_EQ(none, entries.get("name"));
+}
+
+TEST_F(DirEntryTreeTest, SmallDirectoryTakesOnePage) {
+    auto keys = AddMany(10);
+    entries.flush();
+    EXPECT_EQ(PageStore::PAGE_SIZE, blob->size());
+    EXPECT_EQ(keys[5], entries.get("entry5")->key());
+    EXPECT_EQ("entry5", entries.get(keys[5])->name());
+}
+
+TEST_F(DirEntryTreeTest, LargeDirectoryTakesMorePages) {
+    auto keys = AddMany(100);
+    entries.flush();
+    EXPECT_LT(PageStore::PAGE_SIZE, blob->size());
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(keys[i], entries.get("entry" + std::to_string(i))->key());
+    }
+}
+
+TEST_F(DirEntryTreeTest, RenamingToLongNameInSmallDirectory) {
+    auto keys = AddMany(10);
+    std::string longName(900, 'a');
+    entries.rename(keys[3], longName, [] (const Key &) {});
+    entries.rename(keys[4], longName + "b", [] (const Key &) {});
+    entries.rename(keys[5], longName + "c", [] (const Key &) {});
+    entries.rename(keys[6], longName + "d", [] (const Key &) {});
+    EXPECT_EQ(10u, entries.size());
+    EXPECT_EQ(keys[3], entries.get(longName)->key());
+    EXPECT_EQ(longName + "d", entries.get(keys[6])->name());
+    EXPECT_EQ(keys[7], entries.get("entry7")->key());
+}
+
+TEST_F(DirEntryTreeTest, GetByName) {
+    Key key = RandomKey();
+    Add("first", RandomKey());
+    Add("second", key);
+    EXPECT_EQ(key, entries.get("second")->key());
+    EXPECT_EQ("second", entries.get("second")->name());
+    EXPECT_EQ(none, entries.get("nonexisting"));
+}
+
+TEST_F(DirEntryTreeTest, GetByKey) {
+    Key key = RandomKey();
+    Add("first", RandomKey());
+    Add("second", key);
+    EXPECT_EQ("second", entries.get(key)->name());
+}
+
+TEST_F(DirEntryTreeTest, AddingExistingNameFails) {
+    Add("name", RandomKey());
+    EXPECT_ANY_THROW(Add("name", RandomKey()));
+    EXPECT_EQ(1u, entries.size());
+}
+
+TEST_F(DirEntryTreeTest, ManyEntries) {
+    auto keys = AddMany(5000);
+    EXPECT_EQ(5000u, entries.size());
+    for (int i = 0; i < 5000; ++i) {
+        EXPECT_EQ(keys[i], entries.get("entry" + std::to_string(i))->key());
+        EXPECT_EQ("entry" + std::to_string(i), entries.get(keys[i])->name());
+    }
+}
+
+TEST_F(DirEntryTreeTest, ForEachVisitsAllEntries) {
+    AddMany(1000);
+    std::set<std::string> names;
+    entries.forEach([&names] (const DirEntry &entry) {
+        names.insert(entry.name());
+    });
+    EXPECT_EQ(1000u, names.size());
+    EXPECT_EQ(1u, names.count("entry500"));
+}
+
+TEST_F(DirEntryTreeTest, RemoveByName) {
+    auto keys = AddMany(1000);
+    for (int i = 0; i < 1000; i += 2) {
+        entries.remove("entry" + std::to_string(i));
+    }
+    EXPECT_EQ(500u, entries.size());
+    EXPECT_EQ(none, entries.get("entry10"));
+    EXPECT_EQ(keys[11], entries.get("entry11")->key());
+    EXPECT_ANY_THROW(entries.get(keys[10]));
+}
+
+TEST_F(DirEntryTreeTest, RemoveByKey) {
+    auto keys = AddMany(1000);
+    for (int i = 0; i < 1000; ++i) {
+        entries.remove(keys[i]);
+    }
+    EXPECT_EQ(0u, entries.size());
+    EXPECT_EQ(none, entries.get("entry10"));
+}
+
+TEST_F(DirEntryTreeTest, RemovingNonexistingNameFails) {
+    EXPECT_ANY_THROW(entries.remove("nonexisting"));
+}
+
+TEST_F(DirEntryTreeTest, Rename) {
+    Key key = RandomKey();
+    Add("oldname", key);
+    entries.rename(key, "newname", [] (const Key &) {});
+    EXPECT_EQ(none, entries.get("oldname"));
+    EXPECT_EQ(key, entries.get("newname")->key());
+    EXPECT_EQ("newname", entries.get(key)->name());
+}
+
+TEST_F(DirEntryTreeTest, RenameOverwritingEntry) {
+    Key key = RandomKey();
+    Key overwrittenKey = RandomKey();
+    Add("oldname", key);
+    Add("newname", overwrittenKey);
+    bool overwritten = false;
+    entries.rename(key, "newname", [&] (const Key &k) {EXPECT_EQ(overwrittenKey, k); overwritten = true;});
+    EXPECT_TRUE(overwritten);
+    EXPECT_EQ(1u, entries.size());
+    EXPECT_EQ(key, entries.get("newname")->key());
+}
+
+TEST_F(DirEntryTreeTest, RenameToTooLongNameKeepsEntry) {
+    Key key = RandomKey();
+    Add("oldname", key);
+    EXPECT_ANY_THROW(entries.rename(key, std::string(5000, 'a'), [] (const Key &) {}));
+    EXPECT_EQ(key, entries.get("oldname")->key());
+}
+
+TEST_F(DirEntryTreeTest, SetMode) {
+    Key key = RandomKey();
+    Add("name", key);
+    entries.setMode(key, S_IFREG | S_IRUSR);
+    EXPECT_EQ(static_cast<mode_t>(S_IFREG | S_IRUSR), entries.get("name")->mode());
+}
+
+TEST_F(DirEntryTreeTest, Size) {
+    Key key = RandomKey();
+    entries.add("name", key, fspp::Dir::EntryType::FILE, S_IFREG, 0, 0, cpputils::time::now(), cpputils::time::now(), UINT64_C(10));
+    EXPECT_EQ(10u, entries.get("name")->size().value());
+    entries.setSize(key, 20);
+    EXPECT_EQ(20u, entries.get(key)->size().value());
+    entries.updateModificationTimestampAndSizeForChild(key, 30);
+    EXPECT_EQ(30u, entries.get(key)->size().value());
+}
+
+TEST_F(DirEntryTreeTest, UnknownSize) {
+    Key key = RandomKey();
+    entries.add("name", key, fspp::Dir::EntryType::SYMLINK, S_IFLNK, 0, 0, cpputils::time::now(), cpputils::time::now(), none);
+    EXPECT_EQ(none, entries.get("name")->size());
+}
+
+TEST_F(DirEntryTreeTest, SizeIsKeptWhenRenaming) {
+    Key key = RandomKey();
+    entries.add("oldname", key, fspp::Dir::EntryType::FILE, S_IFREG, 0, 0, cpputils::time::now(), cpputils::time::now(), UINT64_C(10));
+    entries.rename(key, "newname", [] (const Key &) {});
+    EXPECT_EQ(10u, entries.get("newname")->size().value());
+}
+
+TEST_F(DirEntryTreeTest, SettingSizeOfNonexistingEntryIsIgnored) {
+    entries.setSize(RandomKey(), 10);
+    EXPECT_EQ(0u, entries.size());
+}
+
+TEST_F(DirEntryTreeTest, SetSizeIfUnknown) {
+    Key unknownSizeKey = RandomKey();
+    Key knownSizeKey = RandomKey();
+    entries.add("unknown", unknownSizeKey, fspp::Dir::EntryType::FILE, S_IFREG, 0, 0, cpputils::time::now(), cpputils::time::now(), none);
+    entries.add("known", knownSizeKey, fspp::Dir::EntryType::FILE, S_IFREG, 0, 0, cpputils::time::now(), cpputils::time::now(), UINT64_C(10));
+    entries.setSizeIfUnknown(unknownSizeKey, 20);
+    entries.setSizeIfUnknown(knownSizeKey, 20);
+    entries.setSizeIfUnknown(RandomKey(), 20);
+    EXPECT_EQ(20u, entries.get(unknownSizeKey)->size().value());
+    EXPECT_EQ(10u, entries.get(knownSizeKey)->size().value());
+    EXPECT_EQ(2u, entries.size());
+}
+
+TEST_F(DirEntryTreeTest, SetDeferredTimestamps) {
+    Key key = RandomKey();
+    Add("name", key);
+    entries.setDeferredTimestamps(key, timespec{300, 0}, timespec{200, 0}, AtimeUpdateBehavior::STRICTATIME);
+    EXPECT_EQ((timespec{300, 0}), entries.get(key)->lastAccessTime());
+    EXPECT_EQ((timespec{200, 0}), entries.get(key)->lastModificationTime());
+}
+
+TEST_F(DirEntryTreeTest, SetDeferredTimestampsWithoutChangesKeepsEntry) {
+    Key key = RandomKey();
+    Add("name", key);
+    DirEntry before = entries.get(key).value();
+    entries.setDeferredTimestamps(key, before.lastAccessTime(), before.lastModificationTime(), AtimeUpdateBehavior::STRICTATIME);
+    EXPECT_EQ(before.lastMetadataChangeTime(), entries.get(key)->lastMetadataChangeTime());
+}
+
+TEST_F(DirEntryTreeTest, LoadExisting) {
+    auto keys = AddMany(1000);
+    entries.setUidGid(keys[3], 1000, 1001);
+    entries.setSize(keys[4], 1234);
+    entries.flush();
+    DirEntryTree loaded(blob.get());
+    EXPECT_EQ(1000u, loaded.size());
+    EXPECT_EQ(1234u, loaded.get(keys[4])->size().value());
+    EXPECT_EQ(keys[500], loaded.get("entry500")->key());
+    EXPECT_EQ(1001u, loaded.get(keys[3])->gid());
+}
+
+TEST_F(DirEntryTreeTest, LookupInLargeDirectoryOnlyReadsSomePages) {
+    auto keys = AddMany(5000);
+    entries.flush();
+    AccessCountingBlob countingBlob(blob.get());
+    DirEntryTree loaded(&countingBlob);
+    countingBlob.bytesRead = 0;
+    EXPECT_EQ(keys[2500], loaded.get("entry2500")->key());
+    EXPECT_EQ("entry2501", loaded.get(keys[2501])->name());
+    EXPECT_LT(countingBlob.bytesRead, blob->size() / 10);
+}
+
+TEST_F(DirEntryTreeTest, ChangingEntryInLargeDirectoryOnlyWritesChangedPages) {
+    auto keys = AddMany(5000);
+    entries.flush();
+    AccessCountingBlob countingBlob(blob.get());
+    DirEntryTree loaded(&countingBlob);
+    loaded.setMode(keys[2500], S_IFREG | S_IRUSR);
+    loaded.flush();
+    EXPECT_LE(countingBlob.bytesWritten, PageStore::PAGE_SIZE);
+    EXPECT_LT(countingBlob.bytesWritten, blob->size() / 10);
+}
+
+TEST_F(DirEntryTreeTest, LoadExistingSmallDirectory) {
+    auto keys = AddMany(10);
+    entries.setSize(keys[4], 1234);
+    entries.remove(keys[2]);
+    entries.flush();
+    DirEntryTree loaded(blob.get());
+    EXPECT_EQ(9u, loaded.size());
+    EXPECT_EQ(1234u, loaded.get(keys[4])->size().value());
+    EXPECT_EQ(keys[5], loaded.get("entry5")->key());
+    EXPECT_EQ(none, loaded.get("entry2"));
+}
+
+TEST_F(DirEntryTreeTest, InitializeWithEntries) {
+    DirEntryList flat;
+    std::vector<Key> keys;
+    for (int i = 0; i < 1000; ++i) {
+        keys.push_back(RandomKey());
+        flat.add("entry" + std::to_string(i), keys.back(), fspp::Dir::EntryType::DIR, S_IFDIR, 0, 0, cpputils::time::now(), cpputils::time::now());
+    }
+    auto initializedBlob = CreateDirectory(std::vector<DirEntry>(flat.begin(), flat.end()));
+
+    DirEntryTree initialized(initializedBlob.get());
+    EXPECT_EQ(1000u, initialized.size());
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(keys[i], initialized.get("entry" + std::to_string(i))->key());
+        EXPECT_EQ(fspp::Dir::EntryType::DIR, initialized.get(keys[i])->type());
+        // The flat format didn't store sizes
+        EXPECT_EQ(none, initialized.get(keys[i])->size());
+    }
+}
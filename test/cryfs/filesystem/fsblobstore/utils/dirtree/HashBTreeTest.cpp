@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+#include <cryfs/filesystem/fsblobstore/utils/dirtree/HashBTree.h>
+#include <blobstore/implementations/onblocks/BlobStoreOnBlocks.h>
+#include <blockstore/implementations/testfake/FakeBlockStore.h>
+#include <cpp-utils/data/DataFixture.h>
+#include <map>
+
+using cryfs::fsblobstore::dirtree::HashBTree;
+using cryfs::fsblobstore::dirtree::PageStore;
+using blobstore::Blob;
+using blobstore::onblocks::BlobStoreOnBlocks;
+using blockstore::testfake::FakeBlockStore;
+using cpputils::Data;
+using cpputils::DataFixture;
+using cpputils::make_unique_ref;
+using cpputils::unique_ref;
+
+class HashBTreeTest: public ::testing::Test {
+public:
+    HashBTreeTest(): blobStore(make_unique_ref<FakeBlockStore>(), 4096), blob(blobStore.create()), pages(Initialized(blob.get())), tree(&pages, HashBTree::CreateEmpty(&pages)) {}
+
+    static Blob *Initialized(Blob *blob) {
+        PageStore::Initialize(blob);
+        return blob;
+    }
+
+    static Data Value(int seed) {
+        return DataFixture::generate(100, seed);
+    }
+
+    static std::function<bool (const Data&)> Equals(const Data &expected) {
+        return [&expected] (const Data &value) {return value == expected;};
+    }
+
+    // Returns all stored values, grouped by hash
+    std::multimap<uint64_t, Data> All() {
+        std::multimap<uint64_t, Data> result;
+        tree.forEach([&result] (uint64_t hash, const Data &value) {
+            result.emplace(hash, value.copy());
+        });
+        return result;
+    }
+
+    BlobStoreOnBlocks blobStore;
+    unique_ref<Blob> blob;
+    PageStore pages;
+    HashBTree tree;
+};
+
+TEST_F(HashBTreeTest, FindInEmptyTree) {
+    EXPECT_EQ(0u, tree.find(5).size());
+}
+
+TEST_F(HashBTreeTest, InsertAndFind) {
+    tree.insert(5, Value(1));
+    tree.insert(3, Value(2));
+    ASSERT_EQ(1u, tree.find(5).size());
+    EXPECT_EQ(Value(1), tree.find(5)[0]);
+    EXPECT_EQ(Value(2), tree.find(3)[0]);
+    EXPECT_EQ(0u, tree.find(4).size());
+}
+
+TEST_F(HashBTreeTest, MultipleValuesForSameHash) {
+    tree.insert(5, Value(1));
+    tree.insert(5, Value(2));
+    EXPECT_EQ(2u, tree.find(5).size());
+    EXPECT_TRUE(tree.removeIf(5, Equals(Value(1))));
+    ASSERT_EQ(1u, tree.find(5).size());
+    EXPECT_EQ(Value(2), tree.find(5)[0]);
+}
+
+TEST_F(HashBTreeTest, ReplaceIf) {
+    tree.insert(5, Value(1));
+    EXPECT_FALSE(tree.replaceIf(5, Equals(Value(2)), Value(3)));
+    EXPECT_TRUE(tree.replaceIf(5, Equals(Value(1)), Value(3)));
+    ASSERT_EQ(1u, tree.find(5).size());
+    EXPECT_EQ(Value(3), tree.find(5)[0]);
+}
+
+TEST_F(HashBTreeTest, RemoveNonexisting) {
+    tree.insert(5, Value(1));
+    EXPECT_FALSE(tree.removeIf(4, Equals(Value(1))));
+    EXPECT_FALSE(tree.removeIf(5, Equals(Value(2))));
+}
+
+TEST_F(HashBTreeTest, ManyValuesSplitNodes) {
+    uint32_t initialRoot = tree.rootPage();
+    for (int i = 0; i < 2000; ++i) {
+        tree.insert(i * 7919 % 2000, Value(i));
+    }
+    EXPECT_NE(initialRoot, tree.rootPage());
+    for (int i = 0; i < 2000; ++i) {
+        auto found = tree.find(i * 7919 % 2000);
+        ASSERT_EQ(1u, found.size());
+        EXPECT_EQ(Value(i), found[0]);
+    }
+}
+
+TEST_F(HashBTreeTest, ForEachIsOrderedByHash) {
+    for (int i = 0; i < 2000; ++i) {
+        tree.insert(i * 7919 % 2000, Value(i));
+    }
+    uint64_t numValues = 0;
+    uint64_t lastHash = 0;
+    tree.forEach([&] (uint64_t hash, const Data &) {
+        EXPECT_LE(lastHash, hash);
+        lastHash = hash;
+        ++numValues;
+    });
+    EXPECT_EQ(2000u, numValues);
+}
+
+TEST_F(HashBTreeTest, RemovingAllValuesFreesPages) {
+    for (int i = 0; i < 2000; ++i) {
+        tree.insert(i, Value(i));
+    }
+    pages.flush();
+    uint64_t size = blob->size();
+    for (int i = 0; i < 2000; ++i) {
+        EXPECT_TRUE(tree.removeIf(i, Equals(Value(i))));
+    }
+    EXPECT_EQ(0u, All().size());
+    // Freed pages are reused, so inserting the values again doesn't grow the blob
+    for (int i = 0; i < 2000; ++i) {
+        tree.insert(i, Value(i));
+    }
+    pages.flush();
+    EXPECT_EQ(size, blob->size());
+}
+
+TEST_F(HashBTreeTest, ManyValuesForSameHashAmongOthers) {
+    for (int i = 0; i < 500; ++i) {
+        tree.insert(i, Value(i));
+    }
+    for (int i = 0; i < 20; ++i) {
+        tree.insert(250, Value(1000 + i));
+    }
+    EXPECT_EQ(21u, tree.find(250).size());
+    EXPECT_EQ(1u, tree.find(249).size());
+    EXPECT_EQ(1u, tree.find(251).size());
+}
+
+TEST_F(HashBTreeTest, LoadExistingTree) {
+    for (int i = 0; i < 500; ++i) {
+        tree.insert(i, Value(i));
+    }
+    pages.flush();
+    PageStore loadedPages(blob.get());
+    HashBTree loaded(&loadedPages, tree.rootPage());
+    EXPECT_EQ(Value(123), loaded.find(123)[0]);
+}
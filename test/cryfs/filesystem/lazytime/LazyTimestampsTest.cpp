@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+#include <cryfs/filesystem/lazytime/LazyTimestamps.h>
+#include <cpp-utils/data/DataFixture.h>
+#include <cpp-utils/lock/ConditionBarrier.h>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+using cryfs::lazytime::LazyTimestamps;
+using cryfs::fsblobstore::AtimeUpdateBehavior;
+using blockstore::Key;
+using cpputils::DataFixture;
+using cpputils::ConditionBarrier;
+using boost::none;
+
+class LazyTimestampsTest: public ::testing::Test {
+public:
+    LazyTimestampsTest(): key(DataFixture::generateFixedSize<Key::BINARY_LENGTH>(1)), timestamps(std::chrono::hours(1)) {}
+
+    static timespec At(time_t seconds) {
+        return timespec{seconds, 0};
+    }
+
+    static struct ::stat StoredStat() {
+        struct ::stat result;
+        std::memset(&result, 0, sizeof(result));
+        result.st_size = 10;
+        result.st_atim = At(200);
+        result.st_mtim = At(100);
+        result.st_ctim = At(100);
+        return result;
+    }
+
+    Key key;
+    LazyTimestamps timestamps;
+};
+
+TEST_F(LazyTimestampsTest, TakeWithoutUpdates) {
+    EXPECT_EQ(none, timestamps.take(key));
+}
+
+TEST_F(LazyTimestampsTest, TakeAccessed) {
+    timestamps.accessed(key, At(300));
+    auto updates = timestamps.take(key).value();
+    EXPECT_EQ(At(300), updates.lastAccessTime.value());
+    EXPECT_EQ(none, updates.lastModificationTime);
+}
+
+TEST_F(LazyTimestampsTest, TakeModified) {
+    timestamps.modified(key, At(300));
+    auto updates = timestamps.take(key).value();
+    EXPECT_EQ(none, updates.lastAccessTime);
+    EXPECT_EQ(At(300), updates.lastModificationTime.value());
+}
+
+TEST_F(LazyTimestampsTest, CoalescesUpdates) {
+    timestamps.modified(key, At(300));
+    timestamps.accessed(key, At(400));
+    timestamps.modified(key, At(500));
+    auto updates = timestamps.take(key).value();
+    EXPECT_EQ(At(400), updates.lastAccessTime.value());
+    EXPECT_EQ(At(500), updates.lastModificationTime.value());
+}
+
+TEST_F(LazyTimestampsTest, TakeRemovesUpdates) {
+    timestamps.accessed(key, At(300));
+    timestamps.take(key);
+    EXPECT_EQ(none, timestamps.take(key));
+}
+
+TEST_F(LazyTimestampsTest, Discard) {
+    timestamps.accessed(key, At(300));
+    timestamps.discard(key);
+    EXPECT_EQ(none, timestamps.take(key));
+}
+
+TEST_F(LazyTimestampsTest, KeepsUpdatesOfDifferentNodesApart) {
+    Key otherKey = DataFixture::generateFixedSize<Key::BINARY_LENGTH>(2);
+    timestamps.accessed(key, At(300));
+    EXPECT_EQ(none, timestamps.take(otherKey));
+    EXPECT_NE(none, timestamps.take(key));
+}
+
+TEST_F(LazyTimestampsTest, NotExpiredWithoutUpdates) {
+    LazyTimestamps immediatelyExpiring(std::chrono::seconds(0));
+    EXPECT_FALSE(immediatelyExpiring.expired(key));
+}
+
+TEST_F(LazyTimestampsTest, NotExpiredBeforeMaxDelay) {
+    timestamps.accessed(key, At(300));
+    EXPECT_FALSE(timestamps.expired(key));
+}
+
+TEST_F(LazyTimestampsTest, ExpiredAfterMaxDelay) {
+    LazyTimestamps immediatelyExpiring(std::chrono::seconds(0));
+    immediatelyExpiring.accessed(key, At(300));
+    EXPECT_TRUE(immediatelyExpiring.expired(key));
+}
+
+TEST_F(LazyTimestampsTest, ApplyWithoutUpdates) {
+    struct ::stat st = StoredStat();
+    timestamps.applyTo(key, AtimeUpdateBehavior::STRICTATIME, &st);
+    EXPECT_EQ(10, st.st_size);
+    EXPECT_EQ(At(200), st.st_atim);
+    EXPECT_EQ(At(100), st.st_mtim);
+}
+
+TEST_F(LazyTimestampsTest, ApplyModified) {
+    timestamps.modified(key, At(300));
+    struct ::stat st = StoredStat();
+    timestamps.applyTo(key, AtimeUpdateBehavior::STRICTATIME, &st);
+    EXPECT_EQ(10, st.st_size);
+    EXPECT_EQ(At(200), st.st_atim);
+    EXPECT_EQ(At(300), st.st_mtim);
+    EXPECT_EQ(At(300), st.st_ctim);
+}
+
+TEST_F(LazyTimestampsTest, ApplyAccessed_Strictatime) {
+    timestamps.accessed(key, At(300));
+    struct ::stat st = StoredStat();
+    timestamps.applyTo(key, AtimeUpdateBehavior::STRICTATIME, &st);
+    EXPECT_EQ(At(300), st.st_atim);
+}
+
+TEST_F(LazyTimestampsTest, ApplyAccessed_Relatime) {
+    timestamps.accessed(key, At(300));
+    struct ::stat st = StoredStat();
+    timestamps.applyTo(key, AtimeUpdateBehavior::RELATIME, &st);
+    EXPECT_EQ(At(200), st.st_atim);
+}
+
+TEST_F(LazyTimestampsTest, ApplyAccessedAfterModified_Relatime) {
+    timestamps.modified(key, At(300));
+    timestamps.accessed(key, At(400));
+    struct ::stat st = StoredStat();
+    timestamps.applyTo(key, AtimeUpdateBehavior::RELATIME, &st);
+    EXPECT_EQ(At(400), st.st_atim);
+}
+
+TEST_F(LazyTimestampsTest, WritesBackExpiredUpdatesInBackground) {
+    LazyTimestamps immediatelyExpiring(std::chrono::seconds(0));
+    ConditionBarrier writtenBack;
+    immediatelyExpiring.addWriteBack(key, [&] {
+        immediatelyExpiring.take(key);
+        writtenBack.release();
+    });
+    immediatelyExpiring.accessed(key, At(300));
+    writtenBack.wait();
+    EXPECT_EQ(none, immediatelyExpiring.take(key));
+}
+
+TEST_F(LazyTimestampsTest, DoesntWriteBackUpdatesBeforeMaxDelay) {
+    std::atomic<bool> writtenBack(false);
+    timestamps.addWriteBack(key, [&] {writtenBack = true;});
+    timestamps.accessed(key, At(300));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_FALSE(writtenBack);
+}
+
+TEST_F(LazyTimestampsTest, DoesntCallRemovedWriteBack) {
+    LazyTimestamps immediatelyExpiring(std::chrono::seconds(0));
+    std::atomic<bool> writtenBack(false);
+    uint64_t id = immediatelyExpiring.addWriteBack(key, [&] {writtenBack = true;});
+    immediatelyExpiring.removeWriteBack(id);
+    immediatelyExpiring.accessed(key, At(300));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_FALSE(writtenBack);
+}
@@ -8,9 +8,9 @@
 
 class CryTestBase {
 public:
-    CryTestBase(): _configFile(false), _device(nullptr) {
+    explicit CryTestBase(cryfs::fsblobstore::AtimeUpdateBehavior atimeBehavior = cryfs::fsblobstore::AtimeUpdateBehavior::STRICTATIME, bool lazytime = false): _configFile(false), _device(nullptr) {
         auto fakeBlockStore = cpputils::make_unique_ref<blockstore::testfake::FakeBlockStore>();
-        _device = std::make_unique<cryfs::CryDevice>(configFile(), std::move(fakeBlockStore));
+        _device = std::make_unique<cryfs::CryDevice>(configFile(), std::move(fakeBlockStore), boost::none, atimeBehavior, lazytime);
     }
 
     cryfs::CryConfigFile configFile() {
@@ -21,6 +21,10 @@ public:
         return cryfs::CryConfigFile::create(_configFile.path(), std::move(config), "mypassword", cpputils::SCrypt::TestSettings);
     }
 
+    cryfs::CryConfig loadConfig() {
+        return *cryfs::CryConfigFile::load(_configFile.path(), "mypassword").value().config();
+    }
+
     cryfs::CryDevice &device() {
         return *_device;
     }
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include "fspp/fuse/InodeTable.h"
+
+using fspp::fuse::InodeTable;
+using boost::none;
+
+class InodeTableTest: public ::testing::Test {
+public:
+  static constexpr uint64_t ROOT = InodeTable::ROOT_INODE;
+
+  InodeTableTest(): inodes() {}
+
+  InodeTable inodes;
+};
+constexpr uint64_t InodeTableTest::ROOT;
+
+TEST_F(InodeTableTest, RootPath) {
+  EXPECT_EQ("/", inodes.path(ROOT).value());
+}
+
+TEST_F(InodeTableTest, UnknownInode) {
+  EXPECT_EQ(none, inodes.path(5));
+}
+
+TEST_F(InodeTableTest, NestedPath) {
+  inodes.addLookup(ROOT, "dir", 10);
+  inodes.addLookup(10, "file", 11);
+  EXPECT_EQ("/dir/file", inodes.path(11).value());
+  EXPECT_EQ(11u, inodes.child(10, "file").value());
+  EXPECT_EQ(10u, inodes.parent(11).value());
+}
+
+TEST_F(InodeTableTest, GeneratesInodeIfFilesystemDoesntProvideOne) {
+  uint64_t inode = inodes.addLookup(ROOT, "file", 0);
+  EXPECT_NE(0u, inode);
+  EXPECT_NE(ROOT, inode);
+  EXPECT_EQ(inode, inodes.addLookup(ROOT, "file", 0));
+  EXPECT_NE(inode, inodes.addLookup(ROOT, "otherfile", 0));
+}
+
+TEST_F(InodeTableTest, ForgetRemovesInodeAfterAllLookups) {
+  inodes.addLookup(ROOT, "file", 10);
+  inodes.addLookup(ROOT, "file", 10);
+  inodes.forget(10, 1);
+  EXPECT_EQ("/file", inodes.path(10).value());
+  inodes.forget(10, 1);
+  EXPECT_EQ(none, inodes.path(10));
+  EXPECT_EQ(none, inodes.child(ROOT, "file"));
+  EXPECT_EQ(1u, inodes.size());
+}
+
+TEST_F(InodeTableTest, RootIsNeverForgotten) {
+  inodes.forget(ROOT, 100);
+  EXPECT_EQ("/", inodes.path(ROOT).value());
+}
+
+TEST_F(InodeTableTest, Remove) {
+  inodes.addLookup(ROOT, "file", 10);
+  EXPECT_EQ(10u, inodes.remove(ROOT, "file").value());
+  EXPECT_EQ(none, inodes.path(10));
+  EXPECT_EQ(none, inodes.child(ROOT, "file"));
+  // The kernel didn't forget it yet
+  EXPECT_EQ(2u, inodes.size());
+}
+
+TEST_F(InodeTableTest, RemoveUnknown) {
+  EXPECT_EQ(none, inodes.remove(ROOT, "file"));
+}
+
+TEST_F(InodeTableTest, Rename) {
+  inodes.addLookup(ROOT, "dir", 10);
+  inodes.addLookup(ROOT, "file", 11);
+  EXPECT_EQ(none, inodes.rename(ROOT, "file", 10, "newname"));
+  EXPECT_EQ("/dir/newname", inodes.path(11).value());
+  EXPECT_EQ(none, inodes.child(ROOT, "file"));
+}
+
+TEST_F(InodeTableTest, RenameMovesChildren) {
+  inodes.addLookup(ROOT, "dir", 10);
+  inodes.addLookup(10, "file", 11);
+  inodes.rename(ROOT, "dir", ROOT, "newdir");
+  EXPECT_EQ("/newdir/file", inodes.path(11).value());
+}
+
+TEST_F(InodeTableTest, RenameOverwritingEntry) {
+  inodes.addLookup(ROOT, "file", 10);
+  inodes.addLookup(ROOT, "existing", 11);
+  EXPECT_EQ(11u, inodes.rename(ROOT, "file", ROOT, "existing").value());
+  EXPECT_EQ("/existing", inodes.path(10).value());
+  EXPECT_EQ(none, inodes.path(11));
+}
+
+TEST_F(InodeTableTest, LookupAtNewLocationMovesInode) {
+  inodes.addLookup(ROOT, "oldname", 10);
+  inodes.addLookup(ROOT, "newname", 10);
+  EXPECT_EQ("/newname", inodes.path(10).value());
+  EXPECT_EQ(none, inodes.child(ROOT, "oldname"));
+}
+
+TEST_F(InodeTableTest, LookupOfReplacedEntryUnlinksOldInode) {
+  inodes.addLookup(ROOT, "file", 10);
+  inodes.addLookup(ROOT, "file", 11);
+  EXPECT_EQ(none, inodes.path(10));
+  EXPECT_EQ("/file", inodes.path(11).value());
+}
@@ -0,0 +1,31 @@
+#include "testutils/FuseFsyncDirTest.h"
+
+using ::testing::StrEq;
+using ::testing::Return;
+
+class FuseFsyncDirDirnameTest: public FuseFsyncDirTest {
+};
+
+TEST_F(FuseFsyncDirDirnameTest, FsyncRootDir) {
+  EXPECT_CALL(fsimpl, fsyncDir(StrEq("/")))
+    .Times(1).WillOnce(Return());
+
+  FsyncDir("/");
+}
+
+TEST_F(FuseFsyncDirDirnameTest, FsyncDir) {
+  ReturnIsDirOnLstat("/mydir");
+  EXPECT_CALL(fsimpl, fsyncDir(StrEq("/mydir")))
+    .Times(1).WillOnce(Return());
+
+  FsyncDir("/mydir");
+}
+
+TEST_F(FuseFsyncDirDirnameTest, FsyncDirNested) {
+  ReturnIsDirOnLstat("/mydir");
+  ReturnIsDirOnLstat("/mydir/mydir2");
+  EXPECT_CALL(fsimpl, fsyncDir(StrEq("/mydir/mydir2")))
+    .Times(1).WillOnce(Return());
+
+  FsyncDir("/mydir/mydir2");
+}
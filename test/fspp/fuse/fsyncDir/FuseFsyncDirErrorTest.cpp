@@ -0,0 +1,23 @@
+#include "testutils/FuseFsyncDirTest.h"
+
+#include "fspp/fuse/FuseErrnoException.h"
+
+using ::testing::StrEq;
+using ::testing::Throw;
+using ::testing::WithParamInterface;
+using ::testing::Values;
+
+using namespace fspp::fuse;
+
+class FuseFsyncDirErrorTest: public FuseFsyncDirTest, public WithParamInterface<int> {
+};
+INSTANTIATE_TEST_CASE_P(FuseFsyncDirErrorTest, FuseFsyncDirErrorTest, Values(EBADF, EIO, EROFS, EINVAL));
+
+TEST_P(FuseFsyncDirErrorTest, ReturnedErrorIsCorrect) {
+  ReturnIsDirOnLstat(DIRNAME);
+  EXPECT_CALL(fsimpl, fsyncDir(StrEq(DIRNAME)))
+    .Times(1).WillOnce(Throw(FuseErrnoException(GetParam())));
+
+  int error = FsyncDirReturnError(DIRNAME);
+  EXPECT_EQ(GetParam(), error);
+}
@@ -0,0 +1,23 @@
+#include "FuseFsyncDirTest.h"
+
+void FuseFsyncDirTest::FsyncDir(const char *dirname) {
+  int error = FsyncDirReturnError(dirname);
+  EXPECT_EQ(0, error);
+}
+
+int FuseFsyncDirTest::FsyncDirReturnError(const char *dirname) {
+  auto fs = TestFS();
+
+  int fd = OpenDir(fs.get(), dirname);
+  int retval = ::fsync(fd);
+  int error = (retval == 0) ? 0 : errno;
+  ::close(fd);
+  return error;
+}
+
+int FuseFsyncDirTest::OpenDir(const TempTestFS *fs, const char *dirname) {
+  auto realpath = fs->mountDir() / dirname;
+  int fd = ::open(realpath.c_str(), O_RDONLY | O_DIRECTORY);
+  EXPECT_GE(fd, 0) << "Error opening directory";
+  return fd;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#ifndef MESSMER_FSPP_TEST_FUSE_FSYNCDIR_TESTUTILS_FUSEFSYNCDIRTEST_H_
+#define MESSMER_FSPP_TEST_FUSE_FSYNCDIR_TESTUTILS_FUSEFSYNCDIRTEST_H_
+
+#include "../../../testutils/FuseTest.h"
+
+class FuseFsyncDirTest: public FuseTest {
+public:
+  const char *DIRNAME = "/mydir";
+
+  void FsyncDir(const char *dirname);
+  int FsyncDirReturnError(const char *dirname);
+
+private:
+  int OpenDir(const TempTestFS *fs, const char *dirname);
+};
+
+#endif
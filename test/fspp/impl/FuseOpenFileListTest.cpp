@@ -21,9 +21,12 @@ public:
   MOCK_CONST_METHOD1(truncate, void(off_t));
   MOCK_CONST_METHOD3(read, size_t(void*, size_t, off_t));
   MOCK_METHOD3(write, void(const void*, size_t, off_t));
+  MOCK_METHOD3(writeInPlace, void(size_t, off_t, const std::function<void (void*, size_t)>&));
   MOCK_METHOD0(flush, void());
   MOCK_METHOD0(fsync, void());
   MOCK_METHOD0(fdatasync, void());
+  MOCK_CONST_METHOD1(seekData, off_t(off_t));
+  MOCK_CONST_METHOD1(seekHole, off_t(off_t));
 };
 
 struct FuseOpenFileListTest: public ::testing::Test {
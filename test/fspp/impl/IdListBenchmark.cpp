@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include "fspp/impl/IdList.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
+
+using cpputils::make_unique_ref;
+using cpputils::unique_ref;
+
+using namespace fspp;
+
+namespace {
+
+// The previous IdList implementation: a map guarded by a mutex that is also locked for lookups
+template<class Entry>
+class MutexMapIdList final {
+public:
+  MutexMapIdList(): _entries(), _id_counter(0), _mutex() {}
+
+  int add(unique_ref<Entry> entry) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    int new_id = ++_id_counter;
+    _entries.insert(std::make_pair(new_id, std::move(entry)));
+    return new_id;
+  }
+
+  Entry *get(int id) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entries.at(id).get();
+  }
+
+  void remove(int id) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _entries.erase(id);
+  }
+
+private:
+  std::map<int, unique_ref<Entry>> _entries;
+  int _id_counter;
+  std::mutex _mutex;
+
+  DISALLOW_COPY_AND_ASSIGN(MutexMapIdList);
+};
+
+}
+
+// Microbenchmark for looking up open files from many threads, like FUSE worker threads do on each read and write.
+// Each thread mostly looks up a shared set of open files, and every 100th operation opens and closes a file of its own.
+// It is disabled by default because it takes a while and doesn't check anything.
+// Run it with --gtest_also_run_disabled_tests --gtest_filter=*IdListBenchmark*
+class IdListBenchmark: public ::testing::Test {
+public:
+  static constexpr int NUM_OPEN_FILES = 100;
+  static constexpr int OPERATIONS_PER_THREAD = 200000;
+
+  template<class List>
+  static double measure(int numThreads) {
+    List list;
+    std::vector<int> ids;
+    for (int i = 0; i < NUM_OPEN_FILES; ++i) {
+      ids.push_back(list.add(make_unique_ref<int>(i)));
+    }
+    std::atomic<bool> start(false);
+    std::atomic<int64_t> checksum(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; ++t) {
+      threads.emplace_back([&list, &ids, &start, &checksum, t] {
+        while (!start) {
+          std::this_thread::yield();
+        }
+        int64_t sum = 0;
+        for (int i = 0; i < OPERATIONS_PER_THREAD; ++i) {
+          if (i % 100 == 0) {
+            list.remove(list.add(make_unique_ref<int>(i)));
+          } else {
+            sum += *list.get(ids[(i + t) % NUM_OPEN_FILES]);
+          }
+        }
+        checksum += sum;
+      });
+    }
+    auto begin = std::chrono::steady_clock::now();
+    start = true;
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - begin;
+    return static_cast<double>(numThreads) * OPERATIONS_PER_THREAD / duration.count() / 1000000;
+  }
+};
+
+TEST_F(IdListBenchmark, DISABLED_ConcurrentLookups) {
+  for (int numThreads : {1, 2, 4, 8, 16, 32, 64}) {
+    double mutexMap = measure<MutexMapIdList<int>>(numThreads);
+    double idList = measure<IdList<int>>(numThreads);
+    std::cout << numThreads << " threads: mutex+map " << mutexMap << " Mops/s, IdList " << idList << " Mops/s" << std::endl;
+  }
+}
@@ -2,6 +2,9 @@
 
 #include "fspp/impl/IdList.h"
 #include <stdexcept>
+#include <atomic>
+#include <thread>
+#include <vector>
 
 using cpputils::make_unique_ref;
 
@@ -107,3 +110,53 @@ TEST_F(IdListTest, Add3AndConstGet) {
   checkConst(id3, OBJ3);
   checkConst(id2, OBJ2);
 }
+
+TEST_F(IdListTest, ReusesRemovedId) {
+  add(OBJ1);
+  int id = add(OBJ2);
+  list.remove(id);
+  int reused = add(OBJ3);
+  EXPECT_EQ(id, reused);
+  check(reused, OBJ3);
+}
+
+TEST_F(IdListTest, ReusesLowestRemovedId) {
+  int id1 = add(OBJ1);
+  int id2 = add(OBJ2);
+  add(OBJ3);
+  list.remove(id2);
+  list.remove(id1);
+  EXPECT_EQ(id1, add());
+  EXPECT_EQ(id2, add());
+}
+
+TEST_F(IdListTest, AddManyAndGet) {
+  // Spans multiple chunks of the slot array
+  std::vector<int> ids;
+  for (int i = 0; i < 3 * IdList<MyObj>::CHUNK_SIZE; ++i) {
+    ids.push_back(add(i));
+  }
+  for (int i = 0; i < 3 * IdList<MyObj>::CHUNK_SIZE; ++i) {
+    check(ids[i], i);
+  }
+}
+
+TEST_F(IdListTest, GetWhileOtherThreadsAddAndRemove) {
+  int id = add(OBJ1);
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> writers;
+  for (int i = 0; i < 4; ++i) {
+    writers.emplace_back([this, &stop] {
+      while (!stop) {
+        list.remove(add(OBJ2));
+      }
+    });
+  }
+  for (int i = 0; i < 100000; ++i) {
+    check(id, OBJ1);
+  }
+  stop = true;
+  for (auto &writer : writers) {
+    writer.join();
+  }
+}
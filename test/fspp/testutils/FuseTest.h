@@ -52,9 +52,11 @@ public:
   MOCK_METHOD2(ftruncate, void(int, off_t));
   MOCK_METHOD4(read, size_t(int, void*, size_t, off_t));
   MOCK_METHOD4(write, void(int, const void*, size_t, off_t));
+  MOCK_METHOD4(writeInPlace, void(int, size_t, off_t, const std::function<void (void*, size_t)>&));
   MOCK_METHOD1(flush, void(int));
   MOCK_METHOD1(fsync, void(int));
   MOCK_METHOD1(fdatasync, void(int));
+  MOCK_METHOD3(lseek, off_t(int, off_t, int));
   MOCK_PATH_METHOD2(access, void, int);
   MOCK_PATH_METHOD4(createAndOpenFile, int, mode_t, uid_t, gid_t);
   MOCK_PATH_METHOD4(mkdir, void, mode_t, uid_t, gid_t);
@@ -68,6 +70,7 @@ public:
     return cpputils::nullcheck(std::unique_ptr<std::vector<fspp::Dir::Entry>>(readDir(path.c_str()))).value();
   }
   MOCK_METHOD1(readDir, std::vector<fspp::Dir::Entry>*(const char*));
+  MOCK_PATH_METHOD1(fsyncDir, void);
   void utimens(const boost::filesystem::path &path, timespec lastAccessTime, timespec lastModificationTime) override {
     return utimens(path.c_str(), lastAccessTime, lastModificationTime);
   }
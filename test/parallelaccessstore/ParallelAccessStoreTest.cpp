@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+#include "parallelaccessstore/ParallelAccessStore.h"
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+#include <future>
+#include <vector>
+
+using ::testing::Test;
+using cpputils::unique_ref;
+using cpputils::make_unique_ref;
+using boost::optional;
+using boost::none;
+using std::vector;
+using std::future;
+using std::mutex;
+using std::unique_lock;
+using std::condition_variable;
+using std::chrono::seconds;
+
+using namespace parallelaccessstore;
+
+namespace {
+
+struct MockKey final {
+  int value;
+
+  static MockKey Null() {
+    return MockKey{-1};
+  }
+  bool operator==(const MockKey &rhs) const {
+    return value == rhs.value;
+  }
+  bool operator<(const MockKey &rhs) const {
+    return value < rhs.value;
+  }
+};
+
+}
+
+namespace std {
+  template<> struct hash<MockKey> {
+    size_t operator()(const MockKey &key) const {
+      return std::hash<int>()(key.value);
+    }
+  };
+}
+
+namespace {
+
+struct MockResource final {
+  explicit MockResource(int value_): value(value_) {}
+  int value;
+};
+
+class MockResourceRef final: public ParallelAccessStore<MockResource, MockResourceRef, MockKey>::ResourceRefBase {
+public:
+  explicit MockResourceRef(MockResource *resource): _resource(resource) {}
+  int value() const {
+    return _resource->value;
+  }
+private:
+  MockResource *_resource;
+};
+
+// Base store that blocks each load until a given number of loads is running at the same time
+// (or a timeout passes). This allows checking how many loads the ParallelAccessStore runs in parallel.
+class BlockingBaseStore final: public ParallelAccessBaseStore<MockResource, MockKey> {
+public:
+  BlockingBaseStore(unsigned int waitForNumParallelLoads, int *numLoadsCalled, unsigned int *maxParallelLoads)
+    : _mutex(), _cv(), _waitForNumParallelLoads(waitForNumParallelLoads), _numRunningLoads(0),
+      _numLoadsCalled(numLoadsCalled), _maxParallelLoads(maxParallelLoads), _numRemovesCalled(0) {}
+
+  optional<unique_ref<MockResource>> loadFromBaseStore(const MockKey &key) override {
+    unique_lock<mutex> lock(_mutex);
+    ++*_numLoadsCalled;
+    ++_numRunningLoads;
+    *_maxParallelLoads = std::max(*_maxParallelLoads, _numRunningLoads);
+    _cv.notify_all();
+    _cv.wait_for(lock, seconds(5), [this] {return *_maxParallelLoads >= _waitForNumParallelLoads;});
+    --_numRunningLoads;
+    if (key.value < 0) {
+      return none;
+    }
+    return make_unique_ref<MockResource>(key.value);
+  }
+
+  void removeFromBaseStore(unique_ref<MockResource> /*resource*/) override {
+    unique_lock<mutex> lock(_mutex);
+    ++_numRemovesCalled;
+  }
+
+  int numRemovesCalled() {
+    unique_lock<mutex> lock(_mutex);
+    return _numRemovesCalled;
+  }
+
+  void setWaitForNumParallelLoads(unsigned int value) {
+    unique_lock<mutex> lock(_mutex);
+    _waitForNumParallelLoads = value;
+  }
+
+private:
+  mutex _mutex;
+  condition_variable _cv;
+  unsigned int _waitForNumParallelLoads;
+  unsigned int _numRunningLoads;
+  int *_numLoadsCalled;
+  unsigned int *_maxParallelLoads;
+  int _numRemovesCalled;
+};
+
+}
+
+class ParallelAccessStoreTest: public Test {
+public:
+  static constexpr unsigned int NUM_THREADS = 8;
+
+  ParallelAccessStoreTest(): numLoadsCalled(0), maxParallelLoads(0),
+    baseStore(new BlockingBaseStore(NUM_THREADS, &numLoadsCalled, &maxParallelLoads)),
+    store(std::move(cpputils::nullcheck(std::unique_ptr<BlockingBaseStore>(baseStore)).value())),
+    numFinishedLoads(0), finishedLoadsMutex(), finishedLoadsCv() {}
+
+  int numLoadsCalled;
+  unsigned int maxParallelLoads;
+  BlockingBaseStore *baseStore;
+  ParallelAccessStore<MockResource, MockResourceRef, MockKey> store;
+
+  unsigned int numFinishedLoads;
+  mutex finishedLoadsMutex;
+  condition_variable finishedLoadsCv;
+
+  // Loads a key in each of NUM_THREADS threads. Each thread keeps its resource open until all threads finished loading.
+  vector<future<int>> loadInParallel(std::function<MockKey (unsigned int)> keyForThread) {
+    vector<future<int>> results;
+    for (unsigned int i = 0; i < NUM_THREADS; ++i) {
+      MockKey key = keyForThread(i);
+      results.push_back(std::async(std::launch::async, [this, key] {
+        auto loaded = store.load(key);
+        waitUntilAllThreadsFinishedLoading();
+        if (loaded == none) {
+          return -1;
+        }
+        return (*loaded)->value();
+      }));
+    }
+    return results;
+  }
+
+  void waitUntilAllThreadsFinishedLoading() {
+    unique_lock<mutex> lock(finishedLoadsMutex);
+    ++numFinishedLoads;
+    finishedLoadsCv.notify_all();
+    finishedLoadsCv.wait(lock, [this] {return numFinishedLoads >= NUM_THREADS;});
+  }
+};
+
+constexpr unsigned int ParallelAccessStoreTest::NUM_THREADS;
+
+TEST_F(ParallelAccessStoreTest, LoadsDifferentKeysInParallel) {
+  auto results = loadInParallel([] (unsigned int i) {return MockKey{static_cast<int>(i)};});
+  for (unsigned int i = 0; i < NUM_THREADS; ++i) {
+    EXPECT_EQ(static_cast<int>(i), results[i].get());
+  }
+  EXPECT_EQ(static_cast<int>(NUM_THREADS), numLoadsCalled);
+  EXPECT_EQ(NUM_THREADS, maxParallelLoads);
+}
+
+TEST_F(ParallelAccessStoreTest, LoadsSameKeyOnlyOnce) {
+  baseStore->setWaitForNumParallelLoads(1);
+  auto results = loadInParallel([] (unsigned int) {return MockKey{5};});
+  for (auto &result : results) {
+    EXPECT_EQ(5, result.get());
+  }
+  EXPECT_EQ(1, numLoadsCalled);
+}
+
+TEST_F(ParallelAccessStoreTest, LoadsNonexistingKeysInParallel) {
+  auto results = loadInParallel([] (unsigned int i) {return MockKey{-1-static_cast<int>(i)};});
+  for (auto &result : results) {
+    EXPECT_EQ(-1, result.get());
+  }
+  EXPECT_EQ(NUM_THREADS, maxParallelLoads);
+}
+
+TEST_F(ParallelAccessStoreTest, LoadThroughput) {
+  // Each base store load blocks until NUM_THREADS loads are running concurrently. With a single global lock
+  // held during loading, each load would run into the timeout and this would take NUM_THREADS*5 seconds.
+  auto start = std::chrono::steady_clock::now();
+  auto results = loadInParallel([] (unsigned int i) {return MockKey{static_cast<int>(i)};});
+  for (auto &result : results) {
+    result.get();
+  }
+  auto duration = std::chrono::steady_clock::now() - start;
+  EXPECT_LT(duration, seconds(5));
+}
+
+TEST_F(ParallelAccessStoreTest, RemoveByKeyRemovesUnopenedResource) {
+  bool removeUnopenedCalled = false;
+  EXPECT_TRUE(store.remove(MockKey{5}, [&] {
+    removeUnopenedCalled = true;
+    return true;
+  }));
+  EXPECT_TRUE(removeUnopenedCalled);
+  EXPECT_EQ(0, numLoadsCalled);
+}
+
+TEST_F(ParallelAccessStoreTest, RemoveByKeyReturnsFalseIfResourceDoesntExist) {
+  EXPECT_FALSE(store.remove(MockKey{5}, [] {return false;}));
+}
+
+TEST_F(ParallelAccessStoreTest, LoadReturnsNoneWhileRemovingByKey) {
+  baseStore->setWaitForNumParallelLoads(1);
+  store.remove(MockKey{5}, [this] {
+    EXPECT_EQ(none, store.load(MockKey{5}));
+    return true;
+  });
+  EXPECT_EQ(0, numLoadsCalled);
+}
+
+TEST_F(ParallelAccessStoreTest, RemoveByKeyWaitsUntilOpenedResourceIsReleased) {
+  baseStore->setWaitForNumParallelLoads(1);
+  auto loaded = store.load(MockKey{5});
+  auto removed = std::async(std::launch::async, [this] {
+    return store.remove(MockKey{5}, [] {
+      ADD_FAILURE() << "Resource is opened and shouldn't be removed with removeUnopened";
+      return false;
+    });
+  });
+  EXPECT_EQ(std::future_status::timeout, removed.wait_for(std::chrono::milliseconds(100)));
+  cpputils::destruct(std::move(*loaded));
+  EXPECT_TRUE(removed.get());
+  EXPECT_EQ(1, baseStore->numRemovesCalled());
+}